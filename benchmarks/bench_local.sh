@@ -0,0 +1,110 @@
+#!/usr/bin/env bash
+#
+# Self-contained localhost throughput benchmark.
+#
+# Starts tests/bench-server (built via 'make -C tests bench-server') and
+# drives wget2 over its synthetic workloads:
+#   many-small  2000 x 4KB files behind one index page (per-request overhead)
+#   huge-file   one 64MB file (raw transfer throughput)
+#   html-tree   recursive HTML tree, depth 5 / fanout 3 (parse + scheduling)
+#
+# Reports requests/sec, MB/s and CPU time per MB for each workload.
+# No network access needed - everything runs against 127.0.0.1.
+
+set -e
+set -o pipefail
+set -u
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+
+WGET2="$SCRIPT_DIR/../src/wget2_noinstall"
+SERVER="$SCRIPT_DIR/../tests/bench-server"
+
+WGET2_OPTIONS="-q --no-config --no-tcp-fastopen"
+
+NRUNS=3
+
+if [ ! -x "$WGET2" ]; then
+	echo "$WGET2 not found, build wget2 first" >&2
+	exit 1
+fi
+if [ ! -x "$SERVER" ]; then
+	echo "$SERVER not found, run 'make -C $SCRIPT_DIR/../tests bench-server' first" >&2
+	exit 1
+fi
+
+# GNU time gives us user+sys CPU, fall back to wall clock only
+TIME=""
+if /usr/bin/time -f "%e %U %S" true 2>/dev/null; then
+	TIME="/usr/bin/time -f %e_%U_%S -o"
+fi
+
+WORKDIR="$(mktemp -d)"
+SERVER_OUT="$WORKDIR/server.out"
+
+cleanup() {
+	[ -n "${SERVER_PID:-}" ] && kill "$SERVER_PID" 2>/dev/null || true
+	rm -rf "$WORKDIR"
+}
+trap cleanup EXIT
+
+"$SERVER" > "$SERVER_OUT" &
+SERVER_PID=$!
+
+# wait for "PORT <n>" - body generation takes a moment
+PORT=""
+for _ in $(seq 1 100); do
+	PORT="$(awk '/^PORT/ { print $2 }' "$SERVER_OUT")"
+	[ -n "$PORT" ] && break
+	sleep 0.1
+done
+if [ -z "$PORT" ]; then
+	echo "bench-server did not come up" >&2
+	exit 1
+fi
+
+# run_workload <name> <nrequests> <wget2 args...>
+run_workload() {
+	local name="$1" nurls="$2"
+	shift 2
+	local best_wall=0 wall user sys cpu bytes dir
+
+	for run in $(seq 1 "$NRUNS"); do
+		dir="$WORKDIR/$name.$run"
+		mkdir "$dir"
+
+		if [ -n "$TIME" ]; then
+			(cd "$dir" && $TIME "$WORKDIR/time.out" "$WGET2" $WGET2_OPTIONS "$@")
+			IFS=_ read -r wall user sys < "$WORKDIR/time.out"
+		else
+			local before after
+			before="$(date +%s%3N)"
+			(cd "$dir" && "$WGET2" $WGET2_OPTIONS "$@")
+			after="$(date +%s%3N)"
+			wall="$(echo "scale=3; ($after - $before) / 1000" | bc)"
+			user=0; sys=0
+		fi
+
+		bytes="$(du -sb "$dir" | cut -f1)"
+
+		if [ "$best_wall" = 0 ] || [ "$(echo "$wall < $best_wall" | bc)" = 1 ]; then
+			best_wall="$wall"; cpu="$(echo "$user + $sys" | bc)"
+		fi
+	done
+
+	printf "%-12s %8s req/s %8s MB/s" "$name" \
+		"$(echo "scale=1; $nurls / $best_wall" | bc)" \
+		"$(echo "scale=1; $bytes / $best_wall / 1048576" | bc)"
+	if [ -n "$TIME" ]; then
+		printf " %8s CPU-ms/MB" "$(echo "scale=1; $cpu * 1000 * 1048576 / $bytes" | bc)"
+	fi
+	printf "  (best of %d)\n" "$NRUNS"
+}
+
+echo "wget2 $("$WGET2" --version | head -1 | cut -d' ' -f3) against bench-server on port $PORT"
+echo
+
+# 2000 files + index; 364 pages + 364 payloads in the tree
+run_workload many-small 2001 -r -np "http://127.0.0.1:$PORT/small/index.html"
+run_workload huge-file 1 -O huge.dat "http://127.0.0.1:$PORT/huge.dat"
+run_workload html-tree 728 -r -np "http://127.0.0.1:$PORT/tree/index.html"
@@ -222,6 +222,10 @@ WGET_BEGIN_DECLS
 #define WGET_NET_FAMILY_PREFERRED 1017
 #define WGET_TCP_FASTFORWARD  1018
 
+// flags for wget_global_init_flags()
+#define WGET_INIT_DEFAULT 0
+#define WGET_INIT_MINIMAL (1 << 0) // skip console setup and CPU feature detection
+
 #define WGET_HTTP_URL                 2000
 #define WGET_HTTP_URL_ENCODING        2001
 #define WGET_HTTP_URI                 2002
@@ -242,6 +246,7 @@ WGET_BEGIN_DECLS
 #define WGET_HTTP_BODY                2017
 #define WGET_HTTP_BODY_SAVEAS         2018
 #define WGET_HTTP_USER_DATA           2019
+#define WGET_HTTP_STREAM_PRIORITY     2020
 
 // definition of error conditions
 #define WGET_E_SUCCESS 0 /* OK */
@@ -257,6 +262,8 @@ typedef void (*wget_global_get_func_t)(const char *, size_t);
 
 WGETAPI void
 	wget_global_init(int key, ...);
+WGETAPI void
+	wget_global_init_flags(int flags, int key, ...);
 WGETAPI void
 	wget_global_deinit(void);
 WGETAPI const void *
@@ -266,6 +273,17 @@ WGETAPI int
 WGETAPI wget_global_get_func_t
 	wget_global_get_func(int key);
 
+// CPU features for wget_cpu_supports(), bit flags so several can be tested at once
+#define WGET_CPU_FEATURE_SSE2  (1 << 0)
+#define WGET_CPU_FEATURE_AVX2  (1 << 1)
+#define WGET_CPU_FEATURE_NEON  (1 << 2)
+#define WGET_CPU_FEATURE_SSSE3 (1 << 3)
+
+WGETAPI int
+	wget_cpu_supports(int features);
+WGETAPI void
+	wget_cpu_set_simd(int enable);
+
 /*
  * Utility functions
  */
@@ -292,12 +310,31 @@ WGETAPI wget_global_get_func_t
 typedef int (*wget_update_load_t)(void *, FILE *fp);
 typedef int (*wget_update_save_t)(void *, FILE *fp);
 
+// file descriptor slot for wget_ready_2_transfer_multi()
+typedef struct {
+	int
+		fd; // file descriptor to wait for, < 0 to ignore this slot
+	short
+		events, // requested events, bitwise or of WGET_IO_READABLE / WGET_IO_WRITABLE
+		revents; // returned ready events
+} wget_io_event_t;
+
+// data fragment for wget_tcp_writev()
+typedef struct {
+	const void *
+		data;
+	size_t
+		length;
+} wget_iovec_t;
+
 WGETAPI int
 	wget_ready_2_read(int fd, int timeout);
 WGETAPI int
 	wget_ready_2_write(int fd, int timeout);
 WGETAPI int
 	wget_ready_2_transfer(int fd, int timeout, int mode);
+WGETAPI int
+	wget_ready_2_transfer_multi(wget_io_event_t *events, int nevents, int timeout);
 WGETAPI int
 	wget_strcmp(const char *s1, const char *s2) G_GNUC_WGET_PURE;
 WGETAPI int
@@ -318,6 +355,8 @@ WGETAPI void
 	wget_millisleep(int ms);
 WGETAPI long long
 	wget_get_timemillis(void);
+WGETAPI long long
+	wget_get_timemillis_coarse(void);
 WGETAPI int
 	wget_percent_unescape(char *src);
 WGETAPI int
@@ -405,6 +444,31 @@ WGETAPI void
 WGETAPI int
 	wget_list_browse(const wget_list_t *list, wget_list_browse_t browse, void *context) G_GNUC_WGET_NONNULL((2));
 
+/**
+ * \ingroup libwget-list
+ *
+ * Link structure for intrusive double linked lists.
+ * Embed it as the first member of your struct, then linking and unlinking
+ * are pointer operations without any allocation or copying per element.
+ */
+typedef struct wget_list_node_st wget_list_node_t;
+struct wget_list_node_st {
+	wget_list_node_t
+		*next,
+		*prev;
+};
+
+WGETAPI void
+	wget_list_link_append(wget_list_node_t **list, wget_list_node_t *node) G_GNUC_WGET_NONNULL_ALL;
+WGETAPI void
+	wget_list_link_remove(wget_list_node_t **list, wget_list_node_t *node) G_GNUC_WGET_NONNULL_ALL;
+WGETAPI void *
+	wget_list_link_first(const wget_list_node_t *list) G_GNUC_WGET_CONST;
+WGETAPI void *
+	wget_list_link_next(const wget_list_node_t *list, const wget_list_node_t *node) G_GNUC_WGET_PURE;
+WGETAPI int
+	wget_list_link_browse(wget_list_node_t *list, wget_list_browse_t browse, void *context) G_GNUC_WGET_NONNULL((2));
+
 /*
  * Memory allocation routines
  */
@@ -425,6 +489,45 @@ WGETAPI void
 WGETAPI void
 	wget_set_oomfunc(wget_oom_callback_t);
 
+// optional allocation accounting, see wget_alloc_stats_enable()
+typedef enum {
+	WGET_ALLOC_TAG_MISC,
+	WGET_ALLOC_TAG_HTTP,
+	WGET_ALLOC_TAG_IRI,
+	WGET_ALLOC_TAG_COOKIE,
+	WGET_ALLOC_TAG_HTML,
+	WGET_ALLOC_TAG_QUEUE,
+	WGET_ALLOC_TAG_MAX
+} wget_alloc_tag_t;
+
+typedef struct {
+	long long
+		nallocs,     // calls to wget_malloc/wget_calloc/wget_realloc
+		nfrees,      // calls to wget_free (global stats only, frees carry no tag)
+		alloc_bytes, // cumulative allocated bytes
+		cur_bytes,   // currently allocated bytes (global stats only)
+		peak_bytes;  // high-water mark of cur_bytes (global stats only)
+} wget_alloc_stats_t;
+
+WGETAPI void
+	wget_alloc_stats_enable(int enable);
+WGETAPI int
+	wget_alloc_tag(wget_alloc_tag_t tag);
+WGETAPI void
+	wget_alloc_stats_get(int tag, wget_alloc_stats_t *stats) G_GNUC_WGET_NONNULL((2));
+WGETAPI const char *
+	wget_alloc_tag_name(wget_alloc_tag_t tag) G_GNUC_WGET_CONST;
+
+// scoped bump allocation for parse-sized object graphs, see wget_arena_push()
+typedef struct _wget_arena_st wget_arena_t;
+
+WGETAPI wget_arena_t *
+	wget_arena_push(wget_arena_t *resume);
+WGETAPI wget_arena_t *
+	wget_arena_pop(void);
+WGETAPI void
+	wget_arena_free(wget_arena_t **arena);
+
 /*
  * String/Memory routines, slightly different than standard functions
  */
@@ -438,6 +541,21 @@ WGETAPI char *
 WGETAPI void
 	wget_strmemcpy(char *s, size_t ssize, const void *m, size_t n);
 
+/*
+ * Reference counted immutable string routines
+ */
+
+WGETAPI char *
+	wget_refstr_memdup(const void *m, size_t n) G_GNUC_WGET_ALLOC_SIZE(2);
+WGETAPI char *
+	wget_refstr_dup(const char *s) G_GNUC_WGET_MALLOC;
+WGETAPI char *
+	wget_refstr_ref(const char *s);
+WGETAPI void
+	wget_refstr_unref(const char **strp);
+WGETAPI size_t
+	wget_refstr_len(const char *s) G_GNUC_WGET_PURE;
+
 /*
  * Base64 routines
  */
@@ -478,9 +596,12 @@ typedef struct {
 		length; // number of bytes in 'data'
 	size_t
 		size; // capacity of 'data' (terminating 0 byte doesn't count here)
+	size_t
+		growth_cap; // upper bound for the exponential growth per resize, 0 = no bound
 	bool
 		release_data : 1, // 'data' has been malloc'ed and must be freed
-		release_buf : 1; // buffer_t structure has been malloc'ed and must be freed
+		release_buf : 1, // buffer_t structure has been malloc'ed and must be freed
+		page_aligned : 1; // round allocations up to full 4 KiB pages
 } wget_buffer_t;
 
 WGETAPI wget_buffer_t *
@@ -489,6 +610,12 @@ WGETAPI wget_buffer_t *
 	wget_buffer_alloc(size_t size) G_GNUC_WGET_MALLOC G_GNUC_WGET_ALLOC_SIZE(1);
 WGETAPI void
 	wget_buffer_ensure_capacity(wget_buffer_t *buf, size_t size);
+WGETAPI void
+	wget_buffer_set_growth_policy(wget_buffer_t *buf, size_t growth_cap, bool page_aligned);
+WGETAPI wget_buffer_t *
+	wget_buffer_acquire(size_t size);
+WGETAPI void
+	wget_buffer_release(wget_buffer_t **buf);
 WGETAPI void
 	wget_buffer_deinit(wget_buffer_t *buf);
 WGETAPI void
@@ -515,6 +642,10 @@ WGETAPI size_t
 	wget_buffer_memset_append(wget_buffer_t *buf, char c, size_t length);
 WGETAPI char *
 	wget_buffer_trim(wget_buffer_t *buf);
+WGETAPI size_t
+	wget_buffer_append_int(wget_buffer_t *buf, long long arg);
+WGETAPI size_t
+	wget_buffer_append_hex(wget_buffer_t *buf, unsigned long long arg);
 WGETAPI size_t
 	wget_buffer_vprintf_append(wget_buffer_t *buf, const char *fmt, va_list args) G_GNUC_WGET_PRINTF_FORMAT(2,0);
 WGETAPI size_t
@@ -559,6 +690,14 @@ WGETAPI const char *
 WGETAPI bool
 	wget_logger_is_active(wget_logger_t *logger) G_GNUC_WGET_PURE;
 
+// asynchronous logging backend (log_async.c)
+WGETAPI int
+	wget_log_async_start(size_t max_pending);
+WGETAPI void
+	wget_log_async_stop(void);
+WGETAPI long long
+	wget_log_async_dropped(void);
+
 /*
  * Logging routines
  */
@@ -598,6 +737,8 @@ typedef int (*wget_vector_destructor_t)(void *elem);
 
 WGETAPI wget_vector_t *
 	wget_vector_create(int max, int off, wget_vector_compare_t cmp) G_GNUC_WGET_MALLOC;
+WGETAPI wget_vector_t *
+	wget_vector_create_sorted(int count, void **elems, wget_vector_compare_t cmp) G_GNUC_WGET_MALLOC;
 WGETAPI void
 	wget_vector_deinit(wget_vector_t *v);
 WGETAPI int
@@ -614,6 +755,8 @@ WGETAPI int
 	wget_vector_insert_sorted(wget_vector_t *v, const void *elem, size_t size) G_GNUC_WGET_NONNULL((2));
 WGETAPI int
 	wget_vector_insert_sorted_noalloc(wget_vector_t *v, const void *elem) G_GNUC_WGET_NONNULL((2));
+WGETAPI int
+	wget_vector_add_batch_sorted(wget_vector_t *v, void **elems, int count) G_GNUC_WGET_NONNULL((2));
 WGETAPI int
 	wget_vector_add(wget_vector_t *v, const void *elem, size_t size) G_GNUC_WGET_NONNULL((2));
 WGETAPI int
@@ -668,8 +811,12 @@ typedef void (*wget_hashmap_value_destructor_t)(void *value);
 
 WGETAPI wget_hashmap_t
 	*wget_hashmap_create(int max, wget_hashmap_hash_t hash, wget_hashmap_compare_t cmp) G_GNUC_WGET_MALLOC;
+WGETAPI wget_hashmap_t
+	*wget_hashmap_create_linear(int max, wget_hashmap_hash_t hash, wget_hashmap_compare_t cmp) G_GNUC_WGET_MALLOC;
 WGETAPI void
 	wget_hashmap_set_growth_policy(wget_hashmap_t *h, int off);
+WGETAPI void
+	wget_hashmap_use_key_arena(wget_hashmap_t *h, size_t chunk_size);
 WGETAPI int
 	wget_hashmap_put(wget_hashmap_t *h, const void *key, size_t keysize, const void *value, size_t valuesize);
 WGETAPI int
@@ -682,6 +829,10 @@ WGETAPI int
 	wget_hashmap_size(const wget_hashmap_t *h) G_GNUC_WGET_PURE;
 WGETAPI int
 	wget_hashmap_browse(const wget_hashmap_t *h, wget_hashmap_browse_t browse, void *ctx) G_GNUC_WGET_NONNULL((2));
+WGETAPI int
+	wget_hashmap_snapshot(const wget_hashmap_t *h, void ***entries) G_GNUC_WGET_NONNULL((2));
+WGETAPI int
+	wget_hashmap_browse_snapshot(void **entries, int count, wget_hashmap_browse_t browse, void *ctx) G_GNUC_WGET_NONNULL((3));
 WGETAPI void
 	wget_hashmap_free(wget_hashmap_t **h);
 WGETAPI void
@@ -720,6 +871,8 @@ typedef void (*wget_stringmap_value_destructor_t)(void *value);
 
 WGETAPI wget_stringmap_t *
 	wget_stringmap_create(int max) G_GNUC_WGET_MALLOC;
+WGETAPI wget_stringmap_t *
+	wget_stringmap_create_arena(int max) G_GNUC_WGET_MALLOC;
 WGETAPI wget_stringmap_t *
 	wget_stringmap_create_nocase(int max) G_GNUC_WGET_MALLOC;
 WGETAPI int
@@ -759,6 +912,46 @@ WGETAPI void
 WGETAPI void
 	wget_stringmap_set_value_destructor(wget_hashmap_t *h, wget_stringmap_value_destructor_t destructor);
 
+/*
+ * Bounded multi-producer/multi-consumer queue routines
+ */
+
+typedef struct _wget_mpmc_queue_st wget_mpmc_queue_t;
+
+WGETAPI wget_mpmc_queue_t *
+	wget_mpmc_queue_create(size_t size) G_GNUC_WGET_MALLOC;
+WGETAPI void
+	wget_mpmc_queue_free(wget_mpmc_queue_t **q);
+WGETAPI int
+	wget_mpmc_queue_push(wget_mpmc_queue_t *q, void *entry) G_GNUC_WGET_NONNULL((1));
+WGETAPI void *
+	wget_mpmc_queue_pop(wget_mpmc_queue_t *q) G_GNUC_WGET_NONNULL((1));
+WGETAPI size_t
+	wget_mpmc_queue_size(wget_mpmc_queue_t *q) G_GNUC_WGET_NONNULL((1));
+
+/*
+ * Hashed timing wheel routines
+ */
+
+typedef struct _wget_timer_wheel_st wget_timer_wheel_t;
+typedef struct _wget_timer_st wget_timer_t;
+typedef void wget_timer_cb_t(void *ctx);
+
+WGETAPI wget_timer_wheel_t *
+	wget_timer_wheel_create(int nslots, int tick_ms);
+WGETAPI wget_timer_t *
+	wget_timer_wheel_add(wget_timer_wheel_t *wheel, long long timeout_ms, wget_timer_cb_t *cb, void *ctx) G_GNUC_WGET_NONNULL((1,3));
+WGETAPI void
+	wget_timer_wheel_cancel(wget_timer_wheel_t *wheel, wget_timer_t **timer) G_GNUC_WGET_NONNULL((1));
+WGETAPI int
+	wget_timer_wheel_tick(wget_timer_wheel_t *wheel, long long now_ms) G_GNUC_WGET_NONNULL((1));
+WGETAPI long long
+	wget_timer_wheel_next(wget_timer_wheel_t *wheel, long long now_ms) G_GNUC_WGET_NONNULL((1));
+WGETAPI int
+	wget_timer_wheel_size(wget_timer_wheel_t *wheel);
+WGETAPI void
+	wget_timer_wheel_free(wget_timer_wheel_t **wheel);
+
 /*
  * Thread wrapper routines
  */
@@ -779,8 +972,12 @@ typedef int wget_thread_cond_t;
 
 WGETAPI int
 	wget_thread_start(wget_thread_t *thread, void *(*start_routine)(void *), void *arg, int flags);
+WGETAPI int
+	wget_thread_bind_cpu(wget_thread_t thread, int n);
 WGETAPI int
 	wget_thread_mutex_init(wget_thread_mutex_t *mutex);
+WGETAPI int
+	wget_thread_mutex_init_adaptive(wget_thread_mutex_t *mutex);
 WGETAPI void
 	wget_thread_mutex_lock(wget_thread_mutex_t *);
 WGETAPI void
@@ -795,6 +992,8 @@ WGETAPI int
 	wget_thread_cond_init(wget_thread_cond_t *cond);
 WGETAPI int
 	wget_thread_cond_signal(wget_thread_cond_t *cond);
+WGETAPI int
+	wget_thread_cond_signal_n(wget_thread_cond_t *cond, int n);
 WGETAPI int
 	wget_thread_cond_wait(wget_thread_cond_t *cond, wget_thread_mutex_t *mutex, long long ms);
 WGETAPI wget_thread_t
@@ -802,6 +1001,17 @@ WGETAPI wget_thread_t
 WGETAPI bool
 	wget_thread_support(void) G_GNUC_WGET_CONST;
 
+typedef struct _wget_thread_pool_st wget_thread_pool_t;
+
+WGETAPI wget_thread_pool_t *
+	wget_thread_pool_create(int nthreads);
+WGETAPI int
+	wget_thread_pool_dispatch(wget_thread_pool_t *pool, void (*fn)(void *), void *arg) G_GNUC_WGET_NONNULL((1,2));
+WGETAPI void
+	wget_thread_pool_wait(wget_thread_pool_t *pool) G_GNUC_WGET_NONNULL((1));
+WGETAPI void
+	wget_thread_pool_free(wget_thread_pool_t **pool);
+
 /*
  * Decompressor routines
  */
@@ -816,7 +1026,8 @@ enum {
 	wget_content_encoding_deflate = 2,
 	wget_content_encoding_lzma = 3,
 	wget_content_encoding_bzip2 = 4,
-	wget_content_encoding_brotli = 5
+	wget_content_encoding_brotli = 5,
+	wget_content_encoding_zstd = 6
 };
 
 WGETAPI wget_decompressor_t *
@@ -903,6 +1114,17 @@ typedef struct wget_iri_st {
 	 */
 	const char *
 		connection_part;
+	/**
+	 * Resolve prefix. Like `connection_part` it is just a lazily computed helper:
+	 * the connection part plus the directory part of `path`, e.g.
+	 *
+	 *     http://www.example.com:8080/path/to/
+	 *
+	 * It is used by wget_iri_relative_to_abs() to resolve relative URLs
+	 * against this IRI without re-deriving the base per reference.
+	 */
+	const char *
+		resolve_prefix;
 	/**
 	 * Length of the directory part in `path`.
 	 *
@@ -910,6 +1132,17 @@ typedef struct wget_iri_st {
 	 */
 	size_t
 		dirlen;
+	/**
+	 * Length of `resolve_prefix`.
+	 */
+	size_t
+		resolve_prefix_len;
+	/**
+	 * Length of the root part of `resolve_prefix`, i.e. the connection part
+	 * plus the slash that follows it (`http://www.example.com:8080/`).
+	 */
+	size_t
+		resolve_root_len;
 	/**
 	 * Port number.
 	 *
@@ -1157,6 +1390,64 @@ WGETAPI int
 WGETAPI int
 	wget_hsts_db_load(wget_hsts_db_t *hsts_db);
 
+/*
+ * HTTP validator cache (ETag / Last-Modified)
+ */
+
+/**
+ * \ingroup libwget-etag
+ *
+ * ETag database for storing HTTP validators (ETag / Last-Modified) per URI
+ */
+typedef struct wget_etag_db_st wget_etag_db_t;
+
+WGETAPI wget_etag_db_t *
+	wget_etag_db_init(wget_etag_db_t *etag_db, const char *fname);
+WGETAPI void
+	wget_etag_db_set_fname(wget_etag_db_t *etag_db, const char *fname);
+WGETAPI void
+	wget_etag_db_deinit(wget_etag_db_t *etag_db);
+WGETAPI void
+	wget_etag_db_free(wget_etag_db_t **etag_db);
+WGETAPI void
+	wget_etag_db_add(wget_etag_db_t *etag_db, const char *uri, const char *etag, int64_t last_modified);
+WGETAPI int
+	wget_etag_db_get(wget_etag_db_t *etag_db, const char *uri, char **etag, int64_t *last_modified);
+WGETAPI int64_t
+	wget_etag_db_created(wget_etag_db_t *etag_db, const char *uri);
+WGETAPI int
+	wget_etag_db_save(wget_etag_db_t *etag_db);
+WGETAPI int
+	wget_etag_db_load(wget_etag_db_t *etag_db);
+
+/**
+ * \ingroup libwget-caps
+ *
+ * Capability database for storing per-host facts (ALPN protocol, byte ranges, keep-alive)
+ */
+typedef struct wget_caps_db_st wget_caps_db_t;
+
+WGETAPI wget_caps_db_t *
+	wget_caps_db_init(wget_caps_db_t *caps_db, const char *fname);
+WGETAPI void
+	wget_caps_db_set_fname(wget_caps_db_t *caps_db, const char *fname);
+WGETAPI void
+	wget_caps_db_deinit(wget_caps_db_t *caps_db);
+WGETAPI void
+	wget_caps_db_free(wget_caps_db_t **caps_db);
+WGETAPI void
+	wget_caps_db_add(wget_caps_db_t *caps_db, const char *host, uint16_t port, const char *alpn, char accept_ranges, char keep_alive);
+WGETAPI int
+	wget_caps_db_get(wget_caps_db_t *caps_db, const char *host, uint16_t port, char **alpn, char *accept_ranges, char *keep_alive);
+WGETAPI void
+	wget_caps_db_add_bdp(wget_caps_db_t *caps_db, const char *host, uint16_t port, int rtt_ms, long long rate);
+WGETAPI int
+	wget_caps_db_get_bufsize(wget_caps_db_t *caps_db, const char *host, uint16_t port);
+WGETAPI int
+	wget_caps_db_save(wget_caps_db_t *caps_db);
+WGETAPI int
+	wget_caps_db_load(wget_caps_db_t *caps_db);
+
 /*
  * HTTP Public Key Pinning (HPKP)
  */
@@ -1273,6 +1564,8 @@ struct wget_hpkp_db_vtable {
 	void (*add)(wget_hpkp_db_t *, wget_hpkp_t *);
 	/// Implementation of \ref wget_hpkp_db_check_pubkey "wget_hpkp_db_check_pubkey()"
 	int (*check_pubkey)(wget_hpkp_db_t *, const char *, const void *, size_t);
+	/// Implementation of \ref wget_hpkp_db_generation "wget_hpkp_db_generation()". May be NULL, callers then must not cache pin-check results.
+	int64_t (*generation)(wget_hpkp_db_t *);
 };
 
 struct wget_hpkp_db_st {
@@ -1314,6 +1607,8 @@ WGETAPI void
 	wget_hpkp_db_free(wget_hpkp_db_t **hpkp_db);
 WGETAPI int
 	wget_hpkp_db_check_pubkey(wget_hpkp_db_t *hpkp_db, const char *host, const void *pubkey, size_t pubkeysize);
+WGETAPI int64_t
+	wget_hpkp_db_generation(wget_hpkp_db_t *hpkp_db);
 WGETAPI void
 	wget_hpkp_db_add(wget_hpkp_db_t *hpkp_db, wget_hpkp_t **hpkp);
 WGETAPI int
@@ -1466,6 +1761,8 @@ struct wget_ocsp_db_vtable {
 	void (*add_host)(wget_ocsp_db_t *, const char *, time_t);
 	/// Implementation of wget_ocsp_db_free()
 	void (*free)(wget_ocsp_db_t *);
+	/// Implementation of wget_ocsp_db_changed(). May be NULL, callers then assume unsaved changes.
+	int (*changed)(wget_ocsp_db_t *);
 };
 
 struct wget_ocsp_db_st {
@@ -1493,6 +1790,8 @@ WGETAPI int
 	wget_ocsp_db_save(wget_ocsp_db_t *ocsp_db);
 WGETAPI int
 	wget_ocsp_db_load(wget_ocsp_db_t *ocsp_db);
+WGETAPI int
+	wget_ocsp_db_changed(wget_ocsp_db_t *ocsp_db);
 
 /*
  * .netrc routines
@@ -1542,6 +1841,8 @@ WGETAPI wget_netrc_t *
 	wget_netrc_get(const wget_netrc_db_t *netrc_db, const char *host);
 WGETAPI int
 	wget_netrc_db_load(wget_netrc_db_t *netrc_db, const char *fname);
+WGETAPI void
+	wget_netrc_db_lazy_load(wget_netrc_db_t *netrc_db, const char *fname);
 
 /*
  * CSS parsing routines
@@ -1613,6 +1914,8 @@ typedef struct {
 		base;
 	bool
 		follow : 1;
+	wget_arena_t
+		*arena; // owns all memory of this result (may be NULL), released in one sweep
 } wget_html_parsed_result_t;
 
 typedef struct {
@@ -1622,16 +1925,28 @@ typedef struct {
 		attribute;
 } wget_html_tag_t;
 
+typedef struct _wget_html_stream_st wget_html_stream_t;
+
 WGETAPI wget_html_parsed_result_t *
 	wget_html_get_urls_inline(const char *html, wget_vector_t *additional_tags, wget_vector_t *ignore_tags);
 WGETAPI void
 	wget_html_free_urls_inline(wget_html_parsed_result_t **res);
+WGETAPI wget_html_stream_t *
+	wget_html_stream_init(wget_vector_t *additional_tags, wget_vector_t *ignore_tags);
+WGETAPI void
+	wget_html_stream_feed(wget_html_stream_t *stream, const char *data, size_t len) G_GNUC_WGET_NONNULL((1));
+WGETAPI wget_html_parsed_result_t *
+	wget_html_stream_close(wget_html_stream_t **stream, const char *html);
 WGETAPI void
 	wget_sitemap_get_urls_inline(const char *sitemap, wget_vector_t **urls, wget_vector_t **sitemap_urls);
 WGETAPI void
 	wget_atom_get_urls_inline(const char *atom, wget_vector_t **urls);
+WGETAPI void
+	wget_atom_get_urls_inline_since(const char *atom, wget_vector_t **urls, time_t since, time_t *newest);
 WGETAPI void
 	wget_rss_get_urls_inline(const char *rss, wget_vector_t **urls);
+WGETAPI void
+	wget_rss_get_urls_inline_since(const char *rss, wget_vector_t **urls, time_t since, time_t *newest);
 
 /*
  * XML and HTML parsing routines
@@ -1654,6 +1969,14 @@ WGETAPI void
 
 typedef void (*wget_xml_callback_t)(void *, int, const char *, const char *, const char *, size_t, size_t);
 
+typedef struct _wget_xml_stream_st wget_xml_stream_t;
+
+WGETAPI wget_xml_stream_t *
+	wget_xml_stream_init(wget_xml_callback_t callback, void *user_ctx, int hints);
+WGETAPI void
+	wget_xml_stream_feed(wget_xml_stream_t *stream, const char *data, size_t len) G_GNUC_WGET_NONNULL((1));
+WGETAPI void
+	wget_xml_stream_close(wget_xml_stream_t **stream);
 WGETAPI void
 	wget_xml_parse_buffer(
 		const char *buf,
@@ -1702,12 +2025,30 @@ WGETAPI void
 	wget_tcp_deinit(wget_tcp_t **tcp);
 WGETAPI void
 	wget_dns_cache_free(void);
+WGETAPI void
+	wget_dns_cache_set_ttl(int secs);
+WGETAPI int
+	wget_dns_cache_save(const char *fname);
+WGETAPI int
+	wget_dns_cache_load(const char *fname);
 WGETAPI void
 	wget_tcp_close(wget_tcp_t *tcp);
 WGETAPI void
 	wget_tcp_set_timeout(wget_tcp_t *tcp, int timeout);
 WGETAPI int
 	wget_tcp_get_timeout(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
+WGETAPI int
+	wget_tcp_get_fd(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
+WGETAPI void
+	wget_tcp_set_readahead_size(wget_tcp_t *tcp, size_t size);
+WGETAPI size_t
+	wget_tcp_get_readahead_size(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
+WGETAPI void
+	wget_tcp_set_pacing_rate(wget_tcp_t *tcp, size_t rate);
+WGETAPI size_t
+	wget_tcp_get_pacing_rate(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
+WGETAPI void
+	wget_tcp_set_caps_db(wget_tcp_t *tcp, wget_caps_db_t *caps_db);
 WGETAPI void
 	wget_tcp_set_connect_timeout(wget_tcp_t *tcp, int timeout);
 WGETAPI void
@@ -1718,6 +2059,8 @@ WGETAPI void
 	wget_tcp_set_tcp_fastopen(wget_tcp_t *tcp, int tcp_fastopen);
 WGETAPI void
 	wget_tcp_set_tls_false_start(wget_tcp_t *tcp, int false_start);
+WGETAPI void
+	wget_tcp_set_tls_early_data(wget_tcp_t *tcp, int early_data);
 WGETAPI void
 	wget_tcp_set_ssl(wget_tcp_t *tcp, int ssl);
 WGETAPI int
@@ -1726,6 +2069,10 @@ WGETAPI void
 	wget_tcp_set_ssl_hostname(wget_tcp_t *tcp, const char *hostname);
 WGETAPI const char *
 	wget_tcp_get_ssl_hostname(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
+WGETAPI void
+	wget_tcp_set_socks5_proxy(wget_tcp_t *tcp, const char *hostport);
+WGETAPI const char *
+	wget_tcp_get_socks5_proxy(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
 WGETAPI void
 	wget_tcp_set_ssl_ca_file(wget_tcp_t *tcp, const char *cafile);
 WGETAPI void
@@ -1734,8 +2081,12 @@ WGETAPI int
 	wget_tcp_get_dns_caching(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
 WGETAPI char
 	wget_tcp_get_tcp_fastopen(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
+WGETAPI void
+	wget_tcp_get_stats_tcp_fastopen(int *nsends, int *nfallbacks);
 WGETAPI char
 	wget_tcp_get_tls_false_start(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
+WGETAPI char
+	wget_tcp_get_tls_early_data(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
 WGETAPI int
 	wget_tcp_get_family(wget_tcp_t *tcp) G_GNUC_WGET_PURE;
 WGETAPI int
@@ -1768,13 +2119,24 @@ WGETAPI ssize_t
 	wget_tcp_printf(wget_tcp_t *tcp, const char *fmt, ...) G_GNUC_WGET_PRINTF_FORMAT(2,3);
 WGETAPI ssize_t
 	wget_tcp_write(wget_tcp_t *tcp, const char *buf, size_t count);
+WGETAPI ssize_t
+	wget_tcp_writev(wget_tcp_t *tcp, const wget_iovec_t *iov, int iovcnt);
 WGETAPI ssize_t
 	wget_tcp_read(wget_tcp_t *tcp, char *buf, size_t count);
+WGETAPI ssize_t
+	wget_tcp_splice_to_fd(wget_tcp_t *tcp, int out_fd, size_t count);
+WGETAPI ssize_t
+	wget_tcp_splice_from_fd(wget_tcp_t *tcp, int in_fd, size_t count);
 WGETAPI int
 	wget_tcp_ready_2_transfer(wget_tcp_t *tcp, int flags);
 
 WGETAPI bool
 	wget_ip_is_family(const char *host, int family) G_GNUC_WGET_PURE;
+WGETAPI bool
+	wget_ip_is_address(const char *host) G_GNUC_WGET_PURE;
+struct sockaddr; // defined in <sys/socket.h>, not pulled in here
+WGETAPI bool
+	wget_ip_to_string(const struct sockaddr *addr, char *dst, size_t size);
 
 /*
  * SSL routines
@@ -1836,6 +2198,8 @@ typedef struct {
 		name;
 	const char *
 		value;
+	bool
+		is_static; // name/value are static or outlive the request - don't copy or free them
 } wget_http_header_param_t;
 
 typedef struct {
@@ -1858,6 +2222,17 @@ typedef struct {
 		encoded_digest;
 } wget_http_digest_t;
 
+typedef struct {
+	const char *
+		alpn; // protocol identifier of the alternative, e.g. "h2" or "h3"
+	const char *
+		host; // alternative host, NULL = same host as the origin
+	long long
+		max_age; // freshness lifetime in seconds
+	uint16_t
+		port;
+} wget_http_alt_svc_t;
+
 typedef struct {
 	const char *
 		auth_scheme;
@@ -1873,6 +2248,7 @@ enum {
 typedef struct wget_http_response_t wget_http_response_t;
 typedef int (*wget_http_header_callback_t)(wget_http_response_t *, void *);
 typedef int (*wget_http_body_callback_t)(wget_http_response_t *, void *, const char *, size_t);
+typedef int wget_http_header_handler_t(wget_http_response_t *resp, const char *value);
 
 // keep the request as simple as possible
 typedef struct {
@@ -1882,6 +2258,8 @@ typedef struct {
 		scheme;
 	const char *
 		body;
+	const char *
+		body_fname; // file streamed as the request body at send time, no full-body buffering
 	wget_http_header_callback_t
 		header_callback; // called after HTTP header has been received
 	wget_http_body_callback_t
@@ -1900,6 +2278,9 @@ typedef struct {
 		body_length;
 	int32_t
 		stream_id; // HTTP2 stream id
+	int
+		body_sink_fd, // optional sink for zero-copy body download, -1 if unused; spliced bytes bypass body_callback
+		stream_priority; // HTTP/2 stream weight (1-256), 0 = protocol default
 	char
 		esc_resource_buf[256];
 	char
@@ -1914,6 +2295,10 @@ typedef struct {
 		request_start; // When this request was sent out
 	long long
 		first_response_start; // The time we read the first bytes back
+	wget_http_body_callback_t
+		raw_body_callback; // called for each body chunk as received from the wire, before decompression
+	void *
+		raw_body_user_data; // meant to be used in raw body callback function
 
 } wget_http_request_t;
 
@@ -1929,6 +2314,8 @@ struct wget_http_response_t {
 		cookies;
 	wget_vector_t *
 		challenges;
+	wget_vector_t *
+		alt_svcs; // alternative services announced via Alt-Svc (RFC 7838)
 	wget_hpkp_t *
 		hpkp;
 	const char *
@@ -1971,21 +2358,45 @@ struct wget_http_response_t {
 	bool
 		content_length_valid : 1,
 		hsts : 1, // if hsts_maxage and hsts_include_subdomains are valid
-		csp : 1;
+		csp : 1,
+		accept_ranges : 1, // whether the server advertised 'Accept-Ranges: bytes'
+		content_type_interned : 1, // content_type points into the intern table, do not free
+		content_type_encoding_interned : 1; // same for content_type_encoding
 	long long
 		response_end; // When this response was received
 };
 
 typedef struct _wget_http_connection_st wget_http_connection_t;
 
+// called when the server promises a pushed stream (HTTP/2 PUSH_PROMISE).
+// Return a request describing how to receive the pushed response - it is
+// treated as if it had been sent with wget_http_send_request() - or NULL
+// to cancel the pushed stream. 'parent_req' is the request the push was
+// associated with.
+typedef wget_http_request_t *(*wget_http_server_push_callback_t)(wget_http_connection_t *conn, const char *uri, wget_http_request_t *parent_req);
+
 WGETAPI const char *
 	wget_http_get_host(const wget_http_connection_t *conn);
 WGETAPI uint16_t
 	wget_http_get_port(const wget_http_connection_t *conn);
+WGETAPI const char *
+	wget_http_get_proxy_host(const wget_http_connection_t *conn);
+WGETAPI uint16_t
+	wget_http_get_proxy_port(const wget_http_connection_t *conn);
 WGETAPI const char *
 	wget_http_get_scheme(const wget_http_connection_t *conn);
 WGETAPI int
 	wget_http_get_protocol(const wget_http_connection_t *conn);
+WGETAPI int
+	wget_http_get_max_concurrent_streams(const wget_http_connection_t *conn);
+WGETAPI int
+	wget_http_get_fd(const wget_http_connection_t *conn);
+WGETAPI int
+	wget_http_want_events(wget_http_connection_t *conn) G_GNUC_WGET_NONNULL_ALL;
+WGETAPI int
+	wget_http_handle_events(wget_http_connection_t *conn, int revents, wget_http_response_t **response) G_GNUC_WGET_NONNULL_ALL;
+WGETAPI void
+	wget_http_set_server_push_callback(wget_http_server_push_callback_t fn);
 
 WGETAPI bool
 	wget_http_isseparator(char c) G_GNUC_WGET_CONST;
@@ -2008,6 +2419,8 @@ WGETAPI const char *
 	wget_http_parse_link(const char *s, wget_http_link_t *link) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI const char *
 	wget_http_parse_digest(const char *s, wget_http_digest_t *digest) G_GNUC_WGET_NONNULL_ALL;
+WGETAPI const char *
+	wget_http_parse_alt_svc(const char *s, wget_http_alt_svc_t *alt_svc) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI const char *
 	wget_http_parse_challenge(const char *s, wget_http_challenge_t *challenge) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI const char *
@@ -2044,6 +2457,8 @@ WGETAPI void
 	wget_http_add_header_printf(wget_http_request_t *req, const char *name, const char *fmt, ...) G_GNUC_WGET_PRINTF_FORMAT(3,4) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI void
 	wget_http_add_header(wget_http_request_t *req, const char *name, const char *value) G_GNUC_WGET_NONNULL_ALL;
+WGETAPI void
+	wget_http_add_header_nocopy(wget_http_request_t *req, const char *name, const char *value) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI void
 	wget_http_add_header_param(wget_http_request_t *req, wget_http_header_param_t *param) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI void
@@ -2056,6 +2471,8 @@ WGETAPI int
 	wget_http_set_no_proxy(const char *no_proxy, const char *encoding);
 WGETAPI int
 	wget_http_match_no_proxy(wget_vector_t *no_proxies, const char *host);
+WGETAPI bool
+	wget_http_uses_proxy(const wget_iri_t *iri) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI void
 	wget_http_abort_connection(wget_http_connection_t *conn);
 
@@ -2065,6 +2482,8 @@ WGETAPI void
 	wget_http_free_cookie(wget_cookie_t *cookie);
 WGETAPI void
 	wget_http_free_digest(wget_http_digest_t *digest);
+WGETAPI void
+	wget_http_free_alt_svc(wget_http_alt_svc_t *alt_svc);
 WGETAPI void
 	wget_http_free_challenge(wget_http_challenge_t *challenge);
 WGETAPI void
@@ -2078,6 +2497,8 @@ WGETAPI void
 	wget_http_free_digests(wget_vector_t **digests);
 WGETAPI void
 	wget_http_free_challenges(wget_vector_t **challenges);
+WGETAPI void
+	wget_http_free_alt_svcs(wget_vector_t **alt_svcs);
 WGETAPI void
 	wget_http_free_links(wget_vector_t **links);
 //WGETAPI void
@@ -2093,6 +2514,8 @@ WGETAPI wget_http_response_t *
 	wget_http_get_header(wget_iri_t *iri) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI int
 	wget_http_parse_header_line(wget_http_response_t *resp, const char *name, size_t namelen, const char *value, size_t valuelen);
+WGETAPI int
+	wget_http_register_header_handler(const char *name, wget_http_header_handler_t *handler);
 WGETAPI wget_http_response_t *
 	wget_http_parse_response_header(char *buf) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI wget_http_response_t *
@@ -2112,6 +2535,8 @@ WGETAPI void
 	wget_http_request_set_header_cb(wget_http_request_t *req, wget_http_header_callback_t cb, void *user_data) G_GNUC_WGET_NONNULL((1));
 WGETAPI void
 	wget_http_request_set_body_cb(wget_http_request_t *req, wget_http_body_callback_t cb, void *user_data) G_GNUC_WGET_NONNULL((1));
+WGETAPI void
+	wget_http_request_set_raw_body_cb(wget_http_request_t *req, wget_http_body_callback_t cb, void *user_data) G_GNUC_WGET_NONNULL((1));
 WGETAPI void
 	wget_http_request_set_int(wget_http_request_t *req, int key, int value) G_GNUC_WGET_NONNULL((1));
 WGETAPI int
@@ -2122,6 +2547,8 @@ WGETAPI void *
 	wget_http_request_get_ptr(wget_http_request_t *req, int key) G_GNUC_WGET_NONNULL((1));
 WGETAPI void
 	wget_http_request_set_body(wget_http_request_t *req, const char *mimetype, char *body, size_t length) G_GNUC_WGET_NONNULL((1));
+WGETAPI int
+	wget_http_request_set_body_file(wget_http_request_t *req, const char *mimetype, const char *fname) G_GNUC_WGET_NONNULL((1,3));
 WGETAPI int
 	wget_http_send_request(wget_http_connection_t *conn, wget_http_request_t *req) G_GNUC_WGET_NONNULL_ALL;
 WGETAPI ssize_t
@@ -2133,6 +2560,23 @@ WGETAPI ssize_t
 
 WGETAPI wget_http_response_t *
 	wget_http_get(int first_key, ...);
+
+// Multi-transfer API: submit many URLs, perform them over shared
+// connections (HTTP/2 streams, HTTP/1.1 keep-alive). The callback is
+// invoked once per URL with the final response, or NULL on failure;
+// the response is free'd after the callback returns.
+typedef struct wget_http_multi_st wget_http_multi_t;
+typedef void wget_http_multi_callback_t(wget_http_response_t *resp, const wget_iri_t *iri, void *user_data);
+
+WGETAPI wget_http_multi_t *
+	wget_http_multi_init(void);
+WGETAPI int
+	wget_http_multi_add(wget_http_multi_t *multi, const char *url, void *user_data) G_GNUC_WGET_NONNULL((1,2));
+WGETAPI int
+	wget_http_multi_perform(wget_http_multi_t *multi, wget_http_multi_callback_t *cb) G_GNUC_WGET_NONNULL((1));
+WGETAPI void
+	wget_http_multi_free(wget_http_multi_t **multi);
+
 WGETAPI wget_vector_t
 	*wget_get_css_urls(const char *data);
 
@@ -2164,7 +2608,8 @@ typedef enum {
 	WGET_DIGTYPE_SHA256,  /**< Type 'SHA256' digest */
 	WGET_DIGTYPE_SHA384,  /**< Type 'SHA384' digest */
 	WGET_DIGTYPE_SHA512,  /**< Type 'SHA512' digest */
-	WGET_DIGTYPE_SHA224   /**< Type 'SHA224' digest */
+	WGET_DIGTYPE_SHA224,  /**< Type 'SHA224' digest */
+	WGET_DIGTYPE_TREE_SHA256 /**< Type 'tree-sha256' digest, computed by the wget_hash_file* functions */
 } wget_digest_algorithm_t;
 
 WGETAPI wget_digest_algorithm_t
@@ -2205,11 +2650,15 @@ WGETAPI void G_GNUC_WGET_PRINTF_FORMAT(4,5) G_GNUC_WGET_NONNULL_ALL
 
 typedef struct {
 	wget_iri_t
-		*iri;        //!< parsed URL of the mirror
+		*iri;          //!< parsed URL of the mirror
+	long long
+		transferred,   //!< bytes delivered by this mirror, updated live during the transfer
+		transfer_time; //!< milliseconds spent delivering those bytes
 	int
-		priority;    //!< priority of the mirror
+		priority,      //!< priority of the mirror
+		failures;      //!< failed chunk attempts in a row
 	char
-		location[8]; //!< location of the mirror, e.g. 'de', 'fr' or 'jp'
+		location[8];   //!< location of the mirror, e.g. 'de', 'fr' or 'jp'
 } wget_metalink_mirror_t;
 
 typedef struct {
@@ -2239,8 +2688,16 @@ typedef struct {
 		size;     //!< total size of the file
 } wget_metalink_t;
 
+typedef struct _wget_metalink_stream_st wget_metalink_stream_t;
+
 WGETAPI wget_metalink_t
 	*wget_metalink_parse(const char *xml) G_GNUC_WGET_NONNULL((1));
+WGETAPI wget_metalink_stream_t
+	*wget_metalink_stream_init(void);
+WGETAPI void
+	wget_metalink_stream_feed(wget_metalink_stream_t *stream, const char *data, size_t len);
+WGETAPI wget_metalink_t
+	*wget_metalink_stream_close(wget_metalink_stream_t **stream);
 WGETAPI void
 	wget_metalink_free(wget_metalink_t **metalink);
 WGETAPI void
@@ -2507,6 +2964,53 @@ typedef int (*wget_plugin_post_processor_t)
 WGETAPI void
 wget_plugin_register_post_processor(wget_plugin_t *plugin, wget_plugin_post_processor_t fn);
 
+/**
+ * \ingroup libwget-plugin
+ *
+ * Read-only snapshot of the scheduler state, see wget_plugin_get_scheduler_info().
+ */
+typedef struct {
+	/// Number of queued, not yet started downloads over all hosts
+	int queue_depth;
+	/// Queued downloads for the host passed to the query, -1 if no host was given
+	int host_pending;
+	/// Downloader threads currently receiving a response
+	int threads_busy;
+	/// Body bytes received so far by the active downloads
+	long long bytes_in_flight;
+	/// Announced body bytes of the active downloads (responses of unknown size excluded)
+	long long bytes_expected;
+} wget_scheduler_info_t;
+
+// Takes a read-only snapshot of the scheduler state.
+WGETAPI void
+wget_plugin_get_scheduler_info(wget_plugin_t *plugin, const char *host, wget_scheduler_info_t *info);
+
+// Filter positions for wget_plugin_register_body_filter()
+#define WGET_PLUGIN_BODY_RAW     0 // wire bytes, before Content-Encoding is undone
+#define WGET_PLUGIN_BODY_DECODED 1 // after decompression, what would be written to disk
+
+/**
+ * \ingroup libwget-plugin
+ *
+ * Prototype of the function for observing response body data as it streams in.
+ * The chunks are the library's own receive buffers - no copy is made, and the
+ * data must not be modified or referenced after the call returns.
+ * The function must be thread-safe.
+ *
+ * \param[in] plugin The plugin handle
+ * \param[in] iri The source address of the response
+ * \param[in] data Pointer to the chunk data
+ * \param[in] length Number of bytes in the chunk
+ * \return 0 to continue the transfer, any other value to cancel it mid-stream.
+ */
+typedef int (*wget_plugin_body_filter_t)
+	(wget_plugin_t *plugin, const wget_iri_t *iri, const char *data, size_t length);
+
+// Registers a plugin function for observing streaming body data.
+WGETAPI void
+wget_plugin_register_body_filter(wget_plugin_t *plugin, wget_plugin_body_filter_t fn, int position);
+
 /**
  * \ingroup libwget-plugin
  *
@@ -2536,6 +3040,9 @@ struct wget_plugin_vtable
 	void (* add_hsts_db)(wget_plugin_t *, wget_hsts_db_t *, int);
 	void (* add_hpkp_db)(wget_plugin_t *, wget_hpkp_db_t *, int);
 	void (* add_ocsp_db)(wget_plugin_t *, wget_ocsp_db_t *, int);
+
+	void (* get_scheduler_info)(wget_plugin_t *, const char *, wget_scheduler_info_t *);
+	void (* register_body_filter)(wget_plugin_t *, wget_plugin_body_filter_t, int);
 };
 
 /*
@@ -2574,7 +3081,11 @@ typedef enum {
 	WGET_STATS_TLS_CON = 6,
 	WGET_STATS_TLS_RESUMED = 7,
 	WGET_STATS_TLS_TCP_PROTO = 8,
-	WGET_STATS_TLS_CERT_CHAIN_SIZE = 9
+	WGET_STATS_TLS_CERT_CHAIN_SIZE = 9,
+	WGET_STATS_TLS_TCP_SECS = 10,
+	WGET_STATS_TLS_EARLY_DATA = 11,
+	WGET_STATS_TLS_HPKP_CACHED = 12,
+	WGET_STATS_TLS_HPKP_SECS = 13
 } wget_tls_stats_t;
 
 typedef enum {
@@ -29,6 +29,7 @@
 #include <config.h>
 
 #include <unistd.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <c-ctype.h>
@@ -48,13 +49,56 @@
 struct _atom_context {
 	wget_vector_t
 		*urls;
+	time_t
+		since, // skip entries at or before this timestamp (0 = collect everything)
+		newest; // newest entry timestamp seen so far
+	char
+		done; // early exit: the remaining entries are older than 'since'
 };
 
+// Parse an RFC 3339 timestamp as used by Atom <updated>/<published>,
+// e.g. 2021-06-09T10:18:14Z. The timezone offset is ignored - the cursor
+// only needs a consistent ordering of the entries within one feed.
+static time_t _atom_parse_rfc3339(const char *s, size_t len)
+{
+	// cumulated number of days until beginning of month for non-leap years
+	static const int sum_of_days[12] = {
+		0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+	};
+	char buf[40];
+	int year, mon, day, hour, min, sec, leap_year, days;
+
+	if (len < 19 || len >= sizeof(buf))
+		return 0;
+	memcpy(buf, s, len);
+	buf[len] = 0;
+
+	if (sscanf(buf, "%4d-%2d-%2d%*1[Tt ]%2d:%2d:%2d", &year, &mon, &day, &hour, &min, &sec) != 6)
+		return 0;
+
+	if (year < 1970 || mon < 1 || mon > 12 || day < 1 || day > 31
+		|| hour < 0 || hour > 23 || min < 0 || min > 60 || sec < 0 || sec > 60)
+		return 0;
+
+	leap_year = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+
+	// calculate time_t from GMT/UTC time values (as in wget_http_parse_full_date)
+	days = 365 * (year - 1970)
+		+ ((year - 1) / 4 - 492) - ((year - 1) / 100 - 19) + ((year - 1) / 400 - 4);
+	days += sum_of_days[mon - 1] + (mon > 2 && leap_year);
+	days += day - 1;
+
+	return (((time_t) days * 24 + hour) * 60 + min) * 60 + sec;
+}
+
 static void _atom_get_url(void *context, int flags, const char *dir, const char *attr, const char *val, size_t len, size_t pos G_GNUC_WGET_UNUSED)
 {
 	struct _atom_context *ctx = context;
 	wget_string_t url;
 
+	if (ctx->done)
+		return; // everything below the cursor - just let the tokenizer run out
+
 	if (!val || !len)
 		return;
 
@@ -83,6 +127,22 @@ static void _atom_get_url(void *context, int flags, const char *dir, const char
 		if (elem) {
 			elem++;
 
+			if (!wget_strcasecmp_ascii(elem, "updated") || !wget_strcasecmp_ascii(elem, "published")) {
+				time_t t = _atom_parse_rfc3339(val, len);
+
+				if (t > ctx->newest)
+					ctx->newest = t;
+
+				// Entries are ordered newest first - once one is at or below
+				// the cursor, the rest of the feed has been seen before.
+				// This also triggers on the feed-level <updated> element when
+				// the whole feed is unchanged since the last poll.
+				if (ctx->since && t && t <= ctx->since)
+					ctx->done = 1;
+
+				return;
+			}
+
 			if (!wget_strcasecmp_ascii(elem, "icon") || !wget_strcasecmp_ascii(elem, "id")
 				 || !wget_strcasecmp_ascii(elem, "logo"))
 			{
@@ -113,11 +173,32 @@ static void _atom_get_url(void *context, int flags, const char *dir, const char
  */
 void wget_atom_get_urls_inline(const char *atom, wget_vector_t **urls)
 {
-	struct _atom_context context = { .urls = NULL };
+	wget_atom_get_urls_inline_since(atom, urls, 0, NULL);
+}
+
+/**
+ * \param[in] atom Atom XML data
+ * \param[in,out] urls Pointer to return vector of URLs
+ * \param[in] since Entry timestamp cursor, 0 to collect everything
+ * \param[out] newest If not NULL, returns the newest entry timestamp seen
+ *
+ * Like wget_atom_get_urls_inline(), but with a timestamp cursor for polling:
+ * extraction stops at the first entry whose `updated`/`published` timestamp
+ * is at or below \p since. Since feed entries are ordered newest first,
+ * re-polling an unchanged or slightly grown feed only scans the new entries.
+ *
+ * The newest timestamp seen is returned in \p newest, to be passed as
+ * \p since on the next poll of the same feed.
+ */
+void wget_atom_get_urls_inline_since(const char *atom, wget_vector_t **urls, time_t since, time_t *newest)
+{
+	struct _atom_context context = { .urls = NULL, .since = since };
 
 	wget_xml_parse_buffer(atom, _atom_get_url, &context, XML_HINT_REMOVE_EMPTY_CONTENT);
 
 	*urls = context.urls;
+	if (newest)
+		*newest = context.newest;
 }
 
 /**@}*/
@@ -95,8 +95,8 @@ typedef struct {
 		tick;
 	enum _bar_slot_status_t
 		status;
-	bool
-		redraw : 1;
+	char
+		redraw; // dirty flag, set lock-free by the downloader threads
 } _bar_slot_t;
 
 struct _wget_bar_st {
@@ -113,24 +113,37 @@ struct _wget_bar_st {
 		max_width;
 	wget_thread_mutex_t
 		mutex;
+	wget_buffer_t
+		frame; // pending escape sequences + text, written out in one go
 };
 
 static volatile sig_atomic_t winsize_changed;
 
 static inline G_GNUC_WGET_ALWAYS_INLINE void
-_restore_cursor_position(void)
+_restore_cursor_position(wget_bar_t *bar)
 {
 	// CSI u: Restore cursor position
-	printf("\033[u");
+	wget_buffer_strcat(&bar->frame, "\033[u");
 }
 
 static inline G_GNUC_WGET_ALWAYS_INLINE void
-_bar_print_slot(const wget_bar_t *bar, int slot)
+_bar_print_slot(wget_bar_t *bar, int slot)
 {
 	// CSI s: Save cursor
 	// CSI <n> A: Cursor up
 	// CSI <n> G: Cursor horizontal absolute
-	printf("\033[s\033[%dA\033[1G", bar->nslots - slot);
+	wget_buffer_printf_append(&bar->frame, "\033[s\033[%dA\033[1G", bar->nslots - slot);
+}
+
+// write the collected frame with a single write(2) instead of one syscall
+// per escape sequence or fragment
+static void _bar_flush(wget_bar_t *bar)
+{
+	if (bar->frame.length) {
+		fwrite(bar->frame.data, 1, bar->frame.length, stdout);
+		fflush(stdout);
+		wget_buffer_reset(&bar->frame);
+	}
 }
 
 static inline G_GNUC_WGET_ALWAYS_INLINE void
@@ -165,7 +178,7 @@ _bar_set_progress(const wget_bar_t *bar, int slot)
 	}
 }
 
-static void _bar_update_slot(const wget_bar_t *bar, int slot)
+static void _bar_update_slot(wget_bar_t *bar, int slot)
 {
 	_bar_slot_t *slotp = &bar->slots[slot];
 
@@ -197,14 +210,13 @@ static void _bar_update_slot(const wget_bar_t *bar, int slot)
 		// xxx.xxK		_BAR_DOWNBYTES_SIZE		Number of downloaded bytes
 		// ===>			Remaining				Progress Meter
 
-		printf("%-*.*s %*d%% [%s] %*s",
+		wget_buffer_printf_append(&bar->frame, "%-*.*s %*d%% [%s] %*s",
 				_BAR_FILENAME_SIZE, _BAR_FILENAME_SIZE, slotp->filename,
 				_BAR_RATIO_SIZE, ratio,
 				slotp->progress,
 				_BAR_DOWNBYTES_SIZE, human_readable_bytes);
 
-		_restore_cursor_position();
-		fflush(stdout);
+		_restore_cursor_position(bar);
 		slotp->tick++;
 	}
 }
@@ -259,11 +271,23 @@ static void _bar_update(wget_bar_t *bar)
 {
 	_bar_update_winsize(bar, false);
 	for (int i = 0; i < bar->nslots; i++) {
-		if (bar->slots[i].redraw || winsize_changed) {
+		char redraw;
+
+		// clear the dirty flag before drawing - an update arriving while we
+		// draw is then picked up by the next tick instead of being lost
+#ifdef WITH_GCC_ATOMIC
+		redraw = __atomic_exchange_n(&bar->slots[i].redraw, 0, __ATOMIC_ACQUIRE);
+#else
+		redraw = bar->slots[i].redraw;
+		bar->slots[i].redraw = 0;
+#endif
+
+		if (redraw || winsize_changed)
 			_bar_update_slot(bar, i);
-			bar->slots[i].redraw = 0;
-		}
 	}
+
+	// one write + flush per render tick, not one per slot or escape sequence
+	_bar_flush(bar);
 }
 
 
@@ -296,6 +320,8 @@ wget_bar_t *wget_bar_init(wget_bar_t *bar, int nslots)
 	} else
 		memset(bar, 0, sizeof(*bar));
 
+	wget_buffer_init(&bar->frame, NULL, 256);
+
 	wget_bar_set_slots(bar, nslots);
 
 	return bar;
@@ -321,7 +347,7 @@ void wget_bar_set_slots(wget_bar_t *bar, int nslots)
 		bar->slots = xcalloc(nslots, sizeof(_bar_slot_t));
 		bar->nslots = nslots;
 		for (int i = 0; i < more_slots; i++) {
-			printf("\n");
+			wget_buffer_memcat(&bar->frame, "\n", 1);
 		}
 		_bar_update_winsize(bar, true);
 		_bar_update(bar);
@@ -346,10 +372,18 @@ void wget_bar_slot_begin(wget_bar_t *bar, int slot, const char *filename, ssize_
 
 void wget_bar_slot_downloaded(wget_bar_t *bar, int slot, size_t nbytes)
 {
+#ifdef WITH_GCC_ATOMIC
+	// hot path: called for every body chunk by every downloader thread.
+	// Store the progress and mark the slot dirty without touching the bar
+	// mutex - the render tick picks both up and redraws changed slots only.
+	__atomic_store_n(&bar->slots[slot].bytes_downloaded, (uint64_t) nbytes, __ATOMIC_RELAXED);
+	__atomic_store_n(&bar->slots[slot].redraw, 1, __ATOMIC_RELEASE);
+#else
 	wget_thread_mutex_lock(&bar->mutex);
 	bar->slots[slot].bytes_downloaded = nbytes;
 	bar->slots[slot].redraw = 1;
 	wget_thread_mutex_unlock(&bar->mutex);
+#endif
 }
 
 void wget_bar_slot_deregister(wget_bar_t *bar, int slot)
@@ -360,6 +394,7 @@ void wget_bar_slot_deregister(wget_bar_t *bar, int slot)
 
 		slotp->status = COMPLETE;
 		_bar_update_slot(bar, slot);
+		_bar_flush(bar);
 	}
 	wget_thread_mutex_unlock(&bar->mutex);
 }
@@ -387,6 +422,7 @@ void wget_bar_deinit(wget_bar_t *bar)
 		xfree(bar->known_size);
 		xfree(bar->unknown_size);
 		xfree(bar->slots);
+		wget_buffer_deinit(&bar->frame);
 	}
 }
 
@@ -406,9 +442,9 @@ void wget_bar_print(wget_bar_t *bar, int slot, const char *s)
 	wget_thread_mutex_lock(&bar->mutex);
 	_bar_print_slot(bar, slot);
 	// CSI <n> G: Cursor horizontal absolute
-	printf("\033[27G[%-*.*s]", bar->max_width, bar->max_width, s);
-	_restore_cursor_position();
-	fflush(stdout);
+	wget_buffer_printf_append(&bar->frame, "\033[27G[%-*.*s]", bar->max_width, bar->max_width, s);
+	_restore_cursor_position(bar);
+	_bar_flush(bar);
 	wget_thread_mutex_unlock(&bar->mutex);
 }
 
@@ -447,11 +483,12 @@ void wget_bar_write_line(wget_bar_t *bar, const char *buf, size_t len)
 	// CSI <n>G: Cursor horizontal absolute
 	// CSI 0J:   Clear from cursor to end of screen
 	// CSI 31m:  Red text color
-	printf("\033[s\033[1S\033[%dA\033[1G\033[0J\033[31m", bar->nslots + 1);
-	fwrite(buf, 1, len, stdout);
-	printf("\033[m"); // reset text color
-	_restore_cursor_position();
+	wget_buffer_printf_append(&bar->frame, "\033[s\033[1S\033[%dA\033[1G\033[0J\033[31m", bar->nslots + 1);
+	wget_buffer_memcat(&bar->frame, buf, len);
+	wget_buffer_strcat(&bar->frame, "\033[m"); // reset text color
+	_restore_cursor_position(bar);
 
+	// the line and the redrawn bars below go out as one frame
 	_bar_update(bar);
 	wget_thread_mutex_unlock(&bar->mutex);
 }
@@ -108,6 +108,8 @@ wget_buffer_t *wget_buffer_init(wget_buffer_t *buf, char *data, size_t size)
 	}
 
 	buf->length = 0;
+	buf->growth_cap = 0;
+	buf->page_aligned = 0;
 
 	return buf;
 }
@@ -153,6 +155,26 @@ static void _buffer_realloc(wget_buffer_t *buf, size_t size)
 	buf->release_data = 1;
 }
 
+// compute the new size for a buffer that must hold at least <minsize> bytes,
+// applying the buffer's growth policy
+static size_t _buffer_grow_size(const wget_buffer_t *buf, size_t minsize)
+{
+	size_t growth = buf->size; // double the size by default
+
+	if (buf->growth_cap && growth > buf->growth_cap)
+		growth = buf->growth_cap;
+
+	size_t size = buf->size + growth;
+
+	if (size < minsize)
+		size = minsize;
+
+	if (buf->page_aligned)
+		size = ((size + 1 + 4095) & ~(size_t) 4095) - 1; // +1 for the terminating 0 byte
+
+	return size;
+}
+
 /**
  * \param[in] buf A buffer, created with wget_buffer_init() or wget_buffer_alloc()
  * \param[in] size Total size (in bytes) required in the buffer
@@ -167,10 +189,104 @@ void wget_buffer_ensure_capacity(wget_buffer_t *buf, size_t size)
 {
 	if (likely(buf)) {
 		if (buf->size < size)
-			_buffer_realloc(buf, size);
+			_buffer_realloc(buf, buf->page_aligned ? ((size + 1 + 4095) & ~(size_t) 4095) - 1 : size);
+	}
+}
+
+/**
+ * \param[in] buf A buffer, created with wget_buffer_init() or wget_buffer_alloc()
+ * \param[in] growth_cap Maximum number of bytes a single resize may add on top
+ *  of what is strictly needed, 0 means no bound (pure doubling)
+ * \param[in] page_aligned If true, allocation sizes are rounded up to full 4 KiB pages
+ *
+ * Tune how the buffer \p buf grows when it runs out of space.
+ *
+ * By default a buffer doubles its size on each resize, which is right for
+ * buffers of unknown final size but over-allocates on huge ones. With
+ * \p growth_cap set, the exponential growth is bounded - the buffer never
+ * grows by more than \p growth_cap bytes at once (plus what the pending
+ * operation strictly needs).
+ *
+ * \p page_aligned is useful for large I/O buffers - the allocator works in
+ * whole pages anyway, so rounding up makes the slack usable.
+ */
+void wget_buffer_set_growth_policy(wget_buffer_t *buf, size_t growth_cap, bool page_aligned)
+{
+	if (likely(buf)) {
+		buf->growth_cap = growth_cap;
+		buf->page_aligned = page_aligned;
 	}
 }
 
+// Thread-local pool of scratch buffers: request and response buffers churn
+// once per HTTP round trip, so released buffers are stashed per thread and
+// handed out again with their allocation intact - no malloc round trip and
+// no allocator lock contention on the downloader hot path.
+#if defined __GNUC__ || defined __clang__
+# define BUFFER_POOL_MAX 4 // buffers kept per thread
+# define BUFFER_POOL_KEEP_SIZE (256 * 1024) // don't hoard oversized buffers
+static __thread wget_buffer_t
+	*_buffer_pool[BUFFER_POOL_MAX];
+static __thread int
+	_buffer_pool_size;
+#endif
+
+/**
+ * \param[in] size Initial length of the buffer
+ * \return A buffer with at least \p size bytes capacity
+ *
+ * Get a scratch buffer from the calling thread's buffer pool, or allocate a
+ * fresh one (like wget_buffer_alloc()) if the pool is empty.
+ *
+ * Pooled buffers keep their previous allocation, so a thread that acquires
+ * and releases buffers of similar size reuses the same memory over and over.
+ * Return the buffer with wget_buffer_release() - preferably on the thread
+ * that acquired it - or free it with wget_buffer_free().
+ */
+wget_buffer_t *wget_buffer_acquire(size_t size)
+{
+#ifdef BUFFER_POOL_MAX
+	if (_buffer_pool_size > 0) {
+		wget_buffer_t *buf = _buffer_pool[--_buffer_pool_size];
+
+		wget_buffer_ensure_capacity(buf, size);
+		return buf;
+	}
+#endif
+
+	return wget_buffer_alloc(size);
+}
+
+/**
+ * \param[in] buf Double pointer to a buffer from wget_buffer_acquire(), gets set to %NULL
+ *
+ * Return a scratch buffer to the calling thread's buffer pool.
+ *
+ * The buffer is reset but keeps its allocation for the next
+ * wget_buffer_acquire(). If the pool is full or the buffer grew unusually
+ * large, it is freed instead.
+ */
+void wget_buffer_release(wget_buffer_t **buf)
+{
+	if (unlikely(!buf || !*buf))
+		return;
+
+#ifdef BUFFER_POOL_MAX
+	if ((*buf)->release_buf && (*buf)->release_data
+		&& _buffer_pool_size < BUFFER_POOL_MAX && (*buf)->size <= BUFFER_POOL_KEEP_SIZE)
+	{
+		wget_buffer_reset(*buf);
+		(*buf)->growth_cap = 0; // don't carry a growth policy over to the next user
+		(*buf)->page_aligned = 0;
+		_buffer_pool[_buffer_pool_size++] = *buf;
+		*buf = NULL;
+		return;
+	}
+#endif
+
+	wget_buffer_free(buf);
+}
+
 /**
  * \param[in] buf A buffer, created with wget_buffer_init() or wget_buffer_alloc()
  *
@@ -304,7 +420,7 @@ size_t wget_buffer_memcat(wget_buffer_t *buf, const void *data, size_t length)
 
 	if (likely(length)) {
 		if (buf->size < buf->length + length)
-			_buffer_realloc(buf, buf->size * 2 + length);
+			_buffer_realloc(buf, _buffer_grow_size(buf, buf->length + length));
 
 		if (likely(data))
 			memcpy(buf->data + buf->length, data, length);
@@ -440,7 +556,7 @@ size_t wget_buffer_memset_append(wget_buffer_t *buf, char c, size_t length)
 
 	if (likely(length)) {
 		if (unlikely(buf->size < buf->length + length))
-			_buffer_realloc(buf, buf->size * 2 + length);
+			_buffer_realloc(buf, _buffer_grow_size(buf, buf->length + length));
 
 		memset(buf->data + buf->length, c, length);
 		buf->length += length;
@@ -87,28 +87,46 @@ static void _copy_string(wget_buffer_t *buf, unsigned int flags, int field_width
 	}
 }
 
+// two decimal digits per table lookup - halves the number of divisions
+// and avoids the per-digit '0' addition
+static const char DEC2[200] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
 static void _convert_dec_fast(wget_buffer_t *buf, int arg)
 {
 	char str[32]; // long enough to hold decimal long long
-	char *dst = str + sizeof(str) - 1;
-	int minus;
+	char *dst = str + sizeof(str);
+	unsigned int argu = arg < 0 ? -(unsigned int)arg : (unsigned int)arg;
 
-	if (arg < 0) {
-		minus = 1;
-		arg = -arg;
-	} else
-		minus = 0;
+	while (argu >= 100) {
+		const char *d2 = DEC2 + (argu % 100) * 2;
 
-	while (arg >= 10) {
-		*dst-- = (arg % 10) + '0';
-		arg /= 10;
+		argu /= 100;
+		*--dst = d2[1];
+		*--dst = d2[0];
 	}
-	*dst-- = (arg % 10) + '0';
 
-	if (minus)
-		*dst-- = '-';
+	if (argu >= 10) {
+		const char *d2 = DEC2 + argu * 2;
+
+		*--dst = d2[1];
+		*--dst = d2[0];
+	} else
+		*--dst = (char) ('0' + argu);
+
+	if (arg < 0)
+		*--dst = '-';
 
-	wget_buffer_memcat(buf, dst + 1, sizeof(str) - (dst - str) - 1);
+	wget_buffer_memcat(buf, dst, sizeof(str) - (dst - str));
 }
 
 static void _convert_dec(wget_buffer_t *buf, unsigned int flags, int field_width, int precision, long long arg)
@@ -127,10 +145,21 @@ static void _convert_dec(wget_buffer_t *buf, unsigned int flags, int field_width
 			argu = -arg;
 		}
 
-		while (argu) {
-			*dst-- = argu % 10 + '0';
-			argu /= 10;
+		while (argu >= 100) {
+			const char *d2 = DEC2 + (argu % 100) * 2;
+
+			argu /= 100;
+			*dst-- = d2[1];
+			*dst-- = d2[0];
 		}
+
+		if (argu >= 10) {
+			const char *d2 = DEC2 + argu * 2;
+
+			*dst-- = d2[1];
+			*dst-- = d2[0];
+		} else if (argu)
+			*dst-- = (char) ('0' + argu);
 	} else if (flags & FLAG_HEXLO) {
 		while (argu) {
 			// slightly faster than having a HEX[] lookup table
@@ -322,6 +351,67 @@ static const char *_read_field_width(const char *p, int *out, unsigned int *flag
 	return p;
 }
 
+/**
+ * \param[in] buf A buffer, created with wget_buffer_init() or wget_buffer_alloc()
+ * \param[in] arg The value to be appended in decimal notation
+ * \return Length of the buffer after appending the number
+ *
+ * Append the decimal representation of \p arg to the buffer \p buf.
+ *
+ * This is the fast path for the very common 'append one number' case -
+ * it skips the format string interpretation of wget_buffer_printf_append()
+ * completely and converts two digits per division via a lookup table.
+ */
+size_t wget_buffer_append_int(wget_buffer_t *buf, long long arg)
+{
+	char str[24]; // long enough to hold decimal long long
+	char *dst = str + sizeof(str);
+	unsigned long long argu = arg < 0 ? -(unsigned long long)arg : (unsigned long long)arg;
+
+	while (argu >= 100) {
+		const char *d2 = DEC2 + (argu % 100) * 2;
+
+		argu /= 100;
+		*--dst = d2[1];
+		*--dst = d2[0];
+	}
+
+	if (argu >= 10) {
+		const char *d2 = DEC2 + argu * 2;
+
+		*--dst = d2[1];
+		*--dst = d2[0];
+	} else
+		*--dst = (char) ('0' + argu);
+
+	if (arg < 0)
+		*--dst = '-';
+
+	return wget_buffer_memcat(buf, dst, sizeof(str) - (dst - str));
+}
+
+/**
+ * \param[in] buf A buffer, created with wget_buffer_init() or wget_buffer_alloc()
+ * \param[in] arg The value to be appended in lower-case hexadecimal notation
+ * \return Length of the buffer after appending the number
+ *
+ * Append the hexadecimal representation of \p arg (without any prefix) to the
+ * buffer \p buf, like wget_buffer_append_int() does for decimal values.
+ */
+size_t wget_buffer_append_hex(wget_buffer_t *buf, unsigned long long arg)
+{
+	static const char HEX[16] = "0123456789abcdef";
+	char str[16]; // long enough to hold hexadecimal long long
+	char *dst = str + sizeof(str);
+
+	do {
+		*--dst = HEX[arg & 0xf];
+		arg >>= 4;
+	} while (arg);
+
+	return wget_buffer_memcat(buf, dst, sizeof(str) - (dst - str));
+}
+
 /**
  * \param[in] buf A buffer, created with wget_buffer_init() or wget_buffer_alloc()
  * \param[in] fmt A `printf(3)`-like format string
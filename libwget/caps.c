@@ -0,0 +1,617 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Per-host capability cache routines
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include <wget.h>
+#include "private.h"
+
+/**
+ * \file
+ * \brief Per-host capability cache routines
+ * \defgroup libwget-caps Per-host capability cache routines
+ * @{
+ *
+ * A persistent per-host store of capabilities that are otherwise rediscovered
+ * the hard way on every run: the ALPN-negotiated protocol, whether the server
+ * supports byte ranges (`Accept-Ranges`) and whether it honors keep-alive.
+ * Consulting the cache lets repeat crawls pick the right protocol and
+ * segmentation strategy without failed-attempt round trips.
+ *
+ * The cache also remembers each route's connect RTT and best observed
+ * delivery rate. Their product is the bandwidth-delay product, from which
+ * wget_caps_db_get_bufsize() derives socket buffer sizes for subsequent
+ * connections - high-BDP routes underperform badly with default buffers.
+ *
+ * Entries go stale as servers get reconfigured, so they expire a week after
+ * their last refresh.
+ */
+
+// entries not refreshed for this long are dropped at load time
+#define CAPS_MAX_AGE (7 * 24 * 3600)
+
+// socket buffers derived from the BDP are clamped to this range; below the
+// minimum the kernel defaults are large enough, the maximum bounds the
+// per-connection memory on very fat pipes
+#define CAPS_BUFSIZE_MIN (128 * 1024)
+#define CAPS_BUFSIZE_MAX (16 * 1024 * 1024)
+
+struct wget_caps_db_st {
+	char *
+		fname;
+	wget_hashmap_t *
+		entries;
+	wget_thread_mutex_t
+		mutex;
+	int64_t
+		load_time;
+};
+
+typedef struct {
+	const char *
+		host;
+	const char *
+		alpn; // ALPN-negotiated protocol id, e.g. "h2", NULL if unknown
+	int64_t
+		updated; // time of the last refresh
+	long long
+		rate; // best observed delivery rate in bytes/s, -1 if unknown
+	int
+		rtt_ms; // smoothed TCP connect time in milliseconds, -1 if unknown
+	uint16_t
+		port;
+	signed char
+		accept_ranges, // -1 unknown, 0 no byte ranges, 1 supported
+		keep_alive; // -1 unknown, 0 server drops keep-alive connections, 1 honors them
+} _caps_entry_t;
+
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+static unsigned int G_GNUC_WGET_PURE _hash_caps(const _caps_entry_t *entry)
+{
+	unsigned int hash = entry->port;
+	const unsigned char *p;
+
+	for (p = (unsigned char *)entry->host; *p; p++)
+		hash = hash * 101 + *p;
+
+	return hash;
+}
+
+static int G_GNUC_WGET_NONNULL_ALL G_GNUC_WGET_PURE _compare_caps(const _caps_entry_t *e1, const _caps_entry_t *e2)
+{
+	int n;
+
+	if ((n = strcmp(e1->host, e2->host)))
+		return n;
+
+	return e1->port - e2->port;
+}
+
+static _caps_entry_t *_init_caps(_caps_entry_t *entry)
+{
+	if (!entry)
+		entry = xmalloc(sizeof(_caps_entry_t));
+
+	memset(entry, 0, sizeof(*entry));
+	entry->updated = time(NULL);
+	entry->accept_ranges = -1;
+	entry->keep_alive = -1;
+	entry->rtt_ms = -1;
+	entry->rate = -1;
+
+	return entry;
+}
+
+static void _deinit_caps(_caps_entry_t *entry)
+{
+	if (entry) {
+		xfree(entry->host);
+		xfree(entry->alpn);
+	}
+}
+
+static void _free_caps(_caps_entry_t *entry)
+{
+	if (entry) {
+		_deinit_caps(entry);
+		xfree(entry);
+	}
+}
+
+static void _caps_db_add_entry(wget_caps_db_t *caps_db, _caps_entry_t *entry)
+{
+	wget_thread_mutex_lock(&caps_db->mutex);
+
+	_caps_entry_t *old = wget_hashmap_get(caps_db->entries, entry);
+
+	if (old) {
+		// merge: unknown fields of the new observation keep the old knowledge
+		if (entry->alpn) {
+			xfree(old->alpn);
+			old->alpn = entry->alpn;
+			entry->alpn = NULL;
+		}
+		if (entry->accept_ranges >= 0)
+			old->accept_ranges = entry->accept_ranges;
+		if (entry->keep_alive >= 0)
+			old->keep_alive = entry->keep_alive;
+		if (entry->rtt_ms >= 0) {
+			// smoothed like TCP's SRTT - one congested handshake must not
+			// shrink the buffers for a whole run
+			old->rtt_ms = old->rtt_ms >= 0 ? (old->rtt_ms * 7 + entry->rtt_ms) / 8 : entry->rtt_ms;
+		}
+		if (entry->rate > old->rate)
+			old->rate = entry->rate; // size buffers for the best the route has shown
+		if (old->updated < entry->updated)
+			old->updated = entry->updated;
+		_free_caps(entry);
+	} else {
+		// key and value are the same to make wget_hashmap_get() return old entry
+		wget_hashmap_put_noalloc(caps_db->entries, entry, entry);
+	}
+
+	wget_thread_mutex_unlock(&caps_db->mutex);
+}
+
+/**
+ * \param[in] caps_db A capability database
+ * \param[in] host Hostname the capabilities belong to
+ * \param[in] port Port the capabilities belong to
+ * \param[in] alpn ALPN-negotiated protocol id (e.g. "h2"), or NULL if unknown
+ * \param[in] accept_ranges 1 if the server supports byte ranges, 0 if not, -1 if unknown
+ * \param[in] keep_alive 1 if the server honors keep-alive, 0 if it drops connections, -1 if unknown
+ *
+ * Record observed capabilities of a host. Unknown values (-1 resp. NULL) leave
+ * the stored knowledge untouched, so partial observations merge instead of
+ * overwriting each other.
+ *
+ * This function is thread-safe and can be called from multiple threads concurrently.
+ */
+void wget_caps_db_add(wget_caps_db_t *caps_db, const char *host, uint16_t port,
+	const char *alpn, char accept_ranges, char keep_alive)
+{
+	_caps_entry_t *entry;
+
+	if (!caps_db || !host)
+		return;
+
+	entry = _init_caps(NULL);
+	entry->host = wget_strdup(host);
+	entry->port = port;
+	entry->alpn = wget_strdup(alpn);
+	entry->accept_ranges = accept_ranges >= 0 ? !!accept_ranges : -1;
+	entry->keep_alive = keep_alive >= 0 ? !!keep_alive : -1;
+
+	_caps_db_add_entry(caps_db, entry);
+}
+
+/**
+ * \param[in] caps_db A capability database
+ * \param[in] host Hostname the measurement belongs to
+ * \param[in] port Port the measurement belongs to
+ * \param[in] rtt_ms TCP connect time in milliseconds, -1 if unknown
+ * \param[in] rate Delivery rate in bytes/s, -1 if unknown
+ *
+ * Record a bandwidth-delay measurement of a route. RTT observations are
+ * smoothed into the stored value, rate observations only replace it when
+ * they exceed it. Unknown values (-1) leave the stored knowledge untouched.
+ *
+ * This function is thread-safe and can be called from multiple threads concurrently.
+ */
+void wget_caps_db_add_bdp(wget_caps_db_t *caps_db, const char *host, uint16_t port,
+	int rtt_ms, long long rate)
+{
+	_caps_entry_t *entry;
+
+	if (!caps_db || !host)
+		return;
+
+	entry = _init_caps(NULL);
+	entry->host = wget_strdup(host);
+	entry->port = port;
+	entry->rtt_ms = rtt_ms >= 0 ? rtt_ms : -1;
+	entry->rate = rate >= 0 ? rate : -1;
+
+	_caps_db_add_entry(caps_db, entry);
+}
+
+/**
+ * \param[in] caps_db A capability database
+ * \param[in] host Hostname to search for
+ * \param[in] port Port to search for
+ * \param[out] alpn Stored ALPN protocol id, allocated (free with wget_free()), or NULL if unknown
+ * \param[out] accept_ranges Stored byte-range support, -1 if unknown
+ * \param[out] keep_alive Stored keep-alive behavior, -1 if unknown
+ * \return 1 if capabilities for `host:port` were found, 0 if not
+ *
+ * Look up the stored capabilities of a host, e.g. to choose the transfer
+ * strategy before the first response arrived.
+ *
+ * This function is thread-safe and can be called from multiple threads concurrently.
+ */
+int wget_caps_db_get(wget_caps_db_t *caps_db, const char *host, uint16_t port,
+	char **alpn, char *accept_ranges, char *keep_alive)
+{
+	_caps_entry_t key, *entry;
+	int found = 0;
+
+	if (alpn)
+		*alpn = NULL;
+	if (accept_ranges)
+		*accept_ranges = -1;
+	if (keep_alive)
+		*keep_alive = -1;
+
+	if (!caps_db || !host)
+		return 0;
+
+	key.host = host;
+	key.port = port;
+
+	wget_thread_mutex_lock(&caps_db->mutex);
+
+	if ((entry = wget_hashmap_get(caps_db->entries, &key))) {
+		if (alpn)
+			*alpn = wget_strdup(entry->alpn);
+		if (accept_ranges)
+			*accept_ranges = entry->accept_ranges;
+		if (keep_alive)
+			*keep_alive = entry->keep_alive;
+		found = 1;
+	}
+
+	wget_thread_mutex_unlock(&caps_db->mutex);
+
+	return found;
+}
+
+/**
+ * \param[in] caps_db A capability database
+ * \param[in] host Hostname to search for
+ * \param[in] port Port to search for
+ * \return Suggested socket buffer size in bytes, 0 if unknown
+ *
+ * Derive a socket buffer size (SO_RCVBUF/SO_SNDBUF) from the stored
+ * bandwidth-delay product of the route to `host:port`. Twice the BDP is
+ * suggested so the congestion window has room to grow past the last
+ * measured rate. Returns 0 when no measurement is stored or the route is
+ * short enough for the kernel defaults.
+ *
+ * This function is thread-safe and can be called from multiple threads concurrently.
+ */
+int wget_caps_db_get_bufsize(wget_caps_db_t *caps_db, const char *host, uint16_t port)
+{
+	_caps_entry_t key, *entry;
+	long long bufsize = 0;
+
+	if (!caps_db || !host)
+		return 0;
+
+	key.host = host;
+	key.port = port;
+
+	wget_thread_mutex_lock(&caps_db->mutex);
+
+	if ((entry = wget_hashmap_get(caps_db->entries, &key)) && entry->rtt_ms >= 0 && entry->rate > 0)
+		bufsize = 2 * (entry->rate * entry->rtt_ms / 1000);
+
+	wget_thread_mutex_unlock(&caps_db->mutex);
+
+	if (bufsize < CAPS_BUFSIZE_MIN)
+		return 0;
+	if (bufsize > CAPS_BUFSIZE_MAX)
+		bufsize = CAPS_BUFSIZE_MAX;
+
+	return (int) bufsize;
+}
+
+static int _caps_db_load(wget_caps_db_t *caps_db, FILE *fp)
+{
+	_caps_entry_t entry;
+	struct stat st;
+	char *buf = NULL, *linep, *p;
+	size_t bufsize = 0;
+	ssize_t buflen;
+	int64_t now = time(NULL);
+	int ok;
+
+	// if the database file hasn't changed since the last read
+	// there's no need to reload
+
+	if (fstat(fileno(fp), &st) == 0) {
+		if (st.st_mtime != caps_db->load_time)
+			caps_db->load_time = st.st_mtime;
+		else
+			return 0;
+	}
+
+	while ((buflen = wget_getline(&buf, &bufsize, fp)) >= 0) {
+		linep = buf;
+
+		while (isspace(*linep)) linep++; // ignore leading whitespace
+		if (!*linep) continue; // skip empty lines
+
+		if (*linep == '#')
+			continue; // skip comments
+
+		// strip off \r\n
+		while (buflen > 0 && (buf[buflen] == '\n' || buf[buflen] == '\r'))
+			buf[--buflen] = 0;
+
+		_init_caps(&entry);
+		ok = 0;
+
+		// parse host
+		if (*linep) {
+			for (p = linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.host = wget_strmemdup(p, linep - p);
+		}
+
+		// parse port
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.port = (uint16_t) atoi(p);
+		}
+
+		// parse time of last refresh
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.updated = atoll(p);
+			if (entry.updated < 0 || entry.updated >= INT64_MAX / 2)
+				entry.updated = 0;
+		}
+
+		// parse byte-range support
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.accept_ranges = (signed char) atoi(p);
+		}
+
+		// parse keep-alive behavior
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.keep_alive = (signed char) atoi(p);
+			ok = 1;
+		}
+
+		// parse ALPN protocol id, '-' = unknown
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			if (linep - p > 0 && !(linep - p == 1 && *p == '-'))
+				entry.alpn = wget_strmemdup(p, linep - p);
+		}
+
+		// parse smoothed connect RTT and best delivery rate,
+		// files from before these columns simply lack them
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.rtt_ms = atoi(p);
+			if (entry.rtt_ms < 0)
+				entry.rtt_ms = -1;
+		}
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.rate = atoll(p);
+			if (entry.rate < 0)
+				entry.rate = -1;
+		}
+
+		if (ok && entry.host && entry.updated + CAPS_MAX_AGE > now) {
+			_caps_db_add_entry(caps_db, wget_memdup(&entry, sizeof(entry)));
+		} else {
+			// stale entries silently age out, everything else is a parse error
+			if (!ok || !entry.host)
+				error_printf(_("Failed to parse capability line: '%s'\n"), buf);
+			_deinit_caps(&entry);
+		}
+	}
+
+	xfree(buf);
+
+	if (ferror(fp)) {
+		caps_db->load_time = 0; // reload on next call to this function
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \param[in] caps_db A capability database
+ * \return 0 if the operation succeeded, -1 in case of error
+ *
+ * Loads the database entries from the file specified in the `fname` parameter of wget_caps_db_init().
+ * Entries whose last refresh is more than a week ago are dropped.
+ *
+ * If `caps_db` is NULL this function does nothing and returns 0.
+ */
+// Load the capability cache from a flat file
+// Protected by flock()
+int wget_caps_db_load(wget_caps_db_t *caps_db)
+{
+	if (!caps_db || !caps_db->fname || !*caps_db->fname)
+		return 0;
+
+	if (wget_update_file(caps_db->fname, (wget_update_load_t) _caps_db_load, NULL, caps_db)) {
+		error_printf(_("Failed to read capability data\n"));
+		return -1;
+	} else {
+		debug_printf(_("Fetched capability data from '%s'\n"), caps_db->fname);
+		return 0;
+	}
+}
+
+static int G_GNUC_WGET_NONNULL((1)) _caps_save(FILE *fp, const _caps_entry_t *entry)
+{
+	fprintf(fp, "%s %hu %lld %d %d %s %d %lld\n",
+		entry->host, entry->port, (long long) entry->updated,
+		entry->accept_ranges, entry->keep_alive, entry->alpn ? entry->alpn : "-",
+		entry->rtt_ms, entry->rate);
+	return 0;
+}
+
+static int _caps_db_save(void *caps_db, FILE *fp)
+{
+	wget_hashmap_t *entries = ((wget_caps_db_t *) caps_db)->entries;
+
+	if (wget_hashmap_size(entries) > 0) {
+		fputs("#Capability 1.0 file\n", fp);
+		fputs("#Generated by Wget2 " PACKAGE_VERSION ". Edit at your own risk.\n", fp);
+		fputs("# <host> <port> <updated> <accept-ranges> <keep-alive> <alpn> <rtt-ms> <rate>\n", fp);
+
+		wget_hashmap_browse(entries, (wget_hashmap_browse_t) _caps_save, fp);
+
+		if (ferror(fp))
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \param[in] caps_db A capability database
+ * \return 0 if the operation succeeded, -1 otherwise
+ *
+ * Saves all changes to the database (via wget_caps_db_add() for example) into the file specified
+ * by the `fname` parameter of wget_caps_db_init().
+ *
+ * If `caps_db` is NULL this function does nothing and returns -1.
+ */
+// Save the capability cache to a flat file
+// Protected by flock()
+int wget_caps_db_save(wget_caps_db_t *caps_db)
+{
+	int size;
+
+	if (!caps_db || !caps_db->fname || !*caps_db->fname)
+		return -1;
+
+	if (wget_update_file(caps_db->fname, (wget_update_load_t) _caps_db_load, _caps_db_save, caps_db)) {
+		error_printf(_("Failed to write capability file '%s'\n"), caps_db->fname);
+		return -1;
+	}
+
+	if ((size = wget_hashmap_size(caps_db->entries)))
+		debug_printf(_("Saved %d capability entr%s into '%s'\n"), size, size != 1 ? "ies" : "y", caps_db->fname);
+	else
+		debug_printf(_("No capability entries to save. Table is empty.\n"));
+
+	return 0;
+}
+
+/**
+ * \param[in] caps_db Capability database created by wget_caps_db_init()
+ *
+ * Frees all resources allocated for the capability database, except for the structure itself.
+ * The `caps_db` pointer can then be passed to wget_caps_db_init() for reinitialization.
+ *
+ * If `caps_db` is NULL this function does nothing.
+ */
+void wget_caps_db_deinit(wget_caps_db_t *caps_db)
+{
+	if (caps_db) {
+		xfree(caps_db->fname);
+		wget_thread_mutex_lock(&caps_db->mutex);
+		wget_hashmap_free(&caps_db->entries);
+		wget_thread_mutex_unlock(&caps_db->mutex);
+	}
+}
+
+/**
+ * \param[in] caps_db Pointer to the capability database handle (will be set to NULL)
+ *
+ * Frees all resources allocated for the capability database.
+ *
+ * If `caps_db` or the pointer it points to is NULL, then the function does nothing.
+ *
+ * Newly added entries will be lost unless committed to persistent storage using wget_caps_db_save().
+ */
+void wget_caps_db_free(wget_caps_db_t **caps_db)
+{
+	if (caps_db && *caps_db) {
+		wget_caps_db_deinit(*caps_db);
+		xfree(*caps_db);
+	}
+}
+
+/**
+ * \param[in] caps_db Previously created capability database on which wget_caps_db_deinit() has been called, or NULL
+ * \param[in] fname The file where the data is stored, or NULL
+ * \return A new wget_caps_db_t
+ *
+ * Constructor for the capability database.
+ *
+ * This function does no file IO, data is read only when wget_caps_db_load() is called.
+ */
+wget_caps_db_t *wget_caps_db_init(wget_caps_db_t *caps_db, const char *fname)
+{
+	if (!caps_db)
+		caps_db = xmalloc(sizeof(wget_caps_db_t));
+
+	memset(caps_db, 0, sizeof(*caps_db));
+	if (fname)
+		caps_db->fname = wget_strdup(fname);
+	caps_db->entries = wget_hashmap_create(16, (wget_hashmap_hash_t)_hash_caps, (wget_hashmap_compare_t)_compare_caps);
+	wget_hashmap_set_key_destructor(caps_db->entries, (wget_hashmap_key_destructor_t)_free_caps);
+	wget_hashmap_set_value_destructor(caps_db->entries, (wget_hashmap_value_destructor_t)_free_caps);
+	wget_thread_mutex_init_adaptive(&caps_db->mutex);
+
+	return caps_db;
+}
+
+/**
+ * \param[in] caps_db Capability database created by wget_caps_db_init()
+ * \param[in] fname Filename where the database should be stored, or NULL
+ *
+ * Changes the file where capability database entries are stored.
+ *
+ * This function does no file IO, data is read or written only when wget_caps_db_load()
+ * or wget_caps_db_save() is called.
+ */
+void wget_caps_db_set_fname(wget_caps_db_t *caps_db, const char *fname)
+{
+	xfree(caps_db->fname);
+	if (fname)
+		caps_db->fname = wget_strdup(fname);
+}
+
+/**@}*/
@@ -31,6 +31,7 @@
 CONSOLE_SCREEN_BUFFER_INFO g_console_info;
 HANDLE                     g_stdout_hnd = INVALID_HANDLE_VALUE;
 CRITICAL_SECTION           g_trace_crit;
+static WORD                g_current_attr; // memoized attribute, skips redundant console calls
 #endif
 
 /**
@@ -49,6 +50,7 @@ static void _reset_color(void)
 
 	if (g_stdout_hnd != INVALID_HANDLE_VALUE) {
 		SetConsoleTextAttribute(g_stdout_hnd, g_console_info.wAttributes);
+		g_current_attr = g_console_info.wAttributes;
 		g_stdout_hnd = INVALID_HANDLE_VALUE;
 	}
 #else
@@ -75,15 +77,23 @@ void wget_console_set_fg_color(wget_console_color_t colorid)
 			[WGET_CONSOLE_COLOR_MAGENTA] = FOREGROUND_RED | FOREGROUND_BLUE
 		};
 
-		fflush (stdout);
+		WORD attr;
 
 		if (colorid == WGET_CONSOLE_COLOR_RESET)
-			SetConsoleTextAttribute (g_stdout_hnd, g_console_info.wAttributes);
-		else if (colorid < countof(color)) {
-			WORD attr = (g_console_info.wAttributes & ~7) | color[colorid];
+			attr = g_console_info.wAttributes;
+		else if (colorid < countof(color))
+			attr = (WORD) ((g_console_info.wAttributes & ~7) | color[colorid] | FOREGROUND_INTENSITY);
+		else
+			return;
+
+		// setting the color the console already shows would only cost an
+		// extra flush + console call per fragment
+		if (attr == g_current_attr)
+			return;
 
-			SetConsoleTextAttribute (g_stdout_hnd, attr | FOREGROUND_INTENSITY);
-		}
+		fflush (stdout);
+		SetConsoleTextAttribute (g_stdout_hnd, attr);
+		g_current_attr = attr;
 	}
 }
 #else
@@ -116,6 +126,7 @@ int wget_console_init(void)
 	g_stdout_hnd = GetStdHandle(STD_OUTPUT_HANDLE);
 	if (g_stdout_hnd != INVALID_HANDLE_VALUE) {
 		GetConsoleScreenBufferInfo(g_stdout_hnd, &g_console_info);
+		g_current_attr = g_console_info.wAttributes;
 
 		if (GetFileType(g_stdout_hnd) != FILE_TYPE_CHAR) /* The console is redirected */
 			g_stdout_hnd = INVALID_HANDLE_VALUE;
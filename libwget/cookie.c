@@ -75,23 +75,115 @@ struct _wget_cookie_st {
 		http_only : 1; // just use the cookie via HTTP/HTTPS protocol
 };
 
+// Direct-mapped memoization of (domain -> PSL verdict) pairs. Ad-heavy sites
+// send cookie storms with few distinct domains - the cached verdict saves the
+// PSL walk for each of them. Reads are lock-free; displaced entries may still
+// be referenced by a racing reader, so they are retired and freed at deinit.
+#define PSL_CACHE_SIZE 256 // power of 2
+
+typedef struct {
+	int
+		verdict; // -1: domain is a public suffix, 0: it is not
+	char
+		domain[];
+} PSL_CACHE_ENTRY;
+
 struct _wget_cookie_db_st {
 	wget_vector_t *
 		cookies;
+	wget_stringmap_t *
+		index; // domain -> vector of cookie pointers, for O(1) candidate lookup
+	wget_hashmap_t *
+		expiry; // expiry generation -> vector of cookie pointers, purged bucket-wise
+	time_t
+		next_purge; // no generation can fall due before this
 #ifdef WITH_LIBPSL
 	psl_ctx_t
 		*psl; // libpsl Publix Suffix List context
+	PSL_CACHE_ENTRY
+		*psl_cache[PSL_CACHE_SIZE];
+	wget_vector_t
+		*psl_cache_retired; // displaced cache entries, freed at deinit
+	wget_thread_mutex_t
+		psl_cache_mutex; // guards the retired list, never the lookups
 #endif
 	wget_thread_mutex_t
 		mutex;
 	unsigned int
 		age;
 	bool
-		keep_session_cookies : 1; // whether or not session cookies are saved
+		keep_session_cookies : 1, // whether or not session cookies are saved
+		dirty : 1; // cookies were stored since the last load/save, else saving can skip the rewrite
 };
 
 // by this kind of sorting, we can easily see if a domain matches or not (match = supercookie !)
 
+#ifdef WITH_LIBPSL
+static unsigned int G_GNUC_WGET_PURE _psl_cache_hash(const char *domain)
+{
+	unsigned int h = 0; // use 0 as SALT if hash table attacks doesn't matter
+
+	while (*domain)
+		h = h * 101 + (unsigned char) *domain++;
+
+	return h;
+}
+
+static void _psl_cache_retire(wget_cookie_db_t *cookie_db, PSL_CACHE_ENTRY *entry)
+{
+	wget_thread_mutex_lock(&cookie_db->psl_cache_mutex);
+
+	if (!cookie_db->psl_cache_retired)
+		cookie_db->psl_cache_retired = wget_vector_create(32, -2, NULL);
+	wget_vector_add_noalloc(cookie_db->psl_cache_retired, entry);
+
+	wget_thread_mutex_unlock(&cookie_db->psl_cache_mutex);
+}
+
+static int _psl_verdict(wget_cookie_db_t *cookie_db, const char *domain)
+{
+	unsigned int slot = _psl_cache_hash(domain) & (PSL_CACHE_SIZE - 1);
+	PSL_CACHE_ENTRY *entry = cookie_db->psl_cache[slot], *new_entry;
+	int verdict;
+
+	if (entry && !strcmp(entry->domain, domain))
+		return entry->verdict;
+
+	verdict = psl_is_public_suffix(cookie_db->psl, domain) ? -1 : 0;
+
+	new_entry = xmalloc(sizeof(PSL_CACHE_ENTRY) + strlen(domain) + 1);
+	new_entry->verdict = verdict;
+	strcpy(new_entry->domain, domain);
+
+	if (__sync_bool_compare_and_swap(&cookie_db->psl_cache[slot], entry, new_entry)) {
+		if (entry)
+			_psl_cache_retire(cookie_db, entry); // a racing reader may still use it
+	} else
+		xfree(new_entry); // another thread cached this slot first
+
+	return verdict;
+}
+
+// drop all memoized verdicts, e.g. after the PSL context changed
+static void _psl_cache_flush(wget_cookie_db_t *cookie_db)
+{
+	for (unsigned int it = 0; it < PSL_CACHE_SIZE; it++) {
+		PSL_CACHE_ENTRY *entry = cookie_db->psl_cache[it];
+
+		if (entry && __sync_bool_compare_and_swap(&cookie_db->psl_cache[it], entry, NULL))
+			_psl_cache_retire(cookie_db, entry);
+	}
+}
+
+static void _psl_cache_free(wget_cookie_db_t *cookie_db)
+{
+	for (unsigned int it = 0; it < PSL_CACHE_SIZE; it++)
+		xfree(cookie_db->psl_cache[it]);
+
+	wget_vector_free(&cookie_db->psl_cache_retired);
+}
+#endif
+
 int wget_cookie_db_load_psl(wget_cookie_db_t *cookie_db _U, const char *fname _U)
 {
 #ifdef WITH_LIBPSL
@@ -108,6 +200,8 @@ int wget_cookie_db_load_psl(wget_cookie_db_t *cookie_db _U, const char *fname _U
 		cookie_db->psl = NULL;
 	}
 
+	_psl_cache_flush(cookie_db); // the memoized verdicts are stale now
+
 	return 0;
 #else
 	return -1;
@@ -576,12 +670,16 @@ int wget_cookie_normalize(const wget_iri_t *iri, wget_cookie_t *cookie)
 
 void wget_cookie_normalize_cookies(const wget_iri_t *iri, const wget_vector_t *cookies)
 {
+	int old_tag = wget_alloc_tag(WGET_ALLOC_TAG_COOKIE); // for --alloc-stats attribution
+
 //	wget_thread_mutex_lock(&_cookies_mutex);
 
 	for (int it = 0; it < wget_vector_size(cookies); it++)
 		_wget_cookie_normalize_cookie(iri, wget_vector_get(cookies, it));
 
 //	wget_thread_mutex_unlock(&_cookies_mutex);
+
+	wget_alloc_tag(old_tag);
 }
 
 int wget_cookie_check_psl(const wget_cookie_db_t *cookie_db _U, const wget_cookie_t *cookie _U)
@@ -592,7 +690,7 @@ int wget_cookie_check_psl(const wget_cookie_db_t *cookie_db _U, const wget_cooki
 	int ret;
 
 	if (cookie_db->psl)
-		ret = psl_is_public_suffix(cookie_db->psl, cookie->domain) ? -1 : 0;
+		ret = _psl_verdict((wget_cookie_db_t *)cookie_db, cookie->domain);
 	else
 		ret = 0;
 #else
@@ -604,6 +702,151 @@ int wget_cookie_check_psl(const wget_cookie_db_t *cookie_db _U, const wget_cooki
 	return ret;
 }
 
+static void _free_index_entry(wget_vector_t *v)
+{
+	wget_vector_clear_nofree(v); // the cookies are owned by cookie_db->cookies
+	wget_vector_free(&v);
+}
+
+// Generational expiry: every persistent cookie sits in the bucket of its
+// expiry generation (64-second granularity). A purge walks only the
+// generations that lie fully in the past and drops their cookies, so the
+// live entries - however many millions there are - are never scanned.
+
+#define COOKIE_GENERATION_BITS 6
+
+static unsigned int G_GNUC_WGET_PURE _generation_hash(const void *key)
+{
+	return (unsigned int) (uintptr_t) key;
+}
+
+static int G_GNUC_WGET_PURE _generation_compare(const void *key1, const void *key2)
+{
+	return key1 != key2;
+}
+
+// file a cookie under its expiry generation (mutex held by the caller);
+// session cookies have no expiry and live until the db is freed
+static void _bucket_cookie(wget_cookie_db_t *cookie_db, wget_cookie_t *cookie)
+{
+	wget_vector_t *bucket;
+	void *key = (void *) (uintptr_t) (cookie->expires >> COOKIE_GENERATION_BITS);
+
+	if (!cookie->expires)
+		return;
+
+	if (!wget_hashmap_get_null(cookie_db->expiry, key, (void **) &bucket)) {
+		bucket = wget_vector_create(4, -2, NULL);
+		wget_hashmap_put_noalloc(cookie_db->expiry, key, bucket);
+	}
+
+	wget_vector_add_noalloc(bucket, cookie);
+}
+
+// 'old' is the (already freed) address of a replaced entry, 'expires' its expiry
+static void _bucket_remove(wget_cookie_db_t *cookie_db, time_t expires, const void *old)
+{
+	wget_vector_t *bucket;
+	void *key = (void *) (uintptr_t) (expires >> COOKIE_GENERATION_BITS);
+
+	if (!expires || !wget_hashmap_get_null(cookie_db->expiry, key, (void **) &bucket))
+		return;
+
+	for (int it = 0; it < wget_vector_size(bucket); it++) {
+		if (wget_vector_get(bucket, it) == old) {
+			wget_vector_remove_nofree(bucket, it);
+			break;
+		}
+	}
+}
+
+struct _purge_context {
+	wget_vector_t *
+		due; // generations that lie fully in the past
+	uintptr_t
+		generation_now;
+};
+
+static int _collect_due_generations(void *ctx, const void *key, void *value G_GNUC_WGET_UNUSED)
+{
+	struct _purge_context *purge = ctx;
+
+	if ((uintptr_t) key < purge->generation_now)
+		wget_vector_add_noalloc(purge->due, (void *) key);
+
+	return 0;
+}
+
+// drop all generations that fell due, cookie by expired cookie (mutex held
+// by the caller) - live cookies are never looked at
+static void _purge_expired(wget_cookie_db_t *cookie_db, time_t now)
+{
+	struct _purge_context purge = { .generation_now = (uintptr_t) (now >> COOKIE_GENERATION_BITS) };
+
+	if (now < cookie_db->next_purge)
+		return;
+
+	cookie_db->next_purge = now + (1 << COOKIE_GENERATION_BITS);
+
+	purge.due = wget_vector_create(16, -2, NULL);
+	wget_hashmap_browse(cookie_db->expiry, _collect_due_generations, &purge);
+
+	for (int it = 0; it < wget_vector_size(purge.due); it++) {
+		void *key = wget_vector_get(purge.due, it);
+		wget_vector_t *bucket;
+
+		if (!wget_hashmap_get_null(cookie_db->expiry, key, (void **) &bucket))
+			continue;
+
+		for (int it2 = 0; it2 < wget_vector_size(bucket); it2++) {
+			wget_cookie_t *cookie = wget_vector_get(bucket, it2);
+			wget_vector_t *candidates = wget_stringmap_get(cookie_db->index, cookie->domain);
+			int pos;
+
+			for (int it3 = 0; it3 < wget_vector_size(candidates); it3++) {
+				if (wget_vector_get(candidates, it3) == cookie) {
+					wget_vector_remove_nofree(candidates, it3);
+					break;
+				}
+			}
+
+			debug_printf("purge expired cookie %s=%s\n", cookie->name, cookie->value);
+			if ((pos = wget_vector_find(cookie_db->cookies, cookie)) >= 0)
+				wget_vector_remove(cookie_db->cookies, pos);
+		}
+
+		wget_hashmap_remove(cookie_db->expiry, key); // frees the bucket
+		cookie_db->dirty = 1;
+	}
+
+	wget_vector_clear_nofree(purge.due); // the keys are generation numbers, not pointers
+	wget_vector_free(&purge.due);
+}
+
+// keep the domain index in sync with the cookie store (mutex held by the caller);
+// 'old' is the (already freed) address of a replaced entry
+static void _index_cookie(wget_cookie_db_t *cookie_db, const void *old, wget_cookie_t *cookie)
+{
+	wget_vector_t *candidates = wget_stringmap_get(cookie_db->index, cookie->domain);
+
+	if (candidates) {
+		if (old) {
+			// the entry was replaced in place, drop the stale pointer
+			for (int it = 0; it < wget_vector_size(candidates); it++) {
+				if (wget_vector_get(candidates, it) == old) {
+					wget_vector_remove_nofree(candidates, it);
+					break;
+				}
+			}
+		}
+	} else {
+		candidates = wget_vector_create(4, -2, NULL);
+		wget_stringmap_put_noalloc(cookie_db->index, wget_strdup(cookie->domain), candidates);
+	}
+
+	wget_vector_add_noalloc(candidates, cookie);
+}
+
 int wget_cookie_store_cookie(wget_cookie_db_t *cookie_db, wget_cookie_t *cookie)
 {
 	wget_cookie_t *old;
@@ -632,15 +875,22 @@ int wget_cookie_store_cookie(wget_cookie_db_t *cookie_db, wget_cookie_t *cookie)
 	old = wget_vector_get(cookie_db->cookies, pos = wget_vector_find(cookie_db->cookies, cookie));
 
 	if (old) {
+		time_t old_expires = old->expires;
+
 		debug_printf("replace old cookie %s=%s\n", cookie->name, cookie->value);
 		cookie->creation = old->creation;
 		cookie->sort_age = old->sort_age;
 		wget_vector_replace(cookie_db->cookies, cookie, sizeof(*cookie), pos);
+		_index_cookie(cookie_db, old, wget_vector_get(cookie_db->cookies, pos));
+		_bucket_remove(cookie_db, old_expires, old);
 	} else {
 		debug_printf("store new cookie %s=%s\n", cookie->name, cookie->value);
 		cookie->sort_age = ++cookie_db->age;
-		wget_vector_insert_sorted(cookie_db->cookies, cookie, sizeof(*cookie));
+		pos = wget_vector_insert_sorted(cookie_db->cookies, cookie, sizeof(*cookie));
+		_index_cookie(cookie_db, NULL, wget_vector_get(cookie_db->cookies, pos));
 	}
+	_bucket_cookie(cookie_db, wget_vector_get(cookie_db->cookies, pos));
+	cookie_db->dirty = 1;
 
 	wget_thread_mutex_unlock(&cookie_db->mutex);
 
@@ -677,41 +927,54 @@ char *wget_cookie_create_request_header(wget_cookie_db_t *cookie_db, const wget_
 
 	wget_thread_mutex_lock(&cookie_db->mutex);
 
-	for (it = 0; it < wget_vector_size(cookie_db->cookies); it++) {
-		wget_cookie_t *cookie = wget_vector_get(cookie_db->cookies, it);
+	// drop the generations that fell due since the last purge, so the
+	// candidate walk below is over live cookies only
+	_purge_expired(cookie_db, now);
 
-		if (cookie->host_only && strcmp(cookie->domain, iri->host)) {
-			debug_printf("cookie host match failed (%s,%s)\n", cookie->domain, iri->host);
-			continue;
-		}
+	// walk the domain suffixes of the request host - only cookies with one of
+	// them as domain can match, and the index hands us exactly those
+	for (const char *domain = iri->host; domain; ) {
+		wget_vector_t *candidates = wget_stringmap_get(cookie_db->index, domain);
 
-		if (!cookie->host_only && !_domain_match(cookie->domain, iri->host)) {
-			debug_printf("cookie domain match failed (%s,%s)\n", cookie->domain, iri->host);
-			continue;
-		}
+		for (it = 0; it < wget_vector_size(candidates); it++) {
+			wget_cookie_t *cookie = wget_vector_get(candidates, it);
 
-		if (cookie->expires && cookie->expires <= now) {
-			debug_printf("cookie expired (%lld <= %lld)\n", (long long)cookie->expires, (long long)now);
-			continue;
-		}
+			if (cookie->host_only && strcmp(cookie->domain, iri->host)) {
+				debug_printf("cookie host match failed (%s,%s)\n", cookie->domain, iri->host);
+				continue;
+			}
 
-		if (cookie->secure_only && iri->scheme != WGET_IRI_SCHEME_HTTPS) {
-			debug_printf("cookie ignored, not secure\n");
-			continue;
-		}
+			if (!cookie->host_only && !_domain_match(cookie->domain, iri->host)) {
+				debug_printf("cookie domain match failed (%s,%s)\n", cookie->domain, iri->host);
+				continue;
+			}
 
-		if (!_path_match(cookie->path, iri->path)) {
-			debug_printf("cookie path doesn't match (%s, %s)\n", cookie->path, iri->path);
-			continue;
-		}
+			if (cookie->expires && cookie->expires <= now) {
+				debug_printf("cookie expired (%lld <= %lld)\n", (long long)cookie->expires, (long long)now);
+				continue;
+			}
+
+			if (cookie->secure_only && iri->scheme != WGET_IRI_SCHEME_HTTPS) {
+				debug_printf("cookie ignored, not secure\n");
+				continue;
+			}
 
-		debug_printf("found %s=%s\n", cookie->name, cookie->value);
+			if (!_path_match(cookie->path, iri->path)) {
+				debug_printf("cookie path doesn't match (%s, %s)\n", cookie->path, iri->path);
+				continue;
+			}
+
+			debug_printf("found %s=%s\n", cookie->name, cookie->value);
 
-		if (!cookies)
-			cookies = wget_vector_create(16, -2, (wget_vector_compare_t)_compare_cookie2);
+			if (!cookies)
+				cookies = wget_vector_create(16, -2, (wget_vector_compare_t)_compare_cookie2);
+
+			// collect matching cookies (just pointers, no allocation)
+			wget_vector_add_noalloc(cookies, cookie);
+		}
 
-		// collect matching cookies (just pointers, no allocation)
-		wget_vector_add_noalloc(cookies, cookie);
+		if ((domain = strchr(domain, '.')))
+			domain++;
 	}
 
 	// sort cookies regarding RFC 6265
@@ -749,8 +1012,14 @@ wget_cookie_db_t *wget_cookie_db_init(wget_cookie_db_t *cookie_db)
 	memset(cookie_db, 0, sizeof(*cookie_db));
 	cookie_db->cookies = wget_vector_create(32, -2, (wget_vector_compare_t)_compare_cookie);
 	wget_vector_set_destructor(cookie_db->cookies, (wget_vector_destructor_t)wget_cookie_deinit);
-	wget_thread_mutex_init(&cookie_db->mutex);
+	cookie_db->index = wget_stringmap_create(16);
+	wget_stringmap_set_value_destructor(cookie_db->index, (wget_stringmap_value_destructor_t)_free_index_entry);
+	cookie_db->expiry = wget_hashmap_create(16, _generation_hash, _generation_compare);
+	wget_hashmap_set_key_destructor(cookie_db->expiry, NULL); // keys are generation numbers, not pointers
+	wget_hashmap_set_value_destructor(cookie_db->expiry, (wget_hashmap_value_destructor_t)_free_index_entry);
+	wget_thread_mutex_init_adaptive(&cookie_db->mutex);
 #ifdef WITH_LIBPSL
+	wget_thread_mutex_init_adaptive(&cookie_db->psl_cache_mutex);
 #if ((PSL_VERSION_MAJOR > 0) || (PSL_VERSION_MAJOR == 0 && PSL_VERSION_MINOR >= 16))
 	cookie_db->psl = psl_latest(NULL);
 #else
@@ -765,10 +1034,13 @@ void wget_cookie_db_deinit(wget_cookie_db_t *cookie_db)
 {
 	if (cookie_db) {
 #ifdef WITH_LIBPSL
+		_psl_cache_free(cookie_db);
 		psl_free(cookie_db->psl);
 		cookie_db->psl = NULL;
 #endif
 		wget_thread_mutex_lock(&cookie_db->mutex);
+		wget_stringmap_free(&cookie_db->index);
+		wget_hashmap_free(&cookie_db->expiry);
 		wget_vector_free(&cookie_db->cookies);
 		wget_thread_mutex_unlock(&cookie_db->mutex);
 	}
@@ -788,6 +1060,43 @@ void wget_cookie_set_keep_session_cookies(wget_cookie_db_t *cookie_db, int keep)
 		cookie_db->keep_session_cookies = !!keep;
 }
 
+// bulk variant of wget_cookie_store_cookie(), used when loading into an empty
+// db: entries are appended unsorted and the db is sorted and indexed once in
+// _cookie_db_bulk_commit(), instead of paying a sorted insert per cookie.
+// The caller already did the normalize and PSL checks.
+static void _cookie_db_bulk_add(wget_cookie_db_t *cookie_db, wget_cookie_t *cookie)
+{
+	wget_thread_mutex_lock(&cookie_db->mutex);
+	cookie->sort_age = ++cookie_db->age;
+	wget_vector_add(cookie_db->cookies, cookie, sizeof(*cookie));
+	wget_thread_mutex_unlock(&cookie_db->mutex);
+}
+
+static void _cookie_db_bulk_commit(wget_cookie_db_t *cookie_db)
+{
+	wget_thread_mutex_lock(&cookie_db->mutex);
+
+	wget_vector_sort(cookie_db->cookies);
+
+	// duplicate lines in the file: keep the later one, as repeated stores would
+	for (int it = wget_vector_size(cookie_db->cookies) - 1; it > 0; it--) {
+		wget_cookie_t *prev = wget_vector_get(cookie_db->cookies, it - 1);
+		wget_cookie_t *cur = wget_vector_get(cookie_db->cookies, it);
+
+		if (_compare_cookie(prev, cur) == 0)
+			wget_vector_remove(cookie_db->cookies, prev->sort_age < cur->sort_age ? it - 1 : it);
+	}
+
+	for (int it = 0; it < wget_vector_size(cookie_db->cookies); it++) {
+		wget_cookie_t *cookie = wget_vector_get(cookie_db->cookies, it);
+
+		_index_cookie(cookie_db, NULL, cookie);
+		_bucket_cookie(cookie_db, cookie);
+	}
+
+	wget_thread_mutex_unlock(&cookie_db->mutex);
+}
+
 static int _cookie_db_load(wget_cookie_db_t *cookie_db, FILE *fp)
 {
 	wget_cookie_t cookie;
@@ -796,6 +1105,9 @@ static int _cookie_db_load(wget_cookie_db_t *cookie_db, FILE *fp)
 	size_t bufsize = 0;
 	ssize_t buflen;
 	time_t now = time(NULL);
+	// only an empty db (the startup load) can take the bulk path; when merging
+	// into a populated db each cookie has to go through the replace logic
+	int bulk = wget_vector_size(cookie_db->cookies) == 0;
 
 	wget_cookie_init(&cookie);
 
@@ -871,11 +1183,20 @@ static int _cookie_db_load(wget_cookie_db_t *cookie_db, FILE *fp)
 
 		if (wget_cookie_normalize(NULL, &cookie) == 0 && wget_cookie_check_psl(cookie_db, &cookie) == 0) {
 			ncookies++;
-			wget_cookie_store_cookie(cookie_db, &cookie);
+			if (bulk)
+				_cookie_db_bulk_add(cookie_db, &cookie);
+			else
+				wget_cookie_store_cookie(cookie_db, &cookie);
+			// the strings belong to the db now - reinit, so that dropping a
+			// later incomplete/expired line can't free them
+			wget_cookie_init(&cookie);
 		} else
 			wget_cookie_deinit(&cookie);
 	}
 
+	if (bulk)
+		_cookie_db_bulk_commit(cookie_db);
+
 	xfree(buf);
 
 	if (ferror(fp)) {
@@ -946,6 +1267,18 @@ int wget_cookie_db_save(wget_cookie_db_t *cookie_db, const char *fname)
 	if (!cookie_db || !fname || !*fname)
 		return -1;
 
+	if (!cookie_db->dirty) {
+		// nothing was stored since the last load/save, skip the full rewrite
+		debug_printf(_("No cookie changes, leaving '%s' untouched\n"), fname);
+		return 0;
+	}
+
+	// expired entries are dropped generation-wise, so the save below only
+	// walks cookies that are (mostly) worth writing
+	wget_thread_mutex_lock(&cookie_db->mutex);
+	_purge_expired(cookie_db, time(NULL));
+	wget_thread_mutex_unlock(&cookie_db->mutex);
+
 	if (wget_update_file(fname,
 		(wget_update_load_t)_cookie_db_load,
 		(wget_update_save_t)_cookie_db_save, cookie_db))
@@ -954,6 +1287,8 @@ int wget_cookie_db_save(wget_cookie_db_t *cookie_db, const char *fname)
 		return -1;
 	}
 
+	cookie_db->dirty = 0;
+
 	if ((size = wget_vector_size(cookie_db->cookies)))
 		debug_printf(_("Saved %d cookie%s into '%s'\n"), size, size != 1 ? "s" : "", fname);
 	else
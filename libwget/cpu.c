@@ -0,0 +1,180 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * CPU feature detection and dispatch for vectorized kernels
+ *
+ * Hot byte-scanning kernels come in a scalar and (where the compiler
+ * provides the intrinsics) a vectorized variant. Instead of every kernel
+ * doing its own cpuid dance, they all register here: one table row per
+ * kernel, pointing at the caller-facing function pointer, the scalar
+ * fallback and the vectorized variant with its required CPU feature.
+ * cpu_resolve_kernels() repoints the slots once - from wget_global_init()
+ * or wget_cpu_set_simd() - so the per-call cost is a single indirect call.
+ *
+ * The slots statically point at the scalar fallbacks, so kernels stay
+ * correct (just unaccelerated) for callers that never initialize the
+ * library.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <wget.h>
+#include "private.h"
+
+// one row per accelerated kernel
+typedef struct {
+	const char *
+		name; // for the debug log
+	cpu_kernel_fn *
+		slot; // the pointer callers go through
+	cpu_kernel_fn
+		scalar, // always available
+		simd;   // NULL if not compiled in
+	int
+		feature; // WGET_CPU_FEATURE_*, required by 'simd'
+} kernel_t;
+
+static const kernel_t kernels[] = {
+	{ "http_scan_byte", (cpu_kernel_fn *) &http_scan_byte,
+		(cpu_kernel_fn) http_scan_byte_scalar,
+#ifdef __SSE2__
+		(cpu_kernel_fn) http_scan_byte_sse2,
+#else
+		NULL,
+#endif
+		WGET_CPU_FEATURE_SSE2 },
+	{ "base64_encode_bulk", (cpu_kernel_fn *) &base64_encode_bulk,
+		(cpu_kernel_fn) base64_encode_bulk_scalar,
+#ifdef WITH_SSSE3_KERNELS
+		(cpu_kernel_fn) base64_encode_bulk_ssse3,
+#else
+		NULL,
+#endif
+		WGET_CPU_FEATURE_SSSE3 },
+	{ "base64_decode_bulk", (cpu_kernel_fn *) &base64_decode_bulk,
+		(cpu_kernel_fn) base64_decode_bulk_scalar,
+#ifdef WITH_SSSE3_KERNELS
+		(cpu_kernel_fn) base64_decode_bulk_ssse3,
+#else
+		NULL,
+#endif
+		WGET_CPU_FEATURE_SSSE3 },
+	{ "memtohex_bulk", (cpu_kernel_fn *) &memtohex_bulk,
+		(cpu_kernel_fn) memtohex_bulk_scalar,
+#ifdef WITH_SSSE3_KERNELS
+		(cpu_kernel_fn) memtohex_bulk_ssse3,
+#else
+		NULL,
+#endif
+		WGET_CPU_FEATURE_SSSE3 },
+	{ "ascii_strcasecmp", (cpu_kernel_fn *) &ascii_strcasecmp,
+		(cpu_kernel_fn) ascii_strcasecmp_scalar,
+#if defined(__SSE2__) && WITH_OVERREAD_KERNELS
+		(cpu_kernel_fn) ascii_strcasecmp_sse2,
+#else
+		NULL,
+#endif
+		WGET_CPU_FEATURE_SSE2 },
+	{ "ascii_strncasecmp", (cpu_kernel_fn *) &ascii_strncasecmp,
+		(cpu_kernel_fn) ascii_strncasecmp_scalar,
+#if defined(__SSE2__) && WITH_OVERREAD_KERNELS
+		(cpu_kernel_fn) ascii_strncasecmp_sse2,
+#else
+		NULL,
+#endif
+		WGET_CPU_FEATURE_SSE2 },
+	{ "ascii_span", (cpu_kernel_fn *) &ascii_span,
+		(cpu_kernel_fn) ascii_span_scalar,
+#ifdef __SSE2__
+		(cpu_kernel_fn) ascii_span_sse2,
+#else
+		NULL,
+#endif
+		WGET_CPU_FEATURE_SSE2 },
+};
+
+static int
+	simd_enabled = 1;
+
+static int _detect_features(void)
+{
+	int features = 0;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		features |= WGET_CPU_FEATURE_SSE2;
+	if (__builtin_cpu_supports("ssse3"))
+		features |= WGET_CPU_FEATURE_SSSE3;
+	if (__builtin_cpu_supports("avx2"))
+		features |= WGET_CPU_FEATURE_AVX2;
+#elif defined(__aarch64__)
+	// Advanced SIMD is part of the AArch64 baseline
+	features |= WGET_CPU_FEATURE_NEON;
+#elif defined(__ARM_NEON)
+	// 32-bit ARM: if the compiler targets NEON, the CPU must have it
+	features |= WGET_CPU_FEATURE_NEON;
+#endif
+
+	return features;
+}
+
+/**
+ * \param[in] features One or more WGET_CPU_FEATURE_* flags, OR'ed together
+ * \return 1 if the running CPU supports all given features, 0 if not
+ *
+ * Detection runs once on first call and is cached.
+ */
+int wget_cpu_supports(int features)
+{
+	static int detected = -1;
+
+	if (detected < 0)
+		detected = _detect_features();
+
+	return (detected & features) == features;
+}
+
+// repoint every kernel slot at the best variant for the running CPU
+void cpu_resolve_kernels(void)
+{
+	for (unsigned it = 0; it < countof(kernels); it++) {
+		const kernel_t *k = &kernels[it];
+		int vectorized = simd_enabled && k->simd && wget_cpu_supports(k->feature);
+
+		*k->slot = vectorized ? k->simd : k->scalar;
+		debug_printf("cpu: %s -> %s\n", k->name, vectorized ? "simd" : "scalar");
+	}
+}
+
+/**
+ * \param[in] enable 0 to force the scalar fallbacks, non-zero to use vectorized kernels where supported
+ *
+ * Meant for debugging and A/B measurements (--no-simd in wget2).
+ * Takes effect immediately, also when called before wget_global_init().
+ */
+void wget_cpu_set_simd(int enable)
+{
+	simd_enabled = !!enable;
+	cpu_resolve_kernels();
+}
@@ -23,12 +23,12 @@
  * Changelog
  * 03.07.2012  Tim Ruehsen  created
  *
- * A parser using the flex tokenizer, created with flex tokens from
- *   https://www.w3.org/TR/css3-syntax/
- *
- * TODO:
- *  - since we are just interested in @import ... and url(...), we could use
- *    a simplistic hand-written parser which might be much smaller and faster
+ * We are just interested in @charset, @import ... and url(...), so instead
+ * of fully tokenizing the stylesheet (we once ran a flex-generated tokenizer
+ * built from the token definitions at https://www.w3.org/TR/css3-syntax/),
+ * we search directly for those constructs and only scan string boundaries,
+ * comments and the url() arguments themselves. Everything between two
+ * constructs is skipped with libc's vectorized delimiter search.
  */
 
 #include <config.h>
@@ -46,26 +46,89 @@
 #include <wget.h>
 #include "private.h"
 
-#include "css_tokenizer.h"
-
-// see css_tokenizer.c
-typedef void* yyscan_t;
-int yyget_leng(yyscan_t yyscanner);
-char *yyget_text(yyscan_t yyscanner);
-typedef struct yy_buffer_state *YY_BUFFER_STATE;
-int yylex_init(yyscan_t* scanner);
-YY_BUFFER_STATE yy_scan_string(const char * yystr, yyscan_t yyscanner);
-YY_BUFFER_STATE yy_scan_bytes(const char * yystr, int len, yyscan_t yyscanner);
-int yylex(yyscan_t yyscanner);
-int yylex_destroy(yyscan_t yyscanner);
-void *yyalloc(size_t size);
-void *yyrealloc(void *p, size_t size);
-
-void *yyalloc(size_t size) {
-	return wget_malloc(size);
+// whitespace as of the CSS 'S' token
+#define _is_css_space(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n' || (c) == '\f')
+
+// chars that may end an identifier directly before 'url(' - if one precedes,
+// we look at the tail of a longer identifier or function name, not at a URI
+#define _is_css_ident_char(c) (c_isalnum(c) || (c) == '_' || (c) == '-' || (c) == '\\' || (unsigned char) (c) >= 0x80)
+
+// skip over a comment, 'it' points at the opening "/*";
+// returns the position right after the closing "*/" (or 'len')
+static size_t _skip_comment(const char *buf, size_t len, size_t it)
+{
+	const char *q;
+
+	for (it += 2; (q = memchr(buf + it, '*', len - it)); ) {
+		it = (size_t) (q - buf) + 1;
+		if (it < len && buf[it] == '/')
+			return it + 1;
+	}
+
+	return len;
+}
+
+// skip over a string, 'it' points at the opening quote;
+// returns the position right after the closing quote.
+// As of CSS an unescaped newline may not appear inside a string - in that
+// case the string is unterminated and scanning resumes at the newline.
+static size_t _skip_string(const char *buf, size_t len, size_t it)
+{
+	char quote = buf[it++];
+
+	while (it < len) {
+		char c = buf[it];
+
+		if (c == '\\' && it + 1 < len)
+			it += 2; // escaped char
+		else if (c == quote)
+			return it + 1;
+		else if (c == '\n' || c == '\r' || c == '\f')
+			break; // unterminated string
+		else
+			it++;
+	}
+
+	return it;
 }
-void *yyrealloc(void *p, size_t size) {
-	return wget_realloc(p, size);
+
+// match the CSS 'uri' token url( w (string | raw url chars) w ), with 'it'
+// pointing at "url(". Returns 1 and the position right after the closing ')'
+// in *end, or 0 if the construct is no complete uri token.
+static int _scan_url_token(const char *buf, size_t len, size_t it, size_t *end)
+{
+	for (it += 4; it < len && _is_css_space(buf[it]); it++);
+
+	if (it < len && (buf[it] == '"' || buf[it] == '\'')) {
+		size_t strend = _skip_string(buf, len, it);
+
+		if (strend <= it + 1 || buf[strend - 1] != buf[it])
+			return 0; // unterminated string
+
+		it = strend;
+	} else {
+		// unquoted: anything printable or non-ASCII except quotes and parentheses,
+		// plus escaped chars
+		while (it < len) {
+			unsigned char c = buf[it];
+
+			if (c == '\\' && it + 1 < len)
+				it += 2;
+			else if ((c >= '!' && c <= '~' && c != '"' && c != '\'' && c != '(' && c != ')') || c >= 0x80)
+				it++;
+			else
+				break;
+		}
+	}
+
+	for (; it < len && _is_css_space(buf[it]); it++);
+
+	if (it < len && buf[it] == ')') {
+		*end = it + 1;
+		return 1;
+	}
+
+	return 0;
 }
 
 void wget_css_parse_buffer(
@@ -75,40 +138,89 @@ void wget_css_parse_buffer(
 	wget_css_parse_encoding_cb_t callback_encoding,
 	void *user_ctx)
 {
-	int token;
-	size_t length, pos = 0;
-	char *text;
-	yyscan_t scanner;
-
-	yylex_init(&scanner);
-	yy_scan_bytes(buf, (int) len, scanner);
-
-	while ((token = yylex(scanner)) != CSSEOF) {
-		if (token == IMPORT_SYM) {
-			// e.g. @import "https://example.com/index.html"
-			pos += yyget_leng(scanner);
-
-			// skip whitespace before URI/STRING
-			while ((token = yylex(scanner)) == S)
-				pos += yyget_leng(scanner);
-
-			// now token should be STRING or URI
-			if (token == STRING)
-				token = URI;
+	size_t it = 0;
+
+	while (it < len) {
+		// fast-forward to the next char that could start a comment, a string,
+		// an at-rule or a url( token
+		it += strcspn(buf + it, "/\"'@uU");
+
+		if (it >= len)
+			break;
+
+		char c = buf[it];
+
+		if (!c) {
+			it++; // embedded 0 byte (strcspn stopped there), no token starts with it
+			continue;
 		}
 
-		if (token == URI && callback_uri) {
-			// e.g. url(https://example.com/index.html)
-			text = yyget_text(scanner);
-			length = yyget_leng(scanner);
+		if (c == '/') {
+			if (it + 1 < len && buf[it + 1] == '*') {
+				it = _skip_comment(buf, len, it);
+				continue;
+			}
+		} else if (c == '"' || c == '\'') {
+			it = _skip_string(buf, len, it);
+			continue;
+		} else if (c == '@') {
+			if (it + 7 <= len && !wget_strncasecmp_ascii(buf + it, "@import", 7)) {
+				size_t it2;
+
+				// skip whitespace before URI/STRING
+				for (it2 = it + 7; it2 < len && _is_css_space(buf[it2]); it2++);
+
+				if (it2 < len && (buf[it2] == '"' || buf[it2] == '\'')) {
+					// e.g. @import "https://example.com/index.html"
+					size_t strend = _skip_string(buf, len, it2);
+
+					if (strend > it2 + 1 && buf[strend - 1] == buf[it2]) {
+						if (callback_uri)
+							callback_uri(user_ctx, buf + it2 + 1, strend - it2 - 2, it2 + 1);
+					}
+
+					it = strend;
+					continue;
+				}
+
+				// @import url(...) is found by the generic url( scan
+				it = it2;
+				continue;
+			}
+			if (it + 8 <= len && !wget_strncasecmp_ascii(buf + it, "@charset", 8)) {
+				size_t it2;
+
+				// skip whitespace before the charset name
+				for (it2 = it + 8; it2 < len && _is_css_space(buf[it2]); it2++);
+
+				if (it2 < len && (buf[it2] == '"' || buf[it2] == '\'')) {
+					// e.g. @charset "UTF-8"
+					size_t strend = _skip_string(buf, len, it2);
+
+					if (strend > it2 + 1 && buf[strend - 1] == buf[it2]) {
+						if (callback_encoding)
+							callback_encoding(user_ctx, buf + it2 + 1, strend - it2 - 2);
+					}
 
-			if (*text == '\'' || *text == '\"') {
-				// a string - remove the quotes
-				callback_uri(user_ctx, text + 1, length - 2, pos + 1);
-			} else {
-				// extract URI from url(...)
-				if (!wget_strncasecmp_ascii(text, "url(", 4)) {
-					char *otext = text;
+					it = strend;
+					continue;
+				}
+
+				error_printf(_("Unknown token after @charset\n"));
+				it = it2;
+				continue;
+			}
+		} else { // 'u' or 'U'
+			size_t end;
+
+			if (it + 4 <= len && !wget_strncasecmp_ascii(buf + it, "url(", 4)
+				&& (!it || !_is_css_ident_char(buf[it - 1]))
+				&& _scan_url_token(buf, len, it, &end))
+			{
+				// e.g. url(https://example.com/index.html)
+				if (callback_uri) {
+					const char *otext = buf + it, *text = otext;
+					size_t length = end - it;
 
 					// remove trailing ) and any spaces before
 					for (length--; c_isspace(text[length - 1]); length--);
@@ -125,37 +237,16 @@ void wget_css_parse_buffer(
 					if (length && (text[length - 1] == '\'' || text[length - 1] == '\"'))
 						length--;
 
-					callback_uri(user_ctx, text, length, pos + (text - otext));
-				}
-			}
-		} else if (token == CHARSET_SYM && callback_encoding) {
-			// e.g. @charset "UTF-8"
-			pos += yyget_leng(scanner);
-
-			// skip whitespace before charset name
-			while ((token = yylex(scanner)) == S)
-				pos += yyget_leng(scanner);
-
-			// now token should be STRING
-			if (token == STRING) {
-				text = yyget_text(scanner);
-				length = yyget_leng(scanner);
-
-				if (*text == '\'' || *text == '\"') {
-					// a string - remove the quotes
-					callback_encoding(user_ctx, text + 1, length - 2);
-				} else {
-					// a string without quotes
-					callback_encoding(user_ctx, text, length);
+					callback_uri(user_ctx, text, length, it + (text - otext));
 				}
-			} else {
-				error_printf(_("Unknown token after @charset: %d\n"), token);
+
+				it = end;
+				continue;
 			}
 		}
-		pos += yyget_leng(scanner);
-	}
 
-	yylex_destroy(scanner);
+		it++; // the char was no token start after all
+	}
 }
 
 void wget_css_parse_file(
@@ -39,6 +39,8 @@ typedef struct {
 		**encoding;
 	wget_vector_t
 		*uris;
+	char
+		dup_urls; // copy the URL text (the parsed buffer dies before the result)
 } _CSS_CONTEXT;
 
 static void _free_url(wget_css_parsed_url_t *url)
@@ -47,6 +49,12 @@ static void _free_url(wget_css_parsed_url_t *url)
 	xfree(url->abs_url);
 }
 
+static void _free_url_slice(wget_css_parsed_url_t *url)
+{
+	// url->url points into the parsed buffer, owned by the caller
+	xfree(url->abs_url);
+}
+
 // Callback function, called from CSS parser for each @charset found.
 static void _css_get_encoding(void *context, const char *encoding, size_t len)
 {
@@ -60,14 +68,17 @@ static void _css_get_encoding(void *context, const char *encoding, size_t len)
 }
 
 // Callback function, called from CSS parser for each URI found.
+// By default the URL is a (pointer,len) slice into the parsed buffer - most
+// URLs get filtered out by the callers, they should not cost an allocation.
 static void _css_get_url(void *context, const char *url, size_t len, size_t pos)
 {
 	_CSS_CONTEXT *ctx = context;
-	wget_css_parsed_url_t parsed_url = { .len = len, .pos = pos, .url = wget_strmemdup(url, len), .abs_url = NULL };
+	wget_css_parsed_url_t parsed_url = { .len = len, .pos = pos, .url = ctx->dup_urls ? wget_strmemdup(url, len) : url, .abs_url = NULL };
 
 	if (!ctx->uris) {
 		ctx->uris = wget_vector_create(16, -2, NULL);
-		wget_vector_set_destructor(ctx->uris, (wget_vector_destructor_t)_free_url);
+		wget_vector_set_destructor(ctx->uris,
+			ctx->dup_urls ? (wget_vector_destructor_t)_free_url : (wget_vector_destructor_t)_free_url_slice);
 	}
 
 	wget_vector_add(ctx->uris, &parsed_url, sizeof(parsed_url));
@@ -85,13 +96,15 @@ static void _urls_to_absolute(wget_vector_t *urls, wget_iri_t *base)
 			if (wget_iri_relative_to_abs(base, url->url, url->len, &buf))
 				url->abs_url = wget_strmemdup(buf.data, buf.length);
 			else
-				error_printf("Cannot resolve relative URI '%s'\n", url->url);
+				error_printf("Cannot resolve relative URI '%.*s'\n", (int) url->len, url->url);
 		}
 
 		wget_buffer_deinit(&buf);
 	}
 }
 
+// The returned 'url' members are (pointer,len) slices into 'css' and stay
+// valid only as long as the caller keeps that buffer alive.
 wget_vector_t *wget_css_get_urls(const char *css, size_t len, wget_iri_t *base, const char **encoding)
 {
 	_CSS_CONTEXT context = { .encoding = encoding };
@@ -104,7 +117,7 @@ wget_vector_t *wget_css_get_urls(const char *css, size_t len, wget_iri_t *base,
 
 wget_vector_t *wget_css_get_urls_from_localfile(const char *fname, wget_iri_t *base, const char **encoding)
 {
-	_CSS_CONTEXT context = { .encoding = encoding };
+	_CSS_CONTEXT context = { .encoding = encoding, .dup_urls = 1 }; // the file buffer dies within wget_css_parse_file()
 
 	wget_css_parse_file(fname, _css_get_url, encoding ? _css_get_encoding : NULL, &context);
 	_urls_to_absolute(context.uris, base);
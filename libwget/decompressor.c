@@ -54,6 +54,10 @@
 #include <brotli/decode.h>
 #endif
 
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+
 #include <wget.h>
 #include "private.h"
 
@@ -77,6 +81,10 @@ struct _wget_decompressor_st {
 	BrotliDecoderState
 		*brotli_strm;
 #endif
+#ifdef WITH_ZSTD
+	ZSTD_DStream
+		*zstd_strm;
+#endif
 
 	wget_decompressor_sink_t
 		sink; // decompressed data goes here
@@ -89,9 +97,19 @@ struct _wget_decompressor_st {
 	void
 		*context; // given to sink()
 	char
-		encoding;
+		encoding,
+		sink_aborted; // a sink returned < 0: the receiver wants no more data
 };
 
+// hand decompressed bytes to the sink. A negative sink return means the
+// receiver wants no more data (e.g. a canceled transfer) - remembered so
+// wget_decompress() can tell the caller to stop feeding.
+static void _sink_write(wget_decompressor_t *dc, const char *data, size_t len)
+{
+	if (dc->sink && dc->sink(dc->context, data, len) < 0)
+		dc->sink_aborted = 1;
+}
+
 #ifdef WITH_ZLIB
 static int gzip_init(z_stream *strm)
 {
@@ -130,11 +148,15 @@ static int gzip_decompress(wget_decompressor_t *dc, char *src, size_t srclen)
 		strm->avail_out = sizeof(dst);
 
 		status = inflate(strm, Z_SYNC_FLUSH);
-		if ((status == Z_OK || status == Z_STREAM_END) && strm->avail_out < sizeof(dst)) {
-			if (dc->sink)
-				dc->sink(dc->context, dst, sizeof(dst) - strm->avail_out);
-		}
-	} while (status == Z_OK && !strm->avail_out);
+		if ((status == Z_OK || status == Z_STREAM_END) && strm->avail_out < sizeof(dst))
+			_sink_write(dc, dst, sizeof(dst) - strm->avail_out);
+
+		// multi-member stream (e.g. from pigz or concatenated .gz files):
+		// restart inflation at the next member instead of dropping the rest
+		if (status == Z_STREAM_END && strm->avail_in > 0
+			&& dc->encoding == wget_content_encoding_gzip && inflateReset(strm) == Z_OK)
+			status = Z_OK;
+	} while (status == Z_OK && (strm->avail_in || !strm->avail_out));
 
 	if (status == Z_OK || status == Z_STREAM_END)
 		return 0;
@@ -202,10 +224,8 @@ static int lzma_decompress(wget_decompressor_t *dc, char *src, size_t srclen)
 		strm->avail_out = sizeof(dst);
 
 		status = lzma_code(strm, LZMA_RUN);
-		if ((status == LZMA_OK || status == LZMA_STREAM_END) && strm->avail_out<sizeof(dst)) {
-			if (dc->sink)
-				dc->sink(dc->context, dst, sizeof(dst) - strm->avail_out);
-		}
+		if ((status == LZMA_OK || status == LZMA_STREAM_END) && strm->avail_out<sizeof(dst))
+			_sink_write(dc, dst, sizeof(dst) - strm->avail_out);
 	} while (status == LZMA_OK && !strm->avail_out);
 
 	if (status == LZMA_OK || status == LZMA_STREAM_END)
@@ -258,10 +278,8 @@ static int brotli_decompress(wget_decompressor_t *dc, char *src, size_t srclen)
 		available_out = sizeof(dst);
 
 		status = BrotliDecoderDecompressStream(strm, &available_in, &next_in, &available_out, &next_out, NULL);
-		if (available_out != sizeof(dst)) {
-			if (dc->sink)
-				dc->sink(dc->context, (char *)dst, sizeof(dst) - available_out);
-		}
+		if (available_out != sizeof(dst))
+			_sink_write(dc, (char *)dst, sizeof(dst) - available_out);
 	} while (status == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT);
 
 	if (status == BROTLI_DECODER_RESULT_SUCCESS || status == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT)
@@ -279,6 +297,60 @@ static void brotli_exit(wget_decompressor_t *dc)
 }
 #endif // WITH_BROTLIDEC
 
+#ifdef WITH_ZSTD
+static int zstd_init(ZSTD_DStream **strm)
+{
+	if ((*strm = ZSTD_createDStream()) == NULL) {
+		error_printf(_("Failed to init zstd decompression\n"));
+		return -1;
+	}
+
+	ZSTD_initDStream(*strm);
+
+	return 0;
+}
+
+static int zstd_decompress(wget_decompressor_t *dc, char *src, size_t srclen)
+{
+	ZSTD_DStream *strm;
+	char dst[10240];
+
+	if (!srclen) {
+		// special case to avoid decompress errors
+		if (dc->sink)
+			dc->sink(dc->context, "", 0);
+
+		return 0;
+	}
+
+	strm = dc->zstd_strm;
+	ZSTD_inBuffer in = { .src = src, .size = srclen, .pos = 0 };
+
+	do {
+		ZSTD_outBuffer out = { .dst = dst, .size = sizeof(dst), .pos = 0 };
+		size_t status = ZSTD_decompressStream(strm, &out, &in);
+
+		if (ZSTD_isError(status)) {
+			error_printf(_("Failed to uncompress zstd stream: %s\n"), ZSTD_getErrorName(status));
+			return -1;
+		}
+
+		if (out.pos)
+			_sink_write(dc, dst, out.pos);
+
+		// status 0 means a frame ended - the decoder restarts itself
+		// on the next frame of a multi-frame stream
+	} while (in.pos < in.size);
+
+	return 0;
+}
+
+static void zstd_exit(wget_decompressor_t *dc)
+{
+	ZSTD_freeDStream(dc->zstd_strm);
+}
+#endif // WITH_ZSTD
+
 #ifdef WITH_BZIP2
 static int bzip2_init(bz_stream *strm)
 {
@@ -315,10 +387,8 @@ static int bzip2_decompress(wget_decompressor_t *dc, char *src, size_t srclen)
 		strm->avail_out = sizeof(dst);
 
 		status = BZ2_bzDecompress(strm);
-		if ((status == BZ_OK || status == BZ_STREAM_END) && strm->avail_out<sizeof(dst)) {
-			if (dc->sink)
-				dc->sink(dc->context, dst, sizeof(dst) - strm->avail_out);
-		}
+		if ((status == BZ_OK || status == BZ_STREAM_END) && strm->avail_out<sizeof(dst))
+			_sink_write(dc, dst, sizeof(dst) - strm->avail_out);
 	} while (status == BZ_OK && !strm->avail_out);
 
 	if (status == BZ_OK || status == BZ_STREAM_END)
@@ -336,19 +406,60 @@ static void bzip2_exit(wget_decompressor_t *dc)
 
 static int identity(wget_decompressor_t *dc, char *src, size_t srclen)
 {
-	if (dc->sink)
-		dc->sink(dc->context, src, srclen);
+	_sink_write(dc, src, srclen);
 
 	return 0;
 }
 
+// Thread-local recycling pool for zlib-based decompressors: a z_stream
+// carries ~40K of window allocations, so paying inflateInit()/inflateEnd()
+// per response adds up with millions of small gzipped bodies. Only zlib
+// states can be reset in place - the other codecs free their state on exit
+// and are created fresh. Open and close happen on the same (downloader)
+// thread, so the pool needs no locking.
+#if (defined __GNUC__ || defined __clang__) && defined WITH_ZLIB
+# define DC_POOL_MAX 4
+static __thread wget_decompressor_t
+	*dc_pool[DC_POOL_MAX];
+static __thread int
+	dc_pool_size;
+#endif
+
 wget_decompressor_t *wget_decompress_open(int encoding,
 	wget_decompressor_sink_t sink,
 	void *context)
 {
-	wget_decompressor_t *dc = xcalloc(1, sizeof(wget_decompressor_t));
+	wget_decompressor_t *dc;
 	int rc = 0;
 
+#ifdef DC_POOL_MAX
+	if (encoding == wget_content_encoding_gzip || encoding == wget_content_encoding_deflate) {
+		for (int it = 0; it < dc_pool_size; it++) {
+			dc = dc_pool[it];
+
+			if (dc->encoding == encoding) {
+				dc_pool[it] = dc_pool[--dc_pool_size];
+
+				// reset keeps the allocated inflate state and window
+				if (inflateReset(&dc->z_strm) == Z_OK) {
+					dc->sink = sink;
+					dc->context = context;
+					dc->error_handler = NULL;
+					dc->sink_aborted = 0;
+					return dc;
+				}
+
+				// a broken state isn't worth saving
+				inflateEnd(&dc->z_strm);
+				xfree(dc);
+				break;
+			}
+		}
+	}
+#endif
+
+	dc = xcalloc(1, sizeof(wget_decompressor_t));
+
 	if (encoding == wget_content_encoding_gzip) {
 #ifdef WITH_ZLIB
 		if ((rc = gzip_init(&dc->z_strm)) == 0) {
@@ -383,6 +494,13 @@ wget_decompressor_t *wget_decompress_open(int encoding,
 			dc->decompress = brotli_decompress;
 			dc->exit = brotli_exit;
 		}
+#endif
+	} else if (encoding == wget_content_encoding_zstd) {
+#ifdef WITH_ZSTD
+		if ((rc = zstd_init(&dc->zstd_strm)) == 0) {
+			dc->decompress = zstd_decompress;
+			dc->exit = zstd_exit;
+		}
 #endif
 	} else {
 		// identity
@@ -403,6 +521,14 @@ wget_decompressor_t *wget_decompress_open(int encoding,
 void wget_decompress_close(wget_decompressor_t *dc)
 {
 	if (dc) {
+#ifdef DC_POOL_MAX
+		if ((dc->encoding == wget_content_encoding_gzip || dc->encoding == wget_content_encoding_deflate)
+			&& dc->exit && dc_pool_size < DC_POOL_MAX)
+		{
+			dc_pool[dc_pool_size++] = dc;
+			return;
+		}
+#endif
 		if (dc->exit)
 			dc->exit(dc);
 		xfree(dc);
@@ -416,6 +542,9 @@ int wget_decompress(wget_decompressor_t *dc, char *src, size_t srclen)
 
 		if (rc && dc->error_handler)
 			dc->error_handler(dc->context, rc);
+
+		if (dc->sink_aborted)
+			return -1; // the receiver canceled, stop feeding
 	}
 
 	return 0;
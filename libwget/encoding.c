@@ -30,6 +30,10 @@
 #include <string.h>
 #include <errno.h>
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 #ifdef HAVE_ICONV
 # include <iconv.h>
 #endif
@@ -57,6 +61,66 @@
 #include <wget.h>
 #include "private.h"
 
+// Length of the leading pure-ASCII run of 's', length-bounded (no overread)
+size_t ascii_span_scalar(const unsigned char *s, size_t n)
+{
+	size_t it = 0;
+
+	for (; it + sizeof(unsigned long long) <= n; it += sizeof(unsigned long long)) {
+		unsigned long long w;
+
+		memcpy(&w, s + it, sizeof(w));
+		if (w & 0x8080808080808080ULL)
+			break;
+	}
+	for (; it < n && s[it] < 0x80; it++)
+		;
+
+	return it;
+}
+
+#ifdef __SSE2__
+size_t ascii_span_sse2(const unsigned char *s, size_t n)
+{
+	size_t it = 0;
+
+	for (; it + 16 <= n; it += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) (s + it));
+		int mask = _mm_movemask_epi8(v); // one bit per byte with the high bit set
+
+		if (mask)
+			return it + __builtin_ctz(mask);
+	}
+	for (; it < n && s[it] < 0x80; it++)
+		;
+
+	return it;
+}
+#endif
+
+ascii_span_fn ascii_span = ascii_span_scalar; // repointed by cpu.c
+
+// Charsets that keep the bytes 0x00..0x7F unchanged, so a pure-ASCII
+// buffer converts to/from them as identity. Deliberately conservative:
+// Shift_JIS is absent (iconv maps 0x5C/0x7E to Yen/overline), as is
+// everything that is no ASCII superset at all (UTF-16/32, EBCDIC, ...).
+static bool _charset_maps_ascii_identity(const char *cs)
+{
+	return !wget_strcasecmp_ascii(cs, "utf-8")
+		|| !wget_strcasecmp_ascii(cs, "utf8")
+		|| !wget_strcasecmp_ascii(cs, "ascii")
+		|| !wget_strcasecmp_ascii(cs, "us-ascii")
+		|| !wget_strncasecmp_ascii(cs, "iso-8859-", 9)
+		|| !wget_strncasecmp_ascii(cs, "windows-125", 11)
+		|| !wget_strncasecmp_ascii(cs, "cp125", 5)
+		|| !wget_strncasecmp_ascii(cs, "koi8", 4)
+		|| !wget_strcasecmp_ascii(cs, "gbk")
+		|| !wget_strcasecmp_ascii(cs, "gb2312")
+		|| !wget_strcasecmp_ascii(cs, "gb18030")
+		|| !wget_strcasecmp_ascii(cs, "big5")
+		|| !wget_strncasecmp_ascii(cs, "euc-", 4);
+}
+
 const char *wget_local_charset_encoding(void)
 {
 	const char *encoding = nl_langinfo(CODESET);
@@ -67,6 +131,71 @@ const char *wget_local_charset_encoding(void)
 	return wget_strdup("ASCII");
 }
 
+#ifdef HAVE_ICONV
+/*
+ * Per-thread iconv descriptor cache. Mirroring a site pays one
+ * iconv_open()/iconv_close() per document otherwise, although nearly all
+ * pages of a host declare the same charset. A handful of MRU-ordered
+ * entries per thread covers that; the descriptors live as long as the
+ * thread (a few cached descriptors, not a growing resource).
+ */
+#if defined __GNUC__ || defined __clang__
+#define HAVE_ICONV_CACHE 1
+
+typedef struct {
+	char
+		from[32],
+		to[32]; // to[0] == 0 means 'entry unused'
+	iconv_t
+		cd;
+} _iconv_cache_entry_t;
+
+static __thread _iconv_cache_entry_t iconv_cache[4]; // most-recently-used first
+
+// returns a (possibly cached) conversion descriptor, *cached tells the
+// caller whether to reset-and-keep or to close it
+static iconv_t _iconv_open_cached(const char *to, const char *from, bool *cached)
+{
+	if (strlen(to) < sizeof(iconv_cache->to) && strlen(from) < sizeof(iconv_cache->from)) {
+		unsigned it;
+
+		for (it = 0; it < countof(iconv_cache) && iconv_cache[it].to[0]; it++) {
+			if (!wget_strcasecmp_ascii(iconv_cache[it].to, to)
+				&& !wget_strcasecmp_ascii(iconv_cache[it].from, from))
+			{
+				_iconv_cache_entry_t entry = iconv_cache[it];
+
+				memmove(&iconv_cache[1], &iconv_cache[0], it * sizeof(*iconv_cache));
+				iconv_cache[0] = entry;
+				*cached = true;
+				return entry.cd;
+			}
+		}
+
+		iconv_t cd = iconv_open(to, from);
+
+		if (cd == (iconv_t) -1)
+			return cd;
+
+		if (it == countof(iconv_cache)) { // cache full - evict the least recently used
+			it--;
+			iconv_close(iconv_cache[it].cd);
+		}
+		memmove(&iconv_cache[1], &iconv_cache[0], it * sizeof(*iconv_cache));
+		wget_strscpy(iconv_cache[0].to, to, sizeof(iconv_cache->to));
+		wget_strscpy(iconv_cache[0].from, from, sizeof(iconv_cache->from));
+		iconv_cache[0].cd = cd;
+		*cached = true;
+		return cd;
+	}
+
+	// overlong charset name - don't cache
+	*cached = false;
+	return iconv_open(to, from);
+}
+#endif // HAVE_ICONV_CACHE
+#endif // HAVE_ICONV
+
 // void *wget_memiconv(const void *src, size_t length, const char *src_encoding, const char *dst_encoding)
 int wget_memiconv(const char *src_encoding, const void *src, size_t srclen, const char *dst_encoding, char **out, size_t *outlen)
 {
@@ -80,8 +209,25 @@ int wget_memiconv(const char *src_encoding, const void *src, size_t srclen, cons
 		dst_encoding = "iso-8859-1"; // default character-set for most browsers
 
 	if (wget_strcasecmp_ascii(src_encoding, dst_encoding)) {
+		// pure-ASCII input converts as identity between ASCII supersets -
+		// the usual case for documents that declare a legacy charset
+		if (_charset_maps_ascii_identity(src_encoding) && _charset_maps_ascii_identity(dst_encoding)
+			&& ascii_span(src, srclen) == srclen)
+		{
+			if (out)
+				*out = wget_strmemdup(src, srclen);
+			if (outlen)
+				*outlen = srclen;
+			return 0;
+		}
+
 		int ret = -1;
+		bool cached = false;
+#ifdef HAVE_ICONV_CACHE
+		iconv_t cd = _iconv_open_cached(dst_encoding, src_encoding, &cached);
+#else
 		iconv_t cd = iconv_open(dst_encoding, src_encoding);
+#endif
 
 		if (cd != (iconv_t)-1) {
 			char *tmp = (char *) src; // iconv won't change where src points to, but changes tmp itself
@@ -112,7 +258,10 @@ int wget_memiconv(const char *src_encoding, const void *src, size_t srclen, cons
 					*outlen = 0;
 			}
 
-			iconv_close(cd);
+			if (cached)
+				iconv(cd, NULL, NULL, NULL, NULL); // reset the shift state for the next use
+			else
+				iconv_close(cd);
 		} else
 			error_printf(_("Failed to prepare transcoding '%s' into '%s' (%d)\n"), src_encoding, dst_encoding, errno);
 
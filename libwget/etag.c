@@ -0,0 +1,496 @@
+/*
+ * Copyright(c) 2016 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * ETag / Last-Modified validator cache routines
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include <wget.h>
+#include "private.h"
+
+/**
+ * \file
+ * \brief HTTP validator cache (ETag / Last-Modified) routines
+ * \defgroup libwget-etag HTTP validator cache (ETag / Last-Modified) routines
+ * @{
+ *
+ * A persistent per-URI store of HTTP validators (RFC 7232). Remembering the
+ * `ETag` and `Last-Modified` values of downloaded resources allows making
+ * requests conditional (`If-None-Match` / `If-Modified-Since`) on later runs,
+ * so unchanged resources cost a 304 response instead of a full transfer.
+ */
+
+struct wget_etag_db_st {
+	char *
+		fname;
+	wget_hashmap_t *
+		entries;
+	wget_thread_mutex_t
+		mutex;
+	int64_t
+		load_time;
+};
+
+typedef struct {
+	const char *
+		uri;
+	const char *
+		etag; // value of the ETag response header, including quotes / weakness prefix
+	int64_t
+		last_modified; // value of the Last-Modified response header as epoch seconds
+	int64_t
+		created; // creation time
+} _etag_entry_t;
+
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+static unsigned int G_GNUC_WGET_PURE _hash_etag(const _etag_entry_t *entry)
+{
+	unsigned int hash = 0;
+	const unsigned char *p;
+
+	for (p = (unsigned char *)entry->uri; *p; p++)
+		hash = hash * 101 + *p;
+
+	return hash;
+}
+
+static int G_GNUC_WGET_NONNULL_ALL G_GNUC_WGET_PURE _compare_etag(const _etag_entry_t *e1, const _etag_entry_t *e2)
+{
+	return strcmp(e1->uri, e2->uri);
+}
+
+static _etag_entry_t *_init_etag(_etag_entry_t *entry)
+{
+	if (!entry)
+		entry = xmalloc(sizeof(_etag_entry_t));
+
+	memset(entry, 0, sizeof(*entry));
+	entry->created = time(NULL);
+
+	return entry;
+}
+
+static void _deinit_etag(_etag_entry_t *entry)
+{
+	if (entry) {
+		xfree(entry->uri);
+		xfree(entry->etag);
+	}
+}
+
+static void _free_etag(_etag_entry_t *entry)
+{
+	if (entry) {
+		_deinit_etag(entry);
+		xfree(entry);
+	}
+}
+
+static _etag_entry_t *_new_etag(const char *uri, const char *etag, int64_t last_modified)
+{
+	_etag_entry_t *entry = _init_etag(NULL);
+
+	entry->uri = wget_strdup(uri);
+	entry->etag = wget_strdup(etag);
+
+	if (last_modified < 0 || last_modified >= INT64_MAX / 2)
+		entry->last_modified = 0;
+	else
+		entry->last_modified = last_modified;
+
+	return entry;
+}
+
+static void _etag_db_add_entry(wget_etag_db_t *etag_db, _etag_entry_t *entry)
+{
+	wget_thread_mutex_lock(&etag_db->mutex);
+
+	if (!entry->etag && !entry->last_modified) {
+		if (wget_hashmap_remove(etag_db->entries, entry))
+			debug_printf("removed validators for %s\n", entry->uri);
+		_free_etag(entry);
+		entry = NULL;
+	} else {
+		_etag_entry_t *old = wget_hashmap_get(etag_db->entries, entry);
+
+		if (old) {
+			if (old->created < entry->created) {
+				old->created = entry->created;
+				old->last_modified = entry->last_modified;
+				xfree(old->etag);
+				old->etag = entry->etag;
+				entry->etag = NULL;
+				debug_printf("update validators for %s\n", old->uri);
+			}
+			_free_etag(entry);
+			entry = NULL;
+		} else {
+			// key and value are the same to make wget_hashmap_get() return old entry
+			// debug_printf("add validators for %s\n", entry->uri);
+			wget_hashmap_put_noalloc(etag_db->entries, entry, entry);
+			// no need to free anything here
+		}
+	}
+
+	wget_thread_mutex_unlock(&etag_db->mutex);
+}
+
+/**
+ * \param[in] etag_db An ETag database
+ * \param[in] uri URI the validators belong to
+ * \param[in] etag Value of the `ETag` response header, or NULL
+ * \param[in] last_modified Value of the `Last-Modified` response header as epoch seconds, or 0
+ *
+ * Add the validators of a downloaded resource to the database. Any existing entry for `uri`
+ * is replaced. If both `etag` is NULL and `last_modified` is 0, an existing entry is removed.
+ *
+ * This function is thread-safe and can be called from multiple threads concurrently.
+ */
+void wget_etag_db_add(wget_etag_db_t *etag_db, const char *uri, const char *etag, int64_t last_modified)
+{
+	if (!etag_db || !uri)
+		return;
+
+	_etag_db_add_entry(etag_db, _new_etag(uri, etag, last_modified));
+}
+
+/**
+ * \param[in] etag_db An ETag database
+ * \param[in] uri URI to search for
+ * \param[out] etag Stored `ETag` value, allocated (free with wget_free()), or NULL if none is known
+ * \param[out] last_modified Stored `Last-Modified` value as epoch seconds, 0 if none is known
+ * \return 1 if validators for `uri` were found, 0 if not
+ *
+ * Look up the stored validators for a given URI, e.g. to construct
+ * `If-None-Match` / `If-Modified-Since` request headers.
+ *
+ * This function is thread-safe and can be called from multiple threads concurrently.
+ */
+int wget_etag_db_get(wget_etag_db_t *etag_db, const char *uri, char **etag, int64_t *last_modified)
+{
+	_etag_entry_t key, *entry;
+	int found = 0;
+
+	if (etag)
+		*etag = NULL;
+	if (last_modified)
+		*last_modified = 0;
+
+	if (!etag_db || !uri)
+		return 0;
+
+	key.uri = uri;
+
+	wget_thread_mutex_lock(&etag_db->mutex);
+
+	if ((entry = wget_hashmap_get(etag_db->entries, &key))) {
+		if (etag)
+			*etag = wget_strdup(entry->etag);
+		if (last_modified)
+			*last_modified = entry->last_modified;
+		found = 1;
+	}
+
+	wget_thread_mutex_unlock(&etag_db->mutex);
+
+	return found;
+}
+
+/**
+ * \param[in] etag_db An ETag database
+ * \param[in] uri URI to search for
+ * \return Time the validators for `uri` were stored as epoch seconds, 0 if `uri` is unknown
+ *
+ * Look up when the validators for a given URI were last stored. This allows
+ * freshness policies that skip recently validated resources without any request.
+ *
+ * This function is thread-safe and can be called from multiple threads concurrently.
+ */
+int64_t wget_etag_db_created(wget_etag_db_t *etag_db, const char *uri)
+{
+	_etag_entry_t key, *entry;
+	int64_t created = 0;
+
+	if (!etag_db || !uri)
+		return 0;
+
+	key.uri = uri;
+
+	wget_thread_mutex_lock(&etag_db->mutex);
+
+	if ((entry = wget_hashmap_get(etag_db->entries, &key)))
+		created = entry->created;
+
+	wget_thread_mutex_unlock(&etag_db->mutex);
+
+	return created;
+}
+
+static int _etag_db_load(wget_etag_db_t *etag_db, FILE *fp)
+{
+	_etag_entry_t entry;
+	struct stat st;
+	char *buf = NULL, *linep, *p;
+	size_t bufsize = 0;
+	ssize_t buflen;
+	int ok;
+
+	// if the database file hasn't changed since the last read
+	// there's no need to reload
+
+	if (fstat(fileno(fp), &st) == 0) {
+		if (st.st_mtime != etag_db->load_time)
+			etag_db->load_time = st.st_mtime;
+		else
+			return 0;
+	}
+
+	while ((buflen = wget_getline(&buf, &bufsize, fp)) >= 0) {
+		linep = buf;
+
+		while (isspace(*linep)) linep++; // ignore leading whitespace
+		if (!*linep) continue; // skip empty lines
+
+		if (*linep == '#')
+			continue; // skip comments
+
+		// strip off \r\n
+		while (buflen > 0 && (buf[buflen] == '\n' || buf[buflen] == '\r'))
+			buf[--buflen] = 0;
+
+		_init_etag(&entry);
+		ok = 0;
+
+		// parse URI
+		if (*linep) {
+			for (p = linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.uri = wget_strmemdup(p, linep - p);
+		}
+
+		// parse creation time
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.created = atoll(p);
+			if (entry.created < 0 || entry.created >= INT64_MAX / 2)
+				entry.created = 0;
+		}
+
+		// parse Last-Modified time
+		if (*linep) {
+			for (p = ++linep; *linep && !isspace(*linep); )
+				linep++;
+			entry.last_modified = atoll(p);
+			if (entry.last_modified < 0 || entry.last_modified >= INT64_MAX / 2)
+				entry.last_modified = 0;
+			ok = 1;
+		}
+
+		// the rest of the line is the ETag value (it may contain spaces)
+		if (*linep && linep[1])
+			entry.etag = wget_strdup(linep + 1);
+
+		if (ok && (entry.etag || entry.last_modified)) {
+			_etag_db_add_entry(etag_db, wget_memdup(&entry, sizeof(entry)));
+		} else {
+			_deinit_etag(&entry);
+			error_printf(_("Failed to parse ETag line: '%s'\n"), buf);
+		}
+	}
+
+	xfree(buf);
+
+	if (ferror(fp)) {
+		etag_db->load_time = 0; // reload on next call to this function
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \param[in] etag_db An ETag database
+ * \return 0 if the operation succeeded, -1 in case of error
+ *
+ * Loads the database entries from the file specified in the `fname` parameter of wget_etag_db_init().
+ *
+ * If `etag_db` is NULL this function does nothing and returns 0.
+ */
+// Load the ETag cache from a flat file
+// Protected by flock()
+int wget_etag_db_load(wget_etag_db_t *etag_db)
+{
+	if (!etag_db || !etag_db->fname || !*etag_db->fname)
+		return 0;
+
+	if (wget_update_file(etag_db->fname, (wget_update_load_t) _etag_db_load, NULL, etag_db)) {
+		error_printf(_("Failed to read ETag data\n"));
+		return -1;
+	} else {
+		debug_printf(_("Fetched ETag data from '%s'\n"), etag_db->fname);
+		return 0;
+	}
+}
+
+static int G_GNUC_WGET_NONNULL((1)) _etag_save(FILE *fp, const _etag_entry_t *entry)
+{
+	fprintf(fp, "%s %lld %lld %s\n", entry->uri, (long long)entry->created, (long long)entry->last_modified, entry->etag ? entry->etag : "");
+	return 0;
+}
+
+static int _etag_db_save(void *etag_db, FILE *fp)
+{
+	wget_hashmap_t *entries = ((wget_etag_db_t *) etag_db)->entries;
+
+	if (wget_hashmap_size(entries) > 0) {
+		fputs("#ETag 1.0 file\n", fp);
+		fputs("#Generated by Wget2 " PACKAGE_VERSION ". Edit at your own risk.\n", fp);
+		fputs("# <uri> <created> <last-modified> <etag>\n", fp);
+
+		wget_hashmap_browse(entries, (wget_hashmap_browse_t) _etag_save, fp);
+
+		if (ferror(fp))
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * \param[in] etag_db An ETag database
+ * \return 0 if the operation succeeded, -1 otherwise
+ *
+ * Saves all changes to the database (via wget_etag_db_add() for example) into the file specified
+ * by the `fname` parameter of wget_etag_db_init().
+ *
+ * If `etag_db` is NULL this function does nothing and returns -1.
+ */
+// Save the ETag cache to a flat file
+// Protected by flock()
+int wget_etag_db_save(wget_etag_db_t *etag_db)
+{
+	int size;
+
+	if (!etag_db || !etag_db->fname || !*etag_db->fname)
+		return -1;
+
+	if (wget_update_file(etag_db->fname, (wget_update_load_t) _etag_db_load, _etag_db_save, etag_db)) {
+		error_printf(_("Failed to write ETag file '%s'\n"), etag_db->fname);
+		return -1;
+	}
+
+	if ((size = wget_hashmap_size(etag_db->entries)))
+		debug_printf(_("Saved %d ETag entr%s into '%s'\n"), size, size != 1 ? "ies" : "y", etag_db->fname);
+	else
+		debug_printf(_("No ETag entries to save. Table is empty.\n"));
+
+	return 0;
+}
+
+/**
+ * \param[in] etag_db ETag database created by wget_etag_db_init()
+ *
+ * Frees all resources allocated for the ETag database, except for the structure itself.
+ * The `etag_db` pointer can then be passed to wget_etag_db_init() for reinitialization.
+ *
+ * If `etag_db` is NULL this function does nothing.
+ */
+void wget_etag_db_deinit(wget_etag_db_t *etag_db)
+{
+	if (etag_db) {
+		xfree(etag_db->fname);
+		wget_thread_mutex_lock(&etag_db->mutex);
+		wget_hashmap_free(&etag_db->entries);
+		wget_thread_mutex_unlock(&etag_db->mutex);
+	}
+}
+
+/**
+ * \param[in] etag_db Pointer to the ETag database handle (will be set to NULL)
+ *
+ * Frees all resources allocated for the ETag database.
+ *
+ * If `etag_db` or the pointer it points to is NULL, then the function does nothing.
+ *
+ * Newly added entries will be lost unless committed to persistent storage using wget_etag_db_save().
+ */
+void wget_etag_db_free(wget_etag_db_t **etag_db)
+{
+	if (etag_db && *etag_db) {
+		wget_etag_db_deinit(*etag_db);
+		xfree(*etag_db);
+	}
+}
+
+/**
+ * \param[in] etag_db Previously created ETag database on which wget_etag_db_deinit() has been called, or NULL
+ * \param[in] fname The file where the data is stored, or NULL
+ * \return A new wget_etag_db_t
+ *
+ * Constructor for the ETag database.
+ *
+ * This function does no file IO, data is read only when wget_etag_db_load() is called.
+ */
+wget_etag_db_t *wget_etag_db_init(wget_etag_db_t *etag_db, const char *fname)
+{
+	if (!etag_db)
+		etag_db = xmalloc(sizeof(wget_etag_db_t));
+
+	memset(etag_db, 0, sizeof(*etag_db));
+	if (fname)
+		etag_db->fname = wget_strdup(fname);
+	etag_db->entries = wget_hashmap_create(16, (wget_hashmap_hash_t)_hash_etag, (wget_hashmap_compare_t)_compare_etag);
+	wget_hashmap_set_key_destructor(etag_db->entries, (wget_hashmap_key_destructor_t)_free_etag);
+	wget_hashmap_set_value_destructor(etag_db->entries, (wget_hashmap_value_destructor_t)_free_etag);
+	wget_thread_mutex_init_adaptive(&etag_db->mutex);
+
+	return etag_db;
+}
+
+/**
+ * \param[in] etag_db ETag database created by wget_etag_db_init()
+ * \param[in] fname Filename where the database should be stored, or NULL
+ *
+ * Changes the file where ETag database entries are stored.
+ *
+ * This function does no file IO, data is read or written only when wget_etag_db_load()
+ * or wget_etag_db_save() is called.
+ */
+void wget_etag_db_set_fname(wget_etag_db_t *etag_db, const char *fname)
+{
+	xfree(etag_db->fname);
+	if (fname)
+		etag_db->fname = wget_strdup(fname);
+}
+
+/**@}*/
@@ -65,6 +65,10 @@
  * md5|WGET_DIGTYPE_MD5
  * md2|WGET_DIGTYPE_MD2
  * rmd160|WGET_DIGTYPE_RMD160
+ * tree-sha256 or treesha256|WGET_DIGTYPE_TREE_SHA256
+ *
+ * tree-sha256 is a file-level algorithm (see wget_hash_file_fd()) that hashes
+ * fixed-size leaves in parallel and combines the leaf digests into a root hash.
  */
 wget_digest_algorithm_t wget_hash_get_algorithm(const char *hashname)
 {
@@ -87,6 +91,8 @@ wget_digest_algorithm_t wget_hash_get_algorithm(const char *hashname)
 			return WGET_DIGTYPE_MD2;
 		else if (!wget_strcasecmp_ascii(hashname, "rmd160"))
 			return WGET_DIGTYPE_RMD160;
+		else if (!wget_strcasecmp_ascii(hashname, "tree-sha256") || !wget_strcasecmp_ascii(hashname, "treesha256"))
+			return WGET_DIGTYPE_TREE_SHA256;
 	}
 
 	error_printf(_("Unknown hash type '%s'\n"), hashname);
@@ -501,6 +507,160 @@ void wget_hash_deinit(wget_hash_hd_t *dig, void *digest)
 }
 #endif
 
+// Tree hashing (tree-sha256): the file is split into fixed-size leaves that
+// are hashed independently - and therefore in parallel across cores - and
+// the root digest is the hash of all leaf digests plus the total length.
+// The leaves use whatever SHA256 the configured crypto backend provides, so
+// per-block SIMD acceleration comes from there. One big file keeps all
+// cores busy instead of one, which matters once the network outruns a
+// single core's hash throughput.
+
+#define TREE_HASH_LEAF_SIZE (1 << 20)
+#define TREE_HASH_MAX_THREADS 8
+#define TREE_HASH_DIGEST_LEN 32 // SHA256
+
+struct _tree_hash_work {
+	const char
+		*data; // the whole region to hash
+	off_t
+		length;
+	unsigned char
+		*digests; // one leaf digest per leaf, in leaf order
+	off_t
+		nleaves;
+	int
+		id, // this worker's index ...
+		nworkers, // ... worker i hashes leaves i, i+n, i+2n, ...
+		failed;
+};
+
+static void *_tree_hash_worker(void *p)
+{
+	struct _tree_hash_work *work = p;
+
+	for (off_t leaf = work->id; leaf < work->nleaves; leaf += work->nworkers) {
+		off_t pos = leaf * (off_t) TREE_HASH_LEAF_SIZE;
+		size_t n = work->length - pos < TREE_HASH_LEAF_SIZE ? (size_t) (work->length - pos) : TREE_HASH_LEAF_SIZE;
+
+		if (wget_hash_fast(WGET_DIGTYPE_SHA256, work->data + pos, n, work->digests + leaf * TREE_HASH_DIGEST_LEN)) {
+			work->failed = 1;
+			return NULL;
+		}
+	}
+
+	return NULL;
+}
+
+// root digest over the leaf digests and the total length - the length
+// suffix keeps regions that differ only in leaf count from colliding
+static int _tree_hash_root(const unsigned char *digests, off_t nleaves, off_t length, unsigned char *digest)
+{
+	unsigned char length_le[8];
+	wget_hash_hd_t dig;
+
+	for (unsigned it = 0; it < sizeof(length_le); it++)
+		length_le[it] = (unsigned char) (length >> (8 * it));
+
+	if (wget_hash_init(&dig, WGET_DIGTYPE_SHA256))
+		return -1;
+	wget_hash(&dig, digests, nleaves * TREE_HASH_DIGEST_LEN);
+	wget_hash(&dig, length_le, sizeof(length_le));
+	wget_hash_deinit(&dig, digest);
+
+	return 0;
+}
+
+// hash an in-memory region leaf-parallel, digest gets TREE_HASH_DIGEST_LEN bytes
+static int _tree_hash_region(const char *data, off_t length, unsigned char *digest)
+{
+	off_t nleaves = (length + TREE_HASH_LEAF_SIZE - 1) / TREE_HASH_LEAF_SIZE;
+	unsigned char *digests = wget_malloc(nleaves * TREE_HASH_DIGEST_LEN + 1);
+	int nworkers = 1, rc = 0;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	long ncores = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncores > 1)
+		nworkers = ncores < TREE_HASH_MAX_THREADS ? (int) ncores : TREE_HASH_MAX_THREADS;
+#endif
+	if ((off_t) nworkers > nleaves)
+		nworkers = (int) (nleaves > 0 ? nleaves : 1);
+
+	if (nworkers > 1) {
+		struct _tree_hash_work work[TREE_HASH_MAX_THREADS];
+		wget_thread_t tid[TREE_HASH_MAX_THREADS];
+
+		for (int it = 0; it < nworkers; it++) {
+			work[it] = (struct _tree_hash_work) {
+				.data = data, .length = length, .digests = digests,
+				.nleaves = nleaves, .id = it, .nworkers = nworkers
+			};
+			if (wget_thread_start(&tid[it], _tree_hash_worker, &work[it], 0) != 0) {
+				tid[it] = 0;
+				_tree_hash_worker(&work[it]); // no thread - hash this share inline
+			}
+		}
+
+		for (int it = 0; it < nworkers; it++) {
+			if (tid[it])
+				wget_thread_join(tid[it]);
+			if (work[it].failed)
+				rc = -1;
+		}
+	} else {
+		struct _tree_hash_work work = {
+			.data = data, .length = length, .digests = digests,
+			.nleaves = nleaves, .id = 0, .nworkers = 1
+		};
+
+		_tree_hash_worker(&work);
+		if (work.failed)
+			rc = -1;
+	}
+
+	if (rc == 0)
+		rc = _tree_hash_root(digests, nleaves, length, digest);
+
+	xfree(digests);
+	return rc;
+}
+
+// sequential fallback when the file cannot be mapped
+static int _tree_hash_fd(int fd, off_t offset, off_t length, unsigned char *digest)
+{
+	off_t nleaves = (length + TREE_HASH_LEAF_SIZE - 1) / TREE_HASH_LEAF_SIZE;
+	unsigned char *digests = wget_malloc(nleaves * TREE_HASH_DIGEST_LEN + 1);
+	char *buf = wget_malloc(TREE_HASH_LEAF_SIZE);
+	int rc = 0;
+
+	if (lseek(fd, offset, SEEK_SET) == (off_t) -1)
+		rc = -1;
+
+	for (off_t leaf = 0; rc == 0 && leaf < nleaves; leaf++) {
+		off_t pos = leaf * (off_t) TREE_HASH_LEAF_SIZE;
+		size_t n = length - pos < TREE_HASH_LEAF_SIZE ? (size_t) (length - pos) : TREE_HASH_LEAF_SIZE;
+
+		for (size_t nread = 0; rc == 0 && nread < n; ) {
+			ssize_t nbytes = read(fd, buf + nread, n - nread);
+
+			if (nbytes <= 0)
+				rc = -1;
+			else
+				nread += nbytes;
+		}
+
+		if (rc == 0 && wget_hash_fast(WGET_DIGTYPE_SHA256, buf, n, digests + leaf * TREE_HASH_DIGEST_LEN))
+			rc = -1;
+	}
+
+	if (rc == 0)
+		rc = _tree_hash_root(digests, nleaves, length, digest);
+
+	xfree(buf);
+	xfree(digests);
+	return rc;
+}
+
 /**
  * \param[in] hashname Name of the hashing algorithm. See wget_hash_get_algorithm()
  * \param[in] fd File descriptor for the target file
@@ -535,18 +695,53 @@ int wget_hash_file_fd(const char *hashname, int fd, char *digest_hex, size_t dig
 
 	debug_printf("%s hashing pos %llu, length %llu...\n", hashname, (unsigned long long)offset, (unsigned long long)length);
 
-	if ((algorithm = wget_hash_get_algorithm(hashname)) != WGET_DIGTYPE_UNKNOWN) {
+	algorithm = wget_hash_get_algorithm(hashname);
+
+	if (algorithm == WGET_DIGTYPE_TREE_SHA256) {
+		unsigned char digest[TREE_HASH_DIGEST_LEN];
+		int rc = -1;
+
+#ifdef HAVE_MMAP
+		off_t delta = offset % sysconf(_SC_PAGESIZE);
+		char *buf = mmap(NULL, length + delta, PROT_READ, MAP_PRIVATE, fd, offset - delta);
+
+		if (buf != MAP_FAILED) {
+			// no MADV_SEQUENTIAL here - the workers walk the mapping at
+			// several positions at once, readahead would fight them
+			rc = _tree_hash_region(buf + delta, length, digest);
+			munmap(buf, length + delta);
+		} else
+#endif
+			rc = _tree_hash_fd(fd, offset, length, digest);
+
+		if (rc == 0) {
+			wget_memtohex(digest, sizeof(digest), digest_hex, digest_hex_size);
+			ret = 0;
+		}
+
+		return ret;
+	}
+
+	if (algorithm != WGET_DIGTYPE_UNKNOWN) {
 		unsigned char digest[wget_hash_get_len(algorithm)];
 
 #ifdef HAVE_MMAP
-		char *buf = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, offset);
+		// piece offsets are rarely page-aligned, so map from the aligned
+		// base and hash at the right delta - else mmap() refuses the offset
+		off_t delta = offset % sysconf(_SC_PAGESIZE);
+		char *buf = mmap(NULL, length + delta, PROT_READ, MAP_PRIVATE, fd, offset - delta);
 
 		if (buf != MAP_FAILED) {
-			if (wget_hash_fast(algorithm, buf, length, digest) == 0) {
+#ifdef MADV_SEQUENTIAL
+			// we run over the mapping exactly once - tell the kernel to
+			// read ahead aggressively and drop the pages behind us
+			madvise(buf, length + delta, MADV_SEQUENTIAL);
+#endif
+			if (wget_hash_fast(algorithm, buf + delta, length, digest) == 0) {
 				wget_memtohex(digest, sizeof(digest), digest_hex, digest_hex_size);
 				ret = 0;
 			}
-			munmap(buf, length);
+			munmap(buf, length + delta);
 		} else {
 #endif
 			// Fallback to read
@@ -554,6 +749,9 @@ int wget_hash_file_fd(const char *hashname, int fd, char *digest_hex, size_t dig
 			wget_hash_hd_t dig;
 			char tmp[65536];
 
+			if (lseek(fd, offset, SEEK_SET) == (off_t) -1)
+				return -1;
+
 			wget_hash_init(&dig, algorithm);
 			while (length > 0 && (nbytes = read(fd, tmp, sizeof(tmp))) > 0) {
 				wget_hash(&dig, tmp, nbytes);
@@ -47,6 +47,29 @@ struct _ENTRY {
 		hash;
 };
 
+// slot of the open-addressing (linear probing / robin hood) variant,
+// stored inline in one flat array - no pointer chasing, no malloc per insert
+typedef struct {
+	void
+		*key,
+		*value;
+	unsigned int
+		hash;
+	unsigned int
+		dist; // probe distance + 1, 0 = empty slot
+} SLOT;
+
+// bump-allocator chunk for key storage, the payload follows the header
+typedef struct _ARENA_CHUNK ARENA_CHUNK;
+
+struct _ARENA_CHUNK {
+	ARENA_CHUNK
+		*next;
+	size_t
+		used,
+		size;
+};
+
 struct _wget_hashmap_st {
 	wget_hashmap_hash_t
 		hash; // hash function
@@ -57,7 +80,13 @@ struct _wget_hashmap_st {
 	wget_hashmap_value_destructor_t
 		value_destructor; // value destructor function
 	ENTRY
-		**entry; // pointer to array of pointers to entries
+		**entry; // pointer to array of pointers to entries (chained variant)
+	SLOT
+		*slot; // flat slot array (open-addressing variant)
+	ARENA_CHUNK
+		*key_arena; // if set, wget_hashmap_put() bump-allocates key copies here
+	size_t
+		key_arena_chunk_size;
 	int
 		max,     // allocated entries
 		cur,     // number of entries in use
@@ -76,6 +105,35 @@ wget_hashmap_t *wget_hashmap_create(int max, wget_hashmap_hash_t hash, wget_hash
 	wget_hashmap_t *h = xmalloc(sizeof(wget_hashmap_t));
 
 	h->entry = xcalloc(max, sizeof(ENTRY *));
+	h->slot = NULL;
+	h->key_arena = NULL;
+	h->key_arena_chunk_size = 0;
+	h->max = max;
+	h->cur = 0;
+	h->off = -2;
+	h->hash = hash;
+	h->cmp = cmp;
+	h->key_destructor = free;
+	h->value_destructor = free;
+	h->factor = 0.75;
+	h->threshold = (int)(max * h->factor);
+
+	return h;
+}
+
+// create an open-addressing hashmap (linear probing with robin hood displacement)
+// same API and semantics as the chained variant, but entries live inline in one
+// flat array with their hashes: probing is sequential memory access and inserting
+// doesn't malloc
+
+wget_hashmap_t *wget_hashmap_create_linear(int max, wget_hashmap_hash_t hash, wget_hashmap_compare_t cmp)
+{
+	wget_hashmap_t *h = xmalloc(sizeof(wget_hashmap_t));
+
+	h->entry = NULL;
+	h->slot = xcalloc(max, sizeof(SLOT));
+	h->key_arena = NULL;
+	h->key_arena_chunk_size = 0;
 	h->max = max;
 	h->cur = 0;
 	h->off = -2;
@@ -97,6 +155,53 @@ void wget_hashmap_set_growth_policy(wget_hashmap_t *h, int off)
 	h->off = off;
 }
 
+// let wget_hashmap_put() bump-allocate its key copies from arena chunks of
+// <chunk_size> bytes instead of one malloc per key.
+// Keys then live until wget_hashmap_clear()/wget_hashmap_free() - removing or
+// replacing an entry doesn't give its key memory back. The key destructor is
+// disabled, a value destructor stays in effect.
+
+void wget_hashmap_use_key_arena(wget_hashmap_t *h, size_t chunk_size)
+{
+	if (h) {
+		h->key_arena_chunk_size = chunk_size ? chunk_size : 16 * 1024;
+		h->key_destructor = NULL;
+	}
+}
+
+static void *hashmap_arena_memdup(wget_hashmap_t *h, const void *key, size_t keysize)
+{
+	ARENA_CHUNK *chunk = h->key_arena;
+	char *p;
+
+	if (!chunk || chunk->size - chunk->used < keysize) {
+		size_t size = keysize > h->key_arena_chunk_size ? keysize : h->key_arena_chunk_size;
+
+		chunk = xmalloc(sizeof(ARENA_CHUNK) + size);
+		chunk->next = h->key_arena;
+		chunk->used = 0;
+		chunk->size = size;
+		h->key_arena = chunk;
+	}
+
+	p = (char *) (chunk + 1) + chunk->used;
+	chunk->used += keysize;
+
+	return memcpy(p, key, keysize);
+}
+
+static void hashmap_free_arena(wget_hashmap_t *h)
+{
+	ARENA_CHUNK *chunk, *next;
+
+	for (chunk = h->key_arena; chunk; chunk = next) {
+		next = chunk->next;
+		xfree(chunk);
+	}
+
+	h->key_arena = NULL;
+}
+
 static _GL_INLINE ENTRY * G_GNUC_WGET_NONNULL_ALL hashmap_find_entry(const wget_hashmap_t *h, const char *key, unsigned int hash, int pos)
 {
 	ENTRY *e;
@@ -114,6 +219,88 @@ static _GL_INLINE ENTRY * G_GNUC_WGET_NONNULL_ALL hashmap_find_entry(const wget_
 	return NULL;
 }
 
+// find the slot index for <key>, -1 if not found
+// the robin hood invariant allows stopping as soon as we hit a slot
+// with a smaller probe distance than our own
+
+static _GL_INLINE int G_GNUC_WGET_NONNULL_ALL hashmap_find_slot(const wget_hashmap_t *h, const char *key, unsigned int hash)
+{
+	int pos = hash % h->max;
+	unsigned int dist = 1;
+
+	while (h->slot[pos].dist >= dist) {
+		if (hash == h->slot[pos].hash && (key == h->slot[pos].key || !h->cmp(key, h->slot[pos].key)))
+			return pos;
+
+		dist++;
+		if (++pos == h->max)
+			pos = 0;
+	}
+
+	return -1;
+}
+
+// insert without looking for an existing entry - the caller did that already
+// robin hood: displace entries that sit closer to their home slot than we do
+
+static void G_GNUC_WGET_NONNULL((1)) hashmap_insert_slot(wget_hashmap_t *h, unsigned int hash, const char *key, const char *value)
+{
+	SLOT cur = { .key = (void *) key, .value = (void *) value, .hash = hash, .dist = 1 };
+	int pos = hash % h->max;
+
+	while (h->slot[pos].dist) {
+		if (h->slot[pos].dist < cur.dist) {
+			SLOT tmp = h->slot[pos];
+			h->slot[pos] = cur;
+			cur = tmp;
+		}
+
+		cur.dist++;
+		if (++pos == h->max)
+			pos = 0;
+	}
+
+	h->slot[pos] = cur;
+}
+
+static void G_GNUC_WGET_NONNULL_ALL hashmap_rehash_slots(wget_hashmap_t *h, int newmax, int recalc_hash)
+{
+	SLOT *old_slot = h->slot;
+	int oldmax = h->max;
+
+	h->slot = xcalloc(newmax, sizeof(SLOT));
+	h->max = newmax;
+	h->threshold = (int)(newmax * h->factor);
+
+	for (int it = 0; it < oldmax; it++) {
+		if (old_slot[it].dist) {
+			if (recalc_hash)
+				old_slot[it].hash = h->hash(old_slot[it].key);
+			hashmap_insert_slot(h, old_slot[it].hash, old_slot[it].key, old_slot[it].value);
+		}
+	}
+
+	xfree(old_slot);
+}
+
+// backward-shift deletion keeps probe distances minimal without tombstones
+
+static void G_GNUC_WGET_NONNULL_ALL hashmap_remove_slot(wget_hashmap_t *h, int pos)
+{
+	int next = pos + 1 == h->max ? 0 : pos + 1;
+
+	while (h->slot[next].dist > 1) {
+		h->slot[pos] = h->slot[next];
+		h->slot[pos].dist--;
+		pos = next;
+		next = pos + 1 == h->max ? 0 : pos + 1;
+	}
+
+	h->slot[pos].dist = 0;
+	h->slot[pos].key = NULL;
+	h->slot[pos].value = NULL;
+}
+
 static void G_GNUC_WGET_NONNULL_ALL hashmap_rehash(wget_hashmap_t *h, int newmax, int recalc_hash)
 {
 	ENTRY **new_entry, *entry, *next;
@@ -147,6 +334,21 @@ static void G_GNUC_WGET_NONNULL_ALL hashmap_rehash(wget_hashmap_t *h, int newmax
 
 static _GL_INLINE void G_GNUC_WGET_NONNULL((1,3)) hashmap_new_entry(wget_hashmap_t *h, unsigned int hash, const char *key, const char *value)
 {
+	if (h->slot) {
+		hashmap_insert_slot(h, hash, key, value);
+
+		if (++h->cur >= h->threshold || h->cur >= h->max - 1) {
+			if (h->off > 0) {
+				hashmap_rehash_slots(h, h->max + h->off, 0);
+			} else {
+				// open addressing must never run full - grow even without explicit policy
+				hashmap_rehash_slots(h, h->max * (h->off < -1 ? -h->off : 2), 0);
+			}
+		}
+
+		return;
+	}
+
 	ENTRY *entry;
 	int pos = hash % h->max;
 
@@ -171,26 +373,51 @@ static _GL_INLINE void G_GNUC_WGET_NONNULL((1,3)) hashmap_new_entry(wget_hashmap
 // return:
 //  0: new entry
 //  1: existing entry has been replaced
+// find pointers to the stored key and value of <key>, regardless of the variant
+// returns 0 if not found
+
+static _GL_INLINE int G_GNUC_WGET_NONNULL_ALL hashmap_find_kv(const wget_hashmap_t *h, const char *key, unsigned int hash, void ***keyp, void ***valuep)
+{
+	if (h->slot) {
+		int pos = hashmap_find_slot(h, key, hash);
+
+		if (pos == -1)
+			return 0;
+
+		*keyp = &h->slot[pos].key;
+		*valuep = &h->slot[pos].value;
+	} else {
+		ENTRY *entry = hashmap_find_entry(h, key, hash, hash % h->max);
+
+		if (!entry)
+			return 0;
+
+		*keyp = &entry->key;
+		*valuep = &entry->value;
+	}
+
+	return 1;
+}
+
 int wget_hashmap_put_noalloc(wget_hashmap_t *h, const void *key, const void *value)
 {
-	ENTRY *entry;
 	unsigned int hash = h->hash(key);
-	int pos = hash % h->max;
+	void **keyp, **valuep;
 
-	if ((entry = hashmap_find_entry(h, key, hash, pos))) {
-		if (entry->key != key && entry->key != value) {
+	if (hashmap_find_kv(h, key, hash, &keyp, &valuep)) {
+		if (*keyp != key && *keyp != value) {
 			if (h->key_destructor)
-				h->key_destructor(entry->key);
-			if (entry->key == entry->value)
-				entry->value = NULL;
+				h->key_destructor(*keyp);
+			if (*keyp == *valuep)
+				*valuep = NULL;
 		}
-		if (entry->value != value && entry->value != key) {
+		if (*valuep != value && *valuep != key) {
 			if (h->value_destructor)
-				h->value_destructor(entry->value);
+				h->value_destructor(*valuep);
 		}
 
-		entry->key = (void *) key;
-		entry->value = (void *) value;
+		*keyp = (void *) key;
+		*valuep = (void *) value;
 
 		return 1;
 	}
@@ -203,45 +430,45 @@ int wget_hashmap_put_noalloc(wget_hashmap_t *h, const void *key, const void *val
 
 int wget_hashmap_put(wget_hashmap_t *h, const void *key, size_t keysize, const void *value, size_t valuesize)
 {
-	ENTRY *entry;
 	unsigned int hash = h->hash(key);
-	int pos = hash % h->max;
+	void **keyp, **valuep;
 
-	if ((entry = hashmap_find_entry(h, key, hash, pos))) {
+	if (hashmap_find_kv(h, key, hash, &keyp, &valuep)) {
 		if (h->value_destructor)
-			h->value_destructor(entry->value);
+			h->value_destructor(*valuep);
 
-		entry->value = wget_memdup(value, valuesize);
+		*valuep = wget_memdup(value, valuesize);
 
 		return 1;
 	}
 
 	// a new entry
-	hashmap_new_entry(h, hash, wget_memdup(key, keysize), wget_memdup(value, valuesize));
+	if (h->key_arena_chunk_size)
+		hashmap_new_entry(h, hash, hashmap_arena_memdup(h, key, keysize), wget_memdup(value, valuesize));
+	else
+		hashmap_new_entry(h, hash, wget_memdup(key, keysize), wget_memdup(value, valuesize));
 
 	return 0;
 }
 
 void *wget_hashmap_get(const wget_hashmap_t *h, const void *key)
 {
-	ENTRY *entry;
 	unsigned int hash = h->hash(key);
-	int pos = hash % h->max;
+	void **keyp, **valuep;
 
-	if ((entry = hashmap_find_entry(h, key, hash, pos)))
-		return entry->value; // watch out, value may be NULL
+	if (hashmap_find_kv(h, key, hash, &keyp, &valuep))
+		return *valuep; // watch out, value may be NULL
 
 	return NULL;
 }
 
 int wget_hashmap_get_null(const wget_hashmap_t *h, const void *key, void **value)
 {
-	ENTRY *entry;
 	unsigned int hash = h->hash(key);
-	int pos = hash % h->max;
+	void **keyp, **valuep;
 
-	if ((entry = hashmap_find_entry(h, key, hash, pos))) {
-		if (value) *value = entry->value;
+	if (hashmap_find_kv(h, key, hash, &keyp, &valuep)) {
+		if (value) *value = *valuep;
 		return 1;
 	}
 
@@ -251,11 +478,10 @@ int wget_hashmap_get_null(const wget_hashmap_t *h, const void *key, void **value
 int wget_hashmap_contains(const wget_hashmap_t *h, const void *key)
 {
 	if (h) {
-		ENTRY *entry;
 		unsigned int hash = h->hash(key);
-		int pos = hash % h->max;
+		void **keyp, **valuep;
 
-		if ((entry = hashmap_find_entry(h, key, hash, pos)))
+		if (hashmap_find_kv(h, key, hash, &keyp, &valuep))
 			return 1;
 	}
 
@@ -268,6 +494,24 @@ static int G_GNUC_WGET_NONNULL_ALL hashmap_remove_entry(wget_hashmap_t *h, const
 	unsigned int hash = h->hash(key);
 	int pos = hash % h->max;
 
+	if (h->slot) {
+		if ((pos = hashmap_find_slot(h, key, hash)) == -1)
+			return 0;
+
+		if (free_kv) {
+			if (h->key_destructor)
+				h->key_destructor(h->slot[pos].key);
+			if (h->slot[pos].value != h->slot[pos].key) {
+				if (h->value_destructor)
+					h->value_destructor(h->slot[pos].value);
+			}
+		}
+		hashmap_remove_slot(h, pos);
+
+		h->cur--;
+		return 1;
+	}
+
 	for (entry = h->entry[pos]; entry; prev = entry, entry = next) {
 		next = entry->next;
 
@@ -318,6 +562,7 @@ void wget_hashmap_free(wget_hashmap_t **h)
 	if (h && *h) {
 		wget_hashmap_clear(*h);
 		xfree((*h)->entry);
+		xfree((*h)->slot);
 		xfree(*h);
 	}
 }
@@ -328,6 +573,28 @@ void wget_hashmap_clear(wget_hashmap_t *h)
 		ENTRY *entry, *next;
 		int it, cur = h->cur;
 
+		if (h->slot) {
+			for (it = 0; it < h->max && cur; it++) {
+				if (!h->slot[it].dist)
+					continue;
+
+				if (h->key_destructor)
+					h->key_destructor(h->slot[it].key);
+
+				// free value if different from key
+				if (h->slot[it].value != h->slot[it].key && h->value_destructor)
+					h->value_destructor(h->slot[it].value);
+
+				h->slot[it].key = NULL;
+				h->slot[it].value = NULL;
+				h->slot[it].dist = 0;
+				cur--;
+			}
+			h->cur = 0;
+			hashmap_free_arena(h);
+			return;
+		}
+
 		for (it = 0; it < h->max && cur; it++) {
 			for (entry = h->entry[it]; entry; entry = next) {
 				next = entry->next;
@@ -348,6 +615,7 @@ void wget_hashmap_clear(wget_hashmap_t *h)
 			h->entry[it] = NULL;
 		}
 		h->cur = 0;
+		hashmap_free_arena(h);
 	}
 }
 
@@ -362,6 +630,17 @@ int wget_hashmap_browse(const wget_hashmap_t *h, wget_hashmap_browse_t browse, v
 		ENTRY *entry;
 		int it, ret, cur = h->cur;
 
+		if (h->slot) {
+			for (it = 0; it < h->max && cur; it++) {
+				if (h->slot[it].dist) {
+					if ((ret = browse(ctx, h->slot[it].key, h->slot[it].value)) != 0)
+						return ret;
+					cur--;
+				}
+			}
+			return 0;
+		}
+
 		for (it = 0; it < h->max && cur; it++) {
 			for (entry = h->entry[it]; entry; entry = entry->next) {
 				if ((ret = browse(ctx, entry->key, entry->value)) != 0)
@@ -374,6 +653,60 @@ int wget_hashmap_browse(const wget_hashmap_t *h, wget_hashmap_browse_t browse, v
 	return 0;
 }
 
+// capture the current key/value pointers into a compact array:
+// (*entries)[2n] = key, (*entries)[2n+1] = value, to be released with wget_free().
+// This is meant for iterating outside the caller's lock (e.g. writing a db to
+// disk) - only the pointers are copied, the caller must make sure the entries
+// themselves stay valid while it uses the snapshot.
+
+int wget_hashmap_snapshot(const wget_hashmap_t *h, void ***entries)
+{
+	if (!h || !h->cur) {
+		*entries = NULL;
+		return 0;
+	}
+
+	void **p = xmalloc(2 * h->cur * sizeof(void *));
+	int cur = h->cur;
+
+	*entries = p;
+
+	if (h->slot) {
+		for (int it = 0; it < h->max && cur; it++) {
+			if (h->slot[it].dist) {
+				*p++ = h->slot[it].key;
+				*p++ = h->slot[it].value;
+				cur--;
+			}
+		}
+	} else {
+		for (int it = 0; it < h->max && cur; it++) {
+			for (ENTRY *entry = h->entry[it]; entry; entry = entry->next) {
+				*p++ = entry->key;
+				*p++ = entry->value;
+				cur--;
+			}
+		}
+	}
+
+	return h->cur;
+}
+
+// iterate a snapshot taken by wget_hashmap_snapshot(), same callback and
+// early-out semantics as wget_hashmap_browse()
+
+int wget_hashmap_browse_snapshot(void **entries, int count, wget_hashmap_browse_t browse, void *ctx)
+{
+	int ret;
+
+	for (int it = 0; it < count; it++) {
+		if ((ret = browse(ctx, entries[2 * it], entries[2 * it + 1])) != 0)
+			return ret;
+	}
+
+	return 0;
+}
+
 void wget_hashmap_setcmpfunc(wget_hashmap_t *h, wget_hashmap_compare_t cmp)
 {
 	if (h)
@@ -385,7 +718,10 @@ void wget_hashmap_sethashfunc(wget_hashmap_t *h, wget_hashmap_hash_t hash)
 	if (h) {
 		h->hash = hash;
 
-		hashmap_rehash(h, h->max, 1);
+		if (h->slot)
+			hashmap_rehash_slots(h, h->max, 1);
+		else
+			hashmap_rehash(h, h->max, 1);
 	}
 }
 
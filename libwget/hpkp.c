@@ -42,6 +42,8 @@ typedef struct {
 		mutex;
 	int64_t
 		load_time;
+	int64_t
+		generation; // increased on every change, lets callers detect stale pin-check results
 } _hpkp_db_impl_t;
 
 struct _wget_hpkp_st {
@@ -424,6 +426,38 @@ static int impl_hpkp_db_check_pubkey(wget_hpkp_db_t *hpkp_db, const char *host,
 	return -2;
 }
 
+/**
+ * \param[in] hpkp_db An HPKP database
+ * \return The current generation of the database, increased on every change, or -1 if unknown
+ *
+ * Returns a generation counter that is increased whenever an entry is added, updated or
+ * removed. Callers caching pin-check results can compare generations to detect staleness.
+ *
+ * If \p hpkp_db is NULL or the implementation doesn't provide a generation counter,
+ * -1 is returned and callers must not cache pin-check results.
+ *
+ * This function is thread-safe and can be called from multiple threads concurrently.
+ * Any implementation for this function must be thread-safe as well.
+ */
+int64_t wget_hpkp_db_generation(wget_hpkp_db_t *hpkp_db)
+{
+	if (!hpkp_db || !hpkp_db->vtable->generation)
+		return -1;
+
+	return (*hpkp_db->vtable->generation)(hpkp_db);
+}
+static int64_t impl_hpkp_db_generation(wget_hpkp_db_t *hpkp_db)
+{
+	_hpkp_db_impl_t *hpkp_db_priv = (_hpkp_db_impl_t *) hpkp_db;
+	int64_t generation;
+
+	wget_thread_mutex_lock(&hpkp_db_priv->mutex);
+	generation = hpkp_db_priv->generation;
+	wget_thread_mutex_unlock(&hpkp_db_priv->mutex);
+
+	return generation;
+}
+
 /* We 'consume' _hpkp and thus set *_hpkp to NULL, so that the calling function
  * can't access it any more */
 /**
@@ -453,8 +487,10 @@ static void impl_hpkp_db_add(wget_hpkp_db_t *hpkp_db, wget_hpkp_t *hpkp)
 	wget_thread_mutex_lock(&hpkp_db_priv->mutex);
 
 	if (hpkp->maxage == 0 || wget_vector_size(hpkp->pins) == 0) {
-		if (wget_hashmap_remove(hpkp_db_priv->entries, hpkp))
+		if (wget_hashmap_remove(hpkp_db_priv->entries, hpkp)) {
 			debug_printf("removed HPKP %s\n", hpkp->host);
+			hpkp_db_priv->generation++;
+		}
 		wget_hpkp_free(hpkp);
 	} else {
 		wget_hpkp_t *old = wget_hashmap_get(hpkp_db_priv->entries, hpkp);
@@ -468,11 +504,13 @@ static void impl_hpkp_db_add(wget_hpkp_db_t *hpkp_db, wget_hpkp_t *hpkp)
 			old->pins = hpkp->pins;
 			hpkp->pins = NULL;
 			debug_printf("update HPKP %s (maxage=%lld, includeSubDomains=%d)\n", old->host, (long long)old->maxage, old->include_subdomains);
+			hpkp_db_priv->generation++;
 			wget_hpkp_free(hpkp);
 		} else {
 			// key and value are the same to make wget_hashmap_get() return old 'hpkp'
 			/* debug_printf("add HPKP %s (maxage=%lld, includeSubDomains=%d)\n", hpkp->host, (long long)hpkp->maxage, hpkp->include_subdomains); */
 			wget_hashmap_put_noalloc(hpkp_db_priv->entries, hpkp, hpkp);
+			hpkp_db_priv->generation++;
 			// no need to free anything here
 		}
 	}
@@ -690,7 +728,8 @@ static struct wget_hpkp_db_vtable vtable = {
 	.save = impl_hpkp_db_save,
 	.free = impl_hpkp_db_free,
 	.add = impl_hpkp_db_add,
-	.check_pubkey = impl_hpkp_db_check_pubkey
+	.check_pubkey = impl_hpkp_db_check_pubkey,
+	.generation = impl_hpkp_db_generation
 };
 
 /**
@@ -734,7 +773,7 @@ wget_hpkp_db_t *wget_hpkp_db_init(wget_hpkp_db_t *hpkp_db, const char *fname)
 	 * Since the value == key, we just need the value destructor for freeing hashmap entries.
 	 */
 
-	wget_thread_mutex_init(&hpkp_db_priv->mutex);
+	wget_thread_mutex_init_adaptive(&hpkp_db_priv->mutex);
 
 	return (wget_hpkp_db_t *) hpkp_db_priv;
 }
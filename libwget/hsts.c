@@ -55,10 +55,16 @@ typedef struct {
 		fname;
 	wget_hashmap_t *
 		entries;
+	wget_hashmap_t *
+		snapshot; // immutable copy of 'entries', probed lock-free by host_match()
+	wget_vector_t *
+		retired_snapshots; // outdated snapshots, kept until deinit (readers may still probe them)
 	wget_thread_mutex_t
 		mutex;
 	int64_t
 		load_time;
+	bool
+		snapshot_dirty : 1; // set when 'entries' membership changed since the last snapshot rebuild
 } _hsts_db_impl_t;
 
 typedef struct {
@@ -145,6 +151,41 @@ static _hsts_t *_new_hsts(const char *host, uint16_t port, time_t maxage, int in
 	return hsts;
 }
 
+static int G_GNUC_WGET_NONNULL_ALL _snapshot_copy_entry(void *snapshot, const void *key, G_GNUC_WGET_UNUSED void *value)
+{
+	const _hsts_t *hsts = key;
+	_hsts_t *copy = wget_memdup(hsts, sizeof(*hsts));
+
+	copy->host = wget_strdup(hsts->host);
+	wget_hashmap_put_noalloc((wget_hashmap_t *) snapshot, copy, copy);
+
+	return 0;
+}
+
+// Rebuild the read-only snapshot from 'entries'. Must be called with the mutex held.
+// A published snapshot is never modified again (only entry expiry values are
+// refreshed in place), so readers can probe it without any locking. The old
+// snapshot goes into the retired list - a concurrent reader may still hold
+// a pointer to it - and is freed on deinit.
+static void _hsts_db_rebuild_snapshot(_hsts_db_impl_t *hsts_db_priv)
+{
+	wget_hashmap_t *snapshot =
+		wget_hashmap_create(wget_hashmap_size(hsts_db_priv->entries) | 1, (wget_hashmap_hash_t)_hash_hsts, (wget_hashmap_compare_t)_compare_hsts);
+
+	wget_hashmap_set_key_destructor(snapshot, (wget_hashmap_key_destructor_t)_free_hsts);
+	wget_hashmap_set_value_destructor(snapshot, (wget_hashmap_value_destructor_t)_free_hsts);
+	wget_hashmap_browse(hsts_db_priv->entries, _snapshot_copy_entry, snapshot);
+
+	if (hsts_db_priv->snapshot) {
+		if (!hsts_db_priv->retired_snapshots)
+			hsts_db_priv->retired_snapshots = wget_vector_create(4, -2, NULL);
+		wget_vector_add_noalloc(hsts_db_priv->retired_snapshots, hsts_db_priv->snapshot);
+	}
+
+	hsts_db_priv->snapshot_dirty = 0;
+	__atomic_store_n(&hsts_db_priv->snapshot, snapshot, __ATOMIC_RELEASE);
+}
+
 /**
  * \param[in] hsts_db An HSTS database
  * \param[in] host Hostname to search for
@@ -168,21 +209,34 @@ static int impl_hsts_db_host_match(const wget_hsts_db_t *hsts_db, const char *ho
 	_hsts_db_impl_t *hsts_db_priv = (_hsts_db_impl_t *) hsts_db;
 
 	_hsts_t hsts, *hstsp;
+	wget_hashmap_t *snapshot;
 	const char *p;
 	int64_t now = time(NULL);
 
+	// catch up with changes made since the last rebuild (rare compared to matches)
+	if (hsts_db_priv->snapshot_dirty) {
+		wget_thread_mutex_lock(&hsts_db_priv->mutex);
+		if (hsts_db_priv->snapshot_dirty)
+			_hsts_db_rebuild_snapshot(hsts_db_priv);
+		wget_thread_mutex_unlock(&hsts_db_priv->mutex);
+	}
+
+	// the snapshot is immutable - probe it without taking the mutex
+	if (!(snapshot = __atomic_load_n(&hsts_db_priv->snapshot, __ATOMIC_ACQUIRE)))
+		return 0;
+
 	// first look for an exact match
 	// if it's the default port, "normalize" it
 	// we assume the scheme is HTTP
 	hsts.port = (port == 80 ? 443 : port);
 	hsts.host = host;
-	if ((hstsp = wget_hashmap_get(hsts_db_priv->entries, &hsts)) && hstsp->expires >= now)
+	if ((hstsp = wget_hashmap_get(snapshot, &hsts)) && hstsp->expires >= now)
 		return 1;
 
 	// now look for a valid subdomain match
 	for (p = host; (p = strchr(p, '.')); ) {
 		hsts.host = ++p;
-		if ((hstsp = wget_hashmap_get(hsts_db_priv->entries, &hsts))
+		if ((hstsp = wget_hashmap_get(snapshot, &hsts))
 				&& hstsp->include_subdomains && hstsp->expires >= now)
 			return 1;
 	}
@@ -208,6 +262,16 @@ void wget_hsts_db_deinit(wget_hsts_db_t *hsts_db)
 		xfree(hsts_db_priv->fname);
 		wget_thread_mutex_lock(&hsts_db_priv->mutex);
 		wget_hashmap_free(&hsts_db_priv->entries);
+		wget_hashmap_free(&hsts_db_priv->snapshot);
+		if (hsts_db_priv->retired_snapshots) {
+			for (int it = 0; it < wget_vector_size(hsts_db_priv->retired_snapshots); it++) {
+				wget_hashmap_t *snapshot = wget_vector_get(hsts_db_priv->retired_snapshots, it);
+				wget_hashmap_free(&snapshot);
+			}
+			wget_vector_clear_nofree(hsts_db_priv->retired_snapshots);
+			wget_vector_free(&hsts_db_priv->retired_snapshots);
+		}
+		hsts_db_priv->snapshot_dirty = 0;
 		wget_thread_mutex_unlock(&hsts_db_priv->mutex);
 	}
 }
@@ -242,8 +306,10 @@ static void _hsts_db_add_entry(_hsts_db_impl_t *hsts_db_priv, _hsts_t *hsts)
 	wget_thread_mutex_lock(&hsts_db_priv->mutex);
 
 	if (hsts->maxage == 0) {
-		if (wget_hashmap_remove(hsts_db_priv->entries, hsts))
+		if (wget_hashmap_remove(hsts_db_priv->entries, hsts)) {
 			debug_printf("removed HSTS %s:%hu\n", hsts->host, hsts->port);
+			hsts_db_priv->snapshot_dirty = 1;
+		}
 		_free_hsts(hsts);
 		hsts = NULL;
 	} else {
@@ -251,6 +317,16 @@ static void _hsts_db_add_entry(_hsts_db_impl_t *hsts_db_priv, _hsts_t *hsts)
 
 		if (old) {
 			if (old->created < hsts->created || old->maxage != hsts->maxage || old->include_subdomains != hsts->include_subdomains) {
+				if (old->include_subdomains != hsts->include_subdomains) {
+					// changes the match outcome for subdomains - needs a snapshot rebuild
+					hsts_db_priv->snapshot_dirty = 1;
+				} else if (hsts_db_priv->snapshot) {
+					// a pure expiry refresh - update the snapshot copy in place
+					_hsts_t *snap = wget_hashmap_get(hsts_db_priv->snapshot, hsts);
+
+					if (snap)
+						snap->expires = hsts->expires;
+				}
 				old->created = hsts->created;
 				old->expires = hsts->expires;
 				old->maxage = hsts->maxage;
@@ -263,6 +339,7 @@ static void _hsts_db_add_entry(_hsts_db_impl_t *hsts_db_priv, _hsts_t *hsts)
 			// key and value are the same to make wget_hashmap_get() return old 'hsts'
 			// debug_printf("add HSTS %s:%hu (maxage=%lld, includeSubDomains=%d)\n", hsts->host, hsts->port, (long long)hsts->maxage, hsts->include_subdomains);
 			wget_hashmap_put_noalloc(hsts_db_priv->entries, hsts, hsts);
+			hsts_db_priv->snapshot_dirty = 1;
 			// no need to free anything here
 		}
 	}
@@ -535,7 +612,7 @@ wget_hsts_db_t *wget_hsts_db_init(wget_hsts_db_t *hsts_db, const char *fname)
 	hsts_db_priv->entries = wget_hashmap_create(16, (wget_hashmap_hash_t)_hash_hsts, (wget_hashmap_compare_t)_compare_hsts);
 	wget_hashmap_set_key_destructor(hsts_db_priv->entries, (wget_hashmap_key_destructor_t)_free_hsts);
 	wget_hashmap_set_value_destructor(hsts_db_priv->entries, (wget_hashmap_value_destructor_t)_free_hsts);
-	wget_thread_mutex_init(&hsts_db_priv->mutex);
+	wget_thread_mutex_init_adaptive(&hsts_db_priv->mutex);
 
 	return (wget_hsts_db_t *) hsts_db_priv;
 }
@@ -49,7 +49,8 @@ typedef struct {
 	char
 		found_robots,
 		found_content_type,
-		link_inline;
+		link_inline,
+		streaming; // record document offsets instead of pointers (chunked input)
 	const char
 		* html,
 		* css_attr,
@@ -99,14 +100,17 @@ static void _css_parse_uri(void *context, const char *url G_GNUC_WGET_UNUSED, si
 	parsed_url.link_inline = 1;
 	wget_strscpy(parsed_url.attr, ctx->css_attr, sizeof(parsed_url.attr));
 	wget_strscpy(parsed_url.dir, ctx->css_dir, sizeof(parsed_url.dir));
-	parsed_url.url.p = (const char *) (ctx->html + ctx->css_start_offset + pos);
+	if (ctx->streaming)
+		parsed_url.url.p = (const char *) (uintptr_t) (ctx->css_start_offset + pos);
+	else
+		parsed_url.url.p = (const char *) (ctx->html + ctx->css_start_offset + pos);
 	parsed_url.url.len = len;
 
 	wget_vector_add(res->uris, &parsed_url, sizeof(parsed_url));
 }
 
 // Callback function, called from HTML parser for each URI found.
-static void _html_get_url(void *context, int flags, const char *tag, const char *attr, const char *val, size_t len, size_t pos G_GNUC_WGET_UNUSED)
+static void _html_get_url(void *context, int flags, const char *tag, const char *attr, const char *val, size_t len, size_t pos)
 {
 	_html_context_t *ctx = context;
 
@@ -190,7 +194,7 @@ static void _html_get_url(void *context, int flags, const char *tag, const char
 		if ((*attr|0x20) == 's' && !wget_strcasecmp_ascii(attr, "style") && len) {
 			ctx->css_dir = tag;
 			ctx->css_attr = "style";
-			ctx->css_start_offset = val - ctx->html;
+			ctx->css_start_offset = ctx->streaming ? pos : (size_t) (val - ctx->html);
 			wget_css_parse_buffer(val, len, _css_parse_uri, NULL, context);
 			return;
 		}
@@ -227,12 +231,14 @@ static void _html_get_url(void *context, int flags, const char *tag, const char
 		}
 
 		if (found) {
+			const char *val_start = val; // pos is the document offset of val_start
+
 			for (;len && c_isspace(*val); val++, len--); // skip leading spaces
 			for (;len && c_isspace(val[len - 1]); len--);  // skip trailing spaces
 
 			if ((*tag|0x20) == 'b' && !wget_strcasecmp_ascii(tag, "base")) {
 				// found a <BASE href="...">
-				res->base.p = val;
+				res->base.p = ctx->streaming ? (const char *) (uintptr_t) (pos + (val - val_start)) : val;
 				res->base.len = len;
 				return;
 			}
@@ -252,7 +258,7 @@ static void _html_get_url(void *context, int flags, const char *tag, const char
 					if (p != val) {
 						wget_strscpy(url.attr, attr, sizeof(url.attr));
 						wget_strscpy(url.dir, tag, sizeof(url.dir));
-						url.url.p = p;
+						url.url.p = ctx->streaming ? (const char *) (uintptr_t) (pos + (p - val_start)) : p;
 						url.url.len = val - p;
 						wget_vector_add(res->uris, &url, sizeof(url));
 					}
@@ -265,7 +271,7 @@ static void _html_get_url(void *context, int flags, const char *tag, const char
 				url.link_inline = ctx->link_inline;
 				wget_strscpy(url.attr, attr, sizeof(url.attr));
 				wget_strscpy(url.dir, tag, sizeof(url.dir));
-				url.url.p = val;
+				url.url.p = ctx->streaming ? (const char *) (uintptr_t) (pos + (val - val_start)) : val;
 				url.url.len = len;
 				ctx->uri_index = wget_vector_add(res->uris, &url, sizeof(url));
 			}
@@ -275,7 +281,7 @@ static void _html_get_url(void *context, int flags, const char *tag, const char
 	if (flags & XML_FLG_CONTENT && val && len && !wget_strcasecmp_ascii(tag, "style")) {
 		ctx->css_dir = "style";
 		ctx->css_attr = "";
-		ctx->css_start_offset = val - ctx->html;
+		ctx->css_start_offset = ctx->streaming ? pos : (size_t) (val - ctx->html);
 		wget_css_parse_buffer(val, len, _css_parse_uri, NULL, context);
 	}
 }
@@ -304,6 +310,15 @@ static void _urls_to_absolute(WGET_VECTOR *urls, WGET_IRI *base)
 void wget_html_free_urls_inline (wget_html_parsed_result_t **res)
 {
 	if (res && *res) {
+		wget_arena_t *arena = (*res)->arena;
+
+		if (arena) {
+			// everything including *res itself lives in the arena
+			wget_arena_free(&arena);
+			*res = NULL;
+			return;
+		}
+
 		xfree((*res)->encoding);
 		wget_vector_free(&(*res)->uris);
 		xfree(*res);
@@ -319,8 +334,101 @@ wget_html_parsed_result_t *wget_html_get_urls_inline(const char *html, wget_vect
 		.html = html,
 	};
 
+	int old_tag = wget_alloc_tag(WGET_ALLOC_TAG_HTML); // for --alloc-stats attribution
+
+	// all result allocations (vector, strings, the result struct) come from
+	// one arena, so the per-page cleanup is a handful of free() calls
+	wget_arena_push(NULL);
+
 //	context.result.uris = wget_vector_create(32, -2, NULL);
 	wget_html_parse_buffer(html, _html_get_url, &context, HTML_HINT_REMOVE_EMPTY_CONTENT);
 
-	return wget_memdup(&context.result, sizeof(context.result));
+	wget_html_parsed_result_t *res = wget_memdup(&context.result, sizeof(context.result));
+	res->arena = wget_arena_pop();
+
+	wget_alloc_tag(old_tag);
+
+	return res;
+}
+
+// Streaming variant of wget_html_get_urls_inline(): URLs are extracted from
+// chunks as they arrive instead of waiting for the complete document, so link
+// extraction overlaps with the download. Since the chunk memory may move or
+// vanish between feeds, document offsets are recorded in the url/base 'p'
+// fields and resolved against the final document buffer on close.
+
+struct _wget_html_stream_st {
+	_html_context_t
+		context;
+	wget_xml_stream_t
+		*parser;
+};
+
+wget_html_stream_t *wget_html_stream_init(wget_vector_t *additional_tags, wget_vector_t *ignore_tags)
+{
+	wget_html_stream_t *stream = wget_calloc(1, sizeof(wget_html_stream_t));
+
+	stream->context.result.follow = 1;
+	stream->context.additional_tags = additional_tags;
+	stream->context.ignore_tags = ignore_tags;
+	stream->context.streaming = 1;
+
+	// one arena collects the result (and parser) allocations across all feeds
+	stream->context.result.arena = wget_arena_push(NULL);
+	stream->parser = wget_xml_stream_init(_html_get_url, &stream->context, XML_HINT_HTML | HTML_HINT_REMOVE_EMPTY_CONTENT);
+	wget_arena_pop();
+
+	return stream;
+}
+
+void wget_html_stream_feed(wget_html_stream_t *stream, const char *data, size_t len)
+{
+	wget_arena_push(stream->context.result.arena);
+	wget_xml_stream_feed(stream->parser, data, len);
+	wget_arena_pop();
+}
+
+// Parses the remaining input and frees the stream.
+// 'html' must point to the complete document (all bytes fed so far) and has to
+// stay valid as long as the returned result is used - the URL entries point
+// into it. With html == NULL the collected results are discarded and NULL
+// is returned.
+
+wget_html_parsed_result_t *wget_html_stream_close(wget_html_stream_t **stream, const char *html)
+{
+	wget_html_parsed_result_t *res = NULL;
+
+	if (!stream || !*stream)
+		return NULL;
+
+	wget_html_parsed_result_t *result = &(*stream)->context.result;
+
+	wget_arena_push(result->arena);
+	wget_xml_stream_close(&(*stream)->parser);
+
+	if (html) {
+		// resolve the recorded document offsets against the complete document
+		for (int it = 0; it < wget_vector_size(result->uris); it++) {
+			wget_html_parsed_url_t *url = wget_vector_get(result->uris, it);
+			url->url.p = html + (size_t) url->url.p;
+		}
+		if (result->base.len)
+			result->base.p = html + (size_t) result->base.p;
+
+		res = wget_memdup(result, sizeof(*result));
+		res->arena = wget_arena_pop();
+	} else {
+		wget_arena_t *arena = wget_arena_pop();
+
+		if (arena) {
+			wget_arena_free(&arena); // discards encoding, uris and parser leftovers
+		} else {
+			xfree(result->encoding);
+			wget_vector_free(&result->uris);
+		}
+	}
+
+	xfree(*stream);
+
+	return res;
 }
@@ -35,9 +35,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <c-ctype.h>
 #include <time.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #ifdef HAVE_SYS_SOCKET_H
 # include <sys/socket.h>
 #elif defined HAVE_WS2TCPIP_H
@@ -91,11 +95,34 @@ typedef struct
 
 static wget_stats_callback_t stats_callback;
 
+#ifdef WITH_LIBNGHTTP2
+// when set, HTTP/2 server push is enabled and the callback decides per
+// pushed resource whether to accept the stream
+static wget_http_server_push_callback_t server_push_callback;
+#endif
+
+// cap for presizing the body buffer from Content-Length - a lying server
+// must not make us allocate unbounded memory before any payload arrived
+#define BODY_PRESIZE_MAX (64 * 1024 * 1024)
+
 // This is the default function for collecting body data
 static int _body_callback(wget_http_response_t *resp, void *user_data G_GNUC_WGET_UNUSED, const char *data, size_t length)
 {
-	if (!resp->body)
-		resp->body = wget_buffer_alloc(102400);
+	if (!resp->body) {
+		size_t size = 102400;
+
+		// the announced size is known - get the allocation right in one go
+		// instead of realloc-copying the body a dozen times on its way up
+		if (resp->content_length_valid && resp->content_length > size)
+			size = resp->content_length < BODY_PRESIZE_MAX ? resp->content_length : BODY_PRESIZE_MAX;
+
+		resp->body = wget_buffer_acquire(size); // reused from the thread's buffer pool across requests
+
+		// beyond the cap the announced length isn't trusted - continue in
+		// bounded, page-aligned steps instead of doubling
+		if (size == BODY_PRESIZE_MAX)
+			wget_buffer_set_growth_policy(resp->body, BODY_PRESIZE_MAX, true);
+	}
 
 	wget_buffer_memcat(resp->body, data, length);
 
@@ -110,13 +137,14 @@ wget_http_request_t *wget_http_create_request(const wget_iri_t *iri, const char
 	wget_buffer_init(&req->esc_host, req->esc_host_buf, sizeof(req->esc_host_buf));
 
 	req->scheme = iri->scheme;
+	req->body_sink_fd = -1;
 	wget_strscpy(req->method, method, sizeof(req->method));
 	wget_iri_get_escaped_resource(iri, &req->esc_resource);
 	wget_iri_get_escaped_host(iri, &req->esc_host);
 	req->headers = wget_vector_create(8, 8, NULL);
 	wget_vector_set_destructor(req->headers, (wget_vector_destructor_t)wget_http_free_param);
 
-	wget_http_add_header(req, "Host", req->esc_host.data);
+	wget_http_add_header_nocopy(req, "Host", req->esc_host.data);
 	wget_http_request_set_body_cb(req, _body_callback, NULL);
 
 	return req;
@@ -134,10 +162,17 @@ void wget_http_request_set_body_cb(wget_http_request_t *req, wget_http_body_call
 	req->body_user_data = user_data;
 }
 
+void wget_http_request_set_raw_body_cb(wget_http_request_t *req, wget_http_body_callback_t callback, void *user_data)
+{
+	req->raw_body_callback = callback;
+	req->raw_body_user_data = user_data;
+}
+
 void wget_http_request_set_int(wget_http_request_t *req, int key, int value)
 {
 	switch (key) {
 	case WGET_HTTP_RESPONSE_KEEPHEADER: req->response_keepheader = !!value; break;
+	case WGET_HTTP_STREAM_PRIORITY: req->stream_priority = value; break;
 	default: error_printf(_("%s: Unknown key %d (or value must not be an integer)\n"), __func__, key);
 	}
 }
@@ -146,6 +181,7 @@ int wget_http_request_get_int(wget_http_request_t *req, int key)
 {
 	switch (key) {
 	case WGET_HTTP_RESPONSE_KEEPHEADER: return req->response_keepheader;
+	case WGET_HTTP_STREAM_PRIORITY: return req->stream_priority;
 	default:
 		error_printf(_("%s: Unknown key %d (or value must not be an integer)\n"), __func__, key);
 		return -1;
@@ -179,12 +215,36 @@ void wget_http_request_set_body(wget_http_request_t *req, const char *mimetype,
 	req->body_length = length;
 }
 
+// File-backed request body: only the name and size are kept here, the
+// payload is streamed from the file at send time (see wget_http_send_request),
+// so multi-GB uploads never materialize in memory.
+int wget_http_request_set_body_file(wget_http_request_t *req, const char *mimetype, const char *fname)
+{
+	struct stat st;
+
+	if (stat(fname, &st) != 0 || !S_ISREG(st.st_mode)) {
+		error_printf(_("Failed to use '%s' as request body (errno=%d)\n"), fname, errno);
+		return -1;
+	}
+
+	if (mimetype)
+		wget_http_add_header(req, "Content-Type", mimetype);
+
+	xfree(req->body_fname);
+	req->body_fname = wget_strdup(fname);
+	req->body_length = (size_t) st.st_size;
+
+	return 0;
+}
+
 void wget_http_add_header_vprintf(wget_http_request_t *req, const char *name, const char *fmt, va_list args)
 {
-	wget_http_header_param_t param;
+	wget_http_header_param_t param = {
+		.name = wget_strdup(name),
+	};
 
-	param.value = wget_vaprintf(fmt, args);
-	param.name = wget_strdup(name);
+	// formats on the stack, the value is one exactly sized allocation
+	wget_vasprintf((char **) &param.value, fmt, args);
 	wget_vector_add(req->headers, &param, sizeof(param));
 }
 
@@ -207,6 +267,21 @@ void wget_http_add_header(wget_http_request_t *req, const char *name, const char
 	wget_vector_add(req->headers, &param, sizeof(param));
 }
 
+// like wget_http_add_header(), but without copying name and value.
+// Both must stay valid for the lifetime of the request, e.g. string
+// literals or configuration values. Saves two allocations per header
+// for the constant headers repeated on every single request.
+void wget_http_add_header_nocopy(wget_http_request_t *req, const char *name, const char *value)
+{
+	wget_http_header_param_t param = {
+		.name = name,
+		.value = value,
+		.is_static = 1
+	};
+
+	wget_vector_add(req->headers, &param, sizeof(param));
+}
+
 void wget_http_add_header_param(wget_http_request_t *req, wget_http_header_param_t *param)
 {
 	wget_http_header_param_t _param = {
@@ -366,6 +441,18 @@ static int _get_body(void *userdata, const char *data, size_t length)
 	return resp->req->body_callback(resp, resp->req->body_user_data, data, length);
 }
 
+// hand one wire chunk to the raw body callback (if any), then into the
+// decompressor chain. A nonzero return means a receiver canceled the
+// transfer and no more data should be read for this response.
+static int _feed_body(wget_http_response_t *resp, wget_decompressor_t *dc, char *data, size_t length)
+{
+	if (resp->req->raw_body_callback
+		&& resp->req->raw_body_callback(resp, resp->req->raw_body_user_data, data, length) < 0)
+		return -1;
+
+	return wget_decompress(dc, data, length);
+}
+
 #ifdef WITH_LIBNGHTTP2
 static ssize_t _send_callback(nghttp2_session *session G_GNUC_WGET_UNUSED,
 	const uint8_t *data, size_t length, int flags G_GNUC_WGET_UNUSED, void *user_data)
@@ -440,10 +527,46 @@ static int _on_frame_send_callback(nghttp2_session *session G_GNUC_WGET_UNUSED,
 }
 
 static int _on_frame_recv_callback(nghttp2_session *session,
-	const nghttp2_frame *frame, void *user_data G_GNUC_WGET_UNUSED)
+	const nghttp2_frame *frame, void *user_data)
 {
 	_print_frame_type(frame->hd.type, '<', frame->hd.stream_id);
 
+	// a complete PUSH_PROMISE - let the application decide whether the
+	// promised stream is worth receiving, a canceled push costs nothing
+	if (frame->hd.type == NGHTTP2_PUSH_PROMISE) {
+		wget_http_connection_t *conn = (wget_http_connection_t *) user_data;
+		int32_t promised_id = frame->push_promise.promised_stream_id;
+		wget_http_request_t *req = NULL;
+
+		if (server_push_callback && conn->push_authority && conn->push_path) {
+			struct _http2_stream_context *parent = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
+			char *uri = wget_aprintf("%s://%s%s", conn->scheme, conn->push_authority, conn->push_path);
+
+			req = server_push_callback(conn, uri, parent && parent->resp ? parent->resp->req : NULL);
+			xfree(uri);
+		}
+
+		if (req) {
+			// receive the pushed stream exactly like a stream we requested
+			struct _http2_stream_context *ctx = xcalloc(1, sizeof(struct _http2_stream_context));
+
+			ctx->resp = xcalloc(1, sizeof(wget_http_response_t));
+			ctx->resp->req = req;
+			ctx->resp->major = 2;
+			ctx->resp->keep_alive = 1;
+			req->request_start = wget_get_timemillis_coarse();
+			req->stream_id = promised_id;
+
+			nghttp2_session_set_stream_user_data(session, promised_id, ctx);
+			conn->pending_http2_requests++;
+		} else
+			nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, promised_id, NGHTTP2_CANCEL);
+
+		xfree(conn->push_authority);
+		xfree(conn->push_path);
+		return 0;
+	}
+
 	// header callback after receiving all header tags
 	if (frame->hd.type == NGHTTP2_HEADERS) {
 		struct _http2_stream_context *ctx = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
@@ -451,7 +574,12 @@ static int _on_frame_recv_callback(nghttp2_session *session,
 
 		if (resp) {
 			if (resp->header && resp->req->header_callback) {
-				resp->req->header_callback(resp, resp->req->header_user_data);
+				if (resp->req->header_callback(resp, resp->req->header_user_data)) {
+					// the caller doesn't want the body (e.g. a redirect):
+					// cancel just this stream, the connection stays usable
+					nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, frame->hd.stream_id, NGHTTP2_CANCEL);
+					return 0;
+				}
 			}
 
 			if (!ctx->decompressor) {
@@ -467,8 +595,25 @@ static int _on_frame_recv_callback(nghttp2_session *session,
 static int _on_header_callback(nghttp2_session *session,
 	const nghttp2_frame *frame, const uint8_t *name, size_t namelen,
 	const uint8_t *value, size_t valuelen,
-	uint8_t flags G_GNUC_WGET_UNUSED, void *user_data G_GNUC_WGET_UNUSED)
+	uint8_t flags G_GNUC_WGET_UNUSED, void *user_data)
 {
+	if (frame->hd.type == NGHTTP2_PUSH_PROMISE) {
+		// request pseudo headers of a promised stream - just collect what
+		// identifies the pushed resource, the accept/reject decision is
+		// made when the frame is complete (_on_frame_recv_callback)
+		wget_http_connection_t *conn = (wget_http_connection_t *) user_data;
+
+		if (namelen == 10 && !memcmp(name, ":authority", 10)) {
+			xfree(conn->push_authority);
+			conn->push_authority = wget_strmemdup(value, valuelen);
+		} else if (namelen == 5 && !memcmp(name, ":path", 5)) {
+			xfree(conn->push_path);
+			conn->push_path = wget_strmemdup(value, valuelen);
+		}
+
+		return 0;
+	}
+
 	struct _http2_stream_context *ctx = nghttp2_session_get_stream_user_data(session, frame->hd.stream_id);
 	wget_http_response_t *resp = ctx ? ctx->resp : NULL;
 
@@ -477,11 +622,11 @@ static int _on_header_callback(nghttp2_session *session,
 
 	if (resp->req->response_keepheader || resp->req->header_callback) {
 		if (!resp->header)
-			resp->header = wget_buffer_alloc(1024);
+			resp->header = wget_buffer_acquire(1024);
 	}
 
 	if (frame->hd.type == NGHTTP2_HEADERS) {
-		if (frame->headers.cat == NGHTTP2_HCAT_RESPONSE) {
+		if (frame->headers.cat == NGHTTP2_HCAT_RESPONSE || frame->headers.cat == NGHTTP2_HCAT_PUSH_RESPONSE) {
 			debug_printf("%.*s: %.*s\n", (int) namelen, name, (int) valuelen, value);
 
 			if (resp->header)
@@ -506,7 +651,7 @@ static int _on_stream_close_callback(nghttp2_session *session, int32_t stream_id
 	if (ctx) {
 		wget_http_connection_t *conn = (wget_http_connection_t *) user_data;
 
-		ctx->resp->response_end = wget_get_timemillis(); // Final transmission time.
+		ctx->resp->response_end = wget_get_timemillis_coarse(); // Final transmission time.
 
 		wget_vector_add_noalloc(conn->received_http2_responses, ctx->resp);
 		wget_decompress_close(ctx->decompressor);
@@ -529,10 +674,12 @@ static int _on_data_chunk_recv_callback(nghttp2_session *session,
 		// debug_printf("[INFO] C <---------------------------- S%d (DATA chunk - %zu bytes)\n", stream_id, len);
 		// debug_printf("nbytes %zu\n", len);
 
-		ctx->resp->req->first_response_start = wget_get_timemillis();
+		ctx->resp->req->first_response_start = wget_get_timemillis_coarse();
 
 		ctx->resp->cur_downloaded += len;
-		wget_decompress(ctx->decompressor, (char *) data, len);
+		if (_feed_body(ctx->resp, ctx->decompressor, (char *) data, len))
+			// receiver canceled: close just this stream, the connection stays usable
+			nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL);
 	}
 	return 0;
 }
@@ -679,6 +826,12 @@ int wget_http_open(wget_http_connection_t **_conn, const wget_iri_t *iri)
 			port = proxy->port;
 			conn->proxied = 1;
 		}
+		if (conn->proxied) {
+			// remember the proxy endpoint: requests carry absolute URIs, so
+			// this connection can be reused for any host behind the proxy
+			conn->proxy_esc_host = wget_strdup(host);
+			conn->proxy_port = port;
+		}
 		wget_thread_mutex_unlock(&mutex);
 	}
 
@@ -692,7 +845,7 @@ int wget_http_open(wget_http_connection_t **_conn, const wget_iri_t *iri)
 		conn->esc_host = iri->host ? wget_strdup(iri->host) : NULL;
 		conn->port = iri->port;
 		conn->scheme = iri->scheme;
-		conn->buf = wget_buffer_alloc(102400); // reusable buffer, large enough for most requests and responses
+		conn->buf = wget_buffer_acquire(102400); // reusable buffer, large enough for most requests and responses
 #ifdef WITH_LIBNGHTTP2
 		if ((conn->protocol = (char) wget_tcp_get_protocol(conn->tcp)) == WGET_PROTOCOL_HTTP_2_0) {
 			nghttp2_session_callbacks *callbacks;
@@ -715,7 +868,11 @@ int wget_http_open(wget_http_connection_t **_conn, const wget_iri_t *iri)
 
 			nghttp2_settings_entry iv[] = {
 				// {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, 100},
-				{NGHTTP2_SETTINGS_ENABLE_PUSH, 0},
+				// server push is only accepted when someone is there to judge it
+				{NGHTTP2_SETTINGS_ENABLE_PUSH, server_push_callback ? 1u : 0},
+				// give each stream enough window that many concurrent
+				// downloads don't stall on the 64k flow-control default
+				{NGHTTP2_SETTINGS_INITIAL_WINDOW_SIZE, 1024 * 1024},
 			};
 
 			if ((rc = nghttp2_submit_settings(conn->http2_session, NGHTTP2_FLAG_NONE, iv, countof(iv)))) {
@@ -724,6 +881,10 @@ int wget_http_open(wget_http_connection_t **_conn, const wget_iri_t *iri)
 				return WGET_E_INVALID;
 			}
 
+			// likewise enlarge the connection-level window, it is shared by all streams
+			if (nghttp2_session_set_local_window_size(conn->http2_session, NGHTTP2_FLAG_NONE, 0, 16 * 1024 * 1024))
+				debug_printf("Failed to enlarge HTTP2 connection window\n");
+
 			conn->received_http2_responses = wget_vector_create(16, -2, NULL);
 		} else
 			conn->pending_requests = wget_vector_create(16, -2, NULL);
@@ -753,19 +914,157 @@ void wget_http_close(wget_http_connection_t **conn)
 		}
 		wget_vector_clear_nofree((*conn)->received_http2_responses);
 		wget_vector_free(&(*conn)->received_http2_responses);
+		xfree((*conn)->push_authority);
+		xfree((*conn)->push_path);
 #endif
 		wget_tcp_deinit(&(*conn)->tcp);
 //		if (!wget_tcp_get_dns_caching())
 //			freeaddrinfo((*conn)->addrinfo);
 		xfree((*conn)->esc_host);
+		xfree((*conn)->proxy_esc_host);
 		// xfree((*conn)->scheme);
-		wget_buffer_free(&(*conn)->buf);
+		wget_buffer_release(&(*conn)->buf);
+		// unanswered requests died with the connection (e.g. a pipelined batch
+		// cut short) - answered ones were popped in wget_http_get_response_cb()
+		for (int it = 0; it < wget_vector_size((*conn)->pending_requests); it++) {
+			wget_http_request_t *req = wget_vector_get((*conn)->pending_requests, it);
+			wget_http_free_request(&req);
+		}
 		wget_vector_clear_nofree((*conn)->pending_requests);
 		wget_vector_free(&(*conn)->pending_requests);
 		xfree(*conn);
 	}
 }
 
+#ifdef WITH_LIBNGHTTP2
+static wget_http_response_t *_http2_pop_response(wget_http_connection_t *conn);
+#endif
+
+/**Gets the number of concurrent streams the remote endpoint allows.
+ * \param conn a wget_http_connection_t
+ * \return The stream limit advertised by the server's SETTINGS frame on a
+ *         HTTP/2 connection, else 1
+ *
+ * Until the server's SETTINGS frame has been processed, the protocol
+ * default (no limit) is reported.
+ */
+int wget_http_get_max_concurrent_streams(const wget_http_connection_t *conn)
+{
+#ifdef WITH_LIBNGHTTP2
+	if (conn && conn->protocol == WGET_PROTOCOL_HTTP_2_0 && conn->http2_session) {
+		uint32_t limit = nghttp2_session_get_remote_settings(
+			conn->http2_session, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+
+		return limit > INT_MAX ? INT_MAX : (int) limit;
+	}
+#endif
+
+	return 1;
+}
+
+/**Gets the socket descriptor of a connection.
+ * \param conn a wget_http_connection_t
+ * \return The underlying socket descriptor, or -1
+ *
+ * For event-loop integration: register the descriptor with epoll/poll and
+ * drive the connection with wget_http_handle_events(). The descriptor is
+ * owned by the connection.
+ */
+int wget_http_get_fd(const wget_http_connection_t *conn)
+{
+	return conn ? wget_tcp_get_fd(conn->tcp) : -1;
+}
+
+/**Gets the I/O events a connection is currently interested in.
+ * \param conn a wget_http_connection_t
+ * \return Bitwise or of WGET_IO_READABLE / WGET_IO_WRITABLE, 0 when idle
+ *
+ * Poll the connection's descriptor for exactly these events, then call
+ * wget_http_handle_events() with the events that fired. A return of 0
+ * means no response is outstanding - nothing to wait for.
+ */
+int wget_http_want_events(wget_http_connection_t *conn)
+{
+	int events = 0;
+
+#ifdef WITH_LIBNGHTTP2
+	if (conn->protocol == WGET_PROTOCOL_HTTP_2_0) {
+		if (conn->pending_http2_requests <= 0 && !wget_vector_size(conn->received_http2_responses))
+			return 0;
+		if (nghttp2_session_want_read(conn->http2_session))
+			events |= WGET_IO_READABLE;
+		if (nghttp2_session_want_write(conn->http2_session))
+			events |= WGET_IO_WRITABLE;
+
+		return events;
+	}
+#endif
+
+	if (wget_vector_size(conn->pending_requests))
+		events |= WGET_IO_READABLE;
+
+	return events;
+}
+
+/**Makes progress on a connection without waiting for I/O.
+ * \param conn a wget_http_connection_t
+ * \param revents The events that fired on the connection's descriptor
+ * \param response Points to the completed response, or NULL if none finished yet
+ * \return WGET_E_SUCCESS on progress, a negative error code when the connection failed
+ *
+ * The non-blocking counterpart of wget_http_get_response(): call it from an
+ * event loop whenever wget_http_get_fd() becomes ready for one of the events
+ * reported by wget_http_want_events(). On HTTP/2 it performs exactly the I/O
+ * the socket can take right now and multiplexes any number of in-flight
+ * requests; poll *response after every call, a single readable event may
+ * complete several streams.
+ *
+ * On HTTP/1.1 the wire format forces sequential responses; once the head
+ * response's first bytes arrived (the readable event), it is read to
+ * completion in one go. Event-driven callers wanting full concurrency
+ * should prefer HTTP/2 servers.
+ */
+int wget_http_handle_events(wget_http_connection_t *conn, int revents, wget_http_response_t **response)
+{
+	*response = NULL;
+
+#ifdef WITH_LIBNGHTTP2
+	if (conn->protocol == WGET_PROTOCOL_HTTP_2_0) {
+		int rc = 0;
+		int timeout = wget_tcp_get_timeout(conn->tcp);
+
+		wget_tcp_set_timeout(conn->tcp, 0); // 0 = immediate, never block
+
+		if ((revents & WGET_IO_WRITABLE) && nghttp2_session_want_write(conn->http2_session))
+			rc = nghttp2_session_send(conn->http2_session);
+		if (!rc && (revents & WGET_IO_READABLE) && nghttp2_session_want_read(conn->http2_session))
+			rc = nghttp2_session_recv(conn->http2_session);
+
+		wget_tcp_set_timeout(conn->tcp, timeout);
+
+		if ((*response = _http2_pop_response(conn))) {
+			if (conn->pending_http2_requests > 0)
+				conn->pending_http2_requests--;
+			if (stats_callback)
+				_server_stats_add(conn, *response);
+		}
+
+		// a failed session with buffered responses still delivers them first
+		if (rc && !*response && !wget_vector_size(conn->received_http2_responses))
+			return WGET_E_CONNECT;
+
+		return WGET_E_SUCCESS;
+	}
+#endif
+
+	if ((revents & WGET_IO_READABLE) && wget_vector_size(conn->pending_requests)) {
+		if (!(*response = wget_http_get_response_cb(conn)))
+			return WGET_E_CONNECT;
+	}
+
+	return WGET_E_SUCCESS;
+}
+
 #ifdef WITH_LIBNGHTTP2
 static void _init_nv(nghttp2_nv *nv, const char *name, const char *value)
 {
@@ -777,6 +1076,56 @@ static void _init_nv(nghttp2_nv *nv, const char *name, const char *value)
 }
 #endif
 
+static ssize_t _http_request_header_to_buffer(wget_http_request_t *req, wget_buffer_t *buf, int proxied);
+
+// Send the assembled header block in conn->buf followed by the request
+// body streamed from req->body_fname, without buffering the whole body.
+static int _http_send_body_file(wget_http_connection_t *conn, wget_http_request_t *req)
+{
+	size_t remaining = req->body_length;
+	ssize_t n;
+	int fd;
+
+	if ((fd = open(req->body_fname, O_RDONLY | O_BINARY)) == -1) {
+		error_printf(_("Failed to open request body file '%s' (errno=%d)\n"), req->body_fname, errno);
+		return -1;
+	}
+
+	if (wget_tcp_write(conn->tcp, conn->buf->data, conn->buf->length) != (ssize_t) conn->buf->length) {
+		close(fd);
+		return -1;
+	}
+
+	// plain connections move the file into the socket zero-copy; a short
+	// transfer leaves the file offset behind the consumed bytes, so the
+	// buffered loop below continues where splice() stopped
+	if ((n = wget_tcp_splice_from_fd(conn->tcp, fd, remaining)) > 0)
+		remaining -= (size_t) n;
+
+	if (remaining) {
+		// TLS connections (or platforms without splice): bounded chunks
+		// through one reused buffer
+		char *chunk = wget_malloc(65536);
+
+		while (remaining && (n = read(fd, chunk, remaining < 65536 ? remaining : 65536)) > 0) {
+			if (wget_tcp_write(conn->tcp, chunk, n) != n)
+				break;
+			remaining -= (size_t) n;
+		}
+
+		xfree(chunk);
+	}
+
+	close(fd);
+
+	if (remaining) {
+		error_printf(_("Failed to send request body from '%s' (%zu bytes left)\n"), req->body_fname, remaining);
+		return -1;
+	}
+
+	return 0;
+}
+
 int wget_http_send_request(wget_http_connection_t *conn, wget_http_request_t *req)
 {
 	ssize_t nbytes;
@@ -816,10 +1165,26 @@ int wget_http_send_request(wget_http_connection_t *conn, wget_http_request_t *re
 		ctx->resp->major = 2;
 		// we do not get a Keep-Alive header in HTTP2 - let's assume the connection stays open
 		ctx->resp->keep_alive = 1;
-		req->request_start = wget_get_timemillis();
+		req->request_start = wget_get_timemillis_coarse();
+
+		// map the requested stream priority to a weight in the priority tree,
+		// so the server interleaves frames of competing streams accordingly
+		nghttp2_priority_spec prio, *prio_ptr = NULL;
+
+		if (req->stream_priority) {
+			int weight = req->stream_priority;
+
+			if (weight < NGHTTP2_MIN_WEIGHT)
+				weight = NGHTTP2_MIN_WEIGHT;
+			else if (weight > NGHTTP2_MAX_WEIGHT)
+				weight = NGHTTP2_MAX_WEIGHT;
+
+			nghttp2_priority_spec_init(&prio, 0, weight, 0);
+			prio_ptr = &prio;
+		}
 
 		// nghttp2 does strdup of name+value and lowercase conversion of 'name'
-		req->stream_id = nghttp2_submit_request(conn->http2_session, NULL, nvs, nvp - nvs, NULL, ctx);
+		req->stream_id = nghttp2_submit_request(conn->http2_session, prio_ptr, nvs, nvp - nvs, NULL, ctx);
 
 		if (req->stream_id < 0) {
 			error_printf(_("Failed to submit HTTP2 request\n"));
@@ -836,33 +1201,54 @@ int wget_http_send_request(wget_http_connection_t *conn, wget_http_request_t *re
 	}
 #endif
 
-	if ((nbytes = wget_http_request_to_buffer(req, conn->buf, conn->proxied)) < 0) {
+	// assemble the header block only - the body is sent as a separate
+	// fragment via scatter-gather I/O, saving a copy of possibly large
+	// POST bodies into the request buffer
+	if ((nbytes = _http_request_header_to_buffer(req, conn->buf, conn->proxied)) < 0) {
 		error_printf(_("Failed to create request buffer\n"));
 		return -1;
 	}
 
-	req->request_start = wget_get_timemillis();
+	req->request_start = wget_get_timemillis_coarse();
 
-	if (wget_tcp_write(conn->tcp, conn->buf->data, nbytes) != nbytes) {
-		// An error will be written by the wget_tcp_write function.
-		// error_printf(_("Failed to send %zd bytes (%d)\n"), nbytes, errno);
-		return -1;
+	if (req->body_fname) {
+		// stream the body straight from the file - multi-GB uploads never
+		// materialize in memory, plain connections go zero-copy via splice()
+		if (_http_send_body_file(conn, req) < 0)
+			return -1;
+
+		nbytes += (ssize_t) req->body_length;
+	} else {
+		wget_iovec_t iov[2] = {
+			{ .data = conn->buf->data, .length = (size_t) nbytes },
+			{ .data = req->body, .length = req->body_length },
+		};
+		int iovcnt = (req->body && req->body_length) ? 2 : 1;
+
+		if (iovcnt == 2)
+			nbytes += (ssize_t) req->body_length;
+
+		if (wget_tcp_writev(conn->tcp, iov, iovcnt) != nbytes) {
+			// An error will be written by the wget_tcp_writev function.
+			// error_printf(_("Failed to send %zd bytes (%d)\n"), nbytes, errno);
+			return -1;
+		}
 	}
 
 	wget_vector_add_noalloc(conn->pending_requests, req);
 
-	if (req->debug_skip_body)
-		debug_printf("# sent %zd bytes:\n%.*s<body skipped>", nbytes, (int)(conn->buf->length - req->body_length), conn->buf->data);
+	if (req->debug_skip_body || req->body_length)
+		debug_printf("# sent %zd bytes:\n%.*s<body skipped>", nbytes, (int)conn->buf->length, conn->buf->data);
 	else
 		debug_printf("# sent %zd bytes:\n%.*s", nbytes, (int)conn->buf->length, conn->buf->data);
 
 	return 0;
 }
 
-ssize_t wget_http_request_to_buffer(wget_http_request_t *req, wget_buffer_t *buf, int proxied)
+static ssize_t _http_request_header_to_buffer(wget_http_request_t *req, wget_buffer_t *buf, int proxied)
 {
 	char have_content_length = 0;
-	char check_content_length = req->body && req->body_length;
+	char check_content_length = (req->body || req->body_fname) && req->body_length;
 
 //	buffer_sprintf(buf, "%s /%s HTTP/1.1\r\nHost: %s", req->method, req->esc_resource.data ? req->esc_resource.data : "",);
 
@@ -902,11 +1288,44 @@ ssize_t wget_http_request_to_buffer(wget_http_request_t *req, wget_buffer_t *buf
 
 	wget_buffer_memcat(buf, "\r\n", 2); // end-of-header
 
-	if (req->body && req->body_length)
+	return buf->length;
+}
+
+ssize_t wget_http_request_to_buffer(wget_http_request_t *req, wget_buffer_t *buf, int proxied)
+{
+	ssize_t nbytes = _http_request_header_to_buffer(req, buf, proxied);
+
+	if (nbytes >= 0 && req->body && req->body_length)
 		wget_buffer_memcat(buf, req->body, req->body_length);
 
-	return buf->length;
+	return nbytes < 0 ? nbytes : (ssize_t) buf->length;
+}
+
+#ifdef WITH_LIBNGHTTP2
+// take the oldest fully received HTTP/2 response off the connection, or NULL
+static wget_http_response_t *_http2_pop_response(wget_http_connection_t *conn)
+{
+	wget_http_response_t *resp = wget_vector_get(conn->received_http2_responses, 0); // should use double linked lists here
+
+	if (resp) {
+		debug_printf("  ##  response status %d\n", resp->code);
+		wget_vector_remove_nofree(conn->received_http2_responses, 0);
+
+		// a workaround for broken server configurations
+		// see https://mail-archives.apache.org/mod_mbox/httpd-dev/200207.mbox/<3D2D4E76.4010502@talex.com.pl>
+		if (resp->content_encoding == wget_content_encoding_gzip
+			&& (!wget_strcasecmp_ascii(resp->content_type, "application/x-gzip")
+			   || !wget_strcasecmp_ascii(resp->content_type, "application/gzip")
+			   || !wget_strcasecmp_ascii(resp->content_type, "application/gunzip")))
+		{
+			debug_printf("Broken server configuration gzip workaround triggered\n");
+			resp->content_encoding =  wget_content_encoding_identity;
+		}
+	}
+
+	return resp;
 }
+#endif
 
 wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 {
@@ -914,14 +1333,17 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 	ssize_t nbytes, nread = 0;
 	char *buf, *p = NULL;
 	wget_http_response_t *resp = NULL;
+	int old_tag = wget_alloc_tag(WGET_ALLOC_TAG_HTTP); // for --alloc-stats attribution
 
 #ifdef WITH_LIBNGHTTP2
 	if (conn->protocol == WGET_PROTOCOL_HTTP_2_0) {
 		debug_printf("  ##  pending_requests = %d\n", conn->pending_http2_requests);
 		if (conn->pending_http2_requests > 0)
 			conn->pending_http2_requests--;
-		else
+		else {
+			wget_alloc_tag(old_tag);
 			return NULL;
+		}
 
 		int timeout = wget_tcp_get_timeout(conn->tcp);
 		int ioflags;
@@ -959,26 +1381,12 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 */
 		}
 
-		resp = wget_vector_get(conn->received_http2_responses, 0); // should use double linked lists here
-		if (resp) {
-			debug_printf("  ##  response status %d\n", resp->code);
-			wget_vector_remove_nofree(conn->received_http2_responses, 0);
-
-			// a workaround for broken server configurations
-			// see https://mail-archives.apache.org/mod_mbox/httpd-dev/200207.mbox/<3D2D4E76.4010502@talex.com.pl>
-			if (resp->content_encoding == wget_content_encoding_gzip
-				&& (!wget_strcasecmp_ascii(resp->content_type, "application/x-gzip")
-				   || !wget_strcasecmp_ascii(resp->content_type, "application/gzip")
-				   || !wget_strcasecmp_ascii(resp->content_type, "application/gunzip")))
-			{
-				debug_printf("Broken server configuration gzip workaround triggered\n");
-				resp->content_encoding =  wget_content_encoding_identity;
-			}
-		}
+		resp = _http2_pop_response(conn);
 
 		if (stats_callback)
 			_server_stats_add(conn, resp);
 
+		wget_alloc_tag(old_tag);
 		return resp;
 	}
 #endif
@@ -997,7 +1405,7 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 	bufsize = conn->buf->size;
 
 	while ((nbytes = wget_tcp_read(conn->tcp, buf + nread, bufsize - nread)) > 0) {
-		req->first_response_start = wget_get_timemillis();
+		req->first_response_start = wget_get_timemillis_coarse();
 		// debug_printf("nbytes %zd nread %zd %zu\n", nbytes, nread, bufsize);
 		nread += nbytes;
 		buf[nread] = 0; // 0-terminate to allow string functions
@@ -1038,8 +1446,12 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 				_server_stats_add(conn, resp);
 
 			if (req->header_callback) {
-				if (req->header_callback(resp, req->header_user_data))
-					goto cleanup; // stop requested by callback function
+				if (req->header_callback(resp, req->header_user_data)) {
+					// stop requested by callback function - the unread body
+					// makes this connection unusable for further requests
+					resp->keep_alive = 0;
+					goto cleanup;
+				}
 			}
 
 			if (req && !wget_strcasecmp_ascii(req->method, "HEAD"))
@@ -1134,11 +1546,26 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 		// read each chunk, stripping the chunk info
 		p = buf;
 		for (;;) {
+			// the payload of consumed chunks already went out through the
+			// decompressor, so drop those bytes before reading on - the buffer
+			// never holds more than one read() worth of data plus a chunk
+			// header, no matter how large the body is
+			if (p > buf) {
+				body_len -= p - buf;
+				memmove(buf, p, body_len + 1); // including 0 terminator
+				p = buf;
+			}
+
 			// read: chunk-size [ chunk-extension ] CRLF
 			while ((!(end = strchr(p, '\r')) || end[1] != '\n')) {
 				if (conn->abort_indicator || _abort_indicator)
 					goto cleanup;
 
+				if (body_len >= bufsize) {
+					error_printf(_("Chunk header larger than %zu bytes\n"), bufsize);
+					goto cleanup;
+				}
+
 				if ((nbytes = wget_tcp_read(conn->tcp, buf + body_len, bufsize - body_len)) <= 0)
 					goto cleanup;
 
@@ -1189,12 +1616,14 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 			if (p <= buf + body_len) {
 				// debug_printf("write full chunk, %zu bytes\n", chunk_size);
 				resp->cur_downloaded += chunk_size;
-				wget_decompress(dc, end, chunk_size);
+				if (_feed_body(resp, dc, end, chunk_size))
+					goto cleanup;
 				continue;
 			}
 
 			resp->cur_downloaded += (buf + body_len) - end;
-			wget_decompress(dc, end, (buf + body_len) - end);
+			if (_feed_body(resp, dc, end, (buf + body_len) - end))
+				goto cleanup;
 
 			chunk_size = (((uintptr_t) p) - ((uintptr_t) (buf + body_len))); // in fact needed bytes to have chunk_size+2 in buf
 
@@ -1218,7 +1647,8 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 					}
 					if (chunk_size > 2) {
 						resp->cur_downloaded += chunk_size - 2;
-						wget_decompress(dc, buf, chunk_size - 2);
+						if (_feed_body(resp, dc, buf, chunk_size - 2))
+							goto cleanup;
 					}
 					body_len = nbytes - chunk_size;
 					if (body_len)
@@ -1230,11 +1660,13 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 					chunk_size -= nbytes;
 					if (chunk_size >= 2) {
 						resp->cur_downloaded += nbytes;
-						wget_decompress(dc, buf, nbytes);
+						if (_feed_body(resp, dc, buf, nbytes))
+							goto cleanup;
 					} else {
 						// special case: we got a partial end-of-chunk
 						resp->cur_downloaded += nbytes - 1;
-						wget_decompress(dc, buf, nbytes - 1);
+						if (_feed_body(resp, dc, buf, nbytes - 1))
+							goto cleanup;
 					}
 				}
 			}
@@ -1243,8 +1675,23 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 		// read content_length bytes
 		debug_printf("method 2\n");
 
-		if (body_len)
-			wget_decompress(dc, buf, body_len);
+		if (body_len && _feed_body(resp, dc, buf, body_len))
+			goto cleanup;
+
+		// zero-copy fast path: identity-encoded payload over a plain connection with
+		// a caller-provided sink - the remaining bytes needn't cross into userspace.
+		// On failure or a partial transfer we simply continue with the read loop below.
+		if (resp->req->body_sink_fd != -1
+			&& resp->content_encoding == wget_content_encoding_identity
+			&& body_len < resp->content_length)
+		{
+			if ((nbytes = wget_tcp_splice_to_fd(conn->tcp, resp->req->body_sink_fd, resp->content_length - body_len)) > 0) {
+				debug_printf("spliced %zd bytes\n", nbytes);
+				body_len += nbytes;
+				resp->cur_downloaded += nbytes;
+			}
+			nbytes = 0;
+		}
 
 		while (body_len < resp->content_length) {
 			if (conn->abort_indicator || _abort_indicator)
@@ -1256,7 +1703,8 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 			body_len += nbytes;
 			// debug_printf("nbytes %zd total %zu/%zu\n", nbytes, body_len, resp->content_length);
 			resp->cur_downloaded += nbytes;
-			wget_decompress(dc, buf, nbytes);
+			if (_feed_body(resp, dc, buf, nbytes))
+				goto cleanup;
 		}
 		if (nbytes < 0)
 			error_printf(_("Failed to read %zd bytes (%d)\n"), nbytes, errno);
@@ -1269,14 +1717,15 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 		// read as long as we can
 		debug_printf("method 3\n");
 
-		if (body_len)
-			wget_decompress(dc, buf, body_len);
+		if (body_len && _feed_body(resp, dc, buf, body_len))
+			goto cleanup;
 
 		while (!conn->abort_indicator && !_abort_indicator && (nbytes = wget_tcp_read(conn->tcp, buf, bufsize)) > 0) {
 			body_len += nbytes;
 			// debug_printf("nbytes %zd total %zu\n", nbytes, body_len);
 			resp->cur_downloaded += nbytes;
-			wget_decompress(dc, buf, nbytes);
+			if (_feed_body(resp, dc, buf, nbytes))
+				break;
 		}
 		resp->content_length = body_len;
 	}
@@ -1284,10 +1733,12 @@ wget_http_response_t *wget_http_get_response_cb(wget_http_connection_t *conn)
 cleanup:
 
 	if (resp)
-		resp->response_end = wget_get_timemillis();
+		resp->response_end = wget_get_timemillis_coarse();
 
 	wget_decompress_close(dc);
 
+	wget_alloc_tag(old_tag);
+
 	return resp;
 }
 
@@ -1410,6 +1861,29 @@ int wget_http_set_no_proxy(const char *no_proxy, const char *encoding)
 	return 0;
 }
 
+/**Tells whether requests for \p iri would go through a configured proxy.
+ * \param iri a wget_iri_t
+ * \return True if a proxy is set for the IRI's scheme and the host is not
+ *         excluded via the no-proxy list
+ *
+ * Lets connection caches decide if a proxied connection (which carries
+ * absolute URIs and can serve any downstream host) may be reused for this
+ * IRI instead of opening a fresh connection to the proxy.
+ */
+bool wget_http_uses_proxy(const wget_iri_t *iri)
+{
+	if (wget_http_match_no_proxy(no_proxies, iri->host))
+		return false;
+
+	if (iri->scheme == WGET_IRI_SCHEME_HTTP)
+		return wget_vector_size(http_proxies) > 0;
+
+	if (iri->scheme == WGET_IRI_SCHEME_HTTPS)
+		return wget_vector_size(https_proxies) > 0;
+
+	return false;
+}
+
 int wget_http_match_no_proxy(wget_vector_t *no_proxies_vec, const char *host)
 {
 	if (!no_proxies_vec || !host)
@@ -1448,6 +1922,23 @@ void wget_tcp_set_stats_server(wget_stats_callback_t fn)
 	stats_callback = fn;
 }
 
+/**
+ * \param[in] fn A `wget_http_server_push_callback_t` callback function deciding about pushed streams
+ *
+ * Set the callback function to be called for each HTTP/2 PUSH_PROMISE received.
+ * HTTP/2 server push is announced to servers (SETTINGS_ENABLE_PUSH) only on
+ * connections opened after a callback has been set; passing NULL disables push
+ * for new connections.
+ */
+void wget_http_set_server_push_callback(wget_http_server_push_callback_t fn)
+{
+#ifdef WITH_LIBNGHTTP2
+	server_push_callback = fn;
+#else
+	(void) fn;
+#endif
+}
+
 /**
  * \param[in] type A `wget_server_stats_t` constant representing Server statistical info to return
  * \param[in] _stats An internal  pointer sent to callback function
@@ -33,6 +33,8 @@ struct _wget_http_connection_st {
 		tcp;
 	const char *
 		esc_host;
+	const char *
+		proxy_esc_host; // proxy endpoint serving this connection, NULL for direct
 	const char *
 		scheme;
 	wget_buffer_t *
@@ -40,6 +42,9 @@ struct _wget_http_connection_st {
 #ifdef WITH_LIBNGHTTP2
 	nghttp2_session *
 		http2_session;
+	char
+		*push_authority, // :authority of the PUSH_PROMISE currently being received
+		*push_path; // :path of the PUSH_PROMISE currently being received
 #endif
 	wget_vector_t
 		*pending_requests; // List of unresponsed requests (HTTP1 only)
@@ -48,7 +53,8 @@ struct _wget_http_connection_st {
 	int
 		pending_http2_requests; // Number of unresponsed requests (HTTP2 only)
 	uint16_t
-		port;
+		port,
+		proxy_port;
 	char
 		protocol; // WGET_PROTOCOL_HTTP_1_1 or WGET_PROTOCOL_HTTP_2_0
 	bool
@@ -239,8 +239,11 @@ wget_http_response_t *wget_http_get(int first_key, ...)
 						wget_http_request_set_body_cb(req, _stream_callback, fp);
 						resp = wget_http_get_response(conn);
 						fclose(fp);
-					} else
+					} else {
 						debug_printf("Failed to open '%s' for writing\n", saveas_name);
+						wget_http_close(&conn); // frees the sent but unanswered request
+						req = NULL;
+					}
 				}
 				else if (saveas_stream)  {
 					wget_http_request_set_body_cb(req, _stream_callback, saveas_stream);
@@ -330,3 +333,266 @@ out:
 
 	return resp;
 }
+
+/*
+ * Multi-transfer API: submit many URLs, then let wget_http_multi_perform()
+ * drive them over shared connections - one connection per origin, filled
+ * with parallel streams on HTTP/2 and reused serially (keep-alive) on
+ * HTTP/1.1. DNS and TLS session caches are shared process-wide anyway, so
+ * a consumer gets warm lookups and resumed handshakes without spawning a
+ * thread per URL like examples/http_multi_get.c does.
+ *
+ * Usage:
+ *   wget_http_multi_t *multi = wget_http_multi_init();
+ *   wget_http_multi_add(multi, "https://example.com/a", my_data);
+ *   wget_http_multi_add(multi, "https://example.com/b", my_data);
+ *   wget_http_multi_perform(multi, my_callback); // callback per completion
+ *   wget_http_multi_free(&multi);
+ */
+
+typedef struct {
+	wget_iri_t *
+		iri;
+	void *
+		user_data;
+	int
+		redirects;
+	bool
+		done : 1, // finished, callback has been invoked
+		pending : 1; // request sent, response outstanding
+} multi_job_t;
+
+struct wget_http_multi_st {
+	wget_vector_t
+		*jobs, // multi_job_t entries, in submission order
+		*conns; // open wget_http_connection_t, one per origin seen so far
+};
+
+// how often a single URL may redirect before we give up on it
+#define MULTI_MAX_REDIRECTIONS 5
+
+wget_http_multi_t *wget_http_multi_init(void)
+{
+	wget_http_multi_t *multi = wget_calloc(1, sizeof(wget_http_multi_t));
+
+	multi->jobs = wget_vector_create(32, -2, NULL);
+	multi->conns = wget_vector_create(4, -2, NULL);
+
+	return multi;
+}
+
+int wget_http_multi_add(wget_http_multi_t *multi, const char *url, void *user_data)
+{
+	multi_job_t job = { .user_data = user_data };
+
+	if (!(job.iri = wget_iri_parse(url, NULL))) {
+		error_printf(_("Error parsing URL '%s'\n"), url);
+		return WGET_E_INVALID;
+	}
+
+	wget_vector_add(multi->jobs, &job, sizeof(job));
+
+	return WGET_E_SUCCESS;
+}
+
+static bool _same_origin(const wget_http_connection_t *conn, const wget_iri_t *iri)
+{
+	return !wget_strcmp(conn->esc_host, iri->host)
+		&& conn->scheme == iri->scheme
+		&& conn->port == iri->port;
+}
+
+// connection serving <iri>'s origin: a cached one, or freshly opened
+static wget_http_connection_t *_multi_connect(wget_http_multi_t *multi, const wget_iri_t *iri)
+{
+	wget_http_connection_t *conn;
+
+	for (int it = 0; it < wget_vector_size(multi->conns); it++) {
+		conn = wget_vector_get(multi->conns, it);
+
+		if (_same_origin(conn, iri))
+			return conn;
+	}
+
+	conn = NULL;
+	if (wget_http_open(&conn, iri) == WGET_E_SUCCESS)
+		wget_vector_add_noalloc(multi->conns, conn);
+
+	return conn;
+}
+
+static void _multi_disconnect(wget_http_multi_t *multi, wget_http_connection_t *conn)
+{
+	for (int it = 0; it < wget_vector_size(multi->conns); it++) {
+		if (wget_vector_get(multi->conns, it) == conn) {
+			wget_vector_remove_nofree(multi->conns, it);
+			break;
+		}
+	}
+
+	wget_http_close(&conn); // also frees sent but unanswered requests
+}
+
+// finish <job>: hand the response (NULL on failure) to the callback,
+// then take it out of the race
+static void _multi_done(multi_job_t *job, wget_http_response_t *resp, wget_http_multi_callback_t *cb)
+{
+	job->done = 1;
+	job->pending = 0;
+
+	if (cb)
+		cb(resp, job->iri, job->user_data);
+
+	wget_http_free_response(&resp);
+}
+
+int wget_http_multi_perform(wget_http_multi_t *multi, wget_http_multi_callback_t *cb)
+{
+	wget_cookie_db_t *cookie_db = NULL;
+	int completed = 0;
+
+	if (wget_global_get_int(WGET_COOKIES_ENABLED))
+		cookie_db = (wget_cookie_db_t *) wget_global_get_ptr(WGET_COOKIE_DB);
+
+	for (int it = 0; it < wget_vector_size(multi->jobs); it++) {
+		multi_job_t *job = wget_vector_get(multi->jobs, it);
+		wget_http_connection_t *conn;
+		int window, pending = 0;
+
+		if (job->done)
+			continue;
+
+		if (!(conn = _multi_connect(multi, job->iri))) {
+			_multi_done(job, NULL, cb);
+			continue;
+		}
+
+		// HTTP/2 carries a whole batch in parallel streams, HTTP/1.1
+		// reuses the connection one request at a time (keep-alive)
+		if (wget_http_get_protocol(conn) == WGET_PROTOCOL_HTTP_2_0)
+			window = wget_http_get_max_concurrent_streams(conn);
+		else
+			window = 1;
+
+		// fill the connection with same-origin jobs, starting at <it>
+		for (int jt = it; jt < wget_vector_size(multi->jobs) && pending < window; jt++) {
+			multi_job_t *job2 = wget_vector_get(multi->jobs, jt);
+			wget_http_request_t *req;
+
+			if (job2->done || job2->pending || !_same_origin(conn, job2->iri))
+				continue;
+
+			req = wget_http_create_request(job2->iri, "GET");
+			wget_http_add_header(req, "Connection", "keep-alive");
+			wget_http_request_set_int(req, WGET_HTTP_RESPONSE_KEEPHEADER, 1);
+			wget_http_request_set_ptr(req, WGET_HTTP_USER_DATA, job2);
+
+			if (cookie_db) {
+				const char *cookie_string;
+
+				if ((cookie_string = wget_cookie_create_request_header(cookie_db, job2->iri))) {
+					wget_http_add_header(req, "Cookie", cookie_string);
+					xfree(cookie_string);
+				}
+			}
+
+			if (wget_http_send_request(conn, req)) {
+				wget_http_free_request(&req);
+				_multi_done(job2, NULL, cb);
+				break; // connection is in doubt, just drain what was sent
+			}
+
+			job2->pending = 1;
+			pending++;
+		}
+
+		// drain the batch - responses come back in stream/request order
+		bool keep_alive = true;
+
+		while (pending > 0) {
+			wget_http_response_t *resp = wget_http_get_response(conn);
+			multi_job_t *job2;
+
+			if (!resp) {
+				// connection died, fail whatever is still in flight
+				for (int jt = 0; jt < wget_vector_size(multi->jobs); jt++) {
+					job2 = wget_vector_get(multi->jobs, jt);
+
+					if (job2->pending)
+						_multi_done(job2, NULL, cb);
+				}
+				_multi_disconnect(multi, conn);
+				conn = NULL;
+				break;
+			}
+
+			job2 = resp->req->user_data;
+			wget_http_free_request(&resp->req);
+			job2->pending = 0;
+			pending--;
+
+			if (!resp->keep_alive)
+				keep_alive = false;
+
+			if (cookie_db) {
+				wget_cookie_normalize_cookies(job2->iri, resp->cookies);
+				wget_cookie_store_cookies(cookie_db, resp->cookies);
+			}
+
+			if (resp->code / 100 == 3 && resp->location && job2->redirects < MULTI_MAX_REDIRECTIONS) {
+				char uri_sbuf[1024];
+				wget_buffer_t uri_buf;
+				wget_iri_t *next;
+
+				wget_buffer_init(&uri_buf, uri_sbuf, sizeof(uri_sbuf));
+				wget_iri_relative_to_abs(job2->iri, resp->location, strlen(resp->location), &uri_buf);
+				next = wget_iri_parse(uri_buf.data, NULL);
+				wget_buffer_deinit(&uri_buf);
+
+				if (next) {
+					// leave the job undone under its new IRI, a later pass
+					// (possibly over another origin's connection) picks it up
+					wget_iri_free(&job2->iri);
+					job2->iri = next;
+					job2->redirects++;
+					wget_http_free_response(&resp);
+					continue;
+				}
+			}
+
+			completed++;
+			_multi_done(job2, resp, cb);
+		}
+
+		// server doesn't support or want keep-alive
+		if (conn && !keep_alive)
+			_multi_disconnect(multi, conn);
+
+		it--; // rescan from here: redirected jobs may want this slot again
+	}
+
+	return completed;
+}
+
+void wget_http_multi_free(wget_http_multi_t **multi)
+{
+	if (!multi || !*multi)
+		return;
+
+	for (int it = 0; it < wget_vector_size((*multi)->jobs); it++) {
+		multi_job_t *job = wget_vector_get((*multi)->jobs, it);
+
+		wget_iri_free(&job->iri);
+	}
+	wget_vector_free(&(*multi)->jobs);
+
+	for (int it = 0; it < wget_vector_size((*multi)->conns); it++) {
+		wget_http_connection_t *conn = wget_vector_get((*multi)->conns, it);
+
+		wget_http_close(&conn);
+	}
+	wget_vector_clear_nofree((*multi)->conns); // entries were just closed
+	wget_vector_free(&(*multi)->conns);
+
+	xfree(*multi);
+}
@@ -33,6 +33,10 @@
 #include <c-ctype.h>
 #include <time.h>
 #include <errno.h>
+#include <stdint.h>
+#ifdef __SSE2__
+#	include <emmintrin.h>
+#endif
 
 #include <wget.h>
 #include "private.h"
@@ -74,6 +78,25 @@ const char *wget_http_get_host(const wget_http_connection_t *conn)
 	return conn->esc_host;
 }
 
+/**Gets the proxy endpoint a connection goes through.
+ * \param conn a wget_http_connection_t
+ * \return The proxy's hostname, or NULL for a direct connection. Returned
+ *         memory is owned by _conn_ and should not be modified or freed.
+ */
+const char *wget_http_get_proxy_host(const wget_http_connection_t *conn)
+{
+	return conn->proxy_esc_host;
+}
+
+/**Gets the port of the proxy endpoint a connection goes through.
+ * \param conn a wget_http_connection_t
+ * \return The proxy's port, or 0 for a direct connection
+ */
+uint16_t wget_http_get_proxy_port(const wget_http_connection_t *conn)
+{
+	return conn->proxied ? conn->proxy_port : 0;
+}
+
 /**Gets the port number of the remote endpoint.
  * \param conn a wget_http_connection_t
  * \return A string containing port number. Returned memory is owned by
@@ -196,6 +219,99 @@ const char *wget_http_parse_param(const char *s, const char **param, const char
 	return s;
 }
 
+// Content-Type and charset values take only a handful of distinct forms
+// across millions of responses ("text/html", "utf-8", ...). Small per-thread
+// intern table of immortal strings: a hit costs a probe instead of a malloc,
+// and equal values share one pointer (cache locality when aggregating stats).
+// Entries are never replaced or freed, so handing out a pointer is safe
+// without refcounting; when the probe window is occupied by other strings,
+// the caller falls back to an owned allocation.
+#if defined __GNUC__ || defined __clang__
+# define INTERN_TABLE_SIZE 64 // slots per thread, power of two
+# define INTERN_MAX_LEN 64
+# define INTERN_MAX_PROBES 4
+
+typedef struct {
+	char *str;
+	unsigned char len;
+} _intern_slot_t;
+
+static __thread _intern_slot_t
+	_intern_table[INTERN_TABLE_SIZE];
+
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+static const char *_intern(const char *s, size_t len)
+{
+	unsigned int hash = 2166136261u; // FNV-1a
+
+	if (!len || len > INTERN_MAX_LEN)
+		return NULL;
+
+	for (size_t it = 0; it < len; it++)
+		hash = (hash ^ (unsigned char) s[it]) * 16777619u;
+
+	for (int probe = 0; probe < INTERN_MAX_PROBES; probe++) {
+		_intern_slot_t *slot = &_intern_table[(hash + probe) & (INTERN_TABLE_SIZE - 1)];
+
+		if (!slot->str) {
+			slot->str = wget_strmemdup(s, len);
+			slot->len = (unsigned char) len;
+			return slot->str;
+		}
+
+		if (slot->len == len && memcmp(slot->str, s, len) == 0)
+			return slot->str;
+	}
+
+	return NULL; // probe window full of other strings
+}
+#else
+static const char *_intern(const char *s G_GNUC_WGET_UNUSED, size_t len G_GNUC_WGET_UNUSED)
+{
+	return NULL;
+}
+#endif
+
+// scan for byte 'c', 16 bytes at a time where SSE2 is available.
+// Returns a pointer to the first occurrence of 'c' or to the terminating 0.
+// Header scanning burns a measurable share of CPU on crawls with millions
+// of small responses, hence the vectorization. Callers go through the
+// http_scan_byte pointer, which cpu.c repoints at the best variant for
+// the running CPU (scalar until the dispatcher has run).
+const char *http_scan_byte_scalar(const char *s, char c)
+{
+	while (*s && *s != c)
+		s++;
+
+	return s;
+}
+
+#ifdef __SSE2__
+const char *http_scan_byte_sse2(const char *s, char c)
+{
+	const __m128i needle = _mm_set1_epi8(c);
+	const __m128i zero = _mm_setzero_si128();
+
+	// scalar until 16-byte alignment, so the aligned loads below can't
+	// cross into an unmapped page
+	for (; (uintptr_t) s % 16; s++)
+		if (*s == c || !*s)
+			return s;
+
+	for (;; s += 16) {
+		__m128i chunk = _mm_load_si128((const __m128i *) s);
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, needle), _mm_cmpeq_epi8(chunk, zero)));
+
+		if (mask)
+			return s + __builtin_ctz((unsigned) mask);
+	}
+}
+#endif
+
+http_scan_byte_fn http_scan_byte = http_scan_byte_scalar;
+
 // message-header = field-name ":" [ field-value ]
 // field-name     = token
 // field-value    = *( field-content | LWS )
@@ -209,7 +325,7 @@ const char *wget_http_parse_name(const char *s, const char **name)
 
 	s = wget_http_parse_token(s, name);
 
-	while (*s && *s != ':') s++;
+	s = http_scan_byte(s, ':');
 
 	return *s == ':' ? s + 1 : s;
 }
@@ -225,7 +341,7 @@ const char *wget_parse_name_fixed(const char *s, const char **name, size_t *name
 
 	*namelen = s - *name;
 
-	while (*s && *s != ':') s++;
+	s = http_scan_byte(s, ':');
 
 	return *s == ':' ? s + 1 : s;
 }
@@ -355,6 +471,59 @@ const char *wget_http_parse_digest(const char *s, wget_http_digest_t *digest)
 	return s;
 }
 
+// from RFC 7838:
+// Alt-Svc       = clear / 1#alt-value
+// alt-value     = alternative *( OWS ";" OWS parameter )
+// alternative   = protocol-id "=" alt-authority
+// protocol-id   = token ; percent-encoded ALPN protocol name
+// alt-authority = quoted-string ; containing [ uri-host ] ":" port
+
+const char *wget_http_parse_alt_svc(const char *s, wget_http_alt_svc_t *alt_svc)
+{
+	const char *name = NULL, *value = NULL;
+
+	memset(alt_svc, 0, sizeof(*alt_svc));
+	alt_svc->max_age = 24 * 3600; // default freshness as of RFC 7838 3.1
+
+	while (c_isblank(*s)) s++;
+	s = wget_http_parse_token(s, &alt_svc->alpn);
+
+	if (*s == '=') {
+		s++;
+		if (*s == '\"') {
+			const char *authority = NULL, *port;
+
+			s = wget_http_parse_quoted_string(s, &authority);
+
+			if (authority && (port = strrchr(authority, ':'))) {
+				if (port > authority)
+					alt_svc->host = wget_strmemdup(authority, port - authority);
+				alt_svc->port = (uint16_t) atoi(port + 1);
+			}
+			xfree(authority);
+		}
+	}
+
+	while (c_isblank(*s)) s++;
+
+	while (*s == ';') {
+		s = wget_http_parse_param(s, &name, &value);
+
+		if (name && value) {
+			if (!wget_strcasecmp_ascii(name, "ma"))
+				alt_svc->max_age = atoll(value);
+			// 'persist' is a hint we don't act on - alternatives are per-response here
+		}
+
+		xfree(name);
+		xfree(value);
+
+		while (c_isblank(*s)) s++;
+	}
+
+	return s;
+}
+
 // RFC 2617:
 // challenge   = auth-scheme 1*SP 1#auth-param
 // auth-scheme = token
@@ -684,6 +853,8 @@ const char *wget_http_parse_content_encoding(const char *s, char *content_encodi
 		*content_encoding = wget_content_encoding_lzma;
 	else if (!wget_strcasecmp_ascii(s, "br"))
 		*content_encoding = wget_content_encoding_brotli;
+	else if (!wget_strcasecmp_ascii(s, "zstd"))
+		*content_encoding = wget_content_encoding_zstd;
 	else
 		*content_encoding = wget_content_encoding_identity;
 
@@ -810,74 +981,147 @@ month        = "Jan" | "Feb" | "Mar" | "Apr"
 				 | "Sep" | "Oct" | "Nov" | "Dec"
 */
 
-time_t wget_http_parse_full_date(const char *s)
+// Month from its first three letters via a perfect hash: the sum of the
+// lowercased 2nd and 3rd letters is unique across the twelve names
+// (199..229), so a 31-byte table maps it to 1..12. The hash alone would
+// also accept garbage with the right letter sum, so the name is verified.
+static int _parse_mname(const char *s)
 {
-	// we simply can't use strptime() since it requires us to setlocale()
-	// which is not thread-safe !!!
+	static const char mname_tab[31] = {
+		[199 - 199] = 2,  // Feb
+		[200 - 199] = 12, // Dec
+		[207 - 199] = 1,  // Jan
+		[211 - 199] = 3,  // Mar
+		[213 - 199] = 9,  // Sep
+		[215 - 199] = 10, // Oct
+		[218 - 199] = 5,  // May
+		[220 - 199] = 8,  // Aug
+		[225 - 199] = 7,  // Jul
+		[226 - 199] = 4,  // Apr
+		[227 - 199] = 6,  // Jun
+		[229 - 199] = 11, // Nov
+	};
 	static const char *mnames[12] = {
 		"Jan", "Feb", "Mar","Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
 	};
-	static int days_per_month[12] = {
+	unsigned sum = ((unsigned) s[1] | 0x20) + ((unsigned) s[2] | 0x20) - 199;
+	int mon;
+
+	if (sum >= countof(mname_tab) || !(mon = mname_tab[sum]))
+		return 0;
+
+	if (wget_strncasecmp_ascii(s, mnames[mon - 1], 3))
+		return 0;
+
+	return mon;
+}
+
+// calculate time_t from broken-down GMT/UTC time values, -1 on invalid fields
+static time_t _date_to_unixtime(int day, int mon, int year, int hour, int min, int sec)
+{
+	static const int days_per_month[12] = {
 		31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
 	};
 	// cumulated number of days until beginning of month for non-leap years
 	static const int sum_of_days[12] = {
 		0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
 	};
+	int leap_month, leap_year, days;
 
-	int day, mon = 0, year, hour, min, sec, leap_month, leap_year, days;
-	char mname[4] = "";
+	if (year < 70 && year >= 0) year += 2000;
+	else if (year >= 70 && year <= 99) year += 1900;
+	if (year < 1970) year = 1970;
 
-	if (sscanf(s, " %*[a-zA-Z], %02d %3s %4d %2d:%2d:%2d", &day, mname, &year, &hour, &min, &sec) >= 6) {
+	// we don't handle leap seconds
+
+	leap_year = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+	leap_month = (mon == 2 && leap_year);
+
+	if (mon < 1 || mon > 12 || day < 1 || (day > days_per_month[mon - 1] + leap_month) ||
+		hour < 0 || hour > 23 || min < 0 || min > 60 || sec < 0 || sec > 60)
+	{
+		return -1;
+	}
+
+	days = 365 * (year - 1970) + leap_days(1970, year);
+	days += sum_of_days[mon - 1] + (mon > 2 && leap_year);
+	days += day - 1;
+
+	return (((time_t)days * 24 + hour) * 60 + min) * 60 + sec;
+}
+
+// Memo for the last date string seen by this thread - Last-Modified and
+// cookie Expires values repeat heavily within a crawl (same generator,
+// same second), so a repeat costs one compare instead of a parse.
+typedef struct {
+	char str[32];
+	time_t t;
+	unsigned char len;
+} _date_memo_t;
+
+static __thread _date_memo_t
+	_date_memo;
+
+time_t wget_http_parse_full_date(const char *s)
+{
+	int day, mon, year, hour, min, sec;
+	char mname[4] = "";
+	size_t len = strlen(s);
+	time_t t;
+
+	if (len && len == _date_memo.len && memcmp(_date_memo.str, s, len) == 0)
+		return _date_memo.t;
+
+	// fast path for IMF-fixdate, the dominant format on the wire:
+	// "Sun, 06 Nov 1994 08:37:18 GMT" - every field sits at a fixed offset
+	if (len >= 25 && s[3] == ',' && s[4] == ' '
+		&& c_isdigit(s[5]) && c_isdigit(s[6]) && s[7] == ' ' && s[11] == ' '
+		&& c_isdigit(s[12]) && c_isdigit(s[13]) && c_isdigit(s[14]) && c_isdigit(s[15]) && s[16] == ' '
+		&& c_isdigit(s[17]) && c_isdigit(s[18]) && s[19] == ':'
+		&& c_isdigit(s[20]) && c_isdigit(s[21]) && s[22] == ':'
+		&& c_isdigit(s[23]) && c_isdigit(s[24])
+		&& (mon = _parse_mname(s + 8)))
+	{
+		day = (s[5] - '0') * 10 + (s[6] - '0');
+		year = ((s[12] - '0') * 10 + (s[13] - '0')) * 100 + (s[14] - '0') * 10 + (s[15] - '0');
+		hour = (s[17] - '0') * 10 + (s[18] - '0');
+		min = (s[20] - '0') * 10 + (s[21] - '0');
+		sec = (s[23] - '0') * 10 + (s[24] - '0');
+	}
+	// we simply can't use strptime() since it requires us to setlocale()
+	// which is not thread-safe !!!
+	else if (sscanf(s, " %*[a-zA-Z], %02d %3s %4d %2d:%2d:%2d", &day, mname, &year, &hour, &min, &sec) >= 6) {
 		// RFC 822 / 1123: Wed, 09 Jun 2021 10:18:14 GMT
+		mon = _parse_mname(mname);
 	}
 	else if (sscanf(s, " %*[a-zA-Z], %2d-%3s-%4d %2d:%2d:%2d", &day, mname, &year, &hour, &min, &sec) >= 6) {
 		// RFC 850 / 1036 or Netscape: Wednesday, 09-Jun-21 10:18:14 or Wed, 09-Jun-2021 10:18:14
+		mon = _parse_mname(mname);
 	}
 	else if (sscanf(s, " %*[a-zA-Z] %3s %2d %2d:%2d:%2d %4d", mname, &day, &hour, &min, &sec, &year) >= 6) {
 		// ANSI C's asctime(): Wed Jun 09 10:18:14 2021
+		mon = _parse_mname(mname);
 	}
 	else if (sscanf(s, " %d %3s %4d %2d:%2d:%2d", &day, mname, &year, &hour, &min, &sec) >= 6) {
 		// non-standard: 1 Mar 2027 09:23:12 GMT
+		mon = _parse_mname(mname);
 	} else {
 		error_printf(_("Failed to parse date '%s'\n"), s);
 		return 0; // return as session cookie
 	}
 
-	if (*mname) {
-		unsigned it;
-
-		for (it = 0; it < countof(mnames); it++) {
-			if (!wget_strcasecmp_ascii(mname, mnames[it])) {
-				mon = it + 1;
-				break;
-			}
-		}
-	}
-
-	if (year < 70 && year >= 0) year += 2000;
-	else if (year >= 70 && year <= 99) year += 1900;
-	if (year < 1970) year = 1970;
-
-	// we don't handle leap seconds
-
-	leap_year = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
-	leap_month = (mon == 2 && leap_year);
-
-	if (mon < 1 || mon > 12 || day < 1 || (day > days_per_month[mon - 1] + leap_month) ||
-		hour < 0 || hour > 23 || min < 0 || min > 60 || sec < 0 || sec > 60)
-	{
+	if ((t = _date_to_unixtime(day, mon, year, hour, min, sec)) == -1) {
 		error_printf(_("Failed to parse date '%s'\n"), s);
 		return 0; // return as session cookie
 	}
 
-	// calculate time_t from GMT/UTC time values
-
-	days = 365 * (year - 1970) + leap_days(1970, year);
-	days += sum_of_days[mon - 1] + (mon > 2 && leap_year);
-	days += day - 1;
+	if (len < sizeof(_date_memo.str)) {
+		memcpy(_date_memo.str, s, len);
+		_date_memo.len = (unsigned char) len;
+		_date_memo.t = t;
+	}
 
-	return (((time_t)days * 24 + hour) * 60 + min) * 60 + sec;
+	return t;
 }
 
 char *wget_http_print_date(time_t t, char *buf, size_t bufsize)
@@ -1030,162 +1274,390 @@ const char *wget_http_parse_setcookie(const char *s, wget_cookie_t **cookie)
 	return wget_cookie_parse_setcookie(s, cookie);
 }
 
+// Each known response header has its own handler function. Dispatch goes
+// through a table sorted by (name length, name), so parsing a header field
+// costs one binary search plus one case-insensitive verify instead of a
+// cascade of string compares.
+
+typedef struct {
+	const char *
+		name;
+	wget_http_header_handler_t *
+		handler;
+	unsigned char
+		namelen;
+} _header_handler_t;
+
+static int _handle_content_encoding(wget_http_response_t *resp, const char *value)
+{
+	wget_http_parse_content_encoding(value, &resp->content_encoding);
+	return 0;
+}
+
+// open-coded variant of wget_http_parse_content_type() that shares the
+// media type and charset strings through the intern table where possible
+static int _handle_content_type(wget_http_response_t *resp, const char *value)
+{
+	if (!resp->content_type && !resp->content_type_encoding) {
+		wget_http_header_param_t param;
+		const char *s = value, *p;
+
+		while (c_isblank(*s)) s++;
+
+		for (p = s; *s && (wget_http_istoken(*s) || *s == '/'); s++);
+
+		if ((resp->content_type = _intern(p, s - p)))
+			resp->content_type_interned = 1;
+		else
+			resp->content_type = wget_strmemdup(p, s - p);
+
+		while (*s) {
+			s = wget_http_parse_param(s, &param.name, &param.value);
+			if (!wget_strcasecmp_ascii("charset", param.name)) {
+				xfree(param.name);
+				if (param.value && (resp->content_type_encoding = _intern(param.value, strlen(param.value)))) {
+					resp->content_type_encoding_interned = 1;
+					xfree(param.value);
+				} else
+					resp->content_type_encoding = param.value;
+				break;
+			}
+			xfree(param.name);
+			xfree(param.value);
+		}
+	}
+	return 0;
+}
+
+static int _handle_content_length(wget_http_response_t *resp, const char *value)
+{
+	resp->content_length = (size_t)atoll(value);
+	resp->content_length_valid = 1;
+	return 0;
+}
+
+static int _handle_content_disposition(wget_http_response_t *resp, const char *value)
+{
+	if (!resp->content_filename)
+		wget_http_parse_content_disposition(value, &resp->content_filename);
+	return 0;
+}
+
+static int _handle_connection(wget_http_response_t *resp, const char *value)
+{
+	wget_http_parse_connection(value, &resp->keep_alive);
+	return 0;
+}
+
+static int _handle_csp(wget_http_response_t *resp, const char *value G_GNUC_WGET_UNUSED)
+{
+	resp->csp = 1;
+	return 0;
+}
+
+static int _handle_digest(wget_http_response_t *resp, const char *value)
+{
+	// https://tools.ietf.org/html/rfc3230
+	wget_http_digest_t digest;
+	wget_http_parse_digest(value, &digest);
+	// debug_printf("%s: %s\n",digest.algorithm,digest.encoded_digest);
+	if (!resp->digests) {
+		resp->digests = wget_vector_create(4, 4, NULL);
+		wget_vector_set_destructor(resp->digests, (wget_vector_destructor_t)wget_http_free_digest);
+	}
+	wget_vector_add(resp->digests, &digest, sizeof(digest));
+	return 0;
+}
+
+static int _handle_etag(wget_http_response_t *resp, const char *value)
+{
+	if (!resp->etag)
+		wget_http_parse_etag(value, &resp->etag);
+	return 0;
+}
+
+static int _handle_icy_metaint(wget_http_response_t *resp, const char *value)
+{
+	resp->icy_metaint = atoi(value);
+	return 0;
+}
+
+static int _handle_accept_ranges(wget_http_response_t *resp, const char *value)
+{
+	resp->accept_ranges = !wget_strcasecmp_ascii(value, "bytes");
+	return 0;
+}
+
+static int _handle_last_modified(wget_http_response_t *resp, const char *value)
+{
+	// Last-Modified: Thu, 07 Feb 2008 15:03:24 GMT
+	resp->last_modified = wget_http_parse_full_date(value);
+	return 0;
+}
+
+static int _handle_location(wget_http_response_t *resp, const char *value)
+{
+	if (resp->code / 100 != 3)
+		return -1;
+	if (!resp->location)
+		wget_http_parse_location(value, &resp->location);
+	return 0;
+}
+
+static int _handle_link(wget_http_response_t *resp, const char *value)
+{
+	if (resp->code / 100 != 3)
+		return -1;
+	// debug_printf("s=%.31s\n",s);
+	wget_http_link_t link;
+	wget_http_parse_link(value, &link);
+	// debug_printf("link->uri=%s\n",link.uri);
+	if (!resp->links) {
+		resp->links = wget_vector_create(8, 8, NULL);
+		wget_vector_set_destructor(resp->links, (wget_vector_destructor_t)wget_http_free_link);
+	}
+	wget_vector_add(resp->links, &link, sizeof(link));
+	return 0;
+}
+
+static int _handle_alt_svc(wget_http_response_t *resp, const char *value)
+{
+	// https://tools.ietf.org/html/rfc7838
+	const char *s = value;
+
+	while (*s) {
+		wget_http_alt_svc_t alt_svc;
+
+		s = wget_http_parse_alt_svc(s, &alt_svc);
+
+		if (alt_svc.alpn && !wget_strcasecmp_ascii(alt_svc.alpn, "clear")) {
+			// the origin invalidates all alternatives announced earlier
+			wget_http_free_alt_svc(&alt_svc);
+			wget_http_free_alt_svcs(&resp->alt_svcs);
+			break;
+		}
+
+		if (alt_svc.alpn && alt_svc.port) {
+			if (!resp->alt_svcs) {
+				resp->alt_svcs = wget_vector_create(2, 2, NULL);
+				wget_vector_set_destructor(resp->alt_svcs, (wget_vector_destructor_t)wget_http_free_alt_svc);
+			}
+			wget_vector_add(resp->alt_svcs, &alt_svc, sizeof(alt_svc));
+		} else
+			wget_http_free_alt_svc(&alt_svc);
+
+		while (c_isblank(*s)) s++;
+		if (*s != ',')
+			break;
+		s++;
+	}
+
+	return 0;
+}
+
+static int _handle_public_key_pins(wget_http_response_t *resp, const char *value)
+{
+	if (!resp->hpkp) {
+		resp->hpkp = wget_hpkp_new();
+		wget_http_parse_public_key_pins(value, resp->hpkp);
+		debug_printf("new host pubkey pinnings added to hpkp db\n");
+	}
+	return 0;
+}
+
+// handles both WWW-Authenticate and Proxy-Authenticate
+static int _handle_authenticate(wget_http_response_t *resp, const char *value)
+{
+	wget_http_challenge_t challenge;
+	wget_http_parse_challenge(value, &challenge);
+
+	if (!resp->challenges) {
+		resp->challenges = wget_vector_create(2, 2, NULL);
+		wget_vector_set_destructor(resp->challenges, (wget_vector_destructor_t)wget_http_free_challenge);
+	}
+	wget_vector_add(resp->challenges, &challenge, sizeof(challenge));
+	return 0;
+}
+
+static int _handle_set_cookie(wget_http_response_t *resp, const char *value)
+{
+	// this is a parser. content validation must be done by higher level functions.
+	wget_cookie_t *cookie;
+	wget_http_parse_setcookie(value, &cookie);
+
+	if (cookie) {
+		if (!resp->cookies) {
+			resp->cookies = wget_vector_create(4, 4, NULL);
+			wget_vector_set_destructor(resp->cookies, (wget_vector_destructor_t) wget_cookie_deinit);
+		}
+		wget_vector_add_noalloc(resp->cookies, cookie);
+	}
+	return 0;
+}
+
+static int _handle_hsts(wget_http_response_t *resp, const char *value)
+{
+	resp->hsts = 1;
+	wget_http_parse_strict_transport_security(value, &resp->hsts_maxage, &resp->hsts_include_subdomains);
+	return 0;
+}
+
+static int _handle_transfer_encoding(wget_http_response_t *resp, const char *value)
+{
+	wget_http_parse_transfer_encoding(value, &resp->transfer_encoding);
+	return 0;
+}
+
+// sorted by (namelen, name) - the order the binary search expects
+static const _header_handler_t known_headers[] = {
+	{ "etag", _handle_etag, 4 },
+	{ "link", _handle_link, 4 },
+	{ "digest", _handle_digest, 6 },
+	{ "alt-svc", _handle_alt_svc, 7 },
+	{ "location", _handle_location, 8 },
+	{ "connection", _handle_connection, 10 },
+	{ "set-cookie", _handle_set_cookie, 10 },
+	{ "icy-metaint", _handle_icy_metaint, 11 },
+	{ "content-type", _handle_content_type, 12 },
+	{ "accept-ranges", _handle_accept_ranges, 13 },
+	{ "last-modified", _handle_last_modified, 13 },
+	{ "content-length", _handle_content_length, 14 },
+	{ "public-key-pins", _handle_public_key_pins, 15 },
+	{ "content-encoding", _handle_content_encoding, 16 },
+	{ "www-authenticate", _handle_authenticate, 16 },
+	{ "transfer-encoding", _handle_transfer_encoding, 17 },
+	{ "proxy-authenticate", _handle_authenticate, 18 },
+	{ "content-disposition", _handle_content_disposition, 19 },
+	{ "content-security-policy", _handle_csp, 23 },
+	{ "strict-transport-security", _handle_hsts, 25 },
+	{ "x-archive-orig-last-modified", _handle_last_modified, 28 },
+};
+
+// handlers registered at runtime, e.g. by plugins (sorted like known_headers[])
+static wget_vector_t
+	*extra_header_handlers;
+static wget_thread_mutex_t
+	extra_handlers_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static int _compare_header_handler(const void *p1, const void *p2)
+{
+	const _header_handler_t *h1 = p1, *h2 = p2;
+
+	if (h1->namelen != h2->namelen)
+		return h1->namelen < h2->namelen ? -1 : 1;
+
+	return wget_strncasecmp_ascii(h1->name, h2->name, h1->namelen);
+}
+
+static wget_http_header_handler_t *_find_header_handler(const char *name, size_t namelen)
+{
+	_header_handler_t key = { .name = name, .namelen = (unsigned char) namelen };
+	const _header_handler_t *entry;
+
+	if (namelen > 255)
+		return NULL; // longer than any known or registrable header name
+
+	if ((entry = bsearch(&key, known_headers, countof(known_headers), sizeof(known_headers[0]), _compare_header_handler)))
+		return entry->handler;
+
+	if (extra_header_handlers) {
+		int pos = wget_vector_find(extra_header_handlers, &key);
+
+		if (pos >= 0)
+			return ((_header_handler_t *) wget_vector_get(extra_header_handlers, pos))->handler;
+	}
+
+	return NULL;
+}
+
+static void _free_header_handler(_header_handler_t *h)
+{
+	xfree(h->name);
+}
+
+/**
+ * \param[in] name Header field name, case-insensitive
+ * \param[in] handler Function to be called with the response and the 0-terminated field value, or NULL to unregister
+ * \return WGET_E_SUCCESS on success, else WGET_E_INVALID
+ *
+ * Register a handler for a response header field that the built-in parser doesn't
+ * know about, e.g. from a plugin. The handler is dispatched from the same sorted
+ * table lookup as the built-in headers, so extra headers don't slow down parsing.
+ * Built-in headers can't be overridden.
+ *
+ * Calling with \p handler == NULL unregisters \p name, calling with
+ * \p name == NULL frees all registered handlers.
+ */
+int wget_http_register_header_handler(const char *name, wget_http_header_handler_t *handler)
+{
+	int pos;
+
+	if (!name) {
+		wget_thread_mutex_lock(&extra_handlers_mutex);
+		wget_vector_free(&extra_header_handlers);
+		wget_thread_mutex_unlock(&extra_handlers_mutex);
+		return WGET_E_SUCCESS;
+	}
+
+	size_t namelen = strlen(name);
+
+	if (!namelen || namelen > 255)
+		return WGET_E_INVALID;
+
+	_header_handler_t h = { .name = name, .handler = handler, .namelen = (unsigned char) namelen };
+
+	if (bsearch(&h, known_headers, countof(known_headers), sizeof(known_headers[0]), _compare_header_handler))
+		return WGET_E_INVALID; // built-in headers can't be overridden
+
+	wget_thread_mutex_lock(&extra_handlers_mutex);
+
+	if (!extra_header_handlers) {
+		extra_header_handlers = wget_vector_create(4, 4, (wget_vector_compare_t) _compare_header_handler);
+		wget_vector_set_destructor(extra_header_handlers, (wget_vector_destructor_t) _free_header_handler);
+	}
+
+	if ((pos = wget_vector_find(extra_header_handlers, &h)) >= 0)
+		wget_vector_remove(extra_header_handlers, pos);
+
+	if (handler) {
+		h.name = wget_strdup(name);
+		wget_vector_insert_sorted(extra_header_handlers, &h, sizeof(h));
+	}
+
+	wget_thread_mutex_unlock(&extra_handlers_mutex);
+
+	return WGET_E_SUCCESS;
+}
+
 int wget_http_parse_header_line(wget_http_response_t *resp, const char *name, size_t namelen, const char *value, size_t valuelen)
 {
 	if (!name || !value)
 		return -1;
 
+	if (*name == ':') {
+		// HTTP/2 pseudo header
+		if (namelen == 7 && !memcmp(name, ":status", 7) && valuelen == 3) {
+			resp->code = ((value[0] - '0') * 10 + (value[1] - '0')) * 10 + (value[2] - '0');
+			return 0;
+		}
+		return -1;
+	}
+
+	wget_http_header_handler_t *handler = _find_header_handler(name, namelen);
+
+	if (!handler)
+		return -1; // unknown header, don't even copy the value
+
 	char valuebuf[256];
 	char *value0;
-	int ret = 0;
+	int ret;
 
 	if (valuelen < sizeof(valuebuf))
 		wget_strmemcpy(value0 = valuebuf, sizeof(valuebuf), value, valuelen);
 	else
 		value0 = wget_strmemdup(value, valuelen);
 
-	switch (*name | 0x20) {
-	case ':':
-		if (!memcmp(name, ":status", namelen) && valuelen == 3) {
-			resp->code = ((value[0] - '0') * 10 + (value[1] - '0')) * 10 + (value[2] - '0');
-		} else
-			ret = -1;
-		break;
-	case 'c':
-		if (!wget_strncasecmp_ascii(name, "content-encoding", namelen)) {
-			wget_http_parse_content_encoding(value0, &resp->content_encoding);
-		} else if (!wget_strncasecmp_ascii(name, "content-type", namelen)) {
-			if (!resp->content_type && !resp->content_type_encoding)
-				wget_http_parse_content_type(value0, &resp->content_type, &resp->content_type_encoding);
-		} else if (!wget_strncasecmp_ascii(name, "content-length", namelen)) {
-			resp->content_length = (size_t)atoll(value0);
-			resp->content_length_valid = 1;
-		} else if (!wget_strncasecmp_ascii(name, "content-disposition", namelen)) {
-			if (!resp->content_filename)
-				wget_http_parse_content_disposition(value0, &resp->content_filename);
-		} else if (!wget_strncasecmp_ascii(name, "connection", namelen)) {
-			wget_http_parse_connection(value0, &resp->keep_alive);
-		} else if (!wget_strncasecmp_ascii(name, "Content-Security-Policy", namelen)) {
-			resp->csp = 1;
-		} else
-			ret = -1;
-		break;
-	case 'd':
-		if (!wget_strncasecmp_ascii(name, "digest", namelen)) {
-			// https://tools.ietf.org/html/rfc3230
-			wget_http_digest_t digest;
-			wget_http_parse_digest(value0, &digest);
-			// debug_printf("%s: %s\n",digest.algorithm,digest.encoded_digest);
-			if (!resp->digests) {
-				resp->digests = wget_vector_create(4, 4, NULL);
-				wget_vector_set_destructor(resp->digests, (wget_vector_destructor_t)wget_http_free_digest);
-			}
-			wget_vector_add(resp->digests, &digest, sizeof(digest));
-		} else
-			ret = -1;
-		break;
-	case 'e':
-		if (!wget_strncasecmp_ascii(name, "etag", namelen)) {
-			if (!resp->etag)
-				wget_http_parse_etag(value0, &resp->etag);
-		} else
-			ret = -1;
-		break;
-	case 'i':
-		if (!wget_strncasecmp_ascii(name, "icy-metaint", namelen)) {
-			resp->icy_metaint = atoi(value0);
-		} else
-			ret = -1;
-		break;
-	case 'l':
-		if (!wget_strncasecmp_ascii(name, "last-modified", namelen)) {
-			// Last-Modified: Thu, 07 Feb 2008 15:03:24 GMT
-			resp->last_modified = wget_http_parse_full_date(value0);
-		} else if (resp->code / 100 == 3 && !wget_strncasecmp_ascii(name, "location", namelen)) {
-			if (!resp->location)
-				wget_http_parse_location(value0, &resp->location);
-		} else if (resp->code / 100 == 3 && !wget_strncasecmp_ascii(name, "link", namelen)) {
-			// debug_printf("s=%.31s\n",s);
-			wget_http_link_t link;
-			wget_http_parse_link(value0, &link);
-			// debug_printf("link->uri=%s\n",link.uri);
-			if (!resp->links) {
-				resp->links = wget_vector_create(8, 8, NULL);
-				wget_vector_set_destructor(resp->links, (wget_vector_destructor_t)wget_http_free_link);
-			}
-			wget_vector_add(resp->links, &link, sizeof(link));
-		} else
-			ret = -1;
-		break;
-	case 'p':
-		if (!wget_strncasecmp_ascii(name, "public-key-pins", namelen)) {
-			if (!resp->hpkp) {
-				resp->hpkp = wget_hpkp_new();
-				wget_http_parse_public_key_pins(value0, resp->hpkp);
-				debug_printf("new host pubkey pinnings added to hpkp db\n");
-			}
-		}
-		else if (!wget_strncasecmp_ascii(name, "proxy-authenticate", namelen)) {
-			wget_http_challenge_t challenge;
-			wget_http_parse_challenge(value0, &challenge);
-
-			if (!resp->challenges) {
-				resp->challenges = wget_vector_create(2, 2, NULL);
-				wget_vector_set_destructor(resp->challenges, (wget_vector_destructor_t)wget_http_free_challenge);
-			}
-			wget_vector_add(resp->challenges, &challenge, sizeof(challenge));
-		} else
-			ret = -1;
-		break;
-	case 's':
-		if (!wget_strncasecmp_ascii(name, "set-cookie", namelen)) {
-			// this is a parser. content validation must be done by higher level functions.
-			wget_cookie_t *cookie;
-			wget_http_parse_setcookie(value0, &cookie);
-
-			if (cookie) {
-				if (!resp->cookies) {
-					resp->cookies = wget_vector_create(4, 4, NULL);
-					wget_vector_set_destructor(resp->cookies, (wget_vector_destructor_t) wget_cookie_deinit);
-				}
-				wget_vector_add_noalloc(resp->cookies, cookie);
-			}
-		}
-		else if (!wget_strncasecmp_ascii(name, "strict-transport-security", namelen)) {
-			resp->hsts = 1;
-			wget_http_parse_strict_transport_security(value0, &resp->hsts_maxage, &resp->hsts_include_subdomains);
-		} else
-			ret = -1;
-		break;
-	case 't':
-		if (!wget_strncasecmp_ascii(name, "transfer-encoding", namelen)) {
-			wget_http_parse_transfer_encoding(value0, &resp->transfer_encoding);
-		} else
-			ret = -1;
-		break;
-	case 'w':
-		if (!wget_strncasecmp_ascii(name, "www-authenticate", namelen)) {
-			wget_http_challenge_t challenge;
-			wget_http_parse_challenge(value0, &challenge);
-
-			if (!resp->challenges) {
-				resp->challenges = wget_vector_create(2, 2, NULL);
-				wget_vector_set_destructor(resp->challenges, (wget_vector_destructor_t)wget_http_free_challenge);
-			}
-			wget_vector_add(resp->challenges, &challenge, sizeof(challenge));
-		} else
-			ret = -1;
-		break;
-	case 'x':
-		if (!wget_strncasecmp_ascii(name, "x-archive-orig-last-modified", namelen)) {
-			resp->last_modified = wget_http_parse_full_date(value0);
-		} else
-			ret = -1;
-		break;
-	default:
-		ret = -1;
-		break;
-	}
+	ret = handler(resp, value0);
 
 	if (value0 != valuebuf)
 		xfree(value0);
@@ -1229,12 +1701,15 @@ wget_http_response_t *wget_http_parse_response_header(char *buf)
 	}
 
 	for (line = eol + 1; eol && *line && *line != '\r' && *line != '\n'; line = eol + 1) {
-		eol = strchr(line, '\n');
-		while (eol && c_isblank(eol[1])) { // handle split lines
+		eol = (char *) http_scan_byte(line, '\n');
+		while (*eol && c_isblank(eol[1])) { // handle split lines
 			*eol = eol[-1] = ' ';
-			eol = strchr(eol, '\n');
+			eol = (char *) http_scan_byte(eol, '\n');
 		}
 
+		if (!*eol)
+			eol = NULL; // header not terminated by a newline
+
 		if (eol) {
 			if (eol[-1] == '\r')
 				eol[-1] = 0;
@@ -1275,8 +1750,10 @@ wget_http_response_t *wget_http_parse_response_header(char *buf)
 
 int wget_http_free_param(wget_http_header_param_t *param)
 {
-	xfree(param->name);
-	xfree(param->value);
+	if (!param->is_static) {
+		xfree(param->name);
+		xfree(param->value);
+	}
 	return 0;
 }
 
@@ -1302,6 +1779,17 @@ void wget_http_free_digests(wget_vector_t **digests)
 	wget_vector_free(digests);
 }
 
+void wget_http_free_alt_svc(wget_http_alt_svc_t *alt_svc)
+{
+	xfree(alt_svc->alpn);
+	xfree(alt_svc->host);
+}
+
+void wget_http_free_alt_svcs(wget_vector_t **alt_svcs)
+{
+	wget_vector_free(alt_svcs);
+}
+
 void wget_http_free_challenge(wget_http_challenge_t *challenge)
 {
 	xfree(challenge->auth_scheme);
@@ -1331,17 +1819,20 @@ void wget_http_free_response(wget_http_response_t **resp)
 	if (resp && *resp) {
 		wget_http_free_links(&(*resp)->links);
 		wget_http_free_digests(&(*resp)->digests);
+		wget_http_free_alt_svcs(&(*resp)->alt_svcs);
 		wget_http_free_challenges(&(*resp)->challenges);
 		wget_http_free_cookies(&(*resp)->cookies);
 		wget_http_free_hpkp_entries(&(*resp)->hpkp);
-		xfree((*resp)->content_type);
-		xfree((*resp)->content_type_encoding);
+		if (!(*resp)->content_type_interned)
+			xfree((*resp)->content_type);
+		if (!(*resp)->content_type_encoding_interned)
+			xfree((*resp)->content_type_encoding);
 		xfree((*resp)->content_filename);
 		xfree((*resp)->location);
 		xfree((*resp)->etag);
 		// xfree((*resp)->reason);
-		wget_buffer_free(&(*resp)->header);
-		wget_buffer_free(&(*resp)->body);
+		wget_buffer_release(&(*resp)->header);
+		wget_buffer_release(&(*resp)->body);
 		xfree(*resp);
 	}
 }
@@ -1354,6 +1845,7 @@ void wget_http_free_request(wget_http_request_t **req)
 		wget_buffer_deinit(&(*req)->esc_host);
 		wget_vector_free(&(*req)->headers);
 		xfree((*req)->body);
+		xfree((*req)->body_fname);
 		xfree(*req);
 	}
 }
@@ -277,6 +277,124 @@ int wget_ready_2_transfer(int fd, int timeout, int mode)
   return rc;
 }
 
+/**
+ * \param[in] events Array of file descriptor slots to wait for
+ * \param[in] nevents Number of elements in \p events
+ * \param[in] timeout Max. duration in milliseconds to wait
+ * \return
+ * -1 on error<br>
+ * 0 on timeout - none of the file descriptors is ready<br>
+ * >0 Number of ready file descriptors
+ *
+ * Wait for any of a set of file descriptors to become ready to read or write.
+ * This is the multiplexing primitive for event-driven transfer engines: one
+ * thread can watch hundreds of connections with a single call instead of
+ * blocking in one wget_ready_2_transfer() per connection.
+ *
+ * On return, the `revents` member of each slot holds the bitwise or of
+ * `WGET_IO_READABLE` and `WGET_IO_WRITABLE` for ready descriptors, 0 otherwise.
+ * Slots with a negative `fd` are ignored.
+ *
+ * A \p timeout value of 0 means the function returns immediately.<br>
+ * A \p timeout value of -1 means infinite timeout.
+ */
+int wget_ready_2_transfer_multi(wget_io_event_t *events, int nevents, int timeout)
+{
+	int rc = -1;
+
+	if (nevents <= 0)
+		return 0;
+
+#ifdef HAVE_POLL
+	struct pollfd sbuf[64], *pollfds = sbuf;
+
+	if ((unsigned) nevents > countof(sbuf))
+		pollfds = wget_malloc(nevents * sizeof(struct pollfd));
+
+	for (int it = 0; it < nevents; it++) {
+		pollfds[it].fd = events[it].fd;
+		pollfds[it].events = 0;
+		pollfds[it].revents = 0;
+
+		if (events[it].events & WGET_IO_READABLE)
+			pollfds[it].events |= POLLIN;
+		if (events[it].events & WGET_IO_WRITABLE)
+			pollfds[it].events |= POLLOUT;
+	}
+
+	if ((rc = poll(pollfds, nevents, timeout)) > 0) {
+		for (int it = 0; it < nevents; it++) {
+			events[it].revents = 0;
+			if (pollfds[it].revents & (POLLIN | POLLERR | POLLHUP))
+				events[it].revents |= WGET_IO_READABLE;
+			if (pollfds[it].revents & POLLOUT)
+				events[it].revents |= WGET_IO_WRITABLE;
+		}
+	} else {
+		for (int it = 0; it < nevents; it++)
+			events[it].revents = 0;
+	}
+
+	if (pollfds != sbuf)
+		xfree(pollfds);
+#else
+	fd_set rdset, wrset;
+	struct timeval tmoval, *tmo = NULL;
+	int maxfd = -1;
+
+	FD_ZERO(&rdset);
+	FD_ZERO(&wrset);
+
+	for (int it = 0; it < nevents; it++) {
+		int fd = events[it].fd;
+
+		events[it].revents = 0;
+
+		if (fd < 0)
+			continue;
+
+		if (fd >= FD_SETSIZE) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		if (events[it].events & WGET_IO_READABLE)
+			FD_SET(fd, &rdset);
+		if (events[it].events & WGET_IO_WRITABLE)
+			FD_SET(fd, &wrset);
+
+		if (fd > maxfd)
+			maxfd = fd;
+	}
+
+	if (timeout >= 0) {
+		tmoval.tv_sec = timeout / 1000L;
+		tmoval.tv_usec = (timeout % 1000) * 1000;
+		tmo = &tmoval;
+	}
+
+	if ((rc = select(maxfd + 1, &rdset, &wrset, NULL, tmo)) > 0) {
+		rc = 0;
+		for (int it = 0; it < nevents; it++) {
+			int fd = events[it].fd;
+
+			if (fd < 0)
+				continue;
+
+			if (FD_ISSET(fd, &rdset))
+				events[it].revents |= WGET_IO_READABLE;
+			if (FD_ISSET(fd, &wrset))
+				events[it].revents |= WGET_IO_WRITABLE;
+
+			if (events[it].revents)
+				rc++;
+		}
+	}
+#endif
+
+	return rc;
+}
+
 /**
  * \param[in] fd File descriptor to wait for
  * \param[in] timeout Max. duration in milliseconds to wait
@@ -23,6 +23,7 @@
 
 #include <config.h>
 
+#include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
@@ -64,6 +65,65 @@ bool wget_ip_is_family(const char *host, int family)
 	}
 }
 
+/**
+ * \param[in] host Host/IP string
+ * \return
+ * 1 if \p host is an IPv4 or IPv6 address literal<br>
+ * 0 if it is not
+ *
+ * This function checks if \p host is an IP address literal of any family.
+ *
+ * A cheap character scan rules out ordinary host names first, so that the
+ * relatively expensive inet_pton() is only reached for strings that at least
+ * look like an address.
+ */
+bool wget_ip_is_address(const char *host)
+{
+	bool dotted = true;
+
+	if (!host || !*host)
+		return 0;
+
+	for (const char *p = host; *p; p++) {
+		if (*p == ':')
+			return wget_ip_is_family(host, WGET_NET_FAMILY_IPV6);
+
+		if (*p != '.' && (*p < '0' || *p > '9'))
+			dotted = false;
+	}
+
+	// no colon seen - only digits and dots may form an IPv4 literal
+	return dotted ? wget_ip_is_family(host, WGET_NET_FAMILY_IPV4) : 0;
+}
+
+/**
+ * \param[in] addr Socket address of family `AF_INET` or `AF_INET6`
+ * \param[out] dst Destination buffer, `INET6_ADDRSTRLEN` bytes fit any address
+ * \param[in] size Size of \p dst
+ * \return
+ * 1 on success<br>
+ * 0 on failure
+ *
+ * Formats the numeric IP address in \p addr into \p dst.
+ *
+ * This is a thin wrapper around inet_ntop() and much cheaper than calling
+ * getnameinfo() with `NI_NUMERICHOST`, which goes through the full resolver
+ * front end just to format a few bytes.
+ */
+bool wget_ip_to_string(const struct sockaddr *addr, char *dst, size_t size)
+{
+	if (!addr || !dst)
+		return 0;
+
+	if (addr->sa_family == AF_INET)
+		return inet_ntop(AF_INET, &((const struct sockaddr_in *)(const void *)addr)->sin_addr, dst, size) != NULL;
+
+	if (addr->sa_family == AF_INET6)
+		return inet_ntop(AF_INET6, &((const struct sockaddr_in6 *)(const void *)addr)->sin6_addr, dst, size) != NULL;
+
+	return 0;
+}
+
 /* Not finished, currently not needed
 int wget_ip_is_ip(const char *addr)
 {
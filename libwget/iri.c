@@ -257,6 +257,7 @@ char *wget_iri_unescape_inline(char *src)
  *  - `query`
  *  - `fragment`
  *  - `connection_part`
+ *  - `resolve_prefix`
  */
 void wget_iri_free_content(wget_iri_t *iri)
 {
@@ -272,6 +273,7 @@ void wget_iri_free_content(wget_iri_t *iri)
 		if (iri->fragment_allocated)
 			xfree(iri->fragment);
 		xfree(iri->connection_part);
+		xfree(iri->resolve_prefix);
 	}
 }
 
@@ -292,6 +294,80 @@ void wget_iri_free(wget_iri_t **iri)
 
 // URIs are assumed to be unescaped at this point
 
+// Pre-scan for the parser's fast path: plain ASCII URLs without percent-escapes
+// need neither unescaping nor charset/IDN conversion. We check 8 bytes per
+// step, so the typical crawl URL is classified within a few iterations.
+static int _iri_is_plain_ascii(const char *s, size_t len)
+{
+	size_t it = 0;
+	uint64_t chunk;
+
+	if (memchr(s, '%', len))
+		return 0;
+
+	for (; it + sizeof(chunk) <= len; it += sizeof(chunk)) {
+		memcpy(&chunk, s + it, sizeof(chunk));
+		if (chunk & 0x8080808080808080ULL)
+			return 0;
+	}
+
+	for (; it < len; it++)
+		if ((unsigned char)s[it] & 0x80)
+			return 0;
+
+	return 1;
+}
+
+// charset/IDN conversion of iri->host, split out so the cached path in
+// wget_iri_parse() can skip it entirely
+static void _iri_convert_host(wget_iri_t *iri, const char *encoding)
+{
+	char *s, *p;
+
+	if ((s = wget_str_to_utf8(iri->host, encoding))) {
+		iri->host = s;
+		iri->host_allocated = true;
+	}
+
+	if ((p = (char *) wget_str_to_ascii(iri->host)) != iri->host) {
+		if (iri->host_allocated)
+			xfree(iri->host);
+		iri->host = p;
+		iri->host_allocated = true;
+	}
+}
+
+// IDN lookups show up with several percent of CPU on international crawls,
+// although only a handful of distinct hostnames occur - per-thread map of
+// (raw host, encoding) -> converted host pairs, lock-free since nothing is
+// shared. Colliding slots are simply overwritten.
+#if defined __GNUC__ || defined __clang__
+# define IDN_CACHE_SIZE 64 // slots per thread, power of two
+
+typedef struct {
+	char
+		*host, // raw (lowercased, pre-conversion) hostname
+		*encoding, // document charset the conversion depended on
+		*ascii; // converted (IDN/punycode) hostname
+} _idn_slot_t;
+
+static __thread _idn_slot_t
+	_idn_cache[IDN_CACHE_SIZE];
+
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+static unsigned int G_GNUC_WGET_PURE _idn_hash(const char *s)
+{
+	unsigned int hash = 2166136261u; // FNV-1a
+
+	while (*s)
+		hash = (hash ^ (unsigned char) *s++) * 16777619u;
+
+	return hash;
+}
+#endif
+
 /**
  * \param[in] url A URL/IRI
  * \param[in] encoding Original encoding of \p url
@@ -307,7 +383,7 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 	wget_iri_t *iri;
 	char *p, *s, *authority, c;
 	size_t slen, it;
-	int maybe_scheme;
+	int maybe_scheme, plain;
 
 	if (!url)
 		return NULL;
@@ -319,6 +395,8 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 	 */
 	while (c_isspace(*url)) url++;
 	if (!*url) return NULL;
+
+	int old_tag = wget_alloc_tag(WGET_ALLOC_TAG_IRI); // for --alloc-stats attribution
 /*
 	// first unescape, than convert to UTF-8
 	if (strchr(url, '%')) {
@@ -348,6 +426,10 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 */
 	// just use one block of memory for all parsed URI parts
 	slen = strlen(url);
+	// the vast majority of URLs seen while crawling are plain ASCII and
+	// already normalized - one scan up front lets us skip the per-component
+	// unescape and charset detection passes below
+	plain = _iri_is_plain_ascii(url, slen);
 	iri = xmalloc(sizeof(wget_iri_t) + slen * 2 + 2);
 	memset(iri, 0, sizeof(wget_iri_t));
 	iri->uri = memcpy(((char *)iri) + sizeof(wget_iri_t), url, slen + 1);
@@ -375,7 +457,8 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 		// find the scheme in our static list of supported schemes
 		// for later comparisons we compare pointers (avoiding strcasecmp())
 		iri->scheme = p;
-		wget_iri_unescape_inline((char *)iri->scheme);
+		if (!plain)
+			wget_iri_unescape_inline((char *)iri->scheme);
 
 		for (it = 0; it < countof(wget_iri_schemes); it++) {
 			if (!wget_strcasecmp_ascii(wget_iri_schemes[it], p)) {
@@ -406,7 +489,8 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 		s++;
 	c = *s;
 	if (c) *s++ = 0;
-	wget_iri_unescape_inline(authority);
+	if (!plain)
+		wget_iri_unescape_inline(authority);
 
 	// left over: [path][?query][#fragment]
 	if (c == '/') {
@@ -415,7 +499,8 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 			s++;
 		c = *s;
 		if (c) *s++ = 0;
-		wget_iri_unescape_inline((char *)iri->path);
+		if (!plain)
+			wget_iri_unescape_inline((char *)iri->path);
 	}
 
 	if (c == '?') {
@@ -433,7 +518,8 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 	if (c == '#') {
 		iri->fragment = s;
 		s += strlen(s);
-		wget_iri_unescape_inline((char *)iri->fragment);
+		if (!plain)
+			wget_iri_unescape_inline((char *)iri->fragment);
 	}
 
 	if (*s) {
@@ -484,46 +570,62 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 
 	if (iri->host) {
 		wget_strtolower((char *)iri->host);
-		if (wget_str_needs_encoding(iri->host)) {
-			if ((s = wget_str_to_utf8(iri->host, encoding))) {
-				iri->host = s;
+		// an all-ASCII host needs no conversion - wget_str_to_ascii()
+		// would return it unchanged anyway
+		if (!plain && wget_str_needs_encoding(iri->host)) {
+#ifdef IDN_CACHE_SIZE
+			_idn_slot_t *slot = &_idn_cache[_idn_hash(iri->host) & (IDN_CACHE_SIZE - 1)];
+
+			if (slot->host && !strcmp(slot->host, iri->host)
+				&& !wget_strcasecmp_ascii(slot->encoding, encoding))
+			{
+				iri->host = wget_strdup(slot->ascii);
 				iri->host_allocated = true;
+			} else {
+				char *raw = wget_strdup(iri->host);
+
+				_iri_convert_host(iri, encoding);
+
+				xfree(slot->host);
+				xfree(slot->encoding);
+				xfree(slot->ascii);
+				slot->host = raw;
+				slot->encoding = wget_strdup(encoding);
+				slot->ascii = wget_strdup(iri->host);
 			}
-		}
-		if ((p = (char *)wget_str_to_ascii(iri->host)) != iri->host) {
-			if (iri->host_allocated)
-				xfree(iri->host);
-			iri->host = p;
-			iri->host_allocated = true;
+#else
+			_iri_convert_host(iri, encoding);
+#endif
 		}
 
 		// Finally, if the host is a literal IPv4 or IPv6 address, mark it as so
-		if (wget_ip_is_family(iri->host, WGET_NET_FAMILY_IPV4) || wget_ip_is_family(iri->host, WGET_NET_FAMILY_IPV6))
+		if (wget_ip_is_address(iri->host))
 			iri->is_ip_address = true;
 	}
 	else {
 		if (iri->scheme == WGET_IRI_SCHEME_HTTP || iri->scheme == WGET_IRI_SCHEME_HTTPS) {
 			error_printf(_("Missing host/domain in URI '%s'\n"), iri->uri);
 			wget_iri_free(&iri);
+			wget_alloc_tag(old_tag);
 			return NULL;
 		}
 	}
 
-	if (iri->path && wget_str_needs_encoding(iri->path)) {
+	if (!plain && iri->path && wget_str_needs_encoding(iri->path)) {
 		if ((s = wget_str_to_utf8(iri->path, encoding))) {
 			iri->path = s;
 			iri->path_allocated = true;
 		}
 	}
 
-	if (iri->query && wget_str_needs_encoding(iri->query)) {
+	if (!plain && iri->query && wget_str_needs_encoding(iri->query)) {
 		if ((s = wget_str_to_utf8(iri->query, encoding))) {
 			iri->query = s;
 			iri->query_allocated = true;
 		}
 	}
 
-	if (iri->fragment && wget_str_needs_encoding(iri->fragment)) {
+	if (!plain && iri->fragment && wget_str_needs_encoding(iri->fragment)) {
 		if ((s = wget_str_to_utf8(iri->fragment, encoding))) {
 			iri->fragment = s;
 			iri->fragment_allocated = true;
@@ -538,6 +640,8 @@ wget_iri_t *wget_iri_parse(const char *url, const char *encoding)
 	debug_printf("fragment=%s\n",iri->fragment);
 */
 
+	wget_alloc_tag(old_tag);
+
 	return iri;
 }
 
@@ -556,6 +660,7 @@ wget_iri_t *wget_iri_clone(const wget_iri_t *iri)
 	wget_iri_t *clone = wget_memdup(iri, sizeof(wget_iri_t) + slen * 2 + 2);
 
 	clone->connection_part = wget_strdup(iri->connection_part);
+	clone->resolve_prefix = wget_strdup(iri->resolve_prefix);
 
 	// adjust pointers
 	if (iri->host_allocated)
@@ -695,6 +800,30 @@ static size_t G_GNUC_WGET_NONNULL_ALL _normalize_path(char *path)
 	return p1 - path;
 }
 
+// precompute the "scheme://host[:port]/dir/" prefix used to resolve relative
+// URLs against 'iri' - done once per base, resolving each of the many links
+// of a document then comes down to a couple of memcpys
+static void _iri_build_resolve_prefix(wget_iri_t *iri)
+{
+	wget_buffer_t buf;
+	char sbuf[256];
+	const char *lastsep = iri->path ? strrchr(iri->path, '/') : NULL;
+
+	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
+
+	wget_buffer_strcpy(&buf, wget_iri_get_connection_part(iri));
+	wget_buffer_strcat(&buf, "/");
+	iri->resolve_root_len = buf.length;
+
+	if (lastsep)
+		wget_buffer_memcat(&buf, iri->path, lastsep - iri->path + 1);
+
+	iri->resolve_prefix_len = buf.length;
+	iri->resolve_prefix = wget_strmemdup(buf.data, buf.length);
+
+	wget_buffer_deinit(&buf);
+}
+
 // create an absolute URI from a base + relative URI
 
 //char *iri_relative_to_absolute(IRI *iri, const char *tag, const char *val, size_t len, char *dst, size_t dst_size)
@@ -743,11 +872,13 @@ const char *wget_iri_relative_to_abs(wget_iri_t *base, const char *val, size_t l
 				debug_printf("*1 %s\n", buf->data);
 			} else {
 				// absolute path
-				_normalize_path(path);
+				size_t path_len = _normalize_path(path);
 
-				wget_buffer_strcpy(buf, wget_iri_get_connection_part(base));
-				wget_buffer_strcat(buf, "/");
-				wget_buffer_strcat(buf, path);
+				if (!base->resolve_prefix)
+					_iri_build_resolve_prefix(base);
+
+				wget_buffer_memcpy(buf, base->resolve_prefix, base->resolve_root_len);
+				wget_buffer_memcat(buf, path, path_len);
 				debug_printf("*2 %s\n", buf->data);
 			}
 		} else {
@@ -765,15 +896,13 @@ const char *wget_iri_relative_to_abs(wget_iri_t *base, const char *val, size_t l
 				return val;
 			}
 		} else if (base) {
-			// relative path
-			const char *lastsep = base->path ? strrchr(base->path, '/') : NULL;
-			wget_buffer_strcpy(buf, wget_iri_get_connection_part(base));
-			wget_buffer_strcat(buf, "/");
+			// relative path: start from the precomputed scheme://host[:port]/dir/ prefix
+			if (!base->resolve_prefix)
+				_iri_build_resolve_prefix(base);
 
-			size_t tmp_len = buf->length;
+			wget_buffer_memcpy(buf, base->resolve_prefix, base->resolve_prefix_len);
 
-			if (lastsep)
-				wget_buffer_memcat(buf, base->path, lastsep - base->path + 1);
+			size_t tmp_len = base->resolve_root_len;
 
 			if (len)
 				wget_buffer_memcat(buf, val, len);
@@ -978,6 +1107,56 @@ const char *wget_iri_escape_query(const char *src, wget_buffer_t *buf)
 	return buf->data;
 }
 
+// Single-entry per-thread memos for escaped forms: a crawl hits the same
+// host and the same directory prefixes in long runs, so the escape scan
+// is paid once per unique string instead of once per URL. Oversized
+// strings simply fall back to escaping every time.
+#if defined __GNUC__ || defined __clang__
+# define _IRI_ESCAPE_MEMO 1
+typedef struct {
+	size_t
+		rawlen,
+		esclen;
+	char
+		raw[256],
+		esc[1024];
+} _esc_memo_t;
+static __thread _esc_memo_t
+	_host_memo,
+	_prefix_memo;
+
+// escape src into buf, remembering (src, escaped form) in the memo;
+// returns the escaped form from the memo on a repeated src
+static void _escape_memoized(const char *src, size_t len, wget_buffer_t *buf,
+	const char *(*escape)(const char *, wget_buffer_t *), _esc_memo_t *memo)
+{
+	size_t mark;
+
+	if (len >= sizeof(memo->raw)) {
+		escape(src, buf);
+		return;
+	}
+
+	if (memo->rawlen == len && memcmp(memo->raw, src, len) == 0) {
+		wget_buffer_memcat(buf, memo->esc, memo->esclen);
+		return;
+	}
+
+	memcpy(memo->raw, src, len);
+	memo->raw[len] = 0;
+	memo->rawlen = len;
+
+	mark = buf->length;
+	escape(memo->raw, buf);
+
+	if (buf->length - mark <= sizeof(memo->esc)) {
+		memo->esclen = buf->length - mark;
+		memcpy(memo->esc, buf->data + mark, memo->esclen);
+	} else
+		memo->rawlen = 0; // escaped form too large to keep
+}
+#endif
+
 /**
  * \param[in] iri An IRI
  * \param[in] buf A buffer, where the resulting string will be put
@@ -986,10 +1165,17 @@ const char *wget_iri_escape_query(const char *src, wget_buffer_t *buf)
  * Return the host part of the provided IRI. It is placed in the buffer \p buf
  * and also returned as a `const char *`.
  *
- * The host is escaped using wget_iri_escape().
+ * The host is escaped using wget_iri_escape(). The escaped form is memoized
+ * per thread, so repeated requests to the same host don't re-scan it.
  */
 const char *wget_iri_get_escaped_host(const wget_iri_t *iri, wget_buffer_t *buf)
 {
+#ifdef _IRI_ESCAPE_MEMO
+	if (iri->host) {
+		_escape_memoized(iri->host, strlen(iri->host), buf, wget_iri_escape, &_host_memo);
+		return buf->data;
+	}
+#endif
 	return wget_iri_escape(iri->host, buf);
 }
 
@@ -1004,14 +1190,25 @@ const char *wget_iri_get_escaped_host(const wget_iri_t *iri, wget_buffer_t *buf)
  *     /foo/bar/?param_1=one&param_2=two
  *
  * Both the path and the query are escaped using wget_iri_escape_path() and
- * wget_iri_escape_query(), respectively.
+ * wget_iri_escape_query(), respectively. The escaped form of the directory
+ * prefix (everything up to and including the last `/`) is memoized per
+ * thread, so escaping it is paid once per unique prefix, not once per URL.
  *
  * The resulting string is placed in the buffer \p buf and also returned as a `const char *`.
  */
 const char *wget_iri_get_escaped_resource(const wget_iri_t *iri, wget_buffer_t *buf)
 {
-	if (iri->path)
+	if (iri->path) {
+#ifdef _IRI_ESCAPE_MEMO
+		const char *basename = strrchr(iri->path, '/');
+
+		if (basename) {
+			_escape_memoized(iri->path, basename - iri->path + 1, buf, wget_iri_escape_path, &_prefix_memo);
+			wget_iri_escape_path(basename + 1, buf);
+		} else
+#endif
 		wget_iri_escape_path(iri->path, buf);
+	}
 
 	if (iri->query) {
 		wget_buffer_memcat(buf, "?", 1);
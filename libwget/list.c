@@ -247,6 +247,103 @@ void wget_list_free(wget_list_t **list)
 		wget_list_remove(list, *list + 1);
 }
 
+/**
+ * \param[in] list Pointer to Pointer to an intrusive double linked list
+ * \param[in] node Pointer to the link embedded in the caller's struct
+ *
+ * Append \p node to the end of the intrusive list.
+ *
+ * Unlike wget_list_append(), nothing is allocated or copied - the links
+ * live inside the caller's struct (see wget_list_node_t), so appending
+ * and removing are pure pointer operations. The caller keeps ownership
+ * of the memory behind \p node.
+ */
+void wget_list_link_append(wget_list_node_t **list, wget_list_node_t *node)
+{
+	if (!*list) {
+		// <*list> is an empty list
+		*list = node;
+		node->next = node->prev = node;
+	} else {
+		node->next = *list;
+		node->prev = (*list)->prev;
+		(*list)->prev->next = node;
+		(*list)->prev = node;
+	}
+}
+
+/**
+ * \param[in] list Pointer to Pointer to an intrusive double linked list
+ * \param[in] node Pointer to a link appended by wget_list_link_append()
+ *
+ * Unlink \p node from the intrusive list. The memory behind \p node
+ * stays untouched - freeing it is up to the caller.
+ */
+void wget_list_link_remove(wget_list_node_t **list, wget_list_node_t *node)
+{
+	if (node->prev == node->next && node == node->prev) {
+		// removing the last node in the list
+		if (*list && node == *list)
+			*list = NULL;
+	} else {
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		if (*list && node == *list)
+			*list = node->next;
+	}
+}
+
+/**
+ * \param[in] list Pointer to an intrusive double linked list
+ * \return Pointer to the first node of the list or %NULL if the list is empty
+ *
+ * Get the first node of an intrusive list. With the link embedded as first
+ * member, the returned pointer is also a pointer to the embedding struct.
+ */
+void *wget_list_link_first(const wget_list_node_t *list)
+{
+	return (void *)list;
+}
+
+/**
+ * \param[in] list Pointer to an intrusive double linked list
+ * \param[in] node Pointer to a node of \p list
+ * \return Pointer to the node after \p node or %NULL if \p node is the last one
+ *
+ * Get the successor of \p node within \p list.
+ */
+void *wget_list_link_next(const wget_list_node_t *list, const wget_list_node_t *node)
+{
+	if (!list || !node || node->next == list)
+		return NULL;
+
+	return node->next;
+}
+
+/**
+ * \param[in] list Pointer to an intrusive double linked list
+ * \param[in] browse Pointer to callback function which is called for every node in the list.
+ *  If the callback functions returns a value not equal to zero, browsing is stopped and
+ *  this value will be returned by wget_list_link_browse.
+ * \param[in] context The context handle that will be passed to the callback function
+ * \return The return value of the last call to the browse function or -1 if \p list is NULL (empty)
+ *
+ * Iterate through all nodes of the intrusive \p list and call the function \p browse for each.
+ */
+int wget_list_link_browse(wget_list_node_t *list, wget_list_browse_t browse, void *context)
+{
+	if (!list)
+		return -1;
+
+	int ret;
+	const wget_list_node_t *end = list->prev, *cur = list;
+
+	while ((ret = browse(context, (void *)cur)) == 0 && cur != end)
+		cur = cur->next;
+
+	return ret;
+}
+
 /*
 void wget_list_dump(const WGET_LIST *list)
 {
@@ -0,0 +1,318 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Asynchronous logging backend
+ *
+ * The loggers in logger.c format and write on the calling thread, so
+ * with verbose or debug output enabled all downloader threads serialize
+ * on the same stderr write. This backend decouples the two: the calling
+ * thread only formats the message (on its own stack) and pushes it onto
+ * a lock-free MPMC queue, a single drain thread pops the messages and
+ * hands them to the original sinks in large batches, preserving order.
+ *
+ * Only the info and debug loggers are redirected - error messages are
+ * rare, must not be lost by wget_error_printf_exit(), and so stay
+ * synchronous. When the queue is full, messages are dropped and counted
+ * instead of blocking the producer; the drop count is reported when the
+ * backend is stopped.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wget.h>
+#include "private.h"
+#include "logger.h"
+
+// a formatted message waiting to be written, queued by pointer
+typedef struct {
+	wget_logger_t *
+		logger; // which sink to hand it to
+	size_t
+		len;
+	char
+		text[];
+} log_msg_t;
+
+// the original sinks of the redirected loggers
+typedef struct {
+	wget_logger_t *
+		logger;
+	void (*vprintf)(const wget_logger_t *, const char *, va_list);
+	void (*write)(const wget_logger_t *, const char *, size_t);
+} saved_logger_t;
+
+// flush a batch at this size even if more messages are pending
+#define BATCH_FLUSH_SIZE (64 * 1024)
+
+static wget_mpmc_queue_t
+	*queue;
+static wget_thread_t
+	drain_tid;
+static wget_thread_mutex_t
+	drain_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+static wget_thread_cond_t
+	drain_cond = WGET_THREAD_COND_INITIALIZER;
+static saved_logger_t
+	saved[2]; // info + debug
+static int
+	nsaved,
+	running;
+static long long
+	dropped;
+
+static void _drop_one(void)
+{
+#ifdef WITH_GCC_ATOMIC
+	__atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+#else
+	wget_thread_mutex_lock(&drain_mutex);
+	dropped++;
+	wget_thread_mutex_unlock(&drain_mutex);
+#endif
+}
+
+static void _enqueue(const wget_logger_t *logger, const char *data, size_t len)
+{
+	// plain malloc: the message is freed by the drain thread, so it must
+	// not come from an arena the producer may have pushed (wget_arena_push())
+	log_msg_t *msg = malloc(sizeof(log_msg_t) + len);
+
+	if (!msg) {
+		_drop_one();
+		return;
+	}
+
+	msg->logger = (wget_logger_t *) logger;
+	msg->len = len;
+	memcpy(msg->text, data, len);
+
+	if (wget_mpmc_queue_push(queue, msg)) {
+		// full - dropping beats blocking the downloader thread
+		_drop_one();
+		free(msg);
+	} else if (wget_mpmc_queue_size(queue) <= 1) {
+		// empty -> non-empty transition, wake the drain thread.
+		// While the queue stays busy it sweeps without being told.
+		wget_thread_cond_signal(&drain_cond);
+	}
+}
+
+static void G_GNUC_WGET_PRINTF_FORMAT(2,0) G_GNUC_WGET_NONNULL((1,2))
+_async_vprintf(const wget_logger_t *logger, const char *fmt, va_list args)
+{
+	char sbuf[4096];
+	wget_buffer_t buf;
+	int err = errno;
+
+	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
+	wget_buffer_vprintf(&buf, fmt, args);
+	_enqueue(logger, buf.data, buf.length);
+	wget_buffer_deinit(&buf);
+
+	errno = err;
+}
+
+static void _async_write(const wget_logger_t *logger, const char *data, size_t len)
+{
+	_enqueue(logger, data, len);
+}
+
+static saved_logger_t *_find_saved(const wget_logger_t *logger)
+{
+	for (int it = 0; it < nsaved; it++)
+		if (saved[it].logger == logger)
+			return &saved[it];
+
+	return NULL;
+}
+
+// write out everything queued so far, batching runs of messages that
+// go to the same sink into one write
+static void _drain(wget_buffer_t *batch)
+{
+	wget_logger_t *batch_logger = NULL;
+	log_msg_t *msg;
+
+	while ((msg = wget_mpmc_queue_pop(queue))) {
+		if (msg->logger != batch_logger || batch->length > BATCH_FLUSH_SIZE) {
+			saved_logger_t *sink = _find_saved(batch_logger);
+
+			if (sink && sink->write && batch->length)
+				sink->write(batch_logger, batch->data, batch->length);
+			wget_buffer_reset(batch);
+			batch_logger = msg->logger;
+		}
+
+		wget_buffer_memcat(batch, msg->text, msg->len);
+		free(msg);
+	}
+
+	if (batch->length) {
+		saved_logger_t *sink = _find_saved(batch_logger);
+
+		if (sink && sink->write)
+			sink->write(batch_logger, batch->data, batch->length);
+		wget_buffer_reset(batch);
+	}
+}
+
+static void *_drain_thread(void *ctx G_GNUC_WGET_UNUSED)
+{
+	wget_buffer_t batch;
+
+	wget_buffer_init(&batch, NULL, BATCH_FLUSH_SIZE);
+
+	for (;;) {
+		wget_thread_mutex_lock(&drain_mutex);
+		// only sleep while there is nothing to do, the timeout is a
+		// safety net against a missed wakeup
+		if (running && !wget_mpmc_queue_size(queue))
+			wget_thread_cond_wait(&drain_cond, &drain_mutex, 50);
+		if (!running) {
+			wget_thread_mutex_unlock(&drain_mutex);
+			break;
+		}
+		wget_thread_mutex_unlock(&drain_mutex);
+
+		_drain(&batch);
+	}
+
+	// final sweep after stop - producers are synchronous again by now
+	_drain(&batch);
+
+	wget_buffer_deinit(&batch);
+
+	return NULL;
+}
+
+static void _redirect(wget_logger_t *logger)
+{
+	if (!logger || !logger->vprintf)
+		return; // logger is off, nothing to speed up
+
+	saved[nsaved].logger = logger;
+	saved[nsaved].vprintf = logger->vprintf;
+	saved[nsaved].write = logger->write;
+	nsaved++;
+
+	logger->vprintf = _async_vprintf;
+	logger->write = _async_write;
+}
+
+/**
+ * \param[in] max_pending Number of messages the queue may hold (rounded up to a power of two)
+ * \return 0 on success, -1 on error (e.g. already started)
+ *
+ * Redirects the info and debug loggers through a background writer
+ * thread: callers only format and enqueue, a single drain thread does
+ * large batched writes to the original sinks. The error logger stays
+ * synchronous.
+ *
+ * Messages arriving while the queue is full are dropped and counted
+ * (see wget_log_async_dropped()) rather than blocking the caller.
+ *
+ * Don't reconfigure the redirected loggers while the backend is running -
+ * call wget_log_async_stop() first.
+ */
+int wget_log_async_start(size_t max_pending)
+{
+	if (running)
+		return -1;
+
+	queue = wget_mpmc_queue_create(max_pending);
+	nsaved = 0;
+	dropped = 0;
+
+	_redirect(wget_get_logger(WGET_LOGGER_INFO));
+	_redirect(wget_get_logger(WGET_LOGGER_DEBUG));
+
+	running = 1;
+
+	if (wget_thread_start(&drain_tid, _drain_thread, NULL, 0)) {
+		// fall back to synchronous logging
+		for (int it = 0; it < nsaved; it++) {
+			saved[it].logger->vprintf = saved[it].vprintf;
+			saved[it].logger->write = saved[it].write;
+		}
+		nsaved = 0;
+		running = 0;
+		wget_mpmc_queue_free(&queue);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Flushes all pending messages, stops the writer thread and restores
+ * synchronous logging. Reports the number of dropped messages, if any.
+ * A no-op if the backend isn't running.
+ */
+void wget_log_async_stop(void)
+{
+	if (!running)
+		return;
+
+	// back to synchronous logging before the final flush, so nothing
+	// can race into the queue after the drain thread is gone. The sink
+	// table stays intact until after the join - the drain thread still
+	// needs it for its final sweep.
+	for (int it = 0; it < nsaved; it++) {
+		saved[it].logger->vprintf = saved[it].vprintf;
+		saved[it].logger->write = saved[it].write;
+	}
+
+	wget_thread_mutex_lock(&drain_mutex);
+	running = 0;
+	wget_thread_cond_signal(&drain_cond);
+	wget_thread_mutex_unlock(&drain_mutex);
+
+	wget_thread_join(drain_tid);
+	nsaved = 0;
+	wget_mpmc_queue_free(&queue);
+
+	if (dropped)
+		wget_error_printf(_("async log: %lld message(s) dropped under overload\n"), dropped);
+}
+
+/**
+ * \return Number of messages dropped because the queue was full
+ */
+long long wget_log_async_dropped(void)
+{
+#ifdef WITH_GCC_ATOMIC
+	return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+#else
+	long long n;
+
+	wget_thread_mutex_lock(&drain_mutex);
+	n = dropped;
+	wget_thread_mutex_unlock(&drain_mutex);
+
+	return n;
+#endif
+}
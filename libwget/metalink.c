@@ -76,8 +76,21 @@ static void _add_piece(_metalink_context_t *ctx, const char *value)
 		// hash for a piece of the file
 		wget_metalink_piece_t piece, *piecep;
 
-		if (!metalink->pieces)
-			metalink->pieces = wget_vector_create(32, 32, NULL);
+		if (!metalink->pieces) {
+			int init = 32;
+
+			// presize from <size> and the piece length when both are
+			// already known - artifact descriptions with 100k+ pieces
+			// otherwise grow through thousands of realloc steps
+			if (metalink->size > 0 && ctx->length > 0) {
+				long long npieces = (metalink->size + ctx->length - 1) / ctx->length;
+
+				if (npieces > 0 && npieces <= 1024 * 1024)
+					init = (int) npieces;
+			}
+
+			metalink->pieces = wget_vector_create(init, 32, NULL);
+		}
 
 		piece.length = ctx->length;
 		wget_strscpy(piece.hash.type, ctx->hash_type, sizeof(piece.hash.type));
@@ -260,6 +273,53 @@ wget_metalink_t *wget_metalink_parse(const char *xml)
 	return metalink;
 }
 
+// streaming variant on top of the restartable XML parser: the .meta4
+// description is parsed chunk by chunk as it arrives, instead of being
+// buffered completely first
+struct _wget_metalink_stream_st {
+	wget_xml_stream_t *
+		xml;
+	wget_metalink_t *
+		metalink;
+	_metalink_context_t
+		ctx;
+};
+
+wget_metalink_stream_t *wget_metalink_stream_init(void)
+{
+	wget_metalink_stream_t *stream = xcalloc(1, sizeof(wget_metalink_stream_t));
+
+	stream->metalink = xcalloc(1, sizeof(wget_metalink_t));
+	stream->ctx.metalink = stream->metalink;
+	stream->ctx.priority = 999999;
+	wget_strscpy(stream->ctx.location, "-", sizeof(stream->ctx.location));
+	stream->xml = wget_xml_stream_init(_metalink_parse, &stream->ctx, 0);
+
+	return stream;
+}
+
+void wget_metalink_stream_feed(wget_metalink_stream_t *stream, const char *data, size_t len)
+{
+	if (stream && data && len)
+		wget_xml_stream_feed(stream->xml, data, len);
+}
+
+// finish parsing and hand over the accumulated metalink description;
+// frees the stream
+wget_metalink_t *wget_metalink_stream_close(wget_metalink_stream_t **stream)
+{
+	wget_metalink_t *metalink;
+
+	if (!stream || !*stream)
+		return NULL;
+
+	wget_xml_stream_close(&(*stream)->xml);
+	metalink = (*stream)->metalink;
+	xfree(*stream);
+
+	return metalink;
+}
+
 void wget_metalink_free(wget_metalink_t **metalink)
 {
 	if (metalink && *metalink) {
@@ -0,0 +1,228 @@
+/*
+ * Copyright(c) 2017-2019 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Bounded multi-producer/multi-consumer queue routines
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wget.h>
+#include "private.h"
+
+/**
+ * \file
+ * \brief Bounded multi-producer/multi-consumer queue
+ * \defgroup libwget-mpmc_queue MPMC queue
+ * @{
+ *
+ * A fixed-capacity FIFO queue that may be pushed to and popped from by any
+ * number of threads concurrently. With compiler support for the __atomic
+ * builtins the fast path is lock-free (one CAS per operation, no futex),
+ * following Dmitry Vyukov's bounded MPMC design with a per-slot sequence
+ * counter. Without that support the implementation degrades to a mutex
+ * protected ring buffer with identical semantics.
+ *
+ * The queue stores plain pointers and never takes ownership of them.
+ */
+
+struct _wget_mpmc_queue_st {
+	size_t
+		mask; // capacity - 1, capacity is a power of two
+#ifdef WITH_GCC_ATOMIC
+	size_t
+		head, // next slot to push to (modulo capacity)
+		tail; // next slot to pop from (modulo capacity)
+	struct _slot {
+		size_t
+			seq; // slot state: == index ready for push, == index+1 ready for pop
+		void
+			*entry;
+	} slot[];
+#else
+	wget_thread_mutex_t
+		mutex;
+	size_t
+		head,
+		tail;
+	void
+		*entry[];
+#endif
+};
+
+/**
+ * \param[in] size Minimum number of entries the queue must hold
+ * \return New queue instance
+ *
+ * Allocates a queue with a capacity of at least \p size entries,
+ * rounded up to the next power of two.
+ */
+wget_mpmc_queue_t *wget_mpmc_queue_create(size_t size)
+{
+	size_t capacity;
+	wget_mpmc_queue_t *q;
+
+	for (capacity = 2; capacity < size; capacity <<= 1)
+		;
+
+#ifdef WITH_GCC_ATOMIC
+	q = xcalloc(1, sizeof(wget_mpmc_queue_t) + capacity * sizeof(struct _slot));
+
+	for (size_t it = 0; it < capacity; it++)
+		q->slot[it].seq = it;
+#else
+	q = xcalloc(1, sizeof(wget_mpmc_queue_t) + capacity * sizeof(void *));
+	wget_thread_mutex_init_adaptive(&q->mutex);
+#endif
+
+	q->mask = capacity - 1;
+
+	return q;
+}
+
+/**
+ * \param[in] q Queue instance to be freed, *q is set to NULL
+ *
+ * Frees the queue itself, not the entries still held by it.
+ */
+void wget_mpmc_queue_free(wget_mpmc_queue_t **q)
+{
+	if (q) {
+		xfree(*q);
+	}
+}
+
+/**
+ * \param[in] q Queue instance
+ * \param[in] entry Pointer to be appended
+ * \return 0 on success, -1 if the queue is full
+ *
+ * Appends \p entry to the queue. Safe to call from any thread.
+ */
+int wget_mpmc_queue_push(wget_mpmc_queue_t *q, void *entry)
+{
+#ifdef WITH_GCC_ATOMIC
+	size_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+
+	for (;;) {
+		struct _slot *slot = &q->slot[head & q->mask];
+		size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		intptr_t diff = (intptr_t)(seq - head);
+
+		if (diff == 0) {
+			// slot is free, try to claim it
+			if (__atomic_compare_exchange_n(&q->head, &head, head + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				slot->entry = entry;
+				__atomic_store_n(&slot->seq, head + 1, __ATOMIC_RELEASE);
+				return 0;
+			}
+			// CAS failed, 'head' has been reloaded
+		} else if (diff < 0) {
+			return -1; // queue is full
+		} else {
+			head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+		}
+	}
+#else
+	int rc = -1;
+
+	wget_thread_mutex_lock(&q->mutex);
+	if (q->head - q->tail <= q->mask) {
+		q->entry[q->head++ & q->mask] = entry;
+		rc = 0;
+	}
+	wget_thread_mutex_unlock(&q->mutex);
+
+	return rc;
+#endif
+}
+
+/**
+ * \param[in] q Queue instance
+ * \return Oldest entry or NULL if the queue is empty
+ *
+ * Removes and returns the oldest entry. Safe to call from any thread.
+ */
+void *wget_mpmc_queue_pop(wget_mpmc_queue_t *q)
+{
+#ifdef WITH_GCC_ATOMIC
+	size_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+	for (;;) {
+		struct _slot *slot = &q->slot[tail & q->mask];
+		size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		intptr_t diff = (intptr_t)(seq - (tail + 1));
+
+		if (diff == 0) {
+			// slot holds an entry, try to claim it
+			if (__atomic_compare_exchange_n(&q->tail, &tail, tail + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				void *entry = slot->entry;
+				__atomic_store_n(&slot->seq, tail + q->mask + 1, __ATOMIC_RELEASE);
+				return entry;
+			}
+		} else if (diff < 0) {
+			return NULL; // queue is empty
+		} else {
+			tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+		}
+	}
+#else
+	void *entry = NULL;
+
+	wget_thread_mutex_lock(&q->mutex);
+	if (q->head != q->tail)
+		entry = q->entry[q->tail++ & q->mask];
+	wget_thread_mutex_unlock(&q->mutex);
+
+	return entry;
+#endif
+}
+
+/**
+ * \param[in] q Queue instance
+ * \return Number of entries currently held
+ *
+ * The returned value is a snapshot and may be stale under concurrency -
+ * use it for heuristics, not for correctness decisions.
+ */
+size_t wget_mpmc_queue_size(wget_mpmc_queue_t *q)
+{
+#ifdef WITH_GCC_ATOMIC
+	size_t head = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	size_t tail = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+	return head > tail ? head - tail : 0;
+#else
+	size_t size;
+
+	wget_thread_mutex_lock(&q->mutex);
+	size = q->head - q->tail;
+	wget_thread_mutex_unlock(&q->mutex);
+
+	return size;
+#endif
+}
+
+/** @} */
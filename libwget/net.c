@@ -35,6 +35,8 @@
 #include <string.h>
 #include <unistd.h>
 #include <stdarg.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <c-ctype.h>
 #include <time.h>
 #include <errno.h>
@@ -54,6 +56,8 @@
 # include <sys/ioctl.h>
 #else
 # include <fcntl.h>
+# include <sys/uio.h> // writev()
+# define HAVE_WRITEV
 #endif
 
 #if defined __APPLE__ && defined __MACH__ && defined CONNECT_DATA_IDEMPOTENT && defined CONNECT_RESUME_ON_READ_WRITE
@@ -120,8 +124,14 @@ struct _dns_entry {
 		host;
 	struct addrinfo *
 		addrinfo;
+	long long
+		expiry_ts; // milliseconds, entry counts as stale from then on
 	uint16_t
 		port;
+	bool
+		allocated; // addrinfo was built by wget_dns_cache_load(), not by getaddrinfo()
+	char
+		ip[INET6_ADDRSTRLEN]; // textual form of the first address, formatted once at insert time
 };
 
 static struct wget_tcp_st _global_tcp = {
@@ -130,6 +140,7 @@ static struct wget_tcp_st _global_tcp = {
 	.connect_timeout = -1,
 	.timeout = -1,
 	.family = AF_UNSPEC,
+	.readahead_size = 8 * 1024,
 	.caching = 1,
 #if defined TCP_FASTOPEN_OSX
 	.tcp_fastopen = 1,
@@ -139,6 +150,18 @@ static struct wget_tcp_st _global_tcp = {
 #endif
 };
 
+// numeric port of a socket address, 0 if the family is unknown
+static uint16_t _sockaddr_port(const struct sockaddr *addr)
+{
+	if (addr->sa_family == AF_INET)
+		return ntohs(((const struct sockaddr_in *)(const void *)addr)->sin_port);
+
+	if (addr->sa_family == AF_INET6)
+		return ntohs(((const struct sockaddr_in6 *)(const void *)addr)->sin6_port);
+
+	return 0;
+}
+
 typedef struct
 {
 	const char
@@ -150,79 +173,222 @@ typedef struct
 
 static wget_stats_callback_t stats_callback;
 
-/* Resolver / DNS cache container */
+// TCP Fast Open usage counters (see wget_tcp_get_stats_tcp_fastopen()).
+// A lost increment on platforms without __atomic builtins only skews a
+// statistic, so no mutex fallback here.
+static int
+	_tfo_sends,
+	_tfo_fallbacks;
+
+#if defined TCP_FASTOPEN_OSX || defined TCP_FASTOPEN_LINUX
+static void _tfo_count(int *counter)
+{
+#ifdef WITH_GCC_ATOMIC
+	__atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+#else
+	(*counter)++;
+#endif
+}
+#endif
+
+/* Resolver / DNS cache container.
+ *
+ * The cache is an insert-only open addressing hash table: entries live
+ * until wget_dns_cache_free(), slots go from NULL to set exactly once and
+ * a full table is replaced by publishing a rehashed copy while the old
+ * table is retired (not freed) so concurrent readers stay valid. That way
+ * cache hits need no lock at all when __atomic builtins are available -
+ * with hundreds of connecting threads the old global mutex around every
+ * lookup was one of the hottest locks in the library. Insertions are rare
+ * (one per host) and keep being serialized by dns_mutex. */
+struct _dns_table {
+	unsigned int
+		mask; // capacity - 1, capacity is a power of 2
+	int
+		nentries;
+	struct _dns_table
+		*retired; // previous, smaller table - kept for readers still probing it
+	struct _dns_entry
+		*entries[];
+};
+
+static struct _dns_table
+	*dns_table;
 static wget_vector_t
-	*dns_cache;
+	*dns_retired; // replaced (stale) entries, freed with the cache since readers may still hold them
 static wget_thread_mutex_t
 	dns_mutex = WGET_THREAD_MUTEX_INITIALIZER;
 
+// getaddrinfo() doesn't expose the resolver TTL, so entries age out after a
+// configurable lifetime instead (see wget_dns_cache_set_ttl())
+static long long
+	dns_cache_ttl_ms = 3600 * 1000LL;
+
+#ifdef WITH_GCC_ATOMIC
+# define _dns_load(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+# define _dns_store(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#else
+// without atomics readers take dns_mutex, plain accesses are fine
+# define _dns_load(p) (*(p))
+# define _dns_store(p, v) (*(p) = (v))
+#endif
+
+static unsigned int G_GNUC_WGET_PURE _hash_dns(const char *host, uint16_t port)
+{
+	unsigned int hash = port; // use 0 as SALT if hash table attacks doesn't matter
+
+	while (host && *host)
+		hash = hash * 101 + (*host++ | 0x20); // locale independent ASCII lowercase
+
+	return hash;
+}
+
+// find the slot for host/port, either occupied by a matching entry or empty.
+// the table is never full, so the probe always terminates.
+static struct _dns_entry **_dns_table_slot(struct _dns_table *table, const char *host, uint16_t port)
+{
+	unsigned int pos = _hash_dns(host, port) & table->mask;
+	struct _dns_entry *entryp;
+
+	while ((entryp = _dns_load(&table->entries[pos]))) {
+		if (entryp->port == port && !wget_strcasecmp(entryp->host, host))
+			break;
+		pos = (pos + 1) & table->mask;
+	}
+
+	return &table->entries[pos];
+}
+
 static struct addrinfo *_wget_dns_cache_get(const char *host, uint16_t port)
 {
-	if (dns_cache) {
-		struct _dns_entry *entryp, entry = { .host = host, .port = port };
-		int index;
+	struct _dns_table *table;
+	struct _dns_entry *entryp = NULL;
 
-		wget_thread_mutex_lock(&dns_mutex);
-		entryp = wget_vector_get(dns_cache, (index = wget_vector_find(dns_cache, &entry)));
-		wget_thread_mutex_unlock(&dns_mutex);
+#ifndef WITH_GCC_ATOMIC
+	wget_thread_mutex_lock(&dns_mutex);
+#endif
 
-		if (entryp) {
-			// DNS cache entry found
-			debug_printf("Found dns cache entry #%d\n", index);
-			return entryp->addrinfo;
-		}
+	if ((table = _dns_load(&dns_table)))
+		entryp = *_dns_table_slot(table, host, port);
+
+#ifndef WITH_GCC_ATOMIC
+	wget_thread_mutex_unlock(&dns_mutex);
+#endif
+
+	if (entryp && entryp->expiry_ts <= wget_get_timemillis())
+		entryp = NULL; // stale entry - treat as cache miss, the re-resolve replaces it
+
+	if (entryp) {
+		// DNS cache entry found - the cached textual address spares a getnameinfo() here
+		debug_printf("Found dns cache entry %s (%s)\n", host ? host : "", entryp->ip);
+		return entryp->addrinfo;
 	}
 
 	return NULL;
 }
 
-static int G_GNUC_WGET_PURE _compare_addr(struct _dns_entry *a1, struct _dns_entry *a2)
+// allocate a table and (on growth) carry the existing entries over, called with dns_mutex held
+static struct _dns_table *_dns_table_resize(struct _dns_table *old, unsigned int capacity)
 {
-	if (a1->port < a2->port)
-		return -1;
-	if (a1->port > a2->port)
-		return 1;
+	struct _dns_table *table = xcalloc(1, sizeof(struct _dns_table) + capacity * sizeof(struct _dns_entry *));
+
+	table->mask = capacity - 1;
+	table->retired = old;
+
+	if (old) {
+		for (unsigned int it = 0; it <= old->mask; it++) {
+			struct _dns_entry *entryp = old->entries[it];
+
+			if (entryp)
+				*_dns_table_slot(table, entryp->host, entryp->port) = entryp;
+		}
+		table->nentries = old->nentries;
+	}
 
-	return wget_strcasecmp(a1->host, a2->host);
+	return table;
 }
 
-static void _free_dns(struct _dns_entry *entry)
+static void _free_dns_entry(struct _dns_entry *entryp)
 {
-	freeaddrinfo(entry->addrinfo);
+	if (entryp->allocated) {
+		// chain built by wget_dns_cache_load(), each node is one allocation
+		for (struct addrinfo *ai = entryp->addrinfo, *next; ai; ai = next) {
+			next = ai->ai_next;
+			xfree(ai);
+		}
+	} else
+		freeaddrinfo(entryp->addrinfo);
+
+	xfree(entryp);
 }
 
-static struct addrinfo * _wget_dns_cache_add(const char *host, uint16_t port, struct addrinfo *addrinfo)
+// build a cache entry with the host name appended to the allocation
+static struct _dns_entry *_alloc_dns_entry(const char *host, uint16_t port)
 {
-	// insert addrinfo into dns cache
 	size_t hostlen = host ? strlen(host) + 1 : 0;
-	struct _dns_entry *entryp = xmalloc(sizeof(struct _dns_entry) + hostlen);
-	int index;
+	struct _dns_entry *entryp = xcalloc(1, sizeof(struct _dns_entry) + hostlen);
 
 	if (host) {
-		entryp->port = port;
 		entryp->host = ((char *)entryp) + sizeof(struct _dns_entry);
 		memcpy((char *)entryp->host, host, hostlen); // ugly cast, but semantically ok
-	} else {
-		entryp->host = NULL;
 	}
+	entryp->port = port;
 
-	entryp->addrinfo = addrinfo;
+	return entryp;
+}
 
-	wget_thread_mutex_lock(&dns_mutex);
-	if (!dns_cache) {
-		dns_cache = wget_vector_create(4, -2, (wget_vector_compare_t)_compare_addr);
-		wget_vector_set_destructor(dns_cache, (wget_vector_destructor_t)_free_dns);
+// insert entryp, called with dns_mutex held.
+// returns the entry that is in the table afterwards - entryp itself, or the
+// already present entry if that one is still fresh (caller frees entryp then).
+static struct _dns_entry *_dns_cache_insert(struct _dns_entry *entryp)
+{
+	struct _dns_table *table;
+	struct _dns_entry **slot;
+
+	if (!(table = dns_table))
+		_dns_store(&dns_table, (table = _dns_table_resize(NULL, 64)));
+
+	if (!*(slot = _dns_table_slot(table, entryp->host, entryp->port))) {
+		debug_printf("Add dns cache entry %s\n", entryp->host ? entryp->host : "");
+		_dns_store(slot, entryp);
+
+		// keep the load factor below 75% so probes stay short (and terminate)
+		if (++table->nentries > (int) (table->mask - (table->mask >> 2)))
+			_dns_store(&dns_table, _dns_table_resize(table, (table->mask + 1) * 2));
+
+		return entryp;
 	}
 
-	if ((index = wget_vector_find(dns_cache, entryp)) == -1) {
-		debug_printf("Add dns cache entry %s\n", host ? host : "");
-		wget_vector_insert_sorted_noalloc(dns_cache, entryp);
-	} else {
-		// race condition:
+	if ((*slot)->expiry_ts <= wget_get_timemillis()) {
+		// replace the stale entry, retire the old one since readers may still hold it
+		if (!dns_retired)
+			dns_retired = wget_vector_create(8, -2, NULL);
+		wget_vector_add_noalloc(dns_retired, *slot);
+
+		debug_printf("Replace stale dns cache entry %s\n", entryp->host ? entryp->host : "");
+		_dns_store(slot, entryp);
+
+		return entryp;
+	}
+
+	return *slot; // a fresh entry is already there (race condition)
+}
+
+static struct addrinfo * _wget_dns_cache_add(const char *host, uint16_t port, struct addrinfo *addrinfo)
+{
+	// insert addrinfo into dns cache
+	struct _dns_entry *entryp = _alloc_dns_entry(host, port), *found;
+
+	entryp->addrinfo = addrinfo;
+	entryp->expiry_ts = wget_get_timemillis() + dns_cache_ttl_ms;
+	if (!addrinfo || !wget_ip_to_string(addrinfo->ai_addr, entryp->ip, sizeof(entryp->ip)))
+		wget_strscpy(entryp->ip, "???", sizeof(entryp->ip));
+
+	wget_thread_mutex_lock(&dns_mutex);
+	if ((found = _dns_cache_insert(entryp)) != entryp) {
 		xfree(entryp);
 		freeaddrinfo(addrinfo);
-		entryp = wget_vector_get(dns_cache, index);
-		addrinfo = entryp ? entryp->addrinfo : NULL;
+		addrinfo = found->addrinfo;
 	}
 	wget_thread_mutex_unlock(&dns_mutex);
 
@@ -371,9 +537,284 @@ static int _wget_tcp_resolve(wget_tcp_t *tcp, const char *host, uint16_t port, s
  */
 void wget_dns_cache_free(void)
 {
+	struct _dns_table *table;
+
+	wget_thread_mutex_lock(&dns_mutex);
+	if ((table = dns_table)) {
+		dns_table = NULL;
+
+		// the newest table knows all entries, retired tables just hold stale copies
+		for (unsigned int it = 0; it <= table->mask; it++) {
+			struct _dns_entry *entryp = table->entries[it];
+
+			if (entryp)
+				_free_dns_entry(entryp);
+		}
+
+		while (table) {
+			struct _dns_table *retired = table->retired;
+			xfree(table);
+			table = retired;
+		}
+	}
+
+	// entries that have been replaced after their expiry
+	for (int it = 0; it < wget_vector_size(dns_retired); it++)
+		_free_dns_entry(wget_vector_get(dns_retired, it));
+	wget_vector_free(&dns_retired);
+
+	wget_thread_mutex_unlock(&dns_mutex);
+}
+
+/**
+ * \param[in] secs Entry lifetime in seconds
+ *
+ * Set the lifetime of DNS cache entries (default: 3600s).
+ *
+ * Since getaddrinfo() doesn't expose the resolver's TTL, cached entries age
+ * out after this fixed lifetime and are then resolved (and replaced) again.
+ */
+void wget_dns_cache_set_ttl(int secs)
+{
+	dns_cache_ttl_ms = secs * 1000LL;
+}
+
+// On-disk DNS cache format: a header followed by one record per entry.
+// Each record is the host/port key, the expiry timestamp and the flattened
+// addrinfo list (family/socktype/protocol plus the raw sockaddr bytes).
+#define DNS_CACHE_FILE_MAGIC "WG2DNS\1"
+
+typedef struct {
+	char
+		magic[8];
+	uint32_t
+		nrecords;
+} _dns_file_header_t;
+
+typedef struct {
+	int64_t
+		expiry_ts;
+	uint16_t
+		port,
+		hostlen, // including terminating zero
+		naddrs,
+		unused;
+} _dns_file_record_t;
+
+typedef struct {
+	int32_t
+		family,
+		socktype,
+		protocol;
+	uint32_t
+		addrlen;
+} _dns_file_addr_t;
+
+/**
+ * \param[in] fname Name of the file to write the DNS cache to
+ * \return 0 on success, -1 on failure
+ *
+ * Save the current DNS cache entries to \p fname in a compact binary format.
+ * Entries that already exceeded their lifetime are skipped.
+ *
+ * Together with wget_dns_cache_load() this avoids re-resolving thousands of
+ * host names when a crawl is re-invoked shortly after (e.g. hourly runs).
+ */
+int wget_dns_cache_save(const char *fname)
+{
+	_dns_file_header_t header;
+	struct _dns_table *table;
+	FILE *fp;
+	long long now = wget_get_timemillis();
+
+	if (!fname)
+		return -1;
+
+	if (!(fp = fopen(fname, "wb"))) {
+		debug_printf("Failed to open DNS cache file %s for writing\n", fname);
+		return -1;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, DNS_CACHE_FILE_MAGIC, sizeof(header.magic));
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1)
+		goto fail;
+
 	wget_thread_mutex_lock(&dns_mutex);
-	wget_vector_free(&dns_cache);
+
+	if ((table = dns_table)) {
+		for (unsigned int it = 0; it <= table->mask; it++) {
+			struct _dns_entry *entryp = table->entries[it];
+			_dns_file_record_t rec;
+			struct addrinfo *ai;
+
+			if (!entryp || !entryp->host || entryp->expiry_ts <= now)
+				continue;
+
+			memset(&rec, 0, sizeof(rec));
+			rec.expiry_ts = entryp->expiry_ts;
+			rec.port = entryp->port;
+			rec.hostlen = (uint16_t) strlen(entryp->host) + 1;
+			for (ai = entryp->addrinfo; ai; ai = ai->ai_next)
+				rec.naddrs++;
+
+			if (fwrite(&rec, sizeof(rec), 1, fp) != 1
+				|| fwrite(entryp->host, rec.hostlen, 1, fp) != 1)
+			{
+				wget_thread_mutex_unlock(&dns_mutex);
+				goto fail;
+			}
+
+			for (ai = entryp->addrinfo; ai; ai = ai->ai_next) {
+				_dns_file_addr_t addr = {
+					.family = ai->ai_family,
+					.socktype = ai->ai_socktype,
+					.protocol = ai->ai_protocol,
+					.addrlen = ai->ai_addrlen
+				};
+
+				if (fwrite(&addr, sizeof(addr), 1, fp) != 1
+					|| (ai->ai_addrlen && fwrite(ai->ai_addr, ai->ai_addrlen, 1, fp) != 1))
+				{
+					wget_thread_mutex_unlock(&dns_mutex);
+					goto fail;
+				}
+			}
+
+			header.nrecords++;
+		}
+	}
+
 	wget_thread_mutex_unlock(&dns_mutex);
+
+	// patch the record count into the header
+	if (fseek(fp, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, fp) != 1)
+		goto fail;
+
+	if (fclose(fp)) {
+		fp = NULL;
+		goto fail;
+	}
+
+	debug_printf("Saved %u DNS cache entries to %s\n", (unsigned) header.nrecords, fname);
+	return 0;
+
+fail:
+	debug_printf("Failed to write DNS cache file %s\n", fname);
+	if (fp)
+		fclose(fp);
+	unlink(fname);
+	return -1;
+}
+
+/**
+ * \param[in] fname Name of the file to read DNS cache entries from
+ * \return Number of entries loaded, or -1 on failure
+ *
+ * Load DNS cache entries previously written by wget_dns_cache_save().
+ * Entries whose lifetime already passed are dropped, existing fresh cache
+ * entries are not overwritten.
+ */
+int wget_dns_cache_load(const char *fname)
+{
+	const _dns_file_header_t *header;
+	const char *data, *p, *end;
+	size_t size;
+	long long now = wget_get_timemillis();
+	int loaded = 0;
+
+	if (!fname)
+		return -1;
+
+	if (!(data = wget_read_file(fname, &size)))
+		return -1; // no cache file yet
+
+	if (size < sizeof(*header)
+		|| memcmp((header = (const _dns_file_header_t *) data)->magic, DNS_CACHE_FILE_MAGIC, sizeof(header->magic)))
+		goto invalid;
+
+	p = data + sizeof(*header);
+	end = data + size;
+
+	for (uint32_t it = 0; it < header->nrecords; it++) {
+		_dns_file_record_t rec;
+		struct _dns_entry *entryp, *found;
+		struct addrinfo *head = NULL, **tail = &head;
+
+		if (p + sizeof(rec) > end)
+			goto invalid;
+		memcpy(&rec, p, sizeof(rec)); // alignment-safe
+		p += sizeof(rec);
+
+		if (!rec.hostlen || p + rec.hostlen > end || p[rec.hostlen - 1])
+			goto invalid;
+
+		const char *host = p;
+		p += rec.hostlen;
+
+		for (unsigned int ait = 0; ait < rec.naddrs; ait++) {
+			_dns_file_addr_t addr;
+			struct addrinfo *ai;
+
+			if (p + sizeof(addr) > end)
+				goto invalid;
+			memcpy(&addr, p, sizeof(addr));
+			p += sizeof(addr);
+
+			if (p + addr.addrlen > end)
+				goto invalid;
+
+			// one allocation per node, the sockaddr lives right behind the struct
+			ai = xcalloc(1, sizeof(struct addrinfo) + addr.addrlen);
+			ai->ai_family = addr.family;
+			ai->ai_socktype = addr.socktype;
+			ai->ai_protocol = addr.protocol;
+			ai->ai_addrlen = addr.addrlen;
+			if (addr.addrlen) {
+				ai->ai_addr = (struct sockaddr *) (ai + 1);
+				memcpy(ai->ai_addr, p, addr.addrlen);
+			}
+			*tail = ai;
+			tail = &ai->ai_next;
+
+			p += addr.addrlen;
+		}
+
+		if (!head || rec.expiry_ts <= now) {
+			// stale record - drop it
+			for (struct addrinfo *ai = head, *next; ai; ai = next) {
+				next = ai->ai_next;
+				xfree(ai);
+			}
+			continue;
+		}
+
+		entryp = _alloc_dns_entry(host, rec.port);
+		entryp->addrinfo = head;
+		entryp->expiry_ts = rec.expiry_ts;
+		entryp->allocated = true;
+		if (!wget_ip_to_string(head->ai_addr, entryp->ip, sizeof(entryp->ip)))
+			wget_strscpy(entryp->ip, "???", sizeof(entryp->ip));
+
+		wget_thread_mutex_lock(&dns_mutex);
+		found = _dns_cache_insert(entryp);
+		wget_thread_mutex_unlock(&dns_mutex);
+
+		if (found != entryp)
+			_free_dns_entry(entryp); // a fresh entry was already there
+		else
+			loaded++;
+	}
+
+	xfree(data);
+	debug_printf("Loaded %d DNS cache entries from %s\n", loaded, fname);
+	return loaded;
+
+invalid:
+	error_printf(_("Invalid DNS cache file %s - ignored\n"), fname);
+	xfree(data);
+	return -1;
 }
 
 /**
@@ -416,7 +857,7 @@ struct addrinfo *wget_tcp_resolve(wget_tcp_t *tcp, const char *host, uint16_t po
 		mutex = WGET_THREAD_MUTEX_INITIALIZER;
 	struct addrinfo *addrinfo = NULL;
 	int rc = 0;
-	char adr[NI_MAXHOST], sport[NI_MAXSERV];
+	char adr[INET6_ADDRSTRLEN];
 	long long before_millisecs = 0;
 	_stats_data_t stats;
 
@@ -479,7 +920,7 @@ struct addrinfo *wget_tcp_resolve(wget_tcp_t *tcp, const char *host, uint16_t po
 		addrinfo = _wget_sort_preferred(addrinfo, tcp->preferred_family);
 
 	if (stats_callback) {
-		if ((rc = getnameinfo(addrinfo->ai_addr, addrinfo->ai_addrlen, adr, sizeof(adr), sport, sizeof(sport), NI_NUMERICHOST | NI_NUMERICSERV)) == 0)
+		if (wget_ip_to_string(addrinfo->ai_addr, adr, sizeof(adr)))
 			stats.ip = adr;
 		else
 			stats.ip = "???";
@@ -490,10 +931,10 @@ struct addrinfo *wget_tcp_resolve(wget_tcp_t *tcp, const char *host, uint16_t po
 	/* Finally, print the address list to the debug pipe if enabled */
 	if (wget_logger_is_active(wget_get_logger(WGET_LOGGER_DEBUG))) {
 		for (struct addrinfo *ai = addrinfo; ai; ai = ai->ai_next) {
-			if ((rc = getnameinfo(ai->ai_addr, ai->ai_addrlen, adr, sizeof(adr), sport, sizeof(sport), NI_NUMERICHOST | NI_NUMERICSERV)) == 0)
-				debug_printf("has %s:%s\n", adr, sport);
+			if (wget_ip_to_string(ai->ai_addr, adr, sizeof(adr)))
+				debug_printf("has %s:%hu\n", adr, _sockaddr_port(ai->ai_addr));
 			else
-				debug_printf("has ??? (%s)\n", gai_strerror(rc));
+				debug_printf("has ???\n");
 		}
 	}
 
@@ -567,6 +1008,21 @@ char wget_tcp_get_tcp_fastopen(wget_tcp_t *tcp)
 	return (tcp ? tcp : &_global_tcp)->tcp_fastopen;
 }
 
+/**
+ * \param[out] nsends Number of requests that rode the SYN via TCP Fast Open. Might be NULL.
+ * \param[out] nfallbacks Number of times TFO wasn't supported and a normal handshake was done. Might be NULL.
+ *
+ * Get process-wide counters telling how often the TCP Fast Open fast path
+ * was actually taken resp. how often it had to fall back.
+ */
+void wget_tcp_get_stats_tcp_fastopen(int *nsends, int *nfallbacks)
+{
+	if (nsends)
+		*nsends = _tfo_sends;
+	if (nfallbacks)
+		*nfallbacks = _tfo_fallbacks;
+}
+
 /**
  * \param[in] tcp A `wget_tcp_t` structure representing a TCP connection, returned by wget_tcp_init(). Might be NULL.
  * \param[in] false_start 1 or 0, whether to enable or disable TLS False Start.
@@ -593,6 +1049,36 @@ char wget_tcp_get_tls_false_start(wget_tcp_t *tcp)
 	return (tcp ? tcp : &_global_tcp)->tls_false_start;
 }
 
+/**
+ * \param[in] tcp A `wget_tcp_t` structure representing a TCP connection, returned by wget_tcp_init(). Might be NULL.
+ * \param[in] early_data 1 or 0, whether to enable or disable TLS 1.3 0-RTT early data.
+ *
+ * Enable or disable TLS 1.3 0-RTT early data ([RFC 8446](https://tools.ietf.org/html/rfc8446), section 2.3).
+ *
+ * With early data enabled and a cached TLS session at hand, the first write on the
+ * connection travels in the same flight as the handshake, saving a full round trip.
+ * Early data is replayable by an attacker, so enable it only for idempotent requests.
+ *
+ * If \p tcp is NULL, TLS early data is enabled or disabled globally.
+ */
+void wget_tcp_set_tls_early_data(wget_tcp_t *tcp, int early_data)
+{
+	(tcp ? tcp : &_global_tcp)->tls_early_data = !!early_data;
+}
+
+/**
+ * \param[in] tcp A `wget_tcp_t` structure representing a TCP connection, returned by wget_tcp_init(). Might be NULL.
+ * \return 1 if TLS early data is enabled, 0 otherwise.
+ *
+ * Tells whether TLS 1.3 0-RTT early data is enabled or not.
+ *
+ * You can enable and disable it with wget_tcp_set_tls_early_data().
+ */
+char wget_tcp_get_tls_early_data(wget_tcp_t *tcp)
+{
+	return (tcp ? tcp : &_global_tcp)->tls_early_data;
+}
+
 /**
  * \param[in] tcp A `wget_tcp_t` structure representing a TCP connection, returned by wget_tcp_init(). Might be NULL.
  * \param[in] caching 1 or 0, whether to enable or disable DNS caching
@@ -712,13 +1198,10 @@ int wget_tcp_get_local_port(wget_tcp_t *tcp)
 	struct sockaddr_storage addr_store;
 	struct sockaddr *addr = (struct sockaddr *)&addr_store;
 	socklen_t addr_len = sizeof(addr_store);
-	char s_port[NI_MAXSERV];
 
 	/* Get automatically retrieved port number */
-	if (getsockname(tcp->sockfd, addr, &addr_len) == 0) {
-		if (getnameinfo(addr, addr_len, NULL, 0, s_port, sizeof(s_port), NI_NUMERICSERV) == 0)
-			return atoi(s_port);
-	}
+	if (getsockname(tcp->sockfd, addr, &addr_len) == 0)
+		return _sockaddr_port(addr);
 
 	return 0;
 }
@@ -821,6 +1304,92 @@ int wget_tcp_get_timeout(wget_tcp_t *tcp)
 	return (tcp ? tcp : &_global_tcp)->timeout;
 }
 
+/**
+ * \param[in] tcp A TCP connection.
+ * \return The underlying socket descriptor, or -1 if not connected.
+ *
+ * Get the socket descriptor of a connection, e.g. for registering it
+ * with an event loop (epoll, poll, ...). The descriptor stays owned by
+ * the connection - don't read, write or close it directly.
+ */
+int wget_tcp_get_fd(wget_tcp_t *tcp)
+{
+	return (tcp ? tcp : &_global_tcp)->sockfd;
+}
+
+/**
+ * \param[in] tcp A TCP connection. Might be NULL.
+ * \param[in] size Size of the readahead buffer in bytes.
+ *
+ * Set the size of the internal readahead buffer used by wget_tcp_read().
+ *
+ * When a caller asks for fewer bytes than this, the connection reads up to
+ * \p size bytes in one go and serves subsequent calls from the buffer, which
+ * reduces the number of syscalls for small sequential reads.
+ *
+ * A value of `0` disables readahead buffering. The default is 8 kB.
+ */
+void wget_tcp_set_readahead_size(wget_tcp_t *tcp, size_t size)
+{
+	(tcp ? tcp : &_global_tcp)->readahead_size = size;
+}
+
+/**
+ * \param[in] tcp A TCP connection. Might be NULL.
+ * \return The readahead buffer size that was set with wget_tcp_set_readahead_size().
+ *
+ * Get the readahead buffer size that was set with wget_tcp_set_readahead_size().
+ */
+size_t wget_tcp_get_readahead_size(wget_tcp_t *tcp)
+{
+	return (tcp ? tcp : &_global_tcp)->readahead_size;
+}
+
+/**
+ * \param[in] tcp A TCP connection. Might be NULL.
+ * \param[in] rate Transfer rate limit in bytes per second, 0 disables pacing.
+ *
+ * Limit the transfer rate of the connection (or, if \p tcp is NULL, of all
+ * connections created afterwards).
+ *
+ * Instead of parking the thread for long periods, reads and writes are split
+ * into small chunks that are spread evenly over time, which keeps TCP windows
+ * and congestion control happy. Where the platform supports it, the kernel
+ * assists via the `SO_MAX_PACING_RATE` socket option.
+ */
+void wget_tcp_set_pacing_rate(wget_tcp_t *tcp, size_t rate)
+{
+	(tcp ? tcp : &_global_tcp)->pacing_rate = rate;
+}
+
+/**
+ * \param[in] tcp A TCP connection. Might be NULL.
+ * \return The transfer rate limit that was set with wget_tcp_set_pacing_rate().
+ *
+ * Get the transfer rate limit that was set with wget_tcp_set_pacing_rate().
+ */
+size_t wget_tcp_get_pacing_rate(wget_tcp_t *tcp)
+{
+	return (tcp ? tcp : &_global_tcp)->pacing_rate;
+}
+
+/**
+ * \param[in] tcp A TCP connection. Might be NULL.
+ * \param[in] caps_db A capability database, or NULL to disable buffer autotuning.
+ *
+ * Attach a capability database to the connection (or, if \p tcp is NULL, to all
+ * connections created afterwards).
+ *
+ * With a database attached, wget_tcp_connect() sizes the socket buffers from
+ * the bandwidth-delay product measured on earlier connections to the same
+ * host, and feeds its own connect time back as the route's RTT. See
+ * wget_caps_db_get_bufsize() and wget_caps_db_add_bdp().
+ */
+void wget_tcp_set_caps_db(wget_tcp_t *tcp, wget_caps_db_t *caps_db)
+{
+	(tcp ? tcp : &_global_tcp)->caps_db = caps_db;
+}
+
 /**
  * \param[in] tcp A TCP connection. Might be NULL.
  * \param[in] bind_address An IP address or host name.
@@ -932,6 +1501,51 @@ const char *wget_tcp_get_ssl_hostname(wget_tcp_t *tcp)
 	return (tcp ? tcp : &_global_tcp)->ssl_hostname;
 }
 
+/**
+ * \param[in] tcp A TCP connection. Might be NULL.
+ * \param[in] hostport The SOCKS5 proxy as 'host[:port]' (default port 1080), or NULL for a direct connection.
+ *
+ * Route the connection through a SOCKS5 proxy (RFC 1928). wget_tcp_connect()
+ * then connects to the proxy and issues a CONNECT for the real destination,
+ * passing the hostname unresolved so DNS happens at the proxy. Only TCP
+ * tunnels are used, UDP ASSOCIATE is never issued.
+ *
+ * If \p tcp is NULL, the proxy becomes the default for subsequently created
+ * connections.
+ */
+void wget_tcp_set_socks5_proxy(wget_tcp_t *tcp, const char *hostport)
+{
+	if (!tcp)
+		tcp = &_global_tcp;
+
+	xfree(tcp->socks5_host);
+	tcp->socks5_port = 1080;
+
+	if (!hostport)
+		return;
+
+	if (!strncmp(hostport, "socks5://", 9))
+		hostport += 9;
+
+	const char *colon = strrchr(hostport, ':');
+
+	// a colon inside an unbracketed IPv6 literal is not a port separator
+	if (colon && !strchr(colon, ']') && strchr(hostport, ':') == colon) {
+		tcp->socks5_host = wget_strmemdup(hostport, colon - hostport);
+		tcp->socks5_port = (uint16_t) atoi(colon + 1);
+	} else
+		tcp->socks5_host = wget_strdup(hostport);
+}
+
+/**
+ * \param[in] tcp A TCP connection. Might be NULL.
+ * \return The SOCKS5 proxy host set with wget_tcp_set_socks5_proxy(), or NULL.
+ */
+const char *wget_tcp_get_socks5_proxy(wget_tcp_t *tcp)
+{
+	return (tcp ? tcp : &_global_tcp)->socks5_host;
+}
+
 /**
  * \return A new `wget_tcp_t` structure, with pre-defined parameters.
  *
@@ -947,6 +1561,7 @@ wget_tcp_t *wget_tcp_init(void)
 
 	*tcp = _global_tcp;
 	tcp->ssl_hostname = wget_strdup(_global_tcp.ssl_hostname);
+	tcp->socks5_host = wget_strdup(_global_tcp.socks5_host);
 
 	return tcp;
 }
@@ -969,6 +1584,7 @@ void wget_tcp_deinit(wget_tcp_t **_tcp)
 
 	if (!_tcp) {
 		xfree(_global_tcp.ssl_hostname);
+		xfree(_global_tcp.socks5_host);
 		return;
 	}
 
@@ -981,7 +1597,9 @@ void wget_tcp_deinit(wget_tcp_t **_tcp)
 		}
 
 		xfree(tcp->ssl_hostname);
+		xfree(tcp->socks5_host);
 		xfree(tcp->ip);
+		xfree(tcp->readahead_buf);
 		xfree(tcp);
 
 		if (_tcp)
@@ -1007,7 +1625,7 @@ static void _set_async(int fd)
 #endif
 }
 
-static void _set_socket_options(int fd)
+static void _set_socket_options(const wget_tcp_t *tcp, int fd)
 {
 	int on = 1;
 
@@ -1017,21 +1635,360 @@ static void _set_socket_options(int fd)
 	on = 1;
 	if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void *)&on, sizeof(on)) == -1)
 		error_printf(_("Failed to set socket option NODELAY\n"));
+
+#ifdef SO_MAX_PACING_RATE
+	// let the kernel's fq pacing assist the userspace rate limiting
+	if (tcp->pacing_rate) {
+		unsigned int rate = tcp->pacing_rate > UINT_MAX ? UINT_MAX : (unsigned int) tcp->pacing_rate;
+
+		if (setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, (void *)&rate, sizeof(rate)) == -1)
+			error_printf(_("Failed to set socket option MAX_PACING_RATE\n"));
+	}
+#else
+	(void) tcp;
+#endif
+
+	// buffers sized to the route's bandwidth-delay product let high-BDP
+	// paths fill their window; the kernel caps the request at
+	// net.core.rmem_max / wmem_max, so this is best effort
+	if (tcp->sockbuf_size > 0) {
+		int size = tcp->sockbuf_size;
+
+		if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (void *)&size, sizeof(size)) == -1)
+			error_printf(_("Failed to set socket option RCVBUF\n"));
+		if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, (void *)&size, sizeof(size)) == -1)
+			error_printf(_("Failed to set socket option SNDBUF\n"));
+	}
 }
 
-/**
- * Test whether the given connection (\p tcp) is ready to read or write.
- *
- * The parameter \p flags can have one or both (with bitwise OR) of the following values:
- *
+// finish an established connection: TLS handshake and peer IP bookkeeping.
+// Returns WGET_E_SUCCESS, WGET_E_CERTIFICATE (fatal, stop trying) or another
+// error code (caller may try the next address).
+// send exactly <len> bytes, honoring the connection's timeout
+static int _socks5_send(wget_tcp_t *tcp, int sockfd, const void *buf, size_t len)
+{
+	const char *p = buf;
+
+	while (len) {
+		if (wget_ready_2_transfer(sockfd, tcp->timeout, WGET_IO_WRITABLE) <= 0)
+			return WGET_E_TIMEOUT;
+
+		ssize_t n = send(sockfd, p, len, 0);
+
+		if (n <= 0)
+			return WGET_E_CONNECT;
+
+		p += n;
+		len -= n;
+	}
+
+	return WGET_E_SUCCESS;
+}
+
+// receive exactly <len> bytes, honoring the connection's timeout
+static int _socks5_recv(wget_tcp_t *tcp, int sockfd, void *buf, size_t len)
+{
+	char *p = buf;
+
+	while (len) {
+		if (wget_ready_2_transfer(sockfd, tcp->timeout, WGET_IO_READABLE) <= 0)
+			return WGET_E_TIMEOUT;
+
+		ssize_t n = recv(sockfd, p, len, 0);
+
+		if (n <= 0)
+			return WGET_E_CONNECT;
+
+		p += n;
+		len -= n;
+	}
+
+	return WGET_E_SUCCESS;
+}
+
+/*
+ * Minimal SOCKS5 (RFC 1928) client handshake on a just-connected socket:
+ * a no-authentication greeting followed by one CONNECT for the destination.
+ * The hostname goes out unresolved (ATYP=3), so DNS happens at the proxy,
+ * and no UDP ASSOCIATE is ever issued - the tunnel is plain TCP and behaves
+ * like any direct connection afterwards (keep-alive, TLS, pooling).
+ */
+static int _socks5_handshake(wget_tcp_t *tcp, int sockfd)
+{
+	const char *host = tcp->socks5_dest_host;
+	size_t host_len = strlen(host);
+	uint16_t port = tcp->socks5_dest_port;
+	unsigned char buf[262]; // 4 + 1 + 255 + 2, the largest message either way
+	int rc;
+
+	if (host_len > 255) {
+		error_printf(_("SOCKS5: hostname too long '%s'\n"), host);
+		return WGET_E_CONNECT;
+	}
+
+	// greeting: version 5, one method, 'no authentication'
+	buf[0] = 5; buf[1] = 1; buf[2] = 0;
+	if ((rc = _socks5_send(tcp, sockfd, buf, 3)))
+		return rc;
+	if ((rc = _socks5_recv(tcp, sockfd, buf, 2)))
+		return rc;
+	if (buf[0] != 5 || buf[1] != 0) {
+		error_printf(_("SOCKS5: proxy requires authentication (method %d)\n"), (int) buf[1]);
+		return WGET_E_CONNECT;
+	}
+
+	// request: CONNECT to host:port, hostname unresolved
+	buf[0] = 5; buf[1] = 1; buf[2] = 0; buf[3] = 3;
+	buf[4] = (unsigned char) host_len;
+	memcpy(buf + 5, host, host_len);
+	buf[5 + host_len] = (unsigned char) (port >> 8);
+	buf[6 + host_len] = (unsigned char) (port & 0xff);
+	if ((rc = _socks5_send(tcp, sockfd, buf, 7 + host_len)))
+		return rc;
+
+	// reply: version, status, reserved, bound address (type-dependent), port
+	if ((rc = _socks5_recv(tcp, sockfd, buf, 4)))
+		return rc;
+	if (buf[0] != 5 || buf[1] != 0) {
+		error_printf(_("SOCKS5: connect to %s:%hu failed (status %d)\n"), host, port, (int) buf[1]);
+		return WGET_E_CONNECT;
+	}
+
+	size_t bound_len;
+	switch (buf[3]) {
+	case 1: bound_len = 4 + 2; break; // IPv4 + port
+	case 4: bound_len = 16 + 2; break; // IPv6 + port
+	case 3: // domain: length byte + name + port
+		if ((rc = _socks5_recv(tcp, sockfd, buf, 1)))
+			return rc;
+		bound_len = buf[0] + 2;
+		break;
+	default:
+		error_printf(_("SOCKS5: unknown address type %d in reply\n"), (int) buf[3]);
+		return WGET_E_CONNECT;
+	}
+
+	if ((rc = _socks5_recv(tcp, sockfd, buf, bound_len)))
+		return rc;
+
+	debug_printf("SOCKS5 tunnel to %s:%hu established\n", host, port);
+	return WGET_E_SUCCESS;
+}
+
+static int _tcp_connect_finalize(wget_tcp_t *tcp, struct addrinfo *ai, int sockfd, long long start_millisecs)
+{
+	char adr[INET6_ADDRSTRLEN];
+	int ret;
+
+	tcp->sockfd = sockfd;
+	tcp->connect_millisecs = wget_get_timemillis() - start_millisecs;
+
+	// the tunnel must be up before TLS - the handshake below runs against
+	// the origin, not the proxy
+	if (tcp->socks5_host && tcp->socks5_dest_host) {
+		if ((ret = _socks5_handshake(tcp, sockfd))) {
+			struct addrinfo *ai_tmp = tcp->addrinfo;
+
+			tcp->addrinfo = NULL; /* do not free tcp->addrinfo when calling wget_tcp_close() */
+			wget_tcp_close(tcp);
+			tcp->addrinfo = ai_tmp;
+
+			return ret;
+		}
+	}
+
+	if (tcp->ssl) {
+		if ((ret = wget_ssl_open(tcp))) {
+			if (ret == WGET_E_CERTIFICATE) {
+				wget_tcp_close(tcp);
+				return ret; /* stop here - the server cert couldn't be validated */
+			}
+
+			/* do not free tcp->addrinfo when calling wget_tcp_close() */
+			struct addrinfo *ai_tmp = tcp->addrinfo;
+
+			tcp->addrinfo = NULL;
+			wget_tcp_close(tcp);
+			tcp->addrinfo = ai_tmp;
+
+			return ret;
+		}
+	}
+
+	if (wget_ip_to_string(ai->ai_addr, adr, sizeof(adr)))
+		tcp->ip = wget_strdup(adr);
+	else
+		tcp->ip = wget_strdup("???");
+
+	return WGET_E_SUCCESS;
+}
+
+/*
+ * Happy Eyeballs (RFC 8305): when a host resolves to several addresses, race
+ * staggered connection attempts interleaved by address family and keep the
+ * first one that completes, instead of waiting out a full connect timeout on
+ * each dead address before trying the next one.
+ */
+#define HAPPY_EYEBALLS_DELAY 250 // milliseconds head start per connection attempt
+#define HAPPY_EYEBALLS_MAX 8 // race at most this many addresses
+
+// create a socket and kick off a non-blocking connect, returns the socket or -1.
+// *fatal is set on errors that make trying further addresses pointless.
+static int _tcp_connect_start(wget_tcp_t *tcp, struct addrinfo *ai, bool *fatal)
+{
+	int sockfd, rc;
+
+	*fatal = false;
+
+	if ((sockfd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) == -1) {
+		error_printf(_("Failed to create socket (%d)\n"), errno);
+		return -1;
+	}
+
+	_set_async(sockfd);
+	_set_socket_options(tcp, sockfd);
+
+	if (tcp->bind_addrinfo) {
+		if (bind(sockfd, tcp->bind_addrinfo->ai_addr, tcp->bind_addrinfo->ai_addrlen) != 0) {
+			error_printf(_("Failed to bind (%d)\n"), errno);
+			close(sockfd);
+			*fatal = true;
+			return -1;
+		}
+	}
+
+	rc = connect(sockfd, ai->ai_addr, ai->ai_addrlen);
+	if (rc < 0 && errno != EAGAIN && errno != EINPROGRESS) {
+		debug_printf("Failed to connect (%d)\n", errno);
+		close(sockfd);
+		return -1;
+	}
+
+	return sockfd;
+}
+
+static int _connect_happy_eyeballs(wget_tcp_t *tcp, struct addrinfo **winner, bool *fatal)
+{
+	struct addrinfo *families[2][HAPPY_EYEBALLS_MAX], *order[HAPPY_EYEBALLS_MAX];
+	struct { int sockfd; struct addrinfo *ai; } attempt[HAPPY_EYEBALLS_MAX];
+	int nfam[2] = { 0, 0 }, norder = 0, nattempts = 0, started = 0;
+	int first_family = tcp->addrinfo->ai_family;
+	long long now = wget_get_timemillis();
+	long long next_start = now;
+	long long deadline = tcp->connect_timeout >= 0 ? now + tcp->connect_timeout : 0;
+
+	*fatal = false;
+
+	// interleave the address families, the preferred family goes first
+	// (the list comes family-sorted from _wget_sort_preferred())
+	for (struct addrinfo *ai = tcp->addrinfo; ai; ai = ai->ai_next) {
+		int f = ai->ai_family == first_family ? 0 : 1;
+
+		if (nfam[f] < HAPPY_EYEBALLS_MAX)
+			families[f][nfam[f]++] = ai;
+	}
+	for (int it = 0; norder < HAPPY_EYEBALLS_MAX && (it < nfam[0] || it < nfam[1]); it++) {
+		if (it < nfam[0])
+			order[norder++] = families[0][it];
+		if (norder < HAPPY_EYEBALLS_MAX && it < nfam[1])
+			order[norder++] = families[1][it];
+	}
+
+	while (started < norder || nattempts > 0) {
+		wget_io_event_t events[HAPPY_EYEBALLS_MAX];
+		int timeout;
+
+		now = wget_get_timemillis();
+
+		if (deadline && now >= deadline)
+			break; // overall connect timeout
+
+		// give the previous attempt its head start, then race the next address
+		if (started < norder && (nattempts == 0 || now >= next_start)) {
+			int sockfd = _tcp_connect_start(tcp, order[started], fatal);
+
+			if (*fatal)
+				break;
+
+			started++;
+
+			if (sockfd == -1)
+				continue; // immediately try the next address
+
+			attempt[nattempts].sockfd = sockfd;
+			attempt[nattempts].ai = order[started - 1];
+			nattempts++;
+			next_start = now + HAPPY_EYEBALLS_DELAY;
+		}
+
+		for (int it = 0; it < nattempts; it++) {
+			events[it].fd = attempt[it].sockfd;
+			events[it].events = WGET_IO_WRITABLE;
+		}
+
+		// wake up for the next staggered attempt or the overall deadline
+		if (started < norder)
+			timeout = (int) (next_start - now);
+		else if (deadline)
+			timeout = (int) (deadline - now);
+		else
+			timeout = -1;
+
+		if (deadline && timeout > (int) (deadline - now))
+			timeout = (int) (deadline - now);
+
+		if (wget_ready_2_transfer_multi(events, nattempts, timeout) <= 0)
+			continue; // stagger delay expired or interrupted
+
+		for (int it = 0; it < nattempts; it++) {
+			int err = 0;
+			socklen_t errlen = sizeof(err);
+
+			if (!(events[it].revents & WGET_IO_WRITABLE))
+				continue;
+
+			if (getsockopt(attempt[it].sockfd, SOL_SOCKET, SO_ERROR, (void *)&err, &errlen) == 0 && err == 0) {
+				// we have a winner - close the losing attempts
+				int sockfd = attempt[it].sockfd;
+
+				*winner = attempt[it].ai;
+				for (int j = 0; j < nattempts; j++)
+					if (j != it)
+						close(attempt[j].sockfd);
+
+				return sockfd;
+			}
+
+			debug_printf("Connect attempt failed (%d)\n", err);
+			close(attempt[it].sockfd);
+			attempt[it] = attempt[--nattempts];
+			break; // events[] indexes are stale now, poll again
+		}
+	}
+
+	for (int it = 0; it < nattempts; it++)
+		close(attempt[it].sockfd);
+
+	return -1;
+}
+
+/**
+ * Test whether the given connection (\p tcp) is ready to read or write.
+ *
+ * The parameter \p flags can have one or both (with bitwise OR) of the following values:
+ *
  *  - `WGET_IO_READABLE`: Is data available for reading?
  *  - `WGET_IO_WRITABLE`: Can we write immediately (without having to wait until the TCP buffer frees)?
  */
 int wget_tcp_ready_2_transfer(wget_tcp_t *tcp, int flags)
 {
-	if (likely(tcp))
+	if (likely(tcp)) {
+		// buffered readahead data is readable without touching the socket
+		if ((flags & WGET_IO_READABLE) && tcp->readahead_fill > tcp->readahead_pos)
+			return WGET_IO_READABLE;
+
 		return wget_ready_2_transfer(tcp->sockfd, tcp->timeout, flags);
-	else
+	} else
 		return -1;
 }
 
@@ -1043,6 +2000,11 @@ int wget_tcp_ready_2_transfer(wget_tcp_t *tcp, int flags)
  *
  * Open a TCP connection with a remote host.
  *
+ * If the host resolves to several addresses, connection attempts are raced in
+ * parallel with a short stagger between them ("Happy Eyeballs", RFC 8305) and
+ * the first one to complete wins, so a dead address doesn't cost a full
+ * connect timeout.
+ *
  * This function will use TLS if it has been enabled for this `wget_tcp_t`. You can enable it
  * with wget_tcp_set_ssl(). Additionally, you can also use wget_tcp_set_ssl_hostname() to set the
  * Server Name Indication (SNI).
@@ -1061,12 +2023,26 @@ int wget_tcp_connect(wget_tcp_t *tcp, const char *host, uint16_t port)
 {
 	struct addrinfo *ai;
 	int sockfd = -1, rc, ret = WGET_E_UNKNOWN;
-	char adr[NI_MAXHOST], s_port[NI_MAXSERV];
+	char adr[INET6_ADDRSTRLEN];
 	int debug = wget_logger_is_active(wget_get_logger(WGET_LOGGER_DEBUG));
 
 	if (unlikely(!tcp))
 		return -1;
 
+	if (tcp->socks5_host) {
+		// connect to the bastion instead, the origin is reached through the
+		// tunnel and its hostname is resolved by the proxy, not locally
+		tcp->socks5_dest_host = host;
+		tcp->socks5_dest_port = port;
+		host = tcp->socks5_host;
+		port = tcp->socks5_port;
+		tcp->tcp_fastopen = 0; // the handshake needs an established stream
+	}
+
+	// size the socket buffers from what earlier transfers revealed about
+	// the route's bandwidth-delay product (0 = kernel default)
+	tcp->sockbuf_size = wget_caps_db_get_bufsize(tcp->caps_db, host, port);
+
 	if (tcp->addrinfo_allocated)
 		freeaddrinfo(tcp->addrinfo);
 
@@ -1074,33 +2050,49 @@ int wget_tcp_connect(wget_tcp_t *tcp, const char *host, uint16_t port)
 
 	tcp->addrinfo_allocated = !tcp->caching;
 
+	// connect phase starts after name resolution - resolve time is reported separately
+	long long start_millisecs = wget_get_timemillis();
+
+	// Happy Eyeballs: with several addresses race staggered parallel attempts
+	// and take the first to complete. Not with TCP Fast Open, where connect()
+	// is deferred until the first send.
+	if (!tcp->tcp_fastopen && tcp->addrinfo && tcp->addrinfo->ai_next) {
+		struct addrinfo *winner = NULL;
+		bool fatal;
+
+		if ((sockfd = _connect_happy_eyeballs(tcp, &winner, &fatal)) != -1) {
+			tcp->first_send = 0;
+
+			ret = _tcp_connect_finalize(tcp, winner, sockfd, start_millisecs);
+			if (ret == WGET_E_SUCCESS) {
+				// feed the measured connect time back as this route's RTT
+				wget_caps_db_add_bdp(tcp->caps_db, host, port, (int) tcp->connect_millisecs, -1);
+			}
+			if (ret == WGET_E_SUCCESS || ret == WGET_E_CERTIFICATE)
+				return ret;
+			// else fall back to the serial loop below (e.g. TLS failed)
+		} else if (fatal)
+			return -1;
+	}
+
 	for (ai = tcp->addrinfo; ai; ai = ai->ai_next) {
 		if (debug) {
-			rc = getnameinfo(ai->ai_addr, ai->ai_addrlen,
-					adr, sizeof(adr),
-					s_port, sizeof(s_port),
-					NI_NUMERICHOST | NI_NUMERICSERV);
-			if (rc == 0)
-				debug_printf("trying %s:%s...\n", adr, s_port);
+			if (wget_ip_to_string(ai->ai_addr, adr, sizeof(adr)))
+				debug_printf("trying %s:%hu...\n", adr, _sockaddr_port(ai->ai_addr));
 			else
-				debug_printf("trying ???:%s (%s)...\n", s_port, gai_strerror(rc));
+				debug_printf("trying ???:%hu...\n", _sockaddr_port(ai->ai_addr));
 		}
 
 		if ((sockfd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)) != -1) {
 			_set_async(sockfd);
-			_set_socket_options(sockfd);
+			_set_socket_options(tcp, sockfd);
 
 			if (tcp->bind_addrinfo) {
 				if (debug) {
-					rc = getnameinfo(tcp->bind_addrinfo->ai_addr,
-							tcp->bind_addrinfo->ai_addrlen,
-							adr, sizeof(adr),
-							s_port, sizeof(s_port),
-							NI_NUMERICHOST | NI_NUMERICSERV);
-					if (rc == 0)
-						debug_printf("binding to %s:%s...\n", adr, s_port);
+					if (wget_ip_to_string(tcp->bind_addrinfo->ai_addr, adr, sizeof(adr)))
+						debug_printf("binding to %s:%hu...\n", adr, _sockaddr_port(tcp->bind_addrinfo->ai_addr));
 					else
-						debug_printf("binding to ???:%s (%s)...\n", s_port, gai_strerror(rc));
+						debug_printf("binding to ???:%hu...\n", _sockaddr_port(tcp->bind_addrinfo->ai_addr));
 				}
 
 				if (bind(sockfd, tcp->bind_addrinfo->ai_addr, tcp->bind_addrinfo->ai_addrlen) != 0) {
@@ -1117,6 +2109,8 @@ int wget_tcp_connect(wget_tcp_t *tcp, const char *host, uint16_t port)
 				sa_endpoints_t endpoints = { .sae_dstaddr = ai->ai_addr, .sae_dstaddrlen = ai->ai_addrlen };
 				rc = connectx(sockfd, &endpoints, SAE_ASSOCID_ANY, CONNECT_RESUME_ON_READ_WRITE | CONNECT_DATA_IDEMPOTENT, NULL, 0, NULL, NULL);
 				tcp->first_send = 0;
+				if (rc == 0 || errno == EINPROGRESS)
+					_tfo_count(&_tfo_sends);
 #else
 				rc = 0;
 				errno = 0;
@@ -1136,31 +2130,15 @@ int wget_tcp_connect(wget_tcp_t *tcp, const char *host, uint16_t port)
 				ret = WGET_E_CONNECT;
 				close(sockfd);
 			} else {
-				tcp->sockfd = sockfd;
-				if (tcp->ssl) {
-					if ((ret = wget_ssl_open(tcp))) {
-						if (ret == WGET_E_CERTIFICATE) {
-							wget_tcp_close(tcp);
-							break; /* stop here - the server cert couldn't be validated */
-						}
-
-						/* do not free tcp->addrinfo when calling wget_tcp_close() */
-						struct addrinfo *ai_tmp = tcp->addrinfo;
-
-						tcp->addrinfo = NULL;
-						wget_tcp_close(tcp);
-						tcp->addrinfo = ai_tmp;
-
-						continue;
-					}
-				}
+				ret = _tcp_connect_finalize(tcp, ai, sockfd, start_millisecs);
 
-				if ((rc = getnameinfo(ai->ai_addr, ai->ai_addrlen, adr, sizeof(adr), s_port, sizeof(s_port), NI_NUMERICHOST | NI_NUMERICSERV)) == 0)
-					tcp->ip = wget_strdup(adr);
-				else
-					tcp->ip = wget_strdup("???");
-
-				return WGET_E_SUCCESS;
+				if (ret == WGET_E_SUCCESS) {
+					wget_caps_db_add_bdp(tcp->caps_db, host, port, (int) tcp->connect_millisecs, -1);
+					return WGET_E_SUCCESS;
+				}
+				if (ret == WGET_E_CERTIFICATE)
+					break; /* stop here - the server cert couldn't be validated */
+				/* else continue with the next address */
 			}
 		} else
 			error_printf(_("Failed to create socket (%d)\n"), errno);
@@ -1197,6 +2175,40 @@ void wget_tcp_tls_stop(wget_tcp_t *tcp)
 		wget_ssl_close(&tcp->ssl_session);
 }
 
+// token-bucket pacing: charge transferred bytes against the configured rate
+// and even out the flow with short sleeps instead of parking the thread
+static void _pace_transfer(wget_tcp_t *tcp, ssize_t nbytes)
+{
+	long long now, delay;
+
+	if (!tcp->pacing_rate || nbytes <= 0)
+		return;
+
+	now = wget_get_timemillis();
+
+	if (tcp->pacing_ts < now)
+		tcp->pacing_ts = now; // idle periods don't accumulate credit
+
+	tcp->pacing_ts += (nbytes * 1000) / (long long) tcp->pacing_rate;
+
+	if ((delay = tcp->pacing_ts - now) > 0)
+		wget_millisleep(delay > 1000 ? 1000 : (int) delay);
+}
+
+// cap a single transfer to roughly 100ms worth of rate budget, so pacing
+// works with many small sleeps instead of few long ones
+static size_t _pacing_chunk(wget_tcp_t *tcp, size_t count)
+{
+	if (tcp->pacing_rate) {
+		size_t max_chunk = tcp->pacing_rate / 10 + 1;
+
+		if (count > max_chunk)
+			count = max_chunk;
+	}
+
+	return count;
+}
+
 /**
  * \param[in] tcp An active TCP connection.
  * \param[in] buf Destination buffer, at least \p count bytes long.
@@ -1209,6 +2221,9 @@ void wget_tcp_tls_stop(wget_tcp_t *tcp)
  * This function knows whether the provided connection is over TLS or not
  * and it will do the right thing.
  *
+ * Reads smaller than the connection's readahead buffer (see wget_tcp_set_readahead_size())
+ * are served from that buffer, which is refilled with larger reads as needed.
+ *
  * The `tcp->timeout` parameter is taken into account by this function as well.
  * It specifies how long should this function wait until there's data available
  * to read (in milliseconds). The default timeout is -1, which means to wait indefinitely.
@@ -1230,6 +2245,52 @@ ssize_t wget_tcp_read(wget_tcp_t *tcp, char *buf, size_t count)
 	if (unlikely(!tcp || !buf))
 		return 0;
 
+	// serve buffered readahead data first
+	if (tcp->readahead_fill > tcp->readahead_pos) {
+		size_t avail = tcp->readahead_fill - tcp->readahead_pos;
+
+		if (avail > count)
+			avail = count;
+		memcpy(buf, tcp->readahead_buf + tcp->readahead_pos, avail);
+		tcp->readahead_pos += avail;
+		return (ssize_t) avail;
+	}
+
+	// amortize small sequential reads with one large read into the readahead buffer
+	if (count < tcp->readahead_size) {
+		size_t fill_size = _pacing_chunk(tcp, tcp->readahead_size);
+
+		if (!tcp->readahead_buf)
+			tcp->readahead_buf = xmalloc(tcp->readahead_size);
+
+		if (tcp->ssl_session) {
+			rc = wget_ssl_read_timeout(tcp->ssl_session, tcp->readahead_buf, fill_size, tcp->timeout);
+		} else {
+			if (tcp->timeout) {
+				if ((rc = wget_ready_2_read(tcp->sockfd, tcp->timeout)) <= 0)
+					return rc;
+			}
+
+			rc = recvfrom(tcp->sockfd, tcp->readahead_buf, fill_size, 0, NULL, NULL);
+		}
+
+		if (rc > 0) {
+			_pace_transfer(tcp, rc);
+			tcp->readahead_fill = (size_t) rc;
+			if ((size_t) rc > count)
+				rc = (ssize_t) count;
+			memcpy(buf, tcp->readahead_buf, rc);
+			tcp->readahead_pos = (size_t) rc;
+		}
+
+		if (rc < 0)
+			error_printf(_("Failed to read %zu bytes (%d)\n"), count, errno);
+
+		return rc;
+	}
+
+	count = _pacing_chunk(tcp, count);
+
 	if (tcp->ssl_session) {
 		rc = wget_ssl_read_timeout(tcp->ssl_session, buf, count, tcp->timeout);
 	} else {
@@ -1241,12 +2302,217 @@ ssize_t wget_tcp_read(wget_tcp_t *tcp, char *buf, size_t count)
 		rc = recvfrom(tcp->sockfd, buf, count, 0, NULL, NULL);
 	}
 
-	if (rc < 0)
+	if (rc > 0)
+		_pace_transfer(tcp, rc);
+	else if (rc < 0)
 		error_printf(_("Failed to read %zu bytes (%d)\n"), count, errno);
 
 	return rc;
 }
 
+/**
+ * \param[in] tcp An active TCP connection.
+ * \param[in] out_fd An open file descriptor to write the payload to.
+ * \param[in] count Number of bytes to move from \p tcp to \p out_fd.
+ * \return The number of bytes moved, 0 on EOF/timeout before any data, or -1 on error
+ *   or if zero-copy transfer isn't possible.
+ *
+ * Move up to \p count bytes from the TCP connection represented by \p tcp directly
+ * into \p out_fd without copying the payload through userspace (Linux splice()).
+ *
+ * This only works for plain connections - TLS payload has to pass through the
+ * SSL layer and is rejected here. On platforms without splice() this function
+ * always returns -1 and the caller is expected to fall back to wget_tcp_read().
+ *
+ * A return value smaller than \p count (including -1 with `errno` set) means the
+ * caller should continue with the conventional read path for the remaining bytes -
+ * no payload is lost in that case.
+ *
+ * The `tcp->timeout` parameter is honored the same way as in wget_tcp_read().
+ */
+ssize_t wget_tcp_splice_to_fd(wget_tcp_t *tcp, int out_fd, size_t count)
+{
+#ifdef SPLICE_F_MOVE
+	int pipefd[2];
+	ssize_t total = 0;
+
+	if (unlikely(!tcp || out_fd < 0))
+		return -1;
+
+	if (tcp->ssl_session)
+		return -1; // encrypted payload must go through the SSL layer
+
+	// splice() refuses descriptors opened with O_APPEND
+	if (fcntl(out_fd, F_GETFL) & O_APPEND)
+		return -1;
+
+	// flush payload that already sits in the readahead buffer
+	if (tcp->readahead_fill > tcp->readahead_pos) {
+		size_t avail = tcp->readahead_fill - tcp->readahead_pos;
+
+		if (avail > count)
+			avail = count;
+		if (write(out_fd, tcp->readahead_buf + tcp->readahead_pos, avail) != (ssize_t) avail)
+			return -1;
+		tcp->readahead_pos += avail;
+		total += avail;
+	}
+
+	if (pipe(pipefd) == -1)
+		return total ? total : -1;
+
+	while ((size_t) total < count) {
+		ssize_t nread;
+
+		if (tcp->timeout) {
+			ssize_t rc;
+
+			if ((rc = wget_ready_2_read(tcp->sockfd, tcp->timeout)) <= 0) {
+				if (total == 0)
+					total = rc;
+				break;
+			}
+		}
+
+		nread = splice(tcp->sockfd, NULL, pipefd[1], NULL, _pacing_chunk(tcp, count - total), SPLICE_F_MOVE);
+
+		if (nread == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				continue;
+			if (total == 0)
+				total = -1;
+			break;
+		}
+		if (nread == 0)
+			break; // peer closed the connection
+
+		_pace_transfer(tcp, nread);
+
+		// drain the pipe into the sink
+		while (nread > 0) {
+			ssize_t nwritten = splice(pipefd[0], NULL, out_fd, NULL, nread, SPLICE_F_MOVE);
+
+			if (nwritten == -1) {
+				// don't lose what we already pulled off the socket,
+				// e.g. when the target filesystem doesn't support splice()
+				char drainbuf[4096];
+
+				while (nread > 0 && (nwritten = read(pipefd[0], drainbuf, sizeof(drainbuf))) > 0) {
+					if (write(out_fd, drainbuf, nwritten) != nwritten) {
+						nwritten = -1;
+						break;
+					}
+					nread -= nwritten;
+					total += nwritten;
+				}
+				if (nwritten == -1 && total == 0)
+					total = -1;
+				goto out;
+			}
+
+			nread -= nwritten;
+			total += nwritten;
+		}
+	}
+
+out:
+	close(pipefd[0]);
+	close(pipefd[1]);
+
+	return total;
+#else
+	(void) tcp; (void) out_fd; (void) count;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/**
+ * \param[in] tcp An active TCP connection.
+ * \param[in] in_fd An open file descriptor to read the payload from.
+ * \param[in] count Number of bytes to move from \p in_fd into \p tcp.
+ * \return The number of bytes moved, or -1 on error or if zero-copy transfer isn't possible.
+ *
+ * Move up to \p count bytes from \p in_fd directly into the TCP connection
+ * represented by \p tcp without copying the payload through userspace
+ * (Linux splice()) - the sending counterpart of wget_tcp_splice_to_fd().
+ *
+ * This only works for plain connections - TLS payload has to pass through the
+ * SSL layer and is rejected here. On platforms without splice() this function
+ * always returns -1 and the caller is expected to fall back to read()/wget_tcp_write().
+ *
+ * A short transfer (including -1) leaves the file offset of \p in_fd right
+ * behind the consumed bytes, so the caller can continue with the conventional
+ * write path for the rest - no payload is lost or sent twice.
+ *
+ * The `tcp->timeout` parameter is honored the same way as in wget_tcp_write().
+ */
+ssize_t wget_tcp_splice_from_fd(wget_tcp_t *tcp, int in_fd, size_t count)
+{
+#ifdef SPLICE_F_MOVE
+	int pipefd[2];
+	ssize_t total = 0;
+
+	if (unlikely(!tcp || in_fd < 0))
+		return -1;
+
+	if (tcp->ssl_session)
+		return -1; // payload must go through the SSL layer
+
+	if (pipe(pipefd) == -1)
+		return -1;
+
+	while ((size_t) total < count) {
+		// pull the next chunk of the file into the pipe
+		ssize_t nread = splice(in_fd, NULL, pipefd[1], NULL, _pacing_chunk(tcp, count - total), SPLICE_F_MOVE);
+
+		if (nread == -1) {
+			if (total == 0)
+				total = -1;
+			break;
+		}
+		if (nread == 0)
+			break; // premature EOF, e.g. the file was truncated meanwhile
+
+		// push the pipe contents into the socket
+		while (nread > 0) {
+			ssize_t nwritten = -1;
+
+			if (!tcp->timeout || wget_ready_2_transfer(tcp->sockfd, tcp->timeout, WGET_IO_WRITABLE) > 0)
+				nwritten = splice(pipefd[0], NULL, tcp->sockfd, NULL, nread, SPLICE_F_MOVE);
+			else
+				errno = ETIMEDOUT;
+
+			if (nwritten == -1) {
+				if (errno == EAGAIN || errno == EWOULDBLOCK)
+					continue;
+				// the pipe still holds bytes the file offset already passed -
+				// rewind so the caller's fallback path resends them
+				if (lseek(in_fd, -nread, SEEK_CUR) == -1 && total == 0)
+					total = -1;
+				goto out;
+			}
+
+			_pace_transfer(tcp, nwritten);
+			nread -= nwritten;
+			total += nwritten;
+		}
+	}
+
+out:
+	close(pipefd[0]);
+	close(pipefd[1]);
+
+	return total;
+#else
+	(void) tcp; (void) in_fd; (void) count;
+
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
 /**
  * \param[in] tcp An active TCP connection.
  * \param[in] buf A buffer, at least \p count bytes long.
@@ -1281,8 +2547,12 @@ ssize_t wget_tcp_write(wget_tcp_t *tcp, const char *buf, size_t count)
 	if (unlikely(!tcp || !buf))
 		return -1;
 
-	if (tcp->ssl_session)
-		return wget_ssl_write_timeout(tcp->ssl_session, buf, count, tcp->timeout);
+	if (tcp->ssl_session) {
+		n = wget_ssl_write_timeout(tcp->ssl_session, buf, count, tcp->timeout);
+		if (n > 0)
+			_pace_transfer(tcp, n);
+		return n;
+	}
 
 	while (count) {
 #ifdef TCP_FASTOPEN_LINUX
@@ -1291,8 +2561,12 @@ ssize_t wget_tcp_write(wget_tcp_t *tcp, const char *buf, size_t count)
 				tcp->connect_addrinfo->ai_addr, tcp->connect_addrinfo->ai_addrlen);
 			tcp->first_send = 0;
 
+			if (n >= 0)
+				_tfo_count(&_tfo_sends); // request rode the SYN (given the kernel had a TFO cookie)
+
 			if (n < 0 && errno == EOPNOTSUPP) {
 				/* fallback from fastopen, e.g. when fastopen is disabled in system */
+				_tfo_count(&_tfo_fallbacks);
 				tcp->tcp_fastopen = 0;
 
 				rc = connect(tcp->sockfd, tcp->connect_addrinfo->ai_addr, tcp->connect_addrinfo->ai_addrlen);
@@ -1308,9 +2582,10 @@ ssize_t wget_tcp_write(wget_tcp_t *tcp, const char *buf, size_t count)
 			}
 		} else
 #endif
-			n = send(tcp->sockfd, buf, count, 0);
+			n = send(tcp->sockfd, buf, _pacing_chunk(tcp, count), 0);
 
 		if (n >= 0) {
+			_pace_transfer(tcp, n);
 			nwritten += n;
 
 			if ((size_t)n >= count)
@@ -1337,6 +2612,84 @@ ssize_t wget_tcp_write(wget_tcp_t *tcp, const char *buf, size_t count)
 	return 0;
 }
 
+/**
+ * \param[in] tcp An active TCP connection.
+ * \param[in] iov Array of data fragments to write.
+ * \param[in] iovcnt Number of fragments in \p iov.
+ * \return The total number of bytes written, or -1 on error.
+ *
+ * Scatter-gather variant of wget_tcp_write(): write all fragments in order
+ * with as few syscalls as possible (`writev(2)` where available), without
+ * the caller having to assemble them into one contiguous buffer first.
+ *
+ * TLS connections, TCP Fast Open first sends and platforms without
+ * `writev()` fall back to writing the fragments one by one.
+ */
+ssize_t wget_tcp_writev(wget_tcp_t *tcp, const wget_iovec_t *iov, int iovcnt)
+{
+	ssize_t nwritten = 0;
+
+	if (unlikely(!tcp || !iov || iovcnt < 0))
+		return -1;
+
+#ifdef HAVE_WRITEV
+	if (!tcp->ssl_session && !(tcp->tcp_fastopen && tcp->first_send)) {
+		struct iovec vec[iovcnt ? iovcnt : 1];
+		int idx = 0, rc;
+
+		for (int it = 0; it < iovcnt; it++) {
+			vec[it].iov_base = (void *) iov[it].data;
+			vec[it].iov_len = iov[it].length;
+		}
+
+		while (idx < iovcnt) {
+			ssize_t n = writev(tcp->sockfd, vec + idx, iovcnt - idx);
+
+			if (n >= 0) {
+				_pace_transfer(tcp, n);
+				nwritten += n;
+
+				// skip completely written fragments, adjust a partial one
+				while (idx < iovcnt && (size_t) n >= vec[idx].iov_len)
+					n -= (ssize_t) vec[idx++].iov_len;
+
+				if (idx < iovcnt) {
+					vec[idx].iov_base = (char *) vec[idx].iov_base + n;
+					vec[idx].iov_len -= n;
+				}
+			} else {
+				if (errno != EAGAIN
+					&& errno != ENOTCONN
+					&& errno != EINPROGRESS
+				) {
+					error_printf(_("Failed to write %d fragments (%d: %s)\n"), iovcnt - idx, errno, strerror(errno));
+					return -1;
+				}
+
+				if (tcp->timeout) {
+					if ((rc = wget_ready_2_write(tcp->sockfd, tcp->timeout)) <= 0)
+						return rc;
+				}
+			}
+		}
+
+		return nwritten;
+	}
+#endif
+
+	// TLS framing resp. MSG_FASTOPEN handling live in wget_tcp_write()
+	for (int it = 0; it < iovcnt; it++) {
+		ssize_t n = wget_tcp_write(tcp, iov[it].data, iov[it].length);
+
+		if (n != (ssize_t) iov[it].length)
+			return n < 0 ? n : -1;
+
+		nwritten += n;
+	}
+
+	return nwritten;
+}
+
 /**
  * \param[in] tcp An active TCP connection.
  * \param[in] fmt Format string (like in `printf(3)`).
@@ -1404,6 +2757,7 @@ void wget_tcp_close(wget_tcp_t *tcp)
 			freeaddrinfo(tcp->addrinfo);
 		}
 		tcp->addrinfo = NULL;
+		tcp->readahead_fill = tcp->readahead_pos = 0; // keep the buffer for re-use
 	}
 }
 
@@ -42,7 +42,18 @@ struct wget_tcp_st {
 		connect_addrinfo; // needed for TCP_FASTOPEN delayed connect
 	const char
 		*ssl_hostname, // if set, do SSL hostname checking
+		*socks5_host, // if set, tunnel through this SOCKS5 proxy
+		*socks5_dest_host, // origin behind the SOCKS5 proxy, only valid while connecting
 		*ip;
+	char *
+		readahead_buf; // filled with large reads, drained by wget_tcp_read()
+	size_t
+		readahead_size, // allocation size of readahead_buf, 0 disables readahead
+		readahead_fill, // number of valid bytes in readahead_buf
+		readahead_pos, // offset of the next unread byte in readahead_buf
+		pacing_rate; // transfer rate limit in bytes/s, 0 = unlimited
+	long long
+		pacing_ts; // earliest timestamp (ms) for the next paced transfer
 	int
 		sockfd,
 		// timeouts in milliseconds
@@ -53,8 +64,17 @@ struct wget_tcp_st {
 		family,
 		preferred_family,
 		protocol; // WGET_PROTOCOL_HTTP1_1, WGET_PROTOCOL_HTTP2_0
+	uint16_t
+		socks5_port, // port of the SOCKS5 proxy
+		socks5_dest_port; // port of the origin behind the SOCKS5 proxy
 	wget_hpkp_stats_t
 		hpkp; // hpkp stats
+	wget_caps_db_t *
+		caps_db; // if set, consulted for BDP-sized socket buffers and fed with connect RTTs
+	int
+		sockbuf_size; // SO_RCVBUF/SO_SNDBUF for the next connect, 0 = kernel default
+	long long
+		connect_millisecs; // duration of the last TCP connect, for stats
 
 	bool
 		ssl : 1,
@@ -62,6 +82,7 @@ struct wget_tcp_st {
 		addrinfo_allocated : 1,
 		bind_addrinfo_allocated : 1,
 		tls_false_start : 1,
+		tls_early_data : 1, // send the first request as TLS 1.3 0-RTT early data
 		tcp_fastopen : 1, // do we use TCP_FASTOPEN or not
 		first_send : 1; // TCP_FASTOPEN's first packet is sent different
 };
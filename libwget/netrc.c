@@ -39,6 +39,10 @@
 struct _wget_netrc_db_st {
 	wget_hashmap_t *
 		machines;
+	const char *
+		fname; // file to parse on first lookup, see wget_netrc_db_lazy_load()
+	bool
+		loaded;
 };
 
 #ifdef __clang__
@@ -103,6 +107,19 @@ wget_netrc_t *wget_netrc_get(const wget_netrc_db_t *netrc_db, const char *host)
 	if (netrc_db) {
 		wget_netrc_t netrc;
 
+		if (netrc_db->fname && !netrc_db->loaded) {
+			// deferred parse: never triggered by crawls that don't authenticate
+			static wget_thread_mutex_t mutex = WGET_THREAD_MUTEX_INITIALIZER;
+			wget_netrc_db_t *db = (wget_netrc_db_t *) netrc_db; // filling the db doesn't break the promise to the caller
+
+			wget_thread_mutex_lock(&mutex);
+			if (!db->loaded) {
+				wget_netrc_db_load(db, db->fname);
+				db->loaded = 1;
+			}
+			wget_thread_mutex_unlock(&mutex);
+		}
+
 		// look for an exact match
 		netrc.host = host;
 		return wget_hashmap_get(netrc_db->machines, &netrc);
@@ -111,6 +128,20 @@ wget_netrc_t *wget_netrc_get(const wget_netrc_db_t *netrc_db, const char *host)
 	return NULL;
 }
 
+// Remember <fname> to be parsed on the first wget_netrc_get(), instead of
+// paying for a full parse up front. Lookups are hash-indexed by host, so
+// even a .netrc with thousands of machine entries costs one probe per
+// authentication after the initial parse.
+void wget_netrc_db_lazy_load(wget_netrc_db_t *netrc_db, const char *fname)
+{
+	if (!netrc_db)
+		return;
+
+	xfree(netrc_db->fname);
+	netrc_db->fname = wget_strdup(fname);
+	netrc_db->loaded = 0;
+}
+
 wget_netrc_db_t *wget_netrc_db_init(wget_netrc_db_t *netrc_db)
 {
 	if (!netrc_db)
@@ -129,6 +160,7 @@ void wget_netrc_db_deinit(wget_netrc_db_t *netrc_db)
 {
 	if (netrc_db) {
 		wget_hashmap_free(&netrc_db->machines);
+		xfree(netrc_db->fname);
 	}
 }
 
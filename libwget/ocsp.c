@@ -57,6 +57,8 @@ typedef struct {
 		hosts;
 	wget_thread_mutex_t
 		mutex;
+	bool
+		changed : 1; // whether or not the db has been changed / needs saving
 } _ocsp_db_impl_t;
 
 typedef struct {
@@ -265,8 +267,10 @@ static void _ocsp_db_add_fingerprint_entry(_ocsp_db_impl_t *ocsp_db_priv, _ocsp_
 	wget_thread_mutex_lock(&ocsp_db_priv->mutex);
 
 	if (ocsp->maxage == 0) {
-		if (wget_hashmap_remove(ocsp_db_priv->fingerprints, ocsp))
+		if (wget_hashmap_remove(ocsp_db_priv->fingerprints, ocsp)) {
+			ocsp_db_priv->changed = 1;
 			debug_printf("removed OCSP cert %s\n", ocsp->key);
+		}
 		_free_ocsp(ocsp);
 	} else {
 		_ocsp_t *old = wget_hashmap_get(ocsp_db_priv->fingerprints, ocsp);
@@ -276,6 +280,7 @@ static void _ocsp_db_add_fingerprint_entry(_ocsp_db_impl_t *ocsp_db_priv, _ocsp_
 				old->mtime = ocsp->mtime;
 				old->maxage = ocsp->maxage;
 				old->valid = ocsp->valid;
+				ocsp_db_priv->changed = 1;
 				debug_printf("update OCSP cert %s (maxage=%lld,valid=%d)\n", old->key, (long long)old->maxage, old->valid);
 			}
 			_free_ocsp(ocsp);
@@ -283,6 +288,7 @@ static void _ocsp_db_add_fingerprint_entry(_ocsp_db_impl_t *ocsp_db_priv, _ocsp_
 			// key and value are the same to make wget_hashmap_get() return old 'ocsp'
 			debug_printf("add OCSP cert %s (maxage=%lld,valid=%d)\n", ocsp->key, (long long)ocsp->maxage, ocsp->valid);
 			wget_hashmap_put_noalloc(ocsp_db_priv->fingerprints, ocsp, ocsp);
+			ocsp_db_priv->changed = 1;
 			// no need to free anything here
 		}
 	}
@@ -332,8 +338,10 @@ static void _ocsp_db_add_host_entry(_ocsp_db_impl_t *ocsp_db_priv, _ocsp_t *ocsp
 	wget_thread_mutex_lock(&ocsp_db_priv->mutex);
 
 	if (ocsp->maxage == 0) {
-		if (wget_hashmap_remove(ocsp_db_priv->hosts, ocsp))
+		if (wget_hashmap_remove(ocsp_db_priv->hosts, ocsp)) {
+			ocsp_db_priv->changed = 1;
 			debug_printf("removed OCSP host %s\n", ocsp->key);
+		}
 		_free_ocsp(ocsp);
 	} else {
 		_ocsp_t *old = wget_hashmap_get(ocsp_db_priv->hosts, ocsp);
@@ -343,12 +351,14 @@ static void _ocsp_db_add_host_entry(_ocsp_db_impl_t *ocsp_db_priv, _ocsp_t *ocsp
 				old->mtime = ocsp->mtime;
 				old->maxage = ocsp->maxage;
 				old->valid = ocsp->valid;
+				ocsp_db_priv->changed = 1;
 				debug_printf("update OCSP host %s (maxage=%lld)\n", old->key, (long long)old->maxage);
 			}
 			_free_ocsp(ocsp);
 		} else {
 			// key and value are the same to make wget_hashmap_get() return old 'ocsp'
 			wget_hashmap_put_noalloc(ocsp_db_priv->hosts, ocsp, ocsp);
+			ocsp_db_priv->changed = 1;
 			debug_printf("add OCSP host %s (maxage=%lld)\n", ocsp->key, (long long)ocsp->maxage);
 			// no need to free anything here
 		}
@@ -611,9 +621,39 @@ static int impl_ocsp_db_save(wget_ocsp_db_t *ocsp_db)
 	} else
 		debug_printf(_("Saved OCSP fingerprints to '%s'\n"), ocsp_db_priv->fname);
 
+	if (ret == 0)
+		ocsp_db_priv->changed = 0;
+
 	return ret;
 }
 
+/**
+ * \param[in] ocsp_db An OCSP database
+ * \return 1 if the database has unsaved changes, 0 if not
+ *
+ * Tells whether entries have been added, updated or removed since the database
+ * was loaded or last saved. Implementations that do not track changes report 1,
+ * so callers saving only dirty databases stay on the safe side.
+ *
+ * If `ocsp_db` is NULL then this function returns 0.
+ */
+int wget_ocsp_db_changed(wget_ocsp_db_t *ocsp_db)
+{
+	if (!ocsp_db)
+		return 0;
+
+	if (ocsp_db->vtable->changed)
+		return ocsp_db->vtable->changed(ocsp_db);
+
+	return 1;
+}
+static int impl_ocsp_db_changed(wget_ocsp_db_t *ocsp_db)
+{
+	_ocsp_db_impl_t *ocsp_db_priv = (_ocsp_db_impl_t *) ocsp_db;
+
+	return ocsp_db_priv->changed;
+}
+
 static struct wget_ocsp_db_vtable vtable = {
 	.load = impl_ocsp_db_load,
 	.save = impl_ocsp_db_save,
@@ -621,7 +661,8 @@ static struct wget_ocsp_db_vtable vtable = {
 	.hostname_is_valid = impl_ocsp_db_hostname_is_valid,
 	.add_fingerprint = impl_ocsp_db_add_fingerprint,
 	.add_host = impl_ocsp_db_add_host,
-	.free = impl_ocsp_db_free
+	.free = impl_ocsp_db_free,
+	.changed = impl_ocsp_db_changed
 };
 
 /**
@@ -653,7 +694,7 @@ wget_ocsp_db_t *wget_ocsp_db_init(wget_ocsp_db_t *ocsp_db, const char *fname)
 	wget_hashmap_set_key_destructor(ocsp_db_priv->hosts, (wget_hashmap_key_destructor_t)_free_ocsp);
 	wget_hashmap_set_value_destructor(ocsp_db_priv->hosts, (wget_hashmap_value_destructor_t)_free_ocsp);
 
-	wget_thread_mutex_init(&ocsp_db_priv->mutex);
+	wget_thread_mutex_init_adaptive(&ocsp_db_priv->mutex);
 
 	return (wget_ocsp_db_t *) ocsp_db_priv;
 }
@@ -309,4 +309,22 @@ void wget_plugin_add_ocsp_db(wget_plugin_t *plugin, wget_ocsp_db_t *ocsp_db, int
 	plugin->vtable->add_ocsp_db(plugin, ocsp_db, priority);
 }
 
+/**
+ * Takes a read-only snapshot of the scheduler state.
+ *
+ * Lets a plugin base admission decisions (e.g. in a URL filter) on the actual
+ * load instead of guessing from callback timing. The snapshot is taken without
+ * stopping the scheduler, so the values may be a few operations apart from
+ * each other. The function is thread-safe and cheap enough to be called per
+ * URL.
+ *
+ * \param[in] plugin The plugin handle
+ * \param[in] host A host name to fill \p host_pending for, or NULL
+ * \param[out] info Filled with the current scheduler state
+ */
+void wget_plugin_get_scheduler_info(wget_plugin_t *plugin, const char *host, wget_scheduler_info_t *info)
+{
+	plugin->vtable->get_scheduler_info(plugin, host, info);
+}
+
 /** @} */
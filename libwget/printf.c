@@ -47,21 +47,31 @@
  *
  * Prints arguments to allocated memory and 0-terminates it. The string is returned via the first argument.
  * It has to be free()'d by the caller when it is no longer needed.
+ *
+ * Formatting happens on the stack - the single allocation is the exactly
+ * sized result. Only results longer than the stack buffer spill to the heap
+ * while being formatted.
  */
 size_t wget_vasprintf(char **strp, const char *fmt, va_list args)
 {
 	wget_buffer_t buf;
+	char sbuf[1024];
 
-	wget_buffer_init(&buf, NULL, 128);
+	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
 
 	size_t len = wget_buffer_vprintf(&buf, fmt, args);
 
 	if (strp) {
-		// shrink memory to real usage
-		*strp = xrealloc(buf.data, len + 1);
+		if (buf.data == sbuf) {
+			// common case: copy out of the stack buffer, exactly sized
+			*strp = wget_strmemdup(buf.data, len);
+		} else {
+			// spilled to the heap while formatting - shrink to real usage
+			*strp = xrealloc(buf.data, len + 1);
+		}
 	} else {
 		// behave like C99/POSIX snprintf - just return the length
-		xfree(buf.data);
+		wget_buffer_deinit(&buf);
 	}
 
 	return len;
@@ -44,8 +44,10 @@
 #	define _(STRING) STRING
 #endif
 
-// I try to never leave freed pointers hanging around
-# define xfree(a) do { if (a) { free((void *)(a)); a=NULL; } } while (0)
+// I try to never leave freed pointers hanging around.
+// Free via wget_free() so arena memory and the allocation accounting
+// (both xalloc.c) see every free.
+# define xfree(a) do { if (a) { wget_free((void *)(a)); a=NULL; } } while (0)
 
 // number of elements within an array
 # define countof(a) (sizeof(a)/sizeof(*(a)))
@@ -67,5 +69,82 @@
 # define debug_printf wget_debug_printf
 # define debug_write wget_debug_write
 
+// CPU feature dispatch for vectorized kernels (cpu.c).
+// Each kernel exports a scalar fallback, optionally a vectorized variant,
+// and a function pointer that callers go through. cpu.c owns the table of
+// kernels and repoints the slots once, at wget_global_init() or whenever
+// wget_cpu_set_simd() is called.
+typedef void (*cpu_kernel_fn)(void);
+void cpu_resolve_kernels(void);
+
+// header scanning (http_parse.c)
+typedef const char *(*http_scan_byte_fn)(const char *, char);
+extern http_scan_byte_fn http_scan_byte;
+const char *http_scan_byte_scalar(const char *s, char c);
+#ifdef __SSE2__
+const char *http_scan_byte_sse2(const char *s, char c);
+#endif
+
+// SSSE3 variants are compiled with a function-level target attribute,
+// so they build regardless of the global -m flags (x86 + GCC/clang only)
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#	define WITH_SSSE3_KERNELS 1
+#endif
+
+// Some kernels read a few bytes past the end of a string. That is safe
+// as long as the load stays on the same page, but looks like a buffer
+// overflow to ASan - keep those kernels out of sanitized builds (e.g.
+// the fuzzers), they fall back to the scalar variants there.
+#if defined(__SANITIZE_ADDRESS__)
+#	define WITH_OVERREAD_KERNELS 0
+#elif defined(__has_feature)
+#	if __has_feature(address_sanitizer)
+#		define WITH_OVERREAD_KERNELS 0
+#	else
+#		define WITH_OVERREAD_KERNELS 1
+#	endif
+#else
+#	define WITH_OVERREAD_KERNELS 1
+#endif
+
+// base64 bulk transcoding (base64.c): converts whole groups only and
+// returns the number of input bytes consumed, the caller's scalar loop
+// finishes the rest
+typedef size_t (*base64_bulk_fn)(char *, const unsigned char *, size_t);
+extern base64_bulk_fn base64_encode_bulk, base64_decode_bulk;
+size_t base64_encode_bulk_scalar(char *dst, const unsigned char *src, size_t n);
+size_t base64_decode_bulk_scalar(char *dst, const unsigned char *src, size_t n);
+#ifdef WITH_SSSE3_KERNELS
+size_t base64_encode_bulk_ssse3(char *dst, const unsigned char *src, size_t n);
+size_t base64_decode_bulk_ssse3(char *dst, const unsigned char *src, size_t n);
+#endif
+
+// hex conversion (utils.c), converts all n bytes
+typedef size_t (*memtohex_bulk_fn)(char *, const unsigned char *, size_t);
+extern memtohex_bulk_fn memtohex_bulk;
+size_t memtohex_bulk_scalar(char *dst, const unsigned char *src, size_t n);
+#ifdef WITH_SSSE3_KERNELS
+size_t memtohex_bulk_ssse3(char *dst, const unsigned char *src, size_t n);
+#endif
+
+// ASCII case-insensitive comparison (utils.c)
+typedef int (*ascii_strcasecmp_fn)(const char *, const char *);
+typedef int (*ascii_strncasecmp_fn)(const char *, const char *, size_t);
+extern ascii_strcasecmp_fn ascii_strcasecmp;
+extern ascii_strncasecmp_fn ascii_strncasecmp;
+int ascii_strcasecmp_scalar(const char *s1, const char *s2);
+int ascii_strncasecmp_scalar(const char *s1, const char *s2, size_t n);
+#if defined(__SSE2__) && WITH_OVERREAD_KERNELS
+int ascii_strcasecmp_sse2(const char *s1, const char *s2);
+int ascii_strncasecmp_sse2(const char *s1, const char *s2, size_t n);
+#endif
+
+// leading pure-ASCII run of a length-bounded buffer (encoding.c)
+typedef size_t (*ascii_span_fn)(const unsigned char *, size_t);
+extern ascii_span_fn ascii_span;
+size_t ascii_span_scalar(const unsigned char *s, size_t n);
+#ifdef __SSE2__
+size_t ascii_span_sse2(const unsigned char *s, size_t n);
+#endif
 
 #endif /* _LIBWGET_PRIVATE_H */
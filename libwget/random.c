@@ -18,7 +18,7 @@
  * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
  *
  *
- * a multi-thread safe wrapper around gnulib random_r()
+ * a multi-thread safe pseudo random number generator
  *
  * Changelog
  * 22.01.2016  Tim Ruehsen  created
@@ -28,6 +28,7 @@
 #include <config.h>
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
@@ -44,53 +45,113 @@
  * \defgroup libwget-random Random functions
  * @{
  *
- * This is wrapper code around gnulib's srandom_r() and random_r() with automatic seeding
+ * Pseudo random numbers from a per-thread xoshiro128** generator with automatic seeding.
+ * Not suitable for cryptographic purposes.
  */
 
+// xoshiro128** by Blackman & Vigna (public domain), one generator per
+// thread: no lock and no syscall on the hot path (unique-filename and
+// boundary-string generation call this from every downloader thread)
+#if defined __GNUC__ || defined __clang__
+# define RANDOM_TLS __thread
+#else
+# define RANDOM_TLS // single shared state, serialized by the mutex below
 static wget_thread_mutex_t mutex = WGET_THREAD_MUTEX_INITIALIZER;
-static int seeded;
-static char statebuf[64];
-static struct random_data state;
+#endif
+
+static unsigned int
+	base_seed; // set by wget_srandom()
+static volatile int
+	seed_generation; // bumped on re-seeding, threads pick it up lazily
+
+static RANDOM_TLS uint32_t
+	xs[4]; // xoshiro128** state
+static RANDOM_TLS int
+	generation = -1; // the seed_generation this thread's state was derived from
+
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+static uint32_t _splitmix32(uint32_t *x)
+{
+	uint32_t z = (*x += 0x9e3779b9);
+
+	z = (z ^ (z >> 16)) * 0x85ebca6b;
+	z = (z ^ (z >> 13)) * 0xc2b2ae35;
+	return z ^ (z >> 16);
+}
+
+static uint32_t G_GNUC_WGET_CONST _rotl32(uint32_t x, int k)
+{
+	return (x << k) | (x >> (32 - k));
+}
+
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+static uint32_t _xoshiro128_next(void)
+{
+	const uint32_t result = _rotl32(xs[1] * 5, 7) * 9;
+	const uint32_t t = xs[1] << 9;
+
+	xs[2] ^= xs[0];
+	xs[3] ^= xs[1];
+	xs[1] ^= xs[2];
+	xs[0] ^= xs[3];
+	xs[2] ^= t;
+	xs[3] = _rotl32(xs[3], 11);
+
+	return result;
+}
 
 /**
  * \return Random value between 0 and RAND_MAX
  *
- * This functions wraps around gnulib's random_r(). It performs a thread-safe seeding on the first use,
- * if not done before by wget_srandom();
+ * Returns the next value of a per-thread xoshiro128** generator. The generator
+ * is seeded on its thread's first use, from wget_srandom() if that was called,
+ * else from time, pid and the thread's identity.
  */
 int wget_random(void)
 {
-	int32_t r;
+	uint32_t r;
 
+#if !defined __GNUC__ && !defined __clang__
 	wget_thread_mutex_lock(&mutex);
+#endif
+
+	if (generation != seed_generation) {
+		// an explicit seed gives every thread the same (reproducible)
+		// stream; automatic seeding mixes in the thread's identity
+		uint32_t x = seed_generation ? base_seed
+			: (uint32_t)((unsigned) time(NULL) ^ (unsigned) getpid()) ^ (uint32_t)(uintptr_t) &generation;
 
-	if (!seeded) {
-		// seed random generator, used e.g. by Digest Authentication and --random-wait
-		initstate_r((unsigned)(time(NULL) ^ getpid()), statebuf, sizeof(statebuf), &state);
-		seeded = 1;
+		do
+			for (int it = 0; it < 4; it++)
+				xs[it] = _splitmix32(&x);
+		while (!(xs[0] | xs[1] | xs[2] | xs[3])); // the all-zero state is invalid
+
+		generation = seed_generation;
 	}
 
-	if (random_r(&state, &r))
-		r = 0; // return 0 on failure
+	r = _xoshiro128_next() % ((uint32_t) RAND_MAX + 1);
 
+#if !defined __GNUC__ && !defined __clang__
 	wget_thread_mutex_unlock(&mutex);
+#endif
 
-	return (int)r;
+	return (int) r;
 }
 
 /**
  * \param[in] seed Value to seed the random generator
  *
- * This functions wraps around srandom_r() to make a thread-safe seeding for wget_random().
+ * Seeds the random generator. Threads re-derive their generator state from the
+ * new seed on their next wget_random() call.
  */
 void wget_srandom(unsigned int seed)
 {
-	wget_thread_mutex_lock(&mutex);
-
-	initstate_r(seed, statebuf, sizeof(statebuf), &state);
-	seeded = 1;
-
-	wget_thread_mutex_unlock(&mutex);
+	base_seed = seed;
+	seed_generation++;
 }
 
 /**@}*/
@@ -0,0 +1,162 @@
+/*
+ * Copyright(c) 2015-2016 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Reference counted immutable string routines
+ *
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <wget.h>
+#include "private.h"
+
+/**
+ * \file
+ * \brief Reference counted immutable strings
+ * \defgroup libwget-refstr Reference counted immutable strings
+ * @{
+ *
+ * A refstr is a 0-terminated immutable string with a hidden header
+ * (length + reference counter) in front of the character data. The public
+ * pointer is a plain `const char *` usable with any C string function, but
+ * instead of copying it around with wget_strdup(), additional owners just
+ * take another reference with wget_refstr_ref().
+ *
+ * This removes the 'strdup storm' for strings that flow through several
+ * stages with different lifetimes - one allocation is shared by all of them.
+ *
+ * The reference counter is updated atomically (with compiler support for the
+ * __atomic builtins), so references may be taken and dropped from different
+ * threads.
+ */
+
+typedef struct {
+	size_t
+		len; // number of bytes without the terminating 0
+	int
+		refcount;
+} _refstr_hdr_t;
+
+#define REFSTR_HDR(s) (((_refstr_hdr_t *) (s)) - 1)
+
+#ifndef WITH_GCC_ATOMIC
+static wget_thread_mutex_t
+	_refcount_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+ * \param[in] m Pointer to the data to copy
+ * \param[in] n Number of bytes to copy
+ * \return A 0-terminated refstr with one reference, to be released with wget_refstr_unref()
+ *
+ * Create a refstr from \p n bytes at \p m, like wget_strmemdup() does for plain strings.
+ */
+char *wget_refstr_memdup(const void *m, size_t n)
+{
+	_refstr_hdr_t *hdr = xmalloc(sizeof(_refstr_hdr_t) + n + 1);
+	char *s = (char *) (hdr + 1);
+
+	hdr->len = n;
+	hdr->refcount = 1;
+
+	memcpy(s, m, n);
+	s[n] = 0;
+
+	return s;
+}
+
+/**
+ * \param[in] s A 0-terminated string or %NULL
+ * \return A refstr copy of \p s with one reference, or %NULL if \p s is %NULL
+ *
+ * Create a refstr from the string \p s, like wget_strdup() does for plain strings.
+ */
+char *wget_refstr_dup(const char *s)
+{
+	return s ? wget_refstr_memdup(s, strlen(s)) : NULL;
+}
+
+/**
+ * \param[in] s A refstr or %NULL
+ * \return \p s
+ *
+ * Take an additional reference on \p s. Each reference must be released
+ * with wget_refstr_unref().
+ *
+ * \p s must have been created by wget_refstr_memdup() or wget_refstr_dup() -
+ * plain malloc'ed strings have no header to count references in.
+ */
+char *wget_refstr_ref(const char *s)
+{
+	if (likely(s)) {
+#ifdef WITH_GCC_ATOMIC
+		__atomic_add_fetch(&REFSTR_HDR(s)->refcount, 1, __ATOMIC_RELAXED);
+#else
+		wget_thread_mutex_lock(&_refcount_mutex);
+		REFSTR_HDR(s)->refcount++;
+		wget_thread_mutex_unlock(&_refcount_mutex);
+#endif
+	}
+
+	return (char *) s;
+}
+
+/**
+ * \param[in] strp Pointer to a refstr, gets set to %NULL
+ *
+ * Release one reference on \p *strp. The string is freed when the last
+ * reference is gone. A %NULL \p strp or \p *strp is a no-op.
+ */
+void wget_refstr_unref(const char **strp)
+{
+	_refstr_hdr_t *hdr;
+	int refcount;
+
+	if (unlikely(!strp || !*strp))
+		return;
+
+	hdr = REFSTR_HDR(*strp);
+	*strp = NULL;
+
+#ifdef WITH_GCC_ATOMIC
+	refcount = __atomic_sub_fetch(&hdr->refcount, 1, __ATOMIC_ACQ_REL);
+#else
+	wget_thread_mutex_lock(&_refcount_mutex);
+	refcount = --hdr->refcount;
+	wget_thread_mutex_unlock(&_refcount_mutex);
+#endif
+
+	if (refcount == 0)
+		xfree(hdr);
+}
+
+/**
+ * \param[in] s A refstr or %NULL
+ * \return The length of \p s in bytes, 0 if \p s is %NULL
+ *
+ * Get the length of \p s without scanning for the terminating 0.
+ */
+size_t wget_refstr_len(const char *s)
+{
+	return s ? REFSTR_HDR(s)->len : 0;
+}
+
+/** @} */
@@ -38,13 +38,35 @@
 struct _rss_context {
 	wget_vector_t
 		*urls;
+	time_t
+		since, // skip items at or before this timestamp (0 = collect everything)
+		newest; // newest item timestamp seen so far
+	char
+		done; // early exit: the remaining items are older than 'since'
 };
 
+// RSS pubDate/lastBuildDate use the RFC 822 date format, which
+// wget_http_parse_full_date() already handles.
+static time_t _rss_parse_date(const char *s, size_t len)
+{
+	char buf[48];
+
+	if (len < 20 || len >= sizeof(buf))
+		return 0;
+	memcpy(buf, s, len);
+	buf[len] = 0;
+
+	return wget_http_parse_full_date(buf);
+}
+
 static void _rss_get_url(void *context, int flags, const char *dir, const char *attr, const char *val, size_t len, size_t pos G_GNUC_WGET_UNUSED)
 {
 	struct _rss_context *ctx = context;
 	wget_string_t url;
 
+	if (ctx->done)
+		return; // everything below the cursor - just let the tokenizer run out
+
 	if (!val || !len)
 		return;
 
@@ -73,6 +95,22 @@ static void _rss_get_url(void *context, int flags, const char *dir, const char *
 		if (elem) {
 			elem++;
 
+			if (!wget_strcasecmp_ascii(elem, "pubDate") || !wget_strcasecmp_ascii(elem, "lastBuildDate")) {
+				time_t t = _rss_parse_date(val, len);
+
+				if (t > ctx->newest)
+					ctx->newest = t;
+
+				// Items are ordered newest first - once one is at or below
+				// the cursor, the rest of the feed has been seen before.
+				// This also triggers on the channel-level <lastBuildDate>
+				// when the whole feed is unchanged since the last poll.
+				if (ctx->since && t && t <= ctx->since)
+					ctx->done = 1;
+
+				return;
+			}
+
 			if (!wget_strcasecmp_ascii(elem, "guid") || !wget_strcasecmp_ascii(elem, "link")
 				 || !wget_strcasecmp_ascii(elem, "comments") || !wget_strcasecmp_ascii(elem, "docs"))
 			{
@@ -95,9 +133,20 @@ static void _rss_get_url(void *context, int flags, const char *dir, const char *
 
 void wget_rss_get_urls_inline(const char *rss, wget_vector_t **urls)
 {
-	struct _rss_context context = { .urls = NULL };
+	wget_rss_get_urls_inline_since(rss, urls, 0, NULL);
+}
+
+// Like wget_rss_get_urls_inline(), but with a timestamp cursor for polling:
+// extraction stops at the first item whose pubDate is at or below 'since'.
+// The newest timestamp seen is returned in 'newest', to be passed as 'since'
+// on the next poll of the same feed.
+void wget_rss_get_urls_inline_since(const char *rss, wget_vector_t **urls, time_t since, time_t *newest)
+{
+	struct _rss_context context = { .urls = NULL, .since = since };
 
 	wget_xml_parse_buffer(rss, _rss_get_url, &context, XML_HINT_REMOVE_EMPTY_CONTENT);
 
 	*urls = context.urls;
+	if (newest)
+		*newest = context.newest;
 }
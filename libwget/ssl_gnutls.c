@@ -67,13 +67,17 @@ typedef struct
 		*version,
 		*alpn_protocol;
 	long long
-		tls_secs; //milliseconds
+		tls_secs, //milliseconds
+		tcp_secs, //milliseconds the TCP connect took
+		hpkp_secs; //milliseconds the HPKP pin check took, -1=no pin check done
 	int
 		cert_chain_size;
 	char
 		tcp_protocol,
 		false_start,
-		tfo;
+		tfo,
+		early_data, // -1=disabled, 0=not used, 1=request deferred into TLS 1.3 0-RTT
+		hpkp_cached; // -1=no pin check done, 0=computed, 1=served from the memoized verdict
 	bool
 		tls_con,
 		resumed;
@@ -144,10 +148,15 @@ struct _session_context {
 		hostname;
 	wget_hpkp_stats_t
 		stats_hpkp;
+	long long
+		stats_hpkp_secs; // milliseconds spent checking pins, -1 if no pin check was done
+	char
+		stats_hpkp_cached; // -1=no pin check done, 0=computed, 1=served from the memoized verdict
 	unsigned char
 		ocsp_stapling : 1,
 		valid : 1,
-		delayed_session_data : 1;
+		delayed_session_data : 1,
+		early_data_pending : 1; // handshake deferred until the first write goes out as TLS 1.3 0-RTT early data
 };
 
 static gnutls_certificate_credentials_t
@@ -155,6 +164,17 @@ static gnutls_certificate_credentials_t
 static gnutls_priority_t
 	_priority_cache;
 
+// immutable per-process session settings, precomputed once by wget_ssl_init()
+// and read lock-free from wget_ssl_open() afterwards
+#if GNUTLS_VERSION_NUMBER >= 0x030200
+static gnutls_datum_t
+	_alpn_protocols[16];
+static unsigned
+	_alpn_nprot;
+#endif
+static char
+	_compat_mode; // whether to enable gnutls compatibility mode ('auto' secure protocol)
+
 void wget_ssl_set_config_string(int key, const char *value)
 {
 	switch (key) {
@@ -732,6 +752,57 @@ static int cert_verify_ocsp(gnutls_x509_crt_t cert, gnutls_x509_crt_t issuer)
 
 	return ret;
 }
+
+// Parallel handshakes to the same host usually need the very same OCSP answer,
+// but each one used to block on its own HTTP request to the responder.
+// Coalesce them: the first thread asks the responder, the others wait for the
+// answer to show up in the OCSP cache instead of duplicating the request.
+static wget_vector_t
+	*_ocsp_in_flight;
+static wget_thread_mutex_t
+	_ocsp_in_flight_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+static wget_thread_cond_t
+	_ocsp_in_flight_cond = WGET_THREAD_COND_INITIALIZER;
+
+// Returns 1 if the caller shall ask the responder itself,
+// 0 if another thread did it meanwhile (check the OCSP cache for the answer).
+static int _ocsp_acquire_request(const char *fingerprint)
+{
+	int first = 0;
+
+	wget_thread_mutex_lock(&_ocsp_in_flight_mutex);
+
+	if (!_ocsp_in_flight)
+		_ocsp_in_flight = wget_vector_create(8, -2, (wget_vector_compare_t)strcmp);
+
+	if (wget_vector_find(_ocsp_in_flight, fingerprint) < 0) {
+		wget_vector_insert_sorted(_ocsp_in_flight, fingerprint, strlen(fingerprint) + 1);
+		first = 1;
+	} else {
+		// wake-ups may get lost on platforms without broadcast, so poll the
+		// in-flight list with a timeout instead of waiting indefinitely
+		while (wget_vector_find(_ocsp_in_flight, fingerprint) >= 0)
+			wget_thread_cond_wait(&_ocsp_in_flight_cond, &_ocsp_in_flight_mutex, 250);
+	}
+
+	wget_thread_mutex_unlock(&_ocsp_in_flight_mutex);
+
+	return first;
+}
+
+static void _ocsp_release_request(const char *fingerprint)
+{
+	int pos;
+
+	wget_thread_mutex_lock(&_ocsp_in_flight_mutex);
+
+	if ((pos = wget_vector_find(_ocsp_in_flight, fingerprint)) >= 0)
+		wget_vector_remove(_ocsp_in_flight, pos);
+
+	wget_thread_mutex_unlock(&_ocsp_in_flight_mutex);
+
+	wget_thread_cond_signal(&_ocsp_in_flight_cond);
+}
 #endif // HAVE_GNUTLS_OCSP_H
 
 static int _cert_verify_hpkp(gnutls_x509_crt_t cert, const char *hostname, gnutls_session_t session)
@@ -803,6 +874,55 @@ out:
 	return ret; // Pubkey not found
 }
 
+// A pin check hashes every SPKI of the presented chain. The verdict only
+// changes when the chain or the host's pin entry changes, so remember it per
+// hostname, keyed by the chain digest and the pin database generation.
+typedef struct {
+	int64_t
+		generation;
+	wget_hpkp_stats_t
+		stats_hpkp;
+	char
+		pinning_ok;
+	char
+		chain_digest[64 * 2 + 1];
+} _hpkp_verdict_t;
+
+static wget_stringmap_t
+	*_hpkp_verdicts;
+static wget_thread_mutex_t
+	_hpkp_verdicts_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+// Identical certificate chains show up on every connection to the same host,
+// CDNs especially. Remember the verification verdict keyed by a digest of the
+// DER chain plus hostname, so repeated handshakes skip the expensive path
+// validation. Entries never outlive the earliest certificate expiry and are
+// capped at one hour, like the OCSP caches.
+static wget_stringmap_t
+	*_verified_chains;
+static wget_thread_mutex_t
+	_verified_chains_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static int _get_chain_digest(const gnutls_datum_t *cert_list, unsigned cert_list_size, const char *hostname, char *digest_hex, size_t length)
+{
+	gnutls_hash_hd_t hd;
+	unsigned char digest[32];
+
+	if (gnutls_hash_init(&hd, GNUTLS_DIG_SHA256) < 0)
+		return -1;
+
+	for (unsigned it = 0; it < cert_list_size; it++)
+		gnutls_hash(hd, cert_list[it].data, cert_list[it].size);
+
+	if (hostname)
+		gnutls_hash(hd, hostname, strlen(hostname));
+
+	gnutls_hash_deinit(hd, digest);
+	wget_memtohex(digest, sizeof(digest), digest_hex, length);
+
+	return 0;
+}
+
 /* This function will verify the peer's certificate, and check
  * if the hostname matches, as well as the activation, expiration dates.
  */
@@ -823,6 +943,54 @@ static int _verify_certificate_callback(gnutls_session_t session)
 	struct _session_context *ctx = gnutls_session_get_ptr(session);
 	hostname = ctx->hostname;
 
+	char chain_digest[64 * 2 + 1];
+	char hpkp_cached = 0;
+	time_t chain_expiry = 0;
+	int64_t hpkp_generation = -1;
+
+	*chain_digest = 0;
+
+	if ((cert_list = gnutls_certificate_get_peers(session, &cert_list_size))
+		&& _get_chain_digest(cert_list, cert_list_size, hostname, chain_digest, sizeof(chain_digest)) == 0)
+	{
+		int64_t *expiresp, now = time(NULL);
+		int hit = 0;
+
+		wget_thread_mutex_lock(&_verified_chains_mutex);
+		if (_verified_chains && (expiresp = wget_stringmap_get(_verified_chains, chain_digest)) && *expiresp > now)
+			hit = 1;
+		wget_thread_mutex_unlock(&_verified_chains_mutex);
+
+		if (hit) {
+			debug_printf("Certificate chain of '%s' already verified (cached)\n", hostname);
+			return 0;
+		}
+	}
+
+	// reuse the pin-check verdict from a previous handshake if neither the
+	// chain nor the pin database changed meanwhile
+	if (_config.hpkp_cache && hostname && *chain_digest
+		&& (hpkp_generation = wget_hpkp_db_generation(_config.hpkp_cache)) >= 0)
+	{
+		_hpkp_verdict_t *verdict;
+
+		wget_thread_mutex_lock(&_hpkp_verdicts_mutex);
+		if (_hpkp_verdicts && (verdict = wget_stringmap_get(_hpkp_verdicts, hostname))
+			&& verdict->generation == hpkp_generation && !strcmp(verdict->chain_digest, chain_digest))
+		{
+			ctx->stats_hpkp = verdict->stats_hpkp;
+			pinning_ok = verdict->pinning_ok;
+			hpkp_cached = 1;
+		}
+		wget_thread_mutex_unlock(&_hpkp_verdicts_mutex);
+
+		if (hpkp_cached) {
+			debug_printf("HPKP pins of '%s' already checked (memoized)\n", hostname);
+			ctx->stats_hpkp_cached = 1;
+			ctx->stats_hpkp_secs = 0;
+		}
+	}
+
 	/* This verification function uses the trusted CAs in the credentials
 	 * structure. So you must have installed one or more CA certificates.
 	 */
@@ -973,10 +1141,23 @@ static int _verify_certificate_callback(gnutls_session_t session)
 			continue;
 		}
 
-		if (_cert_verify_hpkp(cert, hostname, session) == 0)
-			pinning_ok = 1;
+		time_t expiry = gnutls_x509_crt_get_expiration_time(cert);
+		if (expiry != (time_t) -1 && (!chain_expiry || expiry < chain_expiry))
+			chain_expiry = expiry;
+
+		if (!hpkp_cached) {
+			long long before_millisecs = wget_get_timemillis();
 
-		_cert_verify_hpkp(cert, hostname, session);
+			if (_cert_verify_hpkp(cert, hostname, session) == 0)
+				pinning_ok = 1;
+
+			if (_config.hpkp_cache) {
+				if (ctx->stats_hpkp_secs < 0)
+					ctx->stats_hpkp_secs = 0;
+				ctx->stats_hpkp_secs += wget_get_timemillis() - before_millisecs;
+				ctx->stats_hpkp_cached = 0;
+			}
+		}
 
 #ifdef HAVE_GNUTLS_OCSP_H
 		if (_config.ocsp && it > nvalid) {
@@ -1013,6 +1194,23 @@ static int _verify_certificate_callback(gnutls_session_t session)
 				continue;
 			}
 
+			if (!_ocsp_acquire_request(fingerprint)) {
+				// another thread asked the responder for this fingerprint meanwhile
+				if (wget_ocsp_fingerprint_in_cache(_config.ocsp_cert_cache, fingerprint, &revoked)) {
+					if (revoked) {
+						debug_printf("Certificate[%u] of '%s' has been revoked (coalesced)\n", it, hostname);
+						nrevoked++;
+					} else {
+						debug_printf("Certificate[%u] of '%s' is valid (coalesced)\n", it, hostname);
+						nvalid++;
+					}
+				} else {
+					debug_printf("WARNING: OCSP response not available or ignored\n");
+					nignored++;
+				}
+				continue;
+			}
+
 			ocsp_ok = cert_verify_ocsp(cert, issuer);
 			debug_printf("check_ocsp_response() returned %d\n", ocsp_ok);
 
@@ -1028,6 +1226,8 @@ static int _verify_certificate_callback(gnutls_session_t session)
 				debug_printf("WARNING: OCSP response not available or ignored\n");
 				nignored++;
 			}
+
+			_ocsp_release_request(fingerprint);
 		}
 #endif
 	}
@@ -1053,11 +1253,41 @@ static int _verify_certificate_callback(gnutls_session_t session)
 	}
 #endif
 
+	if (!hpkp_cached && hpkp_generation >= 0) {
+		// remember the verdict - also a mismatch, no point in re-hashing an unchanged chain
+		_hpkp_verdict_t verdict = {
+			.generation = hpkp_generation,
+			.stats_hpkp = ctx->stats_hpkp,
+			.pinning_ok = (char) pinning_ok
+		};
+
+		strcpy(verdict.chain_digest, chain_digest);
+
+		wget_thread_mutex_lock(&_hpkp_verdicts_mutex);
+		if (!_hpkp_verdicts)
+			_hpkp_verdicts = wget_stringmap_create(16);
+		wget_stringmap_put(_hpkp_verdicts, hostname, &verdict, sizeof(verdict));
+		wget_thread_mutex_unlock(&_hpkp_verdicts_mutex);
+	}
+
 	if (!pinning_ok) {
 		error_printf(_("%s: Pubkey pinning mismatch!\n"), tag);
 		ret = -1;
 	}
 
+	if (ret == 0 && *chain_digest) {
+		int64_t expires = time(NULL) + 3600; // 1h valid, like the OCSP caches
+
+		if (chain_expiry && chain_expiry < expires)
+			expires = chain_expiry;
+
+		wget_thread_mutex_lock(&_verified_chains_mutex);
+		if (!_verified_chains)
+			_verified_chains = wget_stringmap_create(16);
+		wget_stringmap_put(_verified_chains, chain_digest, &expires, sizeof(expires));
+		wget_thread_mutex_unlock(&_verified_chains_mutex);
+	}
+
 	// 0: continue handshake
 	// else: stop handshake
 out:
@@ -1209,6 +1439,25 @@ void wget_ssl_init(void)
 				error_printf("GnuTLS: Unsupported default priority 'NULL': %s\n", gnutls_strerror(rc));
 		}
 
+		_compat_mode = !wget_strcasecmp_ascii(_config.secure_protocol, "auto");
+
+#if GNUTLS_VERSION_NUMBER >= 0x030200
+		if (_config.alpn) {
+			const char *e, *s;
+
+			// the ALPN protocol list never changes after init - parse it once
+			// here instead of on every connection
+			for (_alpn_nprot = 0, s = e = _config.alpn; *e && _alpn_nprot < countof(_alpn_protocols); s = e + 1) {
+				if ((e = strchrnul(s, ',')) != s) {
+					_alpn_protocols[_alpn_nprot].data = (unsigned char *) s;
+					_alpn_protocols[_alpn_nprot].size = (unsigned) (e - s);
+					debug_printf("ALPN offering %.*s\n", (int) (e - s), s);
+					_alpn_nprot++;
+				}
+			}
+		}
+#endif
+
 		_init++;
 
 		debug_printf("GnuTLS init done\n");
@@ -1227,7 +1476,15 @@ void wget_ssl_deinit(void)
 	if (_init == 1) {
 		gnutls_certificate_free_credentials(_credentials);
 		gnutls_priority_deinit(_priority_cache);
+#if GNUTLS_VERSION_NUMBER >= 0x030200
+		_alpn_nprot = 0;
+#endif
 		gnutls_global_deinit();
+#ifdef HAVE_GNUTLS_OCSP_H
+		wget_vector_free(&_ocsp_in_flight);
+#endif
+		wget_stringmap_free(&_verified_chains);
+		wget_stringmap_free(&_hpkp_verdicts);
 	}
 
 	if (_init > 0) _init--;
@@ -1370,6 +1627,10 @@ int wget_ssl_open(wget_tcp_t *tcp)
 			.alpn_protocol = NULL,
 			.false_start = -1,
 			.tfo = -1,
+			.early_data = -1,
+			.tcp_secs = -1,
+			.hpkp_secs = -1,
+			.hpkp_cached = -1,
 			.resumed = 0,
 			.tcp_protocol = WGET_PROTOCOL_HTTP_1_1,
 			.cert_chain_size = 0
@@ -1390,27 +1651,48 @@ int wget_ssl_open(wget_tcp_t *tcp)
 	sockfd= tcp->sockfd;
 	connect_timeout = tcp->connect_timeout;
 
+	if (tls_stats) {
+		stats.tcp_secs = tcp->connect_millisecs;
+		if (tcp->tls_early_data)
+			stats.early_data = 0;
+	}
+
 #if GNUTLS_VERSION_NUMBER >= 0x030500
+	unsigned int init_flags = GNUTLS_CLIENT | GNUTLS_NONBLOCK;
+
 	if (tcp->tls_false_start) {
 		debug_printf("TLS False Start requested\n");
-		gnutls_init(&session, GNUTLS_CLIENT | GNUTLS_NONBLOCK | GNUTLS_ENABLE_FALSE_START);
-	} else
-		gnutls_init(&session, GNUTLS_CLIENT | GNUTLS_NONBLOCK);
+		init_flags |= GNUTLS_ENABLE_FALSE_START;
+	}
+#if GNUTLS_VERSION_NUMBER >= 0x030605
+	if (tcp->tls_early_data) {
+		debug_printf("TLS 1.3 early data requested\n");
+		init_flags |= GNUTLS_ENABLE_EARLY_DATA;
+	}
+#else
+	if (tcp->tls_early_data)
+		error_printf("TLS early data requested but Wget built with insufficient GnuTLS version\n");
+#endif
+	gnutls_init(&session, init_flags);
 #elif defined GNUTLS_NONBLOCK
 	if (tcp->tls_false_start)
 		error_printf("TLS False Start requested but Wget built with insufficient GnuTLS version\n");
+	if (tcp->tls_early_data)
+		error_printf("TLS early data requested but Wget built with insufficient GnuTLS version\n");
 	gnutls_init(&session, GNUTLS_CLIENT | GNUTLS_NONBLOCK);
 #else
 	// very old gnutls version, likely to not work.
 	if (tcp->tls_false_start)
 		error_printf("TLS False Start requested but Wget built with insufficient GnuTLS version\n");
+	if (tcp->tls_early_data)
+		error_printf("TLS early data requested but Wget built with insufficient GnuTLS version\n");
 	gnutls_init(&session, GNUTLS_CLIENT);
 #endif
 
 	if ((rc = gnutls_priority_set(session, _priority_cache)) != GNUTLS_E_SUCCESS)
 		error_printf("GnuTLS: Failed to set priorities: %s\n", gnutls_strerror(rc));
 
-	if (!wget_strcasecmp_ascii(_config.secure_protocol, "auto"))
+	if (_compat_mode)
 		gnutls_session_enable_compatibility_mode(session);
 
 	// RFC 6066 SNI Server Name Indication
@@ -1420,6 +1702,8 @@ int wget_ssl_open(wget_tcp_t *tcp)
 
 	struct _session_context *ctx = wget_calloc(1, sizeof(struct _session_context));
 	ctx->hostname = wget_strdup(hostname);
+	ctx->stats_hpkp_secs = -1;
+	ctx->stats_hpkp_cached = -1;
 
 #ifdef HAVE_GNUTLS_OCSP_H
 	// If we know the cert chain for the hostname being valid at the moment,
@@ -1442,26 +1726,8 @@ int wget_ssl_open(wget_tcp_t *tcp)
 #endif
 
 #if GNUTLS_VERSION_NUMBER >= 0x030200
-	if (_config.alpn) {
-		unsigned nprot;
-		const char *e, *s;
-
-		for (nprot = 0, s = e = _config.alpn; *e; s = e + 1)
-			if ((e = strchrnul(s, ',')) != s)
-				nprot++;
-
-		gnutls_datum_t data[nprot];
-
-		for (nprot = 0, s = e = _config.alpn; *e; s = e + 1) {
-			if ((e = strchrnul(s, ',')) != s) {
-				data[nprot].data = (unsigned char *) s;
-				data[nprot].size = (unsigned) (e - s);
-				debug_printf("ALPN offering %.*s\n", (int) data[nprot].size, data[nprot].data);
-				nprot++;
-			}
-		}
-
-		if ((rc = gnutls_alpn_set_protocols(session, data, nprot, 0)))
+	if (_alpn_nprot) {
+		if ((rc = gnutls_alpn_set_protocols(session, _alpn_protocols, _alpn_nprot, 0)))
 			error_printf("GnuTLS: Set ALPN: %s\n", gnutls_strerror(rc));
 	}
 #endif
@@ -1504,10 +1770,35 @@ int wget_ssl_open(wget_tcp_t *tcp)
 			debug_printf("found cached session data for %s\n", ctx->hostname);
 			if ((rc = gnutls_session_set_data(session, data, size)) != GNUTLS_E_SUCCESS)
 				error_printf("GnuTLS: Failed to set session data: %s\n", gnutls_strerror(rc));
+#if GNUTLS_VERSION_NUMBER >= 0x030605
+			else if (tcp->tls_early_data && !_config.alpn) {
+				// Defer the handshake until the first write, which then travels
+				// as TLS 1.3 0-RTT early data within the same flight.
+				// Not combinable with ALPN - the protocol selection must not
+				// depend on a handshake that hasn't completed yet.
+				ctx->early_data_pending = 1;
+				debug_printf("deferring handshake for TLS early data\n");
+			}
+#endif
 			xfree(data);
 		}
 	}
 
+#if GNUTLS_VERSION_NUMBER >= 0x030605
+	if (ctx->early_data_pending) {
+		if (tls_stats) {
+			// no separate TLS flight - the handshake rides along with the first request
+			stats.hostname = hostname;
+			stats.early_data = 1;
+			stats.resumed = 1;
+			stats.tls_con = 1;
+			stats.tls_secs = 0;
+			stats_callback(WGET_STATS_TYPE_TLS, &stats);
+		}
+		return WGET_E_SUCCESS; // the handshake is completed by the first read or write
+	}
+#endif
+
 	if (tls_stats)
 		before_millisecs = wget_get_timemillis();
 
@@ -1573,6 +1864,8 @@ int wget_ssl_open(wget_tcp_t *tcp)
 
 	if (tls_stats) {
 		stats.hostname = hostname;
+		stats.hpkp_cached = ctx->stats_hpkp_cached;
+		stats.hpkp_secs = ctx->stats_hpkp_secs;
 		stats_callback(WGET_STATS_TYPE_TLS, &stats);
 		xfree(stats.alpn_protocol);
 	}
@@ -1651,6 +1944,21 @@ ssize_t wget_ssl_read_timeout(void *session, char *buf, size_t count, int timeou
 	int rc;
 	ssize_t nbytes;
 
+#if GNUTLS_VERSION_NUMBER >= 0x030605
+	{
+		// the handshake may still be pending if the session was opened for
+		// TLS early data but nothing has been written yet
+		struct _session_context *early_ctx = gnutls_session_get_ptr(session);
+
+		if (early_ctx && early_ctx->early_data_pending) {
+			early_ctx->early_data_pending = 0;
+			if (_do_handshake(session, sockfd, timeout) != WGET_E_SUCCESS)
+				return -1;
+			early_ctx->delayed_session_data = 1;
+		}
+	}
+#endif
+
 	for (;;) {
 		if (gnutls_record_check_pending(session) <= 0 &&
 			(rc = wget_ready_2_read(sockfd, timeout)) <= 0)
@@ -1682,6 +1990,19 @@ ssize_t wget_ssl_read_timeout(void *session, char *buf, size_t count, int timeou
 			break;
 	}
 
+	// Drain records GnuTLS has already decrypted into its internal buffer:
+	// every record pulled here while the caller's buffer has room saves one
+	// poll/read round trip per record. With 16k TLS records and large caller
+	// buffers that halves the per-call overhead of bulk HTTPS payloads.
+	while (nbytes > 0 && (size_t) nbytes < count && gnutls_record_check_pending(session) > 0) {
+		ssize_t drained = gnutls_record_recv(session, buf + nbytes, count - nbytes);
+
+		if (drained <= 0)
+			break; // error or rehandshake surfaces on the next call
+
+		nbytes += drained;
+	}
+
 	return nbytes < -1 ? -1 : nbytes;
 #endif
 }
@@ -1697,6 +2018,32 @@ ssize_t wget_ssl_write_timeout(void *session, const char *buf, size_t count, int
 	int sockfd = (int)(ptrdiff_t)gnutls_transport_get_ptr(session);
 #endif
 
+#if GNUTLS_VERSION_NUMBER >= 0x030605
+	struct _session_context *ctx = gnutls_session_get_ptr(session);
+
+	if (ctx && ctx->early_data_pending) {
+		ctx->early_data_pending = 0;
+
+		// 0-RTT: hand the request to GnuTLS as early data, then run the deferred
+		// handshake - both go out in the same flight. If the server rejects the
+		// early data (replay protection, expired ticket, no TLS 1.3), it discards
+		// it and we send again over the established session.
+		nbytes = gnutls_record_send_early_data(session, buf, count);
+		if (nbytes < 0)
+			debug_printf("Early data not queued: %s\n", gnutls_strerror((int) nbytes));
+
+		if (_do_handshake(session, sockfd, timeout) != WGET_E_SUCCESS)
+			return -1;
+
+		ctx->delayed_session_data = 1; // pick up a fresh ticket after the first read
+
+		if (nbytes > 0 && (gnutls_session_get_flags(session) & GNUTLS_SFLAGS_EARLY_DATA)) {
+			debug_printf("%zd bytes sent as TLS early data\n", nbytes);
+			return nbytes;
+		}
+	}
+#endif
+
 	for (;;) {
 		if ((rc = wget_ready_2_write(sockfd, timeout)) <= 0)
 			return rc;
@@ -1759,6 +2106,14 @@ const void *wget_tcp_get_stats_tls(wget_tls_stats_t type, const void *_stats)
 		return &(stats->cert_chain_size);
 	case WGET_STATS_TLS_SECS:
 		return &(stats->tls_secs);
+	case WGET_STATS_TLS_TCP_SECS:
+		return &(stats->tcp_secs);
+	case WGET_STATS_TLS_EARLY_DATA:
+		return &(stats->early_data);
+	case WGET_STATS_TLS_HPKP_CACHED:
+		return &(stats->hpkp_cached);
+	case WGET_STATS_TLS_HPKP_SECS:
+		return &(stats->hpkp_secs);
 	default:
 		return NULL;
 	}
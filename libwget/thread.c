@@ -29,6 +29,9 @@
 
 #include <signal.h>
 #include <errno.h>
+#ifdef __linux__
+#	include <sched.h>
+#endif
 #include "timespec.h" // gnulib gettime()
 
 #include <wget.h>
@@ -53,11 +56,63 @@ int wget_thread_start(wget_thread_t *thread, void *(*start_routine)(void *), voi
 	return rc;
 }
 
+// Pin a thread to the n-th CPU the process may run on. Round-robin
+// placement keeps a thread on one core, and with it - via first-touch
+// allocation - its buffers on that core's memory node, so NUMA boxes
+// don't pay cross-node traffic for every body chunk.
+int wget_thread_bind_cpu(wget_thread_t thread, int n)
+{
+#if defined __linux__ && USE_POSIX_THREADS
+	cpu_set_t allowed, set;
+	int count;
+
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+		return errno;
+
+	if ((count = CPU_COUNT(&allowed)) <= 0)
+		return EINVAL;
+
+	n %= count;
+
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &allowed) && n-- == 0) {
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			return pthread_setaffinity_np(thread, sizeof(set), &set);
+		}
+	}
+
+	return EINVAL;
+#else
+	(void) thread; (void) n;
+	return ENOSYS;
+#endif
+}
+
 int wget_thread_mutex_init(wget_thread_mutex_t *mutex)
 {
 	return pthread_mutex_init(mutex, NULL);
 }
 
+// for short critical sections (hash table / db lookups): spin a little
+// before parking in the kernel, where the implementation supports it
+int wget_thread_mutex_init_adaptive(wget_thread_mutex_t *mutex)
+{
+#ifdef PTHREAD_MUTEX_ADAPTIVE_NP
+	pthread_mutexattr_t attr;
+	int rc;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+	rc = pthread_mutex_init(mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	return rc;
+#else
+	return pthread_mutex_init(mutex, NULL);
+#endif
+}
+
 void wget_thread_mutex_lock(wget_thread_mutex_t *mutex)
 {
 	pthread_mutex_lock(mutex);
@@ -110,6 +165,19 @@ int wget_thread_cond_signal(wget_thread_cond_t *cond)
 	return pthread_cond_broadcast(cond);
 }
 
+// wake up to n waiters instead of broadcasting to all of them - signalling
+// once per queued work item avoids the thundering herd on batch enqueues.
+// Surplus signals (n larger than the number of waiters) are simply dropped.
+int wget_thread_cond_signal_n(wget_thread_cond_t *cond, int n)
+{
+	int rc = 0;
+
+	while (n-- > 0 && rc == 0)
+		rc = pthread_cond_signal(cond);
+
+	return rc;
+}
+
 int wget_thread_cond_wait(wget_thread_cond_t *cond, wget_thread_mutex_t *mutex, long long ms)
 {
 	if (ms <= 0)
@@ -126,6 +194,159 @@ bool wget_thread_support(void)
 	return true;
 }
 
+/*
+ * A small generic worker pool: FIFO task queue, fixed number of threads.
+ * Dispatch wakes exactly one worker per task, wget_thread_pool_wait()
+ * blocks until the queue drained and all running tasks finished.
+ */
+
+typedef struct _thread_pool_task_st {
+	struct _thread_pool_task_st
+		*next;
+	void
+		(*fn)(void *);
+	void
+		*arg;
+} _thread_pool_task_t;
+
+struct _wget_thread_pool_st {
+	wget_thread_t
+		*threads;
+	_thread_pool_task_t
+		*head,
+		*tail;
+	wget_thread_mutex_t
+		mutex;
+	wget_thread_cond_t
+		work_cond, // signalled per queued task
+		idle_cond; // signalled when the pool drains
+	int
+		nthreads,
+		queued,
+		running;
+	bool
+		shutdown;
+};
+
+static void *_thread_pool_worker(void *p)
+{
+	wget_thread_pool_t *pool = p;
+
+	wget_thread_mutex_lock(&pool->mutex);
+
+	while (!pool->shutdown) {
+		_thread_pool_task_t *task;
+
+		if (!(task = pool->head)) {
+			wget_thread_cond_wait(&pool->work_cond, &pool->mutex, 0);
+			continue;
+		}
+
+		if (!(pool->head = task->next))
+			pool->tail = NULL;
+		pool->queued--;
+		pool->running++;
+		wget_thread_mutex_unlock(&pool->mutex);
+
+		task->fn(task->arg);
+		xfree(task);
+
+		wget_thread_mutex_lock(&pool->mutex);
+		pool->running--;
+		if (!pool->running && !pool->queued)
+			wget_thread_cond_signal(&pool->idle_cond);
+	}
+
+	wget_thread_mutex_unlock(&pool->mutex);
+
+	return NULL;
+}
+
+wget_thread_pool_t *wget_thread_pool_create(int nthreads)
+{
+	wget_thread_pool_t *pool;
+
+	if (nthreads < 1)
+		return NULL;
+
+	pool = xcalloc(1, sizeof(*pool));
+	wget_thread_mutex_init(&pool->mutex);
+	wget_thread_cond_init(&pool->work_cond);
+	wget_thread_cond_init(&pool->idle_cond);
+	pool->threads = xcalloc(nthreads, sizeof(wget_thread_t));
+
+	for (int it = 0; it < nthreads; it++) {
+		if (wget_thread_start(&pool->threads[pool->nthreads], _thread_pool_worker, pool, 0) == 0)
+			pool->nthreads++;
+	}
+
+	if (!pool->nthreads) {
+		xfree(pool->threads);
+		xfree(pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+int wget_thread_pool_dispatch(wget_thread_pool_t *pool, void (*fn)(void *), void *arg)
+{
+	_thread_pool_task_t *task = xmalloc(sizeof(*task));
+
+	task->next = NULL;
+	task->fn = fn;
+	task->arg = arg;
+
+	wget_thread_mutex_lock(&pool->mutex);
+
+	if (pool->shutdown) {
+		wget_thread_mutex_unlock(&pool->mutex);
+		xfree(task);
+		return -1;
+	}
+
+	if (pool->tail)
+		pool->tail->next = task;
+	else
+		pool->head = task;
+	pool->tail = task;
+	pool->queued++;
+
+	wget_thread_cond_signal_n(&pool->work_cond, 1);
+	wget_thread_mutex_unlock(&pool->mutex);
+
+	return 0;
+}
+
+void wget_thread_pool_wait(wget_thread_pool_t *pool)
+{
+	wget_thread_mutex_lock(&pool->mutex);
+	while (pool->queued || pool->running)
+		wget_thread_cond_wait(&pool->idle_cond, &pool->mutex, 0);
+	wget_thread_mutex_unlock(&pool->mutex);
+}
+
+void wget_thread_pool_free(wget_thread_pool_t **pool)
+{
+	wget_thread_pool_t *p;
+
+	if (!pool || !(p = *pool))
+		return;
+
+	wget_thread_pool_wait(p);
+
+	wget_thread_mutex_lock(&p->mutex);
+	p->shutdown = true;
+	wget_thread_cond_signal(&p->work_cond); // broadcast, all workers exit
+	wget_thread_mutex_unlock(&p->mutex);
+
+	for (int it = 0; it < p->nthreads; it++)
+		wget_thread_join(p->threads[it]);
+
+	xfree(p->threads);
+	xfree(*pool);
+}
+
 #else // USE_POSIX_THREADS || USE_PTH_THREADS
 
 bool wget_thread_support(void)
@@ -138,6 +359,7 @@ int wget_thread_start(wget_thread_t *thread, void *(*start_routine)(void *), voi
 	start_routine(arg);
 	return 0;
 }
+int wget_thread_bind_cpu(wget_thread_t thread, int n) { return 0; }
 int wget_thread_mutex_init(wget_thread_mutex_t *mutex) { return 0; }
 void wget_thread_mutex_lock(wget_thread_mutex_t *mutex) { }
 void wget_thread_mutex_unlock(wget_thread_mutex_t *mutex) { }
@@ -148,5 +370,25 @@ wget_thread_t wget_thread_self(void) { return 0; }
 int wget_thread_cond_init(wget_thread_cond_t *cond) { return 0; }
 int wget_thread_cond_signal(wget_thread_cond_t *cond) { return 0; }
 int wget_thread_cond_wait(wget_thread_cond_t *cond, wget_thread_mutex_t *mutex, long long ms) { return 0; }
+int wget_thread_mutex_init_adaptive(wget_thread_mutex_t *mutex) { return 0; }
+int wget_thread_cond_signal_n(wget_thread_cond_t *cond, int n) { return 0; }
+
+// without thread support tasks simply run inline
+struct _wget_thread_pool_st { int unused; };
+wget_thread_pool_t *wget_thread_pool_create(int nthreads)
+{
+	return nthreads >= 1 ? xcalloc(1, sizeof(wget_thread_pool_t)) : NULL;
+}
+int wget_thread_pool_dispatch(wget_thread_pool_t *pool, void (*fn)(void *), void *arg)
+{
+	fn(arg);
+	return 0;
+}
+void wget_thread_pool_wait(wget_thread_pool_t *pool) { }
+void wget_thread_pool_free(wget_thread_pool_t **pool)
+{
+	if (pool)
+		xfree(*pool);
+}
 
 #endif // USE_POSIX_THREADS || USE_PTH_THREADS
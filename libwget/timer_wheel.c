@@ -0,0 +1,286 @@
+/*
+ * Copyright(c) 2017-2019 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Hashed timing wheel routines
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <wget.h>
+#include "private.h"
+
+/**
+ * \file
+ * \brief Hashed timing wheel
+ * \defgroup libwget-timer_wheel Timer wheel
+ * @{
+ *
+ * A hashed timing wheel for managing many deadlines (connect, read, idle
+ * timeouts) at O(1) insert and cancel. Timers hash into a fixed number of
+ * slots by their expiry tick; advancing the wheel only touches the slots
+ * the clock actually passed, so thousands of idle deadlines cost nothing
+ * until they come due.
+ *
+ * The wheel is not thread-safe - like the hashmap and vector primitives
+ * it expects the caller to serialize access. Callbacks fire from within
+ * wget_timer_wheel_tick() and may add or cancel other timers, but must
+ * not cancel the timer that is currently firing (it is already detached
+ * and about to be freed).
+ */
+
+struct _wget_timer_st {
+	wget_timer_t
+		*prev,
+		*next;
+	long long
+		expiry_ts; // milliseconds
+	wget_timer_cb_t
+		*cb;
+	void
+		*ctx;
+	unsigned int
+		slot;
+};
+
+struct _wget_timer_wheel_st {
+	wget_timer_t
+		**slots;
+	long long
+		last_tick; // wheel position in ticks
+	unsigned int
+		mask; // nslots - 1, nslots is a power of two
+	int
+		tick_ms, // granularity
+		ntimers;
+};
+
+static void _wheel_unlink(wget_timer_wheel_t *wheel, wget_timer_t *timer)
+{
+	if (timer->prev)
+		timer->prev->next = timer->next;
+	else
+		wheel->slots[timer->slot] = timer->next;
+
+	if (timer->next)
+		timer->next->prev = timer->prev;
+
+	wheel->ntimers--;
+}
+
+/**
+ * \param[in] nslots Number of wheel slots, rounded up to the next power of two
+ * \param[in] tick_ms Wheel granularity in milliseconds
+ * \return New timer wheel instance
+ *
+ * Creates a timing wheel. Deadlines are enforced with a granularity of
+ * \p tick_ms - a coarse tick (e.g. 1000ms for idle connection reaping)
+ * keeps wheel advances cheap.
+ */
+wget_timer_wheel_t *wget_timer_wheel_create(int nslots, int tick_ms)
+{
+	unsigned int capacity;
+	wget_timer_wheel_t *wheel;
+
+	if (nslots < 2 || tick_ms < 1)
+		return NULL;
+
+	for (capacity = 2; capacity < (unsigned int) nslots; capacity <<= 1)
+		;
+
+	wheel = xcalloc(1, sizeof(wget_timer_wheel_t));
+	wheel->slots = xcalloc(capacity, sizeof(wget_timer_t *));
+	wheel->mask = capacity - 1;
+	wheel->tick_ms = tick_ms;
+	wheel->last_tick = wget_get_timemillis_coarse() / tick_ms;
+
+	return wheel;
+}
+
+/**
+ * \param[in] wheel Timer wheel
+ * \param[in] timeout_ms Deadline relative to now, in milliseconds
+ * \param[in] cb Function called when the deadline passes
+ * \param[in] ctx Context pointer handed to \p cb
+ * \return Timer handle for wget_timer_wheel_cancel(), owned by the wheel
+ *
+ * Arms a one-shot timer. The handle stays valid until the timer fires or
+ * is cancelled - both free it, so a fired timer must not be cancelled
+ * (clear the stored handle from the callback).
+ */
+wget_timer_t *wget_timer_wheel_add(wget_timer_wheel_t *wheel, long long timeout_ms, wget_timer_cb_t *cb, void *ctx)
+{
+	wget_timer_t *timer = xcalloc(1, sizeof(wget_timer_t));
+	long long tick;
+
+	timer->expiry_ts = wget_get_timemillis_coarse() + (timeout_ms > 0 ? timeout_ms : 0);
+	timer->cb = cb;
+	timer->ctx = ctx;
+
+	// never hash into the tick the wheel already passed, it would only be
+	// visited again after a full rotation
+	tick = timer->expiry_ts / wheel->tick_ms;
+	if (tick <= wheel->last_tick)
+		tick = wheel->last_tick + 1;
+
+	timer->slot = (unsigned int) tick & wheel->mask;
+	timer->next = wheel->slots[timer->slot];
+	if (timer->next)
+		timer->next->prev = timer;
+	wheel->slots[timer->slot] = timer;
+	wheel->ntimers++;
+
+	return timer;
+}
+
+/**
+ * \param[in] wheel Timer wheel
+ * \param[in,out] timer Pointer to the timer handle, set to NULL
+ *
+ * Disarms and frees a pending timer in O(1). Safe to call with a NULL
+ * handle, so callers can cancel unconditionally.
+ */
+void wget_timer_wheel_cancel(wget_timer_wheel_t *wheel, wget_timer_t **timer)
+{
+	if (!timer || !*timer)
+		return;
+
+	_wheel_unlink(wheel, *timer);
+	xfree(*timer);
+}
+
+/**
+ * \param[in] wheel Timer wheel
+ * \param[in] now_ms Current time in milliseconds (e.g. wget_get_timemillis_coarse())
+ * \return Number of timers fired
+ *
+ * Advances the wheel to \p now_ms and fires all expired timers. Only the
+ * slots between the previous and the current tick are inspected, at most
+ * one full rotation. Fired timers are freed after their callback returned.
+ */
+int wget_timer_wheel_tick(wget_timer_wheel_t *wheel, long long now_ms)
+{
+	long long now_tick = now_ms / wheel->tick_ms, span;
+	wget_timer_t *expired = NULL;
+	int fired = 0;
+
+	span = now_tick - wheel->last_tick;
+	if (span <= 0)
+		return 0;
+
+	if (!wheel->ntimers) {
+		wheel->last_tick = now_tick;
+		return 0;
+	}
+
+	if (span > (long long) wheel->mask + 1)
+		span = (long long) wheel->mask + 1; // one rotation covers every slot
+
+	for (long long tick = wheel->last_tick + 1; tick <= wheel->last_tick + span; tick++) {
+		unsigned int slot = (unsigned int) tick & wheel->mask;
+
+		for (wget_timer_t *timer = wheel->slots[slot], *next; timer; timer = next) {
+			next = timer->next;
+
+			// an entry hashed here from a later rotation stays put
+			if (timer->expiry_ts > now_ms)
+				continue;
+
+			_wheel_unlink(wheel, timer);
+			timer->next = expired;
+			expired = timer;
+		}
+	}
+
+	wheel->last_tick = now_tick;
+
+	while (expired) {
+		wget_timer_t *timer = expired;
+
+		expired = timer->next;
+		timer->cb(timer->ctx);
+		xfree(timer);
+		fired++;
+	}
+
+	return fired;
+}
+
+/**
+ * \param[in] wheel Timer wheel
+ * \param[in] now_ms Current time in milliseconds
+ * \return Milliseconds until the next deadline, 0 if one already passed, -1 if no timer is pending
+ *
+ * Computes how long a poll/select loop may sleep before a timer needs
+ * service. This walks the pending timers, so call it once per loop
+ * iteration, not per socket.
+ */
+long long wget_timer_wheel_next(wget_timer_wheel_t *wheel, long long now_ms)
+{
+	long long min = -1;
+
+	if (!wheel->ntimers)
+		return -1;
+
+	for (unsigned int slot = 0; slot <= wheel->mask; slot++) {
+		for (wget_timer_t *timer = wheel->slots[slot]; timer; timer = timer->next) {
+			if (min < 0 || timer->expiry_ts < min)
+				min = timer->expiry_ts;
+		}
+	}
+
+	return min > now_ms ? min - now_ms : 0;
+}
+
+/**
+ * \param[in] wheel Timer wheel
+ * \return Number of pending timers
+ */
+int wget_timer_wheel_size(wget_timer_wheel_t *wheel)
+{
+	return wheel ? wheel->ntimers : 0;
+}
+
+/**
+ * \param[in,out] wheel Pointer to the timer wheel, set to NULL
+ *
+ * Frees the wheel and all pending timers. No callbacks are fired.
+ */
+void wget_timer_wheel_free(wget_timer_wheel_t **wheel)
+{
+	wget_timer_wheel_t *w;
+
+	if (!wheel || !(w = *wheel))
+		return;
+
+	for (unsigned int slot = 0; slot <= w->mask; slot++) {
+		for (wget_timer_t *timer = w->slots[slot], *next; timer; timer = next) {
+			next = timer->next;
+			xfree(timer);
+		}
+	}
+
+	xfree(w->slots);
+	xfree(*wheel);
+}
+
+/**@}*/
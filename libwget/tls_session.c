@@ -38,11 +38,20 @@
 #include <wget.h>
 #include "private.h"
 
-struct _wget_tls_session_db_st {
+// The entries are sharded by hostname hash with one mutex per shard,
+// so that many simultaneous handshakes don't serialize on a single lock.
+#define _TLS_SESSION_DB_SHARDS 16
+
+struct _tls_session_db_shard {
 	wget_hashmap_t *
 		entries;
 	wget_thread_mutex_t
 		mutex;
+};
+
+struct _wget_tls_session_db_st {
+	struct _tls_session_db_shard
+		shards[_TLS_SESSION_DB_SHARDS];
 	int64_t
 		load_time;
 	bool
@@ -78,6 +87,13 @@ static unsigned int G_GNUC_WGET_PURE _hash_tls_session(const wget_tls_session_t
 	return hash;
 }
 
+static struct _tls_session_db_shard G_GNUC_WGET_PURE *_shard_of(const wget_tls_session_db_t *tls_session_db, const char *host)
+{
+	wget_tls_session_t tls_session = { .host = host };
+
+	return (struct _tls_session_db_shard *) &tls_session_db->shards[_hash_tls_session(&tls_session) % _TLS_SESSION_DB_SHARDS];
+}
+
 static int G_GNUC_WGET_NONNULL_ALL G_GNUC_WGET_PURE _compare_tls_session(const wget_tls_session_t *s1, const wget_tls_session_t *s2)
 {
 	int n;
@@ -144,17 +160,27 @@ wget_tls_session_t *wget_tls_session_new(const char *host, time_t maxage, const
 int wget_tls_session_get(const wget_tls_session_db_t *tls_session_db, const char *host, void **data, size_t *size)
 {
 	if (tls_session_db) {
+		struct _tls_session_db_shard *shard = _shard_of(tls_session_db, host);
 		wget_tls_session_t tls_session, *tls_sessionp;
 		int64_t now = time(NULL);
+		int found = 0;
 
 		tls_session.host = host;
-		if ((tls_sessionp = wget_hashmap_get(tls_session_db->entries, &tls_session)) && tls_sessionp->expires >= now) {
+
+		wget_thread_mutex_lock(&shard->mutex);
+
+		if ((tls_sessionp = wget_hashmap_get(shard->entries, &tls_session)) && tls_sessionp->expires >= now) {
 			if (data)
 				*data = wget_memdup(tls_sessionp->data, tls_sessionp->data_size);
 			if (size)
 				*size = tls_sessionp->data_size;
-			return 0;
+			found = 1;
 		}
+
+		wget_thread_mutex_unlock(&shard->mutex);
+
+		if (found)
+			return 0;
 	}
 
 	return 1;
@@ -166,10 +192,15 @@ wget_tls_session_db_t *wget_tls_session_db_init(wget_tls_session_db_t *tls_sessi
 		tls_session_db = xmalloc(sizeof(wget_tls_session_db_t));
 
 	memset(tls_session_db, 0, sizeof(*tls_session_db));
-	tls_session_db->entries = wget_hashmap_create(16, (wget_hashmap_hash_t)_hash_tls_session, (wget_hashmap_compare_t)_compare_tls_session);
-	wget_hashmap_set_key_destructor(tls_session_db->entries, (wget_hashmap_key_destructor_t)wget_tls_session_free);
-	wget_hashmap_set_value_destructor(tls_session_db->entries, (wget_hashmap_value_destructor_t)wget_tls_session_free);
-	wget_thread_mutex_init(&tls_session_db->mutex);
+
+	for (unsigned it = 0; it < _TLS_SESSION_DB_SHARDS; it++) {
+		struct _tls_session_db_shard *shard = &tls_session_db->shards[it];
+
+		shard->entries = wget_hashmap_create(16, (wget_hashmap_hash_t)_hash_tls_session, (wget_hashmap_compare_t)_compare_tls_session);
+		wget_hashmap_set_key_destructor(shard->entries, (wget_hashmap_key_destructor_t)wget_tls_session_free);
+		wget_hashmap_set_value_destructor(shard->entries, (wget_hashmap_value_destructor_t)wget_tls_session_free);
+		wget_thread_mutex_init_adaptive(&shard->mutex);
+	}
 
 	return tls_session_db;
 }
@@ -177,9 +208,13 @@ wget_tls_session_db_t *wget_tls_session_db_init(wget_tls_session_db_t *tls_sessi
 void wget_tls_session_db_deinit(wget_tls_session_db_t *tls_session_db)
 {
 	if (tls_session_db) {
-		wget_thread_mutex_lock(&tls_session_db->mutex);
-		wget_hashmap_free(&tls_session_db->entries);
-		wget_thread_mutex_unlock(&tls_session_db->mutex);
+		for (unsigned it = 0; it < _TLS_SESSION_DB_SHARDS; it++) {
+			struct _tls_session_db_shard *shard = &tls_session_db->shards[it];
+
+			wget_thread_mutex_lock(&shard->mutex);
+			wget_hashmap_free(&shard->entries);
+			wget_thread_mutex_unlock(&shard->mutex);
+		}
 	}
 }
 
@@ -193,30 +228,32 @@ void wget_tls_session_db_free(wget_tls_session_db_t **tls_session_db)
 
 void wget_tls_session_db_add(wget_tls_session_db_t *tls_session_db, wget_tls_session_t *tls_session)
 {
-	wget_thread_mutex_lock(&tls_session_db->mutex);
+	struct _tls_session_db_shard *shard = _shard_of(tls_session_db, tls_session->host);
+
+	wget_thread_mutex_lock(&shard->mutex);
 
 	if (tls_session->maxage == 0) {
-		if (wget_hashmap_remove(tls_session_db->entries, tls_session)) {
+		if (wget_hashmap_remove(shard->entries, tls_session)) {
 			tls_session_db->changed = 1;
 			debug_printf("removed TLS session data for %s\n", tls_session->host);
 		}
 		wget_tls_session_free(tls_session);
 		tls_session = NULL;
 	} else {
-		wget_tls_session_t *old = wget_hashmap_get(tls_session_db->entries, tls_session);
+		wget_tls_session_t *old = wget_hashmap_get(shard->entries, tls_session);
 
 		if (old) {
 			debug_printf("found TLS session data for %s\n", old->host);
-			if (wget_hashmap_remove(tls_session_db->entries, old))
+			if (wget_hashmap_remove(shard->entries, old))
 				debug_printf("removed TLS session data for %s\n", tls_session->host);
 		}
 
 		debug_printf("add TLS session data for %s (maxage=%lld, size=%zu)\n", tls_session->host, (long long)tls_session->maxage, tls_session->data_size);
-		wget_hashmap_put_noalloc(tls_session_db->entries, tls_session, tls_session);
+		wget_hashmap_put_noalloc(shard->entries, tls_session, tls_session);
 		tls_session_db->changed = 1;
 	}
 
-	wget_thread_mutex_unlock(&tls_session_db->mutex);
+	wget_thread_mutex_unlock(&shard->mutex);
 }
 
 static int _tls_session_db_load(wget_tls_session_db_t *tls_session_db, FILE *fp)
@@ -344,16 +381,39 @@ static int G_GNUC_WGET_NONNULL_ALL _tls_session_save(FILE *fp, const wget_tls_se
 	return 0;
 }
 
-static int _tls_session_db_save(void *tls_session_db, FILE *fp)
+static int _tls_session_db_size(const wget_tls_session_db_t *tls_session_db)
+{
+	int size = 0;
+
+	for (unsigned it = 0; it < _TLS_SESSION_DB_SHARDS; it++)
+		size += wget_hashmap_size(tls_session_db->shards[it].entries);
+
+	return size;
+}
+
+static int _tls_session_db_save(void *ctx, FILE *fp)
 {
-	wget_hashmap_t *entries = ((wget_tls_session_db_t *)tls_session_db)->entries;
+	wget_tls_session_db_t *tls_session_db = (wget_tls_session_db_t *)ctx;
 
-	if (wget_hashmap_size(entries) > 0) {
+	if (_tls_session_db_size(tls_session_db) > 0) {
 		fputs("#TLSSession 1.0 file\n", fp);
 		fputs("#Generated by Wget2 " PACKAGE_VERSION ". Edit at your own risk.\n", fp);
 		fputs("#<hostname>  <created> <max-age> <session data>\n\n", fp);
 
-		wget_hashmap_browse(entries, (wget_hashmap_browse_t)_tls_session_save, fp);
+		for (unsigned it = 0; it < _TLS_SESSION_DB_SHARDS; it++) {
+			struct _tls_session_db_shard *shard = &tls_session_db->shards[it];
+			void **snapshot;
+			int count;
+
+			// snapshot the entry pointers under the shard mutex, do the
+			// base64/file I/O outside of it - writers only block for a memcpy
+			wget_thread_mutex_lock(&shard->mutex);
+			count = wget_hashmap_snapshot(shard->entries, &snapshot);
+			wget_thread_mutex_unlock(&shard->mutex);
+
+			wget_hashmap_browse_snapshot(snapshot, count, (wget_hashmap_browse_t)_tls_session_save, fp);
+			xfree(snapshot);
+		}
 
 		if (ferror(fp))
 			return -1;
@@ -377,7 +437,7 @@ int wget_tls_session_db_save(wget_tls_session_db_t *tls_session_db, const char *
 		return -1;
 	}
 
-	if ((size = wget_hashmap_size(tls_session_db->entries)))
+	if ((size = _tls_session_db_size(tls_session_db)))
 		debug_printf(_("Saved %d TLS session entr%s into '%s'\n"), size, size != 1 ? "ies" : "y", fname);
 	else
 		debug_printf(_("No TLS session entries to save. Table is empty.\n"));
@@ -28,6 +28,7 @@
 #include <config.h>
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <strings.h>
 #include <unistd.h>
@@ -43,9 +44,163 @@
 #	include <termios.h>
 #endif
 
+#ifdef __SSE2__
+#	include <emmintrin.h>
+#endif
+
 #include <wget.h>
 #include "private.h"
 
+// Vectorized variants of the hottest micro-primitives in this file,
+// dispatched via cpu.c. They are called hundreds of millions of times
+// per crawl (header comparisons, URL normalization, hash printing), so
+// even small per-call savings add up.
+
+int ascii_strcasecmp_scalar(const char *s1, const char *s2)
+{
+	return c_strcasecmp(s1, s2);
+}
+
+int ascii_strncasecmp_scalar(const char *s1, const char *s2, size_t n)
+{
+	return c_strncasecmp(s1, s2, n);
+}
+
+#if defined(__SSE2__) && WITH_OVERREAD_KERNELS
+
+// add 0x20 to A-Z only (bytes >= 0x80 are negative in epi8 and stay untouched)
+static inline __m128i _fold_case(__m128i v)
+{
+	__m128i is_upper = _mm_and_si128(
+		_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+		_mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+
+	return _mm_add_epi8(v, _mm_and_si128(is_upper, _mm_set1_epi8(0x20)));
+}
+
+// a 16-byte load is only safe when it cannot cross into the next page
+#define _page_safe(p) (((uintptr_t) (p) & 0xFFF) <= 0xFF0)
+
+int ascii_strcasecmp_sse2(const char *s1, const char *s2)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	for (;;) {
+		if (!_page_safe(s1) || !_page_safe(s2)) {
+			// near a page end - step one byte the scalar way
+			int c1 = c_tolower((unsigned char) *s1), c2 = c_tolower((unsigned char) *s2);
+
+			if (c1 != c2 || !*s1)
+				return c1 - c2;
+			s1++, s2++;
+			continue;
+		}
+
+		__m128i a = _mm_loadu_si128((const __m128i *) s1);
+		__m128i b = _mm_loadu_si128((const __m128i *) s2);
+		unsigned eq = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_fold_case(a), _fold_case(b)));
+		unsigned nul = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(a, zero));
+		unsigned stop = (~eq & 0xFFFF) | nul;
+
+		if (stop) {
+			int k = __builtin_ctz(stop);
+
+			return c_tolower((unsigned char) s1[k]) - c_tolower((unsigned char) s2[k]);
+		}
+
+		s1 += 16, s2 += 16;
+	}
+}
+
+int ascii_strncasecmp_sse2(const char *s1, const char *s2, size_t n)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	while (n >= 16) {
+		if (!_page_safe(s1) || !_page_safe(s2)) {
+			int c1 = c_tolower((unsigned char) *s1), c2 = c_tolower((unsigned char) *s2);
+
+			if (c1 != c2 || !*s1)
+				return c1 - c2;
+			s1++, s2++, n--;
+			continue;
+		}
+
+		__m128i a = _mm_loadu_si128((const __m128i *) s1);
+		__m128i b = _mm_loadu_si128((const __m128i *) s2);
+		unsigned eq = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_fold_case(a), _fold_case(b)));
+		unsigned nul = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(a, zero));
+		unsigned stop = (~eq & 0xFFFF) | nul;
+
+		if (stop) {
+			int k = __builtin_ctz(stop);
+
+			return c_tolower((unsigned char) s1[k]) - c_tolower((unsigned char) s2[k]);
+		}
+
+		s1 += 16, s2 += 16, n -= 16;
+	}
+
+	return n ? c_strncasecmp(s1, s2, n) : 0;
+}
+
+#undef _page_safe
+
+#endif // __SSE2__ && WITH_OVERREAD_KERNELS
+
+size_t memtohex_bulk_scalar(char *dst, const unsigned char *src, size_t n)
+{
+	// two output chars per input byte, written with one 16-bit store
+	static uint16_t pair[256];
+	size_t it;
+
+	if (!pair[0]) { // idempotent init, safe to race
+		static const char hexdigits[17] = "0123456789abcdef";
+
+		for (int b = 0; b < 256; b++) {
+			char two[2] = { hexdigits[b >> 4], hexdigits[b & 0xF] };
+
+			memcpy(&pair[b], two, 2);
+		}
+	}
+
+	for (it = 0; it < n; it++, dst += 2)
+		memcpy(dst, &pair[src[it]], 2);
+
+	return n;
+}
+
+#ifdef WITH_SSSE3_KERNELS
+
+#include <immintrin.h>
+
+__attribute__((target("ssse3")))
+size_t memtohex_bulk_ssse3(char *dst, const unsigned char *src, size_t n)
+{
+	const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	size_t done = 0;
+
+	// 8 input bytes -> 16 hex chars per step
+	while (n - done >= 8) {
+		__m128i in = _mm_loadl_epi64((const __m128i *) (src + done));
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+		__m128i lo = _mm_and_si128(in, mask);
+
+		_mm_storeu_si128((__m128i *) dst, _mm_shuffle_epi8(digits, _mm_unpacklo_epi8(hi, lo)));
+		dst += 16;
+		done += 8;
+	}
+
+	return done + memtohex_bulk_scalar(dst, src + done, n - done);
+}
+
+#endif // WITH_SSSE3_KERNELS
+
+ascii_strcasecmp_fn ascii_strcasecmp = ascii_strcasecmp_scalar;
+ascii_strncasecmp_fn ascii_strncasecmp = ascii_strncasecmp_scalar;
+memtohex_bulk_fn memtohex_bulk = memtohex_bulk_scalar;
+
 /**
  * \file
  * \brief General utility functions
@@ -133,7 +288,7 @@ int wget_strcasecmp_ascii(const char *s1, const char *s2)
 		if (!s2)
 			return 1;
 		else
-			return c_strcasecmp(s1, s2);
+			return ascii_strcasecmp(s1, s2);
 	}
 }
 
@@ -161,7 +316,7 @@ int wget_strncasecmp_ascii(const char *s1, const char *s2, size_t n)
 		if (!s2)
 			return 1;
 		else
-			return c_strncasecmp(s1, s2, n);
+			return ascii_strncasecmp(s1, s2, n);
 	}
 }
 
@@ -258,7 +413,10 @@ void wget_memtohex(const unsigned char *src, size_t src_len, char *dst, size_t d
 		adjust = 1;
 	}
 
-	for (it = 0; it < src_len; it++, src++) {
+	it = memtohex_bulk(dst, src, src_len);
+	src += it;
+	dst += it * 2;
+	for (; it < src_len; it++, src++) {
 		*dst++ = (char) ((c = (*src >> 4)) >= 10 ? c + 'a' - 10 : c + '0');
 		*dst++ = (char) ((c = (*src & 0xf)) >= 10 ? c + 'a' - 10 : c + '0');
 	}
@@ -293,6 +451,29 @@ long long wget_get_timemillis(void)
 	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
 }
 
+/**
+ * Return the current milliseconds since the epoch from a coarse clock.
+ *
+ * A few milliseconds stale (one kernel tick), but cheaper than the precise
+ * clock - meant for per-chunk bookkeeping like pacing, progress and stats
+ * timestamps that get called at high volume. Use wget_get_timemillis()
+ * for actual timeout math. Falls back to the precise clock where no
+ * coarse clock exists.
+ *
+ * Don't mix both clocks in one subtraction - the coarse one lags behind.
+ */
+long long wget_get_timemillis_coarse(void)
+{
+#ifdef CLOCK_REALTIME_COARSE
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) == 0)
+		return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+#endif
+
+	return wget_get_timemillis();
+}
+
 static _GL_INLINE unsigned char G_GNUC_WGET_CONST _unhex(unsigned char c)
 {
 	return c <= '9' ? c - '0' : (c <= 'F' ? c - 'A' + 10 : c - 'a' + 10);
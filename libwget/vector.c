@@ -34,6 +34,11 @@
 #include <wget.h>
 #include "private.h"
 
+// number of entry slots stored inline in the vector struct itself -
+// vectors that never outgrow these (request headers, cookie lists, ...)
+// don't allocate an entry array at all
+#define VEC_INLINE_SIZE 8
+
 struct _wget_vector_st {
 	wget_vector_compare_t
 		cmp; // comparison function
@@ -47,6 +52,8 @@ struct _wget_vector_st {
 		off;     // number of elements to add if resize occurs
 	bool
 		sorted : 1; // 1=list is sorted, 0=list is not sorted
+	void
+		*inline_entry[VEC_INLINE_SIZE]; // small-buffer storage, used while <entry> points here
 };
 
 // create vector with initial size <max>
@@ -61,7 +68,10 @@ wget_vector_t *wget_vector_create(int max, int off, wget_vector_compare_t cmp)
 {
 	wget_vector_t *v = xcalloc(1, sizeof(wget_vector_t));
 
-	v->entry = xmalloc(max * sizeof(void *));
+	if (max <= VEC_INLINE_SIZE)
+		v->entry = v->inline_entry;
+	else
+		v->entry = xmalloc(max * sizeof(void *));
 	v->max = max;
 	v->off = off;
 	v->cmp = cmp;
@@ -71,10 +81,40 @@ wget_vector_t *wget_vector_create(int max, int off, wget_vector_compare_t cmp)
 
 void wget_vector_deinit(wget_vector_t *v)
 {
-	if(v)
+	if (v && v->entry != v->inline_entry)
 		wget_xfree(v->entry);
 }
 
+// grow the entry array to hold at least <minmax> elements, -1 if the growth policy forbids it
+static int _vec_grow(wget_vector_t *v, int minmax)
+{
+	int newmax = v->max;
+
+	if (newmax >= minmax)
+		return 0;
+
+	do {
+		if (v->off > 0)
+			newmax += v->off;
+		else if (v->off<-1)
+			newmax = newmax ? newmax * -v->off : -v->off;
+		else
+			return -1;
+	} while (newmax < minmax);
+
+	if (v->entry != v->inline_entry) {
+		v->entry = xrealloc(v->entry, newmax * sizeof(void *));
+	} else if (newmax > VEC_INLINE_SIZE) {
+		// outgrown the inline slots, spill to heap
+		v->entry = xmalloc(newmax * sizeof(void *));
+		memcpy(v->entry, v->inline_entry, v->cur * sizeof(void *));
+	} // else the inline storage still has room, just raise <max>
+
+	v->max = newmax;
+
+	return 0;
+}
+
 static int G_GNUC_WGET_NONNULL((2)) _vec_insert_private(wget_vector_t *v, const void *elem, size_t size, int pos, int replace, int alloc)
 {
 	void *elemp;
@@ -89,16 +129,10 @@ static int G_GNUC_WGET_NONNULL((2)) _vec_insert_private(wget_vector_t *v, const
 	}
 
 	if (!replace) {
-		if (v->max == v->cur) {
-			if (v->off > 0) {
-				v->entry = xrealloc(v->entry, (v->max += v->off) * sizeof(void *));
-			} else if (v->off<-1) {
-				v->entry = xrealloc(v->entry, (v->max *= -v->off) * sizeof(void *));
-			} else {
-				if (alloc)
-					free(elemp);
-				return -1;
-			}
+		if (_vec_grow(v, v->cur + 1)) {
+			if (alloc)
+				xfree(elemp);
+			return -1;
 		}
 
 		memmove(&v->entry[pos + 1], &v->entry[pos], (v->cur - pos) * sizeof(void *));
@@ -172,6 +206,72 @@ int wget_vector_insert_sorted_noalloc(wget_vector_t *v, const void *elem)
 	return _vec_insert_sorted_private(v, elem, 0, 0);
 }
 
+static int G_GNUC_WGET_NONNULL_ALL _compare(const void *p1, const void *p2, void *v);
+
+// append a batch of elements and restore sort order with a single merge.
+// the vector takes ownership of the elements (as wget_vector_add_noalloc does).
+// much faster than inserting one by one, where every wget_vector_insert_sorted()
+// pays a binary search plus a memmove over the tail of the array.
+
+int wget_vector_add_batch_sorted(wget_vector_t *v, void **elems, int count)
+{
+	int oldcur;
+
+	if (!v || count <= 0) return -1;
+
+	if (_vec_grow(v, v->cur + count))
+		return -1;
+
+	oldcur = v->cur;
+	memcpy(&v->entry[oldcur], elems, count * sizeof(void *));
+	v->cur += count;
+
+	if (!v->cmp)
+		return v->cur - 1; // unsorted vector, plain append
+
+	if (oldcur && !v->sorted) {
+		// the vector wasn't sorted anyway, sort everything in one go
+		wget_vector_sort(v);
+		return v->cur - 1;
+	}
+
+	qsort_r(&v->entry[oldcur], count, sizeof(void *), _compare, v);
+
+	if (oldcur) {
+		// merge the two sorted runs back to front, the batch run buffered aside
+		void **batch = wget_memdup(&v->entry[oldcur], count * sizeof(void *));
+		int it = oldcur - 1, jt = count - 1, wt = v->cur - 1;
+
+		while (it >= 0 && jt >= 0) {
+			if (v->cmp(v->entry[it], batch[jt]) > 0)
+				v->entry[wt--] = v->entry[it--];
+			else
+				v->entry[wt--] = batch[jt--];
+		}
+		while (jt >= 0)
+			v->entry[wt--] = batch[jt--];
+
+		xfree(batch);
+	}
+
+	v->sorted = 1;
+
+	return v->cur - 1; // return position of last element
+}
+
+// bulk-load constructor: takes ownership of <count> elements and sorts them
+// once at the end instead of keeping the array sorted on every single insert
+
+wget_vector_t *wget_vector_create_sorted(int count, void **elems, wget_vector_compare_t cmp)
+{
+	wget_vector_t *v = wget_vector_create(count > 0 ? count : VEC_INLINE_SIZE, -2, cmp);
+
+	if (elems && count > 0)
+		wget_vector_add_batch_sorted(v, elems, count);
+
+	return v;
+}
+
 int wget_vector_add(wget_vector_t *v, const void *elem, size_t size)
 {
 	return v ? _vec_insert_private(v, elem, size, v->cur, 0, 1) : -1;
@@ -301,7 +401,8 @@ void wget_vector_free(wget_vector_t **v)
 	if (v && *v) {
 		if ((*v)->entry) {
 			wget_vector_clear(*v);
-			xfree((*v)->entry);
+			if ((*v)->entry != (*v)->inline_entry)
+				xfree((*v)->entry);
 		}
 		xfree(*v);
 	}
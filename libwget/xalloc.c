@@ -28,6 +28,11 @@
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef __GLIBC__
+#  include <malloc.h> // malloc_usable_size(), used for free() accounting
+#endif
 
 #include <wget.h>
 #include "private.h"
@@ -49,11 +54,170 @@
  *
  * To work around this behavior, provide your own allocation routines,
  * namely malloc(), calloc(), realloc().
+ *
+ * Optional allocation accounting can be switched on at runtime with
+ * wget_alloc_stats_enable(). It keeps global and per-tag counters so high
+ * RSS can be attributed to a subsystem without an external profiler.
  */
 
 static void
 	(*_oom_callback)(void);
 
+/*
+ * Allocation accounting. Off by default - the only cost then is one
+ * predictable branch per allocation. Counters are updated with relaxed
+ * atomics, a snapshot may be a few operations skewed but is never torn.
+ *
+ * Attribution works via a per-thread tag that subsystems set around their
+ * allocation-heavy paths (see wget_alloc_tag()). Frees carry no tag - with
+ * glibc the freed size is recovered via malloc_usable_size(), elsewhere
+ * only allocation counters are maintained.
+ */
+
+// must match wget_alloc_tag_t slot for slot
+static const char *tag_names[WGET_ALLOC_TAG_MAX] = {
+	"misc",
+	"http",
+	"iri",
+	"cookie",
+	"html",
+	"queue",
+};
+
+static int
+	stats_enabled;
+static long long
+	tag_nallocs[WGET_ALLOC_TAG_MAX],
+	tag_alloc_bytes[WGET_ALLOC_TAG_MAX],
+	total_nfrees,
+	cur_bytes,
+	peak_bytes;
+
+#if defined __GNUC__ || defined __clang__
+static __thread int my_tag; // = WGET_ALLOC_TAG_MISC
+#else
+static int my_tag; // without TLS all threads share one tag - roughly right
+#endif
+
+static void _stats_add(long long *counter, long long value)
+{
+#if defined __GNUC__ || defined __clang__
+	__atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+#else
+	*counter += value;
+#endif
+}
+
+static void _account_alloc(void *ptr, size_t size)
+{
+	long long cur;
+
+#ifdef __GLIBC__
+	size = malloc_usable_size(ptr); // same measure as on free, no drift
+#else
+	(void) ptr;
+#endif
+
+	tag_nallocs[my_tag]++; // owner-tagged, races between tags are negligible
+	_stats_add(&tag_alloc_bytes[my_tag], (long long) size);
+
+#if defined __GNUC__ || defined __clang__
+	cur = __atomic_add_fetch(&cur_bytes, (long long) size, __ATOMIC_RELAXED);
+	for (long long peak = __atomic_load_n(&peak_bytes, __ATOMIC_RELAXED); cur > peak; ) {
+		if (__atomic_compare_exchange_n(&peak_bytes, &peak, cur, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+#else
+	cur = (cur_bytes += (long long) size);
+	if (cur > peak_bytes)
+		peak_bytes = cur;
+#endif
+}
+
+static void _account_free(void *ptr)
+{
+	_stats_add(&total_nfrees, 1);
+#ifdef __GLIBC__
+	_stats_add(&cur_bytes, -(long long) malloc_usable_size(ptr));
+#else
+	(void) ptr; // freed size unknown, cur_bytes/peak_bytes stay zero
+#endif
+}
+
+/**
+ * \param[in] enable 1 to switch allocation accounting on, 0 to switch it off
+ *
+ * Enable or disable the allocation statistics. Counting starts at the moment
+ * of enabling - allocations made before are invisible, so enable it before
+ * the workload of interest (wget2 does so right after option parsing when
+ * called with \--alloc-stats).
+ */
+void wget_alloc_stats_enable(int enable)
+{
+	stats_enabled = !!enable;
+}
+
+/**
+ * \param[in] tag The subsystem tag for following allocations of this thread
+ * \return The previously set tag
+ *
+ * Attribute subsequent allocations of the calling thread to \p tag.
+ * Set around an allocation-heavy path and restore the returned value
+ * afterwards, so nested tagged sections stay correct:
+ *
+ *     int old_tag = wget_alloc_tag(WGET_ALLOC_TAG_IRI);
+ *     ...
+ *     wget_alloc_tag(old_tag);
+ */
+int wget_alloc_tag(wget_alloc_tag_t tag)
+{
+	int old_tag = my_tag;
+
+	if ((unsigned) tag < WGET_ALLOC_TAG_MAX)
+		my_tag = tag;
+
+	return old_tag;
+}
+
+/**
+ * \param[in] tag A tag from wget_alloc_tag_t, or -1 for the global totals
+ * \param[out] stats Filled with the current counter values
+ *
+ * Query the allocation statistics. Per-tag queries fill \p nallocs and
+ * \p alloc_bytes only; frees cannot be attributed to a tag, so \p nfrees,
+ * \p cur_bytes and \p peak_bytes are maintained globally.
+ */
+void wget_alloc_stats_get(int tag, wget_alloc_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (tag >= 0 && tag < WGET_ALLOC_TAG_MAX) {
+		stats->nallocs = tag_nallocs[tag];
+		stats->alloc_bytes = tag_alloc_bytes[tag];
+		return;
+	}
+
+	for (int it = 0; it < WGET_ALLOC_TAG_MAX; it++) {
+		stats->nallocs += tag_nallocs[it];
+		stats->alloc_bytes += tag_alloc_bytes[it];
+	}
+	stats->nfrees = total_nfrees;
+	stats->cur_bytes = cur_bytes;
+	stats->peak_bytes = peak_bytes;
+}
+
+/**
+ * \param[in] tag A tag from wget_alloc_tag_t
+ * \return The human-readable name of \p tag
+ */
+const char *wget_alloc_tag_name(wget_alloc_tag_t tag)
+{
+	if ((unsigned) tag < WGET_ALLOC_TAG_MAX)
+		return tag_names[tag];
+
+	return "unknown";
+}
+
 static void G_GNUC_WGET_NORETURN _no_memory(void)
 {
 	if (_oom_callback)
@@ -62,6 +226,168 @@ static void G_GNUC_WGET_NORETURN _no_memory(void)
 	exit(EXIT_FAILURE);
 }
 
+/*
+ * Scoped arenas. A parser that makes thousands of small allocations which
+ * all die together can push an arena: until the matching pop, allocations
+ * of the calling thread are bump-allocated from malloc'ed chunks, freeing
+ * arena memory is a no-op and wget_arena_free() returns everything with a
+ * handful of free() calls instead of thousands.
+ *
+ * The memory may outlive the scope - pop the arena and hand it to the
+ * object that owns the allocations. From then on the memory must only be
+ * released as a whole via wget_arena_free(); freeing single arena pointers
+ * after the pop is undefined. Allocations that escape to another thread
+ * while the scope is active (e.g. queued log messages) must bypass
+ * wget_malloc().
+ *
+ * Without thread-local storage arenas are disabled: wget_arena_push()
+ * returns NULL, allocations stay on malloc() and callers keep their
+ * conventional cleanup path.
+ */
+
+typedef struct _arena_chunk_st _arena_chunk_t;
+struct _arena_chunk_st {
+	_arena_chunk_t
+		*next;
+	size_t
+		used,
+		size;
+	// chunk data follows
+};
+
+struct _wget_arena_st {
+	_arena_chunk_t
+		*chunks;
+	wget_arena_t
+		*prev; // next-outer scope of the owning thread
+	size_t
+		chunk_size;
+};
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16 // covers every type the parsers allocate
+#define ARENA_HDR ARENA_ALIGN // per-allocation size header, keeps the data aligned
+
+#if defined __GNUC__ || defined __clang__
+# define HAVE_ARENAS 1
+static __thread wget_arena_t *cur_arena; // innermost active scope of this thread
+
+static void *_arena_alloc(wget_arena_t *arena, size_t size)
+{
+	size_t need = ARENA_HDR + ((size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1));
+	_arena_chunk_t *chunk = arena->chunks;
+
+	if (!chunk || chunk->size - chunk->used < need) {
+		size_t chunk_size = need > arena->chunk_size ? need : arena->chunk_size;
+
+		if (!(chunk = malloc(sizeof(_arena_chunk_t) + chunk_size)))
+			_no_memory();
+		if (stats_enabled)
+			_account_alloc(chunk, sizeof(_arena_chunk_t) + chunk_size);
+
+		chunk->next = arena->chunks;
+		chunk->used = 0;
+		chunk->size = chunk_size;
+		arena->chunks = chunk;
+	}
+
+	char *p = (char *) (chunk + 1) + chunk->used;
+	chunk->used += need;
+	*(size_t *) p = size; // realloc needs the old size
+
+	return p + ARENA_HDR;
+}
+
+// The arena 'ptr' was allocated from, if the calling thread has it pushed
+static wget_arena_t *_arena_owner(const void *ptr)
+{
+	for (wget_arena_t *arena = cur_arena; arena; arena = arena->prev) {
+		for (_arena_chunk_t *chunk = arena->chunks; chunk; chunk = chunk->next) {
+			const char *data = (const char *) (chunk + 1);
+
+			if ((const char *) ptr >= data && (const char *) ptr < data + chunk->used)
+				return arena;
+		}
+	}
+
+	return NULL;
+}
+#endif
+
+/**
+ * \param[in] resume An arena returned by a previous wget_arena_pop() to continue filling, or %NULL to start a new one
+ * \return The active arena, or %NULL if arenas are unsupported on this platform
+ *
+ * Begin an arena scope on the calling thread. Until the matching
+ * wget_arena_pop(), wget_malloc() and friends bump-allocate from the arena
+ * and freeing arena memory is a no-op. Scopes nest per thread.
+ */
+wget_arena_t *wget_arena_push(wget_arena_t *resume)
+{
+#ifdef HAVE_ARENAS
+	wget_arena_t *arena = resume;
+
+	if (!arena) {
+		if (!(arena = malloc(sizeof(wget_arena_t))))
+			_no_memory();
+		arena->chunks = NULL;
+		arena->chunk_size = ARENA_CHUNK_SIZE;
+	}
+
+	arena->prev = cur_arena;
+	cur_arena = arena;
+
+	return arena;
+#else
+	(void) resume;
+	return NULL; // no TLS - allocations stay on malloc(), callers free conventionally
+#endif
+}
+
+/**
+ * \return The arena that was active, or %NULL
+ *
+ * End the innermost arena scope of the calling thread. The handle stays
+ * valid - keep it with the object owning the allocations and release
+ * everything at once with wget_arena_free().
+ */
+wget_arena_t *wget_arena_pop(void)
+{
+#ifdef HAVE_ARENAS
+	wget_arena_t *arena = cur_arena;
+
+	if (arena) {
+		cur_arena = arena->prev;
+		arena->prev = NULL;
+	}
+
+	return arena;
+#else
+	return NULL;
+#endif
+}
+
+/**
+ * \param[in] arena Pointer to an arena handle, gets set to %NULL
+ *
+ * Release all memory of a popped arena in one sweep.
+ */
+void wget_arena_free(wget_arena_t **arena)
+{
+	if (!arena || !*arena)
+		return;
+
+	for (_arena_chunk_t *chunk = (*arena)->chunks, *next; chunk; chunk = next) {
+		next = chunk->next;
+		if (stats_enabled)
+			_account_free(chunk);
+		free(chunk);
+	}
+
+	free(*arena);
+	*arena = NULL;
+}
+
 /**
  * \param[in] oom_callback Pointer to your custom out-of-memory function
  *
@@ -82,9 +408,16 @@ void wget_set_oomfunc(void (*oom_callback)(void))
  */
 void *wget_malloc(size_t size)
 {
+#ifdef HAVE_ARENAS
+	if (unlikely(cur_arena != NULL))
+		return _arena_alloc(cur_arena, size);
+#endif
+
 	void *p = malloc(size);
 	if (!p)
 		_no_memory();
+	if (stats_enabled)
+		_account_alloc(p, size);
 	return p;
 }
 
@@ -99,9 +432,16 @@ void *wget_malloc(size_t size)
  */
 void *wget_calloc(size_t nmemb, size_t size)
 {
+#ifdef HAVE_ARENAS
+	if (unlikely(cur_arena != NULL))
+		return memset(_arena_alloc(cur_arena, nmemb * size), 0, nmemb * size);
+#endif
+
 	void *p = calloc(nmemb, size);
 	if (!p)
 		_no_memory();
+	if (stats_enabled)
+		_account_alloc(p, nmemb * size);
 	return p;
 }
 
@@ -121,9 +461,30 @@ void *wget_realloc(void *ptr, size_t size)
 	if (!size)
 		_no_memory();
 
+#ifdef HAVE_ARENAS
+	if (unlikely(cur_arena != NULL)) {
+		wget_arena_t *owner = ptr ? _arena_owner(ptr) : cur_arena;
+
+		if (owner) {
+			p = _arena_alloc(owner, size);
+			if (ptr) {
+				size_t old_size = *(size_t *) ((char *) ptr - ARENA_HDR);
+				memcpy(p, ptr, old_size < size ? old_size : size);
+			}
+			return p;
+		}
+	}
+#endif
+
+	if (stats_enabled && ptr)
+		_account_free(ptr); // a realloc counts as free + alloc
+
 	if (!(p = realloc(ptr, size)))
 		_no_memory();
 
+	if (stats_enabled)
+		_account_alloc(p, size);
+
 	return p;
 }
 
@@ -140,6 +501,14 @@ void *wget_realloc(void *ptr, size_t size)
  */
 void wget_free(void *ptr)
 {
+#ifdef HAVE_ARENAS
+	if (unlikely(cur_arena != NULL) && ptr && _arena_owner(ptr))
+		return; // released in one sweep by wget_arena_free()
+#endif
+
+	if (stats_enabled && ptr)
+		_account_free(ptr);
+
 	free(ptr);
 }
 
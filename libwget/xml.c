@@ -56,7 +56,8 @@ typedef struct {
 		hints; // XML_HINT...
 	size_t
 		token_size, // size of token buffer
-		token_len; // used bytes of token buffer (not counting terminating 0 byte)
+		token_len, // used bytes of token buffer (not counting terminating 0 byte)
+		buf_offset; // offset of 'buf' within the complete document (streaming mode)
 	void
 		*user_ctx; // user context (not needed if we were using nested functions)
 	wget_xml_callback_t
@@ -68,8 +69,16 @@ typedef struct {
 
 // working only for consecutive alphabets, e.g. EBCDIC would not work
 #define ascii_isalpha(c) ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+
+// the whitespace set matching ascii_isspace(), for strspn()/strcspn()
+#define ascii_spaces " \t\n\v\f\r"
 /* \endcond */
 
+// The scan loops below lean on strspn/strcspn/strchr/strstr/memchr instead of
+// advancing one character at a time: libc implements these with vectorized
+// (SIMD) delimiter search on all relevant platforms, and the inter-tag and
+// attribute-value stretches they skip over are the bulk of real documents.
+
 // append a char to token buffer
 
 static const char *getToken(_xml_context *context)
@@ -78,17 +87,15 @@ static const char *getToken(_xml_context *context)
 	const char *p;
 
 	// skip leading whitespace
-	while ((c = *context->p) && ascii_isspace(c))
-		context->p++;
-	if (!c) return NULL;
+	context->p += strspn(context->p, ascii_spaces);
+	if (!(c = *context->p)) return NULL;
 	context->token = context->p++;
 
 //	info_printf("a c=%c\n", c);
 
 	if (ascii_isalpha(c) || c == '_') {
-		while ((c = *context->p) && !ascii_isspace(c) && c != '>' && c != '=')
-			context->p++;
-		if (!c) return NULL;
+		context->p += strcspn(context->p, ascii_spaces ">=");
+		if (!*context->p) return NULL;
 		context->token_len = context->p - context->token;
 		return context->token;
 	}
@@ -183,10 +190,9 @@ static const char *getToken(_xml_context *context)
 		}
 	}
 
-	while ((c = *context->p) && !ascii_isspace(c))
-		context->p++;
+	context->p += strcspn(context->p, ascii_spaces);
 
-	if (c) {
+	if (*context->p) {
 		context->token_len = context->p - context->token;
 		return context->token;
 	}
@@ -202,9 +208,8 @@ static int getValue(_xml_context *context)
 	context->token = context->p;
 
 	// remove leading spaces
-	while ((c = *context->p) && ascii_isspace(c))
-		context->p++;
-	if (!c) return EOF;
+	context->p += strspn(context->p, ascii_spaces);
+	if (!(c = *context->p)) return EOF;
 
 	if (c == '=') {
 		context->p++;
@@ -226,19 +231,26 @@ static int getValue(_xml_context *context)
 static const char *getScriptContent(_xml_context *context)
 {
 	int comment = 0, length_valid = 0;
-	const char *p;
+	const char *p, *q;
 
-	for (p = context->token = context->p; *p; p++) {
+	for (p = context->token = context->p; *p; ) {
 		if (comment) {
-			if (*p == '-' && !strncmp(p, "-->", 3)) {
-				p += 3 - 1;
-				comment = 0;
+			if (!(q = strstr(p, "-->"))) {
+				p += strlen(p);
+				break;
 			}
+			p = q + 3;
+			comment = 0;
 		} else {
-			if (*p == '<' && !strncmp(p, "<!--", 4)) {
-				p += 4 - 1;
+			if (!(q = strchr(p, '<'))) {
+				p += strlen(p);
+				break;
+			}
+			p = q;
+			if (!strncmp(p, "<!--", 4)) {
+				p += 4;
 				comment = 1;
-			} else if (*p == '<' && !wget_strncasecmp_ascii(p, "</script", 8)) {
+			} else if (!wget_strncasecmp_ascii(p, "</script", 8)) {
 				context->token_len = p - context->token;
 				length_valid = 1;
 				for (p += 8; ascii_isspace(*p); p++);
@@ -247,7 +259,9 @@ static const char *getScriptContent(_xml_context *context)
 					break; // found end of <script>
 				} else if (!*p)
 					break; // end of input
-			}
+				p++; // '</script' followed by more name characters - still script content
+			} else
+				p++;
 		}
 	}
 	context->p = p;
@@ -259,7 +273,7 @@ static const char *getScriptContent(_xml_context *context)
 		return NULL;
 
 	if (context->callback)
-		context->callback(context->user_ctx, XML_FLG_CONTENT | XML_FLG_END, "script", NULL, context->token, context->token_len, context->token - context->buf);
+		context->callback(context->user_ctx, XML_FLG_CONTENT | XML_FLG_END, "script", NULL, context->token, context->token_len, context->token - context->buf + context->buf_offset);
 
 	return context->token;
 }
@@ -269,13 +283,20 @@ static const char *getUnparsed(_xml_context *context, int flags, const char *end
 	int c;
 
 	if (len == 1) {
-		for (context->token = context->p; (c = *context->p) && c != *end; context->p++);
+		const char set[2] = { *end, 0 };
+
+		context->token = context->p;
+		context->p += strcspn(context->p, set);
+		c = *context->p;
 	} else {
-		for (context->token = context->p; (c = *context->p); context->p++) {
-			if (c == *end && context->p[1] == end[1] && (len == 2 || context->p[2] == end[2])) {
-				break;
-			}
-		}
+		const char *q;
+
+		context->token = context->p;
+		if ((q = strstr(context->p, end)))
+			context->p = q;
+		else
+			context->p += strlen(context->p);
+		c = *context->p;
 	}
 
 	context->token_len = context->p - context->token;
@@ -306,7 +327,7 @@ static const char *getUnparsed(_xml_context *context, int flags, const char *end
 	} else {
 */
 	if (context->callback)
-		context->callback(context->user_ctx, flags, directory, NULL, context->token, context->token_len, context->token - context->buf);
+		context->callback(context->user_ctx, flags, directory, NULL, context->token, context->token_len, context->token - context->buf + context->buf_offset);
 
 //	}
 
@@ -332,7 +353,9 @@ static const char *getContent(_xml_context *context, const char *directory)
 {
 	int c;
 
-		for (context->token = context->p; (c = *context->p) && c != '<'; context->p++);
+	context->token = context->p;
+	context->p += strcspn(context->p, "<");
+	c = *context->p;
 
 	context->token_len = context->p - context->token;
 
@@ -341,7 +364,7 @@ static const char *getContent(_xml_context *context, const char *directory)
 
 	// debug_printf("content=%.*s\n", (int)context->token_len, context->token);
 	if (context->callback && context->token_len)
-		context->callback(context->user_ctx, XML_FLG_CONTENT, directory, NULL, context->token, context->token_len, context->token - context->buf);
+		context->callback(context->user_ctx, XML_FLG_CONTENT, directory, NULL, context->token, context->token_len, context->token - context->buf + context->buf_offset);
 
 	return context->token;
 }
@@ -425,7 +448,7 @@ static void parseXML(const char *dir, _xml_context *context)
 					if (context->token_len) {
 						debug_printf("%s/@%s=%.*s\n", directory, attribute, (int)context->token_len, context->token);
 						if (context->callback)
-							context->callback(context->user_ctx, flags | XML_FLG_ATTRIBUTE, directory, attribute, context->token, context->token_len, context->token - context->buf);
+							context->callback(context->user_ctx, flags | XML_FLG_ATTRIBUTE, directory, attribute, context->token, context->token_len, context->token - context->buf + context->buf_offset);
 					} else {
 						debug_printf("%s/@%s\n", directory, attribute);
 						if (context->callback)
@@ -496,17 +519,19 @@ static void parseXML(const char *dir, _xml_context *context)
  *
  * %XML_HINT_HTML turns on HTML scanning.
  */
-void wget_xml_parse_buffer(
+static void _xml_parse_buffer(
 	const char *buf,
 	wget_xml_callback_t callback,
 	void *user_ctx,
-	int hints)
+	int hints,
+	size_t buf_offset)
 {
 	_xml_context context;
 
 	context.token = NULL;
 	context.token_size = 0;
 	context.token_len = 0;
+	context.buf_offset = buf_offset;
 	context.buf = buf;
 	context.p = buf;
 	context.user_ctx = user_ctx;
@@ -516,6 +541,15 @@ void wget_xml_parse_buffer(
 	parseXML("/", &context);
 }
 
+void wget_xml_parse_buffer(
+	const char *buf,
+	wget_xml_callback_t callback,
+	void *user_ctx,
+	int hints)
+{
+	_xml_parse_buffer(buf, callback, user_ctx, hints, 0);
+}
+
 /**
  * \param[in] buf Zero-terminated HTML input data
  * \param[in] callback Function called for each token scan result
@@ -533,6 +567,305 @@ void wget_html_parse_buffer(
 	wget_xml_parse_buffer(buf, callback, user_ctx, hints | XML_HINT_HTML);
 }
 
+// Streaming (chunk-wise) parsing.
+//
+// The tokenizer above needs the complete construct it looks at in memory, so
+// feeding arbitrary chunks directly would truncate tokens at chunk boundaries.
+// Instead we buffer the unparsed tail and scan it with a small state machine
+// that finds 'cut points': positions where the parser is between constructs
+// (plain content, right before a '<'). Everything before the last cut point is
+// handed to the parser, the rest is kept for the next feed. Only comments,
+// tags, <script> and <style> elements are held back as a whole, so the kept
+// tail stays small for typical documents.
+//
+// Restarting the parser at a cut point is loss-free for HTML (tags are
+// reported context-free), for XML the element path of tokens after a cut
+// restarts at the root - use this API for XML only if your callback doesn't
+// depend on the full path.
+
+// scanner states, mirroring the constructs parseXML distinguishes
+typedef enum {
+	SCAN_CONTENT,    // plain text, any position is behind a complete construct
+	SCAN_TAG,        // inside <...>
+	SCAN_QUOTE,      // inside a quoted attribute value
+	SCAN_COMMENT,    // inside <!-- -->
+	SCAN_PROCESSING, // inside <? ?>
+	SCAN_SPECIAL,    // inside <! >
+	SCAN_SCRIPT,     // inside <script> content (incl. comments)
+	SCAN_SCRIPT_END, // seen </script, skipping whitespace before '>'
+	SCAN_STYLE       // inside <style> content
+} _scan_state_t;
+
+struct _wget_xml_stream_st {
+	wget_buffer_t
+		buf; // unparsed tail of the input
+	wget_xml_callback_t
+		callback;
+	void
+		*user_ctx;
+	int
+		hints;
+	size_t
+		offset, // bytes of the document already parsed away (= document offset of buf.data[0])
+		scanned, // bytes of 'buf' the cut scanner already consumed
+		cut; // best known cut position within 'buf'
+	_scan_state_t
+		state;
+	char
+		quote, // quote character that ends SCAN_QUOTE
+		script_comment, // inside <!-- --> within <script> content
+		tag_start, // set while reading the first chars of a tag name
+		tag[8]; // lowercased start of the current tag name (for script/style detection)
+	unsigned int
+		tag_len;
+};
+
+// advance the scanner over the yet unscanned part of stream->buf and
+// remember the last safe cut position.
+// We may stop short of buf.length: some transitions need a few bytes of
+// lookahead which might only arrive with the next chunk.
+
+static void _stream_scan(wget_xml_stream_t *stream)
+{
+	const char *data = stream->buf.data;
+	size_t len = stream->buf.length;
+	size_t it = stream->scanned;
+	int html = stream->hints & XML_HINT_HTML;
+
+	while (it < len) {
+		char c = data[it];
+
+		switch (stream->state) {
+		case SCAN_CONTENT:
+		case SCAN_STYLE:
+			if (c != '<') {
+				const char *q = memchr(data + it, '<', len - it);
+				it = q ? (size_t) (q - data) : len;
+				break;
+			}
+			if (it + 4 > len)
+				goto out; // not enough lookahead to classify '<...'
+			stream->cut = it; // everything before '<' can be parsed
+			if (!strncmp(data + it, "<!--", 4)) {
+				stream->state = SCAN_COMMENT;
+				it += 4;
+			} else if (data[it + 1] == '?') {
+				stream->state = SCAN_PROCESSING;
+				it += 2;
+			} else if (data[it + 1] == '!') {
+				stream->state = SCAN_SPECIAL;
+				it += 2;
+			} else {
+				stream->state = SCAN_TAG;
+				stream->tag_start = 1;
+				stream->tag_len = 0;
+				it += data[it + 1] == '/' ? 2 : 1; // uniform: an end tag never opens script/style
+			}
+			break;
+		case SCAN_TAG:
+			if (stream->tag_start) {
+				if (ascii_isalpha(c) && stream->tag_len < sizeof(stream->tag) - 1) {
+					stream->tag[stream->tag_len++] = c | 0x20;
+					it++;
+					break;
+				}
+				stream->tag[stream->tag_len] = 0;
+				stream->tag_start = 0;
+			}
+			if (c == '\"' || c == '\'') {
+				stream->state = SCAN_QUOTE;
+				stream->quote = c;
+			} else if (c == '>') {
+				if (html && it && data[it - 1] != '/' && !strcmp(stream->tag, "script")) {
+					stream->state = SCAN_SCRIPT;
+					stream->script_comment = 0;
+				} else if (html && it && data[it - 1] != '/' && !strcmp(stream->tag, "style"))
+					stream->state = SCAN_STYLE;
+				else
+					stream->state = SCAN_CONTENT;
+			}
+			it++;
+			break;
+		case SCAN_QUOTE:
+			if (c == stream->quote) {
+				stream->state = SCAN_TAG;
+				it++;
+			} else {
+				const char *q = memchr(data + it, stream->quote, len - it);
+				it = q ? (size_t) (q - data) : len;
+			}
+			break;
+		case SCAN_COMMENT:
+			if (c == '-') {
+				if (it + 3 > len)
+					goto out;
+				if (!strncmp(data + it, "-->", 3)) {
+					stream->state = SCAN_CONTENT;
+					it += 3;
+					break;
+				}
+				it++;
+			} else {
+				const char *q = memchr(data + it, '-', len - it);
+				it = q ? (size_t) (q - data) : len;
+			}
+			break;
+		case SCAN_PROCESSING:
+			if (c == '?') {
+				if (it + 2 > len)
+					goto out;
+				if (data[it + 1] == '>') {
+					stream->state = SCAN_CONTENT;
+					it += 2;
+					break;
+				}
+				it++;
+			} else {
+				const char *q = memchr(data + it, '?', len - it);
+				it = q ? (size_t) (q - data) : len;
+			}
+			break;
+		case SCAN_SPECIAL:
+			if (c == '>') {
+				stream->state = SCAN_CONTENT;
+				it++;
+			} else {
+				const char *q = memchr(data + it, '>', len - it);
+				it = q ? (size_t) (q - data) : len;
+			}
+			break;
+		case SCAN_SCRIPT:
+			if (stream->script_comment) {
+				if (c == '-') {
+					if (it + 3 > len)
+						goto out;
+					if (!strncmp(data + it, "-->", 3)) {
+						stream->script_comment = 0;
+						it += 3;
+						break;
+					}
+					it++;
+				} else {
+					const char *q = memchr(data + it, '-', len - it);
+					it = q ? (size_t) (q - data) : len;
+				}
+				break;
+			}
+			if (c == '<') {
+				if (it + 8 > len)
+					goto out;
+				if (!strncmp(data + it, "<!--", 4)) {
+					stream->script_comment = 1;
+					it += 4;
+					break;
+				}
+				if (!wget_strncasecmp_ascii(data + it, "</script", 8)) {
+					stream->state = SCAN_SCRIPT_END;
+					it += 8;
+					break;
+				}
+				it++;
+			} else {
+				const char *q = memchr(data + it, '<', len - it);
+				it = q ? (size_t) (q - data) : len;
+			}
+			break;
+		case SCAN_SCRIPT_END:
+			if (ascii_isspace(c))
+				it++;
+			else if (c == '>') {
+				stream->state = SCAN_CONTENT;
+				it++;
+			} else
+				stream->state = SCAN_SCRIPT; // '</script' followed by more name chars - still script content
+			break;
+		}
+	}
+
+out:
+	if (stream->state == SCAN_CONTENT)
+		stream->cut = it; // splitting plain content is harmless
+	stream->scanned = it;
+}
+
+/**
+ * \param[in] callback Function called for each token scan result
+ * \param[in] user_ctx User-defined context variable, handed to \p callback
+ * \param[in] hints Flags to influence parsing, see wget_xml_parse_buffer()
+ * \return New streaming parser instance
+ *
+ * Sets up parsing input that arrives chunk-wise, e.g. from a network stream.
+ * Feed the chunks with wget_xml_stream_feed() as they arrive and finish with
+ * wget_xml_stream_close() - the callback sees the same tokens as a
+ * wget_xml_parse_buffer() of the complete document would emit, while only a
+ * small unparsed tail is buffered.
+ *
+ * The \p pos values reported to \p callback are offsets into the complete
+ * document, but the token pointers are only valid during the feed that
+ * emits them.
+ */
+wget_xml_stream_t *wget_xml_stream_init(wget_xml_callback_t callback, void *user_ctx, int hints)
+{
+	wget_xml_stream_t *stream = wget_calloc(1, sizeof(wget_xml_stream_t));
+
+	wget_buffer_init(&stream->buf, NULL, 4096);
+	stream->callback = callback;
+	stream->user_ctx = user_ctx;
+	stream->hints = hints;
+	stream->state = SCAN_CONTENT;
+
+	return stream;
+}
+
+/**
+ * \param[in] stream Streaming parser instance created by wget_xml_stream_init()
+ * \param[in] data Next chunk of input data
+ * \param[in] len Length of \p data
+ *
+ * Appends \p data to the parser's input and parses as far as the data allows.
+ * The callback is invoked from within this call for each completely received token.
+ */
+void wget_xml_stream_feed(wget_xml_stream_t *stream, const char *data, size_t len)
+{
+	wget_buffer_memcat(&stream->buf, data, len);
+
+	_stream_scan(stream);
+
+	if (stream->cut) {
+		size_t cut = stream->cut;
+		char *p = stream->buf.data;
+		char saved = p[cut];
+
+		p[cut] = 0;
+		_xml_parse_buffer(p, stream->callback, stream->user_ctx, stream->hints, stream->offset);
+		p[cut] = saved;
+
+		memmove(p, p + cut, stream->buf.length - cut);
+		stream->buf.length -= cut;
+		p[stream->buf.length] = 0;
+		stream->offset += cut;
+		stream->scanned -= cut;
+		stream->cut = 0;
+	}
+}
+
+/**
+ * \param[in] stream Pointer to a streaming parser instance, set to NULL by this call
+ *
+ * Parses whatever input is still buffered and frees the parser.
+ */
+void wget_xml_stream_close(wget_xml_stream_t **stream)
+{
+	if (!stream || !*stream)
+		return;
+
+	if ((*stream)->buf.length)
+		_xml_parse_buffer((*stream)->buf.data, (*stream)->callback, (*stream)->user_ctx, (*stream)->hints, (*stream)->offset);
+
+	wget_buffer_deinit(&(*stream)->buf);
+	xfree(*stream);
+}
+
 /**
  * \param[in] fname Name of XML or HTML input file
  * \param[in] callback Function called for each token scan result
@@ -33,13 +33,42 @@
 #include <wget.h>
 
 #include "wget_main.h"
+#include "wget_options.h"
 #include "wget_blacklist.h"
 
+// Every URL of a recursive crawl passes through the blacklist, so it is
+// sharded: each shard is an own hashmap under an own mutex, selected by the
+// IRI hash, so the downloader threads rarely contend on the same lock.
+#define BLACKLIST_SHARDS 16 // power of 2
+
+// Bloom filter in front of the shards: 2^25 bits (4 MiB), two bit positions
+// per IRI. It has no false negatives, so "definitely not seen" skips the
+// hashmap lookup - the common case when crawling new ground.
+#define BLOOM_BITS (1U << 25)
+#define BLOOM_WORD_BITS (8 * sizeof(unsigned long))
+
+// With --compact-blacklist each entry is a 128-bit digest of the normalized
+// URI instead of a full wget_iri_t - 16 bytes instead of hundreds. IRIs that
+// become jobs are kept in a side set ('retained') since jobs, hosts and
+// referers point into them; rejected IRIs are given back via
+// blacklist_release() and freed right away.
+#define BLACKLIST_DIGEST_SIZE 16
+
 static wget_hashmap_t
-	*blacklist;
+	*blacklist[BLACKLIST_SHARDS],
+	*blacklist_digests[BLACKLIST_SHARDS],
+	*retained;
 
 static wget_thread_mutex_t
-	mutex = WGET_THREAD_MUTEX_INITIALIZER;
+	mutex[BLACKLIST_SHARDS] = { [0 ... BLACKLIST_SHARDS - 1] = WGET_THREAD_MUTEX_INITIALIZER },
+	retained_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static unsigned long
+	*bloom;
+
+static long long
+	bloom_hits, // bloom said 'maybe seen', the shard hashmap was consulted
+	bloom_misses; // bloom said 'definitely not seen'
 
 // Paul Larson's hash function from Microsoft Research
 // ~ O(1) insertion, search and removal
@@ -66,6 +95,58 @@ static unsigned int G_GNUC_WGET_NONNULL_ALL hash_iri(const wget_iri_t *iri)
 	return h;
 }
 
+static void _bloom_init(void)
+{
+	unsigned long *p = wget_calloc(BLOOM_BITS / BLOOM_WORD_BITS, sizeof(unsigned long));
+
+	if (!__sync_bool_compare_and_swap(&bloom, NULL, p))
+		xfree(p); // another thread was faster
+}
+
+// two bit positions per IRI, the second index derived by scrambling the hash
+static int _bloom_maybe_seen(unsigned int h)
+{
+	unsigned int h2 = (h * 0x9E3779B9u) >> 7;
+	unsigned int b1 = h & (BLOOM_BITS - 1), b2 = h2 & (BLOOM_BITS - 1);
+
+	return ((bloom[b1 / BLOOM_WORD_BITS] >> (b1 % BLOOM_WORD_BITS)) & 1)
+		&& ((bloom[b2 / BLOOM_WORD_BITS] >> (b2 % BLOOM_WORD_BITS)) & 1);
+}
+
+// atomic bit set - concurrent adds from different shards may share a word
+static void _bloom_set(unsigned int h)
+{
+	unsigned int h2 = (h * 0x9E3779B9u) >> 7;
+	unsigned int b1 = h & (BLOOM_BITS - 1), b2 = h2 & (BLOOM_BITS - 1);
+
+	__sync_fetch_and_or(&bloom[b1 / BLOOM_WORD_BITS], 1UL << (b1 % BLOOM_WORD_BITS));
+	__sync_fetch_and_or(&bloom[b2 / BLOOM_WORD_BITS], 1UL << (b2 % BLOOM_WORD_BITS));
+}
+
+static unsigned int _digest_hash(const unsigned char *digest)
+{
+	unsigned int h;
+
+	memcpy(&h, digest, sizeof(h)); // the digest is uniform, any 4 bytes do
+
+	return h;
+}
+
+static int _digest_compare(const unsigned char *d1, const unsigned char *d2)
+{
+	return memcmp(d1, d2, BLACKLIST_DIGEST_SIZE);
+}
+
+static unsigned int _ptr_hash(const void *p)
+{
+	return (unsigned int) ((uintptr_t) p >> 4);
+}
+
+static int _ptr_compare(const void *p1, const void *p2)
+{
+	return p1 != p2;
+}
+
 static int G_GNUC_WGET_NONNULL_ALL _blacklist_print(G_GNUC_WGET_UNUSED void *ctx, const wget_iri_t *iri)
 {
 	debug_printf("blacklist %s\n", iri->uri);
@@ -74,14 +155,64 @@ static int G_GNUC_WGET_NONNULL_ALL _blacklist_print(G_GNUC_WGET_UNUSED void *ctx
 
 void blacklist_print(void)
 {
-	wget_thread_mutex_lock(&mutex);
-	wget_hashmap_browse(blacklist, (wget_hashmap_browse_t)_blacklist_print, NULL);
-	wget_thread_mutex_unlock(&mutex);
+	for (int shard = 0; shard < BLACKLIST_SHARDS; shard++) {
+		wget_thread_mutex_lock(&mutex[shard]);
+		wget_hashmap_browse(blacklist[shard], (wget_hashmap_browse_t)_blacklist_print, NULL);
+		wget_thread_mutex_unlock(&mutex[shard]);
+	}
+
+	// in compact mode only the retained (job-bound) IRIs are known by name
+	wget_thread_mutex_lock(&retained_mutex);
+	wget_hashmap_browse(retained, (wget_hashmap_browse_t)_blacklist_print, NULL);
+	wget_thread_mutex_unlock(&retained_mutex);
 }
 
 int blacklist_size(void)
 {
-	return wget_hashmap_size(blacklist);
+	int size = 0;
+
+	for (int shard = 0; shard < BLACKLIST_SHARDS; shard++)
+		size += wget_hashmap_size(blacklist[shard]) + wget_hashmap_size(blacklist_digests[shard]);
+
+	return size;
+}
+
+void blacklist_stats(long long *hits, long long *misses)
+{
+	*hits = bloom_hits;
+	*misses = bloom_misses;
+}
+
+struct _browse_context {
+	int (*browse)(void *ctx, const wget_iri_t *iri);
+	void *ctx;
+};
+
+static int _blacklist_browse_entry(struct _browse_context *bctx, const wget_iri_t *iri)
+{
+	return bctx->browse(bctx->ctx, iri);
+}
+
+// iterate all blacklisted IRIs, stops (and returns non-zero) if the callback returns non-zero
+int blacklist_browse(int (*browse)(void *ctx, const wget_iri_t *iri), void *ctx)
+{
+	struct _browse_context bctx = { .browse = browse, .ctx = ctx };
+	int rc = 0;
+
+	for (int shard = 0; shard < BLACKLIST_SHARDS && !rc; shard++) {
+		wget_thread_mutex_lock(&mutex[shard]);
+		rc = wget_hashmap_browse(blacklist[shard], (wget_hashmap_browse_t)_blacklist_browse_entry, &bctx);
+		wget_thread_mutex_unlock(&mutex[shard]);
+	}
+
+	// in compact mode only the retained (job-bound) IRIs are known by name
+	if (!rc) {
+		wget_thread_mutex_lock(&retained_mutex);
+		rc = wget_hashmap_browse(retained, (wget_hashmap_browse_t)_blacklist_browse_entry, &bctx);
+		wget_thread_mutex_unlock(&retained_mutex);
+	}
+
+	return rc;
 }
 
 static void _free_entry(wget_iri_t *iri)
@@ -89,27 +220,93 @@ static void _free_entry(wget_iri_t *iri)
 	wget_iri_free(&iri);
 }
 
+// remember an IRI handed out in compact mode, so blacklist_free() can
+// reclaim whatever the crawl still references at exit
+static void _retain(wget_iri_t *iri)
+{
+	wget_thread_mutex_lock(&retained_mutex);
+
+	if (!retained) {
+		retained = wget_hashmap_create(128, (wget_hashmap_hash_t)_ptr_hash, (wget_hashmap_compare_t)_ptr_compare);
+		wget_hashmap_set_key_destructor(retained, (wget_hashmap_key_destructor_t)_free_entry);
+	}
+
+	wget_hashmap_put_noalloc(retained, iri, NULL);
+
+	wget_thread_mutex_unlock(&retained_mutex);
+}
+
+// Give back an IRI that did not become a job. In compact mode the blacklist
+// only keeps its digest, so the IRI itself can be freed right away.
+// A no-op in full-IRI mode, where the blacklist owns all added IRIs.
+void blacklist_release(wget_iri_t **iri)
+{
+	if (!config.compact_blacklist || !iri || !*iri)
+		return;
+
+	wget_thread_mutex_lock(&retained_mutex);
+	wget_hashmap_remove_nofree(retained, *iri);
+	wget_thread_mutex_unlock(&retained_mutex);
+
+	wget_iri_free(iri);
+}
+
 wget_iri_t *blacklist_add(wget_iri_t *iri)
 {
 	if (!iri)
 		return NULL;
 
 	if (wget_iri_supported(iri)) {
-		wget_thread_mutex_lock(&mutex);
+		char digest[BLACKLIST_DIGEST_SIZE];
+		int have_digest = 0;
+		unsigned int h;
+		int shard, maybe_seen;
+		wget_hashmap_t **map;
 
-		if (!blacklist) {
-			blacklist = wget_hashmap_create(128, (wget_hashmap_hash_t)hash_iri, (wget_hashmap_compare_t)wget_iri_compare);
-			wget_hashmap_set_key_destructor(blacklist, (wget_hashmap_key_destructor_t)_free_entry);
+		// --compact-blacklist: dedup on a digest of the URI, do not keep the IRI
+		if (config.compact_blacklist)
+			have_digest = wget_hash_fast(WGET_DIGTYPE_MD5, iri->uri, strlen(iri->uri), digest) == 0;
+
+		h = have_digest ? _digest_hash((unsigned char *)digest) : hash_iri(iri);
+		// take the top bits for the shard - the hashmap buckets use the low ones
+		shard = (h >> (32 - 4)) & (BLACKLIST_SHARDS - 1);
+
+		if (!bloom)
+			_bloom_init();
+
+		wget_thread_mutex_lock(&mutex[shard]);
+
+		map = have_digest ? &blacklist_digests[shard] : &blacklist[shard];
+		if (!*map) {
+			if (have_digest) {
+				*map = wget_hashmap_create(128, (wget_hashmap_hash_t)_digest_hash, (wget_hashmap_compare_t)_digest_compare);
+			} else {
+				*map = wget_hashmap_create(128, (wget_hashmap_hash_t)hash_iri, (wget_hashmap_compare_t)wget_iri_compare);
+				wget_hashmap_set_key_destructor(*map, (wget_hashmap_key_destructor_t)_free_entry);
+			}
 		}
 
-		if (!wget_hashmap_contains(blacklist, iri)) {
+		// The bloom check has to happen under the shard lock: the bits for a
+		// given IRI are set under the same lock, so 'definitely not seen' is
+		// reliable and skips the hashmap lookup.
+		maybe_seen = _bloom_maybe_seen(h);
+		__sync_fetch_and_add(maybe_seen ? &bloom_hits : &bloom_misses, 1);
+
+		if (!maybe_seen || !wget_hashmap_contains(*map, have_digest ? (const void *)digest : (const void *)iri)) {
 			// info_printf("Add to blacklist: %s\n",iri->uri);
-			wget_hashmap_put_noalloc(blacklist, iri, NULL); // use hashmap as a hashset (without value)
-			wget_thread_mutex_unlock(&mutex);
+			if (have_digest)
+				wget_hashmap_put_noalloc(*map, wget_memdup(digest, sizeof(digest)), NULL);
+			else
+				wget_hashmap_put_noalloc(*map, iri, NULL); // use hashmap as a hashset (without value)
+			_bloom_set(h);
+			wget_thread_mutex_unlock(&mutex[shard]);
+
+			if (have_digest)
+				_retain(iri); // jobs, hosts and referers may point into it
 			return iri;
 		}
 
-		wget_thread_mutex_unlock(&mutex);
+		wget_thread_mutex_unlock(&mutex[shard]);
 	}
 
 	wget_iri_free(&iri);
@@ -119,7 +316,16 @@ wget_iri_t *blacklist_add(wget_iri_t *iri)
 
 void blacklist_free(void)
 {
-	wget_thread_mutex_lock(&mutex);
-	wget_hashmap_free(&blacklist);
-	wget_thread_mutex_unlock(&mutex);
+	for (int shard = 0; shard < BLACKLIST_SHARDS; shard++) {
+		wget_thread_mutex_lock(&mutex[shard]);
+		wget_hashmap_free(&blacklist[shard]);
+		wget_hashmap_free(&blacklist_digests[shard]);
+		wget_thread_mutex_unlock(&mutex[shard]);
+	}
+
+	wget_thread_mutex_lock(&retained_mutex);
+	wget_hashmap_free(&retained); // frees the retained IRIs via the key destructor
+	wget_thread_mutex_unlock(&retained_mutex);
+
+	xfree(bloom);
 }
@@ -0,0 +1,223 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Compressed in-memory body cache (--body-cache)
+ *
+ * Documents remembered for --convert-links are read back from disk at the
+ * end of the run, one read per converted file. This cache keeps their
+ * bodies in memory instead, deflate-compressed where zlib is available
+ * (HTML compresses to a fraction of its size), bounded by a byte budget
+ * with least-recently-stored eviction. The conversion pass consumes each
+ * entry exactly once, so a hit also removes it.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_bodycache.h"
+
+// budget for compressed bodies held in memory; the oldest entries are
+// dropped beyond it and their documents fall back to the disk read
+#define BODY_CACHE_MAX_BYTES (64 << 20)
+
+typedef struct body_entry_st {
+	struct body_entry_st
+		*prev,
+		*next;
+	const char
+		*fname;
+	char
+		*data; // compressed (or raw, see below) body bytes
+	size_t
+		length, // number of bytes in 'data'
+		orig_length; // length of the uncompressed body
+	char
+		compressed;
+} body_entry_t;
+
+static wget_stringmap_t
+	*entries; // local filename -> body_entry_t
+
+static body_entry_t
+	*head, // most recently stored
+	*tail; // evicted first
+
+static size_t
+	total_bytes;
+
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static void _unlink_entry(body_entry_t *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		head = entry->next;
+
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		tail = entry->prev;
+
+	total_bytes -= entry->length;
+}
+
+static void _free_entry(body_entry_t *entry)
+{
+	xfree(entry->data);
+	xfree(entry);
+}
+
+// called with the completed document still in memory: keep a compressed
+// copy keyed by the local filename, for the conversion pass at exit
+void body_cache_put(const char *fname, const char *data, size_t length)
+{
+	body_entry_t *entry;
+	char *stored = NULL;
+	size_t stored_length = 0;
+	char compressed = 0;
+
+	if (!config.body_cache || !fname || !data || !length || length > BODY_CACHE_MAX_BYTES)
+		return;
+
+#ifdef WITH_ZLIB
+	{
+		uLongf destlen = compressBound(length);
+		char *dest = wget_malloc(destlen);
+
+		if (compress2((Bytef *) dest, &destlen, (const Bytef *) data, length, Z_BEST_SPEED) == Z_OK
+			&& destlen < length)
+		{
+			stored = dest;
+			stored_length = destlen;
+			compressed = 1;
+		} else
+			xfree(dest); // incompressible (or failed), keep the raw bytes
+	}
+#endif
+
+	if (!stored) {
+		stored = wget_memdup(data, length);
+		stored_length = length;
+	}
+
+	wget_thread_mutex_lock(&mutex);
+
+	if (!entries) {
+		entries = wget_stringmap_create(128);
+		wget_stringmap_set_value_destructor(entries, (wget_stringmap_value_destructor_t) _free_entry);
+	}
+
+	if (wget_stringmap_contains(entries, fname)) {
+		wget_thread_mutex_unlock(&mutex);
+		xfree(stored);
+		return;
+	}
+
+	// stay within the byte budget, oldest entries go first
+	while (tail && total_bytes + stored_length > BODY_CACHE_MAX_BYTES) {
+		body_entry_t *evict = tail;
+
+		_unlink_entry(evict);
+		wget_stringmap_remove(entries, evict->fname);
+	}
+
+	entry = wget_calloc(1, sizeof(body_entry_t));
+	entry->fname = wget_strdup(fname); // owned by the map (freed as its key)
+	entry->data = stored;
+	entry->length = stored_length;
+	entry->orig_length = length;
+	entry->compressed = compressed;
+
+	entry->next = head;
+	if (head)
+		head->prev = entry;
+	else
+		tail = entry;
+	head = entry;
+	total_bytes += stored_length;
+
+	wget_stringmap_put_noalloc(entries, entry->fname, entry);
+
+	wget_thread_mutex_unlock(&mutex);
+}
+
+// look up (and consume) the cached body of a local file;
+// returns the allocated uncompressed bytes, or NULL on a miss
+char *body_cache_get(const char *fname, size_t *length)
+{
+	body_entry_t *entry;
+	char *data = NULL;
+
+	if (!config.body_cache || !fname)
+		return NULL;
+
+	wget_thread_mutex_lock(&mutex);
+
+	if (entries && (entry = wget_stringmap_get(entries, fname))) {
+		if (entry->compressed) {
+#ifdef WITH_ZLIB
+			uLongf destlen = entry->orig_length;
+
+			data = wget_malloc(entry->orig_length);
+			if (uncompress((Bytef *) data, &destlen, (const Bytef *) entry->data, entry->length) != Z_OK
+				|| destlen != entry->orig_length)
+			{
+				xfree(data); // fall back to the disk read
+			}
+#endif
+		} else {
+			data = entry->data;
+			entry->data = NULL;
+		}
+
+		if (data && length)
+			*length = entry->orig_length;
+
+		_unlink_entry(entry);
+		wget_stringmap_remove(entries, fname); // frees the entry
+	}
+
+	wget_thread_mutex_unlock(&mutex);
+
+	return data;
+}
+
+void body_cache_free(void)
+{
+	wget_thread_mutex_lock(&mutex);
+
+	wget_stringmap_free(&entries);
+	head = tail = NULL;
+	total_bytes = 0;
+
+	wget_thread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright(c) 2017-2019 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Connection pool routines
+ *
+ * Keep-alive HTTP(S) connections used to be tied to the downloader thread
+ * that opened them - reuse only happened when the same thread fetched the
+ * same host consecutively. This process-wide pool keyed by scheme/host/port
+ * lets any thread check out a warm connection that another thread paid the
+ * TCP+TLS handshake for, no matter how the scheduler moves hosts around.
+ * Idle connections are reaped after a timeout since servers drop them anyway.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_connpool.h"
+
+// how long an idle connection is worth keeping, servers rarely allow more
+#define CONN_POOL_IDLE_TIMEOUT 60000 // milliseconds
+
+// upper bound so the pool can't exhaust file descriptors
+#define CONN_POOL_MAX 64
+
+struct pooled_conn {
+	wget_http_connection_t
+		*conn;
+	wget_timer_t
+		*idle_timer; // armed at check-in, cancelled at check-out
+};
+
+static wget_vector_t
+	*conn_pool;
+static wget_timer_wheel_t
+	*idle_wheel; // idle deadlines, O(1) arm/cancel instead of scanning the pool
+static wget_thread_mutex_t
+	conn_pool_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+// idle deadline passed - drop the connection, called with mutex held
+// from within wget_timer_wheel_tick()
+static void _expire_idle(void *ctx)
+{
+	wget_http_connection_t *conn = ctx;
+
+	for (int it = 0; it < wget_vector_size(conn_pool); it++) {
+		struct pooled_conn *pooled = wget_vector_get(conn_pool, it);
+
+		if (pooled->conn == conn) {
+			debug_printf("connection pool: reap idle %s\n", wget_http_get_host(conn));
+			pooled->idle_timer = NULL; // fired, the wheel frees it
+			wget_http_close(&pooled->conn);
+			wget_vector_remove(conn_pool, it);
+			break;
+		}
+	}
+}
+
+// check out a warm connection to scheme://host:port, or NULL
+wget_http_connection_t *conn_pool_get(const wget_iri_t *iri)
+{
+	wget_http_connection_t *conn = NULL;
+
+	wget_thread_mutex_lock(&conn_pool_mutex);
+
+	if (idle_wheel)
+		wget_timer_wheel_tick(idle_wheel, wget_get_timemillis_coarse());
+
+	for (int it = 0; it < wget_vector_size(conn_pool); it++) {
+		struct pooled_conn *pooled = wget_vector_get(conn_pool, it);
+
+		// a proxied connection carries absolute URIs, so it serves any host
+		// that would be routed through the proxy - match on the proxy, not
+		// on whichever origin happened to use it first
+		if (wget_http_get_proxy_host(pooled->conn)) {
+			if (wget_http_get_scheme(pooled->conn) == iri->scheme && wget_http_uses_proxy(iri)) {
+				conn = pooled->conn;
+				wget_timer_wheel_cancel(idle_wheel, &pooled->idle_timer);
+				wget_vector_remove(conn_pool, it);
+				debug_printf("connection pool: reuse proxy %s for %s\n",
+					wget_http_get_proxy_host(conn), iri->host);
+				break;
+			}
+			continue;
+		}
+
+		if (!wget_strcmp(wget_http_get_host(pooled->conn), iri->host)
+			&& wget_http_get_scheme(pooled->conn) == iri->scheme
+			&& wget_http_get_port(pooled->conn) == iri->port)
+		{
+			conn = pooled->conn;
+			wget_timer_wheel_cancel(idle_wheel, &pooled->idle_timer);
+			wget_vector_remove(conn_pool, it);
+			debug_printf("connection pool: reuse %s\n", iri->host);
+			break;
+		}
+	}
+
+	wget_thread_mutex_unlock(&conn_pool_mutex);
+
+	return conn;
+}
+
+// check in a connection for later reuse (closes it when the pool is full)
+void conn_pool_put(wget_http_connection_t **conn)
+{
+	struct pooled_conn pooled;
+
+	if (!*conn)
+		return;
+
+	pooled.conn = *conn;
+
+	wget_thread_mutex_lock(&conn_pool_mutex);
+
+	if (!idle_wheel)
+		idle_wheel = wget_timer_wheel_create(64, 1000); // 1s granularity is plenty for a 60s deadline
+
+	wget_timer_wheel_tick(idle_wheel, wget_get_timemillis_coarse());
+
+	if (wget_vector_size(conn_pool) < CONN_POOL_MAX) {
+		if (!conn_pool)
+			conn_pool = wget_vector_create(16, -2, NULL);
+
+		pooled.idle_timer = wget_timer_wheel_add(idle_wheel, CONN_POOL_IDLE_TIMEOUT, _expire_idle, *conn);
+		wget_vector_add(conn_pool, &pooled, sizeof(pooled));
+		debug_printf("connection pool: keep %s\n", wget_http_get_host(*conn));
+		*conn = NULL;
+	}
+
+	wget_thread_mutex_unlock(&conn_pool_mutex);
+
+	if (*conn)
+		wget_http_close(conn); // pool full
+}
+
+// Speculative preconnect: the hosts of freshly enqueued links are handed to
+// a tiny worker pool that performs the TCP+TLS handshake in the background
+// and checks the connection in here, so the first-contact latency of an
+// upcoming host overlaps with the downloads currently in flight.
+#define PRECONNECT_THREADS 2
+#define PRECONNECT_BACKLOG_MAX 16
+
+struct preconnect_candidate {
+	wget_iri_t
+		*iri; // a clone, only scheme/host/port matter
+	int
+		refs; // links seen to this host so far, the most-referenced host connects first
+};
+
+static wget_thread_t
+	preconnect_tid[PRECONNECT_THREADS];
+static wget_vector_t
+	*preconnect_backlog; // hosts waiting for a background handshake
+static wget_stringmap_t
+	*preconnect_seen; // hosts already handed over, one speculative connection per host
+static wget_thread_mutex_t
+	preconnect_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+static wget_thread_cond_t
+	preconnect_cond = WGET_THREAD_COND_INITIALIZER;
+static bool
+	preconnect_shutdown;
+
+static void *_preconnect_thread(void *p G_GNUC_WGET_UNUSED)
+{
+	for (;;) {
+		struct preconnect_candidate *candidate = NULL;
+		wget_http_connection_t *conn;
+		int best = -1, refs = 0;
+
+		wget_thread_mutex_lock(&preconnect_mutex);
+		while (!preconnect_shutdown && wget_vector_size(preconnect_backlog) == 0)
+			wget_thread_cond_wait(&preconnect_cond, &preconnect_mutex, 0);
+		if (preconnect_shutdown) {
+			wget_thread_mutex_unlock(&preconnect_mutex);
+			break; // leftovers are freed by conn_pool_free()
+		}
+		for (int it = 0; it < wget_vector_size(preconnect_backlog); it++) {
+			struct preconnect_candidate *c = wget_vector_get(preconnect_backlog, it);
+
+			if (c->refs > refs) {
+				best = it;
+				refs = c->refs;
+			}
+		}
+		if (best >= 0) {
+			candidate = wget_vector_get(preconnect_backlog, best);
+			wget_vector_remove_nofree(preconnect_backlog, best);
+		}
+		wget_thread_mutex_unlock(&preconnect_mutex);
+
+		if (!candidate)
+			continue; // spurious wakeup
+
+		debug_printf("preconnect %s (%d links)\n", candidate->iri->host, candidate->refs);
+		if (wget_http_open(&conn, candidate->iri) == WGET_E_SUCCESS)
+			conn_pool_put(&conn); // closes it when the pool is full
+
+		wget_iri_free(&candidate->iri);
+		xfree(candidate);
+	}
+
+	return NULL;
+}
+
+// queue a speculative handshake for the host of 'iri', starts the worker
+// pool lazily; repeated calls for the same host just bump its link count
+void conn_pool_preconnect(const wget_iri_t *iri)
+{
+	if (!iri->host)
+		return;
+
+	wget_thread_mutex_lock(&preconnect_mutex);
+
+	if (preconnect_shutdown) {
+		wget_thread_mutex_unlock(&preconnect_mutex);
+		return;
+	}
+
+	if (!preconnect_seen) {
+		preconnect_seen = wget_stringmap_create(64);
+		preconnect_backlog = wget_vector_create(16, -2, NULL);
+
+		for (int it = 0; it < PRECONNECT_THREADS; it++) {
+			int rc;
+
+			if ((rc = wget_thread_start(&preconnect_tid[it], _preconnect_thread, NULL, 0)) != 0)
+				error_printf(_("Failed to start preconnect thread, error %d\n"), rc);
+		}
+	}
+
+	if (wget_stringmap_contains(preconnect_seen, iri->host)) {
+		// still waiting in the backlog? popularity moves it up
+		for (int it = 0; it < wget_vector_size(preconnect_backlog); it++) {
+			struct preconnect_candidate *candidate = wget_vector_get(preconnect_backlog, it);
+
+			if (!wget_strcmp(candidate->iri->host, iri->host)) {
+				candidate->refs++;
+				break;
+			}
+		}
+	} else if (wget_vector_size(preconnect_backlog) < PRECONNECT_BACKLOG_MAX) {
+		struct preconnect_candidate *candidate = wget_malloc(sizeof(*candidate));
+
+		candidate->iri = wget_iri_clone(iri);
+		candidate->refs = 1;
+
+		wget_stringmap_put_noalloc(preconnect_seen, wget_strdup(iri->host), NULL);
+		wget_vector_add_noalloc(preconnect_backlog, candidate);
+		wget_thread_cond_signal(&preconnect_cond);
+	}
+
+	wget_thread_mutex_unlock(&preconnect_mutex);
+}
+
+void conn_pool_free(void)
+{
+	if (preconnect_seen) {
+		// stop the workers, an unconnected leftover host costs nothing
+		wget_thread_mutex_lock(&preconnect_mutex);
+		preconnect_shutdown = true;
+		for (int it = 0; it < PRECONNECT_THREADS; it++)
+			wget_thread_cond_signal(&preconnect_cond);
+		wget_thread_mutex_unlock(&preconnect_mutex);
+
+		for (int it = 0; it < PRECONNECT_THREADS; it++)
+			if (preconnect_tid[it])
+				wget_thread_join(preconnect_tid[it]);
+
+		for (int it = 0; it < wget_vector_size(preconnect_backlog); it++) {
+			struct preconnect_candidate *candidate = wget_vector_get(preconnect_backlog, it);
+
+			wget_iri_free(&candidate->iri);
+		}
+		wget_vector_free(&preconnect_backlog); // frees the candidate structs
+		wget_stringmap_free(&preconnect_seen);
+	}
+
+	// no mutex locking needed - called on exit when all threads have ceased
+	for (int it = 0; it < wget_vector_size(conn_pool); it++) {
+		struct pooled_conn *pooled = wget_vector_get(conn_pool, it);
+
+		wget_http_close(&pooled->conn);
+	}
+	wget_vector_free(&conn_pool);
+	wget_timer_wheel_free(&idle_wheel);
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Resident daemon mode
+ *
+ * Pipelines that invoke wget2 thousands of times per hour repay the
+ * startup cost on every run: config parsing, TLS init, DNS lookups and
+ * the TCP/TLS handshakes. With --daemon-socket=PATH the process stays
+ * resident once its initial queue drains and accepts fetch commands on
+ * a Unix socket, so the DNS cache, TLS session tickets, cookies and the
+ * warm connection pool of earlier fetches serve the later ones.
+ *
+ * A second invocation with --daemon-fetch=PATH acts as the thin client:
+ * it forwards its command-line URLs to the daemon and returns when the
+ * daemon's queue has drained, turning the few hundred milliseconds of
+ * per-process overhead into a socket round trip:
+ *
+ *   wget2 --daemon-socket=/run/wget2.sock &
+ *   wget2 --daemon-fetch=/run/wget2.sock https://example.com/a.tar.gz
+ *
+ * The line protocol is plain text - FETCH <url>, WAIT, STATUS, QUIT -
+ * and just as usable from a shell script via nc. Connections are served
+ * one at a time, so WAIT means "the queue including my URLs is empty",
+ * which is exact as long as submitters take turns.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_host.h"
+#include "wget_metrics.h"
+#include "wget_daemon.h"
+
+// longest command line accepted from a client, URL included
+#define DAEMON_MAX_LINE 8192
+
+static int
+	listen_fd = -1;
+static wget_thread_t
+	serve_thread;
+static char
+	*socket_path;
+static daemon_enqueue_fn
+	*enqueue_cb;
+static daemon_idle_fn
+	*idle_cb;
+static bool
+	quit; // a QUIT command arrived, the main loop may exit
+
+static void _reply(int fd, const char *s)
+{
+	// a client that went away mid-reply is its problem, not ours
+	if (send(fd, s, strlen(s), MSG_NOSIGNAL) == -1)
+		debug_printf("daemon reply failed (errno=%d)\n", errno);
+}
+
+static void _serve_connection(int fd)
+{
+	char *buf = NULL;
+	size_t bufsize = 0;
+	ssize_t len;
+
+	while (!quit && (len = wget_fdgetline(&buf, &bufsize, fd)) >= 0) {
+		char *line = buf;
+
+		while (len && isspace(*line)) { line++; len--; } // skip leading spaces
+		while (len && isspace(line[len - 1])) len--; // skip trailing spaces
+		line[len] = 0;
+
+		if (!*line)
+			continue;
+
+		debug_printf("daemon: received '%s'\n", line);
+
+		if (!wget_strncasecmp_ascii(line, "FETCH ", 6)) {
+			const char *url = line + 6;
+
+			while (isspace(*url)) url++;
+
+			if (*url) {
+				enqueue_cb(url);
+				_reply(fd, "QUEUED\n");
+			} else
+				_reply(fd, "ERR empty URL\n");
+		} else if (!wget_strcasecmp_ascii(line, "WAIT")) {
+			// the client's URLs entered the queue before QUEUED was sent,
+			// so an empty queue means they are done
+			while (!quit && !idle_cb())
+				wget_millisleep(100);
+			_reply(fd, "IDLE\n");
+		} else if (!wget_strcasecmp_ascii(line, "STATUS")) {
+			char status[128];
+
+			snprintf(status, sizeof(status), "STATUS queued=%d files=%lld bytes=%lld\n",
+				queue_size(), metrics_read(METRICS_FILES_SAVED), metrics_read(METRICS_BYTES));
+			_reply(fd, status);
+		} else if (!wget_strcasecmp_ascii(line, "QUIT")) {
+			_reply(fd, "BYE\n");
+			quit = true;
+			enqueue_cb(NULL); // wake the main loop so it notices the shutdown
+			break;
+		} else
+			_reply(fd, "ERR unknown command\n");
+	}
+
+	xfree(buf);
+}
+
+static void *_serve_thread(void *p G_GNUC_WGET_UNUSED)
+{
+	for (;;) {
+		int fd = accept(listen_fd, NULL, NULL); // cancellation point
+
+		if (fd == -1) {
+			if (errno == EINTR)
+				continue;
+			break; // listen_fd went away on shutdown
+		}
+
+		_serve_connection(fd);
+		close(fd);
+	}
+
+	return NULL;
+}
+
+// whether the process should stay resident although the queue is empty
+bool daemon_active(void)
+{
+	return listen_fd != -1 && !quit;
+}
+
+void daemon_init(daemon_enqueue_fn *enqueue, daemon_idle_fn *idle)
+{
+	struct sockaddr_un addr;
+
+	if (!config.daemon_socket)
+		return;
+
+	if (!wget_thread_support()) {
+		error_printf(_("No thread support, disabling daemon mode\n"));
+		return;
+	}
+
+	if (strlen(config.daemon_socket) >= sizeof(addr.sun_path)) {
+		error_printf(_("Daemon socket path too long '%s'\n"), config.daemon_socket);
+		return;
+	}
+
+	if ((listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+		error_printf(_("Failed to create daemon socket (errno=%d)\n"), errno);
+		return;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, config.daemon_socket);
+
+	unlink(config.daemon_socket); // a stale socket from a dead instance
+
+	if (bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1
+		|| listen(listen_fd, 32) == -1)
+	{
+		error_printf(_("Failed to bind daemon socket '%s' (errno=%d)\n"), config.daemon_socket, errno);
+		close(listen_fd);
+		listen_fd = -1;
+		return;
+	}
+
+	socket_path = wget_strdup(config.daemon_socket);
+	enqueue_cb = enqueue;
+	idle_cb = idle;
+
+	if (wget_thread_start(&serve_thread, _serve_thread, NULL, 0)) {
+		error_printf(_("Failed to start daemon thread\n"));
+		close(listen_fd);
+		listen_fd = -1;
+		xfree(socket_path);
+		return;
+	}
+
+	info_printf(_("Daemon accepting fetch commands on '%s'\n"), socket_path);
+}
+
+void daemon_exit(void)
+{
+	if (listen_fd != -1) {
+		wget_thread_cancel(serve_thread);
+		wget_thread_join(serve_thread);
+
+		close(listen_fd);
+		listen_fd = -1;
+		unlink(socket_path);
+	}
+
+	xfree(socket_path);
+}
+
+// Thin-client mode: forward the command-line URLs to a resident daemon
+// and wait until its queue has drained.
+// Returns 0 on success, -1 when no daemon answered or the connection broke.
+int daemon_fetch(int argc, const char **argv, int first)
+{
+	struct sockaddr_un addr;
+	char *buf = NULL;
+	size_t bufsize = 0;
+	int fd, ret = -1;
+
+	if (strlen(config.daemon_fetch) >= sizeof(addr.sun_path)) {
+		error_printf(_("Daemon socket path too long '%s'\n"), config.daemon_fetch);
+		return -1;
+	}
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+		error_printf(_("Failed to create daemon socket (errno=%d)\n"), errno);
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, config.daemon_fetch);
+
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+		error_printf(_("No daemon listening at '%s' (errno=%d)\n"), config.daemon_fetch, errno);
+		close(fd);
+		return -1;
+	}
+
+	for (int it = first; it < argc; it++) {
+		char cmd[DAEMON_MAX_LINE];
+
+		if (snprintf(cmd, sizeof(cmd), "FETCH %s\n", argv[it]) >= (int) sizeof(cmd)) {
+			error_printf(_("URL too long for daemon fetch '%s'\n"), argv[it]);
+			continue;
+		}
+
+		_reply(fd, cmd);
+	}
+
+	_reply(fd, "WAIT\n");
+
+	// one QUEUED per URL, then IDLE once the daemon's queue drained
+	while (wget_fdgetline(&buf, &bufsize, fd) >= 0) {
+		debug_printf("daemon: answered '%s'\n", buf);
+
+		if (!wget_strncasecmp_ascii(buf, "IDLE", 4)) {
+			ret = 0;
+			break;
+		}
+		if (!wget_strncasecmp_ascii(buf, "ERR", 3))
+			error_printf(_("Daemon: %s\n"), buf);
+	}
+
+	if (ret)
+		error_printf(_("Lost connection to daemon at '%s'\n"), config.daemon_fetch);
+
+	xfree(buf);
+	close(fd);
+
+	return ret;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Duplicate content detection (--dedup-content)
+ *
+ * Template-heavy mirrors serve the same bytes under many URLs. Each
+ * completely saved file is hashed (SHA-256) and remembered; when a later
+ * download produces a known digest, the fresh copy is replaced by a
+ * hardlink to the first file with that content.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_dedup.h"
+
+static wget_stringmap_t
+	*files; // SHA-256 hex digest -> first local file saved with that content
+
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static long long
+	dedup_nfiles, // number of files replaced by a hardlink
+	dedup_nbytes; // bytes of disk storage that saved
+
+// called with the completed download still open: hash the file and either
+// remember it as the first copy of its content or replace it by a hardlink
+void dedup_register_file(int fd, const char *fname)
+{
+	char digest_hex[64 + 1]; // sha-256 hex
+	struct stat st;
+	const char *canonical;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+		return; // nothing to win on empty files
+
+	if (wget_hash_file_fd("sha-256", fd, digest_hex, sizeof(digest_hex), 0, 0) != 0)
+		return;
+
+	wget_thread_mutex_lock(&mutex);
+
+	if (!files)
+		files = wget_stringmap_create(128);
+
+	if (!(canonical = wget_stringmap_get(files, digest_hex))) {
+		// first file with this content, it becomes the hardlink target
+		wget_stringmap_put_noalloc(files, wget_strdup(digest_hex), wget_strdup(fname));
+		wget_thread_mutex_unlock(&mutex);
+		return;
+	}
+
+	if (!strcmp(canonical, fname)) {
+		wget_thread_mutex_unlock(&mutex);
+		return; // re-download of the canonical file itself
+	}
+
+	// link to a temporary name first, so the data is never lost on failure
+	char *tmpname = wget_aprintf("%s.dedup", fname);
+
+	if (link(canonical, tmpname) == 0) {
+		if (rename(tmpname, fname) == 0) {
+			dedup_nfiles++;
+			dedup_nbytes += st.st_size;
+			debug_printf("deduplicated '%s', same content as '%s'\n", fname, canonical);
+		} else {
+			error_printf(_("Failed to rename %s to %s (errno=%d)\n"), tmpname, fname, errno);
+			unlink(tmpname);
+		}
+	} else {
+		// e.g. another filesystem (EXDEV) - just keep the plain copy
+		debug_printf("can't hardlink '%s' to '%s' (errno=%d)\n", fname, canonical, errno);
+	}
+
+	xfree(tmpname);
+
+	wget_thread_mutex_unlock(&mutex);
+}
+
+void dedup_stats(long long *nfiles, long long *nbytes)
+{
+	*nfiles = dedup_nfiles;
+	*nbytes = dedup_nbytes;
+}
+
+void dedup_free(void)
+{
+	wget_thread_mutex_lock(&mutex);
+	wget_stringmap_free(&files);
+	wget_thread_mutex_unlock(&mutex);
+}
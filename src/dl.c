@@ -296,9 +296,138 @@ char *dl_get_name_from_path(const char *path, int strict)
 		return wget_strmemdup(path + start, len);
 }
 
+// Resolved plugin-path cache
+// ==========================
+// dl_search() probes every search directory with every platform name
+// pattern, so loading a handful of plugins costs dozens of failed stat()
+// calls on every invocation - real money for short batch runs. The cache
+// remembers name -> resolved path together with the file's mtime; a hit is
+// one stat() to validate the entry, a changed or vanished file falls back
+// to the full probe and refreshes the entry.
+
+typedef struct {
+	char *path;
+	long long mtime;
+} dl_cache_entry_t;
+
+static wget_stringmap_t
+	*dl_cache;
+static char
+	*dl_cache_file;
+static bool
+	dl_cache_dirty;
+
+static void _dl_cache_entry_free(dl_cache_entry_t *entry)
+{
+	wget_free(entry->path);
+}
+
+// load the resolved-path cache, <filename> is remembered for dl_cache_save()
+void dl_cache_load(const char *filename)
+{
+	char *buf = NULL;
+	size_t bufsize = 0;
+	FILE *fp;
+
+	wget_free(dl_cache_file);
+	dl_cache_file = wget_strdup(filename);
+
+	if (!dl_cache) {
+		dl_cache = wget_stringmap_create(16);
+		wget_stringmap_set_value_destructor(dl_cache, (wget_stringmap_value_destructor_t) _dl_cache_entry_free);
+	}
+
+	if (!(fp = fopen(filename, "r")))
+		return; // no cache yet, the first run fills it
+
+	// one entry per line: <mtime> <name> <path>
+	while (wget_getline(&buf, &bufsize, fp) >= 0) {
+		char name[64], path[1024];
+		long long mtime;
+
+		if (sscanf(buf, "%lld %63s %1023s", &mtime, name, path) == 3) {
+			dl_cache_entry_t *entry = wget_malloc(sizeof(dl_cache_entry_t));
+
+			entry->path = wget_strdup(path);
+			entry->mtime = mtime;
+			wget_stringmap_put_noalloc(dl_cache, wget_strdup(name), entry);
+		}
+	}
+
+	wget_xfree(buf);
+	fclose(fp);
+}
+
+static int _dl_cache_write_entry(void *ctx, const char *name, void *value)
+{
+	dl_cache_entry_t *entry = value;
+
+	fprintf((FILE *) ctx, "%lld %s %s\n", entry->mtime, name, entry->path);
+	return 0;
+}
+
+// write the cache back if dl_search() learned or invalidated anything
+void dl_cache_save(void)
+{
+	FILE *fp;
+
+	if (!dl_cache_dirty || !dl_cache_file)
+		return;
+
+	if ((fp = fopen(dl_cache_file, "w"))) {
+		wget_stringmap_browse(dl_cache, _dl_cache_write_entry, fp);
+		fclose(fp);
+		dl_cache_dirty = false;
+	}
+
+	wget_stringmap_free(&dl_cache);
+	wget_xfree(dl_cache_file);
+}
+
+static void _dl_cache_put(const char *name, const char *path)
+{
+	struct stat statbuf;
+
+	if (!dl_cache || stat(path, &statbuf) < 0)
+		return;
+
+	dl_cache_entry_t *entry = wget_malloc(sizeof(dl_cache_entry_t));
+
+	entry->path = wget_strdup(path);
+	entry->mtime = (long long) statbuf.st_mtime;
+	wget_stringmap_put_noalloc(dl_cache, wget_strdup(name), entry);
+	dl_cache_dirty = true;
+}
+
+// cached resolution of <name>, validated against the file's current mtime
+static char *_dl_cache_get(const char *name)
+{
+	dl_cache_entry_t *entry;
+	struct stat statbuf;
+
+	if (!dl_cache || !(entry = wget_stringmap_get(dl_cache, name)))
+		return NULL;
+
+	if (stat(entry->path, &statbuf) == 0
+		&& S_ISREG(statbuf.st_mode)
+		&& (long long) statbuf.st_mtime == entry->mtime)
+	{
+		return wget_strdup(entry->path);
+	}
+
+	// stale: the plugin was rebuilt, moved or removed
+	wget_stringmap_remove(dl_cache, name);
+	dl_cache_dirty = true;
+	return NULL;
+}
+
 char *dl_search(const char *name, const wget_vector_t *dirs)
 {
 	int n_dirs = wget_vector_size(dirs);
+	char *cached = _dl_cache_get(name);
+
+	if (cached)
+		return cached;
 
 	for (int i = 0; i < n_dirs; i++) {
 		const char *dir = wget_vector_get(dirs, i);
@@ -307,8 +436,10 @@ char *dl_search(const char *name, const wget_vector_t *dirs)
 				char *filename = wget_aprintf("%s/%s%s%s", dir,
 						dl_patterns[j].prefix, name, dl_patterns[j].suffix);
 
-				if (is_regular_file(filename))
+				if (is_regular_file(filename)) {
+					_dl_cache_put(name, filename);
 					return filename;
+				}
 
 				wget_free(filename);
 			}
@@ -317,8 +448,10 @@ char *dl_search(const char *name, const wget_vector_t *dirs)
 				char *filename = wget_aprintf("%s%s%s",
 						dl_patterns[j].prefix, name, dl_patterns[j].suffix);
 
-				if (is_regular_file(filename))
+				if (is_regular_file(filename)) {
+					_dl_cache_put(name, filename);
 					return filename;
+				}
 
 				wget_free(filename);
 			}
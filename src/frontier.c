@@ -0,0 +1,151 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Disk-backed URL frontier (--frontier-cap)
+ *
+ * On broad crawls the job queue can grow to millions of entries. With a
+ * frontier cap, URLs discovered while the queue is at the cap are not
+ * turned into jobs but appended to an anonymous sequential spool file,
+ * as plain text records. main() pops them back in discovery order once
+ * the in-memory queue has drained, and the records go through the normal
+ * add_url path (blacklist, host lookup, job creation) at that point.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_frontier.h"
+
+static FILE
+	*spool; // tmpfile(), deleted by the OS when closed
+
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static long long
+	read_off, // file offset of the oldest not yet popped record
+	write_off, // file offset for the next record
+	pending, // number of records between the two offsets
+	total_spilled; // total records ever written, for stats_print()
+
+static char
+	*linebuf; // getline buffer, reused between pops
+static size_t
+	linebufsize;
+
+// append one discovered URL to the spool; the caller increments the level
+// for us since a spilled URL has no parent job any more when it is popped
+int frontier_spill(const char *url, const char *encoding, int flags, int level)
+{
+	int rc = -1;
+
+	wget_thread_mutex_lock(&mutex);
+
+	if (!spool && !(spool = tmpfile())) {
+		error_printf(_("Failed to create frontier spool file (errno=%d)\n"), errno);
+		wget_thread_mutex_unlock(&mutex);
+		return rc;
+	}
+
+	if (fseek(spool, write_off, SEEK_SET) == 0
+		&& fprintf(spool, "%d %d %s %s\n", level, flags, encoding ? encoding : "-", url) > 0)
+	{
+		write_off = ftell(spool);
+		pending++;
+		total_spilled++;
+		rc = 0;
+	} else {
+		error_printf(_("Failed to write to frontier spool file (errno=%d)\n"), errno);
+	}
+
+	wget_thread_mutex_unlock(&mutex);
+
+	return rc;
+}
+
+// pop the oldest record; url and encoding are allocated for the caller,
+// encoding may come back NULL. Returns 1 on success, 0 when drained.
+int frontier_pop(char **url, char **encoding, int *flags, int *level)
+{
+	char *p, *enc;
+	ssize_t len;
+
+	wget_thread_mutex_lock(&mutex);
+
+	if (!pending || fseek(spool, read_off, SEEK_SET) != 0
+		|| (len = wget_getline(&linebuf, &linebufsize, spool)) < 0)
+	{
+		wget_thread_mutex_unlock(&mutex);
+		return 0;
+	}
+
+	read_off = ftell(spool);
+	pending--;
+
+	while (len > 0 && (linebuf[len - 1] == '\n' || linebuf[len - 1] == '\r'))
+		linebuf[--len] = 0;
+
+	*level = (int) strtol(linebuf, &p, 10);
+	*flags = (int) strtol(p, &p, 10);
+	while (*p == ' ') p++;
+	enc = p;
+	if ((p = strchr(p, ' ')))
+		*p++ = 0;
+	else
+		p = enc + strlen(enc); // malformed record, empty URL
+
+	*encoding = strcmp(enc, "-") ? wget_strdup(enc) : NULL;
+	*url = wget_strdup(p);
+
+	wget_thread_mutex_unlock(&mutex);
+
+	return 1;
+}
+
+long long frontier_pending(void)
+{
+	return pending;
+}
+
+void frontier_stats(long long *spilled)
+{
+	*spilled = total_spilled;
+}
+
+void frontier_free(void)
+{
+	wget_thread_mutex_lock(&mutex);
+	if (spool) {
+		fclose(spool);
+		spool = NULL;
+	}
+	xfree(linebuf);
+	linebufsize = 0;
+	read_off = write_off = pending = 0;
+	wget_thread_mutex_unlock(&mutex);
+}
@@ -33,17 +33,122 @@
 
 #include "wget_main.h"
 #include "wget_host.h"
+#include "wget_snapshot.h"
+#include "wget_visited.h"
 #include "wget_options.h"
 #include "wget_job.h"
 #include "wget_stats.h"
+#include "wget_trace.h"
 
 static wget_hashmap_t
 	*hosts;
 static wget_thread_mutex_t
 	hosts_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+static wget_mpmc_queue_t
+	*ready_hosts; // lock-free hints: hosts that likely have a dequeueable job
 static int
 	qsize; // overall number of jobs
 
+// Number of host hints kept in the lock-free ring. Hints are an optimization
+// only - on overflow or loss the full scan in host_get_job() still finds every job.
+#define READY_HOSTS_SIZE 4096
+
+// Circuit breaker: after this many consecutive connection failures a host's
+// whole queue is parked with exponential backoff instead of letting every
+// thread burn a full connect timeout on the next queued job.
+#define HOST_BREAKER_THRESHOLD 3
+#define HOST_BREAKER_MAX_BACKOFF (60 * 1000) // longest park between probes (ms)
+
+static int
+	breakers_tripped; // cumulative trip count, reported by stats_print()
+
+// DNS prefetching: each new host is handed to a small resolver pool that
+// warms the libwget DNS cache in the background, so a downloader thread
+// rarely blocks in getaddrinfo() when it dequeues the host's first job.
+#define DNS_PREFETCH_THREADS 2
+
+static wget_thread_t
+	dns_prefetch_tid[DNS_PREFETCH_THREADS];
+static wget_vector_t
+	*dns_prefetch_backlog; // HOSTs waiting for background resolution
+static wget_thread_mutex_t
+	dns_prefetch_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+static wget_thread_cond_t
+	dns_prefetch_cond = WGET_THREAD_COND_INITIALIZER;
+static bool
+	dns_prefetch_shutdown;
+
+static void *_dns_prefetch_thread(void *p G_GNUC_WGET_UNUSED)
+{
+	wget_tcp_t *tcp = wget_tcp_init(); // carries the default DNS settings (timeout, caching)
+
+	for (;;) {
+		HOST *host = NULL;
+
+		wget_thread_mutex_lock(&dns_prefetch_mutex);
+		while (!dns_prefetch_shutdown && wget_vector_size(dns_prefetch_backlog) == 0)
+			wget_thread_cond_wait(&dns_prefetch_cond, &dns_prefetch_mutex, 0);
+		if (wget_vector_size(dns_prefetch_backlog) > 0) {
+			host = wget_vector_get(dns_prefetch_backlog, 0);
+			wget_vector_remove_nofree(dns_prefetch_backlog, 0);
+		}
+		wget_thread_mutex_unlock(&dns_prefetch_mutex);
+
+		if (!host)
+			break; // shutdown requested and backlog drained
+
+		debug_printf("prefetch DNS for %s\n", host->host);
+		wget_tcp_resolve(tcp, host->host, host->port); // result goes into the DNS cache
+	}
+
+	wget_tcp_deinit(&tcp);
+	return NULL;
+}
+
+// hand a newly seen host to the resolver pool, starts the pool lazily
+static void _dns_prefetch(HOST *host)
+{
+	// without DNS caching a background lookup would just be thrown away
+	if (!wget_tcp_get_dns_caching(NULL))
+		return;
+
+	wget_thread_mutex_lock(&dns_prefetch_mutex);
+
+	if (!dns_prefetch_backlog) {
+		dns_prefetch_backlog = wget_vector_create(16, -2, NULL);
+
+		for (int it = 0; it < DNS_PREFETCH_THREADS; it++) {
+			int rc;
+
+			if ((rc = wget_thread_start(&dns_prefetch_tid[it], _dns_prefetch_thread, NULL, 0)) != 0)
+				error_printf(_("Failed to start DNS prefetch thread, error %d\n"), rc);
+		}
+	}
+
+	wget_vector_add_noalloc(dns_prefetch_backlog, host);
+	wget_thread_cond_signal(&dns_prefetch_cond);
+
+	wget_thread_mutex_unlock(&dns_prefetch_mutex);
+}
+
+static void _dns_prefetch_free(void)
+{
+	if (!dns_prefetch_backlog)
+		return;
+
+	wget_thread_mutex_lock(&dns_prefetch_mutex);
+	dns_prefetch_shutdown = true;
+	for (int it = 0; it < DNS_PREFETCH_THREADS; it++)
+		wget_thread_cond_signal(&dns_prefetch_cond);
+	wget_thread_mutex_unlock(&dns_prefetch_mutex);
+
+	for (int it = 0; it < DNS_PREFETCH_THREADS; it++)
+		if (dns_prefetch_tid[it])
+			wget_thread_join(dns_prefetch_tid[it]);
+
+	wget_vector_free(&dns_prefetch_backlog);
+}
+
 static int _host_compare(const HOST *host1, const HOST *host2)
 {
 	int n;
@@ -83,11 +188,108 @@ static unsigned int _host_hash(const HOST *host)
 	return hash;
 }
 
+// Byte-wise trie over the disallowed path prefixes from robots.txt.
+// Big robots files have thousands of Disallow lines - instead of iterating
+// them per candidate URL, a check walks the request path once.
+typedef struct _robots_trie_node ROBOTS_TRIE;
+struct _robots_trie_node {
+	ROBOTS_TRIE
+		*child, // first child
+		*next; // next sibling
+	char
+		c; // edge byte
+	bool
+		terminal : 1; // a disallow rule ends here
+};
+
+static void _robots_trie_insert(ROBOTS_TRIE *node, const char *prefix, size_t len)
+{
+	for (size_t it = 0; it < len; it++) {
+		ROBOTS_TRIE *child;
+
+		if (node->terminal)
+			return; // a shorter rule already covers this prefix
+
+		for (child = node->child; child && child->c != prefix[it]; child = child->next)
+			;
+
+		if (!child) {
+			child = wget_calloc(1, sizeof(ROBOTS_TRIE));
+			child->c = prefix[it];
+			child->next = node->child;
+			node->child = child;
+		}
+
+		node = child;
+	}
+
+	node->terminal = 1;
+}
+
+static void _robots_trie_free(ROBOTS_TRIE **node)
+{
+	if (node && *node) {
+		for (ROBOTS_TRIE *child = (*node)->child, *next; child; child = next) {
+			next = child->next;
+			_robots_trie_free(&child);
+		}
+		xfree(*node);
+	}
+}
+
+// compile host->robots into the trie - called once after robots.txt is parsed
+void host_compile_robots(HOST *host)
+{
+	wget_thread_mutex_lock(&hosts_mutex);
+
+	_robots_trie_free(&host->robots_trie);
+
+	if (host->robots && wget_vector_size(host->robots->paths) > 0) {
+		host->robots_trie = wget_calloc(1, sizeof(ROBOTS_TRIE));
+
+		for (int it = 0; it < wget_vector_size(host->robots->paths); it++) {
+			wget_string_t *path = wget_vector_get(host->robots->paths, it);
+
+			if (path->len) // skip the leading '/', IRI paths don't have one
+				_robots_trie_insert(host->robots_trie, path->p + 1, path->len - 1);
+		}
+	}
+
+	wget_thread_mutex_unlock(&hosts_mutex);
+}
+
+int host_robots_disallowed(const HOST *host, const char *path)
+{
+	const ROBOTS_TRIE *node = host->robots_trie;
+
+	if (!node)
+		return 0;
+
+	for (const char *p = path ? path : ""; ; p++) {
+		const ROBOTS_TRIE *child;
+
+		if (node->terminal)
+			return 1; // a disallow rule is a prefix of 'path'
+
+		if (!*p)
+			return 0;
+
+		for (child = node->child; child && child->c != *p; child = child->next)
+			;
+
+		if (!child)
+			return 0;
+
+		node = child;
+	}
+}
+
 static void _free_host_entry(HOST *host)
 {
 	if (host) {
 		host_queue_free(host);
 		wget_robots_free(&host->robots);
+		_robots_trie_free(&host->robots_trie);
 		wget_hashmap_free(&host->host_docs);
 		wget_hashmap_free(&host->tree_docs);
 		wget_xfree(host);
@@ -101,6 +303,7 @@ HOST *host_add(wget_iri_t *iri)
 	if (!hosts) {
 		hosts = wget_hashmap_create(16, (wget_hashmap_hash_t)_host_hash, (wget_hashmap_compare_t)_host_compare);
 		wget_hashmap_set_key_destructor(hosts, (wget_hashmap_key_destructor_t)_free_host_entry);
+		ready_hosts = wget_mpmc_queue_create(READY_HOSTS_SIZE);
 		stats_set_hosts(hosts, &hosts_mutex);
 	}
 
@@ -114,6 +317,9 @@ HOST *host_add(wget_iri_t *iri)
 
 	wget_thread_mutex_unlock(&hosts_mutex);
 
+	if (hostp)
+		_dns_prefetch(hostp); // warm the DNS cache while the host's jobs wait in the queue
+
 	return hostp;
 }
 
@@ -135,11 +341,14 @@ HOST *host_get(wget_iri_t *iri)
 
 struct _find_free_job_context {
 	JOB *job;
+	JOB *best; // free job of the highest scheduling class found so far
 	long long now;
 	long long pause;
+	bool steal; // also take jobs from hosts another thread is already draining
 };
 
-static int _search_queue_for_free_job(struct _find_free_job_context *ctx, JOB *job)
+// mark a job (or its first free chunk) as being in use by this thread
+static void _take_job(struct _find_free_job_context *ctx, JOB *job)
 {
 	if (job->parts) {
 		for (int it = 0; it < wget_vector_size(job->parts); it++) {
@@ -151,16 +360,55 @@ static int _search_queue_for_free_job(struct _find_free_job_context *ctx, JOB *j
 				job->part = part;
 				ctx->job = job;
 				debug_printf("dequeue chunk %d/%d %s\n", it + 1, wget_vector_size(job->parts), job->metalink->name);
-				return 1;
+				return;
 			}
 		}
-	} else if (!job->inuse) {
+	} else {
 		job->inuse = 1;
 		job->used_by = wget_thread_self();
 		job->part = NULL;
 		ctx->job = job;
 		debug_printf("dequeue job %s\n", job->iri->uri);
-		return 1;
+	}
+}
+
+static int _has_free_slot(JOB *job)
+{
+	if (job->parts) {
+		for (int it = 0; it < wget_vector_size(job->parts); it++) {
+			PART *part = wget_vector_get(job->parts, it);
+
+			if (!part->inuse)
+				return 1;
+		}
+
+		return 0;
+	}
+
+	return !job->inuse;
+}
+
+static int _search_queue_for_free_job(struct _find_free_job_context *ctx, JOB *job)
+{
+	if (!_has_free_slot(job))
+		return 0;
+
+	// a failed job waits out its jittered backoff in place; surface the
+	// earliest due time so the idle threads know how long to nap
+	if (job->retry_ts > ctx->now) {
+		long long pause = job->retry_ts - ctx->now;
+
+		if (!ctx->pause || ctx->pause > pause)
+			ctx->pause = pause;
+		return 0;
+	}
+
+	// serve higher scheduling classes first, FIFO within a class
+	if (!ctx->best || job->priority > ctx->best->priority) {
+		ctx->best = job;
+
+		if (job->priority >= JOB_PRIORITY_METADATA)
+			return 1; // can't get better, stop scanning
 	}
 
 	return 0;
@@ -172,7 +420,14 @@ static int G_GNUC_WGET_NONNULL_ALL _search_host_for_free_job(struct _find_free_j
 	if (host->blocked)
 		return 0;
 
-	long long pause = host->retry_ts - ctx->now;
+	// Work stealing: spread idle threads over hosts nobody drains yet. Only when
+	// no such host has work left we take ('steal') jobs from already worked hosts.
+	if (!ctx->steal && host->workers > 0)
+		return 0;
+
+	// respect both the failure backoff and the politeness stamp (--wait)
+	long long until_ts = host->retry_ts > host->next_request_ts ? host->retry_ts : host->next_request_ts;
+	long long pause = until_ts - ctx->now;
 	debug_printf("pause=%lld\n", pause);
 	if (pause > 0) {
 		if (!ctx->pause || ctx->pause < pause)
@@ -180,6 +435,11 @@ static int G_GNUC_WGET_NONNULL_ALL _search_host_for_free_job(struct _find_free_j
 		return 0;
 	}
 
+	// half-open breaker: let exactly one worker probe the host, the rest of
+	// the queue stays parked until that probe succeeds or fails
+	if (host->breaker_tripped && host->workers > 0)
+		return 0;
+
 	if (host->robot_job) {
 		if (!host->robot_job->inuse) {
 			host->robot_job->inuse = 1;
@@ -192,20 +452,45 @@ static int G_GNUC_WGET_NONNULL_ALL _search_host_for_free_job(struct _find_free_j
 		return 0; // someone is still working on robots.txt
 	}
 
-	wget_list_browse(host->queue, (wget_list_browse_t)_search_queue_for_free_job, ctx);
+	ctx->best = NULL;
+	wget_list_link_browse(host->queue, (wget_list_browse_t)_search_queue_for_free_job, ctx);
+	if (ctx->best)
+		_take_job(ctx, ctx->best);
 
 	return !!ctx->job;
 }
 
 JOB *host_get_job(HOST *host, long long *pause)
 {
-	struct _find_free_job_context ctx = { .now = wget_get_timemillis() };
+	struct _find_free_job_context ctx = { .now = wget_get_timemillis_coarse() };
 
 	if (host) {
+		// a thread always may drain the host it is attached to
+		ctx.steal = true;
 		_search_host_for_free_job(&ctx, host);
 	} else {
 		wget_thread_mutex_lock(&hosts_mutex);
-		wget_hashmap_browse(hosts, (wget_hashmap_browse_t)_search_host_for_free_job, &ctx);
+
+		// fast path: hosts that recently got a job enqueued are hinted via the
+		// lock-free ring, saving the O(#hosts) hashmap scan on the hot path
+		if (ready_hosts) {
+			HOST *hinted;
+
+			while (!ctx.job && (hinted = wget_mpmc_queue_pop(ready_hosts)))
+				_search_host_for_free_job(&ctx, hinted);
+		}
+
+		// slow path: hints may have been dropped (ring full) or deferred
+		// (host paused/blocked at hint time), so scan all hosts before giving up.
+		// First pass prefers hosts without an attached worker, second pass steals.
+		if (!ctx.job)
+			wget_hashmap_browse(hosts, (wget_hashmap_browse_t)_search_host_for_free_job, &ctx);
+
+		if (!ctx.job) {
+			ctx.steal = true;
+			wget_hashmap_browse(hosts, (wget_hashmap_browse_t)_search_host_for_free_job, &ctx);
+		}
+
 		wget_thread_mutex_unlock(&hosts_mutex);
 	}
 
@@ -255,7 +540,7 @@ void host_release_jobs(HOST *host)
 		}
 	}
 
-	wget_list_browse(host->queue, (wget_list_browse_t)_release_job, &self);
+	wget_list_link_browse(host->queue, (wget_list_browse_t)_release_job, &self);
 
 	wget_thread_mutex_unlock(&hosts_mutex);
 }
@@ -267,16 +552,27 @@ JOB *host_add_job(HOST *host, JOB *job)
 	job->host = host;
 	debug_printf("%s: job fname %s\n", __func__, job->local_filename);
 
+	int old_tag = wget_alloc_tag(WGET_ALLOC_TAG_QUEUE); // for --alloc-stats attribution
+	jobp = job_dup(job); // enqueue/dequeue are pointer swaps, no allocation under the lock
+	wget_alloc_tag(old_tag);
+
+	if (config.trace_sample)
+		jobp->queued_ts = trace_now(); // for the queue-wait stage of a traced request
+
 	wget_thread_mutex_lock(&hosts_mutex);
-	jobp = wget_list_append(&host->queue, job, sizeof(JOB));
+	wget_list_link_append(&host->queue, &jobp->node);
 	host->qsize++;
 	if (!host->blocked)
 		qsize++;
 	wget_thread_mutex_unlock(&hosts_mutex);
 
-	if (job->iri)
+	if (ready_hosts)
+		wget_mpmc_queue_push(ready_hosts, host); // lock-free dequeue hint, losable on overflow
+
+	if (job->iri) {
+		snapshot_journal_add(false, job->iri->uri); // discovered, pending from now on
 		debug_printf("%s: %p %s\n", __func__, (void *)jobp, job->iri->uri);
-	else if (job->metalink)
+	} else if (job->metalink)
 		debug_printf("%s: %p %s\n", __func__, (void *)jobp, job->metalink->name);
 
 	debug_printf("%s: qsize %d host-qsize=%d\n", __func__, qsize, host->qsize);
@@ -300,6 +596,9 @@ JOB *host_add_robotstxt_job(HOST *host, wget_iri_t *iri)
 		qsize++;
 	wget_thread_mutex_unlock(&hosts_mutex);
 
+	if (ready_hosts)
+		wget_mpmc_queue_push(ready_hosts, host);
+
 	debug_printf("%s: %p %s\n", __func__, (void *)job, job->iri->uri);
 	debug_printf("%s: qsize %d host-qsize=%d\n", __func__, qsize, host->qsize);
 
@@ -310,6 +609,11 @@ void host_remove_job(HOST *host, JOB *job)
 {
 	debug_printf("%s: %p\n", __func__, (void *)job);
 
+	if (job->iri) {
+		snapshot_journal_add(true, job->iri->uri); // completed, don't re-queue on resume
+		visited_add(job->iri->uri); // skip it on re-crawls within the revisit interval
+	}
+
 	wget_thread_mutex_lock(&hosts_mutex);
 	if (job == host->robot_job) {
 		// Special handling for automatic robots.txt jobs
@@ -321,10 +625,10 @@ void host_remove_job(HOST *host, JOB *job)
 		// If any of these links that are disallowed have been explicitly requested by the user,
 		// we should download them.
 		if (host->robots) {
-			JOB *next, *thejob = wget_list_getfirst(host->queue);
+			JOB *next, *thejob = wget_list_link_first(host->queue);
 
-			for (int max = host->qsize - 1; max > 0; max--, thejob = next) {
-				next = wget_list_getnext(thejob);
+			for (int max = host->qsize - 1; max > 0 && thejob; max--, thejob = next) {
+				next = wget_list_link_next(host->queue, &thejob->node);
 
 				// info_printf("%s: checking '%s' / '%s'\n", __func__, thejob->iri->path, thejob->iri->uri);
 				if (thejob->requested_by_user)
@@ -333,27 +637,21 @@ void host_remove_job(HOST *host, JOB *job)
 				if (thejob->sitemap)
 						continue;
 
-				for (int it = 0; it < wget_vector_size(host->robots->paths); it++) {
-					wget_string_t *path = wget_vector_get(host->robots->paths, it);
-
-					// info_printf("%s: checked robot path '%.*s' / '%s' / '%s'\n", __func__, (int)path->len, path->path, thejob->iri->path, thejob->iri->uri);
-
-					if (path->len && !strncmp(path->p + 1, thejob->iri->path ? thejob->iri->path : "", path->len - 1)) {
-						info_printf(_("URL '%s' not followed (disallowed by robots.txt)\n"), thejob->iri->uri);
-						host_remove_job(host, thejob);
-						break;
-					}
+				if (host_robots_disallowed(host, thejob->iri->path)) {
+					info_printf(_("URL '%s' not followed (disallowed by robots.txt)\n"), thejob->iri->uri);
+					host_remove_job(host, thejob);
 				}
 			}
 		}
 
 //		wget_iri_free(&job->iri);
 		job_free(job);
-		xfree(host->robot_job);
+		job_recycle(&host->robot_job);
 	} else {
 		job_free(job);
 
-		wget_list_remove(&host->queue, job);
+		wget_list_link_remove(&host->queue, &job->node);
+		job_recycle(&job);
 	}
 
 	host->qsize--;
@@ -364,17 +662,126 @@ void host_remove_job(HOST *host, JOB *job)
 	wget_thread_mutex_unlock(&hosts_mutex);
 }
 
+struct _browse_jobs_context {
+	int (*browse)(void *ctx, JOB *job);
+	void *ctx;
+};
+
+static int _browse_host_jobs(struct _browse_jobs_context *bctx, HOST *host)
+{
+	if (host->robot_job && bctx->browse(bctx->ctx, host->robot_job))
+		return 1;
+
+	return wget_list_link_browse(host->queue, (wget_list_browse_t)bctx->browse, bctx->ctx);
+}
+
+// iterate all queued jobs of all hosts, stops (and returns non-zero) if the callback returns non-zero
+int hosts_browse_jobs(int (*browse)(void *ctx, JOB *job), void *ctx)
+{
+	struct _browse_jobs_context bctx = { .browse = browse, .ctx = ctx };
+	int rc;
+
+	wget_thread_mutex_lock(&hosts_mutex);
+	rc = wget_hashmap_browse(hosts, (wget_hashmap_browse_t)_browse_host_jobs, &bctx);
+	wget_thread_mutex_unlock(&hosts_mutex);
+
+	return rc;
+}
+
+static int _collect_https_host(wget_vector_t *v, HOST *host)
+{
+	if (host->scheme == WGET_IRI_SCHEME_HTTPS)
+		wget_vector_add(v, &host, sizeof(host));
+
+	return 0;
+}
+
+// returns a vector of HOST* for all known HTTPS hosts;
+// the entries stay valid until hosts_free()
+wget_vector_t *hosts_get_https(void)
+{
+	wget_vector_t *v = wget_vector_create(16, -2, NULL);
+
+	wget_thread_mutex_lock(&hosts_mutex);
+	if (hosts)
+		wget_hashmap_browse(hosts, (wget_hashmap_browse_t)_collect_https_host, v);
+	wget_thread_mutex_unlock(&hosts_mutex);
+
+	return v;
+}
+
 void hosts_free(void)
 {
+	_dns_prefetch_free(); // joins the resolver pool, must happen before hosts vanish
+
 	// We don't need mutex locking here - this function is called on exit when all threads have ceased.
 	wget_hashmap_free(&hosts);
+	wget_mpmc_queue_free(&ready_hosts);
+}
+
+void host_inc_worker(HOST *host)
+{
+	wget_thread_mutex_lock(&hosts_mutex);
+	host->workers++;
+	debug_printf("%s: %s workers=%d\n", __func__, host->host, host->workers);
+	wget_thread_mutex_unlock(&hosts_mutex);
+}
+
+void host_dec_worker(HOST *host)
+{
+	wget_thread_mutex_lock(&hosts_mutex);
+	host->workers--;
+	debug_printf("%s: %s workers=%d\n", __func__, host->host, host->workers);
+	wget_thread_mutex_unlock(&hosts_mutex);
+}
+
+// Token-bucket politeness (--wait): instead of parking the worker thread in
+// a sleep, stamp the host with the earliest time the next request may go
+// out. host_get_job() holds the host's jobs back until then, so the thread
+// immediately picks work from other hosts.
+void host_delay_request(HOST *host, long long ms)
+{
+	wget_thread_mutex_lock(&hosts_mutex);
+	host->next_request_ts = wget_get_timemillis_coarse() + ms;
+	wget_thread_mutex_unlock(&hosts_mutex);
+}
+
+// remember that this server doesn't cope with pipelined HTTP/1.1 requests,
+// so further connections fall back to one request at a time
+void host_disable_pipelining(HOST *host)
+{
+	wget_thread_mutex_lock(&hosts_mutex);
+	if (!host->pipelining_broken) {
+		host->pipelining_broken = 1;
+		debug_printf("%s: %s\n", __func__, host->host);
+	}
+	wget_thread_mutex_unlock(&hosts_mutex);
 }
 
 void host_increase_failure(HOST *host)
 {
 	wget_thread_mutex_lock(&hosts_mutex);
 	host->failures++;
-	host->retry_ts = wget_get_timemillis() + host->failures * 1000;
+
+	if (host->failures < HOST_BREAKER_THRESHOLD) {
+		host->retry_ts = wget_get_timemillis_coarse() + host->failures * 1000;
+	} else {
+		// breaker open: park the host with exponential backoff. The scheduler
+		// skips parked hosts, so threads immediately move on to other hosts.
+		// Once retry_ts passes, a single probe job goes out (half-open state,
+		// see _search_host_for_free_job) and a success closes the breaker.
+		int shift = host->failures - HOST_BREAKER_THRESHOLD;
+		long long backoff = shift < 6 ? 2000LL << shift : HOST_BREAKER_MAX_BACKOFF;
+		long long cap = config.waitretry ? config.waitretry : HOST_BREAKER_MAX_BACKOFF;
+
+		host->retry_ts = wget_get_timemillis_coarse() + (backoff < cap ? backoff : cap);
+
+		if (!host->breaker_tripped) {
+			host->breaker_tripped = 1;
+			breakers_tripped++;
+			debug_printf("%s: breaker tripped for %s (%d total)\n", __func__, host->host, breakers_tripped);
+		}
+	}
 	debug_printf("%s: %s failures=%d\n", __func__, host->host, host->failures);
 
 	if (config.tries && host->failures >= config.tries) {
@@ -403,12 +810,19 @@ void host_reset_failure(HOST *host)
 	wget_thread_mutex_lock(&hosts_mutex);
 	host->failures = 0;
 	host->retry_ts = 0;
+	if (host->breaker_tripped) {
+		host->breaker_tripped = 0;
+		debug_printf("%s: breaker closed for %s\n", __func__, host->host);
+	}
 	if (host->blocked) {
 		host->blocked = 0;
 		qsize += host->qsize;
 		debug_printf("%s: qsize=%d\n", __func__, qsize);
 	}
 	wget_thread_mutex_unlock(&hosts_mutex);
+
+	if (ready_hosts && host->qsize)
+		wget_mpmc_queue_push(ready_hosts, host);
 }
 
 int queue_empty(void)
@@ -416,24 +830,28 @@ int queue_empty(void)
 	return !qsize;
 }
 
-// did I say, that I like nested function instead using contexts !?
-// gcc, IBM and Intel support nested functions, just clang refuses it
-
-static int _queue_free_func(void *context G_GNUC_WGET_UNUSED, JOB *job)
+int hosts_breakers_tripped(void)
 {
-	job_free(job);
-	return 0;
+	return breakers_tripped;
 }
 
+// did I say, that I like nested function instead using contexts !?
+// gcc, IBM and Intel support nested functions, just clang refuses it
+
 void host_queue_free(HOST *host)
 {
 	wget_thread_mutex_lock(&hosts_mutex);
-	wget_list_browse(host->queue, (wget_list_browse_t)_queue_free_func, NULL);
-	wget_list_free(&host->queue);
+	while (host->queue) {
+		JOB *job = wget_list_link_first(host->queue);
+
+		wget_list_link_remove(&host->queue, &job->node);
+		job_free(job);
+		job_recycle(&job);
+	}
 	if (host->robot_job) {
 		wget_iri_free(&host->robot_job->iri);
 		job_free(host->robot_job);
-		xfree(host->robot_job);
+		job_recycle(&host->robot_job);
 	}
 	if (!host->blocked)
 		qsize -= host->qsize;
@@ -455,7 +873,7 @@ void queue_print(HOST *host)
 		info_printf("%s://%s\n", host->scheme, host->host);
 
 	wget_thread_mutex_lock(&hosts_mutex);
-	wget_list_browse(host->queue, (wget_list_browse_t)_queue_print_func, NULL);
+	wget_list_link_browse(host->queue, (wget_list_browse_t)_queue_print_func, NULL);
 	wget_thread_mutex_unlock(&hosts_mutex);
 }
 
@@ -464,3 +882,29 @@ int queue_size(void)
 	debug_printf("%s: qsize=%d\n", __func__, qsize);
 	return qsize;
 }
+
+struct _pending_count_context {
+	const char *hostname;
+	int count;
+};
+
+static int _count_host_pending(struct _pending_count_context *ctx, HOST *host)
+{
+	if (!wget_strcasecmp_ascii(host->host, ctx->hostname))
+		ctx->count += host->qsize; // same host may appear once per scheme/port
+
+	return 0;
+}
+
+// queued jobs for one host name, summed over all scheme/port variants
+int host_pending_count(const char *hostname)
+{
+	struct _pending_count_context ctx = { .hostname = hostname };
+
+	wget_thread_mutex_lock(&hosts_mutex);
+	if (hosts)
+		wget_hashmap_browse(hosts, (wget_hashmap_browse_t)_count_host_pending, &ctx);
+	wget_thread_mutex_unlock(&hosts_mutex);
+
+	return ctx.count;
+}
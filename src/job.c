@@ -38,16 +38,83 @@
 
 #include "wget_main.h"
 //#include "wget_log.h"
+#include "wget_options.h"
 #include "wget_job.h"
 
+// Thread-local recycling pools: jobs and their parts vectors churn once per
+// URL, so completed objects are stashed per thread and handed out again
+// without hitting malloc (and without any allocator lock contention).
+#if defined __GNUC__ || defined __clang__
+# define JOB_POOL_MAX 64
+# define PARTS_POOL_MAX 16
+static __thread JOB
+	*job_pool[JOB_POOL_MAX];
+static __thread wget_vector_t
+	*parts_pool[PARTS_POOL_MAX];
+static __thread int
+	job_pool_size,
+	parts_pool_size;
+#endif
+
+static JOB *_job_alloc(void)
+{
+#ifdef JOB_POOL_MAX
+	if (job_pool_size > 0)
+		return job_pool[--job_pool_size];
+#endif
+
+	return wget_malloc(sizeof(JOB));
+}
+
+// create (or recycle) a vector to hold <max> PART entries
+static wget_vector_t *_parts_alloc(int max)
+{
+#ifdef PARTS_POOL_MAX
+	if (parts_pool_size > 0)
+		return parts_pool[--parts_pool_size];
+#endif
+
+	return wget_vector_create(max, 4, NULL);
+}
+
 void job_free(JOB *job)
 {
 	if (job->challenges_alloc)
 		wget_http_free_challenges(&job->challenges);
 	wget_http_free_challenges(&job->proxy_challenges);
 	wget_metalink_free(&job->metalink);
+
+#ifdef PARTS_POOL_MAX
+	if (job->parts && parts_pool_size < PARTS_POOL_MAX) {
+		wget_vector_clear(job->parts);
+		parts_pool[parts_pool_size++] = job->parts;
+		job->parts = NULL;
+	} else
+		wget_vector_free(&job->parts);
+#else
 	wget_vector_free(&job->parts);
-	xfree(job->local_filename);
+#endif
+
+	wget_refstr_unref(&job->local_filename);
+	wget_html_free_urls_inline(&job->parsed_html);
+}
+
+// return a heap-allocated JOB to the recycling pool, counterpart of job_init(NULL, ...).
+// job_free() must have been called before.
+void job_recycle(JOB **job)
+{
+	if (!job || !*job)
+		return;
+
+#ifdef JOB_POOL_MAX
+	if (job_pool_size < JOB_POOL_MAX) {
+		job_pool[job_pool_size++] = *job;
+		*job = NULL;
+		return;
+	}
+#endif
+
+	wget_xfree(*job);
 }
 
 void job_create_parts(JOB *job)
@@ -63,7 +130,7 @@ void job_create_parts(JOB *job)
 
 	// create space to hold enough parts
 	if (!job->parts)
-		job->parts = wget_vector_create(wget_vector_size(metalink->pieces), 4, NULL);
+		job->parts = _parts_alloc(wget_vector_size(metalink->pieces));
 	else
 		wget_vector_clear(job->parts);
 
@@ -96,6 +163,10 @@ static int check_piece_hash(wget_metalink_hash_t *hash, int fd, off_t offset, si
 {
 	char sum[128 + 1]; // large enough for sha-512 hex
 
+	// the non-mmap fallback reads from the current position
+	if (lseek(fd, offset, SEEK_SET) == (off_t) -1)
+		return -1;
+
 	if (wget_hash_file_fd(hash->type, fd, sum, sizeof(sum), offset, length) != -1) {
 		return !wget_strcasecmp_ascii(sum, hash->hash_hex);
 	}
@@ -119,6 +190,137 @@ static int check_file_hash(HASH *hash, const char *fname)
 }
 */
 
+// Sidecar with verified piece state ("<name>.pieces"): a resumed download
+// only hashes the pieces that weren't already verified by an earlier run,
+// instead of rehashing everything downloaded so far. The sidecar records
+// the expected hash per verified piece and is dropped once the whole file
+// checks out - unless --delta-sidecar keeps it around, turning the next
+// re-mirror of a changed file into Range requests for just the pieces
+// whose server-side hash moved.
+static char *_piece_state_fname(const wget_metalink_t *metalink)
+{
+	return wget_aprintf("%s.pieces", metalink->name);
+}
+
+static void _piece_state_load(const wget_metalink_t *metalink, unsigned char *verified, int npieces)
+{
+	char *fname = _piece_state_fname(metalink);
+	FILE *fp = fopen(fname, "r");
+	long long size;
+	int n;
+
+	xfree(fname);
+	if (!fp)
+		return;
+
+	// With --delta-sidecar the geometry gate is skipped: a grown or shrunk
+	// file invalidates pieces by hash, not wholesale - each entry is only
+	// trusted if its expected hash still matches the current description.
+	if (fscanf(fp, "size %lld npieces %d\n", &size, &n) == 2
+		&& ((size == (long long) metalink->size && n == npieces) || config.delta_sidecar))
+	{
+		char type[16], hex[129];
+		int id;
+
+		while (fscanf(fp, "piece %d %15s %128s\n", &id, type, hex) == 3) {
+			if (id < 1 || id > npieces)
+				continue;
+
+			wget_metalink_piece_t *piece = wget_vector_get(metalink->pieces, id - 1);
+
+			// only trust the entry if the expected hash still matches the metalink
+			if (!wget_strcasecmp_ascii(type, piece->hash.type)
+				&& !wget_strcasecmp_ascii(hex, piece->hash.hash_hex))
+				verified[id - 1] = 1;
+		}
+	}
+
+	fclose(fp);
+}
+
+static void _piece_state_save(const wget_metalink_t *metalink, const unsigned char *bad, int npieces)
+{
+	char *fname = _piece_state_fname(metalink);
+	FILE *fp = fopen(fname, "w");
+
+	if (fp) {
+		fprintf(fp, "size %lld npieces %d\n", (long long) metalink->size, npieces);
+
+		for (int it = 0; it < npieces; it++) {
+			if (!bad[it]) {
+				wget_metalink_piece_t *piece = wget_vector_get(metalink->pieces, it);
+
+				fprintf(fp, "piece %d %s %s\n", it + 1, piece->hash.type, piece->hash.hash_hex);
+			}
+		}
+
+		fclose(fp);
+	} else
+		debug_printf("Failed to save piece state '%s.pieces' (errno=%d)\n", metalink->name, errno);
+
+	xfree(fname);
+}
+
+static void _piece_state_drop(const wget_metalink_t *metalink)
+{
+	char *fname = _piece_state_fname(metalink);
+
+	unlink(fname);
+	xfree(fname);
+}
+
+// pieces are independent, so piece verification fans out over a small
+// hasher pool - validating a large artifact then scales with the cores
+// instead of hanging on one. Each hasher opens its own fd (the offsets
+// would race on a shared one).
+#define PIECE_HASH_MAX_THREADS 8
+
+struct piece_check_context {
+	wget_metalink_t
+		*metalink;
+	PART
+		*geometry; // position/length per piece, precomputed
+	unsigned char
+		*verified, // pieces already verified by an earlier run, skipped here
+		*bad; // per-piece verdict, 1 = requeue
+	wget_thread_mutex_t
+		mutex;
+	int
+		next, // next piece to pick up
+		npieces;
+};
+
+static void *_piece_check_thread(void *p)
+{
+	struct piece_check_context *ctx = p;
+	int fd = open(ctx->metalink->name, O_RDONLY | O_BINARY);
+
+	for (;;) {
+		int it;
+
+		wget_thread_mutex_lock(&ctx->mutex);
+		it = ctx->next < ctx->npieces ? ctx->next++ : -1;
+		wget_thread_mutex_unlock(&ctx->mutex);
+
+		if (it < 0)
+			break;
+
+		if (ctx->verified[it])
+			continue; // already verified by an earlier run
+
+		wget_metalink_piece_t *piece = wget_vector_get(ctx->metalink->pieces, it);
+		PART *part = &ctx->geometry[it];
+
+		if (fd == -1 || check_piece_hash(&piece->hash, fd, part->position, part->length) != 1)
+			ctx->bad[it] = 1;
+	}
+
+	if (fd != -1)
+		close(fd);
+
+	return NULL;
+}
+
 static int _check_file_fd(wget_metalink_hash_t *hash, int fd)
 {
 	char sum[128 + 1]; // large enough for sha-512 hex
@@ -162,7 +364,7 @@ int job_validate_file(JOB *job)
 
 	// create space to hold enough parts
 	if (!job->parts)
-		job->parts = wget_vector_create(wget_vector_size(metalink->pieces), 4, NULL);
+		job->parts = _parts_alloc(wget_vector_size(metalink->pieces));
 	else
 		wget_vector_clear(job->parts);
 
@@ -201,6 +403,15 @@ int job_validate_file(JOB *job)
 
 		if (rc == 1) {
 			info_printf(_("Checksum OK for '%s'\n"), metalink->name);
+			if (config.delta_sidecar) {
+				// keep the all-verified digests for the next re-mirror run
+				int npieces = wget_vector_size(metalink->pieces);
+				unsigned char *bad = wget_calloc(npieces, 1);
+
+				_piece_state_save(metalink, bad, npieces);
+				xfree(bad);
+			} else
+				_piece_state_drop(metalink);
 			close(fd);
 			return 1; // we are done
 		}
@@ -208,6 +419,7 @@ int job_validate_file(JOB *job)
 		if (rc == -1) {
 			// failed to check file, continue as if file is ok
 			info_printf(_("Failed to build checksum, assuming file to be OK\n"));
+			_piece_state_drop(metalink);
 			close(fd);
 			return 1; // we are done
 		}
@@ -217,9 +429,23 @@ int job_validate_file(JOB *job)
 //		if (vec_size(metalink->pieces) < 1)
 //			return;
 
-		for (int it = 0; errno != EINTR && it < wget_vector_size(metalink->pieces); it++) {
+		struct piece_check_context ctx = {
+			.metalink = metalink,
+			.npieces = wget_vector_size(metalink->pieces),
+		};
+		wget_thread_t tid[PIECE_HASH_MAX_THREADS];
+		int nthreads = 0;
+
+		ctx.geometry = wget_malloc(ctx.npieces * sizeof(PART));
+		ctx.verified = wget_calloc(ctx.npieces, 1);
+		ctx.bad = wget_calloc(ctx.npieces, 1);
+		wget_thread_mutex_init(&ctx.mutex);
+
+		_piece_state_load(metalink, ctx.verified, ctx.npieces);
+
+		// the piece geometry is cumulative, lay it out up front
+		for (int it = 0; it < ctx.npieces; it++) {
 			wget_metalink_piece_t *piece = wget_vector_get(metalink->pieces, it);
-			wget_metalink_hash_t *hash = &piece->hash;
 
 			if (fsize >= piece->length) {
 				part.length = piece->length;
@@ -228,17 +454,35 @@ int job_validate_file(JOB *job)
 			}
 
 			part.id = it + 1;
-
-			if ((rc = check_piece_hash(hash, fd, part.position, part.length)) != 1) {
-				info_printf(_("Piece %d/%d not OK - requeuing\n"), it + 1, wget_vector_size(metalink->pieces));
-				wget_vector_add(job->parts, &part, sizeof(PART));
-				debug_printf("  need to download %llu bytes from pos=%llu\n",
-					(unsigned long long)part.length, (unsigned long long)part.position);
-			}
+			ctx.geometry[it] = part;
 
 			part.position += part.length;
 			fsize -= piece->length;
 		}
+
+		while (nthreads < PIECE_HASH_MAX_THREADS && nthreads + 1 < ctx.npieces
+			&& wget_thread_start(&tid[nthreads], _piece_check_thread, &ctx, 0) == 0)
+			nthreads++;
+
+		_piece_check_thread(&ctx); // this thread hashes too
+		for (int it = 0; it < nthreads; it++)
+			wget_thread_join(tid[it]);
+
+		for (int it = 0; it < ctx.npieces; it++) {
+			if (ctx.bad[it]) {
+				info_printf(_("Piece %d/%d not OK - requeuing\n"), it + 1, ctx.npieces);
+				wget_vector_add(job->parts, &ctx.geometry[it], sizeof(PART));
+				debug_printf("  need to download %llu bytes from pos=%llu\n",
+					(unsigned long long)ctx.geometry[it].length, (unsigned long long)ctx.geometry[it].position);
+			}
+		}
+
+		// remember what is verified now, so the next resume skips it
+		_piece_state_save(metalink, ctx.bad, ctx.npieces);
+
+		xfree(ctx.geometry);
+		xfree(ctx.verified);
+		xfree(ctx.bad);
 		close(fd);
 	} else {
 //		info_printf("real_fsize = %lld\n", (long long) real_fsize);
@@ -274,13 +518,51 @@ int job_validate_file(JOB *job)
 	return 0;
 }
 
+// backoff before the second attempt of a job, doubled per further failure
+#define JOB_BACKOFF_BASE 1000
+// backoff never grows beyond this (unless --waitretry says otherwise)
+#define JOB_BACKOFF_MAX 60000
+
+// Stamp a failed job with the earliest timestamp of its next attempt.
+// The job stays in its host queue, host_get_job() just skips it until the
+// stamp passed - no thread ever sleeps on a retry. The delay doubles with
+// every failure and is randomized by +/-50%, so jobs that failed together
+// (a host coming back from an outage) don't hammer it in lockstep again.
+void job_backoff(JOB *job)
+{
+	int shift = job->failures < 10 ? job->failures : 10;
+	long long backoff = (long long) JOB_BACKOFF_BASE << shift;
+	long long cap = config.waitretry ? config.waitretry : JOB_BACKOFF_MAX;
+
+	if (backoff > cap)
+		backoff = cap;
+
+	// (0.5 - 1.5) * backoff
+	backoff = backoff / 2 + rand() % (backoff + 1);
+
+	job->failures++;
+	job->retry_ts = wget_get_timemillis_coarse() + backoff;
+
+	debug_printf("job %s failures=%d retry in %lldms\n",
+		job->iri ? job->iri->uri : "?", job->failures, backoff);
+}
+
 JOB *job_init(JOB *job, wget_iri_t *iri)
 {
 	if (!job)
-		job = wget_calloc(1, sizeof(JOB));
-	else
-		memset(job, 0, sizeof(JOB));
+		job = _job_alloc(); // fresh or recycled, zeroed below either way
+
+	memset(job, 0, sizeof(JOB));
 
 	job->iri = iri;
 	return job;
 }
+
+// heap copy of a (stack) JOB, e.g. for linking it into a host queue
+JOB *job_dup(const JOB *job)
+{
+	JOB *jobp = _job_alloc();
+
+	memcpy(jobp, job, sizeof(JOB));
+	return jobp;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Constant-memory latency histograms
+ *
+ * The --stats-* collection keeps one record per request, which is fine
+ * for exporting everything but costs hundreds of MB on million-request
+ * crawls. This module keeps a fixed-size histogram per host and phase
+ * instead: power-of-two millisecond buckets, so a histogram is a few
+ * hundred bytes no matter how many requests feed it. Percentiles are
+ * estimated from the bucket counts at print time (the per-host
+ * histograms are merged into one per phase), accurate to bucket
+ * resolution - plenty for telling a 40ms host from a 4s one.
+ *
+ * Collection is always on; the summary is printed at debug level by
+ * stats_print(), so a crawl with -d always ends with p50/p95/p99 per
+ * phase without any giant CSVs in between.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_latency.h"
+
+// bucket b >= 1 covers [2^(b-1), 2^b) ms, bucket 0 is '< 1ms'
+#define LATENCY_BUCKETS 32
+
+typedef struct {
+	long long
+		counts[LATENCY_BUCKETS],
+		count,
+		sum,
+		max;
+} latency_histogram_t;
+
+typedef struct {
+	latency_histogram_t
+		h[LATENCY_PHASE_MAX];
+} host_latency_t;
+
+// must match latency_phase_t slot for slot
+static const char *phase_names[LATENCY_PHASE_MAX] = {
+	"dns",
+	"tls",
+	"ttfb",
+	"total",
+};
+
+static wget_stringmap_t
+	*hosts; // host name -> host_latency_t
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static int _bucket(long long ms)
+{
+	int b = 0;
+
+	while (ms > 0 && b < LATENCY_BUCKETS - 1) {
+		ms >>= 1;
+		b++;
+	}
+
+	return b;
+}
+
+static void _histogram_add(latency_histogram_t *h, long long ms)
+{
+	h->counts[_bucket(ms)]++;
+	h->count++;
+	h->sum += ms;
+	if (ms > h->max)
+		h->max = ms;
+}
+
+void latency_add(const char *host, latency_phase_t phase, long long ms)
+{
+	host_latency_t *entry;
+
+	if (!host || ms < 0)
+		return;
+
+	wget_thread_mutex_lock(&mutex);
+
+	if (!hosts)
+		hosts = wget_stringmap_create(64);
+
+	if (!wget_stringmap_get_null(hosts, host, (void **) &entry)) {
+		entry = wget_calloc(1, sizeof(host_latency_t));
+		wget_stringmap_put_noalloc(hosts, wget_strdup(host), entry);
+	}
+
+	_histogram_add(&entry->h[phase], ms);
+
+	wget_thread_mutex_unlock(&mutex);
+}
+
+// estimate: walk the cumulative counts, report the bucket's midpoint
+static long long _histogram_percentile(const latency_histogram_t *h, int percentile)
+{
+	long long rank = (h->count * percentile + 99) / 100;
+	long long seen = 0;
+
+	for (int b = 0; b < LATENCY_BUCKETS; b++) {
+		seen += h->counts[b];
+		if (seen >= rank) {
+			if (b == 0)
+				return 0;
+			long long lo = 1LL << (b - 1), hi = 1LL << b;
+			return (lo + hi) / 2 < h->max ? (lo + hi) / 2 : h->max;
+		}
+	}
+
+	return h->max;
+}
+
+struct _merge_context {
+	latency_histogram_t
+		merged[LATENCY_PHASE_MAX];
+	int
+		nhosts;
+};
+
+static int _merge_host(struct _merge_context *ctx, const char *host G_GNUC_WGET_UNUSED, host_latency_t *entry)
+{
+	for (int phase = 0; phase < LATENCY_PHASE_MAX; phase++) {
+		latency_histogram_t *from = &entry->h[phase], *to = &ctx->merged[phase];
+
+		for (int b = 0; b < LATENCY_BUCKETS; b++)
+			to->counts[b] += from->counts[b];
+		to->count += from->count;
+		to->sum += from->sum;
+		if (from->max > to->max)
+			to->max = from->max;
+	}
+	ctx->nhosts++;
+
+	return 0;
+}
+
+void latency_print(void)
+{
+	struct _merge_context ctx;
+
+	memset(&ctx, 0, sizeof(ctx));
+
+	wget_thread_mutex_lock(&mutex);
+	if (hosts)
+		wget_stringmap_browse(hosts, (wget_stringmap_browse_t) _merge_host, &ctx);
+	wget_thread_mutex_unlock(&mutex);
+
+	if (!ctx.nhosts)
+		return;
+
+	debug_printf("latency: %d host%s\n", ctx.nhosts, ctx.nhosts != 1 ? "s" : "");
+
+	for (int phase = 0; phase < LATENCY_PHASE_MAX; phase++) {
+		latency_histogram_t *h = &ctx.merged[phase];
+
+		if (!h->count)
+			continue;
+
+		debug_printf("latency: %-5s n=%lld avg=%lldms p50=%lldms p95=%lldms p99=%lldms max=%lldms\n",
+			phase_names[phase], h->count, h->sum / h->count,
+			_histogram_percentile(h, 50), _histogram_percentile(h, 95),
+			_histogram_percentile(h, 99), h->max);
+	}
+}
+
+void latency_free(void)
+{
+	wget_thread_mutex_lock(&mutex);
+	wget_stringmap_free(&hosts); // frees the keys and histogram values too
+	wget_thread_mutex_unlock(&mutex);
+}
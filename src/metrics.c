@@ -0,0 +1,263 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Low-overhead crawl metrics
+ *
+ * The --stats-* machinery keeps one record per event in mutex-guarded
+ * vectors, which is fine for a post-run report but too expensive to leave
+ * enabled on long production crawls. This module instead keeps a fixed
+ * slot of counters per thread: the owning thread increments without any
+ * locking, a snapshot just sums the per-thread blocks. With
+ * --metrics-file the current totals are appended periodically as one
+ * JSON object (or CSV row) per line, so a crawl can be watched live with
+ * tail -f or scraped by a collector.
+ *
+ * Thread blocks are registered once per thread under a mutex and never
+ * freed while the crawl runs - a thread that exits (the pool shrinks when
+ * idle) leaves its counts in place, so totals are never lost.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#ifdef HAVE_GETRUSAGE
+# include <sys/resource.h>
+#endif
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_metrics.h"
+
+// must match metrics_counter_t slot for slot
+static const char *counter_names[METRICS_MAX] = {
+	"http_requests",
+	"http_ok",
+	"http_redirects",
+	"http_notmodified",
+	"http_errors",
+	"chunks",
+	"files_saved",
+	"bytes",
+	"dns_lookups",
+	"dns_ms",
+	"tls_handshakes",
+	"tls_ms",
+};
+
+typedef struct metrics_block_st metrics_block_t;
+struct metrics_block_st {
+	long long
+		c[METRICS_MAX];
+	metrics_block_t
+		*next;
+};
+
+static metrics_block_t
+	*blocks; // all per-thread blocks, only ever prepended
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER; // guards registration and the dump file only
+static FILE
+	*metrics_fp;
+static bool
+	csv, csv_header_written;
+
+#if defined __GNUC__ || defined __clang__
+static __thread metrics_block_t *my_block;
+#else
+// without thread-local storage fall back to one shared block; the counters
+// then race, but stay roughly right and never block anyone
+static metrics_block_t *my_block;
+#endif
+
+// counters are written by the owning thread only, so a plain add suffices;
+// the relaxed atomic store just keeps snapshot reads from seeing torn values
+static void _counter_add(long long *counter, long long value)
+{
+#if defined __GNUC__ || defined __clang__
+	__atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+#else
+	*counter += value;
+#endif
+}
+
+static long long _counter_read(const long long *counter)
+{
+#if defined __GNUC__ || defined __clang__
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+#else
+	return *counter;
+#endif
+}
+
+void metrics_add(metrics_counter_t counter, long long value)
+{
+	metrics_block_t *block = my_block;
+
+	if (!block) {
+		block = wget_calloc(1, sizeof(metrics_block_t));
+
+		wget_thread_mutex_lock(&mutex);
+		block->next = blocks;
+		blocks = block;
+		wget_thread_mutex_unlock(&mutex);
+
+		my_block = block;
+	}
+
+	_counter_add(&block->c[counter], value);
+}
+
+// peak resident set size in KiB, 0 where the platform can't tell us.
+// A gauge rather than a counter: deep crawls should show a flat watermark,
+// a sawtooth climbing with recursion depth means buffers outlive their use.
+static long long _rss_hwm_kb(void)
+{
+#ifdef HAVE_GETRUSAGE
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		return (long long) ru.ru_maxrss;
+#endif
+	return 0;
+}
+
+// sum all thread blocks into <totals> - lock-free, each value is consistent
+// on its own though the snapshot as a whole may be a few increments skewed
+static void _snapshot(long long totals[METRICS_MAX])
+{
+	memset(totals, 0, METRICS_MAX * sizeof(long long));
+
+	for (metrics_block_t *block = blocks; block; block = block->next)
+		for (int it = 0; it < METRICS_MAX; it++)
+			totals[it] += _counter_read(&block->c[it]);
+}
+
+// current total of one counter, e.g. for the telemetry socket
+long long metrics_read(metrics_counter_t counter)
+{
+	long long total = 0;
+
+	for (metrics_block_t *block = blocks; block; block = block->next)
+		total += _counter_read(&block->c[counter]);
+
+	return total;
+}
+
+// lightweight replacement for the stats vector callback: registered by
+// stats_init() for DNS/TLS when the full --stats-* collection is off
+void metrics_stats_callback(wget_stats_type_t type, const void *stats)
+{
+	const long long *ms;
+
+	switch (type) {
+	case WGET_STATS_TYPE_DNS:
+		metrics_add(METRICS_DNS_LOOKUPS, 1);
+		if ((ms = wget_tcp_get_stats_dns(WGET_STATS_DNS_SECS, stats)))
+			metrics_add(METRICS_DNS_MS, *ms);
+		break;
+
+	case WGET_STATS_TYPE_TLS:
+		metrics_add(METRICS_TLS_HANDSHAKES, 1);
+		if ((ms = wget_tcp_get_stats_tls(WGET_STATS_TLS_SECS, stats)))
+			metrics_add(METRICS_TLS_MS, *ms);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void metrics_init(void)
+{
+	if (!config.metrics_file)
+		return;
+
+	csv = !wget_strcasecmp_ascii(config.metrics_format, "csv");
+
+	if (!strcmp(config.metrics_file, "-"))
+		metrics_fp = stdout;
+	else if (!(metrics_fp = fopen(config.metrics_file, "a")))
+		error_printf(_("Failed to open metrics file '%s' (errno=%d)\n"), config.metrics_file, errno);
+}
+
+void metrics_dump(void)
+{
+	long long totals[METRICS_MAX];
+
+	if (!metrics_fp)
+		return;
+
+	_snapshot(totals);
+
+	if (csv) {
+		if (!csv_header_written) {
+			fputs("ts", metrics_fp);
+			for (int it = 0; it < METRICS_MAX; it++)
+				fprintf(metrics_fp, ",%s", counter_names[it]);
+			fputs(",rss_hwm_kb", metrics_fp);
+			fputc('\n', metrics_fp);
+			csv_header_written = true;
+		}
+
+		fprintf(metrics_fp, "%lld", (long long) time(NULL));
+		for (int it = 0; it < METRICS_MAX; it++)
+			fprintf(metrics_fp, ",%lld", totals[it]);
+		fprintf(metrics_fp, ",%lld", _rss_hwm_kb());
+		fputc('\n', metrics_fp);
+	} else {
+		// one JSON object per line, counters are fixed so no escaping needed
+		fprintf(metrics_fp, "{\"ts\":%lld", (long long) time(NULL));
+		for (int it = 0; it < METRICS_MAX; it++)
+			fprintf(metrics_fp, ",\"%s\":%lld", counter_names[it], totals[it]);
+		fprintf(metrics_fp, ",\"rss_hwm_kb\":%lld", _rss_hwm_kb());
+		fputs("}\n", metrics_fp);
+	}
+
+	// consumers tail the file, don't sit on buffered rows
+	fflush(metrics_fp);
+}
+
+void metrics_exit(void)
+{
+	metrics_block_t *block;
+
+	debug_printf("peak RSS %lld KiB\n", _rss_hwm_kb());
+
+	if (metrics_fp) {
+		metrics_dump(); // final totals
+		if (metrics_fp != stdout)
+			fclose(metrics_fp);
+		metrics_fp = NULL;
+	}
+
+	while ((block = blocks)) {
+		blocks = block->next;
+		xfree(block);
+	}
+	my_block = NULL;
+}
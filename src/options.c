@@ -61,6 +61,8 @@
 #include "wget_dl.h"
 #include "wget_plugin.h"
 #include "wget_stats.h"
+#include "wget_metrics.h"
+#include "wget_trace.h"
 
 static int
 	exit_status;
@@ -842,8 +844,14 @@ struct config config = {
 	.read_timeout = 900 * 1000, // 900s
 	.max_redirect = 20,
 	.max_threads = 5,
+	.parse_workers = 1,
+	.snapshot_interval = 60,
+	.metrics_format = "json",
+	.metrics_interval = 10,
+	.shard_dir = ".",
 	.dns_caching = 1,
 	.tcp_fastopen = 1,
+	.simd = 1,
 	.user_agent = PACKAGE_NAME"/"PACKAGE_VERSION,
 	.verbose = 1,
 	.check_certificate=1,
@@ -868,8 +876,8 @@ struct config config = {
 	.hpkp = 1,
 #if defined WITH_LIBNGHTTP2
 	.http2 = 1,
+	.http2_server_push = 1,
 	.http2_request_window = 30,
-	.http1_request_window = 10,
 #endif
 	.ocsp = 1,
 	.ocsp_stapling = 1,
@@ -883,6 +891,7 @@ struct config config = {
 	.restrict_file_names = WGET_RESTRICT_NAMES_WINDOWS,
 #endif
 	.xattr = 1,
+	.body_cache = 1,
 	.local_db = 1
 };
 
@@ -911,6 +920,12 @@ static const struct optionw options[] = {
 		  "(default: off)\n"
 		}
 	},
+	{ "alloc-stats", &config.alloc_stats, parse_bool, -1, 0,
+		SECTION_STARTUP,
+		{ "Count allocations per subsystem, report at exit.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "append-output", &config.logfile_append, parse_string, 1, 'a',
 		SECTION_STARTUP,
 		{ "File where messages are appended to,\n",
@@ -922,6 +937,14 @@ static const struct optionw options[] = {
 		{ "Print prompt for password\n"
 		}
 	},
+	{ "async-log", &config.async_log, parse_bool, -1, 0,
+		SECTION_STARTUP,
+		{ "Format log messages on the calling thread but\n",
+		  "write them from a background thread, so verbose\n",
+		  "output doesn't serialize the downloaders.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "auth-no-challenge", &config.auth_no_challenge, parse_bool, -1, 0,
 		SECTION_HTTP,
 		{ "send Basic HTTP Authentication before challenge\n" }
@@ -950,6 +973,19 @@ static const struct optionw options[] = {
 		  "(default: automatic)\n"
 		}
 	},
+	{ "bind-cpus", &config.bind_cpus, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Pin each downloader thread to one CPU, so its\n",
+		  "buffers stay on the local memory node. (default: off)\n"
+		}
+	},
+	{ "body-cache", &config.body_cache, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Keep documents for --convert-links compressed\n",
+		  "in memory instead of re-reading them from disk.\n",
+		  "(default: on)\n"
+		}
+	},
 	{ "ca-certificate", &config.ca_cert, parse_string, 1, 0,
 		SECTION_SSL,
 		{ "File with bundle of PEM CA certificates.\n"
@@ -965,6 +1001,19 @@ static const struct optionw options[] = {
 		{ "Enabled using of server cache. (default: on)\n"
 		}
 	},
+	{ "caps", &config.caps, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Remember per-host capabilities (ALPN protocol,\n",
+		  "byte ranges, keep-alive) across invocations.\n",
+		  "(default: off)\n"
+		}
+	},
+	{ "caps-file", &config.caps_file, parse_filename, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Set file for the per-host capability cache.\n",
+		  "(default: ~/.wget-caps)\n"
+		}
+	},
 	{ "certificate", &config.cert_file, parse_string, 1, 0,
 		SECTION_SSL,
 		{ "File with client certificate.\n"
@@ -999,11 +1048,24 @@ static const struct optionw options[] = {
 		{ "Enable file clobbering. (default: on)\n"
 		}
 	},
+	{ "compact-blacklist", &config.compact_blacklist, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Store URL digests instead of full IRIs in the\n",
+		  "blacklist, reducing memory use on huge crawls.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "config", &config.config_files, parse_filenames, 1, 0,
 		SECTION_STARTUP,
 		{ "Backward compatibility\n"
 		}
 	}, // for backward compatibility only
+	{ "config-cache", &config.config_cache, parse_bool, -1, 0,
+		SECTION_STARTUP,
+		{ "Keep a binary snapshot of each parsed config file\n",
+		  "and replay it while it is unchanged. (default: off)\n"
+		}
+	},
 	{ "config-file", &config.config_files, parse_filenames, 1, 0,
 		SECTION_STARTUP,
 		{ "Path to a wgetrc file.\n"
@@ -1071,6 +1133,18 @@ static const struct optionw options[] = {
 		{ "Cut HTTP GET vars from URLs. (default: off)\n"
 		}
 	},
+	{ "daemon-fetch", &config.daemon_fetch, parse_filename, 1, 0,
+		SECTION_STARTUP,
+		{ "Forward the given URLs to a resident daemon at\n",
+		  "this Unix socket, then exit. (default: none)\n"
+		}
+	},
+	{ "daemon-socket", &config.daemon_socket, parse_filename, 1, 0,
+		SECTION_STARTUP,
+		{ "Stay resident and accept fetch commands on this\n",
+		  "Unix socket. (default: none)\n"
+		}
+	},
 	{ "debug", &config.debug, parse_bool, -1, 'd',
 		SECTION_STARTUP,
 		{ "Print debugging messages.(default: off)\n"
@@ -1081,11 +1155,25 @@ static const struct optionw options[] = {
 		{ "Default file name. (default: index.html)\n"
 		}
 	},
+	{ "dedup-content", &config.dedup_content, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Replace downloads whose content was already\n",
+		  "saved before by a hardlink to the first copy.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "delete-after", &config.delete_after, parse_bool, -1, 0,
 		SECTION_DOWNLOAD,
 		{ "Don't save downloaded files. (default: off)\n"
 		}
 	},
+	{ "delta-sidecar", &config.delta_sidecar, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Keep piece-digest sidecars of mirrored files, so\n",
+		  "a later run re-fetches only the changed ranges.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "directories", &config.directories, parse_bool, -1, 0,
 		SECTION_DIRECTORY,
 		{ "Create hierarchy of directories when retrieving\n",
@@ -1097,6 +1185,12 @@ static const struct optionw options[] = {
 		{ "Set directory prefix.\n"
 		}
 	},
+	{ "dns-cache-file", &config.dns_cache_file, parse_filename, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Persist the DNS cache into FILE and load it on startup,\n",
+		  "avoiding re-resolving on repeated invocations.\n"
+		}
+	},
 	{ "dns-caching", &config.dns_caching, parse_bool, -1, 0,
 		SECTION_DOWNLOAD,
 		{ "Caching of domain name lookups. (default: on)\n"
@@ -1118,6 +1212,19 @@ static const struct optionw options[] = {
 		  "Entropy Gathering Daemon.\n"
 		}
 	},
+	{ "etag-file", &config.etag_file, parse_filename, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Set file for ETag/Last-Modified caching.\n",
+		  "(default: ~/.wget-etags)\n"
+		}
+	},
+	{ "etags", &config.etags, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Remember ETag/Last-Modified validators across\n",
+		  "invocations and make requests conditional.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "exclude-domains", &config.exclude_domains, parse_stringlist, 1, 0,
 		SECTION_DOWNLOAD,
 		{ "Comma-separated list of domains NOT to follow.\n"
@@ -1128,6 +1235,26 @@ static const struct optionw options[] = {
 		{ "Wget compatibility option, not needed for Wget\n"
 		}
 	},
+	{ "fast-exit", &config.fast_exit, parse_bool, -1, 0,
+		SECTION_STARTUP,
+		{ "Exit without heap teardown, a forked child\n",
+		  "flushes snapshot/database state. (default: off)\n"
+		}
+	},
+	{ "fd-limit", &config.fd_limit, parse_integer, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Pause new downloads when the process has this\n",
+		  "many open file descriptors. (default: 0 = derive\n",
+		  "from the system limit)\n"
+		}
+	},
+	{ "feed-cursors", &config.feed_cursors_file, parse_filename, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "File to load/save per-feed timestamp cursors,\n",
+		  "so re-polled Atom/RSS feeds only scan new entries.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "filter-urls", &config.filter_urls, parse_bool, 0, 0,
 		SECTION_DOWNLOAD,
 		{ "Apply the accept and reject filters on the URL before starting a download.\n",
@@ -1185,6 +1312,20 @@ static const struct optionw options[] = {
 		{ "Treat input file as Sitemap. (default: off) (NEW!)\n"
 		}
 	},
+	{ "fresh-for", &config.fresh_for, parse_integer, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Skip URLs whose validators were stored less than\n",
+		  "this many seconds ago without any request, needs\n",
+		  "--etags. (default: 0 (=off))\n"
+		}
+	},
+	{ "frontier-cap", &config.frontier_cap, parse_integer, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Maximum number of queued jobs held in memory,\n",
+		  "further URLs are spilled to a spool file and\n",
+		  "re-injected as the queue drains. (default: 0 (=off))\n"
+		}
+	},
 	{ "fsync-policy", &config.fsync_policy, parse_bool, -1, 0,
 		SECTION_STARTUP,
 		{ "Use fsync() to wait for data being written to\n",
@@ -1278,11 +1419,23 @@ static const struct optionw options[] = {
 		  "(default: empty username)\n"
 		}
 	},
+	{ "http1-request-window", &config.http1_request_window, parse_integer, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Number of HTTP/1.1 requests to pipeline on one\n",
+		  "connection (GET/HEAD only). (default: 0 (=off))\n"
+		}
+	},
 	{ "http2", &config.http2, parse_bool, -1, 0,
 		SECTION_SSL,
 		{ "Use HTTP/2 protocol if possible. (default: on)\n"
 		}
 	},
+	{ "http2-server-push", &config.http2_server_push, parse_bool, -1, 0,
+		SECTION_SSL,
+		{ "Accept resources pushed by HTTP/2 servers,\n",
+		  "saving a request round trip each. (default: on)\n"
+		}
+	},
 	{ "https-only", &config.https_only, parse_bool, -1, 0,
 		SECTION_SSL,
 		{ "Do not follow non-secure URLs. (default: off).\n"
@@ -1342,6 +1495,12 @@ static const struct optionw options[] = {
 		{ "Maximum recursion depth. (default: 5)\n"
 		}
 	},
+	{ "limit-rate", &config.limit_rate, parse_numbytes, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Limit the transfer rate to given number of bytes/second.\n",
+		  "(default: 0 (=off)) Example: wget --limit-rate=500k\n"
+		}
+	},
 	{ "list-plugins", NULL, list_plugins, 0, 0,
 		SECTION_STARTUP,
 		{ "Lists all the plugins in the plugin search paths.\n"
@@ -1379,17 +1538,47 @@ static const struct optionw options[] = {
 		  "(default: 5) (NEW!)\n"
 		}
 	},
+	{ "memory-limit", &config.memory_limit, parse_numbytes, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Pause new downloads while the process uses more\n",
+		  "than this much memory. (default: 0 = off)\n"
+		}
+	},
 	{ "metalink", &config.metalink, parse_bool, -1, 0,
 		SECTION_HTTP,
 		{ "Follow a metalink file instead of storing it\n",
 		  "(default: on)\n"
 		}
 	},
+	{ "metrics-file", &config.metrics_file, parse_string, 1, 0,
+		SECTION_STARTUP,
+		{ "File ('-' = STDOUT) for periodic dumps of the\n",
+		  "crawl counters, one record per line.\n"
+		}
+	},
+	{ "metrics-format", &config.metrics_format, parse_string, 1, 0,
+		SECTION_STARTUP,
+		{ "Format of the metrics dumps: json or csv.\n",
+		  "(default: json)\n"
+		}
+	},
+	{ "metrics-interval", &config.metrics_interval, parse_integer, 1, 0,
+		SECTION_STARTUP,
+		{ "Seconds between metrics dumps. (default: 10)\n"
+		}
+	},
 	{ "mirror", &config.mirror, parse_mirror, -1, 'm',
 		SECTION_DOWNLOAD,
 		{ "Turn on mirroring options -r -N -l inf\n"
 		}
 	},
+	{ "mmap-output", &config.mmap_output, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Receive large known-length files into a file\n",
+		  "mapping instead of write() per chunk.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "n", NULL, parse_n_option, 1, 'n',
 		SECTION_STARTUP,
 		{ "Special compatibility option\n"
@@ -1437,6 +1626,14 @@ static const struct optionw options[] = {
 		  "'-' for STDOUT.\n"
 		}
 	},
+	{ "pack-output", &config.pack_output, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Append small response bodies to rotating packed\n",
+		  "segment files plus an index, instead of one file\n",
+		  "each. Recreate the files later with --unpack.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "page-requisites", &config.page_requisites, parse_bool, -1, 'p',
 		SECTION_DOWNLOAD,
 		{ "Download all necessary files to display a\n",
@@ -1448,6 +1645,12 @@ static const struct optionw options[] = {
 		{ "Ascend above parent directory. (default: on)\n"
 		}
 	},
+	{ "parse-workers", &config.parse_workers, parse_integer, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Number of dedicated link-extraction threads,\n",
+		  "0 = parse within the downloader threads. (default: 1)\n"
+		}
+	},
 	{ "password", &config.password, parse_string, 1, 0,
 		SECTION_DOWNLOAD,
 		{ "Password for Authentication.\n",
@@ -1486,6 +1689,12 @@ static const struct optionw options[] = {
 		{ "File with data to be sent in a POST request.\n"
 		}
 	},
+	{ "preconnect", &config.preconnect, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Open connections to newly discovered hosts in the\n",
+		  "background before their downloads start. (default: off)\n"
+		}
+	},
 	{ "prefer-family", &config.preferred_family, parse_prefer_family, 1, 0,
 		SECTION_DOWNLOAD,
 		{ "Prefer IPv4 or IPv6. (default: none)\n"
@@ -1547,6 +1756,13 @@ static const struct optionw options[] = {
 		{ "Read and write timeout in seconds.\n"
 		}
 	},
+	{ "record-file", &config.record_file, parse_string, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Record all responses with their timings into\n",
+		  "this file for replay via tests/replay-server.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "recursive", &config.recursive, parse_bool, -1, 'r',
 		SECTION_DOWNLOAD,
 		{ "Recursive download. (default: off)\n"
@@ -1586,6 +1802,13 @@ static const struct optionw options[] = {
 		  "or in document itself)\n"
 		}
 	},
+	{ "revisit-after", &config.revisit_after, parse_integer, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Seconds until a URL recorded in the visited\n",
+		  "filter is eligible for re-crawling, needs\n",
+		  "--visited-filter. (default: 0 (=never))\n"
+		}
+	},
 	{ "restrict-file-names", &config.restrict_file_names, parse_restrict_names, 1, 0,
 		SECTION_DOWNLOAD,
 		{ "unix, windows, nocontrol, ascii, lowercase,\n",
@@ -1621,6 +1844,48 @@ static const struct optionw options[] = {
 		{ "Print the server response headers. (default: off)\n"
 		}
 	},
+	{ "shard-count", &config.shard_count, parse_integer, 1, 0,
+		SECTION_STARTUP,
+		{ "Number of cooperating processes sharing a crawl\n",
+		  "via a hostname partition. (default: 1 = off)\n"
+		}
+	},
+	{ "shard-dir", &config.shard_dir, parse_string, 1, 0,
+		SECTION_STARTUP,
+		{ "Directory for the per-shard Unix sockets.\n",
+		  "(default: .)\n"
+		}
+	},
+	{ "shard-id", &config.shard_id, parse_integer, 1, 0,
+		SECTION_STARTUP,
+		{ "This process' slot in a sharded crawl,\n",
+		  "0 .. shard-count-1. (default: 0)\n"
+		}
+	},
+	{ "simd", &config.simd, parse_bool, -1, 0,
+		SECTION_STARTUP,
+		{ "Use vectorized kernels where the CPU supports\n",
+		  "them, --no-simd forces the scalar fallbacks.\n",
+		  "(default: on)\n"
+		}
+	},
+	{ "snapshot-file", &config.snapshot_file, parse_string, 1, 0,
+		SECTION_STARTUP,
+		{ "File for periodic snapshots of the queue and\n",
+		  "blacklist, used to resume an interrupted run.\n"
+		}
+	},
+	{ "snapshot-interval", &config.snapshot_interval, parse_integer, 1, 0,
+		SECTION_STARTUP,
+		{ "Seconds between queue snapshots. (default: 60)\n"
+		}
+	},
+	{ "socks5-proxy", &config.socks5_proxy, parse_string, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Tunnel all connections through this SOCKS5\n",
+		  "proxy, given as host[:port] (default port: 1080).\n"
+		}
+	},
 	{ "span-hosts", &config.span_hosts, parse_bool, -1, 'H',
 		SECTION_DOWNLOAD,
 		{ "Span hosts that were not given on the\n",
@@ -1678,6 +1943,12 @@ static const struct optionw options[] = {
 		{ "Enable TCP Fast Open (TFO). (default: on)\n"
 		}
 	},
+	{ "telemetry-socket", &config.telemetry_socket, parse_string, 1, 0,
+		SECTION_STARTUP,
+		{ "Unix socket answering each connect with one JSON\n",
+		  "line of progress data. (default: none)\n"
+		}
+	},
 	{ "timeout", NULL, parse_timeout, 1, 'T',
 		SECTION_DOWNLOAD,
 		{ "General network timeout in seconds.\n"
@@ -1689,12 +1960,24 @@ static const struct optionw options[] = {
 		  "(default: off)\n"
 		}
 	},
+	{ "tls-early-data", &config.tls_early_data, parse_bool, -1, 0,
+		SECTION_SSL,
+		{ "Enable TLS 1.3 0-RTT early data for idempotent\n",
+		  "requests (needs GnuTLS 3.6.5+). (default: off)\n"
+		}
+	},
 	{ "tls-false-start", &config.tls_false_start, parse_bool, -1, 0,
 		SECTION_SSL,
 		{ "Enable TLS False Start (needs GnuTLS 3.5+).\n",
 		  "(default: on)\n"
 		}
 	},
+	{ "tls-prewarm", &config.tls_prewarm, parse_bool, -1, 0,
+		SECTION_SSL,
+		{ "Refresh TLS session tickets for all queued HTTPS\n",
+		  "hosts before the crawl starts. (default: off)\n"
+		}
+	},
 	{ "tls-resume", &config.tls_resume, parse_bool, -1, 0,
 		SECTION_SSL,
 		{ "Enable TLS Session Resumption. (default: on)\n"
@@ -1706,6 +1989,19 @@ static const struct optionw options[] = {
 		  "(default: ~/.wget-session)\n"
 		}
 	},
+	{ "trace-file", &config.trace_file, parse_string, 1, 0,
+		SECTION_STARTUP,
+		{ "File ('-' = STDERR) for per-request trace dumps.\n",
+		  "(default: -)\n"
+		}
+	},
+	{ "trace-sample", &config.trace_sample, parse_integer, 1, 0,
+		SECTION_STARTUP,
+		{ "Trace the timeline of every Nth request, dump\n",
+		  "the ring of traced requests on SIGUSR1 and at\n",
+		  "exit. (default: 0 = off)\n"
+		}
+	},
 	{ "tries", &config.tries, parse_integer, 1, 't',
 		SECTION_DOWNLOAD,
 		{ "Number of tries for each download. (default 20)\n"
@@ -1717,6 +2013,13 @@ static const struct optionw options[] = {
 		  "(default: off)\n"
 		}
 	},
+	{ "unpack", &config.unpack, parse_bool, -1, 0,
+		SECTION_STARTUP,
+		{ "Recreate the individual files from packed\n",
+		  "segments written by --pack-output, then exit.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "use-server-timestamps", &config.use_server_timestamps, parse_bool, -1, 0,
 		SECTION_DOWNLOAD,
 		{ "Set local file's timestamp to server's timestamp.\n",
@@ -1745,6 +2048,13 @@ static const struct optionw options[] = {
 		{ "Display the version of Wget and exit.\n"
 		}
 	},
+	{ "visited-filter", &config.visited_filter, parse_filename, 1, 0,
+		SECTION_STARTUP,
+		{ "Persistent filter of completed URLs - on\n",
+		  "re-crawls, URLs found in it are not enqueued\n",
+		  "at all, see --revisit-after. (default: none)\n"
+		}
+	},
 	{ "wait", &config.wait, parse_timeout, 1, 'w',
 		SECTION_DOWNLOAD,
 		{ "Wait number of seconds between downloads\n",
@@ -1757,6 +2067,32 @@ static const struct optionw options[] = {
 		  "(per thread). (default: 10)\n"
 		}
 	},
+	{ "warc-file", &config.warc_file, parse_string, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Write raw responses as WARC records into\n",
+		  "rotating segments with this file prefix,\n",
+		  "concurrently with the download. (default: off)\n"
+		}
+	},
+	{ "warc-max-size", &config.warc_max_size, parse_numbytes, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Rotate to a new WARC segment beyond this\n",
+		  "size. (default: 1G)\n"
+		}
+	},
+	{ "watchdog-timeout", &config.watchdog_timeout, parse_integer, 1, 0,
+		SECTION_DOWNLOAD,
+		{ "Log a diagnostic when a download moves no bytes\n",
+		  "for this many seconds. (default: 0 = off)\n"
+		}
+	},
+	{ "write-behind", &config.write_behind, parse_bool, -1, 0,
+		SECTION_DOWNLOAD,
+		{ "Write downloaded data to disk from background\n",
+		  "threads instead of the network read loop.\n",
+		  "(default: off)\n"
+		}
+	},
 	{ "xattr", &config.xattr, parse_bool, -1, 0,
 		SECTION_DOWNLOAD,
 		{ "Save extended file attributes. (default: on)\n"\
@@ -1882,6 +2218,224 @@ static int G_GNUC_WGET_PURE G_GNUC_WGET_NONNULL_ALL opt_compare_config_linear(co
 	return *s1 != *s2; // no need for tolower() here
 }
 
+/*
+ * Option lookup is on the startup hot path - a config file plus command line
+ * means hundreds of lookups. Instead of a bsearch per occurrence we probe a
+ * hash index that is built once over the options table. The hash folds case
+ * and skips '-' and '_', so one index serves the case-sensitive command-line
+ * lookup, the case-insensitive config lookup and the 'unsharp' lookup - the
+ * verifying compare after each probe keeps the exact semantics of each.
+ */
+#define OPT_HASH_SIZE 512 // power of two > 2 * countof(options), keeps probe chains short
+
+static short opt_hash_index[OPT_HASH_SIZE]; // option index + 1, 0 = empty slot
+
+static unsigned G_GNUC_WGET_PURE G_GNUC_WGET_NONNULL_ALL opt_hash(const char *name)
+{
+	unsigned hash = 2166136261U; // FNV-1a
+
+	for (; *name; name++) {
+		if (*name == '-' || *name == '_')
+			continue;
+		hash = (hash ^ (unsigned char) c_tolower(*name)) * 16777619U;
+	}
+
+	return hash;
+}
+
+typedef int opt_match_fn(const char *key, const char *long_name);
+
+static option_t opt_lookup(const char *name, opt_match_fn *match)
+{
+	static char built;
+
+	if (!built) {
+		// build the index on first use (single-threaded startup code)
+		for (short it = 0; it < (short) countof(options); it++) {
+			unsigned slot = opt_hash(options[it].long_name) & (OPT_HASH_SIZE - 1);
+
+			while (opt_hash_index[slot])
+				slot = (slot + 1) & (OPT_HASH_SIZE - 1);
+			opt_hash_index[slot] = it + 1;
+		}
+		built = 1;
+	}
+
+	for (unsigned slot = opt_hash(name) & (OPT_HASH_SIZE - 1); opt_hash_index[slot]; slot = (slot + 1) & (OPT_HASH_SIZE - 1)) {
+		option_t opt = &options[opt_hash_index[slot] - 1];
+
+		if (match(name, opt->long_name) == 0)
+			return opt;
+	}
+
+	return NULL;
+}
+
+/*
+ * Compiled config cache. Parsing a config file resolves each line to an
+ * option table entry, an invert flag and a value - we remember exactly these
+ * triplets and write them to '<cfgfile>.cache' so the next invocation can
+ * replay them without any text parsing or option lookup. The cache is bound
+ * to the source file's mtime and size and to a hash of the option table, so
+ * an edited config file or an upgraded binary silently falls back to the
+ * text parser. Values are stored in host byte order - the cache is a local
+ * per-machine file, not an interchange format.
+ *
+ * Files pulled in via 'include' are parsed on their own, but an outer file
+ * containing 'include' is never cached - its cache couldn't see changes to
+ * the included files.
+ */
+#define CONFIG_CACHE_MAGIC 0x57324343 // "W2CC"
+#define CONFIG_CACHE_VERSION 1
+
+typedef struct {
+	int
+		magic,
+		version;
+	unsigned
+		table_hash; // detects a changed or reordered option table
+	long long
+		mtime,
+		size; // of the source config file
+} config_cache_hdr_t;
+
+typedef struct {
+	int
+		index,    // option table index
+		invert,
+		value_len; // -1 = no value, else strlen(value)
+} config_cache_rec_t;
+
+static wget_buffer_t
+	cache_records;
+static char
+	cache_capturing,
+	cache_disabled; // seen an 'include' - this file must not be cached
+
+static unsigned G_GNUC_WGET_PURE opt_table_hash(void)
+{
+	unsigned hash = 2166136261U; // FNV-1a over all long names
+
+	for (unsigned it = 0; it < countof(options); it++) {
+		for (const char *p = options[it].long_name; *p; p++)
+			hash = (hash ^ (unsigned char) *p) * 16777619U;
+		hash = (hash ^ 0xff) * 16777619U; // name separator
+	}
+
+	return hash;
+}
+
+static void config_cache_record(option_t opt, const char *value, char invert)
+{
+	config_cache_rec_t rec = {
+		.index = (int) (opt - options),
+		.invert = invert,
+		.value_len = value ? (int) strlen(value) : -1,
+	};
+
+	wget_buffer_memcat(&cache_records, &rec, sizeof(rec));
+	if (value)
+		wget_buffer_memcat(&cache_records, value, rec.value_len + 1); // include terminating 0
+}
+
+// returns 1 if the file was replayed from a valid cache, else 0 (text parse needed);
+// parser failures during replay go into *parse_ret
+static int G_GNUC_WGET_NONNULL_ALL config_cache_replay(const char *cfgfile, int *parse_ret)
+{
+	char cachefile[strlen(cfgfile) + 7];
+	config_cache_hdr_t hdr;
+	struct stat st;
+	char *data;
+	size_t size;
+
+	snprintf(cachefile, sizeof(cachefile), "%s.cache", cfgfile);
+
+	if (!(data = wget_read_file(cachefile, &size)))
+		return 0;
+
+	if (size < sizeof(hdr))
+		goto stale;
+	memcpy(&hdr, data, sizeof(hdr));
+
+	if (hdr.magic != CONFIG_CACHE_MAGIC || hdr.version != CONFIG_CACHE_VERSION
+		|| hdr.table_hash != opt_table_hash()
+		|| stat(cfgfile, &st) != 0
+		|| hdr.mtime != (long long) st.st_mtime || hdr.size != (long long) st.st_size)
+		goto stale;
+
+	debug_printf("Replaying %s\n", cachefile);
+
+	for (size_t pos = sizeof(hdr); pos < size; ) {
+		config_cache_rec_t rec;
+		const char *value = NULL;
+		int rc;
+
+		if (size - pos < sizeof(rec))
+			goto stale;
+		memcpy(&rec, data + pos, sizeof(rec));
+		pos += sizeof(rec);
+
+		if (rec.index < 0 || rec.index >= (int) countof(options))
+			goto stale;
+		if (rec.value_len >= 0) {
+			if (size - pos < (size_t) rec.value_len + 1 || data[pos + rec.value_len])
+				goto stale;
+			value = data + pos;
+			pos += rec.value_len + 1;
+		}
+
+		if ((rc = options[rec.index].parser(&options[rec.index], value, (char) rec.invert)) < 0) {
+			*parse_ret = rc;
+			break;
+		}
+	}
+
+	xfree(data);
+	return 1;
+
+stale:
+	xfree(data);
+	unlink(cachefile); // outdated or damaged - reparse the text file
+	return 0;
+}
+
+static void config_cache_store(const char *cfgfile)
+{
+	char cachefile[strlen(cfgfile) + 7];
+	config_cache_hdr_t hdr = {
+		.magic = CONFIG_CACHE_MAGIC,
+		.version = CONFIG_CACHE_VERSION,
+		.table_hash = opt_table_hash(),
+	};
+	struct stat st;
+	FILE *fp;
+
+	if (stat(cfgfile, &st) != 0)
+		return;
+	hdr.mtime = (long long) st.st_mtime;
+	hdr.size = (long long) st.st_size;
+
+	snprintf(cachefile, sizeof(cachefile), "%s.cache", cfgfile);
+
+	if (!(fp = fopen(cachefile, "wb"))) {
+		debug_printf("Failed to write %s (%d)\n", cachefile, errno);
+		return;
+	}
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1
+		|| (cache_records.length && fwrite(cache_records.data, cache_records.length, 1, fp) != 1))
+	{
+		fclose(fp);
+		unlink(cachefile);
+		return;
+	}
+
+	if (fclose(fp) == 0)
+		debug_printf("Wrote %s\n", cachefile);
+	else
+		unlink(cachefile);
+}
+
 // return values:
 //  < 0 : parse error
 // >= 0 : number of arguments processed
@@ -1913,17 +2467,15 @@ static int G_GNUC_WGET_NONNULL((1)) set_long_option(const char *name, const char
 	}
 
 	if (parsing_config && case_insensitive) {
-		opt = bsearch(name, options, countof(options), sizeof(options[0]), opt_compare_config);
+		opt = opt_lookup(name, wget_strcasecmp_ascii);
 		if (!opt) {
-			// Fallback to linear search for 'unsharp' searching.
+			// Fallback to 'unsharp' matching.
 			// Maybe the user asked for e.g. https_only or httpsonly instead of https-only
 			// opt_compare_config_linear() will find these. Wget -e/--execute compatibility.
-			for (unsigned it = 0; it < countof(options) && !opt; it++)
-				if (opt_compare_config_linear(name, options[it].long_name) == 0)
-					opt = &options[it];
+			opt = opt_lookup(name, opt_compare_config_linear);
 		}
 	} else
-		opt = bsearch(name, options, countof(options), sizeof(options[0]), opt_compare);
+		opt = opt_lookup(name, strcmp);
 
 	if (!opt) {
 		error_printf(_("Unknown option '%s'\n"), name);
@@ -1981,6 +2533,11 @@ static int G_GNUC_WGET_NONNULL((1)) set_long_option(const char *name, const char
 		}
 	}
 
+	// record the resolved option for the compiled cache; 'execute' recurses
+	// into here and is recorded via its inner option, not twice
+	if (cache_capturing && opt->parser != parse_execute)
+		config_cache_record(opt, value, invert);
+
 	if ((rc = opt->parser(opt, value, invert)) < 0)
 		return rc;
 
@@ -1997,9 +2554,9 @@ static int parse_proxy(option_t opt, const char *val, const char invert)
 			xfree(config.no_proxy);
 			config.no_proxy = val ? wget_strdup(val) : NULL;
 		} else {
-			if((opt = bsearch("http-proxy", options, countof(options), sizeof(options[0]), opt_compare)))
+			if((opt = opt_lookup("http-proxy", strcmp)))
 				parse_string(opt, val, invert);
-			if((opt = bsearch("https-proxy", options, countof(options), sizeof(options[0]), opt_compare)))
+			if((opt = opt_lookup("https-proxy", strcmp)))
 				parse_string(opt, val, invert);
 		}
 	}
@@ -2109,6 +2666,12 @@ static int G_GNUC_WGET_NONNULL((1)) _read_config(const char *cfgfile, int expand
 		return ret;
 	}
 
+	// a valid compiled cache replaces the whole text parse below
+	if (config_cache_replay(cfgfile, &ret)) {
+		level--;
+		return ret;
+	}
+
 	if ((fp = fopen(cfgfile, "r")) == NULL) {
 		error_printf(_("Failed to open %s (%d): %s\n"), cfgfile, errno, strerror(errno));
 		level--;
@@ -2117,6 +2680,13 @@ static int G_GNUC_WGET_NONNULL((1)) _read_config(const char *cfgfile, int expand
 
 	debug_printf("Reading %s\n", cfgfile);
 
+	int capturing = 0;
+	if (!cache_capturing) {
+		wget_buffer_init(&cache_records, NULL, 1024);
+		cache_capturing = capturing = 1;
+		cache_disabled = 0;
+	}
+
 	char tmp[1024];
 	wget_buffer_init(&linebuf, tmp, sizeof(tmp));
 
@@ -2161,6 +2731,7 @@ static int G_GNUC_WGET_NONNULL((1)) _read_config(const char *cfgfile, int expand
 		} else if (found == 2) {
 			// debug_printf("%s %s\n",name,val);
 			if (!strcmp(name, "include")) {
+				cache_disabled = 1; // a cache of this file couldn't see changes in included files
 				ret = _read_config(val, 1);
 			} else {
 				if ((rc = set_long_option(name, NULL, 0)) < 0)
@@ -2178,6 +2749,13 @@ static int G_GNUC_WGET_NONNULL((1)) _read_config(const char *cfgfile, int expand
 		ret = -4;
 	}
 
+	if (capturing) {
+		if (config.config_cache && ret == 0 && !cache_disabled)
+			config_cache_store(cfgfile);
+		wget_buffer_deinit(&cache_records);
+		cache_capturing = 0;
+	}
+
 	level--;
 	return ret;
 }
@@ -2337,6 +2915,8 @@ int init(int argc, const char **argv)
 	// the following strdup's are just needed for reallocation/freeing purposes to
 	// satisfy valgrind
 	config.user_agent = wget_strdup(config.user_agent);
+	config.metrics_format = wget_strdup(config.metrics_format);
+	config.shard_dir = wget_strdup(config.shard_dir);
 	config.secure_protocol = wget_strdup(config.secure_protocol);
 	config.ca_directory = wget_strdup(config.ca_directory);
 	config.default_page = wget_strdup(config.default_page);
@@ -2383,6 +2963,12 @@ int init(int argc, const char **argv)
 	if (config.hsts && !config.hsts_file)
 		config.hsts_file = wget_aprintf("%s/.wget-hsts", home_dir);
 
+	if (config.etags && !config.etag_file)
+		config.etag_file = wget_aprintf("%s/.wget-etags", home_dir);
+
+	if (config.caps && !config.caps_file)
+		config.caps_file = wget_aprintf("%s/.wget-caps", home_dir);
+
 	if (config.hpkp && !config.hpkp_file)
 		config.hpkp_file = wget_aprintf("%s/.wget-hpkp", home_dir);
 
@@ -2395,6 +2981,12 @@ int init(int argc, const char **argv)
 	if (config.netrc && !config.netrc_file)
 		config.netrc_file = wget_aprintf("%s/.netrc", home_dir);
 
+	if (config.netrc_file) {
+		// parsed lazily on the first authentication need
+		config.netrc_db = wget_netrc_db_init(NULL);
+		wget_netrc_db_lazy_load(config.netrc_db, config.netrc_file);
+	}
+
 	xfree(home_dir);
 
 	//Enable plugin loading
@@ -2446,10 +3038,21 @@ int init(int argc, const char **argv)
 
 	log_init();
 
+	if (config.async_log)
+		wget_log_async_start(4096);
+
 	// check for correct settings
 	if (config.max_threads < 1)
 		config.max_threads = 1;
 
+	if (config.parse_workers < 0)
+		config.parse_workers = 0;
+
+	if (config.compact_blacklist && config.convert_links) {
+		error_printf(_("--convert-links needs the original IRIs, disabling --compact-blacklist\n"));
+		config.compact_blacklist = 0;
+	}
+
 	// truncate output document
 	if (config.output_document && strcmp(config.output_document,"-") && !config.dont_write) {
 		int fd = open(config.output_document, O_WRONLY | O_TRUNC | O_BINARY);
@@ -2476,6 +3079,9 @@ int init(int argc, const char **argv)
 			config.no_proxy = wget_strdup(getenv("no_proxy"));
 	}
 
+	if (config.socks5_proxy && *config.socks5_proxy)
+		wget_tcp_set_socks5_proxy(NULL, config.socks5_proxy);
+
 	if (config.http_proxy && *config.http_proxy && !wget_http_set_http_proxy(config.http_proxy, config.local_encoding)) {
 		error_printf(_("Failed to set http proxies %s\n"), config.http_proxy);
 		return -1;
@@ -2493,39 +3099,43 @@ int init(int argc, const char **argv)
 	xfree(config.no_proxy);
 
 #ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+	// only create the database objects here - other subsystems keep
+	// pointers to them. Reading the on-disk files is deferred until a
+	// request actually needs a database (config_load_db()), so short
+	// invocations don't parse state they never touch.
 	if (config.cookies) {
 		config.cookie_db = wget_cookie_db_init(NULL);
 		wget_cookie_set_keep_session_cookies(config.cookie_db, config.keep_session_cookies);
-		if (config.cookie_suffixes)
-			wget_cookie_db_load_psl(config.cookie_db, config.cookie_suffixes);
-		if (config.load_cookies)
-			wget_cookie_db_load(config.cookie_db, config.load_cookies);
 	}
 
 	if (config.hsts) {
 		config.hsts_db = plugin_db_fetch_provided_hsts_db();
 		if (! config.hsts_db)
 			config.hsts_db = wget_hsts_db_init(NULL, config.hsts_file);
-		wget_hsts_db_load(config.hsts_db);
+	}
+
+	if (config.etags)
+		config.etag_db = wget_etag_db_init(NULL, config.etag_file);
+
+	if (config.caps) {
+		config.caps_db = wget_caps_db_init(NULL, config.caps_file);
+		// let connects size their socket buffers from cached BDP measurements
+		wget_tcp_set_caps_db(NULL, config.caps_db);
 	}
 
 	if (config.hpkp) {
 		config.hpkp_db = plugin_db_fetch_provided_hpkp_db();
 		if (! config.hpkp_db)
 			config.hpkp_db = wget_hpkp_db_init(NULL, config.hpkp_file);
-		wget_hpkp_db_load(config.hpkp_db);
 	}
 
-	if (config.tls_resume) {
+	if (config.tls_resume)
 		config.tls_session_db = wget_tls_session_db_init(NULL);
-		wget_tls_session_db_load(config.tls_session_db, config.tls_session_file);
-	}
 
 	if (config.ocsp) {
 		config.ocsp_db = plugin_db_fetch_provided_ocsp_db();
 		if (! config.ocsp_db)
 			config.ocsp_db = wget_ocsp_db_init(NULL, config.ocsp_file);
-		wget_ocsp_db_load(config.ocsp_db);
 	}
 #endif
 
@@ -2572,13 +3182,22 @@ int init(int argc, const char **argv)
 		return -1;
 	}
 
+	// resolve the vectorized kernels (or force the scalar ones)
+	wget_cpu_set_simd(config.simd);
+
 	// set module specific options
 	wget_tcp_set_timeout(NULL, config.read_timeout);
 	wget_tcp_set_connect_timeout(NULL, config.connect_timeout);
 	wget_tcp_set_dns_timeout(NULL, config.dns_timeout);
 	wget_tcp_set_dns_caching(NULL, config.dns_caching);
+	if (config.dns_caching && config.dns_cache_file)
+		wget_dns_cache_load(config.dns_cache_file);
 	wget_tcp_set_tcp_fastopen(NULL, config.tcp_fastopen);
+	if (config.limit_rate)
+		wget_tcp_set_pacing_rate(NULL, (size_t) config.limit_rate);
 	wget_tcp_set_tls_false_start(NULL, config.tls_false_start);
+	// early data is replayable - keep it to idempotent runs without request bodies
+	wget_tcp_set_tls_early_data(NULL, config.tls_early_data && !config.post_data && !config.post_file);
 	if (!config.dont_write) // fuzzing mode, try to avoid real network access
 		wget_tcp_set_bind_address(NULL, config.bind_address);
 	if (config.inet4_only)
@@ -2650,16 +3269,84 @@ int init(int argc, const char **argv)
 	return n;
 }
 
+// Read a state database from disk on first use. init() only allocates the
+// in-memory databases; the file parsing is deferred to here so that short
+// invocations which never touch e.g. cookies or HSTS don't pay for loading
+// them. Safe to call from any downloader thread - the unsynchronized flag
+// check is just a fast path, the load itself is serialized (same pattern as
+// wget_ssl_init()). save_databases() merges with the on-disk file, so an
+// unloaded database that only collected new entries doesn't lose anything.
+void config_load_db(config_db_t db)
+{
+	static wget_thread_mutex_t
+		db_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+	static bool
+		db_loaded[CONFIG_DB_MAX];
+
+	if (db_loaded[db])
+		return;
+
+	wget_thread_mutex_lock(&db_mutex);
+
+	if (!db_loaded[db]) {
+		switch (db) {
+		case CONFIG_DB_COOKIES:
+			if (config.cookie_db) {
+				if (config.cookie_suffixes)
+					wget_cookie_db_load_psl(config.cookie_db, config.cookie_suffixes);
+				if (config.load_cookies)
+					wget_cookie_db_load(config.cookie_db, config.load_cookies);
+			}
+			break;
+		case CONFIG_DB_HSTS:
+			if (config.hsts_db)
+				wget_hsts_db_load(config.hsts_db);
+			break;
+		case CONFIG_DB_ETAGS:
+			if (config.etag_db)
+				wget_etag_db_load(config.etag_db);
+			break;
+		case CONFIG_DB_CAPS:
+			if (config.caps_db)
+				wget_caps_db_load(config.caps_db);
+			break;
+		case CONFIG_DB_HPKP:
+			if (config.hpkp_db)
+				wget_hpkp_db_load(config.hpkp_db);
+			break;
+		case CONFIG_DB_TLS_SESSION:
+			if (config.tls_session_db)
+				wget_tls_session_db_load(config.tls_session_db, config.tls_session_file);
+			break;
+		case CONFIG_DB_OCSP:
+			if (config.ocsp_db)
+				wget_ocsp_db_load(config.ocsp_db);
+			break;
+		default:
+			break;
+		}
+
+		db_loaded[db] = true;
+	}
+
+	wget_thread_mutex_unlock(&db_mutex);
+}
+
 // just needs to be called to free all allocated storage on exit
 // for valgrind testing
 
 void deinit(void)
 {
+	if (config.dns_caching && config.dns_cache_file)
+		wget_dns_cache_save(config.dns_cache_file);
+
 	wget_dns_cache_free(); // frees DNS cache
 	wget_tcp_set_bind_address(NULL, NULL); // free global bind address
 
 	wget_cookie_db_free(&config.cookie_db);
 	wget_hsts_db_free(&config.hsts_db);
+	wget_etag_db_free(&config.etag_db);
+	wget_caps_db_free(&config.caps_db);
 	wget_hpkp_db_free(&config.hpkp_db);
 	wget_tls_session_db_free(&config.tls_session_db);
 	wget_ocsp_db_free(&config.ocsp_db);
@@ -2675,9 +3362,12 @@ void deinit(void)
 	xfree(config.crl_file);
 	xfree(config.default_page);
 	xfree(config.directory_prefix);
+	xfree(config.dns_cache_file);
 	xfree(config.egd_file);
 	xfree(config.gnutls_options);
 	xfree(config.hsts_file);
+	xfree(config.etag_file);
+	xfree(config.caps_file);
 	xfree(config.hpkp_file);
 	xfree(config.http_password);
 	xfree(config.http_proxy);
@@ -2687,10 +3377,21 @@ void deinit(void)
 	xfree(config.https_proxy);
 	xfree(config.input_encoding);
 	xfree(config.input_file);
+	xfree(config.snapshot_file);
+	xfree(config.visited_filter);
+	xfree(config.socks5_proxy);
 	xfree(config.load_cookies);
 	xfree(config.local_encoding);
 	xfree(config.logfile);
 	xfree(config.logfile_append);
+	xfree(config.metrics_file);
+	xfree(config.metrics_format);
+	xfree(config.telemetry_socket);
+	xfree(config.daemon_socket);
+	xfree(config.daemon_fetch);
+	xfree(config.shard_dir);
+	xfree(config.trace_file);
+	xfree(config.warc_file);
 	xfree(config.netrc_file);
 	xfree(config.ocsp_file);
 	xfree(config.output_document);
@@ -2708,6 +3409,8 @@ void deinit(void)
 	xfree(config.username);
 
 	stats_exit();
+	metrics_exit();
+	trace_exit();
 
 	wget_iri_free(&config.base);
 
@@ -2797,6 +3500,23 @@ int selftest_options(void)
 		}
 	}
 
+	// check if all options are found via the hash index, with each matcher
+
+	for (it = 0; it < countof(options); it++) {
+		if (opt_lookup(options[it].long_name, strcmp) != &options[it]) {
+			error_printf("%s: Failed to find option '%s' (using opt_lookup(strcmp))\n", __func__, options[it].long_name);
+			ret = 1;
+		}
+		if (opt_lookup(options[it].long_name, wget_strcasecmp_ascii) != &options[it]) {
+			error_printf("%s: Failed to find option '%s' (using opt_lookup(strcasecmp))\n", __func__, options[it].long_name);
+			ret = 1;
+		}
+		if (opt_lookup(options[it].long_name, opt_compare_config_linear) != &options[it]) {
+			error_printf("%s: Failed to find option '%s' (using opt_lookup(linear))\n", __func__, options[it].long_name);
+			ret = 1;
+		}
+	}
+
 	// test parsing boolean short and long option
 
 	{
@@ -0,0 +1,274 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Packed small-file output (--pack-output / --unpack)
+ *
+ * Mirroring documentation trees creates millions of sub-4K files, and a
+ * metadata-heavy filesystem then caps the crawl at the rate of
+ * open/write/close per file. With --pack-output small bodies are appended
+ * to rotating segment files ('wget2.pack.N') with a text index
+ * ('wget2.pack.idx': segment, offset, length, path) - pure sequential
+ * writes. --unpack recreates the individual files from such a pack later.
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_pack.h"
+
+// rotate to the next segment beyond this size
+#define PACK_SEGMENT_MAX (256 * 1024 * 1024)
+
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static FILE
+	*segment_fp, // current segment, append-only
+	*index_fp; // the index, append-only
+
+static int
+	segment_nr;
+
+static long long
+	segment_off, // write position in the current segment
+	pack_nfiles; // number of bodies packed
+
+static char *_segment_fname(int nr)
+{
+	if (config.directory_prefix)
+		return wget_aprintf("%s/wget2.pack.%d", config.directory_prefix, nr);
+
+	return wget_aprintf("wget2.pack.%d", nr);
+}
+
+static char *_index_fname(void)
+{
+	if (config.directory_prefix)
+		return wget_aprintf("%s/wget2.pack.idx", config.directory_prefix);
+
+	return wget_aprintf("wget2.pack.idx");
+}
+
+// open the next segment, closing (and flushing) the previous one
+static int _next_segment(void)
+{
+	char *fname = _segment_fname(segment_nr);
+
+	if (segment_fp)
+		fclose(segment_fp);
+
+	segment_fp = fopen(fname, "ab");
+	if (!segment_fp) {
+		error_printf(_("Failed to open pack segment '%s' (errno=%d)\n"), fname, errno);
+		xfree(fname);
+		return -1;
+	}
+
+	// appending to an existing segment (e.g. a continued mirror run)
+	segment_off = ftello(segment_fp);
+
+	xfree(fname);
+	return 0;
+}
+
+// append a small body to the current segment and record it in the index;
+// returns 0 on success, -1 if the caller should fall back to a plain file
+int pack_append(const char *fname, const void *data, size_t length)
+{
+	int rc = -1;
+
+	wget_thread_mutex_lock(&mutex);
+
+	if (!index_fp) {
+		char *idxname = _index_fname();
+
+		index_fp = fopen(idxname, "a");
+		if (!index_fp)
+			error_printf(_("Failed to open pack index '%s' (errno=%d)\n"), idxname, errno);
+		xfree(idxname);
+
+		if (!index_fp || _next_segment() != 0)
+			goto out;
+	}
+
+	if (segment_off >= PACK_SEGMENT_MAX) {
+		segment_nr++;
+		if (_next_segment() != 0)
+			goto out;
+	}
+
+	if (fwrite(data, 1, length, segment_fp) != length) {
+		error_printf(_("Failed to write %zu bytes to pack segment %d (errno=%d)\n"),
+			length, segment_nr, errno);
+		goto out;
+	}
+
+	// the path goes last, so embedded spaces survive
+	fprintf(index_fp, "%d %lld %zu %s\n", segment_nr, segment_off, length, fname);
+
+	segment_off += length;
+	pack_nfiles++;
+	rc = 0;
+
+out:
+	wget_thread_mutex_unlock(&mutex);
+
+	return rc;
+}
+
+// --unpack: recreate the individual files recorded in the index.
+// Later index entries win, matching the last-write semantics of a crawl.
+int pack_explode(void)
+{
+	char *idxname = _index_fname();
+	FILE *fp = fopen(idxname, "r");
+	char *buf = NULL, *data = NULL;
+	size_t bufsize = 0, datasize = 0;
+	ssize_t buflen;
+	int rc = 0, cur_segment = -1, nfiles = 0;
+	FILE *seg = NULL;
+
+	if (!fp) {
+		error_printf(_("Failed to open pack index '%s' (errno=%d)\n"), idxname, errno);
+		xfree(idxname);
+		return -1;
+	}
+
+	while ((buflen = wget_getline(&buf, &bufsize, fp)) >= 0) {
+		int segment;
+		long long offset;
+		size_t length;
+		char *name, *end;
+
+		while (buflen > 0 && (buf[buflen - 1] == '\n' || buf[buflen - 1] == '\r'))
+			buf[--buflen] = 0;
+
+		segment = (int) strtol(buf, &end, 10);
+		offset = strtoll(end, &end, 10);
+		length = (size_t) strtoll(end, &end, 10);
+
+		if (end == buf || *end != ' ' || !*(end + 1))
+			continue; // corrupt line
+
+		name = end + 1;
+
+		if (segment != cur_segment) {
+			char *segname = _segment_fname(segment);
+
+			if (seg)
+				fclose(seg);
+			seg = fopen(segname, "rb");
+			if (!seg) {
+				error_printf(_("Failed to open pack segment '%s' (errno=%d)\n"), segname, errno);
+				xfree(segname);
+				rc = -1;
+				break;
+			}
+			xfree(segname);
+			cur_segment = segment;
+		}
+
+		if (length > datasize) {
+			xfree(data);
+			data = wget_malloc((datasize = length));
+		}
+
+		if (fseeko(seg, offset, SEEK_SET) != 0
+			|| fread(data, 1, length, seg) != length)
+		{
+			error_printf(_("Failed to read %zu bytes at %lld from pack segment %d\n"),
+				length, offset, segment);
+			rc = -1;
+			continue;
+		}
+
+		int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+
+		if (fd == -1 && errno == ENOENT) {
+			// create the directory path on demand
+			for (char *p = name + 1; (p = strchr(p, '/')); p++) {
+				*p = 0;
+				if (mkdir(name, 0755) != 0 && errno != EEXIST) {
+					error_printf(_("Failed to make directory '%s' (errno=%d)\n"), name, errno);
+					break;
+				}
+				*p = '/';
+			}
+			fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+		}
+
+		if (fd == -1) {
+			error_printf(_("Failed to open '%s' (errno=%d)\n"), name, errno);
+			rc = -1;
+			continue;
+		}
+
+		if (write(fd, data, length) != (ssize_t) length) {
+			error_printf(_("Failed to write file %s (errno=%d)\n"), name, errno);
+			rc = -1;
+		} else
+			nfiles++;
+
+		close(fd);
+	}
+
+	info_printf(_("Unpacked %d file%s\n"), nfiles, nfiles != 1 ? "s" : "");
+
+	if (seg)
+		fclose(seg);
+	fclose(fp);
+	xfree(data);
+	xfree(buf);
+	xfree(idxname);
+
+	return rc;
+}
+
+void pack_stats(long long *nfiles)
+{
+	*nfiles = pack_nfiles;
+}
+
+void pack_free(void)
+{
+	wget_thread_mutex_lock(&mutex);
+
+	if (segment_fp) {
+		fclose(segment_fp); // one flush per segment instead of one per file
+		segment_fp = NULL;
+	}
+	if (index_fp) {
+		fclose(index_fp);
+		index_fp = NULL;
+	}
+
+	wget_thread_mutex_unlock(&mutex);
+}
@@ -29,6 +29,8 @@
 
 #include "wget_dl.h"
 #include "wget_plugin.h"
+#include "wget_host.h"
+#include "wget_telemetry.h"
 
 // Strings
 static const char *init_fn_name = "wget_plugin_initializer";
@@ -56,6 +58,9 @@ typedef struct {
 	wget_plugin_url_filter_t url_filter;
 	// The plugin's post processor
 	wget_plugin_post_processor_t post_processor;
+	// The plugin's streaming body filter and its position (raw/decoded)
+	wget_plugin_body_filter_t body_filter;
+	int body_filter_position;
 	// Buffer to store plugin name
 	char name_buf[];
 } plugin_priv_t;
@@ -69,6 +74,9 @@ static wget_vector_t *plugin_list;
 static wget_stringmap_t *plugin_name_index;
 // Whether any of the previous options forwarded was 'help'
 static int plugin_help_forwarded;
+// Number of registered body filters per position - lets the hot receive
+// path skip the dispatch entirely when no plugin asked for body data
+static int body_filter_count[2];
 // Plugin supplied HSTS database
 static wget_hsts_db_t *hsts_db;
 static int hsts_db_priority;
@@ -150,9 +158,8 @@ static void impl_action_set_local_filename(wget_intercept_action_t *p_action, co
 {
 	intercept_action_t *action = (intercept_action_t *) p_action;
 
-	if (action->verdict.alt_local_filename)
-		wget_free(action->verdict.alt_local_filename);
-	action->verdict.alt_local_filename = wget_strdup(local_filename);
+	wget_refstr_unref((const char **) &action->verdict.alt_local_filename);
+	action->verdict.alt_local_filename = wget_refstr_dup(local_filename);
 }
 
 static void impl_register_url_filter(wget_plugin_t *p_plugin, wget_plugin_url_filter_t fn)
@@ -248,6 +255,23 @@ static void impl_register_post_processor(wget_plugin_t *p_plugin, wget_plugin_po
 	priv->post_processor = fn;
 }
 
+static void impl_register_body_filter(wget_plugin_t *p_plugin, wget_plugin_body_filter_t fn, int position)
+{
+	plugin_priv_t *priv = (plugin_priv_t *) p_plugin;
+
+	if (position != WGET_PLUGIN_BODY_RAW && position != WGET_PLUGIN_BODY_DECODED)
+		return;
+
+	if (priv->body_filter)
+		body_filter_count[priv->body_filter_position]--;
+
+	priv->body_filter = fn;
+	priv->body_filter_position = position;
+
+	if (fn)
+		body_filter_count[position]++;
+}
+
 // API for custom HSTS, HPKP and OCSP databases
 static void impl_add_hsts_db(G_GNUC_WGET_UNUSED wget_plugin_t *p_plugin, wget_hsts_db_t *new_hsts_db, int priority)
 {
@@ -286,6 +310,14 @@ static void impl_add_ocsp_db(G_GNUC_WGET_UNUSED wget_plugin_t *p_plugin, wget_oc
 }
 
 
+// Read-only scheduler introspection, e.g. for traffic-shaping plugins
+static void impl_get_scheduler_info(G_GNUC_WGET_UNUSED wget_plugin_t *p_plugin, const char *host, wget_scheduler_info_t *info)
+{
+	info->queue_depth = queue_size();
+	info->host_pending = host ? host_pending_count(host) : -1;
+	telemetry_active(&info->threads_busy, &info->bytes_in_flight, &info->bytes_expected);
+}
+
 // vtable
 static struct wget_plugin_vtable vtable = {
 	.get_name = impl_get_name,
@@ -309,7 +341,10 @@ static struct wget_plugin_vtable vtable = {
 
 	.add_hsts_db = impl_add_hsts_db,
 	.add_hpkp_db = impl_add_hpkp_db,
-	.add_ocsp_db = impl_add_ocsp_db
+	.add_ocsp_db = impl_add_ocsp_db,
+
+	.get_scheduler_info = impl_get_scheduler_info,
+	.register_body_filter = impl_register_body_filter
 };
 
 
@@ -351,6 +386,8 @@ static plugin_t *_load_plugin(const char *name, const char *path, dl_error_t *e)
 	priv->argp = NULL;
 	priv->url_filter = NULL;
 	priv->post_processor = NULL;
+	priv->body_filter = NULL;
+	priv->body_filter_position = 0;
 	wget_strscpy(priv->name_buf, name, name_len + 1);
 
 	// Initialize public members
@@ -605,8 +642,7 @@ void plugin_db_forward_url_verdict_free(struct plugin_db_forward_url_verdict *ve
 {
 	if (verdict->alt_iri)
 		wget_iri_free(&verdict->alt_iri);
-	if (verdict->alt_local_filename)
-		wget_free(verdict->alt_local_filename);
+	wget_refstr_unref((const char **) &verdict->alt_local_filename);
 }
 
 // Fetches the plugin-provided HSTS database, or NULL.
@@ -673,6 +709,29 @@ int plugin_db_forward_downloaded_file(const wget_iri_t *iri, uint64_t size, cons
 	return ret;
 }
 
+// Whether any plugin registered a body filter for the given position
+int plugin_db_has_body_filter(int position)
+{
+	return body_filter_count[position] > 0;
+}
+
+// Forwards one streaming body chunk to interested plugins.
+// Returns nonzero if any filter wants the transfer canceled.
+int plugin_db_forward_body(const wget_iri_t *iri, int position, const char *data, size_t length)
+{
+	for (int i = 0; i < wget_vector_size(plugin_list); i++) {
+		plugin_t *plugin = (plugin_t *) wget_vector_get(plugin_list, i);
+		plugin_priv_t *priv = (plugin_priv_t *) plugin;
+
+		if (priv->body_filter && priv->body_filter_position == position) {
+			if (priv->body_filter((wget_plugin_t *) plugin, iri, data, length))
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
 // Initializes the plugin framework
 void plugin_db_init(void)
 {
@@ -691,6 +750,15 @@ void plugin_db_init(void)
 		ocsp_db = NULL;
 		ocsp_db_priority = 0;
 
+		// resolved plugin paths survive across invocations, so batch runs
+		// skip the per-directory name probing on every start
+		const char *home = getenv("HOME");
+		if (home) {
+			char *cache_file = wget_aprintf("%s/.wget2-plugin-cache", home);
+			dl_cache_load(cache_file);
+			wget_free(cache_file);
+		}
+
 		initialized = 1;
 	}
 }
@@ -719,5 +787,7 @@ void plugin_db_finalize(int exitcode)
 	if (ocsp_db)
 		wget_ocsp_db_free(&ocsp_db);
 
+	dl_cache_save();
+
 	initialized = 0;
 }
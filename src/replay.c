@@ -0,0 +1,118 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Crawl recording for deterministic replay (--record-file)
+ *
+ * Live servers vary between runs, so scheduler changes could never be
+ * A/B-benchmarked on identical traffic. With --record-file every response
+ * is appended to a replay file: the raw response header, the wire body
+ * (de-chunked but before decompression) and the elapsed time from request
+ * to completed response. tests/replay-server serves such a file back with
+ * the recorded latencies, so any two builds can be driven over the exact
+ * same crawl.
+ *
+ * Record layout, repeated per response:
+ *
+ *   REPLAY <latency_ms> <header_len> <body_len> <uri>\n
+ *   <header bytes><body bytes>\n
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_replay.h"
+
+struct replay_stream {
+	char
+		*uri; // target URI of the open record
+	wget_buffer_t
+		*body; // wire body collected so far
+	long long
+		start; // when the request went out, for the recorded latency
+};
+
+static FILE
+	*record_fp; // the replay file, append-only under the mutex
+static wget_thread_mutex_t
+	record_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+// start collecting a record, called when the request has been sent
+replay_stream_t *replay_record_begin(const char *uri)
+{
+	replay_stream_t *stream = wget_calloc(1, sizeof(replay_stream_t));
+
+	stream->uri = wget_strdup(uri);
+	stream->body = wget_buffer_alloc(102400);
+	stream->start = wget_get_timemillis();
+
+	return stream;
+}
+
+void replay_record_append(replay_stream_t *stream, const void *data, size_t length)
+{
+	wget_buffer_memcat(stream->body, data, length);
+}
+
+// the response is complete - append the record and free the stream
+void replay_record_end(replay_stream_t **stream, const void *header, size_t header_len)
+{
+	replay_stream_t *s = *stream;
+	long long latency;
+
+	if (!s)
+		return;
+
+	latency = wget_get_timemillis() - s->start;
+
+	wget_thread_mutex_lock(&record_mutex);
+
+	if (!record_fp && !(record_fp = fopen(config.record_file, "wb")))
+		error_printf(_("Failed to open record file '%s' (%d)\n"), config.record_file, errno);
+
+	if (record_fp) {
+		fprintf(record_fp, "REPLAY %lld %zu %zu %s\n", latency, header_len, s->body->length, s->uri);
+		if (header_len)
+			fwrite(header, 1, header_len, record_fp);
+		fwrite(s->body->data, 1, s->body->length, record_fp);
+		fputc('\n', record_fp);
+	}
+
+	wget_thread_mutex_unlock(&record_mutex);
+
+	wget_buffer_free(&s->body);
+	xfree(s->uri);
+	xfree(s);
+	*stream = NULL;
+}
+
+void replay_free(void)
+{
+	if (record_fp) {
+		fclose(record_fp);
+		record_fp = NULL;
+	}
+}
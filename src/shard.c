@@ -0,0 +1,311 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Multi-process crawl sharding
+ *
+ * One process can't always saturate a fat link, and splitting the URL
+ * list by hand breaks cross-host deduplication. With --shard-id=I
+ * --shard-count=N, N cooperating processes partition the crawl by
+ * hostname: a consistent-hash ring maps each host to exactly one shard,
+ * and a URL discovered on the wrong shard is handed to its owner as one
+ * datagram on a Unix socket in --shard-dir (wget2-shard-<I>.sock).
+ *
+ *   wget2 --shard-count=4 --shard-id=0 --recursive ... &
+ *   wget2 --shard-count=4 --shard-id=1 --recursive ... &
+ *   ...
+ *
+ * Every process is started with the full seed list; the seeds it does
+ * not own are forwarded like any discovered URL. Deduplication stays
+ * correct per shard: the sender blacklists a URL before forwarding it
+ * (so it never forwards the same URL twice) and the owner runs it
+ * through its own blacklist like a locally discovered one. The ring
+ * uses virtual nodes, so a changed shard count moves only ~1/N of the
+ * hosts instead of reshuffling everything.
+ *
+ * If an owner is unreachable (not started yet, or crashed), the sender
+ * crawls the URL itself rather than losing it - coverage beats a clean
+ * partition.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_shard.h"
+
+// ring points per shard - enough that the host partition stays within a
+// few percent of even, cheap enough that building the ring is instant
+#define SHARD_VNODES 64
+
+// longest URL accepted over the shard socket; matches what a single
+// AF_UNIX datagram comfortably carries
+#define SHARD_MAX_URL 8192
+
+typedef struct {
+	uint64_t hash;
+	int owner;
+} ring_point_t;
+
+static ring_point_t
+	*ring;
+static int
+	ring_size;
+static int
+	recv_fd = -1, // our bound datagram socket, peers send to it
+	send_fd = -1; // unbound, used with sendto() towards the owners
+static char
+	*sock_path;
+static wget_thread_t
+	recv_thread;
+static shard_enqueue_fn
+	*enqueue_cb;
+static bool
+	*peer_warned; // one 'unreachable' diagnostic per peer
+
+static uint64_t _fnv64(const char *s)
+{
+	uint64_t h = 0xcbf29ce484222325ull; // FNV-1a
+
+	while (*s) {
+		h ^= (unsigned char) *s++;
+		h *= 0x100000001b3ull;
+	}
+
+	return h;
+}
+
+static int _ring_point_compare(const void *a, const void *b)
+{
+	uint64_t ha = ((const ring_point_t *) a)->hash, hb = ((const ring_point_t *) b)->hash;
+
+	return ha < hb ? -1 : (ha > hb ? 1 : 0);
+}
+
+// shard owning <host>: first ring point at or after the host's hash
+static int _shard_owner(const char *host)
+{
+	uint64_t h = _fnv64(host);
+	int lo = 0, hi = ring_size;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (ring[mid].hash < h)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return ring[lo == ring_size ? 0 : lo].owner; // wrap around
+}
+
+bool shard_local_host(const char *host)
+{
+	if (!ring)
+		return true; // sharding off (or disabled at init), everything is ours
+
+	return _shard_owner(host) == config.shard_id;
+}
+
+static void _peer_path(int owner, char *path, size_t size)
+{
+	snprintf(path, size, "%s/wget2-shard-%d.sock", config.shard_dir, owner);
+}
+
+// Hand <url> to the shard owning <host>.
+// Returns 0 when the datagram went out, -1 when the owner is unreachable
+// and the caller should crawl the URL itself.
+int shard_forward(const char *host, const char *url)
+{
+	struct sockaddr_un addr;
+	size_t url_len = strlen(url);
+	int owner;
+
+	if (!ring || send_fd == -1)
+		return -1;
+
+	if (url_len == 0 || url_len > SHARD_MAX_URL)
+		return -1; // a 0-byte datagram is the receiver's shutdown signal
+
+	owner = _shard_owner(host);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	_peer_path(owner, addr.sun_path, sizeof(addr.sun_path));
+
+	if (sendto(send_fd, url, url_len, 0, (struct sockaddr *) &addr, sizeof(addr)) == (ssize_t) url_len) {
+		peer_warned[owner] = false;
+		return 0;
+	}
+
+	if (!peer_warned[owner]) {
+		error_printf(_("Shard %d unreachable at '%s' (errno=%d), crawling its URLs here\n"),
+			owner, addr.sun_path, errno);
+		peer_warned[owner] = true;
+	}
+
+	return -1;
+}
+
+static void *_recv_thread(void *p G_GNUC_WGET_UNUSED)
+{
+	char buf[SHARD_MAX_URL + 1];
+
+	for (;;) {
+		ssize_t n = recv(recv_fd, buf, sizeof(buf) - 1, 0); // cancellation point
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			break; // recv_fd went away on shutdown
+		}
+
+		if (n == 0)
+			break; // empty datagram = shutdown signal
+
+		buf[n] = 0;
+		debug_printf("shard: received '%s'\n", buf);
+		enqueue_cb(buf);
+	}
+
+	return NULL;
+}
+
+void shard_init(shard_enqueue_fn *enqueue)
+{
+	struct sockaddr_un addr;
+	char path[sizeof(addr.sun_path)];
+
+	if (config.shard_count <= 1)
+		return;
+
+	if (config.shard_id < 0 || config.shard_id >= config.shard_count) {
+		error_printf(_("Invalid shard id %d (shard count %d), disabling sharding\n"),
+			config.shard_id, config.shard_count);
+		return;
+	}
+
+	if (!wget_thread_support()) {
+		error_printf(_("No thread support, disabling sharding\n"));
+		return;
+	}
+
+	_peer_path(config.shard_id, path, sizeof(path));
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		error_printf(_("Shard directory path too long '%s'\n"), config.shard_dir);
+		return;
+	}
+
+	if ((recv_fd = socket(AF_UNIX, SOCK_DGRAM, 0)) == -1
+		|| (send_fd = socket(AF_UNIX, SOCK_DGRAM, 0)) == -1)
+	{
+		error_printf(_("Failed to create shard socket (errno=%d)\n"), errno);
+		goto fail;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	unlink(path); // a stale socket from a dead instance
+
+	if (bind(recv_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+		error_printf(_("Failed to bind shard socket '%s' (errno=%d)\n"), path, errno);
+		goto fail;
+	}
+
+	// the consistent-hash ring: SHARD_VNODES points per shard, sorted
+	ring_size = config.shard_count * SHARD_VNODES;
+	ring = wget_malloc(ring_size * sizeof(ring_point_t));
+
+	for (int owner = 0; owner < config.shard_count; owner++) {
+		for (int v = 0; v < SHARD_VNODES; v++) {
+			char point[48];
+
+			snprintf(point, sizeof(point), "%d-%d", owner, v);
+			ring[owner * SHARD_VNODES + v].hash = _fnv64(point);
+			ring[owner * SHARD_VNODES + v].owner = owner;
+		}
+	}
+
+	qsort(ring, ring_size, sizeof(ring_point_t), _ring_point_compare);
+
+	peer_warned = wget_calloc(config.shard_count, sizeof(bool));
+	sock_path = wget_strdup(path);
+	enqueue_cb = enqueue;
+
+	if (wget_thread_start(&recv_thread, _recv_thread, NULL, 0)) {
+		error_printf(_("Failed to start shard receiver thread\n"));
+		xfree(peer_warned);
+		xfree(sock_path);
+		xfree(ring);
+		ring_size = 0;
+		goto fail;
+	}
+
+	debug_printf("shard %d/%d listening on '%s'\n", config.shard_id, config.shard_count, sock_path);
+	return;
+
+fail:
+	if (recv_fd != -1) {
+		close(recv_fd);
+		recv_fd = -1;
+	}
+	if (send_fd != -1) {
+		close(send_fd);
+		send_fd = -1;
+	}
+}
+
+void shard_exit(void)
+{
+	if (recv_fd != -1) {
+		wget_thread_cancel(recv_thread);
+		wget_thread_join(recv_thread);
+
+		close(recv_fd);
+		recv_fd = -1;
+		unlink(sock_path);
+	}
+
+	if (send_fd != -1) {
+		close(send_fd);
+		send_fd = -1;
+	}
+
+	xfree(sock_path);
+	xfree(peer_warned);
+	xfree(ring);
+	ring_size = 0;
+}
@@ -0,0 +1,382 @@
+/*
+ * Copyright(c) 2017-2019 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Queue/blacklist snapshot routines
+ *
+ * A snapshot is a flat binary file of fixed-size records so a restarted
+ * crawl can resume without re-parsing or re-crawling: pending URLs are
+ * re-queued, already processed URLs just go into the blacklist. Records
+ * are written with a single fwrite each and loaded straight from an
+ * mmap'ed (or bulk-read) view without any per-entry parsing.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_job.h"
+#include "wget_host.h"
+#include "wget_blacklist.h"
+#include "wget_snapshot.h"
+
+#define SNAPSHOT_MAGIC "WG2SNAP\1"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_URI_SIZE 2040 // URIs longer than this are dropped from the snapshot
+
+#define SNAPSHOT_REC_DONE     0 // URL has been seen, just blacklist it on load
+#define SNAPSHOT_REC_QUEUED   1 // URL was still pending, re-queue it on load
+#define SNAPSHOT_REC_FINISHED 2 // journal: URL completed after the last full save
+
+typedef struct {
+	char
+		magic[8];
+	uint32_t
+		version,
+		nrecords;
+} snapshot_header_t;
+
+typedef struct {
+	uint32_t
+		type,
+		unused; // pad the URI to an 8-byte boundary
+	char
+		uri[SNAPSHOT_URI_SIZE]; // zero-terminated
+} snapshot_record_t;
+
+// In-memory journal of queue changes since the last flush. Downloader
+// threads append fixed-size records under a short lock; the checkpoint
+// timer steals the whole buffer and appends it to the snapshot file, so
+// a checkpoint costs O(changes) and never blocks the crawl on file I/O.
+static wget_buffer_t
+	*journal;
+static wget_thread_mutex_t
+	journal_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+void snapshot_journal_add(bool finished, const char *uri)
+{
+	snapshot_record_t rec;
+
+	if (!config.snapshot_file)
+		return;
+
+	if (strlen(uri) >= sizeof(rec.uri))
+		return; // over-long URIs are dropped from full snapshots, too
+
+	memset(&rec, 0, sizeof(rec));
+	rec.type = finished ? SNAPSHOT_REC_FINISHED : SNAPSHOT_REC_QUEUED;
+	wget_strscpy(rec.uri, uri, sizeof(rec.uri));
+
+	wget_thread_mutex_lock(&journal_mutex);
+	if (!journal)
+		journal = wget_buffer_alloc(64 * sizeof(snapshot_record_t));
+	wget_buffer_memcat(journal, (const char *) &rec, sizeof(rec));
+	wget_thread_mutex_unlock(&journal_mutex);
+}
+
+// a full rewrite captures the exact current state, pending journal
+// entries would only duplicate it
+static void _journal_reset(void)
+{
+	wget_thread_mutex_lock(&journal_mutex);
+	wget_buffer_free(&journal);
+	wget_thread_mutex_unlock(&journal_mutex);
+}
+
+struct snapshot_write_context {
+	FILE
+		*fp;
+	uint32_t
+		nrecords;
+};
+
+static int _write_record(struct snapshot_write_context *ctx, uint32_t type, const char *uri)
+{
+	snapshot_record_t rec;
+
+	if (strlen(uri) >= sizeof(rec.uri)) {
+		debug_printf("snapshot: URI too long, dropped: %s\n", uri);
+		return 0;
+	}
+
+	memset(&rec, 0, sizeof(rec));
+	rec.type = type;
+	wget_strscpy(rec.uri, uri, sizeof(rec.uri));
+
+	if (fwrite(&rec, sizeof(rec), 1, ctx->fp) != 1)
+		return -1;
+
+	ctx->nrecords++;
+
+	return 0;
+}
+
+static int _snapshot_queued_job(struct snapshot_write_context *ctx, JOB *job)
+{
+	if (job->iri)
+		return _write_record(ctx, SNAPSHOT_REC_QUEUED, job->iri->uri) < 0;
+
+	return 0;
+}
+
+static int _snapshot_blacklist_entry(struct snapshot_write_context *ctx, const wget_iri_t *iri)
+{
+	return _write_record(ctx, SNAPSHOT_REC_DONE, iri->uri) < 0;
+}
+
+void snapshot_save(void)
+{
+	struct snapshot_write_context ctx = { .nrecords = 0 };
+	snapshot_header_t header;
+	char *tmpname;
+
+	if (!config.snapshot_file)
+		return;
+
+	// write into a temporary file and rename() so a crash while
+	// snapshotting never clobbers the previous good snapshot
+	tmpname = wget_aprintf("%s.tmp", config.snapshot_file);
+
+	if (!(ctx.fp = fopen(tmpname, "wb"))) {
+		error_printf(_("Failed to write snapshot %s (%d)\n"), tmpname, errno);
+		xfree(tmpname);
+		return;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+
+	if (fwrite(&header, sizeof(header), 1, ctx.fp) != 1)
+		goto fail;
+
+	// pending jobs first: on load they are re-queued (which also blacklists
+	// them), so their later DONE records become no-ops
+	if (hosts_browse_jobs((int (*)(void *, JOB *))_snapshot_queued_job, &ctx))
+		goto fail;
+
+	if (blacklist_browse((int (*)(void *, const wget_iri_t *))_snapshot_blacklist_entry, &ctx))
+		goto fail;
+
+	// patch the record count into the header
+	header.nrecords = ctx.nrecords;
+	if (fseek(ctx.fp, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, ctx.fp) != 1)
+		goto fail;
+
+	if (fclose(ctx.fp)) {
+		ctx.fp = NULL;
+		goto fail;
+	}
+
+	if (rename(tmpname, config.snapshot_file)) {
+		error_printf(_("Failed to rename %s to %s (%d)\n"), tmpname, config.snapshot_file, errno);
+		unlink(tmpname);
+		xfree(tmpname);
+		return;
+	}
+
+	debug_printf("snapshot: saved %u records to %s\n", (unsigned) ctx.nrecords, config.snapshot_file);
+	_journal_reset();
+	xfree(tmpname);
+	return;
+
+fail:
+	error_printf(_("Failed to write snapshot %s (%d)\n"), tmpname, errno);
+	if (ctx.fp)
+		fclose(ctx.fp);
+	unlink(tmpname);
+	xfree(tmpname);
+}
+
+// Append the journaled queue changes to the snapshot file and patch the
+// record count in the header. The count is updated only after the records
+// hit the disk, so a crash mid-append leaves the previous consistent view.
+void snapshot_checkpoint(void)
+{
+	wget_buffer_t *out;
+	snapshot_header_t header;
+	FILE *fp;
+
+	if (!config.snapshot_file)
+		return;
+
+	wget_thread_mutex_lock(&journal_mutex);
+	out = journal;
+	journal = NULL;
+	wget_thread_mutex_unlock(&journal_mutex);
+
+	if (!out)
+		return; // nothing changed since the last checkpoint
+
+	if (!(fp = fopen(config.snapshot_file, "r+b"))) {
+		// first checkpoint of a fresh crawl - create the file
+		if (!(fp = fopen(config.snapshot_file, "w+b"))) {
+			error_printf(_("Failed to write snapshot %s (%d)\n"), config.snapshot_file, errno);
+			wget_buffer_free(&out);
+			return;
+		}
+
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+		header.version = SNAPSHOT_VERSION;
+
+		if (fwrite(&header, sizeof(header), 1, fp) != 1)
+			goto fail;
+	} else if (fread(&header, sizeof(header), 1, fp) != 1
+		|| memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic))
+		|| header.version != SNAPSHOT_VERSION)
+	{
+		// don't append to something that isn't ours - the next full save rewrites it
+		fclose(fp);
+		wget_buffer_free(&out);
+		return;
+	}
+
+	if (fseek(fp, 0, SEEK_END)
+		|| fwrite(out->data, 1, out->length, fp) != out->length
+		|| fflush(fp))
+		goto fail;
+
+	header.nrecords += (uint32_t) (out->length / sizeof(snapshot_record_t));
+
+	if (fseek(fp, 0, SEEK_SET) || fwrite(&header, sizeof(header), 1, fp) != 1 || fflush(fp))
+		goto fail;
+
+	fsync(fileno(fp));
+	fclose(fp);
+
+	debug_printf("snapshot: checkpointed %zu records\n", out->length / sizeof(snapshot_record_t));
+	wget_buffer_free(&out);
+	return;
+
+fail:
+	error_printf(_("Failed to write snapshot %s (%d)\n"), config.snapshot_file, errno);
+	fclose(fp);
+	wget_buffer_free(&out);
+}
+
+void snapshot_load(void)
+{
+	const char *data = NULL;
+	size_t size = 0;
+	const snapshot_header_t *header;
+	const snapshot_record_t *rec;
+	uint32_t nrecords, queued = 0, known = 0;
+	int fd = -1;
+	char *filedata = NULL;
+#ifdef HAVE_MMAP
+	void *map = MAP_FAILED;
+	struct stat st;
+#endif
+
+	if (!config.snapshot_file)
+		return;
+
+	if ((fd = open(config.snapshot_file, O_RDONLY | O_BINARY)) == -1)
+		return; // no snapshot yet - a fresh crawl
+
+#ifdef HAVE_MMAP
+	if (fstat(fd, &st) == 0 && (map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+		data = map;
+		size = st.st_size;
+	}
+#endif
+	if (!data) {
+		close(fd); fd = -1;
+		if (!(filedata = wget_read_file(config.snapshot_file, &size))) {
+			error_printf(_("Failed to read snapshot %s\n"), config.snapshot_file);
+			return;
+		}
+		data = filedata;
+	}
+
+	if (size < sizeof(snapshot_header_t))
+		goto invalid;
+
+	header = (const snapshot_header_t *) data;
+
+	if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) || header->version != SNAPSHOT_VERSION)
+		goto invalid;
+
+	nrecords = header->nrecords;
+	if (size < sizeof(snapshot_header_t) + (size_t) nrecords * sizeof(snapshot_record_t))
+		goto invalid;
+
+	rec = (const snapshot_record_t *) (data + sizeof(snapshot_header_t));
+
+	// first pass: URLs the journal recorded as completed. They must be
+	// known before the QUEUED records are replayed - a journaled crawl
+	// appends QUEUED at discovery and FINISHED at completion, and the
+	// re-queueing below skips anything already blacklisted.
+	for (uint32_t it = 0; it < nrecords; it++) {
+		if (!memchr(rec[it].uri, 0, sizeof(rec[it].uri)))
+			goto invalid;
+
+		if (rec[it].type == SNAPSHOT_REC_FINISHED) {
+			blacklist_add(wget_iri_parse(rec[it].uri, "utf-8"));
+			known++;
+		}
+	}
+
+	// second pass in file order: pending URLs are re-queued (which also
+	// blacklists them), so the DONE records of a full save become no-ops
+	for (uint32_t it = 0; it < nrecords; it++) {
+		if (rec[it].type == SNAPSHOT_REC_QUEUED) {
+			queue_url_from_snapshot(rec[it].uri);
+			queued++;
+		} else if (rec[it].type == SNAPSHOT_REC_DONE) {
+			// mark as known so recursion doesn't fetch it again
+			blacklist_add(wget_iri_parse(rec[it].uri, "utf-8"));
+			known++;
+		}
+	}
+
+	info_printf(_("Resumed snapshot %s: %u pending, %u known URLs\n"),
+		config.snapshot_file, (unsigned) queued, (unsigned) known);
+
+cleanup:
+#ifdef HAVE_MMAP
+	if (map != MAP_FAILED)
+		munmap(map, size);
+#endif
+	if (fd != -1)
+		close(fd);
+	xfree(filedata);
+	return;
+
+invalid:
+	error_printf(_("Invalid snapshot file %s - ignored\n"), config.snapshot_file);
+	goto cleanup;
+}
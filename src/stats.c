@@ -30,12 +30,20 @@
 #include "wget_stats.h"
 #include "wget_options.h"
 #include "wget_host.h"
+#include "wget_blacklist.h"
+#include "wget_dedup.h"
+#include "wget_frontier.h"
+#include "wget_pack.h"
+#include "wget_warc.h"
+#include "wget_metrics.h"
+#include "wget_latency.h"
 
 #define NULL_TO_DASH(s) ((s) ? (s) : "-")
 #define ONE_ZERO_DASH(s) ((s) ? ((s) == 1 ? "1" : "-") : "0")
 #define ON_OFF_DASH(s) ((s) ? ((s) == 1 ? "On" : "-") : "Off")
 #define YES_NO(s) ((s) ? "Yes" : "No")
 #define HTTP_1_2(s) ((s) == WGET_PROTOCOL_HTTP_1_1 ? "HTTP/1.1" : ((s) == WGET_PROTOCOL_HTTP_2_0 ? "HTTP/2" : "-"))
+#define PIN_CHECK(s) ((s) ? ((s) == 1 ? "Cached" : "-") : "Computed")
 #define HTTP_S_DASH(s) (strcmp(s, "http") ? (strcmp(s, "https") ? s : "1") : "0")
 
 static wget_vector_t
@@ -181,12 +189,88 @@ static HOST_DOCS *host_docs_get(wget_hashmap_t *host_docs, int status)
 	return host_docsp;
 }
 
-DOC *stats_docs_add(wget_iri_t *iri, wget_http_response_t *resp)
+// --stats-site bookkeeping used to lock two global mutexes and touch several
+// hashmaps on every completed document, serializing the downloader threads.
+// A completion is now just appended to a striped per-thread cell (the global
+// sequence number is the only shared write) and the records are rolled up
+// into the host_docs/tree_docs structures on demand, when the stats output
+// needs them.
+#define SITE_STATS_CELLS 64 // power of 2, >= number of downloader threads
+
+typedef struct {
+	wget_iri_t
+		*parent_iri,
+		*iri;
+	long long
+		seq, // global completion order - a parent rolls up before its children
+		request_start,
+		response_end,
+		initial_response_duration,
+		size_downloaded,
+		size_decompressed;
+	int
+		code;
+	char
+		encoding;
+	bool
+		head_req : 1,
+		robot : 1,
+		redirect : 1;
+} SITE_STATS_RECORD;
+
+typedef struct {
+	wget_thread_mutex_t
+		mutex; // only ever contended by the rollup
+	SITE_STATS_RECORD
+		*records;
+	int
+		count,
+		max;
+} SITE_STATS_CELL;
+
+static SITE_STATS_CELL
+	site_stats_cells[SITE_STATS_CELLS] = { [0 ... SITE_STATS_CELLS - 1] = { .mutex = WGET_THREAD_MUTEX_INITIALIZER } };
+
+static long long
+	site_stats_seq;
+
+void stats_site_add(wget_iri_t *parent_iri, wget_iri_t *iri, wget_http_response_t *resp, bool robot_iri, bool redirect)
+{
+	SITE_STATS_CELL *cell = &site_stats_cells[(unsigned long) wget_thread_self() & (SITE_STATS_CELLS - 1)];
+	SITE_STATS_RECORD record = {
+		.parent_iri = parent_iri,
+		.iri = iri,
+		.seq = __sync_fetch_and_add(&site_stats_seq, 1),
+		.request_start = resp->req->request_start,
+		.response_end = resp->response_end,
+		.initial_response_duration = resp->req->first_response_start - resp->req->request_start,
+		.size_downloaded = resp->cur_downloaded,
+		.size_decompressed = resp->body->length,
+		.code = resp->code,
+		.encoding = resp->content_encoding,
+		.head_req = !wget_strcasecmp_ascii(resp->req->method, "HEAD"),
+		.robot = robot_iri,
+		.redirect = redirect,
+	};
+
+	wget_thread_mutex_lock(&cell->mutex);
+
+	if (cell->count == cell->max) {
+		cell->max = cell->max ? cell->max * 2 : 256;
+		cell->records = wget_realloc(cell->records, cell->max * sizeof(SITE_STATS_RECORD));
+	}
+	cell->records[cell->count++] = record;
+
+	wget_thread_mutex_unlock(&cell->mutex);
+}
+
+static DOC *stats_docs_add(SITE_STATS_RECORD *record)
 {
 	wget_hashmap_t *host_docs, *docs;
 	HOST_DOCS *host_docsp;
 	DOC *doc;
 	HOST *hostp;
+	wget_iri_t *iri = record->iri;
 
 	if (!(hostp = stats_host_get(iri))) {
 		error_printf("No existing host entry for iri->uri = %s\n", iri->uri);
@@ -201,9 +285,9 @@ DOC *stats_docs_add(wget_iri_t *iri, wget_http_response_t *resp)
 		hostp->host_docs = host_docs;
 	}
 
-	if (!(host_docsp = host_docs_get(host_docs, resp->code))) {
+	if (!(host_docsp = host_docs_get(host_docs, record->code))) {
 		host_docsp = wget_calloc(1, sizeof(HOST_DOCS));
-		host_docsp->http_status = resp->code;
+		host_docsp->http_status = record->code;
 		host_docsp->docs = NULL;
 		wget_hashmap_put_noalloc(host_docs, host_docsp, host_docsp);
 	}
@@ -217,30 +301,29 @@ DOC *stats_docs_add(wget_iri_t *iri, wget_http_response_t *resp)
 	if (!(doc = stats_docs_get(docs, iri))) {
 		doc = wget_calloc(1, sizeof(DOC));
 		doc->iri = iri;
-		doc->status = resp->code;
-		doc->encoding = resp->content_encoding;
+		doc->status = record->code;
+		doc->encoding = record->encoding;
 
 		// Set the request start time (since this is the first request for the doc)
 		// request_end will be overwritten by any subsequent responses for the doc.
-		doc->request_start = resp->req->request_start;
-		doc->response_end = resp->response_end;
-		doc->initial_response_duration = resp->req->first_response_start - resp->req->request_start;
+		doc->request_start = record->request_start;
+		doc->response_end = record->response_end;
+		doc->initial_response_duration = record->initial_response_duration;
 
-		if (!wget_strcasecmp_ascii(resp->req->method, "HEAD"))
-			doc->head_req = true;
+		doc->head_req = record->head_req;
 		wget_hashmap_put_noalloc(docs, doc->iri, doc);
 
 	} else {
 		// The final response right now.
-		doc->response_end = resp->response_end;
+		doc->response_end = record->response_end;
 	}
 
-	if (resp->code == 206) { // --chunk-size
-		doc->size_downloaded += resp->cur_downloaded;
-		doc->size_decompressed += resp->body->length;
+	if (record->code == 206) { // --chunk-size
+		doc->size_downloaded += record->size_downloaded;
+		doc->size_decompressed += record->size_decompressed;
 	} else { // second GET after first HEAD for --spider
-		doc->size_downloaded = resp->cur_downloaded;
-		doc->size_decompressed = resp->body->length;
+		doc->size_downloaded = record->size_downloaded;
+		doc->size_decompressed = record->size_decompressed;
 	}
 
 	wget_thread_mutex_unlock(&host_docs_mutex);
@@ -248,12 +331,13 @@ DOC *stats_docs_add(wget_iri_t *iri, wget_http_response_t *resp)
 	return doc;
 }
 
-TREE_DOCS *stats_tree_docs_add(wget_iri_t *parent_iri, wget_iri_t *iri, wget_http_response_t *resp, bool robot_iri, bool redirect, DOC *doc)
+static TREE_DOCS *stats_tree_docs_add(SITE_STATS_RECORD *record, DOC *doc)
 {
 	HOST *hostp = NULL;
 	wget_hashmap_t *tree_docs;
 	TREE_DOCS *parent_node, *child_node = NULL;
 	wget_vector_t *children = NULL;
+	wget_iri_t *parent_iri = record->parent_iri, *iri = record->iri;
 
 	if (!doc)
 		return NULL;
@@ -291,12 +375,12 @@ TREE_DOCS *stats_tree_docs_add(wget_iri_t *parent_iri, wget_iri_t *iri, wget_htt
 		child_node->iri = iri;
 		child_node->doc = doc;
 		child_node->children = NULL;
-		child_node->redirect = redirect;
+		child_node->redirect = record->redirect;
 		wget_hashmap_put_noalloc(tree_docs, child_node->iri, child_node);
 	} else {
-		if (child_node->doc->head_req && wget_strcasecmp_ascii(resp->req->method, "HEAD")) {
+		if (child_node->doc->head_req && !record->head_req) {
 			child_node->doc = doc;
-			child_node->redirect = redirect;
+			child_node->redirect = record->redirect;
 		} else {
 			// error_printf("Existing entry for iri->uri = %s in tree_docs hashmap of host %s://%s\n", iri->uri, hostp->scheme, hostp->host);
 			goto out;
@@ -306,7 +390,7 @@ TREE_DOCS *stats_tree_docs_add(wget_iri_t *parent_iri, wget_iri_t *iri, wget_htt
 	if (parent_iri)
 		wget_vector_add_noalloc(children, child_node);
 	else {
-		if (robot_iri)
+		if (record->robot)
 			hostp->robot = child_node;
 		else
 			hostp->root = child_node;
@@ -324,6 +408,70 @@ out:
 	return child_node;
 }
 
+static int _site_stats_record_compare(const void *p1, const void *p2)
+{
+	const SITE_STATS_RECORD *r1 = p1, *r2 = p2;
+
+	return r1->seq < r2->seq ? -1 : (r1->seq > r2->seq ? 1 : 0);
+}
+
+// drain all cells and replay the records in completion order - a parent
+// document always completes before the links extracted from it, so its tree
+// node exists when the children are replayed
+void stats_site_rollup(void)
+{
+	SITE_STATS_RECORD *records = NULL;
+	int count = 0;
+
+	for (int it = 0; it < SITE_STATS_CELLS; it++) {
+		SITE_STATS_CELL *cell = &site_stats_cells[it];
+
+		wget_thread_mutex_lock(&cell->mutex);
+		if (cell->count) {
+			records = wget_realloc(records, (count + cell->count) * sizeof(SITE_STATS_RECORD));
+			memcpy(records + count, cell->records, cell->count * sizeof(SITE_STATS_RECORD));
+			count += cell->count;
+		}
+		xfree(cell->records);
+		cell->count = cell->max = 0;
+		wget_thread_mutex_unlock(&cell->mutex);
+	}
+
+	if (!count)
+		return;
+
+	qsort(records, count, sizeof(SITE_STATS_RECORD), _site_stats_record_compare);
+
+	for (int it = 0; it < count; it++)
+		stats_tree_docs_add(&records[it], stats_docs_add(&records[it]));
+
+	xfree(records);
+}
+
+
+// lightweight always-on path: per-host latency histograms plus the cheap
+// metrics counters, but no per-event records - constant memory per host
+static void light_stats_callback(wget_stats_type_t type, const void *stats)
+{
+	const long long *ms;
+
+	switch (type) {
+	case WGET_STATS_TYPE_DNS:
+		if ((ms = wget_tcp_get_stats_dns(WGET_STATS_DNS_SECS, stats)))
+			latency_add(wget_tcp_get_stats_dns(WGET_STATS_DNS_HOST, stats), LATENCY_DNS, *ms);
+		break;
+
+	case WGET_STATS_TYPE_TLS:
+		if ((ms = wget_tcp_get_stats_tls(WGET_STATS_TLS_SECS, stats)))
+			latency_add(wget_tcp_get_stats_tls(WGET_STATS_TLS_HOSTNAME, stats), LATENCY_TLS, *ms);
+		break;
+
+	default:
+		break;
+	}
+
+	metrics_stats_callback(type, stats);
+}
 
 static void stats_callback(wget_stats_type_t type, const void *stats)
 {
@@ -347,11 +495,15 @@ static void stats_callback(wget_stats_type_t type, const void *stats)
 		wget_vector_add(dns_stats_v, &dns_stats, sizeof(dns_stats_t));
 		wget_thread_mutex_unlock(&dns_mutex);
 
+		// keep the cheap counters and histograms in sync when full collection is on
+		metrics_stats_callback(type, stats);
+		latency_add(dns_stats.host, LATENCY_DNS, dns_stats.millisecs);
+
 		break;
 	}
 
 	case WGET_STATS_TYPE_TLS: {
-		tls_stats_t tls_stats = { .false_start = -1, .tfo = -1, .tls_con = -1, .resumed = -1, .tcp_protocol = -1, .cert_chain_size = -1, .millisecs = -1 };
+		tls_stats_t tls_stats = { .false_start = -1, .tfo = -1, .early_data = -1, .hpkp_cached = -1, .tls_con = -1, .resumed = -1, .tcp_protocol = -1, .cert_chain_size = -1, .millisecs = -1, .tcp_millisecs = -1, .hpkp_millisecs = -1 };
 
 		tls_stats.hostname = wget_strdup(wget_tcp_get_stats_tls(WGET_STATS_TLS_HOSTNAME, stats));
 		tls_stats.version = wget_strdup(wget_tcp_get_stats_tls(WGET_STATS_TLS_VERSION, stats));
@@ -382,10 +534,25 @@ static void stats_callback(wget_stats_type_t type, const void *stats)
 		if (wget_tcp_get_stats_tls(WGET_STATS_TLS_SECS, stats))
 			tls_stats.millisecs = *((long long *)wget_tcp_get_stats_tls(WGET_STATS_TLS_SECS, stats));
 
+		if (wget_tcp_get_stats_tls(WGET_STATS_TLS_TCP_SECS, stats))
+			tls_stats.tcp_millisecs = *((long long *)wget_tcp_get_stats_tls(WGET_STATS_TLS_TCP_SECS, stats));
+
+		if (wget_tcp_get_stats_tls(WGET_STATS_TLS_EARLY_DATA, stats))
+			tls_stats.early_data = *((char *)wget_tcp_get_stats_tls(WGET_STATS_TLS_EARLY_DATA, stats));
+
+		if (wget_tcp_get_stats_tls(WGET_STATS_TLS_HPKP_CACHED, stats))
+			tls_stats.hpkp_cached = *((char *)wget_tcp_get_stats_tls(WGET_STATS_TLS_HPKP_CACHED, stats));
+
+		if (wget_tcp_get_stats_tls(WGET_STATS_TLS_HPKP_SECS, stats))
+			tls_stats.hpkp_millisecs = *((long long *)wget_tcp_get_stats_tls(WGET_STATS_TLS_HPKP_SECS, stats));
+
 		wget_thread_mutex_lock(&tls_mutex);
 		wget_vector_add(tls_stats_v, &tls_stats, sizeof(tls_stats_t));
 		wget_thread_mutex_unlock(&tls_mutex);
 
+		metrics_stats_callback(type, stats);
+		latency_add(tls_stats.hostname, LATENCY_TLS, tls_stats.millisecs);
+
 		break;
 	}
 
@@ -510,12 +677,17 @@ void stats_init(void)
 		dns_stats_v = wget_vector_create(8, -2, NULL);
 		wget_vector_set_destructor(dns_stats_v, (wget_vector_destructor_t) free_dns_stats);
 		wget_tcp_set_stats_dns(stats_callback);
+	} else {
+		// counters and histograms only, no per-event records
+		wget_tcp_set_stats_dns(light_stats_callback);
 	}
 
 	if (stats_opts[WGET_STATS_TYPE_TLS].status) {
 		tls_stats_v = wget_vector_create(8, -2, NULL);
 		wget_vector_set_destructor(tls_stats_v, (wget_vector_destructor_t) free_tls_stats);
 		wget_tcp_set_stats_tls(stats_callback);
+	} else {
+		wget_tcp_set_stats_tls(light_stats_callback);
 	}
 
 	if (stats_opts[WGET_STATS_TYPE_SERVER].status) {
@@ -789,10 +961,15 @@ static void stats_print_human_tls_entry(struct json_stats *ctx, const tls_stats_
 	wget_buffer_printf_append(ctx->buf, "    Version         : %s\n", tls_stats->version);
 	wget_buffer_printf_append(ctx->buf, "    False Start     : %s\n", ON_OFF_DASH(tls_stats->false_start));
 	wget_buffer_printf_append(ctx->buf, "    TFO             : %s\n", ON_OFF_DASH(tls_stats->tfo));
+	wget_buffer_printf_append(ctx->buf, "    Early Data      : %s\n", ON_OFF_DASH(tls_stats->early_data));
 	wget_buffer_printf_append(ctx->buf, "    ALPN Protocol   : %s\n", tls_stats->alpn_proto);
 	wget_buffer_printf_append(ctx->buf, "    Resumed         : %s\n", YES_NO(tls_stats->resumed));
 	wget_buffer_printf_append(ctx->buf, "    TCP Protocol    : %s\n", HTTP_1_2(tls_stats->tcp_protocol));
 	wget_buffer_printf_append(ctx->buf, "    Cert Chain Size : %d\n", tls_stats->cert_chain_size);
+	wget_buffer_printf_append(ctx->buf, "    Pin Check       : %s\n", PIN_CHECK(tls_stats->hpkp_cached));
+	wget_buffer_printf_append(ctx->buf, "    Pin Check (ms)  : %lld\n", tls_stats->hpkp_millisecs);
+	wget_buffer_printf_append(ctx->buf, "    TCP connect\n");
+	wget_buffer_printf_append(ctx->buf, "    duration (ms)   : %lld\n", tls_stats->tcp_millisecs);
 	wget_buffer_printf_append(ctx->buf, "    TLS negotiation\n");
 	wget_buffer_printf_append(ctx->buf, "    duration (ms)   : %lld\n\n", tls_stats->millisecs);
 }
@@ -804,10 +981,14 @@ static void stats_print_json_tls_entry(struct json_stats *ctx, const tls_stats_t
 	wget_buffer_printf_append(ctx->buf, "%.*s\"TLSVersion\" : \"%s\",\n", ctx->ntabs + 2, tabs, tls_stats->version);
 	wget_buffer_printf_append(ctx->buf, "%.*s\"FalseStart\" : \"%s\",\n", ctx->ntabs + 2, tabs, ON_OFF_DASH(tls_stats->false_start));
 	wget_buffer_printf_append(ctx->buf, "%.*s\"TFO\" : \"%s\",\n", ctx->ntabs + 2, tabs, ON_OFF_DASH(tls_stats->tfo));
+	wget_buffer_printf_append(ctx->buf, "%.*s\"EarlyData\" : \"%s\",\n", ctx->ntabs + 2, tabs, ON_OFF_DASH(tls_stats->early_data));
 	wget_buffer_printf_append(ctx->buf, "%.*s\"ALPN\" : \"%s\",\n", ctx->ntabs + 2, tabs, tls_stats->alpn_proto);
 	wget_buffer_printf_append(ctx->buf, "%.*s\"Resumed\" : \"%s\",\n", ctx->ntabs + 2, tabs, YES_NO(tls_stats->resumed));
 	wget_buffer_printf_append(ctx->buf, "%.*s\"HTTPVersion\" : \"%s\",\n", ctx->ntabs + 2, tabs, HTTP_1_2(tls_stats->tcp_protocol));
 	wget_buffer_printf_append(ctx->buf, "%.*s\"Certificates\" : %d,\n", ctx->ntabs + 2, tabs, tls_stats->cert_chain_size);
+	wget_buffer_printf_append(ctx->buf, "%.*s\"PinCheck\" : \"%s\",\n", ctx->ntabs + 2, tabs, PIN_CHECK(tls_stats->hpkp_cached));
+	wget_buffer_printf_append(ctx->buf, "%.*s\"PinCheckDuration\" : %lld,\n", ctx->ntabs + 2, tabs, tls_stats->hpkp_millisecs);
+	wget_buffer_printf_append(ctx->buf, "%.*s\"TCPDuration\" : %lld,\n", ctx->ntabs + 2, tabs, tls_stats->tcp_millisecs);
 	wget_buffer_printf_append(ctx->buf, "%.*s\"Duration\" : %lld\n", ctx->ntabs + 2, tabs, tls_stats->millisecs);
 	if (ctx->last)
 		wget_buffer_printf_append(ctx->buf, "%.*s}\n", ctx->ntabs + 1, tabs);
@@ -817,16 +998,20 @@ static void stats_print_json_tls_entry(struct json_stats *ctx, const tls_stats_t
 
 static void stats_print_csv_tls_entry(struct json_stats *ctx, const tls_stats_t *tls_stats)
 {
-	wget_buffer_printf_append(ctx->buf, "%s,%s,%s,%s,%s,%s,%s,%d,%lld\n",
+	wget_buffer_printf_append(ctx->buf, "%s,%s,%s,%s,%s,%s,%s,%s,%d,%s,%lld,%lld,%lld\n",
 		tls_stats->hostname,
 		tls_stats->version,
 		ONE_ZERO_DASH(tls_stats->false_start),
 		ONE_ZERO_DASH(tls_stats->tfo),
+		ONE_ZERO_DASH(tls_stats->early_data),
 		tls_stats->alpn_proto,
 		tls_stats->resumed ? "1" : "0",
 		tls_stats->tcp_protocol == WGET_PROTOCOL_HTTP_1_1 ?
 			"1" : (tls_stats->tcp_protocol == WGET_PROTOCOL_HTTP_2_0 ? "2" : "-"),
 		tls_stats->cert_chain_size,
+		ONE_ZERO_DASH(tls_stats->hpkp_cached),
+		tls_stats->hpkp_millisecs,
+		tls_stats->tcp_millisecs,
 		tls_stats->millisecs);
 }
 
@@ -1026,7 +1211,7 @@ static void stats_print_csv(wget_stats_type_t type, wget_buffer_t *buf, FILE *fp
 		break;
 
 	case WGET_STATS_TYPE_TLS:
-		wget_buffer_printf(buf, "%s\n", "Hostname,TLSVersion,FalseStart,TFO,ALPN,Resumed,HTTPVersion,Certificates,Duration");
+		wget_buffer_printf(buf, "%s\n", "Hostname,TLSVersion,FalseStart,TFO,EarlyData,ALPN,Resumed,HTTPVersion,Certificates,PinCheckCached,PinCheckDuration,TCPDuration,Duration");
 		_stats_print(tls_stats_v, (wget_vector_browse_t) stats_print_csv_tls_entry, buf, fp, 0);
 		break;
 
@@ -1058,6 +1243,9 @@ void stats_print(void)
 	char sbuf[4096], *filename;
 	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
 
+	if (stats_opts[WGET_STATS_TYPE_SITE].status)
+		stats_site_rollup(); // build host_docs/tree_docs from the recorded completions
+
 	for (wget_stats_type_t type = 0; (int) type < (int) countof(stats_opts); type++) {
 		if (!stats_opts[type].status)
 			continue;
@@ -1116,4 +1304,61 @@ void stats_print(void)
 	}
 
 	wget_buffer_deinit(&buf);
+
+	// effectiveness of the bloom filter front end of the URL blacklist
+	long long bloom_hits, bloom_misses;
+	blacklist_stats(&bloom_hits, &bloom_misses);
+	if (bloom_hits || bloom_misses)
+		debug_printf("blacklist: %lld bloom hits (hashmap consulted), %lld bloom misses (lookup skipped)\n",
+			bloom_hits, bloom_misses);
+
+	// hosts that were parked by the failure circuit breaker
+	int breakers = hosts_breakers_tripped();
+	if (breakers)
+		debug_printf("host circuit breakers tripped: %d\n", breakers);
+
+	// duplicate downloads replaced by hardlinks (--dedup-content)
+	long long dedup_nfiles, dedup_nbytes;
+	dedup_stats(&dedup_nfiles, &dedup_nbytes);
+	if (dedup_nfiles)
+		debug_printf("dedup: %lld file%s hardlinked, %lld bytes of storage saved\n",
+			dedup_nfiles, dedup_nfiles != 1 ? "s" : "", dedup_nbytes);
+
+	// URLs that took the disk detour of the bounded frontier (--frontier-cap)
+	long long spilled;
+	frontier_stats(&spilled);
+	if (spilled)
+		debug_printf("frontier: %lld URLs spilled to disk\n", spilled);
+
+	// small bodies coalesced into packed segments (--pack-output)
+	long long packed;
+	pack_stats(&packed);
+	if (packed)
+		debug_printf("pack: %lld bodies packed\n", packed);
+
+	// raw responses archived as WARC records (--warc-file)
+	long long archived;
+	warc_stats(&archived);
+	if (archived)
+		debug_printf("warc: %lld records archived\n", archived);
+
+	if (config.alloc_stats) {
+		wget_alloc_stats_t alloc;
+		char cur_buf[16], peak_buf[16];
+
+		wget_alloc_stats_get(-1, &alloc);
+		info_printf(_("Allocations: %lld allocs, %lld frees, %s in use, %s peak\n"),
+			alloc.nallocs, alloc.nfrees,
+			wget_human_readable(cur_buf, sizeof(cur_buf), alloc.cur_bytes),
+			wget_human_readable(peak_buf, sizeof(peak_buf), alloc.peak_bytes));
+
+		for (int it = 0; it < WGET_ALLOC_TAG_MAX; it++) {
+			wget_alloc_stats_get(it, &alloc);
+			if (alloc.nallocs)
+				info_printf("  %-8s %10lld allocs %10s\n", wget_alloc_tag_name(it),
+					alloc.nallocs, wget_human_readable(cur_buf, sizeof(cur_buf), alloc.alloc_bytes));
+		}
+	}
+
+	latency_print();
 }
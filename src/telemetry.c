@@ -0,0 +1,393 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Progress telemetry socket
+ *
+ * With --telemetry-socket=PATH a Unix socket is created on which each
+ * connect is answered with one JSON line describing the current state:
+ * queue depth, totals from the metrics counters and the per-download
+ * progress that also feeds the progress bar (bytes, rate, ETA per slot).
+ * The connection is closed right after, so an orchestrator polls by
+ * connect/read/close instead of scraping log output:
+ *
+ *   nc -U /run/wget2-1.sock
+ *
+ * Per-slot updates from the downloader threads are plain stores into a
+ * fixed array, the serving thread only ever reads - no lock is taken on
+ * the download path.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_host.h"
+#include "wget_metrics.h"
+#include "wget_telemetry.h"
+
+typedef struct {
+	char
+		uri[256]; // truncated is fine, it's for display/matching
+	long long
+		expected,   // content length, -1 if unknown
+		downloaded,
+		begin_ms,
+		last_progress_ms,  // when 'downloaded' last changed, for the watchdog
+		last_downloaded;   // 'downloaded' at the last watchdog check
+	int
+		active,
+		phase; // telemetry_phase_t
+	bool
+		stall_warned; // one diagnostic per stall, reset on progress
+} telemetry_slot_t;
+
+// must match telemetry_phase_t slot for slot
+static const char *phase_names[TELEMETRY_PHASE_MAX] = {
+	"connect", // includes the TLS handshake
+	"request",
+	"read",
+};
+
+static telemetry_slot_t
+	*slots;
+static int
+	nslots;
+static wget_thread_t
+	serve_thread;
+static int
+	listen_fd = -1;
+static char
+	*socket_path;
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER; // guards slot begin/end vs. snapshot
+
+void telemetry_job_begin(int slot, const char *uri, ssize_t expected)
+{
+	telemetry_slot_t *s;
+
+	if (!slots || slot < 0 || slot >= nslots)
+		return;
+
+	s = &slots[slot];
+
+	wget_thread_mutex_lock(&mutex);
+	wget_strscpy(s->uri, uri ? uri : "", sizeof(s->uri));
+	s->expected = expected;
+	s->downloaded = 0;
+	s->begin_ms = wget_get_timemillis_coarse();
+	s->last_progress_ms = s->begin_ms;
+	s->last_downloaded = 0;
+	s->phase = TELEMETRY_PHASE_CONNECT;
+	s->stall_warned = false;
+	s->active = 1;
+	wget_thread_mutex_unlock(&mutex);
+}
+
+void telemetry_job_phase(int slot, telemetry_phase_t phase)
+{
+	if (!slots || slot < 0 || slot >= nslots)
+		return;
+
+	wget_thread_mutex_lock(&mutex);
+	slots[slot].phase = phase;
+	slots[slot].last_progress_ms = wget_get_timemillis_coarse(); // a phase change is progress
+	slots[slot].stall_warned = false;
+	wget_thread_mutex_unlock(&mutex);
+}
+
+// the content length becomes known with the response header
+void telemetry_job_expected(int slot, ssize_t expected)
+{
+	if (!slots || slot < 0 || slot >= nslots)
+		return;
+
+	wget_thread_mutex_lock(&mutex);
+	slots[slot].expected = expected;
+	wget_thread_mutex_unlock(&mutex);
+}
+
+// hot path - a single word store, torn reads just show a stale byte count
+void telemetry_job_downloaded(int slot, size_t nbytes)
+{
+	if (!slots || slot < 0 || slot >= nslots)
+		return;
+
+#if defined __GNUC__ || defined __clang__
+	__atomic_store_n(&slots[slot].downloaded, (long long) nbytes, __ATOMIC_RELAXED);
+#else
+	slots[slot].downloaded = (long long) nbytes;
+#endif
+}
+
+void telemetry_job_end(int slot)
+{
+	if (!slots || slot < 0 || slot >= nslots)
+		return;
+
+	wget_thread_mutex_lock(&mutex);
+	slots[slot].active = 0;
+	wget_thread_mutex_unlock(&mutex);
+}
+
+// URIs rarely need escaping, but a quote or backslash would break the JSON
+static void _append_json_string(wget_buffer_t *buf, const char *s)
+{
+	wget_buffer_memcat(buf, "\"", 1);
+
+	for (; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			wget_buffer_memcat(buf, "\\", 1);
+		if ((unsigned char) *s < 0x20)
+			continue; // control chars have no business in a URI
+		wget_buffer_memcat(buf, s, 1);
+	}
+
+	wget_buffer_memcat(buf, "\"", 1);
+}
+
+static void _snapshot(wget_buffer_t *buf)
+{
+	long long now = wget_get_timemillis_coarse();
+	int active = 0, jobs = 0;
+
+	wget_thread_mutex_lock(&mutex);
+
+	for (int it = 0; it < nslots; it++)
+		if (slots[it].active)
+			active++;
+
+	wget_buffer_printf(buf,
+		"{\"ts\":%lld,\"queue\":%d,\"active\":%d,\"requests\":%lld,\"files\":%lld,\"bytes\":%lld,\"jobs\":[",
+		(long long) time(NULL), queue_size(), active,
+		metrics_read(METRICS_HTTP_REQUESTS), metrics_read(METRICS_FILES_SAVED), metrics_read(METRICS_BYTES));
+
+	for (int it = 0; it < nslots; it++) {
+		telemetry_slot_t *s = &slots[it];
+		long long downloaded, elapsed_ms, rate;
+
+		if (!s->active)
+			continue;
+
+#if defined __GNUC__ || defined __clang__
+		downloaded = __atomic_load_n(&s->downloaded, __ATOMIC_RELAXED);
+#else
+		downloaded = s->downloaded;
+#endif
+		elapsed_ms = now - s->begin_ms;
+		rate = elapsed_ms > 0 ? downloaded * 1000 / elapsed_ms : 0; // bytes/s
+
+		wget_buffer_printf_append(buf, "%s{\"slot\":%d,\"uri\":", jobs++ ? "," : "", it);
+		_append_json_string(buf, s->uri);
+		wget_buffer_printf_append(buf, ",\"phase\":\"%s\",\"size\":%lld,\"got\":%lld,\"rate\":%lld",
+			phase_names[s->phase], s->expected, downloaded, rate);
+		if (s->expected > 0 && rate > 0)
+			wget_buffer_printf_append(buf, ",\"eta\":%lld", (s->expected - downloaded) / rate);
+		wget_buffer_memcat(buf, "}", 1);
+	}
+
+	wget_thread_mutex_unlock(&mutex);
+
+	wget_buffer_strcat(buf, "]}\n");
+}
+
+static wget_buffer_t
+	*snapshot_buf; // owned here, freed after the thread is joined
+
+static void *_serve_thread(void *p G_GNUC_WGET_UNUSED)
+{
+	wget_buffer_t *buf = snapshot_buf;
+
+	for (;;) {
+		int fd = accept(listen_fd, NULL, NULL); // cancellation point
+
+		if (fd == -1) {
+			if (errno == EINTR)
+				continue;
+			break; // listen_fd went away on shutdown
+		}
+
+		_snapshot(buf);
+
+		// short writes to a poller that went away are its problem, not ours
+		if (send(fd, buf->data, buf->length, MSG_NOSIGNAL) == -1)
+			debug_printf("telemetry write failed (errno=%d)\n", errno);
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+// Scan the slot table for downloads that haven't moved a byte for
+// config.watchdog_timeout seconds and log one compact diagnostic each -
+// enough to grep the stuck host and phase out of a long crawl log.
+// Called from the main loop, so a stall is detected within one wake-up.
+void telemetry_watchdog_check(void)
+{
+	long long now = wget_get_timemillis_coarse();
+	long long timeout_ms = config.watchdog_timeout * 1000LL;
+
+	wget_thread_mutex_lock(&mutex);
+
+	for (int it = 0; it < nslots; it++) {
+		telemetry_slot_t *s = &slots[it];
+		long long downloaded;
+
+		if (!s->active)
+			continue;
+
+#if defined __GNUC__ || defined __clang__
+		downloaded = __atomic_load_n(&s->downloaded, __ATOMIC_RELAXED);
+#else
+		downloaded = s->downloaded;
+#endif
+
+		if (downloaded != s->last_downloaded) {
+			s->last_downloaded = downloaded;
+			s->last_progress_ms = now;
+			s->stall_warned = false;
+			continue;
+		}
+
+		if (!s->stall_warned && now - s->last_progress_ms >= timeout_ms) {
+			error_printf(_("Watchdog: downloader #%d stalled %llds in %s phase (running %llds, %lld bytes): %s\n"),
+				it, (now - s->last_progress_ms) / 1000, phase_names[s->phase],
+				(now - s->begin_ms) / 1000, downloaded, s->uri);
+			s->stall_warned = true;
+		}
+	}
+
+	wget_thread_mutex_unlock(&mutex);
+}
+
+// current load derived from the slot table, for the plugin scheduler info
+void telemetry_active(int *busy, long long *received, long long *expected)
+{
+	int active = 0;
+	long long got = 0, announced = 0;
+
+	wget_thread_mutex_lock(&mutex);
+
+	for (int it = 0; it < nslots; it++) {
+		telemetry_slot_t *s = &slots[it];
+
+		if (!s->active)
+			continue;
+
+		active++;
+#if defined __GNUC__ || defined __clang__
+		got += __atomic_load_n(&s->downloaded, __ATOMIC_RELAXED);
+#else
+		got += s->downloaded;
+#endif
+		if (s->expected > 0)
+			announced += s->expected;
+	}
+
+	wget_thread_mutex_unlock(&mutex);
+
+	*busy = active;
+	*received = got;
+	*expected = announced;
+}
+
+void telemetry_init(void)
+{
+	struct sockaddr_un addr;
+
+	// the slot table also feeds the plugin scheduler-info API, so it is
+	// kept even without --telemetry-socket - it's a few hundred bytes
+	nslots = config.max_threads > 0 ? config.max_threads : 1;
+	slots = wget_calloc(nslots, sizeof(telemetry_slot_t));
+
+	if (!config.telemetry_socket)
+		return;
+
+	if (!wget_thread_support()) {
+		error_printf(_("No thread support, disabling telemetry socket\n"));
+		return;
+	}
+
+	if (strlen(config.telemetry_socket) >= sizeof(addr.sun_path)) {
+		error_printf(_("Telemetry socket path too long '%s'\n"), config.telemetry_socket);
+		return;
+	}
+
+	if ((listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+		error_printf(_("Failed to create telemetry socket (errno=%d)\n"), errno);
+		return;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, config.telemetry_socket);
+
+	unlink(config.telemetry_socket); // a stale socket from a dead instance
+
+	if (bind(listen_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1
+		|| listen(listen_fd, 8) == -1)
+	{
+		error_printf(_("Failed to bind telemetry socket '%s' (errno=%d)\n"), config.telemetry_socket, errno);
+		close(listen_fd);
+		listen_fd = -1;
+		return;
+	}
+
+	socket_path = wget_strdup(config.telemetry_socket);
+	snapshot_buf = wget_buffer_alloc(4096);
+
+	if (wget_thread_start(&serve_thread, _serve_thread, NULL, 0)) {
+		error_printf(_("Failed to start telemetry thread\n"));
+		close(listen_fd);
+		listen_fd = -1;
+		wget_buffer_free(&snapshot_buf);
+	}
+}
+
+void telemetry_exit(void)
+{
+	if (listen_fd != -1) {
+		wget_thread_cancel(serve_thread);
+		wget_thread_join(serve_thread);
+
+		close(listen_fd);
+		listen_fd = -1;
+		unlink(socket_path);
+		wget_buffer_free(&snapshot_buf);
+	}
+
+	xfree(socket_path);
+	xfree(slots);
+	nslots = 0;
+}
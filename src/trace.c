@@ -0,0 +1,189 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Per-request tracing
+ *
+ * Tail latency can't be debugged from aggregate counters - you need the
+ * timeline of the slow request itself. With --trace-sample=N every Nth
+ * dequeued request gets a record in a preallocated ring and the hot path
+ * stamps nanosecond timestamps into it as the request passes through the
+ * pipeline (queue wait, connect, request, first/last byte, processing).
+ * A stamp is one clock_gettime() plus a store; unsampled requests pay a
+ * single NULL check per stage.
+ *
+ * The ring holds the last TRACE_RING_SIZE sampled requests. SIGUSR1
+ * requests a dump (printed from the main loop, the handler only sets a
+ * flag), and a final dump is written at exit. Slots are reused without
+ * locking - a record that is being overwritten while dumped can show a
+ * mixed timeline, acceptable for a debugging facility.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_trace.h"
+
+#define TRACE_RING_SIZE 1024 // records kept, power of two
+
+static const char *stage_names[TRACE_STAGE_MAX] = {
+	"queued",
+	"dequeue",
+	"connect",
+	"request",
+	"first_byte",
+	"last_byte",
+	"processed",
+};
+
+static trace_rec_t
+	*ring; // NULL while tracing is off - the only hot-path check
+static unsigned long long
+	next_seq, // claim ticket for ring slots
+	sample_nr; // running count of dequeued requests, for 1-in-N sampling
+static volatile sig_atomic_t
+	dump_requested;
+
+long long trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#if defined __GNUC__ || defined __clang__
+#define _fetch_inc(p) __atomic_fetch_add(p, 1, __ATOMIC_RELAXED)
+#else
+#define _fetch_inc(p) ((*(p))++)
+#endif
+
+void trace_init(void)
+{
+	if (config.trace_sample > 0)
+		ring = wget_calloc(TRACE_RING_SIZE, sizeof(trace_rec_t));
+}
+
+// claims a ring slot for every Nth request, returns NULL for the rest
+trace_rec_t *trace_begin(const char *uri, long long queued_ts)
+{
+	trace_rec_t *rec;
+	unsigned long long seq;
+
+	if (!ring)
+		return NULL;
+
+	if (_fetch_inc(&sample_nr) % config.trace_sample)
+		return NULL;
+
+	seq = _fetch_inc(&next_seq);
+	rec = &ring[seq % TRACE_RING_SIZE];
+
+	memset(rec, 0, sizeof(*rec));
+	rec->seq = seq + 1; // 0 = slot never used
+	wget_strscpy(rec->uri, uri ? uri : "-", sizeof(rec->uri));
+	rec->ts[TRACE_QUEUED] = queued_ts;
+	rec->ts[TRACE_DEQUEUE] = trace_now();
+
+	return rec;
+}
+
+void trace_stamp(trace_rec_t *rec, trace_stage_t stage)
+{
+	if (rec)
+		rec->ts[stage] = trace_now();
+}
+
+// called from the signal handler - just remember the wish
+void trace_dump_request(void)
+{
+	dump_requested = 1;
+}
+
+static void _dump_record(FILE *fp, const trace_rec_t *rec)
+{
+	// offsets in microseconds relative to the first stamped stage
+	long long base = 0;
+
+	for (int it = 0; it < TRACE_STAGE_MAX && !base; it++)
+		base = rec->ts[it];
+
+	fprintf(fp, "trace %llu", rec->seq);
+
+	for (int it = 0; it < TRACE_STAGE_MAX; it++) {
+		if (rec->ts[it])
+			fprintf(fp, " %s=+%lld.%03lldus", stage_names[it],
+				(rec->ts[it] - base) / 1000, (rec->ts[it] - base) % 1000);
+		else
+			fprintf(fp, " %s=-", stage_names[it]);
+	}
+
+	fprintf(fp, " %s\n", rec->uri);
+}
+
+void trace_dump(bool force)
+{
+	FILE *fp = stderr;
+	bool opened = false;
+
+	if (!ring || (!force && !dump_requested))
+		return;
+
+	dump_requested = 0;
+
+	if (config.trace_file && strcmp(config.trace_file, "-")) {
+		if (!(fp = fopen(config.trace_file, "a"))) {
+			error_printf(_("Failed to open trace file '%s' (errno=%d)\n"), config.trace_file, errno);
+			return;
+		}
+		opened = true;
+	}
+
+	// oldest first: continue behind the youngest claimed slot
+	for (unsigned it = 0; it < TRACE_RING_SIZE; it++) {
+		const trace_rec_t *rec = &ring[(next_seq + it) % TRACE_RING_SIZE];
+
+		if (rec->seq)
+			_dump_record(fp, rec);
+	}
+
+	if (opened)
+		fclose(fp);
+	else
+		fflush(fp);
+}
+
+void trace_exit(void)
+{
+	trace_dump(true);
+	xfree(ring);
+}
@@ -0,0 +1,281 @@
+/*
+ * Copyright(c) 2017-2019 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Persistent visited-URL filter (--visited-filter)
+ *
+ * Periodic re-crawls of a large site re-discover millions of URLs that
+ * were mirrored last time, enqueue them and drop each one again after a
+ * conditional request. With --visited-filter, completed downloads are
+ * recorded in a Bloom filter that persists across runs, and discovered
+ * URLs found in it are not enqueued at all - queue pressure stays
+ * proportional to new content instead of site size.
+ *
+ * The filter holds two generations, each spanning --revisit-after
+ * seconds. Completions go into the current generation, lookups consult
+ * both, and when the current generation ages out it replaces the
+ * previous one. A recorded URL is therefore skipped for at least one and
+ * at most two revisit intervals; with --revisit-after=0 entries never
+ * expire. Membership is approximate: a false positive (about 1 in 10^5
+ * at four million URLs per generation) skips a URL for one interval,
+ * which is acceptable for re-crawls by construction.
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_visited.h"
+
+#define VISITED_MAGIC "WG2SEEN\1"
+#define VISITED_VERSION 1
+#define VISITED_BITS (1u << 26) // bits per generation (8 MiB)
+#define VISITED_HASHES 6
+
+typedef struct {
+	char
+		magic[8];
+	uint32_t
+		version,
+		nhashes;
+	uint64_t
+		nbits;
+	int64_t
+		created; // when the current generation was started
+} visited_header_t;
+
+static uint8_t
+	*gen[2]; // bit arrays: [0] = current generation, [1] = previous
+static int64_t
+	created; // start of the current generation
+static bool
+	dirty; // filter changed since load, needs saving
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+// FNV-1a, the same construction shard.c uses for its hash ring
+static uint64_t _fnv64(const char *s)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+
+	while (*s) {
+		h ^= (unsigned char) *s++;
+		h *= 0x100000001b3ull;
+	}
+
+	return h;
+}
+
+// the classic double-hashing scheme: k indexes from two 64-bit hashes,
+// the second one derived by finalizer mixing so one string pass suffices
+static void _bit_positions(const char *uri, uint64_t pos[VISITED_HASHES])
+{
+	uint64_t h1 = _fnv64(uri);
+	uint64_t h2 = h1;
+
+	h2 ^= h2 >> 33;
+	h2 *= 0xff51afd7ed558ccdull;
+	h2 ^= h2 >> 29;
+	h2 |= 1; // odd step, cycles through all bit positions
+
+	for (int i = 0; i < VISITED_HASHES; i++)
+		pos[i] = (h1 + (uint64_t) i * h2) % VISITED_BITS;
+}
+
+static bool _test_gen(const uint8_t *bits, const uint64_t pos[VISITED_HASHES])
+{
+	for (int i = 0; i < VISITED_HASHES; i++)
+		if (!(bits[pos[i] >> 3] & (1 << (pos[i] & 7))))
+			return false;
+
+	return true;
+}
+
+// mutex must be held: age out the current generation when its interval
+// is over, so long daemon runs rotate just like restarts do
+static void _rotate(int64_t now)
+{
+	if (!config.revisit_after)
+		return; // entries never expire
+
+	if (now - created >= 2LL * config.revisit_after) {
+		memset(gen[0], 0, VISITED_BITS / 8);
+		memset(gen[1], 0, VISITED_BITS / 8);
+		created = now;
+		dirty = true;
+	} else if (now - created >= config.revisit_after) {
+		uint8_t *t = gen[1];
+
+		gen[1] = gen[0];
+		gen[0] = t;
+		memset(gen[0], 0, VISITED_BITS / 8);
+		created = now;
+		dirty = true;
+	}
+}
+
+void visited_load(void)
+{
+	visited_header_t header;
+	FILE *fp;
+
+	if (!config.visited_filter)
+		return;
+
+	gen[0] = wget_calloc(1, VISITED_BITS / 8);
+	gen[1] = wget_calloc(1, VISITED_BITS / 8);
+	created = time(NULL);
+
+	if (!(fp = fopen(config.visited_filter, "rb"))) {
+		if (errno != ENOENT)
+			error_printf(_("Failed to read visited filter %s (%d)\n"), config.visited_filter, errno);
+		return; // first run, start empty
+	}
+
+	if (fread(&header, sizeof(header), 1, fp) != 1
+		|| memcmp(header.magic, VISITED_MAGIC, sizeof(header.magic))
+		|| header.version != VISITED_VERSION
+		|| header.nhashes != VISITED_HASHES
+		|| header.nbits != VISITED_BITS)
+	{
+		// incompatible geometry can't be rehashed - start over
+		error_printf(_("Unusable visited filter %s - starting empty\n"), config.visited_filter);
+		fclose(fp);
+		return;
+	}
+
+	if (fread(gen[0], VISITED_BITS / 8, 1, fp) != 1
+		|| fread(gen[1], VISITED_BITS / 8, 1, fp) != 1)
+	{
+		error_printf(_("Failed to read visited filter %s - starting empty\n"), config.visited_filter);
+		memset(gen[0], 0, VISITED_BITS / 8);
+		memset(gen[1], 0, VISITED_BITS / 8);
+		fclose(fp);
+		return;
+	}
+
+	fclose(fp);
+
+	created = header.created;
+	_rotate(time(NULL));
+
+	debug_printf("visited: loaded filter from %s\n", config.visited_filter);
+}
+
+bool visited_test(const char *uri)
+{
+	uint64_t pos[VISITED_HASHES];
+	bool found;
+
+	if (!gen[0])
+		return false;
+
+	_bit_positions(uri, pos);
+
+	wget_thread_mutex_lock(&mutex);
+	_rotate(time(NULL));
+	found = _test_gen(gen[0], pos) || _test_gen(gen[1], pos);
+	wget_thread_mutex_unlock(&mutex);
+
+	return found;
+}
+
+void visited_add(const char *uri)
+{
+	uint64_t pos[VISITED_HASHES];
+
+	if (!gen[0])
+		return;
+
+	_bit_positions(uri, pos);
+
+	wget_thread_mutex_lock(&mutex);
+	_rotate(time(NULL));
+	for (int i = 0; i < VISITED_HASHES; i++)
+		gen[0][pos[i] >> 3] |= 1 << (pos[i] & 7);
+	dirty = true;
+	wget_thread_mutex_unlock(&mutex);
+}
+
+void visited_save(void)
+{
+	visited_header_t header;
+	char *tmpname;
+	FILE *fp;
+
+	if (!config.visited_filter || !gen[0] || !dirty)
+		return;
+
+	// write into a temporary file and rename() so a crash while saving
+	// never clobbers the previous good filter
+	tmpname = wget_aprintf("%s.tmp", config.visited_filter);
+
+	if (!(fp = fopen(tmpname, "wb"))) {
+		error_printf(_("Failed to write visited filter %s (%d)\n"), tmpname, errno);
+		xfree(tmpname);
+		return;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, VISITED_MAGIC, sizeof(header.magic));
+	header.version = VISITED_VERSION;
+	header.nhashes = VISITED_HASHES;
+	header.nbits = VISITED_BITS;
+	header.created = created;
+
+	if (fwrite(&header, sizeof(header), 1, fp) != 1
+		|| fwrite(gen[0], VISITED_BITS / 8, 1, fp) != 1
+		|| fwrite(gen[1], VISITED_BITS / 8, 1, fp) != 1)
+	{
+		error_printf(_("Failed to write visited filter %s (%d)\n"), tmpname, errno);
+		fclose(fp);
+		unlink(tmpname);
+		xfree(tmpname);
+		return;
+	}
+
+	if (fclose(fp) != 0) {
+		error_printf(_("Failed to write visited filter %s (%d)\n"), tmpname, errno);
+		unlink(tmpname);
+		xfree(tmpname);
+		return;
+	}
+
+	if (rename(tmpname, config.visited_filter)) {
+		error_printf(_("Failed to rename %s to %s (%d)\n"), tmpname, config.visited_filter, errno);
+		unlink(tmpname);
+	} else
+		debug_printf("visited: saved filter to %s\n", config.visited_filter);
+
+	xfree(tmpname);
+}
+
+void visited_free(void)
+{
+	xfree(gen[0]);
+	xfree(gen[1]);
+}
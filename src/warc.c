@@ -0,0 +1,327 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Streaming WARC-style archive output (--warc-file)
+ *
+ * Archival crawls used to save files first and convert them to WARC with an
+ * external tool, re-reading everything just written. This writer builds the
+ * archive concurrently with the download instead: the record header and the
+ * raw wire bytes (response header plus pre-decompression body) are appended
+ * to rotating segment files ('<prefix>-<thread>-NNNNN.warc') with an offset
+ * index ('<prefix>.warc.idx': segment, offset, length, URI). Each downloader
+ * thread owns its segment, so records never interleave and every stream is
+ * purely sequential. The record's Content-Length is reserved as a
+ * fixed-width field and patched in place once the record is complete -
+ * no second pass over the payload.
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include <wget.h>
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_warc.h"
+
+// rotate a segment beyond this size unless --warc-max-size says otherwise
+#define WARC_SEGMENT_MAX (1024LL * 1024 * 1024)
+
+// width of the reserved Content-Length field, patched when the record ends
+#define WARC_CLEN_DIGITS 15
+
+struct warc_stream {
+	FILE
+		*fp; // current segment
+	char
+		*fname, // name of the current segment
+		*uri; // target URI of the open record
+	long long
+		offset, // write position in the current segment
+		record_start, // segment offset of the open record
+		clen_pos, // segment offset of the reserved Content-Length field
+		payload; // HTTP header + body bytes of the open record
+	int
+		id, // downloader slot, part of the segment name
+		seq; // segment rotation counter
+	bool
+		in_record;
+};
+
+static warc_stream_t
+	**streams; // one stream per downloader slot, lazily created
+static int
+	nstreams;
+static FILE
+	*index_fp; // the offset index, append-only
+static long long
+	warc_nrecords;
+static wget_thread_mutex_t
+	mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static char *_segment_fname(int id, int seq)
+{
+	return wget_aprintf("%s-%d-%05d.warc", config.warc_file, id, seq);
+}
+
+// open the next segment of this stream, closing the previous one.
+// "x" skips over segments of an earlier run with the same prefix.
+static int _next_segment(warc_stream_t *stream)
+{
+	if (stream->fp) {
+		fclose(stream->fp);
+		stream->fp = NULL;
+	}
+	xfree(stream->fname);
+
+	do {
+		stream->fname = _segment_fname(stream->id, stream->seq);
+
+		if ((stream->fp = fopen(stream->fname, "w+bx")))
+			break;
+
+		if (errno != EEXIST) {
+			error_printf(_("Failed to open WARC segment '%s' (errno=%d)\n"), stream->fname, errno);
+			xfree(stream->fname);
+			return -1;
+		}
+
+		xfree(stream->fname);
+		stream->seq++;
+	} while (stream->seq < 100000);
+
+	if (!stream->fp)
+		return -1;
+
+	stream->offset = 0;
+	return 0;
+}
+
+// throw away a half-written record (transfer ended without a response)
+static void _record_abort(warc_stream_t *stream)
+{
+	fflush(stream->fp);
+	if (ftruncate(fileno(stream->fp), stream->record_start) != 0
+		|| fseeko(stream->fp, stream->record_start, SEEK_SET) != 0)
+	{
+		error_printf(_("Failed to truncate WARC segment '%s' (errno=%d)\n"), stream->fname, errno);
+		set_exit_status(WG_EXIT_STATUS_IO);
+	}
+
+	stream->offset = stream->record_start;
+	xfree(stream->uri);
+	stream->in_record = false;
+}
+
+// start a WARC response record: record header plus the raw HTTP response
+// header go out right away, body bytes follow via warc_record_append()
+warc_stream_t *warc_record_begin(int slot, const char *uri, const void *header, size_t length)
+{
+	warc_stream_t *stream;
+	char date[32], *rec;
+	const char *clen;
+	size_t reclen;
+	struct tm tm;
+	time_t t = time(NULL);
+
+	if (!config.warc_file || slot < 0)
+		return NULL;
+
+	wget_thread_mutex_lock(&mutex);
+
+	if (!streams) {
+		char *idxname = wget_aprintf("%s.warc.idx", config.warc_file);
+
+		index_fp = fopen(idxname, "a");
+		if (!index_fp)
+			error_printf(_("Failed to open WARC index '%s' (errno=%d)\n"), idxname, errno);
+		xfree(idxname);
+
+		nstreams = config.max_threads > 0 ? config.max_threads : 1;
+		streams = wget_calloc(nstreams, sizeof(*streams));
+	}
+
+	if (slot >= nstreams) {
+		wget_thread_mutex_unlock(&mutex);
+		return NULL;
+	}
+
+	if (!(stream = streams[slot])) {
+		stream = wget_calloc(1, sizeof(*stream));
+		stream->id = slot;
+
+		if (_next_segment(stream) != 0) {
+			xfree(stream);
+			wget_thread_mutex_unlock(&mutex);
+			return NULL;
+		}
+
+		streams[slot] = stream;
+	}
+
+	wget_thread_mutex_unlock(&mutex);
+
+	// from here on the stream is private to this downloader thread
+
+	if (stream->in_record)
+		_record_abort(stream);
+
+	if (stream->offset >= (config.warc_max_size > 0 ? config.warc_max_size : WARC_SEGMENT_MAX)) {
+		stream->seq++;
+		if (_next_segment(stream) != 0)
+			return NULL;
+	}
+
+	stream->record_start = stream->offset;
+
+	gmtime_r(&t, &tm);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+	rec = wget_aprintf(
+		"WARC/1.0\r\n"
+		"WARC-Type: response\r\n"
+		"WARC-Record-ID: <urn:uuid:%08x-%04x-%04x-%04x-%04x%08x>\r\n"
+		"WARC-Date: %s\r\n"
+		"WARC-Target-URI: %s\r\n"
+		"Content-Type: application/http;msgtype=response\r\n"
+		"Content-Length: %0*lld\r\n"
+		"\r\n",
+		(unsigned) wget_random(),
+		(unsigned) wget_random() & 0xFFFF,
+		((unsigned) wget_random() & 0x0FFF) | 0x4000,
+		((unsigned) wget_random() & 0x3FFF) | 0x8000,
+		(unsigned) wget_random() & 0xFFFF, (unsigned) wget_random(),
+		date, uri, WARC_CLEN_DIGITS, 0LL);
+
+	clen = strstr(rec, "\r\nContent-Length: ");
+	stream->clen_pos = stream->offset + (clen - rec) + 18;
+
+	reclen = strlen(rec);
+	if (fwrite(rec, 1, reclen, stream->fp) != reclen
+		|| fwrite(header, 1, length, stream->fp) != length)
+	{
+		error_printf(_("Failed to write to WARC segment '%s' (errno=%d)\n"), stream->fname, errno);
+		set_exit_status(WG_EXIT_STATUS_IO);
+		xfree(rec);
+		_record_abort(stream);
+		return NULL;
+	}
+	xfree(rec);
+
+	stream->offset += reclen + length;
+	stream->payload = length;
+	stream->uri = wget_strdup(uri);
+	stream->in_record = true;
+
+	return stream;
+}
+
+// append one wire chunk (pre-decompression) to the open record
+void warc_record_append(warc_stream_t *stream, const void *data, size_t length)
+{
+	if (!stream->in_record)
+		return;
+
+	if (fwrite(data, 1, length, stream->fp) != length) {
+		error_printf(_("Failed to write to WARC segment '%s' (errno=%d)\n"), stream->fname, errno);
+		set_exit_status(WG_EXIT_STATUS_IO);
+		_record_abort(stream);
+		return;
+	}
+
+	stream->offset += length;
+	stream->payload += length;
+}
+
+// complete the record: patch the reserved Content-Length field in place
+// and add the record to the offset index
+void warc_record_end(warc_stream_t *stream)
+{
+	char clen[WARC_CLEN_DIGITS + 1];
+
+	if (!stream || !stream->in_record)
+		return;
+
+	if (fwrite("\r\n\r\n", 1, 4, stream->fp) != 4) {
+		error_printf(_("Failed to write to WARC segment '%s' (errno=%d)\n"), stream->fname, errno);
+		set_exit_status(WG_EXIT_STATUS_IO);
+		_record_abort(stream);
+		return;
+	}
+	stream->offset += 4;
+
+	snprintf(clen, sizeof(clen), "%0*lld", WARC_CLEN_DIGITS, stream->payload);
+
+	if (fseeko(stream->fp, stream->clen_pos, SEEK_SET) != 0
+		|| fwrite(clen, 1, WARC_CLEN_DIGITS, stream->fp) != WARC_CLEN_DIGITS
+		|| fseeko(stream->fp, stream->offset, SEEK_SET) != 0)
+	{
+		error_printf(_("Failed to patch WARC record length in '%s' (errno=%d)\n"), stream->fname, errno);
+		set_exit_status(WG_EXIT_STATUS_IO);
+	}
+
+	wget_thread_mutex_lock(&mutex);
+	if (index_fp) {
+		// the URI goes last, so embedded spaces survive
+		fprintf(index_fp, "%s %lld %lld %s\n",
+			stream->fname, stream->record_start, stream->offset - stream->record_start, stream->uri);
+	}
+	warc_nrecords++;
+	wget_thread_mutex_unlock(&mutex);
+
+	xfree(stream->uri);
+	stream->in_record = false;
+}
+
+void warc_stats(long long *nrecords)
+{
+	*nrecords = warc_nrecords;
+}
+
+void warc_free(void)
+{
+	// no mutex locking needed - called on exit when all threads have ceased
+	for (int it = 0; it < nstreams; it++) {
+		warc_stream_t *stream = streams[it];
+
+		if (!stream)
+			continue;
+
+		if (stream->in_record)
+			_record_abort(stream); // interrupted transfer, drop the partial record
+
+		fclose(stream->fp);
+		xfree(stream->fname);
+		xfree(stream);
+	}
+	xfree(streams);
+	nstreams = 0;
+
+	if (index_fp) {
+		fclose(index_fp);
+		index_fp = NULL;
+	}
+}
@@ -43,9 +43,15 @@
 #include <regex.h>
 #include <sys/stat.h>
 #include <locale.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #ifdef _WIN32
 #include <windows.h> // GetFileAttributes()
+#else
+#include <dirent.h> // counting /proc/self/fd for the admission governor
+#include <sys/resource.h>
 #endif
 
 #include "timespec.h" // gnulib gettime()
@@ -67,15 +73,39 @@
 #include "wget_job.h"
 #include "wget_options.h"
 #include "wget_blacklist.h"
+#include "wget_bodycache.h"
+#include "wget_connpool.h"
+#include "wget_dedup.h"
+#include "wget_frontier.h"
+#include "wget_writer.h"
+#include "wget_pack.h"
+#include "wget_warc.h"
+#include "wget_replay.h"
+#include "wget_metrics.h"
+#include "wget_trace.h"
+#include "wget_telemetry.h"
+#include "wget_latency.h"
 #include "wget_host.h"
 #include "wget_bar.h"
 #include "wget_xattr.h"
 #include "wget_dl.h"
 #include "wget_plugin.h"
+#include "wget_shard.h"
+#include "wget_daemon.h"
 #include "wget_stats.h"
+#include "wget_snapshot.h"
+#include "wget_visited.h"
+
+// milliseconds an idle downloader thread waits for new work before it
+// exits to shrink the pool (main() restarts threads when the queue refills)
+#define THREAD_IDLE_TIMEOUT 10000
+#define DB_FLUSH_INTERVAL (15 * 60 * 1000) // flush dirty state databases every 15 minutes
 
 #define URL_FLG_REDIRECTION  (1<<0)
 #define URL_FLG_SITEMAP      (1<<1)
+#define URL_FLG_REQUISITE    (1<<2) // inline resource of a page (CSS, images, ...)
+#define URL_FLG_METALINK     (1<<3) // metalink description document
+#define URL_FLG_REQUEUED     (1<<4) // popped from the disk frontier, don't spill again
 
 #define _CONTENT_TYPE_HTML 1
 typedef struct {
@@ -109,14 +139,15 @@ typedef struct {
 static _statistics_t stats;
 
 static int G_GNUC_WGET_NONNULL((1)) _prepare_file(wget_http_response_t *resp, const char *fname, int flag,
-		const char *uri, const char *original_url, int ignore_patterns, wget_buffer_t *partial_content,
-		size_t max_partial_content);
+		int ignore_patterns, wget_buffer_t *partial_content,
+		size_t max_partial_content, char **actual_fname);
 
 static void
 	sitemap_parse_xml(JOB *job, const char *data, const char *encoding, wget_iri_t *base),
 	sitemap_parse_xml_gz(JOB *job, wget_buffer_t *data, const char *encoding, wget_iri_t *base),
 	sitemap_parse_xml_localfile(JOB *job, const char *fname, const char *encoding, wget_iri_t *base),
 	sitemap_parse_text(JOB *job, const char *data, const char *encoding, wget_iri_t *base),
+	sitemap_parse_body(JOB *job, const char *content_type, wget_buffer_t *body),
 	atom_parse(JOB *job, const char *data, const char *encoding, wget_iri_t *base),
 	atom_parse_localfile(JOB *job, const char *fname, const char *encoding, wget_iri_t *base),
 	rss_parse(JOB *job, const char *data, const char *encoding, wget_iri_t *base),
@@ -132,7 +163,10 @@ static int
 	http_send_request(wget_iri_t *iri, wget_iri_t *original_url, DOWNLOADER *downloader);
 wget_http_response_t
 	*http_receive_response(wget_http_connection_t *conn);
+static wget_http_request_t
+	*_accept_server_push(wget_http_connection_t *conn, const char *uri, wget_http_request_t *parent_req);
 static long long G_GNUC_WGET_NONNULL_ALL get_file_size(const char *fname);
+static time_t G_GNUC_WGET_NONNULL_ALL get_file_mtime(const char *fname);
 
 static wget_stringmap_t
 	*etags;
@@ -146,26 +180,52 @@ static long long
 	quota;
 static int
 	hsts_changed,
-	hpkp_changed;
+	hpkp_changed,
+	etag_changed,
+	caps_changed;
 static volatile int
 	terminate;
 int
 	nthreads;
 
+// directories already created (or found existing) this run - each unique
+// directory then costs exactly one mkdir instead of one per file saved into it.
+// Protected by the same mutex that protects mkdir_path().
+static wget_stringmap_t
+	*created_dirs;
+
+// next free numeric suffix per colliding base filename - without it every
+// save into a hot directory re-probes name.1, name.2, ... with a syscall
+// each, which degrades quadratically (40k stats for one directory were seen)
+static wget_stringmap_t
+	*unique_suffixes;
+static wget_thread_mutex_t
+	unique_suffixes_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
 // this function should be called protected by a mutex - else race conditions will happen
 static void mkdir_path(char *fname)
 {
 	char *p1, *p2;
 	int rc;
 
+	if (!created_dirs)
+		created_dirs = wget_stringmap_create(128);
+
 	for (p1 = fname + 1; *p1 && (p2 = strchr(p1, '/')); p1 = p2 + 1) {
 		*p2 = 0; // replace path separator
 
+		if (wget_stringmap_contains(created_dirs, fname)) {
+			*p2 = '/'; // restore path separator
+			continue;
+		}
+
 		// relative paths should have been normalized earlier,
 		// but for security reasons, don't trust myself...
 		if (*p1 == '.' && p1[1] == '.')
 			error_printf_exit(_("Internal error: Unexpected relative path: '%s'\n"), fname);
 
+		bool is_dir = true; // whether <fname> is a directory when this iteration ends
+
 		rc = mkdir(fname, 0755);
 
 		debug_printf("mkdir(%s)=%d errno=%d\n",fname,rc,errno);
@@ -192,8 +252,10 @@ static void mkdir_path(char *fname)
 						*p2 = '/'; // restore path separator
 						break;
 					}
-				} else
+				} else {
 					error_printf(_("Failed to rename '%s' (errno=%d)\n"), fname, errno);
+					is_dir = false;
+				}
 			} else if (errno != EEXIST) {
 				error_printf(_("Failed to make directory '%s' (errno=%d)\n"), fname, errno);
 				*p2 = '/'; // restore path separator
@@ -201,6 +263,26 @@ static void mkdir_path(char *fname)
 			}
 		} else debug_printf("created dir %s\n", fname);
 
+		if (is_dir)
+			wget_stringmap_put(created_dirs, fname, NULL, 0);
+
+		*p2 = '/'; // restore path separator
+	}
+}
+
+// forget the memoized directory chain of <fname> - called when an open fails
+// with ENOENT although the directories were created, i.e. something removed
+// them while we were running
+static void mkdir_path_forget(char *fname)
+{
+	char *p1, *p2;
+
+	if (!created_dirs)
+		return;
+
+	for (p1 = fname + 1; *p1 && (p2 = strchr(p1, '/')); p1 = p2 + 1) {
+		*p2 = 0; // replace path separator
+		wget_stringmap_remove(created_dirs, fname);
 		*p2 = '/'; // restore path separator
 	}
 }
@@ -218,6 +300,7 @@ static void mkdir_path(char *fname)
 const char * G_GNUC_WGET_NONNULL_ALL get_local_filename(wget_iri_t *iri)
 {
 	wget_buffer_t buf;
+	char buf_static[1024];
 	char *fname;
 	int directories;
 
@@ -232,7 +315,7 @@ const char * G_GNUC_WGET_NONNULL_ALL get_local_filename(wget_iri_t *iri)
 	if (config.force_directories == 1)
 		directories = 1;
 
-	wget_buffer_init(&buf, NULL, 256);
+	wget_buffer_init(&buf, buf_static, sizeof(buf_static));
 
 	if (config.directory_prefix && *config.directory_prefix) {
 		wget_buffer_strcat(&buf, config.directory_prefix);
@@ -309,10 +392,14 @@ const char * G_GNUC_WGET_NONNULL_ALL get_local_filename(wget_iri_t *iri)
 //	mkdir_path(fname);
 
 	if (config.delete_after) {
-		wget_buffer_deinit(&buf);
 		fname = NULL;
-	} else
+	} else {
 		debug_printf("local filename = '%s'\n", fname);
+		// one refcounted allocation, shared by all jobs referring to this file
+		fname = wget_refstr_memdup(buf.data, buf.length);
+	}
+
+	wget_buffer_deinit(&buf);
 
 	return fname;
 }
@@ -352,16 +439,232 @@ static void _atomic_increment_int(int *p)
 // we have to modify and check the quota in one (protected) step.
 static long long quota_modify_read(size_t nbytes)
 {
+	metrics_add(METRICS_BYTES, (long long) nbytes);
 	return _fetch_and_add_longlong(&quota, (long long)nbytes);
 }
 
+// Download admission control
+// ==========================
+// With a deep queue the downloader threads happily hold max-threads
+// connections plus an output file and buffers each, which on small boxes
+// ends in EMFILE or the OOM killer mid-crawl - wasting all completed work.
+// Instead of letting jobs fail, each thread checks the process against an
+// fd budget (derived from RLIMIT_NOFILE, or --fd-limit) and an optional
+// memory budget (--memory-limit) before admitting new work. While over
+// budget it keeps draining its in-flight responses - which is exactly
+// what releases descriptors and buffers - and re-checks periodically.
+
+#define GOVERNOR_CHECK_INTERVAL 500 // ms between /proc scans, they are not free
+#define GOVERNOR_FD_HEADROOM 64 // fds kept free for output files, DNS, plugins, ...
+
+static int
+	governor_fd_budget; // 0 = fd budget unknown, no fd governing
+
+static void governor_init(void)
+{
+#ifndef _WIN32
+	struct rlimit rl;
+
+	if (config.fd_limit > 0)
+		governor_fd_budget = config.fd_limit;
+	else if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY
+		&& (long long) rl.rlim_cur > 2 * GOVERNOR_FD_HEADROOM)
+	{
+		governor_fd_budget = (int) (rl.rlim_cur - GOVERNOR_FD_HEADROOM);
+	}
+#else
+	if (config.fd_limit > 0)
+		governor_fd_budget = config.fd_limit;
+#endif
+}
+
+// number of open file descriptors, -1 where the platform can't tell us
+static int count_open_fds(void)
+{
+#ifndef _WIN32
+	DIR *dir = opendir("/proc/self/fd");
+
+	if (dir) {
+		int count = 0;
+
+		while (readdir(dir))
+			count++;
+		closedir(dir);
+
+		return count - 3; // ., .. and the directory fd itself
+	}
+#endif
+	return -1;
+}
+
+// current resident set size in bytes, -1 where the platform can't tell us
+static long long current_rss(void)
+{
+#ifndef _WIN32
+	FILE *fp = fopen("/proc/self/statm", "r");
+
+	if (fp) {
+		long long vsize, resident;
+		int ok = fscanf(fp, "%lld %lld", &vsize, &resident) == 2;
+
+		fclose(fp);
+		if (ok)
+			return resident * (long long) sysconf(_SC_PAGESIZE);
+	}
+#endif
+	return -1;
+}
+
+// true when the process sits at its fd or memory budget and new downloads
+// should wait; the verdict is cached because both probes scan /proc
+static bool governor_should_delay(void)
+{
+	static wget_thread_mutex_t gov_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+	static long long last_check;
+	static bool delayed, warned;
+	bool ret;
+
+	if (!governor_fd_budget && !config.memory_limit)
+		return false;
+
+	long long now = wget_get_timemillis_coarse();
+
+	wget_thread_mutex_lock(&gov_mutex);
+
+	if (now - last_check >= GOVERNOR_CHECK_INTERVAL) {
+		const char *what = NULL;
+		int fds;
+		long long rss;
+
+		last_check = now;
+
+		if (governor_fd_budget && (fds = count_open_fds()) >= governor_fd_budget)
+			what = "file descriptor";
+		else if (config.memory_limit && (rss = current_rss()) >= config.memory_limit)
+			what = "memory";
+
+		delayed = what != NULL;
+
+		if (delayed && !warned) {
+			info_printf(_("At the %s budget - pausing new downloads until resources are released\n"), what);
+			warned = true;
+		} else if (!delayed && warned) {
+			debug_printf("governor: below budget again, admitting new downloads\n");
+			warned = false;
+		}
+	}
+
+	ret = delayed;
+	wget_thread_mutex_unlock(&gov_mutex);
+
+	return ret;
+}
+
 static wget_vector_t
 	*parents;
 static wget_thread_mutex_t
 	downloader_mutex = WGET_THREAD_MUTEX_INITIALIZER;
 
+// Compiled form of an accept/reject pattern list. The option vectors are
+// immutable after startup, so each list is classified once on first use:
+// plain patterns become a hash set that is probed once per distinct
+// pattern length, and only patterns with fnmatch() wildcards keep a
+// per-pattern loop. With large rule sets this turns the per-URL cost
+// from O(rules) into O(distinct literal lengths + wildcard rules).
+typedef struct {
+	const wget_vector_t *src; // the option vector this was built from
+	wget_vector_t *wildcards; // borrowed pointers into src
+	wget_stringmap_t *literals; // set of literal tail patterns
+	int *literal_lens; // the distinct literal pattern lengths
+	int nlens;
+} pattern_filter_t;
+
+static pattern_filter_t pattern_filters[2]; // --accept and --reject lists
+static wget_thread_mutex_t pattern_filter_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static pattern_filter_t *get_pattern_filter(const wget_vector_t *v)
+{
+	pattern_filter_t *f = NULL;
+
+	// fast path without taking the lock - src is published last
+	for (unsigned it = 0; it < countof(pattern_filters); it++)
+		if (pattern_filters[it].src == v)
+			return &pattern_filters[it];
+
+	wget_thread_mutex_lock(&pattern_filter_mutex);
+
+	for (unsigned it = 0; it < countof(pattern_filters); it++) {
+		if (pattern_filters[it].src == v) {
+			wget_thread_mutex_unlock(&pattern_filter_mutex);
+			return &pattern_filters[it];
+		}
+		if (!pattern_filters[it].src && !f)
+			f = &pattern_filters[it];
+	}
+
+	if (!f) { // more lists than slots - the caller falls back to a linear scan
+		wget_thread_mutex_unlock(&pattern_filter_mutex);
+		return NULL;
+	}
+
+	f->literals = config.ignore_case ? wget_stringmap_create_nocase(64) : wget_stringmap_create(64);
+	wget_stringmap_set_key_destructor(f->literals, NULL);
+	wget_stringmap_set_value_destructor(f->literals, NULL);
+	f->wildcards = wget_vector_create(16, -2, NULL);
+	wget_vector_set_destructor(f->wildcards, NULL);
+	f->literal_lens = wget_malloc(wget_vector_size(v) * sizeof(int));
+
+	for (int it = 0; it < wget_vector_size(v); it++) {
+		const char *pattern = wget_vector_get(v, it);
+
+		if (strpbrk(pattern, "*?[]")) {
+			wget_vector_add_noalloc(f->wildcards, pattern);
+		} else {
+			int len = (int) strlen(pattern), lt;
+
+			wget_stringmap_put_noalloc(f->literals, pattern, NULL);
+			for (lt = 0; lt < f->nlens && f->literal_lens[lt] != len; lt++)
+				;
+			if (lt == f->nlens)
+				f->literal_lens[f->nlens++] = len;
+		}
+	}
+
+	debug_printf("compiled pattern list: %d literal lengths, %d wildcards\n",
+		f->nlens, wget_vector_size(f->wildcards));
+
+	f->src = v; // publish
+
+	wget_thread_mutex_unlock(&pattern_filter_mutex);
+
+	return f;
+}
+
 static int in_pattern_list(const wget_vector_t *v, const char *url)
 {
+	pattern_filter_t *f = get_pattern_filter(v);
+
+	if (f) {
+		size_t url_len = strlen(url);
+
+		// one hash probe per distinct literal pattern length
+		for (int it = 0; it < f->nlens; it++) {
+			int len = f->literal_lens[it];
+
+			if ((size_t) len <= url_len && wget_stringmap_contains(f->literals, url + url_len - len))
+				return 1;
+		}
+
+		for (int it = 0; it < wget_vector_size(f->wildcards); it++) {
+			const char *pattern = wget_vector_get(f->wildcards, it);
+
+			if (!fnmatch(pattern, url, config.ignore_case ? FNM_CASEFOLD : 0))
+				return 1;
+		}
+
+		return 0;
+	}
+
 	for (int it = 0; it < wget_vector_size(v); it++) {
 		const char *pattern = wget_vector_get(v, it);
 
@@ -479,21 +782,158 @@ static int regex_match_pcre(const char *string, const char *pattern)
 }
 #endif
 
+// --accept-regex/--reject-regex are fixed strings after startup, but were
+// recompiled for every single URL. Cache the compiled form per pattern;
+// the compiled objects are safe for concurrent matching (a PCRE2 match
+// data block is not, so that one stays per call).
+typedef struct {
+	const char *pattern; // the config string - stable, compared by pointer
+	regex_t posix_re;
+#ifdef WITH_LIBPCRE2
+	pcre2_code *pcre_re;
+#elif defined WITH_LIBPCRE
+	pcre *pcre_re;
+	pcre_extra *pcre_study;
+#endif
+	char failed; // pattern did not compile - never matches, as before
+} compiled_regex_t;
+
+static compiled_regex_t compiled_regexes[2]; // --accept-regex and --reject-regex
+static wget_thread_mutex_t regex_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
 static int regex_match(const char *string, const char *pattern)
 {
+	compiled_regex_t *cre = NULL;
+
+	// fast path without taking the lock - pattern is published last
+	for (unsigned it = 0; it < countof(compiled_regexes) && !cre; it++)
+		if (compiled_regexes[it].pattern == pattern)
+			cre = &compiled_regexes[it];
+
+	if (!cre) {
+		compiled_regex_t *free_slot = NULL;
+
+		wget_thread_mutex_lock(&regex_mutex);
+
+		for (unsigned it = 0; it < countof(compiled_regexes); it++) {
+			if (compiled_regexes[it].pattern == pattern) {
+				cre = &compiled_regexes[it];
+				break;
+			}
+			if (!compiled_regexes[it].pattern && !free_slot)
+				free_slot = &compiled_regexes[it];
+		}
+
+		if (!cre && free_slot) {
+			cre = free_slot;
+
 #if defined WITH_LIBPCRE2 || defined WITH_LIBPCRE
-	if (config.regex_type == WGET_REGEX_TYPE_PCRE)
-		return regex_match_pcre(string, pattern);
-	else
+			if (config.regex_type == WGET_REGEX_TYPE_PCRE) {
+#ifdef WITH_LIBPCRE2
+				int errornumber;
+				PCRE2_SIZE erroroffset;
+
+				if (!(cre->pcre_re = pcre2_compile((PCRE2_SPTR) pattern, PCRE2_ZERO_TERMINATED, 0, &errornumber, &erroroffset, NULL)))
+					cre->failed = 1;
+#else
+				const char *error_msg;
+				int error;
+
+				if ((cre->pcre_re = pcre_compile(pattern, 0, &error_msg, &error, NULL))) {
+					error_msg = NULL;
+					cre->pcre_study = pcre_study(cre->pcre_re, 0, &error_msg);
+					if (error_msg) {
+						pcre_free(cre->pcre_re);
+						cre->pcre_re = NULL;
+						cre->failed = 1;
+					}
+				} else
+					cre->failed = 1;
+#endif
+			} else
+#endif
+			if (regcomp(&cre->posix_re, pattern, REG_EXTENDED|REG_NOSUB) != 0)
+				cre->failed = 1;
+
+			cre->pattern = pattern; // publish
+		}
+
+		wget_thread_mutex_unlock(&regex_mutex);
+	}
+
+	if (!cre) {
+		// more distinct patterns than cache slots - match uncached
+#if defined WITH_LIBPCRE2 || defined WITH_LIBPCRE
+		if (config.regex_type == WGET_REGEX_TYPE_PCRE)
+			return regex_match_pcre(string, pattern);
+#endif
 		return regex_match_posix(string, pattern);
+	}
+
+	if (cre->failed)
+		return 0;
+
+#if defined WITH_LIBPCRE2 || defined WITH_LIBPCRE
+	if (config.regex_type == WGET_REGEX_TYPE_PCRE) {
+#ifdef WITH_LIBPCRE2
+		pcre2_match_data *match_data = pcre2_match_data_create_from_pattern(cre->pcre_re, NULL);
+		int rc = pcre2_match(cre->pcre_re, (PCRE2_SPTR) string, strlen(string), 0, 0, match_data, NULL);
+
+		pcre2_match_data_free(match_data);
+		return rc >= 0;
 #else
-	return regex_match_posix(string, pattern);
+		int offsets[8];
+
+		return pcre_exec(cre->pcre_re, cre->pcre_study, string, (int) strlen(string), 0, 0, offsets, 8) >= 0;
+#endif
+	}
 #endif
+
+	return regexec(&cre->posix_re, string, (size_t) 0, NULL, 0) == 0;
 }
 
-// Add URLs given by user (command line, file or -i option).
-// Needs to be thread-save.
-static void add_url_to_queue(const char *url, wget_iri_t *base, const char *encoding)
+// Add a single URL given by user (command line, file or -i option).
+// downloader_mutex must be held by the caller.
+// consult the capability cache: a host that is known to lack byte-range
+// support gets no HEAD probe for chunking, the GET goes out right away
+static bool host_may_support_ranges(const wget_iri_t *iri)
+{
+	char accept_ranges;
+
+	if (!config.caps_db)
+		return true;
+
+	config_load_db(CONFIG_DB_CAPS);
+
+	if (wget_caps_db_get(config.caps_db, iri->host, iri->port, NULL, &accept_ranges, NULL))
+		return accept_ranges != 0;
+
+	return true;
+}
+
+// --fresh-for: a URL whose validators were stored less than the given
+// number of seconds ago, and whose local file still exists, is treated
+// as unchanged and not requested at all. Policy-expired entries still
+// get a conditional request from the validator cache as usual.
+static bool is_still_fresh(const wget_iri_t *iri, const char *local_filename)
+{
+	int64_t created;
+
+	if (!config.fresh_for || !config.etags || !local_filename)
+		return false;
+
+	config_load_db(CONFIG_DB_ETAGS);
+
+	if (!(created = wget_etag_db_created(config.etag_db, iri->uri)))
+		return false;
+
+	if (created + config.fresh_for <= time(NULL))
+		return false;
+
+	return get_file_mtime(local_filename) != 0;
+}
+
+static void add_url_to_queue_impl(const char *url, wget_iri_t *base, const char *encoding)
 {
 	wget_iri_t *iri;
 	JOB *new_job = NULL, job_buf;
@@ -527,19 +967,35 @@ static void add_url_to_queue(const char *url, wget_iri_t *base, const char *enco
 		return;
 	}
 
-	wget_thread_mutex_lock(&downloader_mutex);
+	// mirrored within the revisit interval on an earlier run - not enqueued
+	if (visited_test(iri->uri)) {
+		debug_printf("visited '%s' - not requested\n", iri->uri);
+		wget_iri_free(&iri);
+		plugin_db_forward_url_verdict_free(&plugin_verdict);
+		return;
+	}
 
 	if (!blacklist_add(iri)) {
 		// we know this URL already
-		wget_thread_mutex_unlock(&downloader_mutex);
 		plugin_db_forward_url_verdict_free(&plugin_verdict);
 		return;
 	}
 
+	// sharded crawl: every process gets the full seed list, seeds owned by
+	// another shard are handed over like any discovered URL
+	if (config.shard_count > 1 && iri->host && !shard_local_host(iri->host)) {
+		if (shard_forward(iri->host, iri->uri) == 0) {
+			blacklist_release(&iri);
+			plugin_db_forward_url_verdict_free(&plugin_verdict);
+			return;
+		}
+		// the owner is unreachable - crawl the URL here rather than losing it
+	}
+
 	// only download content from hosts given on the command line or from input file
 	if (wget_vector_contains(config.exclude_domains, iri->host)) {
 		// download from this scheme://domain are explicitly not wanted
-		wget_thread_mutex_unlock(&downloader_mutex);
+		blacklist_release(&iri);
 		plugin_db_forward_url_verdict_free(&plugin_verdict);
 		return;
 	}
@@ -585,6 +1041,14 @@ static void add_url_to_queue(const char *url, wget_iri_t *base, const char *enco
 		new_job->local_filename = get_local_filename(iri);
 	}
 
+	// recently validated and still on disk - nothing to ask the server
+	if (is_still_fresh(iri, new_job->local_filename)) {
+		debug_printf("fresh '%s' - not requested\n", iri->uri);
+		wget_refstr_unref(&new_job->local_filename);
+		plugin_db_forward_url_verdict_free(&plugin_verdict);
+		return;
+	}
+
 	if (plugin_verdict.accept) {
 		new_job->ignore_patterns = 1;
 	} else if (config.recursive) {
@@ -600,7 +1064,7 @@ static void add_url_to_queue(const char *url, wget_iri_t *base, const char *enco
 	if (config.recursive)
 		new_job->requested_by_user = 1; // download even if disallowed by robots.txt
 
-	if (config.spider || config.chunk_size)
+	if (config.spider || (config.chunk_size && host_may_support_ranges(new_job->iri)))
 		new_job->head_first = 1;
 
 	if (config.auth_no_challenge) {
@@ -610,9 +1074,107 @@ static void add_url_to_queue(const char *url, wget_iri_t *base, const char *enco
 
 	host_add_job(host, new_job);
 
+	plugin_db_forward_url_verdict_free(&plugin_verdict);
+}
+
+// Add URLs given by user (command line, file or -i option).
+// Needs to be thread-save.
+static void add_url_to_queue(const char *url, wget_iri_t *base, const char *encoding)
+{
+	wget_thread_mutex_lock(&downloader_mutex);
+	add_url_to_queue_impl(url, base, encoding);
 	wget_thread_mutex_unlock(&downloader_mutex);
+}
 
-	plugin_db_forward_url_verdict_free(&plugin_verdict);
+// receiver-thread callback: a peer shard handed us a URL whose host we own.
+// The URL is absolute and UTF-8 encoded (it came from a parsed IRI).
+static void shard_enqueue(const char *url)
+{
+	add_url_to_queue(url, config.base, "utf-8");
+}
+
+// re-queue a pending URL read from a resumed snapshot (see src/snapshot.c)
+void queue_url_from_snapshot(const char *url)
+{
+	add_url_to_queue(url, config.base, "utf-8");
+}
+
+// Bulk reader for URL lists given with --input-file.
+// The whole file is mapped (or read) at once and scanned for newlines in
+// memory, which is much faster on multi-million line seed lists than the
+// read(2)-per-line loop used for STDIN. URLs are enqueued in batches of
+// INPUT_URL_BATCH under one downloader_mutex acquisition.
+#define INPUT_URL_BATCH 256
+
+static void queue_urls_from_file(const char *fname, const char *encoding)
+{
+	const char *data = NULL, *p, *end, *eol;
+	size_t size = 0;
+	char linebuf[2048], *line, *filedata = NULL;
+	int batch;
+#ifdef HAVE_MMAP
+	void *map = MAP_FAILED;
+	struct stat st;
+	int fd;
+
+	if ((fd = open(fname, O_RDONLY|O_BINARY)) != -1) {
+		if (fstat(fd, &st) == 0 && st.st_size > 0
+			&& (map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+		{
+			data = map;
+			size = st.st_size;
+		}
+		close(fd);
+	}
+#endif
+
+	if (!data) {
+		if (!(filedata = wget_read_file(fname, &size))) {
+			error_printf(_("Failed to open input file %s\n"), fname);
+			return;
+		}
+		data = filedata;
+	}
+
+	for (p = data, end = data + size; p < end; ) {
+		wget_thread_mutex_lock(&downloader_mutex);
+
+		for (batch = 0; batch < INPUT_URL_BATCH && p < end; p = eol + 1) {
+			size_t len;
+
+			if (!(eol = memchr(p, '\n', end - p)))
+				eol = end; // last line misses the newline
+
+			// skip leading and trailing spaces, empty lines and comments
+			while (p < eol && isspace(*p)) p++;
+			len = eol - p;
+			while (len && isspace(p[len - 1])) len--;
+			if (!len || *p == '#')
+				continue;
+
+			if (len < sizeof(linebuf))
+				line = linebuf;
+			else
+				line = wget_malloc(len + 1);
+
+			memcpy(line, p, len);
+			line[len] = 0;
+
+			add_url_to_queue_impl(line, config.base, encoding);
+			batch++;
+
+			if (line != linebuf)
+				xfree(line);
+		}
+
+		wget_thread_mutex_unlock(&downloader_mutex);
+	}
+
+#ifdef HAVE_MMAP
+	if (map != MAP_FAILED)
+		munmap(map, size);
+#endif
+	xfree(filedata);
 }
 
 static wget_thread_mutex_t
@@ -626,9 +1188,76 @@ static wget_thread_t
 static void
 	*input_thread(void *p);
 
-// Add URLs parsed from downloaded files
-// Needs to be thread-save
-static void add_url(JOB *job, const char *encoding, const char *url, int flags)
+// Dedicated parse workers: downloader threads hand completed bodies over
+// instead of extracting the links themselves, so parsing big documents
+// doesn't stall network work. See parse_pool_submit() / parse_thread().
+typedef struct PARSE_TASK {
+	struct PARSE_TASK
+		*next;
+	wget_buffer_t
+		*body; // response body, taken over from the response
+	wget_html_parsed_result_t
+		*parsed_html; // result of the streaming parser, if any
+	wget_iri_t
+		*iri; // owned by the blacklist, outlives the job
+	const char
+		*local_filename; // refcounted, see get_local_filename()
+	char
+		*content_type,
+		*encoding; // charset from the Content-Type header, NULL if not given
+	int
+		level;
+	bool
+		sitemap : 1;
+} PARSE_TASK;
+
+static PARSE_TASK
+	*parse_queue_head,
+	*parse_queue_tail;
+static wget_thread_t
+	*parse_tids;
+static int
+	parse_nthreads,
+	parse_pending; // tasks queued or currently being parsed
+static wget_thread_mutex_t
+	parse_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+static wget_thread_cond_t
+	parse_cond = WGET_THREAD_COND_INITIALIZER; // is signalled whenever a body is handed over
+static void
+	parse_pool_stop(void);
+static void
+	parse_cache_free(void);
+static void
+	feed_cursors_free(void);
+
+// serve-thread callback: a daemon client handed us a URL to fetch.
+// A NULL url only wakes the main loop, e.g. after a QUIT command.
+static void daemon_enqueue(const char *url)
+{
+	if (url)
+		add_url_to_queue(url, config.base, config.local_encoding);
+
+	// the main loop may be in an unbounded condition wait and nothing else
+	// is going to wake it up - signal under main_mutex so the wakeup can't
+	// fall between its queue check and the wait
+	wget_thread_mutex_lock(&main_mutex);
+	wget_thread_cond_signal(&main_cond);
+	wget_thread_mutex_unlock(&main_mutex);
+}
+
+// serve-thread callback: a WAIT command polls this until all queued work
+// has finished; an unlocked read of parse_pending only risks one more
+// poll round
+static bool daemon_idle(void)
+{
+	return queue_empty() && !parse_pending && !frontier_pending();
+}
+
+// Add a URL parsed from a downloaded file.
+// Must be called with downloader_mutex held, see add_url() / the batch loops in the
+// parsers, which take the mutex once for a whole batch of URLs.
+// Returns 1 if a job has been enqueued (the caller wakes up one worker per new job), else 0.
+static int add_url_impl(JOB *job, const char *encoding, const char *url, int flags)
 {
 	JOB *new_job = NULL, job_buf;
 	wget_iri_t *iri;
@@ -637,7 +1266,7 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 
 	if (flags & URL_FLG_REDIRECTION) { // redirect
 		if (config.max_redirect && job && job->redirection_level >= config.max_redirect) {
-			return;
+			return 0;
 		}
 	} else {
 //		if (config.recursive) {
@@ -647,6 +1276,16 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 //		}
 	}
 
+	// bounded frontier: with the queue at the cap, park the URL in the disk
+	// spool instead of creating a job; main() re-injects it on queue drain.
+	// Redirects stay in memory, their origin job is already accounted for.
+	if (config.frontier_cap && !(flags & URL_FLG_REQUEUED) && !(flags & URL_FLG_REDIRECTION)
+		&& queue_size() >= config.frontier_cap)
+	{
+		frontier_spill(url, encoding, flags, job ? job->level + 1 : 0);
+		return 0;
+	}
+
 	const char *p = NULL;
 
 	if (config.cut_url_get_vars)
@@ -662,7 +1301,7 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 
 	if (!iri) {
 		error_printf(_("Cannot resolve URI '%s'\n"), url);
-		return;
+		return 0;
 	}
 
 	// Allow plugins to intercept URL
@@ -671,7 +1310,7 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 	if (plugin_verdict.reject) {
 		plugin_db_forward_url_verdict_free(&plugin_verdict);
 		wget_iri_free(&iri);
-		return;
+		return 0;
 	}
 
 	if (plugin_verdict.alt_iri) {
@@ -684,23 +1323,41 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 		info_printf(_("URL '%s' not followed (unsupported scheme '%s')\n"), url, iri->scheme);
 		wget_iri_free(&iri);
 		plugin_db_forward_url_verdict_free(&plugin_verdict);
-		return;
+		return 0;
 	}
 
 	if (config.https_only && iri->scheme != WGET_IRI_SCHEME_HTTPS) {
 		info_printf(_("URL '%s' not followed (https-only requested)\n"), url);
 		wget_iri_free(&iri);
 		plugin_db_forward_url_verdict_free(&plugin_verdict);
-		return;
+		return 0;
 	}
 
-	wget_thread_mutex_lock(&downloader_mutex);
+	// mirrored within the revisit interval on an earlier run - not followed
+	if (visited_test(iri->uri)) {
+		debug_printf("visited '%s' - not followed\n", iri->uri);
+		wget_iri_free(&iri);
+		plugin_db_forward_url_verdict_free(&plugin_verdict);
+		return 0;
+	}
 
 	if (!blacklist_add(iri)) {
 		// we know this URL already
-		wget_thread_mutex_unlock(&downloader_mutex);
 		plugin_db_forward_url_verdict_free(&plugin_verdict);
-		return;
+		return 0;
+	}
+
+	// sharded crawl: URLs whose host belongs to another process are handed
+	// over instead of crawled. The blacklist entry just created keeps this
+	// process from forwarding the same URL twice, the owner dedups against
+	// its own blacklist - so cross-host dedup stays correct per shard.
+	if (config.shard_count > 1 && iri->host && !shard_local_host(iri->host)) {
+		if (shard_forward(iri->host, iri->uri) == 0) {
+			blacklist_release(&iri);
+			plugin_db_forward_url_verdict_free(&plugin_verdict);
+			return 0;
+		}
+		// the owner is unreachable - crawl the URL here rather than losing it
 	}
 
 	if (config.recursive) {
@@ -715,10 +1372,10 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 			reason = _("domain explicitly excluded");
 
 		if (reason) {
-			wget_thread_mutex_unlock(&downloader_mutex);
-			info_printf(_("URL '%s' not followed (%s)\n"), iri->uri, reason);
+				info_printf(_("URL '%s' not followed (%s)\n"), iri->uri, reason);
+			blacklist_release(&iri);
 			plugin_db_forward_url_verdict_free(&plugin_verdict);
-			return;
+			return 0;
 		}
 	}
 
@@ -740,10 +1397,10 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 		}
 
 		if (!ok) {
-			wget_thread_mutex_unlock(&downloader_mutex);
-			info_printf(_("URL '%s' not followed (parent ascending not allowed)\n"), url);
+				info_printf(_("URL '%s' not followed (parent ascending not allowed)\n"), url);
+			blacklist_release(&iri);
 			plugin_db_forward_url_verdict_free(&plugin_verdict);
-			return;
+			return 0;
 		}
 	}
 
@@ -759,43 +1416,43 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 	} else if ((host = host_get(iri))) {
 		if (host->robots && iri->path) {
 			// info_printf("%s: checking '%s' / '%s'\n", __func__, iri->path, iri->uri);
-			for (int it = 0; it < wget_vector_size(host->robots->paths); it++) {
-				wget_string_t *path = wget_vector_get(host->robots->paths, it);
-				// info_printf("%s: checked robot path '%.*s' / '%s' / '%s'\n", __func__, (int)path->len, path->path, iri->path, iri->uri);
-				if (path->len && !strncmp(path->p + 1, iri->path ? iri->path : "", path->len - 1)) {
-					wget_thread_mutex_unlock(&downloader_mutex);
-					info_printf(_("URL '%s' not followed (disallowed by robots.txt)\n"), iri->uri);
-					plugin_db_forward_url_verdict_free(&plugin_verdict);
-					return;
-				}
+			if (host_robots_disallowed(host, iri->path)) {
+							info_printf(_("URL '%s' not followed (disallowed by robots.txt)\n"), iri->uri);
+				blacklist_release(&iri);
+				plugin_db_forward_url_verdict_free(&plugin_verdict);
+				return 0;
 			}
 		}
 	} else {
 		// this should really not ever happen
-		wget_thread_mutex_unlock(&downloader_mutex);
 		error_printf(_("Failed to get '%s' from hosts\n"), iri->host);
+		blacklist_release(&iri);
 		plugin_db_forward_url_verdict_free(&plugin_verdict);
-		return;
+		return 0;
 	}
 
+	// no blacklist_release() from here on: host_add() may have captured iri->host into a new host entry
 	if (config.recursive && config.filter_urls) {
 		if ((config.accept_patterns && !in_pattern_list(config.accept_patterns, iri->uri))
 				|| (config.accept_regex && !regex_match(iri->uri, config.accept_regex))) {
 
 			debug_printf("not requesting '%s' (doesn't match accept pattern)\n", iri->uri);
-			wget_thread_mutex_unlock(&downloader_mutex);
-			return;
+				return 0;
 		}
 
 		if ((config.reject_patterns && in_pattern_list(config.reject_patterns, iri->uri))
 				|| (config.reject_regex && regex_match(iri->uri, config.reject_regex))) {
 
 			debug_printf("not requesting '%s' (matches reject pattern)\n", iri->uri);
-			wget_thread_mutex_unlock(&downloader_mutex);
-			return;
+				return 0;
 		}
 	}
 
+	// the URL passed all filters - overlap the host's first handshake
+	// with the downloads currently in flight
+	if (config.preconnect && !(flags & URL_FLG_REDIRECTION))
+		conn_pool_preconnect(iri);
+
 	new_job = job_init(&job_buf, iri);
 
 	if (!config.output_document) {
@@ -805,10 +1462,18 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 		} else if (!(flags & URL_FLG_REDIRECTION) || config.trust_server_names || !job) {
 			new_job->local_filename = get_local_filename(new_job->iri);
 		} else {
-			new_job->local_filename = wget_strdup(job->local_filename);
+			new_job->local_filename = wget_refstr_ref(job->local_filename);
 		}
 	}
 
+	// recently validated and still on disk - nothing to ask the server
+	if (is_still_fresh(new_job->iri, new_job->local_filename)) {
+		debug_printf("fresh '%s' - not requested\n", new_job->iri->uri);
+		wget_refstr_unref(&new_job->local_filename);
+		plugin_db_forward_url_verdict_free(&plugin_verdict);
+		return 0;
+	}
+
 	if (job) {
 		if (flags & URL_FLG_REDIRECTION) {
 			new_job->redirection_level = job->redirection_level + 1;
@@ -832,7 +1497,7 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 			new_job->head_first = 1; // enable mime-type check to assure e.g. text/html to be downloaded and parsed
 	}
 
-	if (config.spider || config.chunk_size)
+	if (config.spider || (config.chunk_size && host_may_support_ranges(new_job->iri)))
 		new_job->head_first = 1;
 
 	if (config.auth_no_challenge)
@@ -842,121 +1507,262 @@ static void add_url(JOB *job, const char *encoding, const char *url, int flags)
 	if (flags & URL_FLG_SITEMAP)
 		new_job->sitemap = 1;
 
+	// schedule metadata and inline resources before bulk bodies (see JOB_PRIORITY_*)
+	if (flags & (URL_FLG_SITEMAP | URL_FLG_METALINK))
+		new_job->priority = JOB_PRIORITY_METADATA;
+	else if (flags & URL_FLG_REQUISITE)
+		new_job->priority = JOB_PRIORITY_INLINE;
+	else if ((flags & URL_FLG_REDIRECTION) && job)
+		new_job->priority = job->priority; // a redirect stays in its origin's class
+
 	// now add the new job to the queue (thread-safe))
 	host_add_job(host, new_job);
 
-	// and wake up all waiting threads
-	wget_thread_cond_signal(&worker_cond);
+	plugin_db_forward_url_verdict_free(&plugin_verdict);
+
+	return 1;
+}
+
+// Add a single URL parsed from a downloaded file.
+// Needs to be thread-save.
+static void add_url(JOB *job, const char *encoding, const char *url, int flags)
+{
+	wget_thread_mutex_lock(&downloader_mutex);
+
+	if (add_url_impl(job, encoding, url, flags)) {
+		// wake up one of the waiting downloader threads
+		wget_thread_cond_signal_n(&worker_cond, 1);
+	}
 
 	wget_thread_mutex_unlock(&downloader_mutex);
-	plugin_db_forward_url_verdict_free(&plugin_verdict);
 }
 
-static void _convert_links(void)
+// Pop spilled URLs from the disk frontier back into the job queue; called by
+// main() once the in-memory queue has drained below the cap.
+static void frontier_requeue(int max)
+{
+	char *url, *encoding;
+	int flags, level, enqueued = 0;
+
+	wget_thread_mutex_lock(&downloader_mutex);
+
+	while (max > 0 && frontier_pop(&url, &encoding, &flags, &level)) {
+		// a dummy parent job carries the already incremented discovery level
+		JOB parent = { .level = level > 0 ? level - 1 : 0 };
+
+		enqueued += add_url_impl(level > 0 ? &parent : NULL, encoding, url, flags | URL_FLG_REQUEUED);
+		xfree(url);
+		xfree(encoding);
+		max--;
+	}
+
+	// wake one waiting downloader thread per new job
+	wget_thread_cond_signal_n(&worker_cond, enqueued);
+
+	wget_thread_mutex_unlock(&downloader_mutex);
+}
+
+// convert the links of one document, rewriting them to relative paths where
+// the target was downloaded. Only touches this document's file plus per-call
+// state, so any number of documents can be converted concurrently.
+static void convert_links_file(_conversion_t *conversion, wget_buffer_t *buf)
 {
 	FILE *fpout = NULL;
-	wget_buffer_t buf;
-	char sbuf[1024];
+	const char *data = NULL, *data_ptr;
+	char *filedata = NULL;
+	size_t data_length = 0;
 
-	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
+	wget_info_printf("convert %s %s %s\n", conversion->filename, conversion->base_url->uri, conversion->encoding);
 
-	// cycle through all documents where links have been found
-	for (int it = 0; it < wget_vector_size(conversions); it++) {
-		_conversion_t *conversion = wget_vector_get(conversions, it);
-		const char *data, *data_ptr;
-		size_t data_length;
+	// the body cache may still hold these bytes, saving the disk read
+	if ((filedata = body_cache_get(conversion->filename, &data_length)))
+		data = filedata;
 
-		wget_info_printf("convert %s %s %s\n", conversion->filename, conversion->base_url->uri, conversion->encoding);
+	// map the document instead of copying it - we just wrote these bytes and
+	// the parsed URL offsets from download time tell us where to patch
+#ifdef HAVE_MMAP
+	void *map = MAP_FAILED;
+	struct stat st;
+	int fd;
 
-		if (!(data = data_ptr = wget_read_file(conversion->filename, &data_length))) {
-			wget_error_printf(_("%s not found (%d)\n"), conversion->filename, errno);
-			continue;
+	if (!data && (fd = open(conversion->filename, O_RDONLY|O_BINARY)) != -1) {
+		if (fstat(fd, &st) == 0 && st.st_size > 0
+			&& (map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+		{
+			data = map;
+			data_length = st.st_size;
 		}
+		close(fd);
+	}
+#endif
 
-		// cycle through all links found in the document
-		for (int it2 = 0; it2 < wget_vector_size(conversion->parsed->uris); it2++) {
-			wget_html_parsed_url_t *html_url = wget_vector_get(conversion->parsed->uris, it2);
-			wget_string_t *url = &html_url->url;
+	if (!data) {
+		if (!(filedata = wget_read_file(conversion->filename, &data_length))) {
+			wget_error_printf(_("%s not found (%d)\n"), conversion->filename, errno);
+			return;
+		}
+		data = filedata;
+	}
+	data_ptr = data;
 
-			url->p = (size_t) url->p + data; // convert offset to pointer
+	// cycle through all links found in the document
+	for (int it2 = 0; it2 < wget_vector_size(conversion->parsed->uris); it2++) {
+		wget_html_parsed_url_t *html_url = wget_vector_get(conversion->parsed->uris, it2);
+		wget_string_t *url = &html_url->url;
 
-			if (url->len >= 1 && *url->p == '#') // ignore e.g. href='#'
-				continue;
+		url->p = (size_t) url->p + data; // convert offset to pointer
 
-			if (wget_iri_relative_to_abs(conversion->base_url, url->p, url->len, &buf)) {
-				// buf.data now holds the absolute URL as a string
-				wget_iri_t *iri = wget_iri_parse(buf.data, conversion->encoding);
+		if (url->len >= 1 && *url->p == '#') // ignore e.g. href='#'
+			continue;
 
-				if (!iri) {
-					wget_error_printf(_("Cannot resolve URI '%s'\n"), buf.data);
-					continue;
-				}
+		if (wget_iri_relative_to_abs(conversion->base_url, url->p, url->len, buf)) {
+			// buf->data now holds the absolute URL as a string
+			wget_iri_t *iri = wget_iri_parse(buf->data, conversion->encoding);
 
-				const char *filename = get_local_filename(iri);
+			if (!iri) {
+				wget_error_printf(_("Cannot resolve URI '%s'\n"), buf->data);
+				continue;
+			}
 
-				if (access(filename, W_OK) == 0) {
-					const char *linkpath = filename, *dir = NULL, *p1, *p2;
-					const char *docpath = conversion->filename;
+			const char *filename = get_local_filename(iri);
 
-					// e.g.
-					// docpath  'hostname/1level/2level/3level/xyz.html'
-					// linkpath 'hostname/1level/2level.bak/3level/xyz.html'
-					// expected result: '../../2level.bak/3level/xyz.html'
+			if (access(filename, W_OK) == 0) {
+				const char *linkpath = filename, *dir = NULL, *p1, *p2;
+				const char *docpath = conversion->filename;
 
-					// find first difference in path
-					for (dir = p1 = linkpath, p2 = docpath; *p1 && *p1 == *p2; p1++, p2++)
-						if (*p1 == '/') dir = p1+1;
+				// e.g.
+				// docpath  'hostname/1level/2level/3level/xyz.html'
+				// linkpath 'hostname/1level/2level.bak/3level/xyz.html'
+				// expected result: '../../2level.bak/3level/xyz.html'
 
-					// generate relative path
-					wget_buffer_reset(&buf); // reuse buffer
-					while (*p2) {
-						if (*p2++ == '/')
-							wget_buffer_memcat(&buf, "../", 3);
-					}
-					wget_buffer_strcat(&buf, dir);
+				// find first difference in path
+				for (dir = p1 = linkpath, p2 = docpath; *p1 && *p1 == *p2; p1++, p2++)
+					if (*p1 == '/') dir = p1+1;
 
-					wget_info_printf("  %.*s -> %s\n", (int) url->len,  url->p, linkpath);
-					wget_info_printf("       -> %s\n", buf.data);
-				} else {
-					// insert absolute URL
-					wget_info_printf("  %.*s -> %s\n", (int) url->len,  url->p, buf.data);
+				// generate relative path
+				wget_buffer_reset(buf); // reuse buffer
+				while (*p2) {
+					if (*p2++ == '/')
+						wget_buffer_memcat(buf, "../", 3);
 				}
+				wget_buffer_strcat(buf, dir);
 
-				if (buf.length != url->len || strncmp(buf.data, url->p, url->len)) {
-					// conversion takes place, write to disk
-					if (!fpout) {
-						if (config.backup_converted) {
-							char dstfile[strlen(conversion->filename) + 5 + 1];
+				wget_info_printf("  %.*s -> %s\n", (int) url->len,  url->p, linkpath);
+				wget_info_printf("       -> %s\n", buf->data);
+			} else {
+				// insert absolute URL
+				wget_info_printf("  %.*s -> %s\n", (int) url->len,  url->p, buf->data);
+			}
 
-							snprintf(dstfile, sizeof(dstfile), "%s.orig", conversion->filename);
+			if (buf->length != url->len || strncmp(buf->data, url->p, url->len)) {
+				// conversion takes place, write to disk
+				if (!fpout) {
+					if (config.backup_converted) {
+						char dstfile[strlen(conversion->filename) + 5 + 1];
 
-							if (rename(conversion->filename, dstfile) == -1) {
-								wget_error_printf(_("Failed to rename %s to %s (%d)"), conversion->filename, dstfile, errno);
-							}
+						snprintf(dstfile, sizeof(dstfile), "%s.orig", conversion->filename);
+
+						if (rename(conversion->filename, dstfile) == -1) {
+							wget_error_printf(_("Failed to rename %s to %s (%d)"), conversion->filename, dstfile, errno);
 						}
-						if (!(fpout = fopen(conversion->filename, "wb")))
-							wget_error_printf(_("Failed to write open %s (%d)"), conversion->filename, errno);
-					}
-					if (fpout) {
-						fwrite(data_ptr, 1, url->p - data_ptr, fpout);
-						fwrite(buf.data, 1, buf.length, fpout);
-						data_ptr = url->p + url->len;
 					}
+#ifdef HAVE_MMAP
+					else if (map != MAP_FAILED)
+						unlink(conversion->filename); // fopen("wb") would truncate the bytes we are still reading from the map
+#endif
+					if (!(fpout = fopen(conversion->filename, "wb")))
+						wget_error_printf(_("Failed to write open %s (%d)"), conversion->filename, errno);
+				}
+				if (fpout) {
+					fwrite(data_ptr, 1, url->p - data_ptr, fpout);
+					fwrite(buf->data, 1, buf->length, fpout);
+					data_ptr = url->p + url->len;
 				}
-				xfree(filename);
-				wget_iri_free(&iri);
 			}
+			wget_refstr_unref(&filename);
+			wget_iri_free(&iri);
 		}
+	}
+
+	if (fpout) {
+		fwrite(data_ptr, 1, (data + data_length) - data_ptr, fpout);
+		fclose(fpout);
+	}
+
+#ifdef HAVE_MMAP
+	if (map != MAP_FAILED)
+		munmap(map, data_length);
+#endif
+	xfree(filedata);
+}
 
-		if (fpout) {
-			fwrite(data_ptr, 1, (data + data_length) - data_ptr, fpout);
-			fclose(fpout);
-			fpout = NULL;
+static wget_thread_mutex_t
+	convert_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+static int
+	convert_next; // next unconverted index into 'conversions'
+
+static void *convert_thread(void *ctx G_GNUC_WGET_UNUSED)
+{
+	wget_buffer_t buf;
+	char sbuf[1024];
+
+	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
+
+	for (;;) {
+		_conversion_t *conversion;
+
+		wget_thread_mutex_lock(&convert_mutex);
+		if (convert_next >= wget_vector_size(conversions)) {
+			wget_thread_mutex_unlock(&convert_mutex);
+			break;
 		}
+		conversion = wget_vector_get(conversions, convert_next++);
+		wget_thread_mutex_unlock(&convert_mutex);
 
-		xfree(data);
+		convert_links_file(conversion, &buf);
+	}
+
+	wget_buffer_deinit(&buf);
+
+	return NULL;
+}
+
+// convert the documents in parallel - each entry only reads and rewrites its
+// own file, so the pass scales with the number of threads. Deciding between
+// a relative path and an absolute URL needs the final on-disk state of every
+// link target, which is why the pass starts after the crawl, not during it.
+static void _convert_links(void)
+{
+	int nthreads = wget_vector_size(conversions);
+
+	if (nthreads > config.max_threads)
+		nthreads = config.max_threads;
+
+	if (nthreads > 1 && wget_thread_support()) {
+		wget_thread_t tids[nthreads];
+		int started = 0;
+
+		for (int it = 0; it < nthreads; it++) {
+			if (wget_thread_start(&tids[started], convert_thread, NULL, 0) == 0)
+				started++;
+		}
+
+		if (started) {
+			for (int it = 0; it < started; it++)
+				wget_thread_join(tids[it]);
+			return;
+		}
+		// fall through to the sequential pass if no thread could be started
 	}
 
+	wget_buffer_t buf;
+	char sbuf[1024];
+
+	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
+
+	for (int it = 0; it < wget_vector_size(conversions); it++)
+		convert_links_file(wget_vector_get(conversions, it), &buf);
+
 	wget_buffer_deinit(&buf);
 }
 
@@ -972,6 +1778,107 @@ static void print_status(DOWNLOADER *downloader G_GNUC_WGET_UNUSED, const char *
 	}
 }
 
+// TLS pre-warming: handshake-only connections to the queued HTTPS hosts at
+// low concurrency, refreshing session tickets and the OCSP/cert caches
+// before the crawl's connection burst hits cold state.
+struct tls_prewarm_context {
+	wget_vector_t
+		*hosts; // HOST * entries, owned by host.c
+	wget_thread_mutex_t
+		mutex;
+	int
+		next;
+};
+
+static void *tls_prewarm_thread(void *p)
+{
+	struct tls_prewarm_context *ctx = p;
+
+	for (;;) {
+		HOST **hostp;
+		wget_tcp_t *tcp;
+
+		wget_thread_mutex_lock(&ctx->mutex);
+		hostp = wget_vector_get(ctx->hosts, ctx->next++);
+		wget_thread_mutex_unlock(&ctx->mutex);
+
+		if (!hostp)
+			break;
+
+		tcp = wget_tcp_init();
+		wget_tcp_set_timeout(tcp, config.read_timeout);
+		wget_tcp_set_connect_timeout(tcp, config.connect_timeout);
+		wget_tcp_set_ssl(tcp, 1);
+		wget_tcp_set_ssl_hostname(tcp, (*hostp)->host);
+
+		if (wget_tcp_connect(tcp, (*hostp)->host, (*hostp)->port ? (*hostp)->port : 443) == WGET_E_SUCCESS)
+			debug_printf("pre-warmed TLS session for %s\n", (*hostp)->host);
+
+		wget_tcp_deinit(&tcp);
+	}
+
+	return NULL;
+}
+
+static void tls_prewarm(void)
+{
+	struct tls_prewarm_context ctx = { .hosts = hosts_get_https() };
+	wget_thread_t tids[5];
+	int nhosts = wget_vector_size(ctx.hosts);
+	int nthreads = nhosts < (int) countof(tids) ? nhosts : (int) countof(tids);
+
+	if (nhosts > 0) {
+		info_printf(_("Pre-warming TLS sessions for %d host%s\n"), nhosts, nhosts != 1 ? "s" : "");
+		wget_thread_mutex_init(&ctx.mutex);
+
+		for (int it = 0; it < nthreads; it++)
+			if (wget_thread_start(&tids[it], tls_prewarm_thread, &ctx, 0) != 0)
+				tids[it] = 0;
+
+		for (int it = 0; it < nthreads; it++)
+			if (tids[it])
+				wget_thread_join(tids[it]);
+	}
+
+	wget_vector_free(&ctx.hosts);
+}
+
+// Flush the in-memory cookie/HSTS/ETag/HPKP/TLS-session/OCSP state to disk,
+// skipping databases without unsaved changes. Each save merges with the
+// on-disk file under a lock and replaces it atomically (wget_update_file()),
+// so this is safe to call periodically while the crawl is running.
+static void save_databases(void)
+{
+	if (config.save_cookies)
+		wget_cookie_db_save(config.cookie_db, config.save_cookies);
+
+	if (config.hsts && config.hsts_file && hsts_changed) {
+		hsts_changed = 0;
+		wget_hsts_db_save(config.hsts_db);
+	}
+
+	if (config.etags && config.etag_file && etag_changed) {
+		etag_changed = 0;
+		wget_etag_db_save(config.etag_db);
+	}
+
+	if (config.caps && config.caps_file && caps_changed) {
+		caps_changed = 0;
+		wget_caps_db_save(config.caps_db);
+	}
+
+	if (config.hpkp && config.hpkp_file && hpkp_changed) {
+		hpkp_changed = 0;
+		wget_hpkp_db_save(config.hpkp_db);
+	}
+
+	if (config.tls_resume && config.tls_session_file && wget_tls_session_db_changed(config.tls_session_db))
+		wget_tls_session_db_save(config.tls_session_db, config.tls_session_file);
+
+	if (config.ocsp && config.ocsp_file && wget_ocsp_db_changed(config.ocsp_db))
+		wget_ocsp_db_save(config.ocsp_db);
+}
+
 static void nop(int sig)
 {
 	if (sig == SIGTERM) {
@@ -985,6 +1892,10 @@ static void nop(int sig)
 #ifdef SIGWINCH
 	} else if (sig == SIGWINCH) {
 		wget_bar_screen_resized();
+#endif
+#ifdef SIGUSR1
+	} else if (sig == SIGUSR1) {
+		trace_dump_request(); // printed from the main loop, not from here
 #endif
 	}
 }
@@ -1019,6 +1930,7 @@ int main(int argc, const char **argv)
 	sigaction(SIGTERM, &sig_action, NULL);
 	sigaction(SIGINT, &sig_action, NULL);
 	sigaction(SIGWINCH, &sig_action, NULL);
+	sigaction(SIGUSR1, &sig_action, NULL);
 #endif
 
 	known_urls = wget_hashmap_create(128, (wget_hashmap_hash_t)hash_url, (wget_hashmap_compare_t)strcmp);
@@ -1036,8 +1948,39 @@ int main(int argc, const char **argv)
 	}
 	set_exit_status(WG_EXIT_STATUS_NO_ERROR);
 
+	if (config.alloc_stats)
+		wget_alloc_stats_enable(1); // as early as possible, counting starts here
+
+	// tool mode: explode a pack written by --pack-output, then exit
+	if (config.unpack) {
+		if (pack_explode() != 0)
+			set_exit_status(WG_EXIT_STATUS_IO);
+		goto out;
+	}
+
+	// thin-client mode: forward the URLs to a resident daemon and exit
+	if (config.daemon_fetch) {
+		if (daemon_fetch(argc, argv, n) != 0)
+			set_exit_status(WG_EXIT_STATUS_NETWORK);
+		goto out;
+	}
+
+	metrics_init();
+	trace_init();
+	telemetry_init();
+	shard_init(shard_enqueue);
+	daemon_init(daemon_enqueue, daemon_idle);
+	governor_init();
 	stats_init();
 
+	// must be loaded before the first URL is queued - add_url_to_queue()
+	// consults the filter
+	visited_load();
+
+	// accept HTTP/2 server pushed resources instead of re-requesting them
+	if (config.http2_server_push)
+		wget_http_set_server_push_callback(_accept_server_push);
+
 	for (; n < argc; n++) {
 		add_url_to_queue(argv[n], config.base, config.local_encoding);
 	}
@@ -1091,28 +2034,15 @@ int main(int argc, const char **argv)
 				}
 			}
 		} else {
-			int fd;
-			ssize_t len;
-			char *url;
-
-			// read URLs from input file
-			if ((fd = open(config.input_file, O_RDONLY|O_BINARY)) >= 0) {
-				while ((len = wget_fdgetline(&buf, &bufsize, fd)) >= 0) {
-					for (url = buf; len && isspace(*url); url++, len--); // skip leading spaces
-					if (*url == '#' || len <= 0) continue; // skip empty lines and comments
-					for (;len && isspace(url[len - 1]); len--);  // skip trailing spaces
-					// debug_printf("len=%zd url=%s\n", len, buf);
-
-					url[len] = 0;
-					add_url_to_queue(url, config.base, config.input_encoding);
-				}
-				close(fd);
-			} else
-				error_printf(_("Failed to open input file %s\n"), config.input_file);
+			// bulk-read URLs from input file
+			queue_urls_from_file(config.input_file, config.input_encoding);
 		}
 	}
 
-	if (queue_size() == 0 && !input_tid) {
+	// resume pending/known URLs from a previous interrupted run
+	snapshot_load();
+
+	if (queue_size() == 0 && !input_tid && !daemon_active()) {
 		error_printf(_("Nothing to do - goodbye\n"));
 		goto out;
 	}
@@ -1120,6 +2050,9 @@ int main(int argc, const char **argv)
 	// At this point, all values have been initialized and all URLs read.
 	// Perform any sanity checking or extra initialization here.
 
+	if (config.tls_prewarm && config.tls_resume)
+		tls_prewarm();
+
 	// Decide on the number of threads to spawn. In case we're reading
 	// asynchronously from STDIN or have are downloading recursively, we don't
 	// know the queue_size at startup, and hence spawn config.max_threads
@@ -1141,22 +2074,69 @@ int main(int argc, const char **argv)
 
 	downloaders = wget_calloc(config.max_threads, sizeof(DOWNLOADER));
 
+	long long last_snapshot = wget_get_timemillis_coarse();
+	long long last_db_flush = last_snapshot;
+	long long last_metrics = last_snapshot;
+
+	// the shortest enabled periodic task bounds the condition wait
+	long long wait_ms = config.snapshot_file ? config.snapshot_interval * 1000LL : 0;
+	if (config.metrics_file && (!wait_ms || config.metrics_interval * 1000LL < wait_ms))
+		wait_ms = config.metrics_interval * 1000LL;
+	// checking at half the timeout bounds the detection delay to ~1.5x
+	if (config.watchdog_timeout && (!wait_ms || config.watchdog_timeout * 500LL < wait_ms))
+		wait_ms = config.watchdog_timeout * 500LL;
+
 	wget_thread_mutex_lock(&main_mutex);
 	while (!terminate) {
 		// queue_print();
-		if (queue_empty() && !input_tid) {
+		// pull spilled URLs back in once the queue has drained below the cap
+		if (config.frontier_cap && frontier_pending() && queue_size() < (config.frontier_cap + 1) / 2)
+			frontier_requeue(config.frontier_cap - queue_size());
+
+		// an in-flight parse may still produce new jobs, so wait for the
+		// parse workers too (they signal main_cond when a task finishes);
+		// a resident daemon keeps waiting for fetch commands instead
+		if (queue_empty() && !input_tid && !parse_pending && !frontier_pending() && !daemon_active()) {
 			break;
 		}
 
-		for (;nthreads < config.max_threads && nthreads < queue_size(); nthreads++) {
-			downloaders[nthreads].id = nthreads;
+		// Adaptive pool sizing: reap threads that exited after being idle,
+		// then (re)start threads while there is more queued work than live
+		// threads, growing the pool at most geometrically per round.
+		int live = 0, grow;
+
+		for (int it = 0; it < nthreads; it++) {
+			if (downloaders[it].exited) {
+				wget_thread_join(downloaders[it].tid); // thread has ended, reap it
+				downloaders[it].tid = 0;
+				downloaders[it].exited = 0;
+			} else if (downloaders[it].tid)
+				live++;
+		}
+
+		grow = live > 4 ? live : 4;
+
+		for (int it = 0; grow && it < config.max_threads && live < queue_size(); it++) {
+			if (it < nthreads && downloaders[it].tid)
+				continue; // slot is busy
+
+			downloaders[it].id = it;
 
 			if (config.progress)
-				bar_update_slots(nthreads + 2);
+				bar_update_slots(it + 2);
 
 			// start worker threads (I call them 'downloaders')
-			if ((rc = wget_thread_start(&downloaders[nthreads].tid, downloader_thread, &downloaders[nthreads], 0)) != 0) {
+			if ((rc = wget_thread_start(&downloaders[it].tid, downloader_thread, &downloaders[it], 0)) != 0) {
 				error_printf(_("Failed to start downloader, error %d\n"), rc);
+			} else {
+				// on NUMA boxes this keeps a downloader's socket and
+				// buffers on one memory node (first-touch allocation)
+				if (config.bind_cpus)
+					wget_thread_bind_cpu(downloaders[it].tid, it);
+				live++;
+				grow--;
+				if (it >= nthreads)
+					nthreads = it + 1;
 			}
 		}
 
@@ -1170,8 +2150,47 @@ int main(int argc, const char **argv)
 		}
 
 		// here we sit and wait for an event from our worker threads
-		wget_thread_cond_wait(&main_cond, &main_mutex, 0);
+		wget_thread_cond_wait(&main_cond, &main_mutex, wait_ms);
 		debug_printf("%s: wake up\n", __func__);
+
+		// periodically persist the queue changes since the last checkpoint;
+		// appending the journal is O(changes), the full rewrite happens at exit
+		if (config.snapshot_file) {
+			long long now = wget_get_timemillis_coarse();
+
+			if (now - last_snapshot >= config.snapshot_interval * 1000LL) {
+				snapshot_checkpoint();
+				last_snapshot = now;
+			}
+		}
+
+		// periodically append the current counter totals for live monitoring
+		if (config.metrics_file) {
+			long long now = wget_get_timemillis_coarse();
+
+			if (now - last_metrics >= config.metrics_interval * 1000LL) {
+				metrics_dump();
+				last_metrics = now;
+			}
+		}
+
+		// a SIGUSR1 arrived since the last wake-up?
+		trace_dump(false);
+
+		// report downloads that stopped moving bytes
+		if (config.watchdog_timeout)
+			telemetry_watchdog_check();
+
+		// periodically flush the dirty state databases so a crash doesn't
+		// lose hours of accumulated session/validation state
+		{
+			long long now = wget_get_timemillis_coarse();
+
+			if (now - last_db_flush >= DB_FLUSH_INTERVAL) {
+				save_databases();
+				last_db_flush = now;
+			}
+		}
 	}
 	debug_printf("%s: done\n", __func__);
 
@@ -1187,32 +2206,56 @@ int main(int argc, const char **argv)
 		// if the thread is not detached, we have to call pthread_join()/pthread_timedjoin_np()
 		// else we will have a huge memory leak
 		//		if ((rc=pthread_timedjoin_np(downloader[n].tid, NULL, &ts))!=0)
+		if (!downloaders[n].tid)
+			continue; // slot was reaped after its thread exited idle
 		if ((rc = wget_thread_join(downloaders[n].tid)) != 0)
 			error_printf(_("Failed to wait for downloader #%d (%d %d)\n"), n, rc, errno);
 	}
 
+	parse_pool_stop();
+
+	// stop answering pollers before the host/queue structures go away
+	daemon_exit();
+	shard_exit();
+	telemetry_exit();
+
 	if (config.progress)
 		bar_printf(nthreads, "Files: %d  Bytes: %s  Redirects: %d  Todo: %d",
 			stats.ndownloads, wget_human_readable(quota_buf, sizeof(quota_buf), quota), stats.nredirects, queue_size());
 	else if ((config.recursive || config.page_requisites || (config.input_file && quota != 0)) && quota) {
 		info_printf(_("Downloaded: %d files, %s bytes, %d redirects, %d errors\n"),
 			stats.ndownloads, wget_human_readable(quota_buf, sizeof(quota_buf), quota), stats.nredirects, stats.nerrors);
-	}
 
-	if (config.save_cookies)
-		wget_cookie_db_save(config.cookie_db, config.save_cookies);
+		if (config.tcp_fastopen) {
+			int tfo_sends, tfo_fallbacks;
 
-	if (config.hsts && config.hsts_file && hsts_changed)
-		wget_hsts_db_save(config.hsts_db);
+			wget_tcp_get_stats_tcp_fastopen(&tfo_sends, &tfo_fallbacks);
+			if (tfo_sends || tfo_fallbacks)
+				info_printf(_("TCP Fast Open: %d requests sent on SYN, %d fallbacks\n"), tfo_sends, tfo_fallbacks);
+		}
+	}
 
-	if (config.hpkp && config.hpkp_file && hpkp_changed)
-		wget_hpkp_db_save(config.hpkp_db);
+	// --fast-exit: the queue snapshot, database saves and link conversion
+	// move into a forked flusher while the parent returns to the shell at
+	// once, without walking the heap. All worker threads are joined above,
+	// so the child inherits no locked mutex.
+	if (config.fast_exit) {
+		pid_t flusher = fork();
+
+		if (flusher > 0) { // parent: out at once, the child flushes the state
+			wget_log_async_stop();
+			plugin_db_finalize(get_exit_status());
+			_exit(get_exit_status());
+		}
+		// the child carries out the shutdown work below; when fork
+		// failed (flusher < 0), the parent does it inline as usual
+	}
 
-	if (config.tls_resume && config.tls_session_file && wget_tls_session_db_changed(config.tls_session_db))
-		wget_tls_session_db_save(config.tls_session_db, config.tls_session_file);
+	// final snapshot: everything left in the queue is still pending
+	snapshot_save();
+	visited_save();
 
-	if (config.ocsp && config.ocsp_file)
-		wget_ocsp_db_save(config.ocsp_db);
+	save_databases();
 
 	if (config.delete_after && config.output_document)
 		unlink(config.output_document);
@@ -1227,12 +2270,29 @@ int main(int argc, const char **argv)
 
 	stats_print();
 
+	if (config.fast_exit) {
+		// flusher child (or the parent itself when fork failed): the
+		// state is on disk now, leave without the heap teardown
+		wget_log_async_stop();
+		_exit(get_exit_status());
+	}
+
  out:
+	wget_log_async_stop(); // flush pending messages, back to synchronous logging
 	if (wget_match_tail(argv[0], "wget2_noinstall")) {
 		// freeing to avoid disguising valgrind output
 
 		xfree(buf);
 		blacklist_free();
+		dedup_free();
+		frontier_free();
+		visited_free();
+		writer_free();
+		pack_free();
+		warc_free();
+		replay_free();
+		latency_free();
+		conn_pool_free();
 		hosts_free();
 		host_ips_free();
 		xfree(downloaders);
@@ -1241,6 +2301,11 @@ int main(int argc, const char **argv)
 		wget_vector_clear_nofree(parents);
 		wget_vector_free(&parents);
 		wget_hashmap_free(&known_urls);
+		wget_stringmap_free(&created_dirs);
+		wget_stringmap_free(&unique_suffixes);
+		parse_cache_free();
+		body_cache_free();
+		feed_cursors_free();
 		wget_stringmap_free(&etags);
 		deinit();
 
@@ -1261,7 +2326,7 @@ void *input_thread(void *p G_GNUC_WGET_UNUSED)
 
 	while ((len = wget_fdgetline(&buf, &bufsize, STDIN_FILENO)) >= 0) {
 		add_url_to_queue(buf, config.base, config.local_encoding);
-		wget_thread_cond_signal(&worker_cond);
+		wget_thread_cond_signal_n(&worker_cond, 1);
 	}
 
 	// input closed, don't read from it any more
@@ -1275,10 +2340,13 @@ static int try_connection(DOWNLOADER *downloader, wget_iri_t *iri)
 	wget_http_connection_t *conn;
 	int rc;
 
-	if (config.hsts && iri->scheme == WGET_IRI_SCHEME_HTTP && wget_hsts_host_match(config.hsts_db, iri->host, iri->port)) {
-		info_printf("HSTS in effect for %s:%hu\n", iri->host, iri->port);
-		wget_iri_set_scheme(iri, WGET_IRI_SCHEME_HTTPS);
-		host_add(iri);	// add new host to hosts
+	if (config.hsts && iri->scheme == WGET_IRI_SCHEME_HTTP) {
+		config_load_db(CONFIG_DB_HSTS);
+		if (wget_hsts_host_match(config.hsts_db, iri->host, iri->port)) {
+			info_printf("HSTS in effect for %s:%hu\n", iri->host, iri->port);
+			wget_iri_set_scheme(iri, WGET_IRI_SCHEME_HTTPS);
+			host_add(iri);	// add new host to hosts
+		}
 	}
 
 	if ((conn = downloader->conn)) {
@@ -1286,12 +2354,41 @@ static int try_connection(DOWNLOADER *downloader, wget_iri_t *iri)
 			wget_http_get_scheme(conn) == iri->scheme &&
 			wget_http_get_port(conn) == iri->port)
 		{
-			debug_printf("reuse connection %s\n", wget_http_get_host(conn));
+			debug_printf("reuse connection %s\n", wget_http_get_host(conn));
+			return WGET_E_SUCCESS;
+		}
+
+		// a proxied connection carries absolute URIs and serves any host
+		// behind the proxy - don't pay a fresh handshake per origin
+		if (wget_http_get_proxy_host(conn)
+			&& wget_http_get_scheme(conn) == iri->scheme
+			&& wget_http_uses_proxy(iri))
+		{
+			debug_printf("reuse proxy connection %s\n", wget_http_get_proxy_host(conn));
 			return WGET_E_SUCCESS;
 		}
 
-		debug_printf("close connection %s\n", wget_http_get_host(conn));
-		wget_http_close(&downloader->conn);
+		// another thread may still have use for this warm connection
+		debug_printf("pool connection %s\n", wget_http_get_host(conn));
+		conn_pool_put(&downloader->conn);
+	}
+
+	if ((downloader->conn = conn_pool_get(iri))) {
+		debug_printf("reuse pooled connection %s\n", wget_http_get_host(downloader->conn));
+		return WGET_E_SUCCESS;
+	}
+
+	if (iri->scheme == WGET_IRI_SCHEME_HTTPS) {
+		// the TLS layer holds pointers into these databases, make sure
+		// they are populated before the first handshake
+		config_load_db(CONFIG_DB_HPKP);
+		config_load_db(CONFIG_DB_TLS_SESSION);
+		config_load_db(CONFIG_DB_OCSP);
+	}
+
+	if (config.caps) {
+		// the TCP layer sizes socket buffers from cached BDP measurements
+		config_load_db(CONFIG_DB_CAPS);
 	}
 
 	if ((rc = wget_http_open(&downloader->conn, iri)) == WGET_E_SUCCESS) {
@@ -1304,6 +2401,81 @@ static int try_connection(DOWNLOADER *downloader, wget_iri_t *iri)
 	return rc;
 }
 
+// Live mirror scoring: mirrors start out ranked by their static metalink
+// priority, but deliver wildly differently in practice. Every finished
+// chunk credits its mirror with bytes and elapsed time, every failed one
+// counts against it - remaining chunks then go to whoever delivers best
+// right now, and a repeatedly failing mirror stops being picked while any
+// alternative is left.
+#define MIRROR_MAX_FAILURES 3
+
+static wget_thread_mutex_t
+	mirror_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static int mirror_select(wget_metalink_t *metalink)
+{
+	int best = 0, best_class = -1;
+	long long best_score = -1;
+
+	wget_thread_mutex_lock(&mirror_mutex);
+
+	for (int it = 0; it < wget_vector_size(metalink->mirrors); it++) {
+		wget_metalink_mirror_t *mirror = wget_vector_get(metalink->mirrors, it);
+		int class;
+		long long score = 0;
+
+		if (mirror->failures >= MIRROR_MAX_FAILURES)
+			class = 0; // failed out, only used when nothing else is left
+		else if (!mirror->transfer_time)
+			class = 2; // untried - probe it to learn its speed
+		else {
+			class = 1;
+			score = mirror->transferred / mirror->transfer_time; // bytes/ms
+		}
+
+		if (class > best_class || (class == best_class && score > best_score)) {
+			best = it;
+			best_class = class;
+			best_score = score;
+
+			// mirrors are priority-sorted, the first untried one wins
+			if (class == 2)
+				break;
+		}
+	}
+
+	wget_thread_mutex_unlock(&mirror_mutex);
+
+	return best;
+}
+
+// credit or debit the mirror that served the last chunk attempt
+static void mirror_record(DOWNLOADER *downloader, int success, off_t length)
+{
+	wget_metalink_mirror_t *mirror = downloader->mirror;
+
+	if (!mirror)
+		return;
+
+	wget_thread_mutex_lock(&mirror_mutex);
+
+	if (success) {
+		long long ms = wget_get_timemillis_coarse() - downloader->part_ts;
+
+		mirror->transferred += length;
+		mirror->transfer_time += ms > 0 ? ms : 1;
+		mirror->failures = 0;
+	} else if (++mirror->failures == MIRROR_MAX_FAILURES) {
+		debug_printf("mirror %s failed %d times, deprioritized\n",
+			mirror->iri && mirror->iri->host ? mirror->iri->host : mirror->location,
+			mirror->failures);
+	}
+
+	wget_thread_mutex_unlock(&mirror_mutex);
+
+	downloader->mirror = NULL;
+}
+
 static int establish_connection(DOWNLOADER *downloader, wget_iri_t **iri)
 {
 	int rc = WGET_E_UNKNOWN;
@@ -1318,34 +2490,37 @@ static int establish_connection(DOWNLOADER *downloader, wget_iri_t **iri)
 		int mirror_index;
 
 		if (mirror_count > 0)
-			mirror_index = downloader->id % mirror_count;
+			mirror_index = mirror_select(metalink);
 		else {
 			host_final_failure(downloader->job->host);
 			set_exit_status(WG_EXIT_STATUS_NETWORK);
 			return rc;
 		}
 
-		// we try every mirror max. 'config.tries' number of times
-		for (int tries = 0; tries < config.tries && !part->done && !terminate; tries++) {
-			wget_millisleep(tries * 1000 > config.waitretry ? config.waitretry : tries * 1000);
-
-			if (terminate)
-				break;
-
-			for (int mirrors = 0; mirrors < wget_vector_size(metalink->mirrors) && !part->done; mirrors++) {
-				wget_metalink_mirror_t *mirror = wget_vector_get(metalink->mirrors, mirror_index);
+		// One round over the mirrors per attempt. When all of them fail the
+		// job goes back into its queue with a jittered backoff stamp instead
+		// of sleeping this thread here - the attempts are counted on the job,
+		// so config.tries still bounds them.
+		for (int mirrors = 0; mirrors < wget_vector_size(metalink->mirrors) && !part->done && !terminate; mirrors++) {
+			wget_metalink_mirror_t *mirror = wget_vector_get(metalink->mirrors, mirror_index);
 
-				mirror_index = (mirror_index + 1) % wget_vector_size(metalink->mirrors);
+			mirror_index = (mirror_index + 1) % wget_vector_size(metalink->mirrors);
 
-				rc = try_connection(downloader, mirror->iri);
+			rc = try_connection(downloader, mirror->iri);
 
-				if (rc == WGET_E_SUCCESS) {
-					if (iri)
-						*iri = mirror->iri;
-					return rc;
-				}
+			if (rc == WGET_E_SUCCESS) {
+				downloader->mirror = mirror;
+				downloader->part_ts = wget_get_timemillis_coarse();
+				if (iri)
+					*iri = mirror->iri;
+				return rc;
 			}
 		}
+
+		if (config.tries && job->failures + 1 >= config.tries) {
+			host_final_failure(downloader->job->host);
+			set_exit_status(WG_EXIT_STATUS_NETWORK);
+		}
 	} else {
 		rc = try_connection(downloader, *iri);
 	}
@@ -1367,21 +2542,194 @@ static void add_statistics(wget_http_response_t *resp)
 	wget_iri_t *iri = job->iri;
 
 	if (resp->code == 200) {
-		if (job->part)
+		if (job->part) {
 			_atomic_increment_int(&stats.nchunks);
-		else
+			metrics_add(METRICS_CHUNKS, 1);
+		} else {
 			_atomic_increment_int(&stats.ndownloads);
-	} else if (resp->code == 301 || resp->code == 302  || resp->code == 303  || resp->code == 307  || resp->code == 308)
+			metrics_add(METRICS_HTTP_OK, 1);
+		}
+	} else if (resp->code == 301 || resp->code == 302  || resp->code == 303  || resp->code == 307  || resp->code == 308) {
 		_atomic_increment_int(&stats.nredirects);
-	else if (resp->code == 304)
+		metrics_add(METRICS_HTTP_REDIRECTS, 1);
+	} else if (resp->code == 304) {
 		_atomic_increment_int(&stats.nnotmodified);
-	else
+		metrics_add(METRICS_HTTP_NOTMODIFIED, 1);
+	} else {
 		_atomic_increment_int(&stats.nerrors);
+		metrics_add(METRICS_HTTP_ERRORS, 1);
+	}
 
 	if (config.stats_site) {
 		wget_iri_t *parent_iri = job->redirection_level ? job->original_url : job->referer;
-		stats_tree_docs_add(parent_iri, iri, resp, (job == job->host->robot_job), (bool)job->redirection_level, stats_docs_add(iri, resp));
+		stats_site_add(parent_iri, iri, resp, (job == job->host->robot_job), (bool)job->redirection_level);
+	}
+}
+
+static void parse_task_free(PARSE_TASK *t)
+{
+	wget_html_free_urls_inline(&t->parsed_html);
+	wget_refstr_unref(&t->local_filename);
+	wget_buffer_free(&t->body);
+	xfree(t->content_type);
+	xfree(t->encoding);
+	xfree(t);
+}
+
+// Same dispatch as the inline parsing in process_response(), but working on
+// a task that survived its job: the parsers only read iri, level,
+// local_filename and sitemap, so a sparse stack JOB is sufficient.
+static void parse_task_process(PARSE_TASK *t)
+{
+	JOB job_buf, *job = job_init(&job_buf, t->iri);
+	const char *encoding = t->encoding ? t->encoding : config.remote_encoding;
+
+	job->level = t->level;
+	job->local_filename = t->local_filename;
+	job->parsed_html = t->parsed_html;
+	job->sitemap = t->sitemap;
+	t->parsed_html = NULL; // consumed (or freed) via the stack job below
+
+	if (!wget_strcasecmp_ascii(t->content_type, "text/html")) {
+		html_parse(job, job->level, t->body->data, t->body->length, encoding, job->iri);
+	} else if (!wget_strcasecmp_ascii(t->content_type, "application/xhtml+xml")) {
+		html_parse(job, job->level, t->body->data, t->body->length, encoding, job->iri);
+	} else if (!wget_strcasecmp_ascii(t->content_type, "text/css")) {
+		css_parse(job, t->body->data, t->body->length, encoding, job->iri);
+	} else if (!wget_strcasecmp_ascii(t->content_type, "application/atom+xml")) {
+		atom_parse(job, t->body->data, "utf-8", job->iri);
+	} else if (!wget_strcasecmp_ascii(t->content_type, "application/rss+xml")) {
+		rss_parse(job, t->body->data, "utf-8", job->iri);
+	} else if (job->sitemap) {
+		if (!wget_strcasecmp_ascii(t->content_type, "application/xml")
+			|| !wget_strcasecmp_ascii(t->content_type, "application/x-gzip")
+			|| !wget_strcasecmp_ascii(t->content_type, "text/plain"))
+			sitemap_parse_body(job, t->content_type, t->body);
+	}
+
+	wget_html_free_urls_inline(&job->parsed_html); // in case no parser consumed it
+}
+
+static void *parse_thread(void *p G_GNUC_WGET_UNUSED)
+{
+	PARSE_TASK *t;
+
+	wget_thread_mutex_lock(&parse_mutex);
+
+	while (!terminate) {
+		if (!(t = parse_queue_head)) {
+			wget_thread_cond_wait(&parse_cond, &parse_mutex, THREAD_IDLE_TIMEOUT);
+			continue;
+		}
+
+		if (!(parse_queue_head = t->next))
+			parse_queue_tail = NULL;
+
+		wget_thread_mutex_unlock(&parse_mutex);
+
+		parse_task_process(t);
+		parse_task_free(t);
+
+		wget_thread_mutex_lock(&parse_mutex);
+		parse_pending--;
+		// main() waits for the last in-flight parses before declaring the crawl done
+		wget_thread_cond_signal(&main_cond);
+	}
+
+	wget_thread_mutex_unlock(&parse_mutex);
+
+	// if we terminate, tell the other parse workers
+	wget_thread_cond_signal(&parse_cond);
+
+	return NULL;
+}
+
+// Hand a completed body over to the parse worker pool.
+// Returns 1 when the task was taken over (the response loses its body),
+// 0 when the caller has to parse inline.
+static int parse_pool_submit(JOB *job, wget_http_response_t *resp)
+{
+	PARSE_TASK *t;
+
+	if (config.parse_workers <= 0 || !wget_thread_support())
+		return 0;
+
+	// robots.txt gates the host queue and must be evaluated before the
+	// downloader releases the job - parse it inline
+	if (job->robotstxt)
+		return 0;
+
+	if (wget_strcasecmp_ascii(resp->content_type, "text/html")
+		&& wget_strcasecmp_ascii(resp->content_type, "application/xhtml+xml")
+		&& wget_strcasecmp_ascii(resp->content_type, "text/css")
+		&& wget_strcasecmp_ascii(resp->content_type, "application/atom+xml")
+		&& wget_strcasecmp_ascii(resp->content_type, "application/rss+xml")
+		&& !job->sitemap)
+		return 0; // nothing a parse worker could extract links from
+
+	// bounded handoff: a sitemap index may reference hundreds of large
+	// (gzipped) child sitemaps - when parsing falls behind, parse inline so
+	// the downloader threads apply back-pressure instead of queueing an
+	// unbounded number of response bodies
+	wget_thread_mutex_lock(&parse_mutex);
+	if (parse_pending >= config.parse_workers * 4) {
+		wget_thread_mutex_unlock(&parse_mutex);
+		return 0;
+	}
+	wget_thread_mutex_unlock(&parse_mutex);
+
+	t = wget_calloc(1, sizeof(PARSE_TASK));
+	t->body = resp->body;
+	resp->body = NULL; // taken over, the response is freed right after processing
+	t->parsed_html = job->parsed_html;
+	job->parsed_html = NULL;
+	t->iri = job->iri;
+	t->local_filename = wget_refstr_ref(job->local_filename);
+	t->content_type = wget_strdup(resp->content_type);
+	t->encoding = wget_strdup(resp->content_type_encoding);
+	t->level = job->level;
+	t->sitemap = job->sitemap;
+
+	wget_thread_mutex_lock(&parse_mutex);
+
+	if (parse_queue_tail)
+		parse_queue_tail->next = t;
+	else
+		parse_queue_head = t;
+	parse_queue_tail = t;
+	parse_pending++;
+
+	// grow the pool on demand, up to --parse-workers threads
+	if (parse_nthreads < config.parse_workers && parse_pending > parse_nthreads) {
+		if (!parse_tids)
+			parse_tids = wget_calloc(config.parse_workers, sizeof(wget_thread_t));
+		if (wget_thread_start(&parse_tids[parse_nthreads], parse_thread, NULL, 0) == 0)
+			parse_nthreads++;
+	}
+
+	wget_thread_cond_signal_n(&parse_cond, 1); // one task, one worker
+	wget_thread_mutex_unlock(&parse_mutex);
+
+	return 1;
+}
+
+// called from main() after the downloaders - the only submitters - are joined
+static void parse_pool_stop(void)
+{
+	PARSE_TASK *t, *next;
+
+	wget_thread_cond_signal(&parse_cond); // 'terminate' is set, wake the workers
+
+	for (int it = 0; it < parse_nthreads; it++)
+		wget_thread_join(parse_tids[it]);
+
+	// tasks skipped due to early termination (quota, Ctrl-C)
+	for (t = parse_queue_head; t; t = next) {
+		next = t->next;
+		parse_task_free(t);
 	}
+	parse_queue_head = parse_queue_tail = NULL;
+	xfree(parse_tids);
 }
 
 static int process_response_header(wget_http_response_t *resp)
@@ -1424,6 +2772,37 @@ static int process_response_header(wget_http_response_t *resp)
 		hsts_changed = 1;
 	}
 
+	// remember validators to make requests conditional on subsequent runs
+	if (config.etags && resp->code == 200 && !job->part
+		&& (resp->etag || resp->last_modified))
+	{
+		wget_etag_db_add(config.etag_db, iri->uri, resp->etag, resp->last_modified);
+		etag_changed = 1;
+	}
+
+	// remember per-host capabilities, so later runs pick protocol and
+	// segmentation without rediscovery
+	if (config.caps && !iri->is_ip_address) {
+		// a 206 proves range support, a 200 shows what the server advertises
+		char ranges = resp->code == 206 ? 1 : resp->code == 200 ? (char) resp->accept_ranges : -1;
+
+		wget_caps_db_add(config.caps_db, iri->host, iri->port,
+			wget_http_get_protocol(downloader->conn) == WGET_PROTOCOL_HTTP_2_0 ? "h2" : "http/1.1",
+			ranges, (char) !!resp->keep_alive);
+
+		// feed the delivery rate into the BDP cache so the next connection
+		// to this host sizes its socket buffers accordingly; small bodies
+		// measure little more than a round trip, skip them
+		if (resp->cur_downloaded >= 65536 && resp->req) {
+			long long millisecs = resp->response_end - resp->req->first_response_start;
+
+			if (millisecs > 0)
+				wget_caps_db_add_bdp(config.caps_db, iri->host, iri->port, -1,
+					((long long) resp->cur_downloaded * 1000) / millisecs);
+		}
+		caps_changed = 1;
+	}
+
 	// HTTP Public-Key Pinning (RFC 7469)
 	if (config.hpkp
 		&& iri->scheme == WGET_IRI_SCHEME_HTTPS && !iri->is_ip_address
@@ -1531,7 +2910,7 @@ static void process_head_response(wget_http_response_t *resp)
 			return; // if not -r then we are done
 
 		job->inuse = 0; // do this job again with GET request
-	} else if (config.chunk_size && resp->content_length > config.chunk_size) {
+	} else if (config.chunk_size && resp->content_length > config.chunk_size && resp->accept_ranges) {
 		// create metalink structure without hashing
 		wget_metalink_piece_t piece = { .length = config.chunk_size };
 		wget_metalink_mirror_t mirror = { .location = "-", .iri = job->iri };
@@ -1554,12 +2933,15 @@ static void process_head_response(wget_http_response_t *resp)
 
 		// start or resume downloading
 		if (!job_validate_file(job)) {
-			// wake up sleeping workers
-			wget_thread_cond_signal(&worker_cond);
+			// wake up a sleeping worker
+			wget_thread_cond_signal_n(&worker_cond, 1);
 			job->inuse = 0; // do not remove this job from queue yet
 		} // else file already downloaded and checksum ok
 	} else if (config.chunk_size) {
-		// server did not send Content-Length or chunk size <= Content-Length
+		// server did not send Content-Length or 'Accept-Ranges: bytes',
+		// or the file fits into one chunk
+		if (resp->content_length > config.chunk_size)
+			info_printf(_("No byte ranges support at %s - downloading over a single connection\n"), job->iri->host);
 		job->inuse = 0; // do not remove this job from queue yet
 	}
 }
@@ -1587,6 +2969,8 @@ static void process_response_part(wget_http_response_t *resp)
 		part->done = 1; // set this when downloaded ok
 	}
 
+	mirror_record(downloader, part->done, part->length);
+
 	if (part->done) {
 		// check if all parts are done (downloaded + hash-checked)
 		int all_done = 1, it;
@@ -1684,7 +3068,7 @@ static void process_response(wget_http_response_t *resp)
 
 		if (metalink) {
 			// found a link to a metalink3 or metalink4 description, create a new job
-			add_url(job, "utf-8", metalink->uri, 0);
+			add_url(job, "utf-8", metalink->uri, URL_FLG_METALINK);
 			return;
 		} else if (top_link) {
 			// no metalink4 description found, create a new job
@@ -1699,7 +3083,8 @@ static void process_response(wget_http_response_t *resp)
 		{
 			// print_status(downloader, "get metalink info\n");
 			// save_file(resp, job->local_filename, O_TRUNC);
-			job->metalink = resp->body && resp->body->data ? wget_metalink_parse(resp->body->data) : NULL;
+			if (!job->metalink) // not already built by the streaming parse
+				job->metalink = resp->body && resp->body->data ? wget_metalink_parse(resp->body->data) : NULL;
 		}
 		if (job->metalink) {
 			if (job->metalink->size <= 0) {
@@ -1714,8 +3099,8 @@ static void process_response(wget_http_response_t *resp)
 					// sort mirrors by priority to download from highest priority first
 					wget_metalink_sort_mirrors(job->metalink);
 
-					// wake up sleeping workers
-					wget_thread_cond_signal(&worker_cond);
+					// wake up a sleeping worker
+					wget_thread_cond_signal_n(&worker_cond, 1);
 
 					job->inuse = 0; // do not remove this job from queue yet
 				} // else file already downloaded and checksum ok
@@ -1725,7 +3110,7 @@ static void process_response(wget_http_response_t *resp)
 	}
 
 	// Forward response to plugins
-	if (resp->code == 200 || resp->code == 206 || resp->code == 416 || (resp->code == 304 && config.timestamping)) {
+	if (resp->code == 200 || resp->code == 206 || resp->code == 416 || (resp->code == 304 && (config.timestamping || config.etags))) {
 		process_decision = job->local_filename || resp->body ? 1 : 0;
 		recurse_decision = process_decision && config.recursive
 			&& (!config.level || job->level < config.level + config.page_requisites) ? 1 : 0;
@@ -1768,7 +3153,9 @@ static void process_response(wget_http_response_t *resp)
 
 	if (resp->code == 200 || resp->code == 206) {
 		if (process_decision && recurse_decision) {
-			if (resp->content_type && resp->body) {
+			// prefer handing the body to a dedicated parse worker so this
+			// thread can go back to network work immediately
+			if (resp->content_type && resp->body && !parse_pool_submit(job, resp)) {
 				if (!wget_strcasecmp_ascii(resp->content_type, "text/html")) {
 					html_parse(job, job->level, resp->body->data, resp->body->length, resp->content_type_encoding ? resp->content_type_encoding : config.remote_encoding, job->iri);
 				} else if (!wget_strcasecmp_ascii(resp->content_type, "application/xhtml+xml")) {
@@ -1781,15 +3168,15 @@ static void process_response(wget_http_response_t *resp)
 				} else if (!wget_strcasecmp_ascii(resp->content_type, "application/rss+xml")) { // see https://cyber.harvard.edu/rss/rss.html
 					rss_parse(job, resp->body->data, "utf-8", job->iri);
 				} else if (job->sitemap) {
-					if (!wget_strcasecmp_ascii(resp->content_type, "application/xml"))
-						sitemap_parse_xml(job, resp->body->data, "utf-8", job->iri);
-					else if (!wget_strcasecmp_ascii(resp->content_type, "application/x-gzip"))
-						sitemap_parse_xml_gz(job, resp->body, "utf-8", job->iri);
-					else if (!wget_strcasecmp_ascii(resp->content_type, "text/plain"))
-						sitemap_parse_text(job, resp->body->data, "utf-8", job->iri);
+					if (!wget_strcasecmp_ascii(resp->content_type, "application/xml")
+						|| !wget_strcasecmp_ascii(resp->content_type, "application/x-gzip")
+						|| !wget_strcasecmp_ascii(resp->content_type, "text/plain"))
+						sitemap_parse_body(job, resp->content_type, resp->body);
 				} else if (job->robotstxt) {
 					debug_printf("Scanning robots.txt ...\n");
 					if ((job->host->robots = wget_robots_parse(resp->body->data, PACKAGE_NAME))) {
+						host_compile_robots(job->host);
+
 						// the sitemaps are not relevant as page requisites
 						if (!config.page_requisites) {
 							// add sitemaps to be downloaded (format https://www.sitemaps.org/protocol.html)
@@ -1804,7 +3191,7 @@ static void process_response(wget_http_response_t *resp)
 			}
 		}
 	}
-	else if ((resp->code == 304 && config.timestamping) || resp->code == 416) { // local document is up-to-date
+	else if ((resp->code == 304 && (config.timestamping || config.etags)) || resp->code == 416) { // local document is up-to-date
 		if (process_decision && recurse_decision) {
 			const char *ext;
 
@@ -1837,7 +3224,7 @@ void *downloader_thread(void *p)
 	JOB *job;
 	HOST *host = NULL;
 	int pending = 0, max_pending = 1, locked;
-	long long pause = 0;
+	long long pause = 0, idle_since = 0;
 	enum actions action = ACTION_GET_JOB;
 
 	downloader->tid = wget_thread_self(); // to avoid race condition
@@ -1849,54 +3236,94 @@ void *downloader_thread(void *p)
 
 		switch (action) {
 		case ACTION_GET_JOB: // Get a job, connect, send request
+			// at the fd/memory budget: admit no new work, the in-flight
+			// downloads of the other threads release resources as they finish
+			if (!pending && governor_should_delay()) {
+				wget_thread_cond_wait(&worker_cond, &main_mutex, GOVERNOR_CHECK_INTERVAL); locked = 1;
+				break;
+			}
+
 			if (!(job = host_get_job(host, &pause))) {
 				if (pending) {
 					wget_thread_mutex_unlock(&main_mutex); locked = 0;
 					action = ACTION_GET_RESPONSE;
 				} else if (host) {
-					wget_http_close(&downloader->conn);
+					conn_pool_put(&downloader->conn);
+					host_dec_worker(host);
 					host = NULL;
 				} else {
 					if (!wget_thread_support()) {
 						goto out;
 					}
-					wget_thread_cond_wait(&worker_cond, &main_mutex, pause); locked = 1;
+
+					// shrink the pool: exit when idle for too long, main() will
+					// restart a thread when the queue fills up again
+					if (!idle_since)
+						idle_since = wget_get_timemillis_coarse();
+					else if (wget_get_timemillis_coarse() - idle_since >= THREAD_IDLE_TIMEOUT) {
+						downloader->exited = 1;
+						wget_thread_cond_signal(&main_cond);
+						goto out;
+					}
+
+					wget_thread_cond_wait(&worker_cond, &main_mutex,
+						pause > 0 && pause < THREAD_IDLE_TIMEOUT ? pause : THREAD_IDLE_TIMEOUT); locked = 1;
 				}
 				break;
 			}
 
+			idle_since = 0;
+
 			wget_thread_mutex_unlock(&main_mutex); locked = 0;
 
 			{
 				wget_iri_t *iri = job->iri;
 				downloader->job = job;
 				job->downloader = downloader;
+				job->trace = trace_begin(iri ? iri->uri : NULL, job->queued_ts);
+				telemetry_job_begin(downloader->id, iri ? iri->uri : NULL, -1);
 
 				if (++pending == 1) {
 					host = job->host;
+					host_inc_worker(host);
 
 					if (establish_connection(downloader, &iri)) {
 						host_increase_failure(host);
+						job_backoff(job); // retried when the jittered stamp passes
 						action = ACTION_ERROR;
 						break;
 					}
 
+					trace_stamp(job->trace, TRACE_CONNECT);
+					telemetry_job_phase(downloader->id, TELEMETRY_PHASE_REQUEST);
+
 					job->iri = iri;
-					if (config.wait || job->metalink || !downloader->conn || wget_http_get_protocol(downloader->conn) != WGET_PROTOCOL_HTTP_2_0)
+					if (config.wait || job->metalink || !downloader->conn)
+						max_pending = 1;
+					else if (wget_http_get_protocol(downloader->conn) == WGET_PROTOCOL_HTTP_2_0) {
+						// fill the connection with as many concurrent streams as both sides allow
+						max_pending = wget_http_get_max_concurrent_streams(downloader->conn);
+						if (max_pending > config.http2_request_window)
+							max_pending = config.http2_request_window;
+					} else if (config.http1_request_window > 1 && !host->pipelining_broken
+						&& !config.post_data && !config.post_file)
+					{
+						// opt-in HTTP/1.1 pipelining: burst idempotent requests
+						// back-to-back, responses come back in request order
+						max_pending = config.http1_request_window;
+					} else
 						max_pending = 1;
-					else
-						max_pending = config.http2_request_window;
 				}
 
-				// wait between sending requests
+				// politeness wait between requests to the same host: instead of
+				// sleeping here, stamp the host so host_get_job() holds its jobs
+				// back until the wait elapsed - this thread stays available for
+				// other hosts meanwhile
 				if (config.wait) {
 					if (config.random_wait)
-						wget_millisleep(rand() % config.wait + config.wait / 2); // (0.5 - 1.5) * config.wait
+						host_delay_request(host, rand() % config.wait + config.wait / 2); // (0.5 - 1.5) * config.wait
 					else
-						wget_millisleep(config.wait);
-
-					if (terminate)
-						break;
+						host_delay_request(host, config.wait);
 				}
 
 				if (!job->original_url)
@@ -1904,10 +3331,23 @@ void *downloader_thread(void *p)
 
 				if (http_send_request(job->iri, job->original_url, downloader)) {
 					host_increase_failure(host);
+					job_backoff(job);
 					action = ACTION_ERROR;
 					break;
 				}
 
+				trace_stamp(job->trace, TRACE_REQUEST);
+				telemetry_job_phase(downloader->id, TELEMETRY_PHASE_READ);
+
+				// the server's SETTINGS frame may arrive after connect,
+				// honor a lowered stream limit for the rest of this batch
+				if (max_pending > 1 && wget_http_get_protocol(downloader->conn) == WGET_PROTOCOL_HTTP_2_0) {
+					int streams = wget_http_get_max_concurrent_streams(downloader->conn);
+
+					if (streams < max_pending)
+						max_pending = streams;
+				}
+
 				if (pending >= max_pending)
 					action = ACTION_GET_RESPONSE;
 				else
@@ -1927,6 +3367,20 @@ void *downloader_thread(void *p)
 			host_reset_failure(host);
 
 			job = resp->req->user_data;
+			// a pushed response satisfies a job of its own making, not one
+			// of this batch's requests - 'pending' counts only the latter
+			bool pushed = job->pushed;
+			job->failures = 0;
+			job->retry_ts = 0;
+			trace_stamp(job->trace, TRACE_LAST_BYTE);
+
+			// feed the latency histograms from the request timestamps
+			if (resp->req->request_start > 0) {
+				if (resp->req->first_response_start >= resp->req->request_start)
+					latency_add(host->host, LATENCY_TTFB, resp->req->first_response_start - resp->req->request_start);
+				if (resp->response_end >= resp->req->request_start)
+					latency_add(host->host, LATENCY_TOTAL, resp->response_end - resp->req->request_start);
+			}
 
 			// general response check to see if we need further processing
 			if (process_response_header(resp) == 0) {
@@ -1938,6 +3392,10 @@ void *downloader_thread(void *p)
 					process_response(resp); // GET + POST request/response
 			}
 
+			trace_stamp(job->trace, TRACE_PROCESSED);
+			job->trace = NULL; // record stays in the ring
+			telemetry_job_end(downloader->id);
+
 			wget_http_free_request(&resp->req);
 			wget_http_free_response(&resp);
 
@@ -1946,22 +3404,51 @@ void *downloader_thread(void *p)
 			// download of single-part file complete, remove from job queue
 			if (job && job->inuse)
 				host_remove_job(host, job);
+			else if (job && pushed) {
+				// a pushed job never entered a host queue - dispose of it here
+				if (job->iri) {
+					snapshot_journal_add(true, job->iri->uri);
+					visited_add(job->iri->uri);
+				}
+				job_free(job);
+				job_recycle(&job);
+			}
+
+			// the server closed a pipelined connection early: the unanswered
+			// requests died with it, re-queue their jobs and re-send them one
+			// at a time on a fresh connection
+			if (pending > 1 && !downloader->conn) {
+				host_disable_pipelining(host);
+				host_release_jobs(host);
+				pending = 1;
+			}
 
 			wget_thread_cond_signal(&main_cond);
 
-			pending--;
+			if (!pushed)
+				pending--;
 			action = ACTION_GET_JOB;
 
 			break;
 
 		case ACTION_ERROR:
+			// an aborted pipelined batch hints at a server that can't cope
+			// with bursts - don't try pipelining against this host again
+			if (max_pending > 1 && pending > 1 && downloader->conn
+				&& wget_http_get_protocol(downloader->conn) != WGET_PROTOCOL_HTTP_2_0)
+				host_disable_pipelining(host);
+
 			wget_http_close(&downloader->conn);
+			telemetry_job_end(downloader->id);
 
 			wget_thread_mutex_lock(&main_mutex); locked = 1;
 			host_release_jobs(host);
 			wget_thread_cond_signal(&main_cond);
 
-			host = NULL;
+			if (host) {
+				host_dec_worker(host);
+				host = NULL;
+			}
 			pending = 0;
 
 			action = ACTION_GET_JOB;
@@ -1975,7 +3462,9 @@ void *downloader_thread(void *p)
 out:
 	if (locked)
 		wget_thread_mutex_unlock(&main_mutex);
-	wget_http_close(&downloader->conn);
+	if (host)
+		host_dec_worker(host);
+	conn_pool_put(&downloader->conn);
 
 	// if we terminate, tell the other downloaders
 	wget_thread_cond_signal(&worker_cond);
@@ -2064,9 +3553,104 @@ static int _normalize_uri(wget_iri_t *base, wget_string_t *url, const char *enco
 	return 0;
 }
 
+// ---- parse-result cache ----
+// Mirror runs refetch boilerplate pages (shared headers/footers, pagination
+// templates) whose link list we have extracted before. Remember the result
+// of wget_html_get_urls_inline() keyed by a digest of the body, so a
+// byte-identical body skips tokenizing entirely. The cached entry stores
+// the links as document offsets and is rebased onto the current body on a hit.
+
+#define PARSE_CACHE_KEY_SIZE 32 // length of a SHA-256 digest
+#define PARSE_CACHE_MAX_ENTRIES 10000
+
+static wget_hashmap_t
+	*parse_cache;
+static wget_thread_mutex_t
+	parse_cache_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+static unsigned int G_GNUC_WGET_PURE _parse_cache_hash(const char *key)
+{
+	unsigned int hash;
+
+	memcpy(&hash, key, sizeof(hash)); // the key already is a digest, take it as-is
+	return hash;
+}
+
+static int G_GNUC_WGET_PURE _parse_cache_cmp(const char *key1, const char *key2)
+{
+	return memcmp(key1, key2, PARSE_CACHE_KEY_SIZE);
+}
+
+static void _parse_cache_free_value(wget_html_parsed_result_t *res)
+{
+	wget_html_free_urls_inline(&res);
+}
+
+// deep copy of a parse result, rebasing the url pointers from document
+// 'from' onto document 'to' (either may be NULL = offset form)
+static wget_html_parsed_result_t *html_result_clone(const wget_html_parsed_result_t *res, const char *from, const char *to)
+{
+	wget_html_parsed_result_t *clone = wget_memdup(res, sizeof(*res));
+
+	clone->arena = NULL; // the clone owns conventional heap memory
+	clone->encoding = wget_strdup(res->encoding);
+
+	if (clone->base.len)
+		clone->base.p = to + (res->base.p - from);
+
+	if (res->uris) {
+		clone->uris = wget_vector_create(wget_vector_size(res->uris), -2, NULL);
+
+		for (int it = 0; it < wget_vector_size(res->uris); it++) {
+			wget_html_parsed_url_t url = *(wget_html_parsed_url_t *) wget_vector_get(res->uris, it);
+
+			url.url.p = to + (url.url.p - from);
+			wget_vector_add(clone->uris, &url, sizeof(url));
+		}
+	}
+
+	return clone;
+}
+
+static wget_html_parsed_result_t *parse_cache_get(const char *key, const char *html)
+{
+	wget_html_parsed_result_t *cached, *parsed = NULL;
+
+	wget_thread_mutex_lock(&parse_cache_mutex);
+
+	if (parse_cache && (cached = wget_hashmap_get(parse_cache, key)))
+		parsed = html_result_clone(cached, NULL, html);
+
+	wget_thread_mutex_unlock(&parse_cache_mutex);
+
+	return parsed;
+}
+
+static void parse_cache_put(const char *key, const char *html, const wget_html_parsed_result_t *parsed)
+{
+	wget_thread_mutex_lock(&parse_cache_mutex);
+
+	if (!parse_cache) {
+		parse_cache = wget_hashmap_create(128, (wget_hashmap_hash_t)_parse_cache_hash, (wget_hashmap_compare_t)_parse_cache_cmp);
+		wget_hashmap_set_value_destructor(parse_cache, (wget_hashmap_value_destructor_t)_parse_cache_free_value);
+	}
+
+	if (wget_hashmap_size(parse_cache) < PARSE_CACHE_MAX_ENTRIES && !wget_hashmap_contains(parse_cache, key))
+		wget_hashmap_put_noalloc(parse_cache, wget_memdup(key, PARSE_CACHE_KEY_SIZE), html_result_clone(parsed, html, NULL));
+
+	wget_thread_mutex_unlock(&parse_cache_mutex);
+}
+
+static void parse_cache_free(void)
+{
+	wget_hashmap_free(&parse_cache);
+}
+
 void html_parse(JOB *job, int level, const char *html, size_t html_len, const char *encoding, wget_iri_t *base)
 {
 	wget_iri_t *allocated_base = NULL;
+	const char *html_org = html; // the bytes as saved on disk, before BOM/charset handling
+	size_t html_len_org = html_len;
 	const char *reason;
 	char *utf8 = NULL;
 	wget_buffer_t buf;
@@ -2127,7 +3711,28 @@ void html_parse(JOB *job, int level, const char *html, size_t html_len, const ch
 		}
 	}
 
-	wget_html_parsed_result_t *parsed  = wget_html_get_urls_inline(html, config.follow_tags, config.ignore_tags);
+	wget_html_parsed_result_t *parsed;
+	char body_digest[PARSE_CACHE_KEY_SIZE];
+	// the parser sees a 0-terminated document ('html_len' is stale after a
+	// UTF-16 conversion), so that is also what identifies the parse result
+	int digest_ok = wget_hash_fast(WGET_DIGTYPE_SHA256, html, strlen(html), body_digest) == 0;
+
+	if (job && job->parsed_html) {
+		// the links have already been extracted chunk-wise while the body was streaming in,
+		// the offsets were resolved against 'html' (= the response body), see _get_body()
+		parsed = job->parsed_html;
+		job->parsed_html = NULL;
+
+		if (digest_ok)
+			parse_cache_put(body_digest, html, parsed); // later identical bodies skip parsing
+	} else if (digest_ok && (parsed = parse_cache_get(body_digest, html))) {
+		debug_printf("%s: cache hit, parsing skipped\n", __func__);
+	} else {
+		parsed = wget_html_get_urls_inline(html, config.follow_tags, config.ignore_tags);
+
+		if (digest_ok)
+			parse_cache_put(body_digest, html, parsed);
+	}
 
 	if (config.robots && !parsed->follow)
 		goto cleanup;
@@ -2161,7 +3766,12 @@ void html_parse(JOB *job, int level, const char *html, size_t html_len, const ch
 		}
 	}
 
+	int enqueued = 0;
+
+	// batch enqueue: take the locks once for all URLs of this document and
+	// wake up one downloader per job actually added
 	wget_thread_mutex_lock(&known_urls_mutex);
+	wget_thread_mutex_lock(&downloader_mutex);
 	for (int it = 0; it < wget_vector_size(parsed->uris); it++) {
 		wget_html_parsed_url_t *html_url = wget_vector_get(parsed->uris, it);
 		wget_string_t *url = &html_url->url;
@@ -2192,11 +3802,17 @@ void html_parse(JOB *job, int level, const char *html, size_t html_len, const ch
 		if (!base && !buf.length)
 			info_printf(_("URL '%.*s' not followed (missing base URI)\n"), (int)url->len, url->p);
 		else {
-			// Blacklist for URLs before they are processed
-			if (wget_hashmap_put_noalloc(known_urls, wget_strmemdup(buf.data, buf.length), NULL) == 0)
-				add_url(job, "utf-8", buf.data, 0);
+			// Blacklist for URLs before they are processed.
+			// Check membership first - the key is only allocated for new URLs,
+			// repeated links (the majority in a focused crawl) cost nothing.
+			if (!wget_hashmap_contains(known_urls, buf.data)) {
+				wget_hashmap_put_noalloc(known_urls, wget_strmemdup(buf.data, buf.length), NULL);
+				enqueued += add_url_impl(job, "utf-8", buf.data, html_url->link_inline ? URL_FLG_REQUISITE : 0);
+			}
 		}
 	}
+	wget_thread_cond_signal_n(&worker_cond, enqueued);
+	wget_thread_mutex_unlock(&downloader_mutex);
 	wget_thread_mutex_unlock(&known_urls_mutex);
 
 	wget_buffer_deinit(&buf);
@@ -2207,6 +3823,10 @@ void html_parse(JOB *job, int level, const char *html, size_t html_len, const ch
 			html_url->url.p = (const char *) (html_url->url.p - html); // convert pointer to offset
 		}
 		_remember_for_conversion(job->local_filename, base, _CONTENT_TYPE_HTML, encoding, parsed);
+		// keep the body for the conversion pass, saves the disk re-read
+		// (with --save-headers the file differs from the body, skip it then)
+		if (!config.save_headers)
+			body_cache_put(job->local_filename, html_org, html_len_org);
 		parsed = NULL; // 'parsed' has been consumed
 	}
 
@@ -2246,7 +3866,12 @@ void sitemap_parse_xml(JOB *job, const char *data, const char *encoding, wget_ir
 
 	// process the sitemap urls here
 	info_printf(_("found %d url(s) (base=%s)\n"), wget_vector_size(urls), base ? base->uri : NULL);
+
+	int enqueued = 0;
+
+	// batch enqueue: take the locks once for the whole sitemap
 	wget_thread_mutex_lock(&known_urls_mutex);
+	wget_thread_mutex_lock(&downloader_mutex);
 	for (int it = 0; it < wget_vector_size(urls); it++) {
 		wget_string_t *url = wget_vector_get(urls, it);
 
@@ -2264,7 +3889,7 @@ void sitemap_parse_xml(JOB *job, const char *data, const char *encoding, wget_ir
 			continue;
 		}
 
-		add_url(job, encoding, p, 0);
+		enqueued += add_url_impl(job, encoding, p, 0);
 	}
 
 	// process the sitemap index urls here
@@ -2281,8 +3906,10 @@ void sitemap_parse_xml(JOB *job, const char *data, const char *encoding, wget_ir
 			continue;
 		}
 
-		add_url(job, encoding, p, URL_FLG_SITEMAP);
+		enqueued += add_url_impl(job, encoding, p, URL_FLG_SITEMAP);
 	}
+	wget_thread_cond_signal_n(&worker_cond, enqueued);
+	wget_thread_mutex_unlock(&downloader_mutex);
 	wget_thread_mutex_unlock(&known_urls_mutex);
 
 	wget_vector_free(&urls);
@@ -2297,22 +3924,79 @@ static int _get_unzipped(void *userdata, const char *data, size_t length)
 	return 0;
 }
 
+// identify a compressed body by its leading magic bytes instead of trusting
+// the announced type - misconfigured servers label gzipped sitemaps as XML
+// (or the transport already decoded them), and a wrong guess costs a failed
+// or redundant decompression pass over the whole file
+static char _sniff_content_encoding(const char *data, size_t length)
+{
+	const unsigned char *p = (const unsigned char *) data;
+
+	if (length >= 2 && p[0] == 0x1F && p[1] == 0x8B)
+		return wget_content_encoding_gzip;
+	if (length >= 3 && p[0] == 'B' && p[1] == 'Z' && p[2] == 'h')
+		return wget_content_encoding_bzip2;
+	if (length >= 6 && p[0] == 0xFD && !memcmp(p + 1, "7zXZ", 4) && p[5] == 0)
+		return wget_content_encoding_lzma;
+	if (length >= 4 && p[0] == 0x28 && p[1] == 0xB5 && p[2] == 0x2F && p[3] == 0xFD)
+		return wget_content_encoding_zstd;
+
+	return wget_content_encoding_identity;
+}
+
 void sitemap_parse_xml_gz(JOB *job, wget_buffer_t *gzipped_data, const char *encoding, wget_iri_t *base)
 {
+	char encoding_type = _sniff_content_encoding(gzipped_data->data, gzipped_data->length);
+
+	if (encoding_type == wget_content_encoding_identity) {
+		// mislabeled or already decoded by the transport - parse as is
+		sitemap_parse_xml(job, gzipped_data->data, encoding, base);
+		return;
+	}
+
 	wget_buffer_t *plain = wget_buffer_alloc(gzipped_data->length * 10);
 	wget_decompressor_t *dc = NULL;
 
-	if ((dc = wget_decompress_open(wget_content_encoding_gzip, _get_unzipped, plain))) {
-		wget_decompress(dc, gzipped_data->data, gzipped_data->length);
+	// a doubly compressed body (transport + stored .gz) needs a second pass,
+	// the sniff on the output tells us - bounded, garbage stays garbage
+	for (int pass = 0; pass < 2 && encoding_type != wget_content_encoding_identity; pass++) {
+		if (!(dc = wget_decompress_open(encoding_type, _get_unzipped, plain))) {
+			error_printf("Can't scan '%s' because no decompression support enabled at compile time\n", job->iri->uri);
+			wget_buffer_free(&plain);
+			return;
+		}
+
+		if (pass == 0)
+			wget_decompress(dc, gzipped_data->data, gzipped_data->length);
+		else {
+			wget_buffer_t *compressed = plain;
+
+			plain = wget_buffer_alloc(compressed->length * 10);
+			wget_decompress(dc, compressed->data, compressed->length);
+			wget_buffer_free(&compressed);
+		}
 		wget_decompress_close(dc);
 
-		sitemap_parse_xml(job, plain->data, encoding, base);
-	} else
-		error_printf("Can't scan '%s' because no libz support enabled at compile time\n", job->iri->uri);
+		encoding_type = _sniff_content_encoding(plain->data, plain->length);
+	}
+
+	sitemap_parse_xml(job, plain->data, encoding, base);
 
 	wget_buffer_free(&plain);
 }
 
+// dispatch a sitemap body to the right parser: the Content-Type narrows the
+// format down, but the magic bytes have the final say on the codec chain
+static void sitemap_parse_body(JOB *job, const char *content_type, wget_buffer_t *body)
+{
+	if (_sniff_content_encoding(body->data, body->length) != wget_content_encoding_identity)
+		sitemap_parse_xml_gz(job, body, "utf-8", job->iri);
+	else if (!wget_strcasecmp_ascii(content_type, "text/plain"))
+		sitemap_parse_text(job, body->data, "utf-8", job->iri);
+	else
+		sitemap_parse_xml(job, body->data, "utf-8", job->iri);
+}
+
 void sitemap_parse_xml_localfile(JOB *job, const char *fname, const char *encoding, wget_iri_t *base)
 {
 	char *data;
@@ -2336,6 +4020,11 @@ void sitemap_parse_text(JOB *job, const char *data, const char *encoding, wget_i
 			baselen = strlen(base->uri);
 	}
 
+	int enqueued = 0;
+
+	// batch enqueue: take the lock once for the whole sitemap
+	wget_thread_mutex_lock(&downloader_mutex);
+
 	// also catch the case where the last line isn't terminated by '\n'
 	for (line = end = data; *end && (end = (p = strchr(line, '\n')) ? p : line + strlen(line)); line = end + 1) {
 		// trim
@@ -2354,14 +4043,17 @@ void sitemap_parse_text(JOB *job, const char *data, const char *encoding, wget_i
 				memcpy(url, line, len);
 				url[len] = 0;
 
-				add_url(job, encoding, url, 0);
+				enqueued += add_url_impl(job, encoding, url, 0);
 			} else {
 				char *url = wget_strmemdup(line, len);
-				add_url(job, encoding, url, 0);
+				enqueued += add_url_impl(job, encoding, url, 0);
 				xfree(url);
 			}
 		}
 	}
+
+	wget_thread_cond_signal_n(&worker_cond, enqueued);
+	wget_thread_mutex_unlock(&downloader_mutex);
 }
 
 static void _add_urls(JOB *job, wget_vector_t *urls, const char *encoding, wget_iri_t *base)
@@ -2378,7 +4070,11 @@ static void _add_urls(JOB *job, wget_vector_t *urls, const char *encoding, wget_
 
 	info_printf(_("found %d url(s) (base=%s)\n"), wget_vector_size(urls), base ? base->uri : NULL);
 
+	int enqueued = 0;
+
+	// batch enqueue: take the locks once for the whole feed
 	wget_thread_mutex_lock(&known_urls_mutex);
+	wget_thread_mutex_lock(&downloader_mutex);
 	for (int it = 0; it < wget_vector_size(urls); it++) {
 		wget_string_t *url = wget_vector_get(urls, it);
 
@@ -2387,26 +4083,116 @@ static void _add_urls(JOB *job, wget_vector_t *urls, const char *encoding, wget_
 			continue;
 		}
 
-		// Blacklist for URLs before they are processed
-		if (wget_hashmap_put_noalloc(known_urls, (p = wget_strmemdup(url->p, url->len)), NULL)) {
-			// the dup'ed url has already been freed when we come here
-			info_printf(_("URL '%.*s' not followed (already known)\n"), (int)url->len, url->p);
-			continue;
-		}
+		// Blacklist for URLs before they are processed
+		if (wget_hashmap_put_noalloc(known_urls, (p = wget_strmemdup(url->p, url->len)), NULL)) {
+			// the dup'ed url has already been freed when we come here
+			info_printf(_("URL '%.*s' not followed (already known)\n"), (int)url->len, url->p);
+			continue;
+		}
+
+		enqueued += add_url_impl(job, encoding, p, 0);
+	}
+	wget_thread_cond_signal_n(&worker_cond, enqueued);
+	wget_thread_mutex_unlock(&downloader_mutex);
+	wget_thread_mutex_unlock(&known_urls_mutex);
+}
+
+// Per-feed cursor store: remember the newest entry timestamp of each feed,
+// so a re-polled feed is only scanned down to the first already-seen entry.
+// With --feed-cursors the cursors survive across invocations.
+
+static wget_hashmap_t
+	*feed_cursors;
+static wget_thread_mutex_t
+	feed_cursors_mutex = WGET_THREAD_MUTEX_INITIALIZER;
+
+// called with feed_cursors_mutex held
+static void feed_cursors_init(void)
+{
+	FILE *fp;
+
+	feed_cursors = wget_hashmap_create(64, (wget_hashmap_hash_t)hash_url, (wget_hashmap_compare_t)strcmp);
+
+	if (config.feed_cursors_file && (fp = fopen(config.feed_cursors_file, "r"))) {
+		char *buf = NULL;
+		size_t bufsize = 0;
+		ssize_t buflen;
+
+		while ((buflen = wget_getline(&buf, &bufsize, fp)) >= 0) {
+			long long t;
+			char uri[buflen + 1];
+
+			if (sscanf(buf, "%lld %s", &t, uri) == 2 && t > 0)
+				wget_hashmap_put_noalloc(feed_cursors, wget_strdup(uri), wget_memdup(&t, sizeof(t)));
+		}
+
+		xfree(buf);
+		fclose(fp);
+	}
+}
+
+static time_t feed_cursor_get(const char *uri)
+{
+	long long *tp, t = 0;
+
+	wget_thread_mutex_lock(&feed_cursors_mutex);
+	if (!feed_cursors)
+		feed_cursors_init();
+	if ((tp = wget_hashmap_get(feed_cursors, uri)))
+		t = *tp;
+	wget_thread_mutex_unlock(&feed_cursors_mutex);
+
+	return (time_t) t;
+}
+
+static void feed_cursor_set(const char *uri, time_t t)
+{
+	long long tll = t;
+
+	wget_thread_mutex_lock(&feed_cursors_mutex);
+	if (!feed_cursors)
+		feed_cursors_init();
+	wget_hashmap_put_noalloc(feed_cursors, wget_strdup(uri), wget_memdup(&tll, sizeof(tll)));
+	wget_thread_mutex_unlock(&feed_cursors_mutex);
+}
+
+static int _feed_cursor_save(void *ctx, const void *key, void *value)
+{
+	fprintf((FILE *)ctx, "%lld %s\n", *(long long *)value, (const char *)key);
+
+	return 0;
+}
+
+// called from main() after the downloaders and parse workers are done
+static void feed_cursors_free(void)
+{
+	if (feed_cursors && config.feed_cursors_file) {
+		FILE *fp;
 
-		add_url(job, encoding, p, 0);
+		if ((fp = fopen(config.feed_cursors_file, "w"))) {
+			wget_hashmap_browse(feed_cursors, _feed_cursor_save, fp);
+			fclose(fp);
+		} else
+			error_printf(_("Failed to write feed cursors to '%s'\n"), config.feed_cursors_file);
 	}
-	wget_thread_mutex_unlock(&known_urls_mutex);
+
+	wget_hashmap_free(&feed_cursors);
 }
 
 void atom_parse(JOB *job, const char *data, const char *encoding, wget_iri_t *base)
 {
 	wget_vector_t *urls;
+	const char *feed_uri = job && job->iri ? job->iri->uri : NULL;
+	time_t since = feed_uri ? feed_cursor_get(feed_uri) : 0;
+	time_t newest = 0;
 
-	wget_atom_get_urls_inline(data, &urls);
+	wget_atom_get_urls_inline_since(data, &urls, since, &newest);
 	_add_urls(job, urls, encoding, base);
 	wget_vector_free(&urls);
 	// wget_atom_free_urls_inline(&res);
+
+	if (feed_uri && newest > since)
+		feed_cursor_set(feed_uri, newest);
 }
 
 void atom_parse_localfile(JOB *job, const char *fname, const char *encoding, wget_iri_t *base)
@@ -2422,11 +4208,17 @@ void atom_parse_localfile(JOB *job, const char *fname, const char *encoding, wge
 void rss_parse(JOB *job, const char *data, const char *encoding, wget_iri_t *base)
 {
 	wget_vector_t *urls;
+	const char *feed_uri = job && job->iri ? job->iri->uri : NULL;
+	time_t since = feed_uri ? feed_cursor_get(feed_uri) : 0;
+	time_t newest = 0;
 
-	wget_rss_get_urls_inline(data, &urls);
+	wget_rss_get_urls_inline_since(data, &urls, since, &newest);
 	_add_urls(job, urls, encoding, base);
 	wget_vector_free(&urls);
 	// wget_rss_free_urls_inline(&res);
+
+	if (feed_uri && newest > since)
+		feed_cursor_set(feed_uri, newest);
 }
 
 void rss_parse_localfile(JOB *job, const char *fname, const char *encoding, wget_iri_t *base)
@@ -2487,6 +4279,8 @@ struct css_context {
 		*encoding;
 	wget_buffer_t
 		uri_buf;
+	int
+		enqueued; // number of jobs added within one batch (downloader_mutex held)
 	char
 		encoding_allocated;
 };
@@ -2514,7 +4308,7 @@ static void _css_parse_uri(void *context, const char *url, size_t len, size_t po
 	if (!ctx->base && !ctx->uri_buf.length)
 		info_printf(_("URL '%.*s' not followed (missing base URI)\n"), (int)len, url);
 	else
-		add_url(ctx->job, ctx->encoding, ctx->uri_buf.data, 0);
+		ctx->enqueued += add_url_impl(ctx->job, ctx->encoding, ctx->uri_buf.data, URL_FLG_REQUISITE);
 }
 
 void css_parse(JOB *job, const char *data, size_t len, const char *encoding, wget_iri_t *base)
@@ -2528,7 +4322,11 @@ void css_parse(JOB *job, const char *data, size_t len, const char *encoding, wge
 	if (encoding)
 		info_printf(_("URI content encoding = '%s'\n"), encoding);
 
+	// batch enqueue: take the lock once for the whole stylesheet
+	wget_thread_mutex_lock(&downloader_mutex);
 	wget_css_parse_buffer(data, len, _css_parse_uri, _css_parse_encoding, &context);
+	wget_thread_cond_signal_n(&worker_cond, context.enqueued);
+	wget_thread_mutex_unlock(&downloader_mutex);
 
 	if (context.encoding_allocated)
 		xfree(context.encoding);
@@ -2547,7 +4345,11 @@ void css_parse_localfile(JOB *job, const char *fname, const char *encoding, wget
 	if (encoding)
 		info_printf(_("URI content encoding = '%s'\n"), encoding);
 
+	// batch enqueue: take the lock once for the whole stylesheet
+	wget_thread_mutex_lock(&downloader_mutex);
 	wget_css_parse_file(fname, _css_parse_uri, _css_parse_encoding, &context);
+	wget_thread_cond_signal_n(&worker_cond, context.enqueued);
+	wget_thread_mutex_unlock(&downloader_mutex);
 
 	if (context.encoding_allocated)
 		xfree(context.encoding);
@@ -2603,6 +4405,69 @@ static int _wa_open(const char *fname, int flags, mode_t mode) {
 	return fd;
 }
 
+// one readdir instead of a stat per suffix: the highest numeric suffix
+// of 'fname' that already exists in its directory
+static size_t _scan_max_suffix(const char *fname)
+{
+	const char *sep = strrchr(fname, '/');
+	const char *base = sep ? sep + 1 : fname;
+	char *dirname = sep ? wget_strmemdup(fname, sep - fname) : wget_strdup(".");
+	size_t base_len = strlen(base), max = 0;
+	DIR *dir;
+
+	if ((dir = opendir(*dirname ? dirname : "/"))) {
+		struct dirent *entry;
+
+		while ((entry = readdir(dir))) {
+			char *end;
+			unsigned long n;
+
+			if (strncmp(entry->d_name, base, base_len) || entry->d_name[base_len] != '.')
+				continue;
+
+			n = strtoul(entry->d_name + base_len + 1, &end, 10);
+			if (end != entry->d_name + base_len + 1 && !*end && n > max)
+				max = n;
+		}
+		closedir(dir);
+	}
+
+	xfree(dirname);
+	return max;
+}
+
+// the first suffix worth probing for 'fname', seeded by one directory scan
+static size_t _next_unique_suffix(const char *fname)
+{
+	void *value;
+	size_t next;
+
+	wget_thread_mutex_lock(&unique_suffixes_mutex);
+
+	if (!unique_suffixes) {
+		unique_suffixes = wget_stringmap_create(128);
+		wget_stringmap_set_value_destructor(unique_suffixes, NULL); // values are counters, not pointers
+	}
+
+	if (wget_stringmap_get_null(unique_suffixes, fname, &value))
+		next = (size_t) (uintptr_t) value;
+	else {
+		next = _scan_max_suffix(fname) + 1;
+		wget_stringmap_put_noalloc(unique_suffixes, wget_strdup(fname), (void *) (uintptr_t) next);
+	}
+
+	wget_thread_mutex_unlock(&unique_suffixes_mutex);
+
+	return next;
+}
+
+static void _update_unique_suffix(const char *fname, size_t next)
+{
+	wget_thread_mutex_lock(&unique_suffixes_mutex);
+	wget_stringmap_put_noalloc(unique_suffixes, wget_strdup(fname), (void *) (uintptr_t) next);
+	wget_thread_mutex_unlock(&unique_suffixes_mutex);
+}
+
 // Opens files uniquely
 static int _open_unique(const char *fname, int flags, mode_t mode, int multiple, char *unique, size_t unique_len)
 {
@@ -2623,18 +4488,38 @@ static int _open_unique(const char *fname, int flags, mode_t mode, int multiple,
 		for (n_digits = unique_len - fname_len - 2, lim = 1; n_digits; n_digits--, lim *= 10)
 			;
 
-		for (i = 1; i < lim && fd < 0 && ((multiple && errno == EEXIST) || errno == EISDIR); i++) {
+		i = ((multiple && errno == EEXIST) || errno == EISDIR) ? _next_unique_suffix(fname) : 1;
+
+		for (; i < lim && fd < 0 && ((multiple && errno == EEXIST) || errno == EISDIR); i++) {
 			snprintf(unique, unique_len, "%s.%zu", fname, i);
 			fd = _wa_open(unique, flags, mode);
 		}
 
+		if (fd >= 0 && unique[0])
+			_update_unique_suffix(fname, i); // i is one past the suffix just taken
+
 		return fd;
 	}
 }
 
+// reserve disk space for [offset, offset+length) so large files grow in
+// contiguous extents instead of write by write; best effort, a filesystem
+// without support just keeps growing the file on demand
+static void _preallocate(int fd, long long offset, long long length)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int rc;
+
+	if (length > 0 && (rc = posix_fallocate(fd, (off_t) offset, (off_t) length)) != 0)
+		debug_printf("Failed to preallocate %lld bytes at %lld (errno=%d)\n", length, offset, rc);
+#else
+	(void) fd; (void) offset; (void) length;
+#endif
+}
+
 static int G_GNUC_WGET_NONNULL((1)) _prepare_file(wget_http_response_t *resp, const char *fname, int flag,
-		const char *uri, const char *original_url, int ignore_patterns, wget_buffer_t *partial_content,
-		size_t max_partial_content)
+		int ignore_patterns, wget_buffer_t *partial_content,
+		size_t max_partial_content, char **actual_fname)
 {
 	static wget_thread_mutex_t
 		savefile_mutex = WGET_THREAD_MUTEX_INITIALIZER;
@@ -2812,10 +4697,20 @@ static int G_GNUC_WGET_NONNULL((1)) _prepare_file(wget_http_response_t *resp, co
 			multiple, unique, fname_length + 1);
 	// debug_printf("1 fd=%d flag=%02x (%02x %02x %02x) errno=%d %s\n",fd,flag,O_EXCL,O_TRUNC,O_APPEND,errno,fname);
 
+	if (fd == -1 && errno == ENOENT) {
+		// the directory chain was memoized as created but has been removed
+		// meanwhile - drop the stale entries, recreate and retry once
+		mkdir_path_forget((char *) fname);
+		mkdir_path((char *) fname);
+		fd = _open_unique(fname, O_WRONLY | flag | O_CREAT | O_NONBLOCK | O_BINARY, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH,
+				multiple, unique, fname_length + 1);
+	}
+
 	if (fd >= 0) {
 		ssize_t rc;
 
 		info_printf(_("Saving '%s'\n"), unique[0] ? unique : fname);
+		metrics_add(METRICS_FILES_SAVED, 1);
 
 		if (config.save_headers) {
 			if ((rc = write(fd, resp->header->data, resp->header->length)) != (ssize_t)resp->header->length) {
@@ -2823,6 +4718,11 @@ static int G_GNUC_WGET_NONNULL((1)) _prepare_file(wget_http_response_t *resp, co
 				set_exit_status(WG_EXIT_STATUS_IO);
 			}
 		}
+
+		// the announced size is known, reserve it in one go
+		if (resp->content_length_valid && flag != O_APPEND)
+			_preallocate(fd, 0,
+				(config.save_headers ? (long long) resp->header->length : 0) + resp->content_length);
 	} else {
 		if (fd == -1) {
 			if (errno == EEXIST)
@@ -2836,17 +4736,8 @@ static int G_GNUC_WGET_NONNULL((1)) _prepare_file(wget_http_response_t *resp, co
 		}
 	}
 
-	if (config.xattr) {
-		FILE *fp;
-		fname = unique[0] ? unique : fname;
-		if ((fp = fopen(fname, "ab"))) {
-			set_file_metadata(uri, original_url, resp->content_type, resp->content_type_encoding, fp);
-			fclose(fp);
-		} else {
-			error_printf(_("Failed to save extended attribute %s\n"), fname);
-			set_exit_status(WG_EXIT_STATUS_IO);
-		}
-	}
+	if (fd >= 0 && actual_fname)
+		*actual_fname = wget_strdup(unique[0] ? unique : fname); // the name really opened, for dedup
 
 	wget_thread_mutex_unlock(&savefile_mutex);
 
@@ -2858,12 +4749,59 @@ static int G_GNUC_WGET_NONNULL((1)) _prepare_file(wget_http_response_t *resp, co
 struct _body_callback_context {
 	JOB *job;
 	wget_buffer_t *body;
+	wget_html_stream_t *html_stream; // incremental link extraction, fed from _get_body
 	uint64_t max_memory;
 	uint64_t length;
 	int outfd;
 	int progress_slot;
+	char *map; // destination file mapping, only set with --mmap-output
+	long long map_size; // announced Content-Length, the mapping covers exactly this
+	long long map_synced; // bytes already scheduled for writeback
+	char *dedup_fname; // file name really saved to, only set with --dedup-content
+	char *pack_fname; // file name to pack instead of saving, only set with --pack-output
+	warc_stream_t *warc; // open archive record, fed from _get_raw_body
+	replay_stream_t *replay; // open --record-file record, fed from _get_raw_body
+	wget_metalink_stream_t *metalink_stream; // incremental .meta4 parse, fed from _get_body
+	char html_stream_decided; // streaming parse decision has been made (first body chunk)
+	char discard_body; // saved to disk and never re-read - don't keep an in-memory copy
 };
 
+// bodies up to this size go into packed segments with --pack-output,
+// anything larger is saved as a plain file
+#define PACK_MAX_FILESIZE 65536
+
+// --mmap-output only pays off for large files, smaller ones take the write() path
+#define MMAP_OUT_MIN_SIZE (1 << 20)
+// completed mapping windows are scheduled for writeback and dropped from RSS
+#define MMAP_OUT_SYNC_WINDOW (8 << 20)
+
+// check whether this response can be appended to a packed segment instead of
+// getting its own file: only complete plain downloads of known small size
+// qualify, everything resumed, ranged or specially routed takes the file path
+static bool pack_eligible(struct _body_callback_context *ctx, wget_http_response_t *resp, const char *fname)
+{
+	if (!config.pack_output || !fname)
+		return false;
+
+	if (resp->code != 200 || !resp->content_length_valid || resp->content_length > PACK_MAX_FILESIZE)
+		return false;
+
+	if (config.spider || config.delete_after || config.dont_write
+		|| config.output_document || config.continue_download || config.save_headers)
+		return false;
+
+	if (!ctx->job->ignore_patterns) {
+		if ((config.accept_patterns && !in_pattern_list(config.accept_patterns, fname))
+			|| (config.accept_regex && !regex_match(fname, config.accept_regex)))
+			return false;
+		if ((config.reject_patterns && in_pattern_list(config.reject_patterns, fname))
+			|| (config.reject_regex && regex_match(fname, config.reject_regex)))
+			return false;
+	}
+
+	return true;
+}
+
 static int _get_header(wget_http_response_t *resp, void *context)
 {
 	struct _body_callback_context *ctx = (struct _body_callback_context *)context;
@@ -2874,20 +4812,51 @@ static int _get_header(wget_http_response_t *resp, void *context)
 	char *fname_allocated = NULL;
 #endif
 
+	trace_stamp(ctx->job->trace, TRACE_FIRST_BYTE);
+
+	// open the archive record before anything can cancel the transfer, so
+	// redirects and error responses are captured too
+	if (config.warc_file && resp->header)
+		ctx->warc = warc_record_begin(ctx->progress_slot, ctx->job->iri->uri,
+			resp->header->data, resp->header->length);
+
 	bool metalink = resp->content_type
 	    && (!wget_strcasecmp_ascii(resp->content_type, "application/metalink4+xml") ||
 		!wget_strcasecmp_ascii(resp->content_type, "application/metalink+xml"));
 
+	// fast redirect path: the body of a redirect is of no use to us, so skip
+	// its transfer. On HTTP/2 only the stream is canceled (RST_STREAM) and the
+	// connection stays usable; on HTTP/1.1 aborting costs the connection, so
+	// it only pays off when draining would be more expensive than reconnecting.
+	if (resp->code / 100 == 3 && resp->location
+		&& !(resp->code == 302 && resp->links && resp->digests) // Metalink redirect, still processed
+		&& (resp->major >= 2 || (resp->content_length_valid && resp->content_length > 65536)))
+		return 1;
+
+	// parse a metalink description as it arrives - for descriptions with
+	// 100k+ pieces the piece table is ready when the body completes
+	if (config.metalink && metalink && !ctx->job->head_first && resp->code == 200)
+		ctx->metalink_stream = wget_metalink_stream_init();
+
 	if (ctx->job->head_first || (config.metalink && metalink)) {
 		name = ctx->job->local_filename;
 	} else if ((part = ctx->job->part)) {
 		name = ctx->job->metalink->name;
+		if (resp->code != 206) {
+			// server ignored our Range header - writing a full body at the
+			// part's offset would corrupt the file
+			ret = -1;
+			goto out;
+		}
 		ctx->outfd = open(ctx->job->metalink->name, O_WRONLY | O_CREAT | O_NONBLOCK | O_BINARY, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 		if (ctx->outfd == -1) {
 			set_exit_status(WG_EXIT_STATUS_IO);
 			ret = -1;
 			goto out;
 		}
+		// allocate this part's own range up front - the positioned writes
+		// then fill contiguous blocks instead of seeking into a hole
+		_preallocate(ctx->outfd, part->position, part->length);
 		if (lseek(ctx->outfd, part->position, SEEK_SET) == (off_t) -1) {
 			close(ctx->outfd);
 			set_exit_status(WG_EXIT_STATUS_IO);
@@ -2907,19 +4876,83 @@ static int _get_header(wget_http_response_t *resp, void *context)
 	} else
 		name = dest = config.output_document ? config.output_document : ctx->job->local_filename;
 
-	if (dest && (resp->code == 200 || resp->code == 206 || config.content_on_error)) {
+	if (dest && pack_eligible(ctx, resp, dest)) {
+		// body stays in ctx->body and is appended to a packed segment on completion
+		ctx->pack_fname = wget_strdup(dest);
+	} else if (dest && (resp->code == 200 || resp->code == 206 || config.content_on_error)) {
 		ctx->outfd = _prepare_file(resp, dest,
 			resp->code == 206 ? O_APPEND : O_TRUNC,
-			ctx->job->iri->uri,
-			ctx->job->original_url->uri,
 			ctx->job->ignore_patterns,
 			resp->code == 206 ? ctx->body : NULL,
-			ctx->max_memory);
+			ctx->max_memory,
+			// dedup only complete plain downloads, never resumed or appended files
+			config.dedup_content && resp->code == 200 && !config.output_document
+				? &ctx->dedup_fname : NULL);
 		if (ctx->outfd == -1)
 			ret = -1;
 	}
 //	info_printf("Opened %d\n", ctx->outfd);
 
+#ifdef HAVE_MMAP
+	// --mmap-output: a complete plain download of known large size is received
+	// into a mapping of the preallocated destination file - _get_body copies
+	// each chunk in place and there is no write() per chunk at all. Writeback
+	// is scheduled window-wise, so dirty pages don't pile up behind a 10 Gbps
+	// link.
+	if (config.mmap_output && ctx->outfd != -1 && resp->code == 200
+	    && resp->content_length_valid && resp->content_length >= MMAP_OUT_MIN_SIZE
+	    && !config.write_behind
+	    && !metalink && !ctx->job->part && !ctx->job->robotstxt && !ctx->job->sitemap)
+	{
+		_preallocate(ctx->outfd, 0, (long long) resp->content_length);
+
+		if (ftruncate(ctx->outfd, (off_t) resp->content_length) == 0) {
+			char *map = mmap(NULL, resp->content_length, PROT_WRITE, MAP_SHARED, ctx->outfd, 0);
+
+			if (map != MAP_FAILED) {
+				ctx->map = map;
+				ctx->map_size = (long long) resp->content_length;
+			} else
+				debug_printf("Failed to map output file (errno=%d), falling back to write()\n", errno);
+		}
+	}
+#endif
+
+	// plain file download where the in-memory body copy isn't needed afterwards:
+	// let libwget splice the payload directly into the file (zero-copy on Linux).
+	// Excluded are cases where the body gets parsed (recursion, robots, sitemaps,
+	// metalink) or where _get_body feeds side channels (progress bar, chunk validation).
+	if (!ctx->map && ctx->outfd != -1 && resp->code == 200
+	    && !config.progress && !config.recursive && !config.page_requisites
+	    && !config.write_behind // splicing would write synchronously again
+	    && !metalink && !ctx->job->part && !ctx->job->robotstxt && !ctx->job->sitemap)
+	{
+		resp->req->body_sink_fd = ctx->outfd;
+	}
+
+	// The in-memory body copy is only needed when something re-reads the
+	// complete document afterwards: link extraction, robots/sitemap/metalink
+	// parsing, chunk validation, packed output or a resumed download.
+	// Everything else streams to disk - dropping the copy caps deep-crawl RSS
+	// at the write buffers instead of up to 10 MiB per parallel download.
+	if (ctx->outfd != -1 && resp->code == 200
+	    && !config.recursive && !config.page_requisites
+	    && !metalink && !ctx->job->part && !ctx->job->robotstxt && !ctx->job->sitemap)
+	{
+		ctx->discard_body = 1;
+	}
+
+	// body is kept in memory and the announced size is known - reserve the
+	// allocation once up front instead of realloc-copying on the way to it
+	if (!ctx->discard_body && resp->content_length_valid && resp->content_length > ctx->body->size) {
+		uint64_t need = resp->content_length;
+
+		if (ctx->max_memory && need > ctx->max_memory)
+			need = ctx->max_memory;
+
+		wget_buffer_ensure_capacity(ctx->body, (size_t) need);
+	}
+
 #ifdef _WIN32
 	xfree(fname_allocated);
 #endif
@@ -2927,6 +4960,7 @@ static int _get_header(wget_http_response_t *resp, void *context)
 out:
 	if (config.progress)
 		bar_slot_begin(ctx->progress_slot, name, resp->content_length);
+	telemetry_job_expected(ctx->progress_slot, resp->content_length);
 
 	return ret;
 }
@@ -2941,36 +4975,132 @@ static int _get_body(wget_http_response_t *resp, void *context, const char *data
 			info_printf("# got header %zu bytes:\n%s\n", resp->header->length, resp->header->data);
 	}
 
+	// decoded-position plugin filters see the chunk before it is written
+	// anywhere; a cancel verdict also keeps it off the disk
+	if (plugin_db_has_body_filter(WGET_PLUGIN_BODY_DECODED)
+		&& plugin_db_forward_body(ctx->job->iri, WGET_PLUGIN_BODY_DECODED, data, length))
+		return -1;
+
 	ctx->length += length;
 
+	if (ctx->metalink_stream)
+		wget_metalink_stream_feed(ctx->metalink_stream, data, length);
+
+#ifdef HAVE_MMAP
+	if (ctx->map) {
+		long long pos = (long long) (ctx->length - length);
+
+		if (pos + (long long) length <= ctx->map_size) {
+			long long done;
+
+			memcpy(ctx->map + pos, data, length);
+
+			// hand completed windows to the kernel and drop them from RSS,
+			// [map_synced, done) is page-aligned by construction
+			done = (long long) ctx->length & ~((long long) sysconf(_SC_PAGESIZE) - 1);
+			if (done - ctx->map_synced >= MMAP_OUT_SYNC_WINDOW) {
+				msync(ctx->map + ctx->map_synced, done - ctx->map_synced, MS_ASYNC);
+				madvise(ctx->map + ctx->map_synced, done - ctx->map_synced, MADV_DONTNEED);
+				ctx->map_synced = done;
+			}
+
+			goto mapped;
+		}
+
+		// the server sent more than it announced - back to the write() path
+		munmap(ctx->map, ctx->map_size);
+		ctx->map = NULL;
+		if (lseek(ctx->outfd, pos, SEEK_SET) == (off_t) -1) {
+			set_exit_status(WG_EXIT_STATUS_IO);
+			return -1;
+		}
+	}
+#endif
+
 	if (ctx->outfd >= 0) {
-		size_t written = safe_write(ctx->outfd, data, length);
+		if (config.write_behind && !ctx->job->part) {
+			// hand the chunk to a writer thread so a slow disk doesn't stall
+			// the read loop; errors surface at the writer_drain() before close
+			writer_enqueue(ctx->outfd, data, length);
+		} else {
+			size_t written = safe_write(ctx->outfd, data, length);
 
-		if (written == SAFE_WRITE_ERROR) {
+			if (written == SAFE_WRITE_ERROR) {
 #if EAGAIN != EWOULDBLOCK
-			if ((errno == EAGAIN || errno == EWOULDBLOCK) && !terminate) {
+				if ((errno == EAGAIN || errno == EWOULDBLOCK) && !terminate) {
 #else
-			if (errno == EAGAIN && !terminate) {
+				if (errno == EAGAIN && !terminate) {
 #endif
-				if (wget_ready_2_write(ctx->outfd, 1000) > 0) {
-					written = safe_write(ctx->outfd, data, length);
+					if (wget_ready_2_write(ctx->outfd, 1000) > 0) {
+						written = safe_write(ctx->outfd, data, length);
+					}
 				}
 			}
-		}
 
-		if (written == SAFE_WRITE_ERROR) {
-			if (!terminate)
-				debug_printf(_("Failed to write errno=%d\n"), errno);
-			set_exit_status(WG_EXIT_STATUS_IO);
-			return -1;
+			if (written == SAFE_WRITE_ERROR) {
+				if (!terminate)
+					debug_printf(_("Failed to write errno=%d\n"), errno);
+				set_exit_status(WG_EXIT_STATUS_IO);
+				return -1;
+			}
 		}
 	}
 
-	if (ctx->max_memory == 0 || ctx->length < ctx->max_memory)
+#ifdef HAVE_MMAP
+mapped:
+#endif
+	if (!ctx->discard_body && (ctx->max_memory == 0 || ctx->length < ctx->max_memory))
 		wget_buffer_memcat(ctx->body, data, length); // append new data to body
+	else if (ctx->html_stream)
+		wget_html_stream_close(&ctx->html_stream, NULL); // body truncated, the streamed offsets would be wrong
+
+	if (!ctx->html_stream_decided) {
+		ctx->html_stream_decided = 1;
+
+		// parse-as-you-go only pays off for documents we will scan for links later,
+		// and only if the raw bytes equal what html_parse() would see
+		// (no UTF-16/BOM re-encoding), see the streamed result use in html_parse()
+		const char *enc = resp->content_type_encoding ? resp->content_type_encoding : config.remote_encoding;
+
+		if (config.recursive && resp->code == 200
+			&& !ctx->job->part && !ctx->job->robotstxt && !ctx->job->sitemap && !ctx->job->head_first
+			&& resp->content_type
+			&& (!wget_strcasecmp_ascii(resp->content_type, "text/html")
+				|| !wget_strcasecmp_ascii(resp->content_type, "application/xhtml+xml"))
+			&& wget_strncasecmp_ascii(enc, "UTF-16", 6)
+			&& length >= 4
+			&& memcmp(data, "\xEF\xBB\xBF", 3)
+			&& (unsigned char) *data != 0xFE && (unsigned char) *data != 0xFF)
+		{
+			ctx->html_stream = wget_html_stream_init(config.follow_tags, config.ignore_tags);
+		}
+	}
+
+	if (ctx->html_stream)
+		wget_html_stream_feed(ctx->html_stream, data, length);
 
 	if (config.progress)
 		bar_set_downloaded(ctx->progress_slot, resp->cur_downloaded);
+	telemetry_job_downloaded(ctx->progress_slot, resp->cur_downloaded);
+
+	return 0;
+}
+
+// raw-position plugin filters see the wire bytes, before any
+// Content-Encoding is undone. Only registered when a plugin asked for it.
+static int _get_raw_body(wget_http_response_t *resp G_GNUC_WGET_UNUSED, void *context, const char *data, size_t length)
+{
+	struct _body_callback_context *ctx = (struct _body_callback_context *)context;
+
+	if (ctx->warc)
+		warc_record_append(ctx->warc, data, length);
+
+	if (ctx->replay)
+		replay_record_append(ctx->replay, data, length);
+
+	if (plugin_db_has_body_filter(WGET_PLUGIN_BODY_RAW)
+		&& plugin_db_forward_body(ctx->job->iri, WGET_PLUGIN_BODY_RAW, data, length))
+		return -1;
 
 	return 0;
 }
@@ -3001,17 +5131,8 @@ static void _add_authorize_header(
 	if (selected_challenge) {
 		if (username) {
 			wget_http_add_credentials(req, selected_challenge, username, password, proxied);
-		} else if (config.netrc_file) {
-			static wget_thread_mutex_t
-				mutex = WGET_THREAD_MUTEX_INITIALIZER;
-
-			wget_thread_mutex_lock(&mutex);
-			if (!config.netrc_db) {
-				config.netrc_db = wget_netrc_db_init(NULL);
-				wget_netrc_db_load(config.netrc_db, config.netrc_file);
-			}
-			wget_thread_mutex_unlock(&mutex);
-
+		} else if (config.netrc_db) {
+			// the db parses its file on the first lookup (wget_netrc_db_lazy_load())
 			wget_netrc_t *netrc = wget_netrc_get(config.netrc_db, req->esc_host.data);
 			if (!netrc)
 				netrc = wget_netrc_get(config.netrc_db, "default");
@@ -3048,6 +5169,13 @@ static wget_http_request_t *http_create_request(wget_iri_t *iri, JOB *job)
 	if (!(req = wget_http_create_request(iri, method)))
 		return req;
 
+	// translate the job's scheduling class into a HTTP/2 stream weight, so
+	// crawl-unblocking resources win server-side frame interleaving too
+	if (job->priority == JOB_PRIORITY_METADATA)
+		wget_http_request_set_int(req, WGET_HTTP_STREAM_PRIORITY, 256);
+	else if (job->priority == JOB_PRIORITY_INLINE)
+		wget_http_request_set_int(req, WGET_HTTP_STREAM_PRIORITY, 64);
+
 	if (config.continue_download || config.timestamping) {
 		const char *local_filename = config.output_document ? config.output_document : job->local_filename;
 
@@ -3070,6 +5198,34 @@ static wget_http_request_t *http_create_request(wget_iri_t *iri, JOB *job)
 
 	}
 
+	// make the request conditional with the validators remembered from an earlier run,
+	// but only if the local file still exists - else a 304 would leave us empty-handed
+	if (config.etags && !job->head_first && !job->part && !config.continue_download
+		&& !config.post_data && !config.post_file)
+	{
+		const char *local_filename = config.output_document ? config.output_document : job->local_filename;
+
+		if (local_filename && get_file_mtime(local_filename)) {
+			char *etag;
+			int64_t last_modified;
+
+			config_load_db(CONFIG_DB_ETAGS);
+
+			if (wget_etag_db_get(config.etag_db, iri->uri, &etag, &last_modified)) {
+				if (etag) {
+					wget_http_add_header(req, "If-None-Match", etag);
+					xfree(etag);
+				}
+				if (last_modified && !config.timestamping) {
+					char http_date[32];
+
+					wget_http_print_date((time_t) last_modified, http_date, sizeof(http_date));
+					wget_http_add_header(req, "If-Modified-Since", http_date);
+				}
+			}
+		}
+	}
+
 	// 20.06.2012: www.google.de only sends gzip responses with one of the
 	// following header lines in the request.
 	// User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:10.0.5) Gecko/20100101 Firefox/10.0.5 Iceweasel/10.0.5
@@ -3085,41 +5241,45 @@ static wget_http_request_t *http_create_request(wget_iri_t *iri, JOB *job)
 	"Accept-Language: en-us,en;q=0.5\r\n");
 	 */
 
-	wget_buffer_reset(&buf);
+	// the supported content encodings are fixed at compile time, so the
+	// header value is too - no need to assemble it for every request
+	static const char accept_encoding[] =
 #ifdef WITH_ZLIB
-	wget_buffer_strcat(&buf, buf.length ? ", gzip, deflate" : "gzip, deflate");
+		"gzip, deflate, "
 #endif
 #ifdef WITH_BZIP2
-	wget_buffer_strcat(&buf, buf.length ? ", bzip2" : "bzip2");
+		"bzip2, "
 #endif
 #ifdef WITH_LZMA
-	wget_buffer_strcat(&buf, buf.length ? ", xz, lzma" : "xz, lzma");
+		"xz, lzma, "
 #endif
 #ifdef WITH_BROTLIDEC
-	wget_buffer_strcat(&buf, buf.length ? ", br" : "br");
+		"br, "
+#endif
+#ifdef WITH_ZSTD
+		"zstd, "
 #endif
-	if (!buf.length)
-		wget_buffer_strcat(&buf, "identity");
+		"identity";
 
-	wget_http_add_header(req, "Accept-Encoding", buf.data);
+	wget_http_add_header_nocopy(req, "Accept-Encoding", accept_encoding);
 
-	wget_http_add_header(req, "Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
+	wget_http_add_header_nocopy(req, "Accept", "text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8");
 
 //	if (config.spider && !config.recursive)
 //		http_add_header_if_modified_since(time(NULL));
 //		http_add_header(req, "If-Modified-Since", "Wed, 29 Aug 2012 00:00:00 GMT");
 
 	if (config.user_agent)
-		wget_http_add_header(req, "User-Agent", config.user_agent);
+		wget_http_add_header_nocopy(req, "User-Agent", config.user_agent);
 
 	if (config.keep_alive)
-		wget_http_add_header(req, "Connection", "keep-alive");
+		wget_http_add_header_nocopy(req, "Connection", "keep-alive");
 
 	if (!config.cache)
-		wget_http_add_header(req, "Pragma", "no-cache");
+		wget_http_add_header_nocopy(req, "Pragma", "no-cache");
 
 	if (config.referer)
-		wget_http_add_header(req, "Referer", config.referer);
+		wget_http_add_header_nocopy(req, "Referer", config.referer);
 	else if (job->referer) {
 		wget_iri_t *referer = job->referer;
 
@@ -3148,6 +5308,8 @@ static wget_http_request_t *http_create_request(wget_iri_t *iri, JOB *job)
 	if (config.cookies) {
 		const char *cookie_string;
 
+		config_load_db(CONFIG_DB_COOKIES);
+
 		if ((cookie_string = wget_cookie_create_request_header(config.cookie_db, iri))) {
 			wget_http_add_header(req, "Cookie", cookie_string);
 			xfree(cookie_string);
@@ -3168,6 +5330,7 @@ static wget_http_request_t *http_create_request(wget_iri_t *iri, JOB *job)
 						wget_http_free_param(h);
 						h->name = wget_strdup(param->name);
 						h->value = wget_strdup(param->value);
+						h->is_static = 0;
 						replaced = 1;
 					}
 				}
@@ -3183,14 +5346,10 @@ static wget_http_request_t *http_create_request(wget_iri_t *iri, JOB *job)
 
 		wget_http_request_set_body(req, "application/x-www-form-urlencoded", wget_memdup(config.post_data, length), length);
 	} else if (config.post_file) {
-		size_t length;
-		char *data;
-
-		if ((data = wget_read_file(config.post_file, &length))) {
-			wget_http_request_set_body(req, "application/x-www-form-urlencoded", data, length);
-		} else {
+		// streamed from the file at send time, the body never materializes
+		// in memory (zero-copy on plain connections)
+		if (wget_http_request_set_body_file(req, "application/x-www-form-urlencoded", config.post_file) != 0)
 			wget_http_free_request(&req);
-		}
 	}
 
 	wget_buffer_deinit(&buf);
@@ -3233,28 +5392,155 @@ int http_send_request(wget_iri_t *iri, wget_iri_t *original_url, DOWNLOADER *dow
 		return rc;
 	}
 
+	metrics_add(METRICS_HTTP_REQUESTS, 1);
+
 	struct _body_callback_context *context = wget_calloc(1, sizeof(struct _body_callback_context));
 
 	context->job = downloader->job;
 	context->max_memory = downloader->job->part ? 0 : ((uint64_t) 10) * (1 << 20);
 	context->outfd = -1;
-	context->body = wget_buffer_alloc(102400);
+	context->body = wget_buffer_acquire(102400); // recycled through the thread's buffer pool on response free
 	context->length = 0;
 	context->progress_slot = downloader->id;
 	context->job->original_url = original_url;
 
+	if (config.record_file)
+		context->replay = replay_record_begin(iri->uri);
+
 	// set callback functions
 	wget_http_request_set_header_cb(req, _get_header, context);
 	wget_http_request_set_body_cb(req, _get_body, context);
+	if (config.warc_file || config.record_file || plugin_db_has_body_filter(WGET_PLUGIN_BODY_RAW))
+		wget_http_request_set_raw_body_cb(req, _get_raw_body, context);
 
 	// keep the received response header in 'resp->header'
-	wget_http_request_set_int(req, WGET_HTTP_RESPONSE_KEEPHEADER, config.save_headers || config.server_response);
+	wget_http_request_set_int(req, WGET_HTTP_RESPONSE_KEEPHEADER,
+		config.save_headers || config.server_response || !!config.warc_file || !!config.record_file);
 
 	return WGET_E_SUCCESS;
 }
 
+// Decide about an HTTP/2 server push (called from within libwget while a
+// response batch is being received). A pushed resource rides the existing
+// connection for free, but it bypasses the job queue - so it must pass the
+// same filters a discovered URL would, with the blacklist as the final word
+// on whether the resource is still wanted. An accepted push gets a job of
+// its own that never enters a host queue; the downloader loop disposes of
+// it right after the pushed response has been processed.
+static wget_http_request_t *_accept_server_push(wget_http_connection_t *conn, const char *uri, wget_http_request_t *parent_req)
+{
+	JOB *parent_job = parent_req ? parent_req->user_data : NULL;
+	wget_iri_t *iri;
+	HOST *host;
+
+	if (!parent_job || !parent_job->downloader)
+		return NULL;
+
+	// POST bodies and HEAD-first probing (spider, chunked downloads) have
+	// no equivalent on a pushed stream
+	if (config.spider || config.chunk_size || config.post_data || config.post_file)
+		return NULL;
+
+	if (!(iri = wget_iri_parse(uri, NULL)))
+		return NULL;
+
+	// only same-origin pushes are trusted - the server must be
+	// authoritative for what it pushes (RFC 7540 8.2)
+	if (wget_strcmp(iri->host, wget_http_get_host(conn))
+		|| (iri->scheme != WGET_IRI_SCHEME_HTTP && iri->scheme != WGET_IRI_SCHEME_HTTPS)
+		|| (config.https_only && iri->scheme != WGET_IRI_SCHEME_HTTPS))
+	{
+		debug_printf("push '%s' rejected (not same-origin)\n", uri);
+		wget_iri_free(&iri);
+		return NULL;
+	}
+
+	// a push can't fall back to a HEAD-first mime check, so anything the
+	// patterns don't clearly accept is left to the normal crawl
+	if (config.recursive) {
+		if ((config.accept_patterns && !in_pattern_list(config.accept_patterns, iri->uri))
+			|| (config.accept_regex && !regex_match(iri->uri, config.accept_regex))
+			|| (config.reject_patterns && in_pattern_list(config.reject_patterns, iri->uri))
+			|| (config.reject_regex && regex_match(iri->uri, config.reject_regex)))
+		{
+			debug_printf("push '%s' rejected (accept/reject patterns)\n", uri);
+			wget_iri_free(&iri);
+			return NULL;
+		}
+	}
+
+	if (!(host = host_get(iri))) {
+		wget_iri_free(&iri);
+		return NULL;
+	}
+
+	if (host->robots && iri->path && host_robots_disallowed(host, iri->path)) {
+		debug_printf("push '%s' rejected (disallowed by robots.txt)\n", uri);
+		wget_iri_free(&iri);
+		return NULL;
+	}
+
+	// final check: a blacklist hit means the resource was downloaded or is
+	// queued already - the new entry also keeps the later HTML parse from
+	// enqueueing what the push delivers right now
+	if (!blacklist_add(iri)) {
+		debug_printf("push '%s' rejected (known URL)\n", uri);
+		return NULL;
+	}
+
+	// no wget_iri_free() from here on, the blacklist owns the IRI
+
+	JOB *job = job_init(NULL, iri);
+
+	job->pushed = 1;
+	job->host = host;
+	job->downloader = parent_job->downloader;
+	job->level = parent_job->level + 1;
+	job->referer = parent_job->iri;
+	job->original_url = iri;
+	if (!config.output_document)
+		job->local_filename = get_local_filename(iri);
+
+	wget_http_request_t *req = http_create_request(iri, job);
+
+	if (!req) {
+		job_free(job);
+		job_recycle(&job);
+		return NULL;
+	}
+
+	wget_http_request_set_ptr(req, WGET_HTTP_USER_DATA, job);
+
+	struct _body_callback_context *parent_context = parent_req->body_user_data;
+	struct _body_callback_context *context = wget_calloc(1, sizeof(struct _body_callback_context));
+
+	context->job = job;
+	context->max_memory = ((uint64_t) 10) * (1 << 20);
+	context->outfd = -1;
+	context->body = wget_buffer_acquire(102400);
+	context->progress_slot = parent_context ? parent_context->progress_slot : 0;
+
+	if (config.record_file)
+		context->replay = replay_record_begin(iri->uri);
+
+	wget_http_request_set_header_cb(req, _get_header, context);
+	wget_http_request_set_body_cb(req, _get_body, context);
+	if (config.warc_file || config.record_file || plugin_db_has_body_filter(WGET_PLUGIN_BODY_RAW))
+		wget_http_request_set_raw_body_cb(req, _get_raw_body, context);
+
+	wget_http_request_set_int(req, WGET_HTTP_RESPONSE_KEEPHEADER,
+		config.save_headers || config.server_response || !!config.warc_file || !!config.record_file);
+
+	print_status(job->downloader, "[%d] Accepted push '%s' ...\n", job->downloader->id, iri->uri);
+
+	return req;
+}
+
 wget_http_response_t *http_receive_response(wget_http_connection_t *conn)
 {
+	if (!conn)
+		return NULL;
+
 	wget_http_response_t *resp = wget_http_get_response_cb(conn);
 
 	if (!resp)
@@ -3264,7 +5550,64 @@ wget_http_response_t *http_receive_response(wget_http_connection_t *conn)
 
 	resp->body = context->body;
 
+	// a parsed result left over from an earlier request of this job is stale by now
+	wget_html_free_urls_inline(&context->job->parsed_html);
+	if (context->html_stream)
+		context->job->parsed_html = wget_html_stream_close(&context->html_stream, resp->body->data);
+
+	if (context->metalink_stream) {
+		wget_metalink_t *metalink = wget_metalink_stream_close(&context->metalink_stream);
+
+		if (resp->code == 200 && !context->job->metalink)
+			context->job->metalink = metalink;
+		else
+			wget_metalink_free(&metalink);
+	}
+
+	if (context->pack_fname) {
+		// only complete bodies go into the pack - a truncated transfer gets retried
+		if (resp->code == 200 && context->body && context->body->length == context->length) {
+			if (pack_append(context->pack_fname, context->body->data, context->body->length) == 0) {
+				info_printf(_("Saving '%s' (packed)\n"), context->pack_fname);
+				metrics_add(METRICS_FILES_SAVED, 1);
+			} else
+				set_exit_status(WG_EXIT_STATUS_IO);
+		}
+	}
+
 	if (context->outfd >= 0) {
+#ifdef HAVE_MMAP
+		if (context->map) {
+			msync(context->map, context->map_size, MS_ASYNC);
+			munmap(context->map, context->map_size);
+			context->map = NULL;
+
+			// truncated transfer: cut the preallocation back to what arrived
+			if ((long long) context->length < context->map_size
+				&& ftruncate(context->outfd, (off_t) context->length) != 0)
+			{
+				error_printf(_("Failed to truncate '%s' (errno=%d)\n"), context->job->local_filename, errno);
+				set_exit_status(WG_EXIT_STATUS_IO);
+			}
+		}
+#endif
+
+		// the attributes ride the fd's writer queue with --write-behind,
+		// so they are covered by the drain below
+		if (config.xattr)
+			set_file_metadata(context->job->iri->uri,
+				context->job->original_url ? context->job->original_url->uri : NULL,
+				resp->content_type, resp->content_type_encoding, context->outfd);
+
+		// deferred writes must have hit the fd before hashing/mtime/fsync
+		if (config.write_behind && writer_drain(context->outfd) < 0)
+			set_exit_status(WG_EXIT_STATUS_IO);
+
+		// hardlink to an identical earlier download; a replaced file's old
+		// inode stays valid for the mtime/fsync handling below
+		if (context->dedup_fname && resp->code == 200)
+			dedup_register_file(context->outfd, context->dedup_fname);
+
 		if (resp->last_modified)
 			set_file_mtime(context->outfd, resp->last_modified);
 
@@ -3279,9 +5622,18 @@ wget_http_response_t *http_receive_response(wget_http_connection_t *conn)
 		context->outfd = -1;
 	}
 
+	warc_record_end(context->warc);
+
+	if (context->replay)
+		replay_record_end(&context->replay,
+			resp->header ? resp->header->data : NULL, resp->header ? resp->header->length : 0);
+
 	if (config.progress)
 		bar_slot_deregister(context->progress_slot);
+	telemetry_job_end(context->progress_slot);
 
+	xfree(context->dedup_fname);
+	xfree(context->pack_fname);
 	xfree(context);
 
 	return resp;
@@ -3289,30 +5641,43 @@ wget_http_response_t *http_receive_response(wget_http_connection_t *conn)
 
 #ifdef USE_XATTR
 
-static int write_xattr_metadata(const char *name, const char *value,
-								FILE *fname)
+// apply a packed list of name\0value\0 pairs against the open fd
+int xattr_apply_packed(int fd, const char *packed, size_t length)
 {
-	int retval = -1;
+	const char *end = packed + length;
+	int retval = 0;
+
+	while (packed < end) {
+		const char *name = packed;
+		const char *value = name + strlen(name) + 1;
 
-	if (name && value && fname) {
-		retval = fsetxattr(fileno (fname), name, value, strlen (value), 0);
 		/* FreeBSD's extattr_set_fd returns the length of the extended attribute. */
-		retval = (retval < 0) ? retval : 0;
-		if (retval)
+		if (fsetxattr(fd, name, value, strlen(value), 0) < 0) {
 			debug_printf("Failed to set xattr %s.\n", name);
+			retval = -1;
+		}
+
+		packed = value + strlen(value) + 1;
 	}
 
 	return retval;
 }
 
+static void _pack_xattr(wget_buffer_t *buf, const char *name, const char *value)
+{
+	if (value) {
+		wget_buffer_memcat(buf, name, strlen(name) + 1);
+		wget_buffer_memcat(buf, value, strlen(value) + 1);
+	}
+}
+
 #else /* USE_XATTR */
 
-static int write_xattr_metadata(const char *name, const char *value,
-								FILE *fname)
+int xattr_apply_packed(int fd, const char *packed, size_t length)
 {
-	(void)name;
-	(void)value;
-	(void)fname;
+	(void)fd;
+	(void)packed;
+	(void)length;
 
 	return 0;
 }
@@ -3320,7 +5685,7 @@ static int write_xattr_metadata(const char *name, const char *value,
 #endif /* USE_XATTR */
 
 int set_file_metadata(const char *origin_url, const char *referrer_url,
-					  const char *mime_type, const char *charset, FILE *fname)
+					  const char *mime_type, const char *charset, int fd)
 {
 	/* Save metadata about where the file came from (requested, final URLs) to
 	 * user POSIX Extended Attributes of retrieved file.
@@ -3329,15 +5694,38 @@ int set_file_metadata(const char *origin_url, const char *referrer_url,
 	 * [http://freedesktop.org/wiki/CommonExtendedAttributes] and
 	 * [http://0pointer.de/lennart/projects/mod_mime_xattr/].
 	 */
-	int retval = -1;
+#ifdef USE_XATTR
+	wget_buffer_t buf;
+	char sbuf[1024];
+	int retval;
+
+	if (!origin_url || fd < 0)
+		return -1;
 
-	if (!origin_url || !fname)
-		return retval;
+	// all attributes are packed once and submitted in one go
+	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
+	_pack_xattr(&buf, "user.xdg.origin.url", origin_url);
+	_pack_xattr(&buf, "user.xdg.referrer.url", referrer_url);
+	_pack_xattr(&buf, "user.mime_type", mime_type);
+	_pack_xattr(&buf, "user.charset", charset);
+
+	if (config.write_behind) {
+		// the fd's writer thread applies them in order, before writer_drain() returns
+		writer_enqueue_xattr(fd, buf.data, buf.length);
+		retval = 0;
+	} else
+		retval = xattr_apply_packed(fd, buf.data, buf.length);
 
-	write_xattr_metadata("user.xdg.origin.url", origin_url, fname);
-	write_xattr_metadata("user.xdg.referrer.url", referrer_url, fname);
-	write_xattr_metadata("user.mime_type", mime_type, fname);
-	retval = write_xattr_metadata("user.charset", charset, fname);
+	wget_buffer_deinit(&buf);
 
 	return retval;
+#else
+	(void)origin_url;
+	(void)referrer_url;
+	(void)mime_type;
+	(void)charset;
+	(void)fd;
+
+	return 0;
+#endif
 }
@@ -32,7 +32,10 @@
 
 int in_blacklist(wget_iri_t *iri) G_GNUC_WGET_NONNULL_ALL;
 int blacklist_size(void) G_GNUC_WGET_PURE;
+void blacklist_stats(long long *hits, long long *misses) G_GNUC_WGET_NONNULL_ALL;
 wget_iri_t *blacklist_add(wget_iri_t *iri);
+void blacklist_release(wget_iri_t **iri);
+int blacklist_browse(int (*browse)(void *ctx, const wget_iri_t *iri), void *ctx) G_GNUC_WGET_NONNULL((1));
 void blacklist_print(void);
 void blacklist_free(void);
 
@@ -0,0 +1,33 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for the compressed in-memory body cache
+ *
+ */
+
+#ifndef _WGET_BODYCACHE_H
+#define _WGET_BODYCACHE_H
+
+#include <stddef.h>
+
+void body_cache_put(const char *fname, const char *data, size_t length);
+char *body_cache_get(const char *fname, size_t *length);
+void body_cache_free(void);
+
+#endif /* _WGET_BODYCACHE_H */
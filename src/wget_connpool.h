@@ -0,0 +1,37 @@
+/*
+ * Copyright(c) 2017-2019 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for connection pool routines
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#ifndef _WGET_CONNPOOL_H
+#define _WGET_CONNPOOL_H
+
+#include <wget.h>
+
+wget_http_connection_t *conn_pool_get(const wget_iri_t *iri) G_GNUC_WGET_NONNULL((1));
+void conn_pool_put(wget_http_connection_t **conn) G_GNUC_WGET_NONNULL((1));
+void conn_pool_preconnect(const wget_iri_t *iri) G_GNUC_WGET_NONNULL((1));
+void conn_pool_free(void);
+
+#endif /* _WGET_CONNPOOL_H */
@@ -0,0 +1,41 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for resident daemon mode
+ *
+ */
+
+#ifndef _WGET_DAEMON_H
+#define _WGET_DAEMON_H
+
+#include <wget.h>
+
+// called on the serve thread for each URL received from a client;
+// a NULL url just wakes the main loop (e.g. after a QUIT command)
+typedef void daemon_enqueue_fn(const char *url);
+
+// called on the serve thread to decide whether all queued work finished
+typedef bool daemon_idle_fn(void);
+
+void daemon_init(daemon_enqueue_fn *enqueue, daemon_idle_fn *idle);
+void daemon_exit(void);
+bool daemon_active(void);
+int daemon_fetch(int argc, const char **argv, int first);
+
+#endif /* _WGET_DAEMON_H */
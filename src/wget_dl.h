@@ -92,6 +92,12 @@ char *dl_get_name_from_path(const char *path, int strict);
  */
 char *dl_search(const char *name, const wget_vector_t *dirs);
 
+// Loads the resolved plugin-path cache (mtime-validated by dl_search())
+void dl_cache_load(const char *filename);
+
+// Writes the cache back if dl_search() learned or invalidated anything
+void dl_cache_save(void);
+
 /* Creates a list of loadable object files in a given list of directories.
  */
 void dl_list(const wget_vector_t *dirs, wget_vector_t *names_out);
@@ -0,0 +1,35 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for the disk-backed URL frontier
+ *
+ */
+
+#ifndef _WGET_FRONTIER_H
+#define _WGET_FRONTIER_H
+
+#include <wget.h>
+
+int frontier_spill(const char *url, const char *encoding, int flags, int level) G_GNUC_WGET_NONNULL((1));
+int frontier_pop(char **url, char **encoding, int *flags, int *level) G_GNUC_WGET_NONNULL_ALL;
+long long frontier_pending(void) G_GNUC_WGET_PURE;
+void frontier_stats(long long *spilled) G_GNUC_WGET_NONNULL_ALL;
+void frontier_free(void);
+
+#endif /* _WGET_FRONTIER_H */
@@ -56,8 +56,10 @@ typedef struct {
 		*robot_job; // special job for downloading robots.txt (before anything else)
 	wget_robots_t
 		*robots;
-	wget_list_t
-		*queue; // host specific job queue
+	struct _robots_trie_node
+		*robots_trie; // disallow rules compiled into a trie, checks are O(path length)
+	wget_list_node_t
+		*queue; // host specific job queue, intrusive: the links are embedded in JOB
 	wget_hashmap_t
 		*host_docs;
 	wget_hashmap_t
@@ -66,14 +68,18 @@ typedef struct {
 		*root,
 		*robot;
 	long long
-		retry_ts; // timestamp of earliest retry in milliseconds
+		retry_ts, // timestamp of earliest retry in milliseconds
+		next_request_ts; // token-bucket politeness (--wait): earliest time the next request may go out
 	int
 		qsize, // number of jobs in queue
+		workers, // number of downloader threads currently draining this host's queue
 		failures; // number of consequent connection failures
 	uint16_t
 		port;
 	bool
-		blocked : 1; // host may be blocked after too many errors or even one final error
+		blocked : 1, // host may be blocked after too many errors or even one final error
+		pipelining_broken : 1, // server closed a pipelined HTTP/1.1 connection early
+		breaker_tripped : 1; // failure circuit breaker open, queue parked with exponential backoff
 } HOST;
 
 typedef struct {
@@ -145,13 +151,23 @@ JOB *host_add_robotstxt_job(HOST *host, wget_iri_t *iri) G_GNUC_WGET_NONNULL((1,
 void host_release_jobs(HOST *host);
 void host_remove_job(HOST *host, JOB *job) G_GNUC_WGET_NONNULL((1,2));
 void host_queue_free(HOST *host) G_GNUC_WGET_NONNULL((1));
+int hosts_browse_jobs(int (*browse)(void *ctx, JOB *job), void *ctx) G_GNUC_WGET_NONNULL((1));
+wget_vector_t *hosts_get_https(void);
 void hosts_free(void);
+void host_inc_worker(HOST *host) G_GNUC_WGET_NONNULL((1));
+void host_dec_worker(HOST *host) G_GNUC_WGET_NONNULL((1));
+void host_delay_request(HOST *host, long long ms) G_GNUC_WGET_NONNULL((1));
+void host_disable_pipelining(HOST *host) G_GNUC_WGET_NONNULL((1));
+void host_compile_robots(HOST *host) G_GNUC_WGET_NONNULL((1));
+int host_robots_disallowed(const HOST *host, const char *path) G_GNUC_WGET_NONNULL((1));
 void host_increase_failure(HOST *host) G_GNUC_WGET_NONNULL((1));
 void host_final_failure(HOST *host) G_GNUC_WGET_NONNULL((1));
 void host_reset_failure(HOST *host) G_GNUC_WGET_NONNULL((1));
 
 int queue_size(void) G_GNUC_WGET_PURE;
+int host_pending_count(const char *hostname) G_GNUC_WGET_NONNULL_ALL;
 int queue_empty(void) G_GNUC_WGET_PURE;
+int hosts_breakers_tripped(void) G_GNUC_WGET_PURE;
 void queue_print(HOST *host);
 
 #endif /* _WGET_HOST_H */
@@ -50,7 +50,16 @@ typedef struct {
 
 typedef struct DOWNLOADER DOWNLOADER;
 
+// Scheduling classes for the job queue, higher classes are dequeued first.
+// Small metadata fetches unlock further parallelism (more URLs to crawl),
+// so they must not wait behind bulk bodies.
+#define JOB_PRIORITY_BULK     0 // regular document / body downloads
+#define JOB_PRIORITY_INLINE   1 // page requisites and inline resources (CSS, images, ...)
+#define JOB_PRIORITY_METADATA 2 // robots.txt, sitemaps, metalink descriptions
+
 struct JOB {
+	wget_list_node_t
+		node; // host queue link, must stay the first member (a JOB * is also a node *)
 	wget_iri_t
 		*iri,
 		*original_url,
@@ -70,19 +79,28 @@ struct JOB {
 		*parts; // parts to download
 	HOST
 		*host;
+	wget_html_parsed_result_t
+		*parsed_html; // links extracted incrementally while the body was streaming in
 	const char
 		*local_filename;
 	PART
 		*part; // current chunk to download
 	DOWNLOADER
 		*downloader;
+	struct trace_rec_st
+		*trace; // sampled per-request timeline, NULL when not traced
+	long long
+		queued_ts, // ns timestamp of enqueueing, only set with --trace-sample
+		retry_ts; // earliest next attempt in milliseconds, set by job_backoff()
 
 	wget_thread_t
 		used_by; // keep track of who uses this job, for host_release_jobs()
 	int
+		priority, // scheduling class, higher classes are dequeued first (JOB_PRIORITY_*)
 		level, // current recursion level
 		redirection_level, // number of redirections occurred to create this job
 		auth_failure_count, // number of times server has returned a 401 response
+		failures, // failed attempts of this job, drives the retry backoff
 		mirror_pos, // where to look up the next (metalink) mirror to use
 		piece_pos; // where to look up the next (metalink) piece to download
 	bool
@@ -92,7 +110,8 @@ struct JOB {
 		robotstxt : 1, // URL is a robots.txt to be scanned
 		head_first : 1, // first check mime type by using a HEAD request
 		requested_by_user : 1, // download even if disallowed by robots.txt
-		ignore_patterns : 1; // Ignore accept/reject patterns
+		ignore_patterns : 1, // Ignore accept/reject patterns
+		pushed : 1; // satisfied by an HTTP/2 server push, never entered a host queue
 };
 
 struct DOWNLOADER {
@@ -102,6 +121,10 @@ struct DOWNLOADER {
 		*job;
 	wget_http_connection_t
 		*conn;
+	wget_metalink_mirror_t
+		*mirror; // mirror serving the current part, for live throughput scoring
+	long long
+		part_ts; // start of the current part attempt
 	char
 		*buf;
 	size_t
@@ -111,12 +134,16 @@ struct DOWNLOADER {
 	wget_thread_cond_t
 		cond;
 	bool
-		final_error : 1;
+		final_error : 1,
+		exited : 1; // thread shut down after being idle, slot may be reaped/reused
 };
 
 JOB *job_init(JOB *job, wget_iri_t *iri) G_GNUC_WGET_NONNULL((2));
+JOB *job_dup(const JOB *job) G_GNUC_WGET_NONNULL((1));
 int job_validate_file(JOB *job) G_GNUC_WGET_NONNULL((1));
 void job_create_parts(JOB *job) G_GNUC_WGET_NONNULL((1));
 void job_free(JOB *job) G_GNUC_WGET_NONNULL((1));
+void job_recycle(JOB **job);
+void job_backoff(JOB *job) G_GNUC_WGET_NONNULL((1));
 
 #endif /* _WGET_JOB_H */
@@ -0,0 +1,40 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for constant-memory latency histograms
+ *
+ */
+
+#ifndef _WGET_LATENCY_H
+#define _WGET_LATENCY_H
+
+// one histogram per host and phase - adding one needs a name in latency.c
+typedef enum {
+	LATENCY_DNS,
+	LATENCY_TLS,
+	LATENCY_TTFB,  // request sent until first response bytes
+	LATENCY_TOTAL, // request sent until response complete
+	LATENCY_PHASE_MAX
+} latency_phase_t;
+
+void latency_add(const char *host, latency_phase_t phase, long long ms);
+void latency_print(void);
+void latency_free(void);
+
+#endif /* _WGET_LATENCY_H */
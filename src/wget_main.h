@@ -59,5 +59,6 @@
 #define countof(a) (sizeof(a)/sizeof(*(a)))
 
 const char * G_GNUC_WGET_NONNULL_ALL get_local_filename(wget_iri_t *iri);
+void queue_url_from_snapshot(const char *url) G_GNUC_WGET_NONNULL_ALL;
 
 #endif /* _WGET_MAIN_H */
@@ -0,0 +1,53 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for low-overhead crawl metrics
+ *
+ */
+
+#ifndef _WGET_METRICS_H
+#define _WGET_METRICS_H
+
+#include <wget.h>
+
+// fixed counter slots - adding one needs a matching name in metrics.c
+typedef enum {
+	METRICS_HTTP_REQUESTS,   // requests sent
+	METRICS_HTTP_OK,         // 200 responses
+	METRICS_HTTP_REDIRECTS,
+	METRICS_HTTP_NOTMODIFIED,
+	METRICS_HTTP_ERRORS,
+	METRICS_CHUNKS,          // completed metalink chunks
+	METRICS_FILES_SAVED,
+	METRICS_BYTES,           // downloaded payload bytes
+	METRICS_DNS_LOOKUPS,
+	METRICS_DNS_MS,          // summed DNS resolve time
+	METRICS_TLS_HANDSHAKES,
+	METRICS_TLS_MS,          // summed TLS handshake time
+	METRICS_MAX
+} metrics_counter_t;
+
+void metrics_init(void);
+void metrics_add(metrics_counter_t counter, long long value);
+long long metrics_read(metrics_counter_t counter);
+void metrics_dump(void);
+void metrics_exit(void);
+void metrics_stats_callback(wget_stats_type_t type, const void *stats);
+
+#endif /* _WGET_METRICS_H */
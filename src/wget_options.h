@@ -73,7 +73,8 @@ struct config {
 		*random_file,
 		*secure_protocol, // auto, SSLv2, SSLv3, TLSv1
 		*accept_regex,
-		*reject_regex;
+		*reject_regex,
+		*metrics_format; // json or csv
 	wget_vector_t
 		*config_files,
 		*domains,
@@ -86,6 +87,10 @@ struct config {
 		*headers;
 	wget_hsts_db_t
 		*hsts_db; // in-memory HSTS database
+	wget_etag_db_t
+		*etag_db; // in-memory ETag/Last-Modified validator cache
+	wget_caps_db_t
+		*caps_db; // in-memory per-host capability cache (ALPN, ranges, keep-alive)
 	wget_hpkp_db_t
 		*hpkp_db; // in-memory HPKP database
 	wget_tls_session_db_t
@@ -98,15 +103,34 @@ struct config {
 		*cookie_db;
 	char
 		*hsts_file,
+		*etag_file,
+		*caps_file, // persistent per-host capability cache
+
 		*hpkp_file,
 		*tls_session_file,
 		*ocsp_file,
 		*netrc_file,
+		*dns_cache_file, // persistent DNS cache across invocations
+		*snapshot_file, // file for periodic queue/blacklist snapshots
+		*visited_filter, // persistent filter of completed URLs, consulted before enqueueing
+		*metrics_file, // file ('-' = stdout) for periodic crawl counter dumps
+		*trace_file, // file ('-' = stderr) for per-request trace dumps
+		*telemetry_socket, // Unix socket path for live progress polling
+		*daemon_socket, // Unix socket path: stay resident and serve fetch commands on it
+		*daemon_fetch, // forward the command-line URLs to a resident daemon at this socket
+		*shard_dir, // directory holding the per-shard Unix sockets
+		*socks5_proxy, // SOCKS5 proxy as host[:port], all connections tunnel through it
+		*feed_cursors_file, // persistent per-feed timestamp cursors
+		*warc_file, // prefix for streaming WARC-style archive segments
+		*record_file, // replay file capturing responses and timings for deterministic benchmarks
 		*password;
 	size_t
 		chunk_size;
 	long long
-		quota;
+		quota,
+		limit_rate, // transfer rate limit in bytes/s, 0 = unlimited
+		memory_limit, // pause new downloads above this RSS in bytes, 0 = off
+		warc_max_size; // rotate WARC segments beyond this size, 0 = 1G default
 	bool
 		auth_no_challenge;
 	int
@@ -124,15 +148,34 @@ struct config {
 		dns_timeout, // ms
 		read_timeout, // ms
 		max_redirect,
-		max_threads;
+		max_threads,
+		parse_workers, // dedicated link-extraction threads, 0 = parse within the downloader threads
+		snapshot_interval, // seconds between queue/blacklist snapshots
+		metrics_interval, // seconds between metrics dumps
+		trace_sample, // trace every Nth request (0 = tracing off)
+		watchdog_timeout, // seconds without progress before a stall diagnostic (0 = off)
+		shard_id, // this process' slot in a sharded crawl
+		shard_count, // number of cooperating shard processes (<= 1 = off)
+		fd_limit, // pause new downloads at this many open fds, 0 = derive from RLIMIT_NOFILE
+		fresh_for, // skip URLs validated less than this many seconds ago without a request
+		revisit_after, // generation length of the visited filter in seconds (0 = entries never expire)
+		frontier_cap; // max queued jobs in memory, overflow is spilled to disk (0 = unbounded)
 	char
 		tls_resume,            // if TLS session resumption is enabled or not
 		tls_false_start,
+		tls_early_data,        // send idempotent requests as TLS 1.3 0-RTT early data
+		tls_prewarm,           // refresh TLS tickets for all queued HTTPS hosts before the crawl
 		progress,
 		content_on_error,
 		fsync_policy,
+		write_behind,          // flush body chunks to disk from writer threads
+		bind_cpus,             // pin downloader threads to CPUs, buffers stay node-local
+		mmap_output,           // receive known-length bodies into a file mapping, no write() per chunk
+		body_cache,            // keep --convert-links documents compressed in memory
+		preconnect,            // background TCP+TLS handshakes to newly discovered hosts
 		netrc,
 		http2,
+		http2_server_push,     // accept HTTP/2 pushed resources instead of re-requesting them
 		ocsp_stapling,
 		ocsp,
 		mirror,
@@ -140,6 +183,8 @@ struct config {
 		convert_links,
 		ignore_case,
 		hsts,                  // if HSTS (HTTP Strict Transport Security) is enabled or not
+		etags,                 // remember ETag/Last-Modified validators for conditional requests
+		caps,                  // remember per-host capabilities (ALPN, ranges, keep-alive)
 		hpkp,                  // HTTP Public Key Pinning (HPKP)
 		random_wait,
 		trust_server_names,
@@ -186,6 +231,8 @@ struct config {
 		print_version,
 		quiet,
 		debug,
+		simd,                  // use vectorized kernels where the CPU supports them
+
 		metalink,
 		cut_url_get_vars,
 		cut_file_get_vars,
@@ -198,12 +245,33 @@ struct config {
 		dont_write, // fuzzers and unit/fuzz tests set this to 1, so they won't write any files
 		regex_type,
 		filter_urls,
+		compact_blacklist, // store URL digests instead of full IRIs in the blacklist
+		config_cache, // keep a validated binary snapshot of each parsed config file
+		dedup_content, // hardlink downloads with identical content to the first copy
+		delta_sidecar, // keep piece-digest sidecars, re-fetch only changed ranges on re-mirror
+		pack_output, // append small bodies to packed segment files instead of one file each
+		unpack, // recreate the files from packed segments, then exit
+		fast_exit, // skip heap teardown at exit, a forked child flushes state
+		alloc_stats, // count allocations per subsystem, report at exit
+		async_log, // write log messages from a background thread
 		askpass;
 };
 
 extern struct config
 	config;
 
+// state databases are read from disk on first use, see config_load_db()
+typedef enum {
+	CONFIG_DB_COOKIES,
+	CONFIG_DB_HSTS,
+	CONFIG_DB_ETAGS,
+	CONFIG_DB_CAPS,
+	CONFIG_DB_HPKP,
+	CONFIG_DB_TLS_SESSION,
+	CONFIG_DB_OCSP,
+	CONFIG_DB_MAX
+} config_db_t;
+
 typedef enum exit_status_t {
 	WG_EXIT_STATUS_NO_ERROR   = EXIT_SUCCESS,
 	WG_EXIT_STATUS_GENERIC    = 1,
@@ -223,6 +291,7 @@ extern "C" {
 
 int init(int argc, const char **argv) G_GNUC_WGET_NONNULL_ALL;
 int selftest_options(void);
+void config_load_db(config_db_t db);
 void deinit(void);
 void set_exit_status(exit_status_t status);
 int get_exit_status(void);
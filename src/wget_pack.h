@@ -0,0 +1,34 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for packed small-file output
+ *
+ */
+
+#ifndef _WGET_PACK_H
+#define _WGET_PACK_H
+
+#include <wget.h>
+
+int pack_append(const char *fname, const void *data, size_t length) G_GNUC_WGET_NONNULL_ALL;
+int pack_explode(void);
+void pack_stats(long long *nfiles) G_GNUC_WGET_NONNULL_ALL;
+void pack_free(void);
+
+#endif /* _WGET_PACK_H */
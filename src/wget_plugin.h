@@ -81,7 +81,7 @@ void plugin_db_show_help(void);
 // Plugin's verdict on forwarded URLs
 struct plugin_db_forward_url_verdict {
 	wget_iri_t *alt_iri;
-	char *alt_local_filename;
+	char *alt_local_filename; // a refstr, release with wget_refstr_unref()
 	bool
 		reject : 1,
 		accept : 1;
@@ -98,6 +98,13 @@ void plugin_db_forward_url_verdict_free(struct plugin_db_forward_url_verdict *ve
 int plugin_db_forward_downloaded_file(const wget_iri_t *iri, uint64_t size, const char *filename, const void *data,
 		wget_vector_t *recurse_iris);
 
+// Whether any plugin registered a body filter for the given position
+int plugin_db_has_body_filter(int position);
+
+// Forwards one streaming body chunk to intrested plugins
+// Returns nonzero if any filter wants the transfer canceled
+int plugin_db_forward_body(const wget_iri_t *iri, int position, const char *data, size_t length);
+
 // Fetches the plugin-provided HSTS database, or NULL.
 // Ownership of the returned HSTS database is transferred to the caller, so it must be free'd with wget_hsts_db_free().
 wget_hsts_db_t *plugin_db_fetch_provided_hsts_db(void);
@@ -0,0 +1,36 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Crawl recording for deterministic replay (--record-file)
+ *
+ */
+
+#ifndef _WGET_REPLAY_H
+#define _WGET_REPLAY_H
+
+#include <stddef.h>
+
+typedef struct replay_stream replay_stream_t;
+
+replay_stream_t *replay_record_begin(const char *uri) G_GNUC_WGET_NONNULL((1));
+void replay_record_append(replay_stream_t *stream, const void *data, size_t length) G_GNUC_WGET_NONNULL((1,2));
+void replay_record_end(replay_stream_t **stream, const void *header, size_t header_len) G_GNUC_WGET_NONNULL((1));
+void replay_free(void);
+
+#endif /* _WGET_REPLAY_H */
@@ -0,0 +1,37 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for multi-process crawl sharding
+ *
+ */
+
+#ifndef _WGET_SHARD_H
+#define _WGET_SHARD_H
+
+#include <wget.h>
+
+// called on the receiver thread for each URL handed over by a peer shard
+typedef void shard_enqueue_fn(const char *url);
+
+void shard_init(shard_enqueue_fn *enqueue);
+void shard_exit(void);
+bool shard_local_host(const char *host) G_GNUC_WGET_NONNULL_ALL;
+int shard_forward(const char *host, const char *url) G_GNUC_WGET_NONNULL_ALL;
+
+#endif /* _WGET_SHARD_H */
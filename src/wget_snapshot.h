@@ -0,0 +1,43 @@
+/*
+ * Copyright(c) 2017-2019 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for queue/blacklist snapshot routines
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#ifndef _WGET_SNAPSHOT_H
+#define _WGET_SNAPSHOT_H
+
+// load a snapshot written by a previous run (config.snapshot_file):
+// re-queues pending URLs and marks finished ones as known
+void snapshot_load(void);
+
+// write the current queue + blacklist state to config.snapshot_file
+void snapshot_save(void);
+
+// journal one queue change (discovery or completion) for the next checkpoint
+void snapshot_journal_add(bool finished, const char *uri) G_GNUC_WGET_NONNULL((2));
+
+// append the journaled changes to config.snapshot_file - O(changes), no rewrite
+void snapshot_checkpoint(void);
+
+#endif /* _WGET_SNAPSHOT_H */
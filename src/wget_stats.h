@@ -42,13 +42,17 @@ typedef struct {
 		*version,
 		*alpn_proto;
 	long long
-		millisecs;
+		millisecs,
+		tcp_millisecs, // duration of the TCP connect preceding the handshake
+		hpkp_millisecs; // duration of the HPKP pin check, -1 if none was done
 	int
 		cert_chain_size;
 	char
 		tcp_protocol,
 		false_start,
-		tfo;
+		tfo,
+		early_data,
+		hpkp_cached; // -1=no pin check, 0=computed, 1=served from the memoized verdict
 	bool
 		tls_con : 1,
 		resumed : 1;
@@ -82,7 +86,7 @@ void stats_print(void);
 void stats_set_option(int type, bool status, int format, const char *filename);
 void stats_set_hosts(wget_hashmap_t *_hosts, wget_thread_mutex_t *_hosts_mutex);
 bool stats_is_enabled(int type);
-DOC *stats_docs_add(wget_iri_t *iri, wget_http_response_t *resp);
-TREE_DOCS *stats_tree_docs_add(wget_iri_t *parent_iri, wget_iri_t *iri, wget_http_response_t *resp, bool robot_iri, bool redirect, DOC *doc);
+void stats_site_add(wget_iri_t *parent_iri, wget_iri_t *iri, wget_http_response_t *resp, bool robot_iri, bool redirect);
+void stats_site_rollup(void);
 
 #endif
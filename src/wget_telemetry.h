@@ -0,0 +1,55 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for the progress telemetry socket
+ *
+ */
+
+#ifndef _WGET_TELEMETRY_H
+#define _WGET_TELEMETRY_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// coarse download phases, for the watchdog diagnostics - TLS is part of
+// the connect phase, the handshake happens inside establish_connection()
+typedef enum {
+	TELEMETRY_PHASE_CONNECT,
+	TELEMETRY_PHASE_REQUEST,
+	TELEMETRY_PHASE_READ,
+	TELEMETRY_PHASE_MAX
+} telemetry_phase_t;
+
+void telemetry_init(void);
+void telemetry_exit(void);
+
+// per-download progress, keyed by the progress bar slot (= downloader id)
+void telemetry_job_begin(int slot, const char *uri, ssize_t expected);
+void telemetry_job_phase(int slot, telemetry_phase_t phase);
+void telemetry_job_expected(int slot, ssize_t expected);
+void telemetry_job_downloaded(int slot, size_t nbytes);
+void telemetry_job_end(int slot);
+
+// report downloads without progress for config.watchdog_timeout seconds
+void telemetry_watchdog_check(void);
+
+// current load derived from the slot table, for the plugin scheduler info
+void telemetry_active(int *busy, long long *received, long long *expected);
+
+#endif /* _WGET_TELEMETRY_H */
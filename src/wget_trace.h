@@ -0,0 +1,58 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for per-request tracing
+ *
+ */
+
+#ifndef _WGET_TRACE_H
+#define _WGET_TRACE_H
+
+#include <wget.h>
+
+// request timeline stages, stamped in chronological order
+typedef enum {
+	TRACE_QUEUED,     // job entered the host queue
+	TRACE_DEQUEUE,    // a downloader picked the job up
+	TRACE_CONNECT,    // connection established (0 when reused)
+	TRACE_REQUEST,    // request handed to the transport
+	TRACE_FIRST_BYTE, // response header arrived
+	TRACE_LAST_BYTE,  // response complete
+	TRACE_PROCESSED,  // parsing/writing done
+	TRACE_STAGE_MAX
+} trace_stage_t;
+
+typedef struct trace_rec_st {
+	unsigned long long
+		seq; // claim ticket, orders the dump
+	long long
+		ts[TRACE_STAGE_MAX]; // ns timestamps, 0 = stage not reached
+	char
+		uri[224];
+} trace_rec_t;
+
+void trace_init(void);
+long long trace_now(void);
+trace_rec_t *trace_begin(const char *uri, long long queued_ts);
+void trace_stamp(trace_rec_t *rec, trace_stage_t stage);
+void trace_dump_request(void); // async-signal-safe, dump happens on next trace_dump()
+void trace_dump(bool force);
+void trace_exit(void);
+
+#endif /* _WGET_TRACE_H */
@@ -0,0 +1,48 @@
+/*
+ * Copyright(c) 2017-2019 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for the persistent visited-URL filter
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#ifndef _WGET_VISITED_H
+#define _WGET_VISITED_H
+
+#include <wget.h>
+
+// load the filter written by a previous run (config.visited_filter),
+// expiring generations older than config.revisit_after
+void visited_load(void);
+
+// write the filter back to config.visited_filter
+void visited_save(void);
+
+// true if \p uri completed within roughly the last revisit interval -
+// approximate, a (rare) false positive skips the URL for one interval
+bool visited_test(const char *uri) G_GNUC_WGET_NONNULL((1));
+
+// record a completed download in the current generation
+void visited_add(const char *uri) G_GNUC_WGET_NONNULL((1));
+
+void visited_free(void);
+
+#endif /* _WGET_VISITED_H */
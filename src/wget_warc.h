@@ -0,0 +1,37 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for streaming WARC-style archive output
+ *
+ */
+
+#ifndef _WGET_WARC_H
+#define _WGET_WARC_H
+
+#include <wget.h>
+
+typedef struct warc_stream warc_stream_t;
+
+warc_stream_t *warc_record_begin(int slot, const char *uri, const void *header, size_t length) G_GNUC_WGET_NONNULL((2,3));
+void warc_record_append(warc_stream_t *stream, const void *data, size_t length) G_GNUC_WGET_NONNULL((1,2));
+void warc_record_end(warc_stream_t *stream);
+void warc_stats(long long *nrecords) G_GNUC_WGET_NONNULL_ALL;
+void warc_free(void);
+
+#endif /* _WGET_WARC_H */
@@ -0,0 +1,34 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Header file for write-behind file output
+ *
+ */
+
+#ifndef _WGET_WRITER_H
+#define _WGET_WRITER_H
+
+#include <wget.h>
+
+void writer_enqueue(int fd, const void *data, size_t length) G_GNUC_WGET_NONNULL((2));
+void writer_enqueue_xattr(int fd, const void *packed, size_t length) G_GNUC_WGET_NONNULL((2));
+int writer_drain(int fd);
+void writer_free(void);
+
+#endif /* _WGET_WRITER_H */
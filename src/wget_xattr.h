@@ -23,11 +23,14 @@
 #ifndef _WGET_XATTR_H
 #define _WGET_XATTR_H
 
-#include <stdio.h>
+#include <stddef.h>
 
-/* Store metadata name/value attributes against fp. */
+/* Store metadata name/value attributes against the open output fd. */
 int set_file_metadata(const char *origin_url, const char *referrer_url,
-	const char *mime_type, const char *charset, FILE *fname);
+	const char *mime_type, const char *charset, int fd);
+
+/* Apply a packed list of name\0value\0 pairs, built by set_file_metadata(). */
+int xattr_apply_packed(int fd, const char *packed, size_t length);
 
 #if defined __linux
 /* libc on Linux has fsetxattr (5 arguments). */
@@ -0,0 +1,255 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Write-behind file output (--write-behind)
+ *
+ * Body chunks are copied into a bounded per-thread backlog and written by
+ * a small writer pool, so the network read loop doesn't stall on a slow
+ * disk (NFS targets easily add tens of ms per write). An fd is always
+ * served by the same writer thread, which keeps its chunks in order.
+ * writer_drain() must be called before the fd's mtime/fsync/close
+ * handling and reports whether any of its deferred writes failed.
+ *
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <wget.h>
+
+#include "safe-write.h"
+
+#include "wget_main.h"
+#include "wget_options.h"
+#include "wget_writer.h"
+#include "wget_xattr.h"
+
+#define WRITER_THREADS 2
+
+// above this many queued entries per writer new chunks block (bounded buffer),
+// trading the stall back in rather than ballooning RSS on a dead-slow disk
+#define WRITER_MAX_BACKLOG 512
+
+typedef struct {
+	int
+		fd;
+	size_t
+		length;
+	char
+		is_xattr, // data holds packed xattr name/value pairs instead of a body chunk
+		data[]; // the copied chunk
+} WRITE_ENTRY;
+
+typedef struct {
+	wget_thread_t
+		tid;
+	wget_thread_mutex_t
+		mutex;
+	wget_thread_cond_t
+		cond; // signalled on new work, a finished write and shutdown
+	wget_vector_t
+		*backlog, // WRITE_ENTRYs in enqueue order
+		*failed; // fds with a failed write, picked up by writer_drain()
+	int
+		busy_fd; // fd currently being written, -1 if none
+} WRITER;
+
+static WRITER writers[WRITER_THREADS] = {
+	[0 ... WRITER_THREADS - 1] = {
+		.mutex = WGET_THREAD_MUTEX_INITIALIZER,
+		.cond = WGET_THREAD_COND_INITIALIZER,
+		.busy_fd = -1
+	}
+};
+
+static bool writer_shutdown;
+
+// all entries of an fd live on one writer, so its chunks stay in order
+static WRITER *_writer_of(int fd)
+{
+	return &writers[(unsigned) fd % WRITER_THREADS];
+}
+
+static int _fd_pending(WRITER *writer, int fd)
+{
+	if (writer->busy_fd == fd)
+		return 1;
+
+	for (int it = 0; it < wget_vector_size(writer->backlog); it++)
+		if (((WRITE_ENTRY *) wget_vector_get(writer->backlog, it))->fd == fd)
+			return 1;
+
+	return 0;
+}
+
+static void *_writer_thread(void *p)
+{
+	WRITER *writer = p;
+
+	for (;;) {
+		WRITE_ENTRY *entry = NULL;
+
+		wget_thread_mutex_lock(&writer->mutex);
+		while (!writer_shutdown && wget_vector_size(writer->backlog) == 0)
+			wget_thread_cond_wait(&writer->cond, &writer->mutex, 0);
+		if (wget_vector_size(writer->backlog) > 0) {
+			entry = wget_vector_get(writer->backlog, 0);
+			wget_vector_remove_nofree(writer->backlog, 0);
+			writer->busy_fd = entry->fd;
+		}
+		wget_thread_mutex_unlock(&writer->mutex);
+
+		if (!entry)
+			break; // shutdown requested and backlog drained
+
+		if (entry->is_xattr) {
+			// failures are logged per attribute and non-fatal, as on the sync path
+			xattr_apply_packed(entry->fd, entry->data, entry->length);
+
+			wget_thread_mutex_lock(&writer->mutex);
+			writer->busy_fd = -1;
+			wget_thread_cond_signal(&writer->cond);
+			wget_thread_mutex_unlock(&writer->mutex);
+
+			xfree(entry);
+			continue;
+		}
+
+		// same EAGAIN handling as the synchronous path, the fds are O_NONBLOCK
+		size_t written = safe_write(entry->fd, entry->data, entry->length);
+		while (written == SAFE_WRITE_ERROR
+#if EAGAIN != EWOULDBLOCK
+			&& (errno == EAGAIN || errno == EWOULDBLOCK)
+#else
+			&& errno == EAGAIN
+#endif
+			&& wget_ready_2_write(entry->fd, 1000) > 0)
+		{
+			written = safe_write(entry->fd, entry->data, entry->length);
+		}
+
+		wget_thread_mutex_lock(&writer->mutex);
+		if (written == SAFE_WRITE_ERROR) {
+			debug_printf("Failed to write errno=%d\n", errno);
+			if (!writer->failed)
+				writer->failed = wget_vector_create(4, -2, NULL);
+			wget_vector_add_noalloc(writer->failed, (void *) (ptrdiff_t) entry->fd);
+		}
+		writer->busy_fd = -1;
+		wget_thread_cond_signal(&writer->cond); // wake drain and backpressure waiters
+		wget_thread_mutex_unlock(&writer->mutex);
+
+		xfree(entry);
+	}
+
+	return NULL;
+}
+
+static void _enqueue(int fd, const void *data, size_t length, char is_xattr)
+{
+	WRITER *writer = _writer_of(fd);
+	WRITE_ENTRY *entry = wget_malloc(sizeof(WRITE_ENTRY) + length);
+
+	entry->fd = fd;
+	entry->length = length;
+	entry->is_xattr = is_xattr;
+	memcpy(entry->data, data, length);
+
+	wget_thread_mutex_lock(&writer->mutex);
+
+	if (!writer->backlog) {
+		int rc;
+
+		writer->backlog = wget_vector_create(64, -2, NULL);
+
+		if ((rc = wget_thread_start(&writer->tid, _writer_thread, writer, 0)) != 0)
+			error_printf(_("Failed to start writer thread, error %d\n"), rc);
+	}
+
+	while (wget_vector_size(writer->backlog) >= WRITER_MAX_BACKLOG)
+		wget_thread_cond_wait(&writer->cond, &writer->mutex, 0);
+
+	wget_vector_add_noalloc(writer->backlog, entry);
+	wget_thread_cond_signal(&writer->cond);
+
+	wget_thread_mutex_unlock(&writer->mutex);
+}
+
+// hand a body chunk to the writer pool, starts the pool lazily
+void writer_enqueue(int fd, const void *data, size_t length)
+{
+	_enqueue(fd, data, length, 0);
+}
+
+// hand packed xattr name/value pairs to the fd's writer, applied after the
+// chunks queued so far - one submission instead of one syscall per attribute
+// from the downloader thread
+void writer_enqueue_xattr(int fd, const void *packed, size_t length)
+{
+	_enqueue(fd, packed, length, 1);
+}
+
+// wait until all deferred writes of fd hit the fd; returns -1 if any failed
+int writer_drain(int fd)
+{
+	WRITER *writer = _writer_of(fd);
+	int rc = 0;
+
+	wget_thread_mutex_lock(&writer->mutex);
+
+	while (_fd_pending(writer, fd))
+		wget_thread_cond_wait(&writer->cond, &writer->mutex, 0);
+
+	for (int it = wget_vector_size(writer->failed) - 1; it >= 0; it--) {
+		if ((int) (ptrdiff_t) wget_vector_get(writer->failed, it) == fd) {
+			wget_vector_remove_nofree(writer->failed, it);
+			rc = -1;
+		}
+	}
+
+	wget_thread_mutex_unlock(&writer->mutex);
+
+	return rc;
+}
+
+void writer_free(void)
+{
+	writer_shutdown = true;
+
+	for (int it = 0; it < WRITER_THREADS; it++) {
+		wget_thread_mutex_lock(&writers[it].mutex);
+		wget_thread_cond_signal(&writers[it].cond);
+		wget_thread_mutex_unlock(&writers[it].mutex);
+	}
+
+	for (int it = 0; it < WRITER_THREADS; it++) {
+		if (writers[it].tid) {
+			wget_thread_join(writers[it].tid);
+			writers[it].tid = 0;
+		}
+		wget_vector_free(&writers[it].backlog);
+		wget_vector_clear_nofree(writers[it].failed); // holds plain fds, not pointers
+		wget_vector_free(&writers[it].failed);
+	}
+
+	writer_shutdown = false;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Standalone benchmark server with synthetic workloads
+ *
+ * Serves three workloads over the same test server that the tests use:
+ *   /small/index.html   - links to many small files (per-request overhead)
+ *   /huge.dat           - one large file (raw transfer throughput)
+ *   /tree/index.html    - a deep HTML tree (parse + scheduling)
+ *
+ * Started by benchmarks/bench_local.sh, which drives wget2 against the
+ * workloads and reports requests/sec, MB/s and CPU per byte. The server
+ * prints "PORT <n>" on stdout when ready and runs until SIGTERM/SIGINT.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <wget.h>
+#include "libtest.h"
+
+// many-small-files workload
+#define SMALL_COUNT 2000
+#define SMALL_SIZE 4096
+
+// one-huge-file workload
+#define HUGE_SIZE (64 * 1024 * 1024)
+
+// deep-HTML-tree workload: (FANOUT^(DEPTH+1)-1)/(FANOUT-1) pages
+#define TREE_DEPTH 5
+#define TREE_FANOUT 3
+
+static wget_test_url_t *urls;
+static size_t nurls, maxurls;
+
+static wget_test_url_t *add_url(const char *name)
+{
+	wget_test_url_t *url;
+
+	if (nurls >= maxurls) {
+		maxurls = maxurls ? maxurls * 2 : 256;
+		urls = wget_realloc(urls, maxurls * sizeof(*urls));
+	}
+
+	url = &urls[nurls++];
+	memset(url, 0, sizeof(*url));
+	url->name = name;
+	url->code = "200 Dontcare";
+	url->body_alloc = 1;
+
+	return url;
+}
+
+// filler that compresses realistically and is cheap to generate
+static char *make_payload(size_t size)
+{
+	char *data = wget_malloc(size + 1);
+
+	for (size_t it = 0; it < size; it++)
+		data[it] = (char) ((it / 13) % 61 + ' ');
+	data[size] = 0;
+
+	return data;
+}
+
+static void make_small_files(void)
+{
+	wget_buffer_t *index = wget_buffer_alloc(64 * 1024);
+	wget_test_url_t *url;
+
+	wget_buffer_strcpy(index, "<html><head><title>small files</title></head><body>\n");
+
+	for (int it = 0; it < SMALL_COUNT; it++) {
+		wget_buffer_printf_append(index, "<a href=\"file%d.dat\">file %d</a>\n", it, it);
+
+		url = add_url(wget_aprintf("/small/file%d.dat", it));
+		url->body = make_payload(SMALL_SIZE);
+		url->headers[0] = "Content-Type: application/octet-stream";
+	}
+
+	wget_buffer_strcat(index, "</body></html>\n");
+
+	url = add_url("/small/index.html");
+	url->body = wget_strmemdup(index->data, index->length);
+	url->headers[0] = "Content-Type: text/html";
+
+	wget_buffer_free(&index);
+}
+
+static void make_huge_file(void)
+{
+	wget_test_url_t *url = add_url("/huge.dat");
+
+	url->body = make_payload(HUGE_SIZE);
+	url->headers[0] = "Content-Type: application/octet-stream";
+}
+
+// every page links its children plus one payload file
+static void make_tree(const char *dir, int depth)
+{
+	wget_buffer_t *page = wget_buffer_alloc(1024);
+	wget_test_url_t *url;
+
+	wget_buffer_printf(page, "<html><head><title>%s</title></head><body>\n", dir);
+	wget_buffer_strcat(page, "<a href=\"leaf.dat\">leaf</a>\n");
+
+	if (depth < TREE_DEPTH) {
+		for (int it = 0; it < TREE_FANOUT; it++) {
+			wget_buffer_printf_append(page, "<a href=\"d%d/index.html\">subtree %d</a>\n", it, it);
+
+			char *subdir = wget_aprintf("%sd%d/", dir, it);
+			make_tree(subdir, depth + 1);
+			wget_xfree(subdir);
+		}
+	}
+
+	wget_buffer_strcat(page, "</body></html>\n");
+
+	url = add_url(wget_aprintf("%sindex.html", dir));
+	url->body = wget_strmemdup(page->data, page->length);
+	url->headers[0] = "Content-Type: text/html";
+
+	url = add_url(wget_aprintf("%sleaf.dat", dir));
+	url->body = make_payload(SMALL_SIZE);
+	url->headers[0] = "Content-Type: application/octet-stream";
+
+	wget_buffer_free(&page);
+}
+
+static void stop(G_GNUC_WGET_UNUSED int sig)
+{
+	exit(EXIT_SUCCESS); // atexit() handler stops the server
+}
+
+int main(void)
+{
+	make_small_files();
+	make_huge_file();
+	make_tree("/tree/", 0);
+
+	wget_test_start_server(
+		WGET_TEST_RESPONSE_URLS, urls, nurls,
+		0);
+
+	signal(SIGTERM, stop);
+	signal(SIGINT, stop);
+
+	printf("PORT %d\n", wget_test_get_http_server_port());
+	fflush(stdout);
+
+	for (;;)
+		pause();
+}
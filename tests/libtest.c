@@ -279,6 +279,11 @@ static int _answer_to_connection(
 		MHD_http_unescape(url_iri->data);
 
 		if (!strcmp(url_full->data, url_iri->data)) {
+			// replayed latency - the server runs one thread per connection
+			// when any URL carries a delay, so parallel requests overlap
+			if (urls[it1].delay_ms > 0)
+				wget_millisleep(urls[it1].delay_ms);
+
 			// chunked encoding
 			if (!wget_strcmp(urls[it1].name + 3, "bad.txt")) {
 				response = MHD_create_response_from_buffer(strlen(urls[it1].body),
@@ -420,9 +425,14 @@ static int _answer_to_connection(
 					ret = MHD_queue_response(connection, MHD_HTTP_PARTIAL_CONTENT, response);
 				}
 			} else {
-				response = MHD_create_response_from_buffer(strlen(urls[it1].body),
+				// body_len supports binary bodies (replayed compressed payloads),
+				// a numeric code string ("200 OK", "404 Not Found") picks the status
+				int status = atoi(urls[it1].code ? urls[it1].code : "200");
+
+				response = MHD_create_response_from_buffer(
+					urls[it1].body_len ? urls[it1].body_len : strlen(urls[it1].body),
 					(void *) urls[it1].body, MHD_RESPMEM_MUST_COPY);
-				ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+				ret = MHD_queue_response(connection, status > 0 ? (unsigned int) status : MHD_HTTP_OK, response);
 			}
 
 			// add available headers
@@ -470,6 +480,17 @@ static void _http_server_stop(void)
 	wget_xfree(cert_pem);
 }
 
+// a delaying URL must not stall the select loop - serve each connection
+// from its own thread then, so replayed latencies overlap like real ones
+static unsigned int _daemon_flags(void)
+{
+	for (size_t it = 0; it < nurls; it++)
+		if (urls[it].delay_ms > 0)
+			return MHD_USE_THREAD_PER_CONNECTION;
+
+	return MHD_USE_SELECT_INTERNALLY;
+}
+
 static int _http_server_start(int SERVER_MODE)
 {
 	uint16_t port_num = 0;
@@ -477,7 +498,7 @@ static int _http_server_start(int SERVER_MODE)
 	if (SERVER_MODE == HTTP_MODE) {
 		static char rnd[8] = "realrnd"; // fixed 'random' value
 
-		httpdaemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY,
+		httpdaemon = MHD_start_daemon(_daemon_flags(),
 			port_num, NULL, NULL, &_answer_to_connection, NULL,
 			MHD_OPTION_DIGEST_AUTH_RANDOM, sizeof(rnd), rnd,
 			MHD_OPTION_NONCE_NC_SIZE, 300,
@@ -497,7 +518,7 @@ static int _http_server_start(int SERVER_MODE)
 			return 1;
 		}
 
-		httpsdaemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY | MHD_USE_TLS,
+		httpsdaemon = MHD_start_daemon(_daemon_flags() | MHD_USE_TLS,
 			port_num, NULL, NULL, &_answer_to_connection, NULL,
 			MHD_OPTION_HTTPS_MEM_KEY, key_pem,
 			MHD_OPTION_HTTPS_MEM_CERT, cert_pem,
@@ -115,6 +115,10 @@ typedef struct {
 		request_headers[10];
 	time_t
 		modified;
+	size_t
+		body_len; // length of 'body', 0 means strlen(body) - set it for binary bodies
+	int
+		delay_ms; // artificial delay before answering, for replayed latencies
 	char
 		body_alloc; // if body has been allocated internally (and need to be freed on exit)
 	char
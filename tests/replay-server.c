@@ -0,0 +1,199 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of libwget.
+ *
+ * Libwget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Libwget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libwget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Replay server for crawls recorded with 'wget2 --record-file'
+ *
+ * Reads a replay file (see src/replay.c for the record layout) and serves
+ * the captured responses back on localhost with the recorded latencies.
+ * Any two builds of wget2 driven against the same replay file see
+ * identical traffic, which makes scheduler changes benchmarkable:
+ *
+ *   wget2 --record-file=crawl.replay -r https://example.com
+ *   tests/replay-server crawl.replay     # prints "PORT <n>" when ready
+ *   wget2 -r http://127.0.0.1:<n>/
+ *
+ * Message framing headers (Transfer-Encoding, Content-Length, Connection)
+ * are dropped when replaying - the server does its own framing. The body
+ * bytes are served exactly as captured, before decompression, so a
+ * recorded Content-Encoding still matches its payload.
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <wget.h>
+#include "libtest.h"
+
+static wget_test_url_t *urls;
+static size_t nurls, maxurls;
+
+static wget_test_url_t *add_url(void)
+{
+	wget_test_url_t *url;
+
+	if (nurls >= maxurls) {
+		maxurls = maxurls ? maxurls * 2 : 256;
+		urls = wget_realloc(urls, maxurls * sizeof(*urls));
+	}
+
+	url = &urls[nurls++];
+	memset(url, 0, sizeof(*url));
+
+	return url;
+}
+
+// the path (plus query) of an absolute URI, the server matches on that
+static const char *uri_path(const char *uri)
+{
+	const char *p = strstr(uri, "://");
+
+	if (p && (p = strchr(p + 3, '/')))
+		return p;
+
+	return *uri == '/' ? uri : "/";
+}
+
+// headers the server generates itself - replaying the recorded ones
+// would conflict with the actual framing of the replayed message
+static int framing_header(const char *line)
+{
+	return !wget_strncasecmp_ascii(line, "Transfer-Encoding:", 18)
+		|| !wget_strncasecmp_ascii(line, "Content-Length:", 15)
+		|| !wget_strncasecmp_ascii(line, "Connection:", 11)
+		|| !wget_strncasecmp_ascii(line, "Keep-Alive:", 11);
+}
+
+// split the raw response header into status code and header lines
+static void parse_header(wget_test_url_t *url, char *header, size_t len)
+{
+	char *end = header + len, *line, *next;
+	size_t it = 0;
+
+	for (line = header; line < end; line = next) {
+		char *eol = memchr(line, '\n', end - line);
+
+		next = eol ? eol + 1 : end;
+		if (eol > line && eol[-1] == '\r')
+			eol--;
+		if (!eol || eol == line)
+			continue; // empty line, end of header
+
+		*eol = 0;
+
+		if (line == header) {
+			// status line: HTTP/1.1 200 OK
+			const char *code = strchr(line, ' ');
+
+			url->code = code ? code + 1 : "200 OK";
+			continue;
+		}
+
+		// keep one NULL slot, the server iterates until it hits one
+		if (it < countof(url->headers) - 1 && !framing_header(line))
+			url->headers[it++] = line;
+	}
+
+	if (!url->code)
+		url->code = "200 OK";
+}
+
+// parse the whole replay file, entries point into the file buffer
+static int load_replay_file(const char *fname)
+{
+	size_t size;
+	char *data = wget_read_file(fname, &size);
+	char *p = data, *end;
+
+	if (!data) {
+		fprintf(stderr, "Failed to read '%s'\n", fname);
+		return -1;
+	}
+
+	end = data + size;
+
+	while (p < end) {
+		long long latency;
+		size_t header_len, body_len;
+		int uri_offset;
+		char *eol = memchr(p, '\n', end - p);
+
+		if (!eol || sscanf(p, "REPLAY %lld %zu %zu %n", &latency, &header_len, &body_len, &uri_offset) < 3) {
+			fprintf(stderr, "Malformed record at offset %zu\n", (size_t) (p - data));
+			return -1;
+		}
+		*eol = 0; // terminates the URI
+
+		if (end - (eol + 1) < (ptrdiff_t) (header_len + body_len)) {
+			fprintf(stderr, "Truncated record for %s\n", p + uri_offset);
+			return -1;
+		}
+
+		wget_test_url_t *url = add_url();
+
+		url->name = uri_path(p + uri_offset);
+		url->body = eol + 1 + header_len;
+		url->body_len = body_len;
+		url->delay_ms = (int) latency;
+		parse_header(url, eol + 1, header_len);
+
+		p = eol + 1 + header_len + body_len + 1; // + 1 for the record-ending newline
+	}
+
+	return 0;
+}
+
+static void stop(G_GNUC_WGET_UNUSED int sig)
+{
+	exit(EXIT_SUCCESS); // atexit() handler stops the server
+}
+
+int main(int argc, const char *const *argv)
+{
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <replay file>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (load_replay_file(argv[1]))
+		return EXIT_FAILURE;
+
+	fprintf(stderr, "Replaying %zu responses from %s\n", nurls, argv[1]);
+
+	wget_test_start_server(
+		WGET_TEST_RESPONSE_URLS, urls, nurls,
+		0);
+
+	signal(SIGTERM, stop);
+	signal(SIGINT, stop);
+
+	printf("PORT %d\n", wget_test_get_http_server_port());
+	fflush(stdout);
+
+	for (;;)
+		pause();
+}
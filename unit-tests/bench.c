@@ -0,0 +1,392 @@
+/*
+ * Copyright(c) 2017 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * Benchmark harness for the libwget hot primitives
+ *
+ * Run via 'make bench'. Each benchmark warms up, then runs a fixed number
+ * of timed iterations and reports ns/op plus throughput where a byte count
+ * makes sense. Output lines are stable so a saved run can serve as a
+ * baseline:
+ *
+ *   ./libwget_bench > baseline.txt     # on the reference build
+ *   ./libwget_bench baseline.txt       # prints the delta per benchmark
+ *
+ * Changelog
+ * 26.08.2026  created
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <wget.h>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#define countof(a) (sizeof(a)/sizeof(*(a)))
+
+#define WARMUP_DIV 10 // warmup runs 1/10 of the timed iterations
+
+// baseline values read from the file given as argv[1]
+static struct baseline {
+	char name[64];
+	double ns_op;
+} baselines[64];
+static int nbaselines;
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// one result line: name, ns/op, optional MB/s, optional delta to the baseline
+static void report(const char *name, long long ops, long long bytes, long long ns)
+{
+	double ns_op = (double) ns / ops;
+
+	printf("%-24s %10lld ops %10.1f ns/op", name, ops, ns_op);
+
+	if (bytes)
+		printf(" %8.1f MB/s", bytes / (ns / 1e9) / (1024 * 1024));
+
+	for (int it = 0; it < nbaselines; it++) {
+		if (!strcmp(baselines[it].name, name)) {
+			printf("  %+6.1f%% vs baseline", (ns_op - baselines[it].ns_op) * 100 / baselines[it].ns_op);
+			break;
+		}
+	}
+
+	printf("\n");
+}
+
+static void load_baseline(const char *fname)
+{
+	FILE *fp;
+	char buf[256];
+
+	if (!(fp = fopen(fname, "r"))) {
+		fprintf(stderr, "Failed to open baseline %s\n", fname);
+		return;
+	}
+
+	while (nbaselines < (int) countof(baselines) && fgets(buf, sizeof(buf), fp)) {
+		struct baseline *b = &baselines[nbaselines];
+		long long ops;
+
+		if (sscanf(buf, "%63s %lld ops %lf ns/op", b->name, &ops, &b->ns_op) == 3)
+			nbaselines++;
+	}
+
+	fclose(fp);
+}
+
+/* --- the benchmarks --- */
+
+static unsigned int hash_str(const char *key)
+{
+	unsigned int hash = 0;
+
+	while (*key)
+		hash = hash * 101 + (unsigned char) *key++;
+
+	return hash;
+}
+
+// NKEYS distinct keys, reused by the map benchmarks
+#define NKEYS 4096
+static char keys[NKEYS][32];
+
+static void make_keys(void)
+{
+	for (int it = 0; it < NKEYS; it++)
+		snprintf(keys[it], sizeof(keys[0]), "/path/%d/file%d.html", it % 97, it);
+}
+
+static void bench_hashmap(void)
+{
+	const long long iterations = 2000;
+	long long before, found = 0;
+	wget_hashmap_t *map = wget_hashmap_create(128, (wget_hashmap_hash_t) hash_str, (wget_hashmap_compare_t) strcmp);
+
+	for (int it = 0; it < NKEYS; it++)
+		wget_hashmap_put(map, keys[it], strlen(keys[it]) + 1, &it, sizeof(it));
+
+	for (long long round = 0; round < iterations / WARMUP_DIV; round++)
+		for (int it = 0; it < NKEYS; it++)
+			found += !!wget_hashmap_get(map, keys[it]);
+
+	before = now_ns();
+	for (long long round = 0; round < iterations; round++)
+		for (int it = 0; it < NKEYS; it++)
+			found += !!wget_hashmap_get(map, keys[it]);
+	report("hashmap_get", iterations * NKEYS, 0, now_ns() - before);
+
+	if (found < iterations * NKEYS)
+		fprintf(stderr, "hashmap_get: lookups failed\n");
+
+	wget_hashmap_free(&map);
+}
+
+static void bench_stringmap(void)
+{
+	const long long iterations = 500;
+	long long before;
+
+	before = now_ns();
+	for (long long round = 0; round < iterations; round++) {
+		wget_stringmap_t *map = wget_stringmap_create(128);
+
+		for (int it = 0; it < NKEYS; it++)
+			wget_stringmap_put(map, keys[it], NULL, 0);
+
+		wget_stringmap_free(&map);
+	}
+	report("stringmap_put", iterations * NKEYS, 0, now_ns() - before);
+}
+
+static void bench_vector(void)
+{
+	const long long iterations = 2000;
+	long long before, sum = 0;
+
+	before = now_ns();
+	for (long long round = 0; round < iterations; round++) {
+		wget_vector_t *v = wget_vector_create(16, -2, NULL);
+
+		for (int it = 0; it < NKEYS; it++)
+			wget_vector_add(v, &it, sizeof(it));
+		for (int it = 0; it < NKEYS; it++)
+			sum += *(int *) wget_vector_get(v, it);
+
+		wget_vector_free(&v);
+	}
+	report("vector_add_get", iterations * NKEYS * 2, 0, now_ns() - before);
+
+	if (!sum)
+		fprintf(stderr, "vector_add_get: unexpected sum\n");
+}
+
+static void bench_buffer(void)
+{
+	const long long iterations = 2000000;
+	long long before, bytes = 0;
+	wget_buffer_t *buf = wget_buffer_alloc(256);
+
+	for (long long it = 0; it < iterations / WARMUP_DIV; it++)
+		wget_buffer_printf(buf, "GET /index%lld.html?q=%s HTTP/1.1\r\nHost: example%lld.com\r\n", it, "search+term", it % 997);
+
+	before = now_ns();
+	for (long long it = 0; it < iterations; it++) {
+		wget_buffer_printf(buf, "GET /index%lld.html?q=%s HTTP/1.1\r\nHost: example%lld.com\r\n", it, "search+term", it % 997);
+		bytes += buf->length;
+	}
+	report("buffer_printf", iterations, bytes, now_ns() - before);
+
+	wget_buffer_free(&buf);
+}
+
+static void bench_iri_parse(void)
+{
+	const long long iterations = 200000;
+	static const char *uris[] = {
+		"http://example.com/",
+		"https://user:pw@www.example.org:8080/path/to/file.html?query=value&x=1#frag",
+		"https://example.com/%C3%A4%C3%B6%C3%BC/index.html",
+	};
+	long long before, bytes = 0;
+
+	for (long long it = 0; it < iterations / WARMUP_DIV; it++) {
+		wget_iri_t *iri = wget_iri_parse(uris[it % countof(uris)], "utf-8");
+		wget_iri_free(&iri);
+	}
+
+	before = now_ns();
+	for (long long it = 0; it < iterations; it++) {
+		const char *uri = uris[it % countof(uris)];
+		wget_iri_t *iri = wget_iri_parse(uri, "utf-8");
+
+		bytes += strlen(uri);
+		wget_iri_free(&iri);
+	}
+	report("iri_parse", iterations, bytes, now_ns() - before);
+}
+
+static void bench_html_parse(void)
+{
+	const long long iterations = 2000;
+	long long before, bytes = 0;
+	wget_buffer_t *html = wget_buffer_alloc(64 * 1024);
+
+	// a link-heavy page of realistic shape
+	wget_buffer_strcpy(html, "<!DOCTYPE html><html><head><title>bench</title>\n");
+	for (int it = 0; it < 300; it++)
+		wget_buffer_printf_append(html, "<link rel=\"stylesheet\" href=\"/css/style%d.css\">\n", it % 7);
+	wget_buffer_strcat(html, "</head><body>\n");
+	for (int it = 0; it < 1000; it++)
+		wget_buffer_printf_append(html,
+			"<p>Some text with a <a href=\"/page%d.html\">link %d</a> and "
+			"an <img src=\"/img/pic%d.png\" alt=\"x\"></p>\n", it, it, it % 31);
+	wget_buffer_strcat(html, "</body></html>\n");
+
+	for (long long it = 0; it < iterations / WARMUP_DIV; it++) {
+		wget_html_parsed_result_t *res = wget_html_get_urls_inline(html->data, NULL, NULL);
+		wget_html_free_urls_inline(&res);
+	}
+
+	before = now_ns();
+	for (long long it = 0; it < iterations; it++) {
+		wget_html_parsed_result_t *res = wget_html_get_urls_inline(html->data, NULL, NULL);
+
+		bytes += html->length;
+		wget_html_free_urls_inline(&res);
+	}
+	report("html_parse", iterations, bytes, now_ns() - before);
+
+	wget_buffer_free(&html);
+}
+
+static void bench_base64(void)
+{
+	const long long iterations = 200000;
+	char data[1024], encoded[wget_base64_get_encoded_length(sizeof(data))];
+	char decoded[sizeof(data) + 3];
+	long long before, bytes = 0;
+	size_t enc_len;
+
+	for (unsigned it = 0; it < sizeof(data); it++)
+		data[it] = (char) (it * 17);
+
+	enc_len = wget_base64_encode(encoded, data, sizeof(data));
+
+	before = now_ns();
+	for (long long it = 0; it < iterations; it++) {
+		wget_base64_encode(encoded, data, sizeof(data));
+		bytes += sizeof(data);
+	}
+	report("base64_encode", iterations, bytes, now_ns() - before);
+
+	before = now_ns();
+	for (long long it = 0; it < iterations; it++) {
+		wget_base64_decode(decoded, encoded, enc_len);
+		bytes += enc_len;
+	}
+	report("base64_decode", iterations, bytes, now_ns() - before);
+}
+
+static void bench_utils(void)
+{
+	const long long iterations = 2000000;
+	unsigned char digest[32]; // SHA-256 sized, the common case
+	char hex[sizeof(digest) * 2 + 1];
+	// equal but for case, so the compare always runs the full length
+	const char *u1 = "HTTP://Example.COM/Path/To/Some/Resource/Index.HTML?Query=Value";
+	const char *u2 = "http://example.com/path/to/some/resource/index.html?query=value";
+	long long before, bytes = 0, sink = 0;
+
+	for (unsigned it = 0; it < sizeof(digest); it++)
+		digest[it] = (unsigned char) (it * 37);
+
+	before = now_ns();
+	for (long long it = 0; it < iterations; it++) {
+		wget_memtohex(digest, sizeof(digest), hex, sizeof(hex));
+		bytes += sizeof(digest);
+	}
+	report("memtohex", iterations, bytes, now_ns() - before);
+
+	bytes = 0;
+	before = now_ns();
+	for (long long it = 0; it < iterations; it++) {
+		sink += wget_strcasecmp_ascii(u1, u2);
+		bytes += (long long) strlen(u2);
+	}
+	report("strcasecmp_ascii", iterations, bytes, now_ns() - before);
+
+	if (sink)
+		fprintf(stderr, "strcasecmp_ascii: expected equal strings\n");
+}
+
+#ifdef WITH_ZLIB
+static int null_sink(G_GNUC_WGET_UNUSED void *context, G_GNUC_WGET_UNUSED const char *data, size_t length)
+{
+	*(long long *) context += length;
+	return 0;
+}
+
+static void bench_decompress(void)
+{
+	const long long iterations = 2000;
+	long long before, in_bytes = 0, out_bytes = 0;
+	Bytef raw[64 * 1024], compressed[80 * 1024];
+	uLongf compressed_len = sizeof(compressed);
+
+	// compressible but not trivial input
+	for (unsigned it = 0; it < sizeof(raw); it++)
+		raw[it] = (Bytef) ((it / 13) % 61 + ' ');
+
+	if (compress2(compressed, &compressed_len, raw, sizeof(raw), Z_DEFAULT_COMPRESSION) != Z_OK) {
+		fprintf(stderr, "decompress: failed to prepare input\n");
+		return;
+	}
+
+	before = now_ns();
+	for (long long it = 0; it < iterations; it++) {
+		wget_decompressor_t *dc = wget_decompress_open(wget_content_encoding_deflate, null_sink, &out_bytes);
+
+		wget_decompress(dc, (char *) compressed, compressed_len);
+		wget_decompress_close(dc);
+		in_bytes += sizeof(raw);
+	}
+	report("decompress_deflate", iterations, in_bytes, now_ns() - before);
+
+	if (out_bytes != iterations * (long long) sizeof(raw))
+		fprintf(stderr, "decompress_deflate: output size mismatch\n");
+}
+#endif
+
+int main(int argc, const char **argv)
+{
+	if (argc > 1)
+		load_baseline(argv[1]);
+
+	make_keys();
+
+	bench_hashmap();
+	bench_stringmap();
+	bench_vector();
+	bench_buffer();
+	bench_iri_parse();
+	bench_html_parse();
+	bench_base64();
+	bench_utils();
+#ifdef WITH_ZLIB
+	bench_decompress();
+#endif
+
+	return 0;
+}
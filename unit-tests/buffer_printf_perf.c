@@ -31,6 +31,19 @@
 
 #include <wget.h>
 
+#define ITERATIONS 10000000
+
+// time one formatting statement over ITERATIONS runs
+#define BENCH(name, statement) \
+do { \
+	long long before = wget_get_timemillis(); \
+	for (unsigned it = 0; it < ITERATIONS; it++) { \
+		buf.length = 0; \
+		statement; \
+	} \
+	printf("%-32s: %lld ms\n", name, wget_get_timemillis() - before); \
+} while (0)
+
 int main(void)
 {
 	wget_buffer_t buf;
@@ -38,40 +51,16 @@ int main(void)
 
 	wget_buffer_init(&buf, sbuf, sizeof(sbuf));
 
-	for (unsigned it = 0; it < 10000000; it++) {
-		// buffer: 0.239s  libc: 0.018s (gcc replaces sprintf(%s) by strcpy())
-//		snprintf(sbuf,sizeof(sbuf),"%s", "teststring sabbeldi heidewitzka\n");
-//		buffer_printf(&buf,"%s", "teststring sabbeldi heidewitzka\n");
-
-		// buffer: 0.306s  libc: 1.040s
-//		sprintf(sbuf,"%s\n", "teststring sabbeldi heidewitzka\n");
-//		buffer_printf(&buf,"%s\n", "teststring sabbeldi heidewitzka\n");
-
-		// function call and loop overhead: buffer: 0.072s libc: 0.390s
-//		buffer_printf(&buf, "", "teststring sabbeldi heidewitzka\n");
-//		sprintf(sbuf, "", "teststring sabbeldi heidewitzka\n");
-
-		// buffer: 0.392s  libc: 0.838s
-//		sprintf(sbuf,"%.*s\n", 17, "teststring sabbeldi heidewitzka\n");
-//		buffer_printf(&buf,"%.*s\n", 17, "teststring sabbeldi heidewitzka\n");
-
-		// buffer: 0.407s  libc: 0.960s
-//		sprintf(sbuf,"%d\n", it);
-//		buffer_printf(&buf,"%d\n", it);
-
-		// buffer: 0.643s  libc/sprintf: 1.251s  libc/snprintf: 1.253s
-//		snprintf(sbuf,sizeof(sbuf),"%10.*d\n", 8, it);
-//		sprintf(sbuf,"%10.*d\n", 8, it);
-//		buffer_printf(&buf,"%10.*d\n", 8, it);
-
-		// buffer: 0.456s  libc: 0.867s
-//		sprintf(sbuf,"%X\n", it);
-		wget_buffer_printf(&buf, "%X\n", it);
+	BENCH("printf %d", wget_buffer_printf(&buf, "%d\n", it));
+	BENCH("printf %X", wget_buffer_printf(&buf, "%X\n", it));
+	BENCH("printf %10.8d", wget_buffer_printf(&buf, "%10.*d\n", 8, it));
+	BENCH("printf %s + %d", wget_buffer_printf(&buf, "teststring %s sabbeldi %d\n", "[foobar foobar foobar]", it));
+	BENCH("append_int", wget_buffer_append_int(&buf, it));
+	BENCH("append_hex", wget_buffer_append_hex(&buf, it));
 
-		// buffer: 0.955s  libc: 1.648s
-//		sprintf(sbuf,"teststring %s sabbeldi %d\n", "[foobar foobar foobar]", it);
-//		buffer_printf(&buf,"teststring %s sabbeldi %d\n", "[foobar foobar foobar]", it);
-	}
+	// libc reference numbers (same machine, same iteration count)
+	BENCH("sprintf %d (libc)", sprintf(sbuf, "%d\n", it));
+	BENCH("sprintf %X (libc)", sprintf(sbuf, "%X\n", it));
 
 	wget_buffer_deinit(&buf);
 
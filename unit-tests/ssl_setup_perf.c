@@ -0,0 +1,57 @@
+/*
+ * Copyright(c) 2015-2016 Free Software Foundation, Inc.
+ *
+ * This file is part of Wget.
+ *
+ * Wget is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Wget is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Wget.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ *
+ * testing performance of the TLS session setup
+ *
+ * Measures the one-time cost of wget_ssl_init() (priority string
+ * compilation, credential allocation, trust store loading) - the work
+ * that would be paid on every connection if it weren't cached per
+ * process. With N threads connecting at once, the saving is roughly
+ * N times the printed value.
+ *
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+
+#include <wget.h>
+
+int main(void)
+{
+	long long before, after;
+	int iterations = 20;
+
+	// don't let the trust store scan depend on whatever the test host has configured
+	wget_ssl_set_config_string(WGET_SSL_CA_DIRECTORY, "system");
+
+	before = wget_get_timemillis();
+
+	for (int it = 0; it < iterations; it++) {
+		wget_ssl_init();
+		wget_ssl_deinit();
+	}
+
+	after = wget_get_timemillis();
+
+	printf("TLS session setup: %.1f ms per init (priority compilation + trust store)\n",
+		(double) (after - before) / iterations);
+
+	return 0;
+}
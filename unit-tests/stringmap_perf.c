@@ -47,13 +47,12 @@ static int G_GNUC_WGET_NONNULL_ALL _print_word(G_GNUC_WGET_UNUSED void *ctx, con
 	return 0;
 }
 
-int main(int argc, const char *const *argv)
+static void _fill_map(wget_stringmap_t *map, int argc, const char *const *argv, int *uniquep, int *duplep)
 {
 	int fd, it, unique = 0, duple = 0;
 	char *buf, *word, *end;
 	size_t length;
 	struct stat st;
-	wget_stringmap_t *map = wget_stringmap_create(1024);
 
 	for (it = 1; it < argc; it++) {
 		if ((fd = open(argv[it], O_RDONLY | O_BINARY)) == -1) {
@@ -116,7 +115,35 @@ int main(int argc, const char *const *argv)
 		close(fd);
 	}
 
-	printf("read %d words, %d uniques, %d doubles\n", unique + duple, unique, duple);
+	*uniquep = unique;
+	*duplep = duple;
+}
+
+int main(int argc, const char *const *argv)
+{
+	int unique = 0, duple = 0;
+	long long before, after;
+	wget_stringmap_t *map = wget_stringmap_create(1024);
+
+	// pass 1: the default stringmap, one malloc per key
+	before = wget_get_timemillis();
+	_fill_map(map, argc, argv, &unique, &duple);
+	after = wget_get_timemillis();
+
+	printf("read %d words, %d uniques, %d doubles (malloc keys: %lld ms)\n", unique + duple, unique, duple, after - before);
+
+	// pass 2: same input into an arena-backed stringmap, keys bump-allocated in chunks
+	{
+		wget_stringmap_t *arena_map = wget_stringmap_create_arena(1024);
+
+		before = wget_get_timemillis();
+		_fill_map(arena_map, argc, argv, &unique, &duple);
+		after = wget_get_timemillis();
+
+		printf("read %d words, %d uniques, %d doubles (arena keys : %lld ms)\n", unique + duple, unique, duple, after - before);
+
+		wget_stringmap_free(&arena_map);
+	}
 
 	// const void *keys = stringmap_get_keys(map);
 	wget_stringmap_browse(map, (wget_stringmap_browse_t)_print_word, NULL);
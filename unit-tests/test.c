@@ -106,6 +106,36 @@ static void test_mem(void)
 
 }
 
+static void test_refstr(void)
+{
+	char *p;
+	const char *s;
+
+	CHECK(!wget_refstr_dup(NULL));
+	CHECK(!wget_refstr_len(NULL));
+
+	CHECK(p = wget_refstr_dup("xxx"));
+	CHECK(!strcmp(p, "xxx"));
+	CHECK(wget_refstr_len(p) == 3);
+	s = p;
+	wget_refstr_unref(&s);
+	CHECK(!s);
+
+	CHECK(p = wget_refstr_memdup("xxx", 1));
+	CHECK(!strcmp(p, "x"));
+	CHECK(wget_refstr_len(p) == 1);
+	CHECK(wget_refstr_ref(p) == p); // refcount 2 now
+	s = p;
+	wget_refstr_unref(&s); // refcount 1, must not be free'd yet
+	CHECK(!strcmp(p, "x"));
+	s = p;
+	wget_refstr_unref(&s);
+
+	s = NULL;
+	wget_refstr_unref(&s); // must not crash
+	CHECK(!wget_refstr_ref(NULL));
+}
+
 static void test_strlcpy(void)
 {
 	char buf[4] = "x";
@@ -322,6 +352,27 @@ static void test_buffer_printf(void)
 	} else
 		ok++;
 
+	// the dedicated number appenders must match their printf equivalents
+	for (it = 0; it < countof(number); it++) {
+		wget_buffer_reset(&buf);
+		wget_buffer_append_int(&buf, number[it]);
+		snprintf(result, sizeof(result), "%lld", number[it]);
+		if (strcmp(result, buf.data)) {
+			failed++;
+			info_printf("%s: append_int(%lld) = '%s', expected '%s'\n", __func__, number[it], buf.data, result);
+		} else
+			ok++;
+
+		wget_buffer_reset(&buf);
+		wget_buffer_append_hex(&buf, (unsigned long long) number[it]);
+		snprintf(result, sizeof(result), "%llx", (unsigned long long) number[it]);
+		if (strcmp(result, buf.data)) {
+			failed++;
+			info_printf("%s: append_hex(%llu) = '%s', expected '%s'\n", __func__, (unsigned long long) number[it], buf.data, result);
+		} else
+			ok++;
+	}
+
 	// sprintf on Solaris and Windows uses spaces instead of 0s for e.g. %03s padding
 	// we skip those test when we detect such behavior
 #if defined __clang__ || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 5)
@@ -1792,6 +1843,130 @@ static void test_vector(void)
 	}
 
 	wget_vector_free(&v);
+
+	// exercise the spill from inline small-buffer storage to the heap
+	v = wget_vector_create(2, -2, NULL);
+
+	for (n = 0; n < 20; n++)
+		wget_vector_add(v, &n, sizeof(n));
+
+	if (wget_vector_size(v) == 20)
+		ok++;
+	else {
+		failed++;
+		info_printf("test_vector: got size %d, expected 20\n", wget_vector_size(v));
+	}
+
+	for (n = 0; n < 20; n++) {
+		int *ep = wget_vector_get(v, n);
+		if (!ep || *ep != n) {
+			failed++;
+			info_printf("test_vector: entry %d broken after resize\n", n);
+			break;
+		}
+	}
+	if (n == 20)
+		ok++;
+
+	wget_vector_free(&v);
+
+	// bulk load a shuffled batch, the result must be fully sorted
+	{
+		struct ENTRY *batch[countof(txt)];
+
+		for (it = 0; it < countof(txt); it++)
+			batch[it] = wget_memdup(txt[it], sizeof(struct ENTRY));
+
+		v = wget_vector_create_sorted(countof(txt), (void **)batch, (wget_vector_compare_t)compare_txt);
+
+		for (it = 0, n = 1; it < countof(txt); it++) {
+			struct ENTRY *e = wget_vector_get(v, it);
+			if (!e || strcmp(e->txt, txt_sorted[it].txt))
+				n = 0;
+		}
+		if (n)
+			ok++;
+		else {
+			failed++;
+			info_printf("test_vector: create_sorted() result not sorted\n");
+		}
+
+		wget_vector_free(&v);
+	}
+
+	// merge a batch into an already sorted vector
+	{
+		struct ENTRY *batch[countof(txt) - 2];
+
+		v = wget_vector_create(2, -2, (wget_vector_compare_t)compare_txt);
+		wget_vector_insert_sorted(v, txt[0], sizeof(struct ENTRY));
+		wget_vector_insert_sorted(v, txt[1], sizeof(struct ENTRY));
+
+		for (it = 2; it < countof(txt); it++)
+			batch[it - 2] = wget_memdup(txt[it], sizeof(struct ENTRY));
+
+		wget_vector_add_batch_sorted(v, (void **)batch, countof(batch));
+
+		for (it = 0, n = 1; it < countof(txt); it++) {
+			struct ENTRY *e = wget_vector_get(v, it);
+			if (!e || strcmp(e->txt, txt_sorted[it].txt))
+				n = 0;
+		}
+		if (n)
+			ok++;
+		else {
+			failed++;
+			info_printf("test_vector: add_batch_sorted() result not sorted\n");
+		}
+
+		wget_vector_free(&v);
+	}
+}
+
+static void test_mpmc_queue(void)
+{
+	wget_mpmc_queue_t *q = wget_mpmc_queue_create(5); // rounded up to 8
+	int values[8];
+
+	if (wget_mpmc_queue_pop(q) == NULL)
+		ok++;
+	else
+		failed++;
+
+	// fill up to capacity, the 9th push must fail
+	for (unsigned it = 0; it < countof(values); it++) {
+		values[it] = it;
+		if (wget_mpmc_queue_push(q, &values[it]) == 0)
+			ok++;
+		else
+			failed++;
+	}
+
+	if (wget_mpmc_queue_push(q, values) == -1)
+		ok++;
+	else
+		failed++;
+
+	if (wget_mpmc_queue_size(q) == countof(values))
+		ok++;
+	else
+		failed++;
+
+	// FIFO order on drain
+	for (unsigned it = 0; it < countof(values); it++) {
+		int *p = wget_mpmc_queue_pop(q);
+		if (p && *p == (int) it)
+			ok++;
+		else
+			failed++;
+	}
+
+	if (wget_mpmc_queue_pop(q) == NULL)
+		ok++;
+	else
+		failed++;
+
+	wget_mpmc_queue_free(&q);
 }
 
 // this hash function generates collisions and reduces the map to a simple list.
@@ -1801,6 +1976,154 @@ static unsigned int hash_txt(G_GNUC_WGET_UNUSED const char *key)
 	return 0;
 }
 
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+static unsigned int hash_txt2(const char *key)
+{
+	unsigned int hash = 0;
+
+	while (*key)
+		hash = hash * 101 + (unsigned char)*key++;
+
+	return hash;
+}
+
+static void test_hashmap_linear(void)
+{
+	wget_hashmap_t *m;
+	char key[128], value[128], *val;
+	int run, it;
+
+	// the initial size of 4 forces several rehashes while filling the map
+
+	m = wget_hashmap_create_linear(4, (wget_hashmap_hash_t)hash_txt2, (wget_hashmap_compare_t)wget_strcmp);
+
+	for (run = 0; run < 2; run++) {
+		if (run) {
+			// reduce the map to a linear scan by generating collisions
+			wget_hashmap_clear(m);
+			wget_hashmap_sethashfunc(m, (wget_hashmap_hash_t)hash_txt);
+		}
+
+		for (it = 0; it < 26; it++) {
+			snprintf(key, sizeof(key), "http://www.example.com/subdir/%d.html", it);
+			int valuesize = snprintf(value, sizeof(value), "%d.html", it);
+			if (wget_hashmap_put(m, key, strlen(key) + 1, value, valuesize + 1)) {
+				failed++;
+				info_printf("hashmap_put(%s) returns unexpected old value\n", key);
+			} else ok++;
+		}
+
+		if ((it = wget_hashmap_size(m)) != 26) {
+			failed++;
+			info_printf("hashmap_size() returned %d (expected %d)\n", it, 26);
+		} else ok++;
+
+		// now, look up every single entry
+		for (it = 0; it < 26; it++) {
+			snprintf(key, sizeof(key), "http://www.example.com/subdir/%d.html", it);
+			snprintf(value, sizeof(value), "%d.html", it);
+			if (!(val = wget_hashmap_get(m, key))) {
+				failed++;
+				info_printf("hashmap_get(%s) didn't find entry\n", key);
+			} else if (strcmp(val, value)) {
+				failed++;
+				info_printf("hashmap_get(%s) found '%s' (expected '%s')\n", key, val, value);
+			} else ok++;
+		}
+
+		// now, remove every odd entry (exercises the backward-shift deletion)
+		for (it = 1; it < 26; it += 2) {
+			snprintf(key, sizeof(key), "http://www.example.com/subdir/%d.html", it);
+			wget_hashmap_remove(m, key) ? ok++ : failed++;
+		}
+
+		if ((it = wget_hashmap_size(m)) != 13) {
+			failed++;
+			info_printf("hashmap_size() returned %d (expected %d)\n", it, 13);
+		} else ok++;
+
+		// the even entries must still be found
+		for (it = 0; it < 26; it += 2) {
+			snprintf(key, sizeof(key), "http://www.example.com/subdir/%d.html", it);
+			wget_hashmap_get(m, key) ? ok++ : failed++;
+		}
+	}
+
+	wget_hashmap_free(&m);
+}
+
+static void test_html_stream(void)
+{
+	// chunk-wise HTML parsing must extract exactly the same URLs as parsing
+	// the complete document at once, no matter where the chunk borders fall
+	static const char *html =
+		"<!DOCTYPE html><html><head>\n"
+		"<meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\">\n"
+		"<base href=\"http://example.com/sub/\">\n"
+		"<link rel=\"stylesheet\" href=\"theme.css\">\n"
+		"<style>body { background: url(bg.png); }</style>\n"
+		"<script>var fake = \"<a href='not-a-link.html'>\";</script>\n"
+		"</head><body>\n"
+		"<!-- <a href=\"commented-out.html\">nope</a> -->\n"
+		"<a href=\"page1.html\">one</a>\n"
+		"<img src=\"image.jpg\" srcset=\"small.jpg 1x, big.jpg 2x\">\n"
+		"<div style=\"background-image: url('inline.png')\">text</div>\n"
+		"<a href = 'page2.html' >two</a>\n"
+		"</body></html>\n";
+
+	wget_html_parsed_result_t *expected = wget_html_get_urls_inline(html, NULL, NULL);
+	size_t html_len = strlen(html);
+
+	for (size_t chunk_size = 1; chunk_size <= 7; chunk_size++) {
+		wget_html_stream_t *stream = wget_html_stream_init(NULL, NULL);
+
+		for (size_t offset = 0; offset < html_len; offset += chunk_size)
+			wget_html_stream_feed(stream, html + offset, offset + chunk_size <= html_len ? chunk_size : html_len - offset);
+
+		wget_html_parsed_result_t *parsed = wget_html_stream_close(&stream, html);
+
+		if (wget_vector_size(parsed->uris) != wget_vector_size(expected->uris)) {
+			failed++;
+			info_printf("html_stream (chunk size %zu) found %d URLs (expected %d)\n",
+				chunk_size, wget_vector_size(parsed->uris), wget_vector_size(expected->uris));
+		} else {
+			int mismatch = 0;
+
+			for (int it = 0; it < wget_vector_size(expected->uris); it++) {
+				wget_html_parsed_url_t *a = wget_vector_get(expected->uris, it);
+				wget_html_parsed_url_t *b = wget_vector_get(parsed->uris, it);
+
+				if (a->url.p != b->url.p || a->url.len != b->url.len
+					|| strcmp(a->attr, b->attr) || strcmp(a->dir, b->dir))
+				{
+					failed++;
+					info_printf("html_stream (chunk size %zu) URL %d mismatch: '%.*s' (expected '%.*s')\n",
+						chunk_size, it, (int) b->url.len, b->url.p, (int) a->url.len, a->url.p);
+					mismatch = 1;
+					break;
+				}
+			}
+			if (!mismatch) ok++;
+		}
+
+		if (parsed->base.p != expected->base.p || parsed->base.len != expected->base.len) {
+			failed++;
+			info_printf("html_stream (chunk size %zu) base mismatch\n", chunk_size);
+		} else ok++;
+
+		if (wget_strcmp(parsed->encoding, expected->encoding)) {
+			failed++;
+			info_printf("html_stream (chunk size %zu) encoding mismatch '%s'\n", chunk_size, parsed->encoding);
+		} else ok++;
+
+		wget_html_free_urls_inline(&parsed);
+	}
+
+	wget_html_free_urls_inline(&expected);
+}
+
 static void test_stringmap(void)
 {
 	wget_stringmap_t *m;
@@ -1893,6 +2216,27 @@ static void test_stringmap(void)
 		} else ok++;
 	}
 
+	// testing the snapshot API: every entry shows up exactly once
+	{
+		void **snapshot;
+		int count = wget_hashmap_snapshot(m, &snapshot);
+
+		if (count != wget_stringmap_size(m)) {
+			failed++;
+			info_printf("hashmap_snapshot() returned %d entries (expected %d)\n", count, wget_stringmap_size(m));
+		} else ok++;
+
+		for (it = 0; it < count; it++) {
+			const char *k = strrchr(snapshot[2 * it], '/');
+			if (!k || strcmp(snapshot[2 * it + 1], k + 1)) {
+				failed++;
+				info_printf("hashmap_snapshot() key/value mismatch '%s' / '%s'\n", (char *) snapshot[2 * it], (char *) snapshot[2 * it + 1]);
+			} else ok++;
+		}
+
+		xfree(snapshot);
+	}
+
 	// testing alloc/free in stringmap/hashmap
 	wget_stringmap_clear(m);
 	wget_stringmap_put(m, "thekey", NULL, 0) ? failed++ : ok++;
@@ -2303,6 +2647,50 @@ static void test_set_proxy(void)
 	}
 }
 
+static void test_parse_full_date(void)
+{
+	static const struct test_data {
+		const char *
+			date;
+		long long
+			expected;
+	} test_data[] = {
+		// IMF-fixdate takes the fixed-offset fast path
+		{ "Sun, 06 Nov 1994 08:37:18 GMT", 784111038 },
+		{ "Wed, 09 Jun 2021 10:18:14 GMT", 1623233894 },
+		// month names match case-insensitively
+		{ "Sun, 06 NOV 1994 08:37:18 GMT", 784111038 },
+		// RFC 850 and asctime() formats go through the sscanf path
+		{ "Sunday, 06-Nov-94 08:37:18 GMT", 784111038 },
+		{ "Sun Nov  6 08:37:18 1994", 784111038 },
+		// non-standard, without a weekday
+		{ "6 Nov 1994 08:37:18 GMT", 784111038 },
+		// garbage month names must not slip through the hash
+		{ "Sun, 06 Xyz 1994 08:37:18 GMT", 0 },
+	};
+
+	for (unsigned it = 0; it < countof(test_data); it++) {
+		const struct test_data *t = &test_data[it];
+		long long res = wget_http_parse_full_date(t->date);
+
+		if (res == t->expected)
+			ok++;
+		else {
+			failed++;
+			info_printf("Failed [%u]: wget_http_parse_full_date(%s) -> %lld (expected %lld)\n",
+				it, t->date, res, t->expected);
+		}
+
+		// the repeat is answered from the per-thread memo
+		if (wget_http_parse_full_date(t->date) == res)
+			ok++;
+		else {
+			failed++;
+			info_printf("Failed [%u]: memoized wget_http_parse_full_date(%s) differs\n", it, t->date);
+		}
+	}
+}
+
 static void test_parse_response_header(void)
 {
 	char *response_text = wget_strdup(
@@ -2378,6 +2766,7 @@ int main(int argc, const char **argv)
 
 	// testing basic library functionality
 	test_mem();
+	test_refstr();
 	test_strlcpy();
 	test_buffer();
 	test_buffer_printf();
@@ -2385,7 +2774,10 @@ int main(int argc, const char **argv)
 	test_strcasecmp_ascii();
 	test_hashing();
 	test_vector();
+	test_mpmc_queue();
 	test_stringmap();
+	test_html_stream();
+	test_hashmap_linear();
 	test_striconv();
 
 	if (failed) {
@@ -2408,6 +2800,7 @@ int main(int argc, const char **argv)
 	test_netrc();
 	test_robots();
 	test_set_proxy();
+	test_parse_full_date();
 	test_parse_response_header();
 
 	selftest_options() ? failed++ : ok++;